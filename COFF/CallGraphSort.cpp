@@ -0,0 +1,68 @@
+//===- CallGraphSort.cpp --------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file builds the graph of section chunks that the clustering in
+// lld/Common/CallGraphSort.h orders, from Config->CallGraphProfile.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphSort.h"
+#include "Chunks.h"
+#include "Config.h"
+#include "lld/Common/CallGraphSort.h"
+#include <climits>
+
+using namespace llvm;
+
+namespace lld {
+namespace coff {
+
+// Returns the sections in the call graph profile in the order in which they
+// should be laid out. The priorities are negative, like those of /order, so
+// that the sections come before those that are not in the profile.
+DenseMap<const SectionChunk *, int> computeCallGraphProfileOrder() {
+  std::vector<const SectionChunk *> Sections;
+  std::vector<uint64_t> Sizes;
+  std::vector<CallGraphArc> Arcs;
+  DenseMap<const SectionChunk *, int> SecToNode;
+
+  auto GetOrCreateNode = [&](const SectionChunk *SC) -> int {
+    auto Res = SecToNode.insert(std::make_pair(SC, Sections.size()));
+    if (Res.second) {
+      Sections.push_back(SC);
+      Sizes.push_back(SC->getSize());
+    }
+    return Res.first->second;
+  };
+
+  for (const auto &C : Config->CallGraphProfile) {
+    const SectionChunk *FromSC = C.first.first;
+    const SectionChunk *ToSC = C.first.second;
+
+    // The Writer only reorders chunks with the same section name and
+    // characteristics, so ignore edges between chunks that are not placed
+    // together, as the ELF linker does for different output sections.
+    if (FromSC->getSectionName() != ToSC->getSectionName() ||
+        FromSC->getOutputCharacteristics() != ToSC->getOutputCharacteristics())
+      continue;
+
+    int From = GetOrCreateNode(FromSC);
+    int To = GetOrCreateNode(ToSC);
+    Arcs.push_back({From, To, C.second});
+  }
+
+  DenseMap<const SectionChunk *, int> OrderMap;
+  int CurOrder = INT_MIN;
+  for (int I : sortCallGraph(Sizes, Arcs, CallGraphSortOptions()))
+    OrderMap[Sections[I]] = CurOrder++;
+  return OrderMap;
+}
+
+} // namespace coff
+} // namespace lld
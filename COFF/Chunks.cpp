@@ -12,6 +12,7 @@
 #include "Symbols.h"
 #include "Writer.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/BinaryFormat/COFF.h"
 #include "llvm/Object/COFF.h"
@@ -30,10 +31,9 @@ namespace lld {
 namespace coff {
 
 SectionChunk::SectionChunk(ObjFile *F, const coff_section *H)
-    : Chunk(SectionKind), Repl(this), Header(H), File(F),
-      Relocs(File->getCOFFObj()->getRelocations(Header)) {
-  // Initialize SectionName.
-  File->getCOFFObj()->getSectionName(Header, SectionName);
+    : Chunk(SectionKind), Repl(this), Header(H), File(F) {
+  ArrayRef<coff_relocation> Relocs = File->getCOFFObj()->getRelocations(Header);
+  RelocsData = Relocs.empty() ? nullptr : Relocs.data();
 
   Alignment = Header->getAlignment();
 
@@ -300,9 +300,39 @@ void SectionChunk::writeTo(uint8_t *Buf) const {
   if (!A.empty())
     memcpy(Buf + OutputSectionOff, A.data(), A.size());
 
-  // Apply relocations.
+  // Apply relocations. The loop is instantiated for each machine so that
+  // the relocation type is dispatched directly.
+  switch (Config->Machine) {
+  case AMD64:
+    applyRelocations<AMD64>(Buf);
+    break;
+  case I386:
+    applyRelocations<I386>(Buf);
+    break;
+  case ARMNT:
+    applyRelocations<ARMNT>(Buf);
+    break;
+  case ARM64:
+    applyRelocations<ARM64>(Buf);
+    break;
+  default:
+    llvm_unreachable("unknown machine type");
+  }
+}
+
+template <uint16_t Machine>
+void SectionChunk::applyRelocations(uint8_t *Buf) const {
   size_t InputSize = getSize();
-  for (const coff_relocation &Rel : Relocs) {
+  uint8_t *Base = Buf + OutputSectionOff;
+
+  // Consecutive relocations often refer to the same symbol, e.g. the
+  // section symbol of .text in debug info, so the last resolved target is
+  // kept.
+  uint32_t LastIndex = UINT32_MAX;
+  OutputSection *OS = nullptr;
+  uint64_t S = 0;
+
+  for (const coff_relocation &Rel : getRelocs()) {
     // Check for an invalid relocation offset. This check isn't perfect, because
     // we don't have the relocation size, which is only known after checking the
     // machine and relocation type. As a result, a relocation may overwrite the
@@ -310,43 +340,46 @@ void SectionChunk::writeTo(uint8_t *Buf) const {
     if (Rel.VirtualAddress >= InputSize)
       fatal("relocation points beyond the end of its parent section");
 
-    uint8_t *Off = Buf + OutputSectionOff + Rel.VirtualAddress;
-
-    // Get the output section of the symbol for this relocation.  The output
-    // section is needed to compute SECREL and SECTION relocations used in debug
-    // info.
-    auto *Sym =
-        dyn_cast_or_null<Defined>(File->getSymbol(Rel.SymbolTableIndex));
-    if (!Sym) {
-      if (isCodeView() || isDWARF())
-        continue;
-      // Symbols in early discarded sections are represented using null pointers,
-      // so we need to retrieve the name from the object file.
-      COFFSymbolRef Sym =
-          check(File->getCOFFObj()->getSymbol(Rel.SymbolTableIndex));
-      StringRef Name;
-      File->getCOFFObj()->getSymbolName(Sym, Name);
-      fatal("relocation against symbol in discarded section: " + Name);
+    if (Rel.SymbolTableIndex != LastIndex) {
+      // Get the output section of the symbol for this relocation. The output
+      // section is needed to compute SECREL and SECTION relocations used in
+      // debug info.
+      auto *Sym =
+          dyn_cast_or_null<Defined>(File->getSymbol(Rel.SymbolTableIndex));
+      if (!Sym) {
+        if (isCodeView() || isDWARF())
+          continue;
+        // Symbols in early discarded sections are represented using null
+        // pointers, so we need to retrieve the name from the object file.
+        COFFSymbolRef Sym =
+            check(File->getCOFFObj()->getSymbol(Rel.SymbolTableIndex));
+        StringRef Name;
+        File->getCOFFObj()->getSymbolName(Sym, Name);
+        fatal("relocation against symbol in discarded section: " + Name);
+      }
+      Chunk *C = Sym->getChunk();
+      OS = C ? C->getOutputSection() : nullptr;
+
+      // Only absolute and __ImageBase symbols lack an output section. For any
+      // other symbol, this indicates that the chunk was discarded. Normally
+      // relocations against discarded sections are an error. However, debug
+      // info sections are not GC roots and can end up with these kinds of
+      // relocations. Skip these relocations.
+      if (!OS && !isa<DefinedAbsolute>(Sym) && !isa<DefinedSynthetic>(Sym)) {
+        if (isCodeView() || isDWARF())
+          continue;
+        fatal("relocation against symbol in discarded section: " +
+              Sym->getName());
+      }
+      S = Sym->getRVA();
+      LastIndex = Rel.SymbolTableIndex;
     }
-    Chunk *C = Sym->getChunk();
-    OutputSection *OS = C ? C->getOutputSection() : nullptr;
-
-    // Only absolute and __ImageBase symbols lack an output section. For any
-    // other symbol, this indicates that the chunk was discarded.  Normally
-    // relocations against discarded sections are an error.  However, debug info
-    // sections are not GC roots and can end up with these kinds of relocations.
-    // Skip these relocations.
-    if (!OS && !isa<DefinedAbsolute>(Sym) && !isa<DefinedSynthetic>(Sym)) {
-      if (isCodeView() || isDWARF())
-        continue;
-      fatal("relocation against symbol in discarded section: " +
-            Sym->getName());
-    }
-    uint64_t S = Sym->getRVA();
+
+    uint8_t *Off = Base + Rel.VirtualAddress;
 
     // Compute the RVA of the relocation for relative relocations.
     uint64_t P = RVA + Rel.VirtualAddress;
-    switch (Config->Machine) {
+    switch (Machine) {
     case AMD64:
       applyRelX64(Off, Rel.Type, OS, S, P);
       break;
@@ -359,14 +392,30 @@ void SectionChunk::writeTo(uint8_t *Buf) const {
     case ARM64:
       applyRelARM64(Off, Rel.Type, OS, S, P);
       break;
-    default:
-      llvm_unreachable("unknown machine type");
     }
   }
 }
 
+// SectionChunk is allocated for every section of every input file, so keep
+// an eye on its size.
+static_assert(sizeof(SectionChunk) <= 104, "SectionChunk grew");
+
+// Section names are not stored in the chunk. Short names are read directly
+// from the header; long names ("/nnn") are looked up in the string table.
+StringRef SectionChunk::getSectionName() const {
+  if (Header->Name[0] != '/')
+    return StringRef(Header->Name, strnlen(Header->Name, NameSize));
+  StringRef Name;
+  File->getCOFFObj()->getSectionName(Header, Name);
+  return Name;
+}
+
 void SectionChunk::addAssociative(SectionChunk *Child) {
-  AssocChildren.push_back(Child);
+  // Append to the tail so that children are visited in insertion order.
+  SectionChunk **P = &AssocChildren;
+  while (*P)
+    P = &(*P)->AssocNext;
+  *P = Child;
 }
 
 static uint8_t getBaserelType(const coff_relocation &Rel) {
@@ -399,7 +448,7 @@ static uint8_t getBaserelType(const coff_relocation &Rel) {
 // fixed by the loader if load-time relocation is needed.
 // Only called when base relocation is enabled.
 void SectionChunk::getBaserels(std::vector<Baserel> *Res) {
-  for (const coff_relocation &Rel : Relocs) {
+  for (const coff_relocation &Rel : getRelocs()) {
     uint8_t Ty = getBaserelType(Rel);
     if (Ty == IMAGE_REL_BASED_ABSOLUTE)
       continue;
@@ -523,7 +572,7 @@ void RVATableChunk::writeTo(uint8_t *Buf) const {
   size_t Cnt = 0;
   for (const ChunkAndOffset &CO : Syms)
     Begin[Cnt++] = CO.InputChunk->getRVA() + CO.Offset;
-  std::sort(Begin, Begin + Cnt);
+  parallelSort(Begin, Begin + Cnt, std::less<uint32_t>());
   assert(std::unique(Begin, Begin + Cnt) == Begin + Cnt &&
          "RVA tables should be de-duplicated");
 }
@@ -567,22 +616,24 @@ void RVATableChunk::writeTo(uint8_t *Buf) const {
 //
 // Usually we have a lot of relocations for each page, so the number of
 // bytes for one .reloc entry is close to 2 bytes on average.
-BaserelChunk::BaserelChunk(uint32_t Page, Baserel *Begin, Baserel *End) {
-  // Block header consists of 4 byte page RVA and 4 byte block size.
-  // Each entry is 2 byte. Last entry may be padding.
-  Data.resize(alignTo((End - Begin) * 2 + 8, 4));
-  uint8_t *P = Data.data();
+// Block header consists of 4 byte page RVA and 4 byte block size.
+// Each entry is 2 byte. Last entry may be padding.
+size_t BaserelChunk::getSize() const {
+  return alignTo((End - Begin) * 2 + 8, 4);
+}
+
+void BaserelChunk::writeTo(uint8_t *Buf) const {
+  uint8_t *P = Buf + OutputSectionOff;
   write32le(P, Page);
-  write32le(P + 4, Data.size());
+  write32le(P + 4, getSize());
   P += 8;
-  for (Baserel *I = Begin; I != End; ++I) {
+  for (const Baserel *I = Begin; I != End; ++I) {
     write16le(P, (I->Type << 12) | (I->RVA - Page));
     P += 2;
   }
-}
-
-void BaserelChunk::writeTo(uint8_t *Buf) const {
-  memcpy(Buf + OutputSectionOff, Data.data(), Data.size());
+  // Zero the padding entry, if any.
+  if ((End - Begin) % 2)
+    write16le(P, 0);
 }
 
 uint8_t Baserel::getDefaultType() {
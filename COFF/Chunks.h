@@ -50,7 +50,7 @@ const uint32_t TypeMask = 0x000000E0;
 // doesn't even have actual data (if common or bss).
 class Chunk {
 public:
-  enum Kind { SectionKind, OtherKind };
+  enum Kind : uint8_t { SectionKind, OtherKind };
   Kind kind() const { return ChunkKind; }
   virtual ~Chunk() = default;
 
@@ -105,15 +105,17 @@ protected:
   Chunk(Kind K = OtherKind) : ChunkKind(K) {}
   const Kind ChunkKind;
 
-  // The RVA of this chunk in the output. The writer sets a value.
-  uint64_t RVA = 0;
-
-  // The output section for this chunk.
-  OutputSection *Out = nullptr;
+  // The RVA of this chunk in the output. The writer sets a value. RVAs are
+  // 32 bits wide in PE images.
+  uint32_t RVA = 0;
 
 public:
   // The offset from beginning of the output section. The writer sets a value.
-  uint64_t OutputSectionOff = 0;
+  uint32_t OutputSectionOff = 0;
+
+protected:
+  // The output section for this chunk.
+  OutputSection *Out = nullptr;
 };
 
 // A chunk corresponding a section of an input file.
@@ -145,7 +147,7 @@ public:
   void writeTo(uint8_t *Buf) const override;
   bool hasData() const override;
   uint32_t getOutputCharacteristics() const override;
-  StringRef getSectionName() const override { return SectionName; }
+  StringRef getSectionName() const override;
   void getBaserels(std::vector<Baserel> *Res) override;
   bool isCOMDAT() const;
   void applyRelX64(uint8_t *Off, uint16_t Type, OutputSection *OS, uint64_t S,
@@ -180,22 +182,58 @@ public:
   // True if this is a codeview debug info chunk. These will not be laid out in
   // the image. Instead they will end up in the PDB, if one is requested.
   bool isCodeView() const {
-    return SectionName == ".debug" || SectionName.startswith(".debug$");
+    StringRef Name = getSectionName();
+    return Name == ".debug" || Name.startswith(".debug$");
   }
 
   // True if this is a DWARF debug info or exception handling chunk.
   bool isDWARF() const {
-    return SectionName.startswith(".debug_") || SectionName == ".eh_frame";
+    StringRef Name = getSectionName();
+    return Name.startswith(".debug_") || Name == ".eh_frame";
+  }
+
+  // Returns the relocations of this section. The count is read from the
+  // section header, so only the start of the table is stored.
+  ArrayRef<coff_relocation> getRelocs() const {
+    if (!RelocsData)
+      return {};
+    if (Header->hasExtendedRelocations())
+      return {RelocsData, RelocsData[-1].VirtualAddress - 1};
+    return {RelocsData, Header->NumberOfRelocations};
   }
 
   // Allow iteration over the bodies of this chunk's relocated symbols.
   llvm::iterator_range<symbol_iterator> symbols() const {
+    ArrayRef<coff_relocation> Relocs = getRelocs();
     return llvm::make_range(symbol_iterator(File, Relocs.begin()),
                             symbol_iterator(File, Relocs.end()));
   }
 
+  // Iterates over the associative children of a section, which are kept
+  // in an intrusive singly linked list.
+  class assoc_iterator
+      : public llvm::iterator_facade_base<
+            assoc_iterator, std::forward_iterator_tag, SectionChunk *> {
+  public:
+    assoc_iterator() = default;
+    explicit assoc_iterator(SectionChunk *C) : Cur(C) {}
+
+    bool operator==(const assoc_iterator &R) const { return Cur == R.Cur; }
+    SectionChunk *&operator*() { return Cur; }
+    SectionChunk *const &operator*() const { return Cur; }
+    assoc_iterator &operator++() {
+      Cur = Cur->AssocNext;
+      return *this;
+    }
+
+  private:
+    SectionChunk *Cur = nullptr;
+  };
+
   // Allow iteration over the associated child chunks for this section.
-  ArrayRef<SectionChunk *> children() const { return AssocChildren; }
+  llvm::iterator_range<assoc_iterator> children() const {
+    return llvm::make_range(assoc_iterator(AssocChildren), assoc_iterator());
+  }
 
   // A pointer pointing to a replacement for this chunk.
   // Initially it points to "this" object. If this chunk is merged
@@ -203,10 +241,6 @@ public:
   // and this chunk is considrered as dead.
   SectionChunk *Repl;
 
-  // The CRC of the contents as described in the COFF spec 4.5.5.
-  // Auxiliary Format 5: Section Definitions. Used for ICF.
-  uint32_t Checksum = 0;
-
   const coff_section *Header;
 
   // The file that this chunk was created from.
@@ -215,18 +249,35 @@ public:
   // The COMDAT leader symbol if this is a COMDAT chunk.
   DefinedRegular *Sym = nullptr;
 
-  ArrayRef<coff_relocation> Relocs;
-
 private:
-  StringRef SectionName;
-  std::vector<SectionChunk *> AssocChildren;
+  // The first relocation of this section, or null if there are none.
+  // Use getRelocs() to access them.
+  const coff_relocation *RelocsData;
 
-  // Used by the garbage collector.
-  bool Live;
+  template <uint16_t Machine> void applyRelocations(uint8_t *Buf) const;
+
+  // The first associative child and the next sibling in the parent's list.
+  SectionChunk *AssocChildren = nullptr;
+  SectionChunk *AssocNext = nullptr;
+
+public:
+  // The CRC of the contents as described in the COFF spec 4.5.5.
+  // Auxiliary Format 5: Section Definitions. Used for ICF.
+  uint32_t Checksum = 0;
 
+private:
   // Used for ICF (Identical COMDAT Folding)
   void replace(SectionChunk *Other);
   uint32_t Class[2] = {0, 0};
+
+public:
+  // True if the address of this chunk may be compared by the program, so
+  // that /opt:safeicf must not fold it.
+  bool KeepUnique = false;
+
+private:
+  // Used by the garbage collector.
+  bool Live;
 };
 
 // This class is used to implement an lld-specific feature (not implemented in
@@ -396,12 +447,15 @@ private:
 // See the PE/COFF spec 5.6 for details.
 class BaserelChunk : public Chunk {
 public:
-  BaserelChunk(uint32_t Page, Baserel *Begin, Baserel *End);
-  size_t getSize() const override { return Data.size(); }
+  BaserelChunk(uint32_t Page, const Baserel *Begin, const Baserel *End)
+      : Page(Page), Begin(Begin), End(End) {}
+  size_t getSize() const override;
   void writeTo(uint8_t *Buf) const override;
 
 private:
-  std::vector<uint8_t> Data;
+  uint32_t Page;
+  const Baserel *Begin;
+  const Baserel *End;
 };
 
 class Baserel {
@@ -10,6 +10,7 @@
 #ifndef LLD_COFF_CONFIG_H
 #define LLD_COFF_CONFIG_H
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/COFF.h"
@@ -20,6 +21,8 @@
 #include <string>
 
 namespace lld {
+class LinkCache;
+
 namespace coff {
 
 using llvm::COFF::IMAGE_FILE_MACHINE_UNKNOWN;
@@ -27,6 +30,7 @@ using llvm::COFF::WindowsSubsystem;
 using llvm::StringRef;
 class DefinedAbsolute;
 class DefinedRelative;
+class SectionChunk;
 class StringChunk;
 class Symbol;
 
@@ -92,6 +96,7 @@ struct Configuration {
   std::string ImportName;
   bool DoGC = true;
   bool DoICF = true;
+  bool SafeICF = false;
   bool TailMerge;
   bool Relocatable = true;
   bool Force = false;
@@ -99,6 +104,7 @@ struct Configuration {
   bool DebugDwarf = false;
   bool DebugGHashes = false;
   bool ShowTiming = false;
+  bool PrintMemoryUsage = false;
   unsigned DebugTypes = static_cast<unsigned>(DebugType::None);
   std::vector<std::string> NatvisFiles;
   llvm::SmallString<128> PDBAltPath;
@@ -141,6 +147,12 @@ struct Configuration {
   // Used for /opt:lldltocachepolicy=policy
   llvm::CachePruningPolicy LTOCachePolicy;
 
+  // Used for /lldghashcache:path
+  StringRef GHashCache;
+
+  // Used for /lldlinkcache:path
+  LinkCache *OutputCache = nullptr;
+
   // Used for /merge:from=to (e.g. /merge:.rdata=.text)
   std::map<StringRef, StringRef> Merge;
 
@@ -169,8 +181,14 @@ struct Configuration {
   // Used for /order.
   llvm::StringMap<int> Order;
 
+  // Used for /call-graph-ordering-file and .llvm.call-graph-profile sections.
+  llvm::MapVector<std::pair<const SectionChunk *, const SectionChunk *>,
+                  uint64_t>
+      CallGraphProfile;
+
   // Used for /lldmap.
   std::string MapFile;
+  std::string TimeTraceFile;
 
   uint64_t ImageBase = -1;
   uint64_t StackReserve = 1024 * 1024;
@@ -194,6 +212,9 @@ struct Configuration {
   bool WarnMissingOrderSymbol = true;
   bool WarnLocallyDefinedImported = true;
   bool Incremental = true;
+  // True if /incremental was given explicitly, which keeps the layout of
+  // the image stable across relinks.
+  bool IncrementalLayout = false;
   bool IntegrityCheck = false;
   bool KillAt = false;
   bool Repro = false;
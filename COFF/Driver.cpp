@@ -19,10 +19,14 @@
 #include "lld/Common/Args.h"
 #include "lld/Common/Driver.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/LinkCache.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/TimeTrace.h"
 #include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/BinaryFormat/Magic.h"
 #include "llvm/Object/ArchiveWriter.h"
@@ -32,10 +36,10 @@
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
-#include "llvm/Support/TarWriter.h"
-#include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ToolDrivers/llvm-lib/LibDriver.h"
 #include <algorithm>
@@ -45,6 +49,7 @@
 using namespace llvm;
 using namespace llvm::object;
 using namespace llvm::COFF;
+using namespace llvm::support::endian;
 using llvm::sys::Process;
 
 namespace lld {
@@ -71,6 +76,12 @@ bool link(ArrayRef<const char *> Args, bool CanExitEarly, raw_ostream &Diag) {
   Driver = make<LinkerDriver>();
   Driver->link(Args);
 
+  // Write out the files queued for /linkrepro while the inputs are mapped.
+  finishTarWriters();
+
+  if (!Config->TimeTraceFile.empty())
+    writeTimeTrace(Config->TimeTraceFile);
+
   // Call exit() if we can to avoid calling destructors.
   if (CanExitEarly)
     exitLld(errorCount() ? 1 : 0);
@@ -99,8 +110,8 @@ typedef std::pair<std::unique_ptr<MemoryBuffer>, std::error_code> MBErrPair;
 static std::future<MBErrPair> createFutureForFile(std::string Path) {
 #if _WIN32
   // On Windows, file I/O is relatively slow so it is best to do this
-  // asynchronously.
-  auto Strategy = std::launch::async;
+  // asynchronously, unless /threads:no asked for a single-threaded link.
+  auto Strategy = ThreadsEnabled ? std::launch::async : std::launch::deferred;
 #else
   auto Strategy = std::launch::deferred;
 #endif
@@ -116,16 +127,31 @@ static std::future<MBErrPair> createFutureForFile(std::string Path) {
 
 MemoryBufferRef LinkerDriver::takeBuffer(std::unique_ptr<MemoryBuffer> MB) {
   MemoryBufferRef MBRef = *MB;
+  InputFileBytes += MBRef.getBufferSize();
   make<std::unique_ptr<MemoryBuffer>>(std::move(MB)); // take ownership
 
   if (Driver->Tar)
     Driver->Tar->append(relativeToRoot(MBRef.getBufferIdentifier()),
                         MBRef.getBuffer());
+  if (Config->OutputCache)
+    Config->OutputCache->addInput(MBRef.getBufferIdentifier(), MBRef);
   return MBRef;
 }
 
+// Returns an object file for MB that has already read its section table, or
+// null if MB is not a COFF object file. This does not touch the symbol table,
+// so it may be called from parallel regions.
+static ObjFile *preparseObjFile(MemoryBufferRef MB, StringRef ParentName) {
+  if (identify_magic(MB.getBuffer()) != file_magic::coff_object)
+    return nullptr;
+  ObjFile *Obj = makeConcurrent<ObjFile>(MB);
+  Obj->ParentName = ParentName;
+  Obj->preparse();
+  return Obj;
+}
+
 void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> MB,
-                             bool WholeArchive) {
+                             bool WholeArchive, ObjFile *Obj) {
   StringRef Filename = MB->getBufferIdentifier();
 
   MemoryBufferRef MBRef = takeBuffer(std::move(MB));
@@ -152,7 +178,7 @@ void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> MB,
     break;
   case file_magic::coff_object:
   case file_magic::coff_import_library:
-    Symtab->addFile(make<ObjFile>(MBRef));
+    Symtab->addFile(Obj ? Obj : make<ObjFile>(MBRef));
     break;
   case file_magic::coff_cl_gl_object:
     error(Filename + ": is not a native COFF file. Recompile without /GL");
@@ -170,21 +196,37 @@ void LinkerDriver::addBuffer(std::unique_ptr<MemoryBuffer> MB,
   }
 }
 
+namespace {
+// The state that the preparation step of an input file task passes on to
+// the task.
+struct PreparedFile {
+  MBErrPair MBOrErr;
+  ObjFile *Obj = nullptr;
+};
+} // namespace
+
 void LinkerDriver::enqueuePath(StringRef Path, bool WholeArchive) {
   auto Future =
       std::make_shared<std::future<MBErrPair>>(createFutureForFile(Path));
+  auto File = std::make_shared<PreparedFile>();
   std::string PathStr = Path;
-  enqueueTask([=]() {
-    auto MBOrErr = Future->get();
-    if (MBOrErr.second)
-      error("could not open " + PathStr + ": " + MBOrErr.second.message());
-    else
-      Driver->addBuffer(std::move(MBOrErr.first), WholeArchive);
-  });
+  enqueueTask(
+      [=]() {
+        MBErrPair &MBOrErr = File->MBOrErr;
+        if (MBOrErr.second)
+          error("could not open " + PathStr + ": " + MBOrErr.second.message());
+        else
+          Driver->addBuffer(std::move(MBOrErr.first), WholeArchive, File->Obj);
+      },
+      [=]() {
+        File->MBOrErr = Future->get();
+        if (File->MBOrErr.first)
+          File->Obj = preparseObjFile(*File->MBOrErr.first, "");
+      });
 }
 
 void LinkerDriver::addArchiveBuffer(MemoryBufferRef MB, StringRef SymName,
-                                    StringRef ParentName) {
+                                    StringRef ParentName, ObjFile *Preparsed) {
   file_magic Magic = identify_magic(MB.getBuffer());
   if (Magic == file_magic::coff_import_library) {
     Symtab->addFile(make<ImportFile>(MB));
@@ -193,7 +235,7 @@ void LinkerDriver::addArchiveBuffer(MemoryBufferRef MB, StringRef SymName,
 
   InputFile *Obj;
   if (Magic == file_magic::coff_object) {
-    Obj = make<ObjFile>(MB);
+    Obj = Preparsed ? Preparsed : make<ObjFile>(MB);
   } else if (Magic == file_magic::bitcode) {
     Obj = make<BitcodeFile>(MB);
   } else {
@@ -213,7 +255,10 @@ void LinkerDriver::enqueueArchiveMember(const Archive::Child &C,
     MemoryBufferRef MB = CHECK(
         C.getMemoryBufferRef(),
         "could not get the buffer for the member defining symbol " + SymName);
-    enqueueTask([=]() { Driver->addArchiveBuffer(MB, SymName, ParentName); });
+    auto Obj = std::make_shared<ObjFile *>(nullptr);
+    enqueueTask(
+        [=]() { Driver->addArchiveBuffer(MB, SymName, ParentName, *Obj); },
+        [=]() { *Obj = preparseObjFile(MB, ParentName); });
     return;
   }
 
@@ -549,6 +594,26 @@ static std::string getImportName(bool AsLib) {
   return Out.str();
 }
 
+// Returns the files a link may write, which are what /lldlinkcache stores.
+static std::vector<std::string>
+getLinkCacheOutputs(const opt::InputArgList &Args) {
+  std::vector<std::string> V = {Config->OutputFile};
+  if (!Config->PDBPath.empty())
+    V.push_back(Config->PDBPath.str());
+  if (!Config->MapFile.empty())
+    V.push_back(Config->MapFile);
+  // Whether there is an import library is only known once all symbols have
+  // been resolved, so it is always a candidate.
+  V.push_back(getImplibPath());
+  if (Config->Manifest == Configuration::SideBySide)
+    V.push_back(Config->ManifestFile.empty()
+                    ? Config->OutputFile + ".manifest"
+                    : Config->ManifestFile.str());
+  if (auto *Arg = Args.getLastArg(OPT_output_def))
+    V.push_back(Arg->getValue());
+  return V;
+}
+
 static void createImportLibrary(bool AsLib) {
   std::vector<COFFShortExport> Exports;
   for (Export &E1 : Config->Exports) {
@@ -785,15 +850,26 @@ void LinkerDriver::invokeMSVC(opt::InputArgList &Args) {
     sys::fs::remove(Path);
 }
 
-void LinkerDriver::enqueueTask(std::function<void()> Task) {
+void LinkerDriver::enqueueTask(std::function<void()> Task,
+                               std::function<void()> Prepare) {
   TaskQueue.push_back(std::move(Task));
+  if (Prepare)
+    PrepareQueue.push_back(std::move(Prepare));
 }
 
+// Runs the queued tasks in order. Input files are read and their section
+// tables parsed in parallel, in batches of whatever has been queued, while
+// the symbol table is only ever updated by the tasks, in command line order.
 bool LinkerDriver::run() {
   ScopedTimer T(InputFileTimer);
 
   bool DidWork = !TaskQueue.empty();
   while (!TaskQueue.empty()) {
+    if (!PrepareQueue.empty()) {
+      std::vector<std::function<void()>> Batch = std::move(PrepareQueue);
+      PrepareQueue.clear();
+      parallelForEach(Batch, [](std::function<void()> &Fn) { Fn(); });
+    }
     TaskQueue.front()();
     TaskQueue.pop_front();
   }
@@ -840,6 +916,132 @@ static void parseOrderFile(StringRef Arg) {
   }
 }
 
+static void markAddrsig(Symbol *S) {
+  if (auto *D = dyn_cast_or_null<Defined>(S))
+    if (auto *SC = dyn_cast_or_null<SectionChunk>(D->getChunk()))
+      SC->KeepUnique = true;
+}
+
+// Marks the chunks whose addresses are significant, so that /opt:safeicf
+// does not fold them.
+static void findKeepUniqueSections() {
+  // Exported symbols could be address-significant in other executables or
+  // DLLs, so we conservatively mark them as address-significant.
+  for (Export &E : Config->Exports)
+    markAddrsig(E.Sym);
+
+  // Visit the address-significance table in each object file and mark each
+  // referenced symbol as address-significant.
+  for (ObjFile *Obj : ObjFile::Instances) {
+    ArrayRef<Symbol *> Syms = Obj->getSymbols();
+    if (!Obj->AddrsigSec) {
+      // If an object file does not have an address-significance table,
+      // conservatively mark all of its symbols as address-significant.
+      for (Symbol *S : Syms)
+        markAddrsig(S);
+      continue;
+    }
+
+    ArrayRef<uint8_t> Contents;
+    Obj->getCOFFObj()->getSectionContents(Obj->AddrsigSec, Contents);
+    const uint8_t *Cur = Contents.begin();
+    while (Cur != Contents.end()) {
+      unsigned Size;
+      const char *Err;
+      uint64_t SymIndex = decodeULEB128(Cur, &Size, Contents.end(), &Err);
+      if (Err)
+        fatal(toString(Obj) + ": could not decode addrsig section: " + Err);
+      if (SymIndex >= Syms.size())
+        fatal(toString(Obj) + ": invalid symbol index in addrsig section");
+      markAddrsig(Syms[SymIndex]);
+      Cur += Size;
+    }
+  }
+}
+
+// Returns the section that defines S for a call graph profile, or null if
+// it is not defined in a section that can be reordered.
+static SectionChunk *getCallGraphSection(Symbol *S) {
+  auto *D = dyn_cast_or_null<DefinedRegular>(S);
+  if (!D)
+    return nullptr;
+  SectionChunk *SC = D->getChunk();
+  if (!SC || !SC->isLive())
+    return nullptr;
+  return SC->Repl;
+}
+
+// Reads a /call-graph-ordering-file. Each line gives the name of a caller,
+// the name of a callee and the number of calls between them, separated by
+// spaces.
+static void readCallGraph(StringRef Path) {
+  std::unique_ptr<MemoryBuffer> MB = CHECK(
+      MemoryBuffer::getFile(Path, -1, false, true), "could not open " + Path);
+
+  // Build a map from symbol name to symbol, including the local symbols
+  // of each object file.
+  DenseMap<StringRef, Symbol *> Map;
+  for (ObjFile *File : ObjFile::Instances)
+    for (Symbol *Sym : File->getSymbols())
+      if (Sym)
+        Map[Sym->getName()] = Sym;
+
+  auto FindSection = [&](StringRef Name) -> SectionChunk * {
+    Symbol *Sym = Map.lookup(Name);
+    if (!Sym) {
+      if (Config->WarnMissingOrderSymbol)
+        warn(Path + ": no such symbol: " + Name);
+      return nullptr;
+    }
+    return getCallGraphSection(Sym);
+  };
+
+  for (StringRef Line : args::getLines(MB->getMemBufferRef())) {
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, ' ');
+    uint64_t Count;
+    if (Fields.size() != 3 || !to_integer(Fields[2], Count)) {
+      error(Path + ": parse error");
+      return;
+    }
+
+    SectionChunk *From = FindSection(Fields[0]);
+    SectionChunk *To = FindSection(Fields[1]);
+    if (From && To && Count)
+      Config->CallGraphProfile[{From, To}] += Count;
+  }
+}
+
+// Reads the .llvm.call-graph-profile sections that the compiler emits for
+// -fprofile-use. Each entry holds the symbol table indices of a caller and
+// a callee as 32-bit words, followed by a 64-bit call count.
+static void readCallGraphsFromObjectFiles() {
+  for (ObjFile *Obj : ObjFile::Instances) {
+    if (!Obj->CallgraphSec)
+      continue;
+
+    ArrayRef<uint8_t> Contents;
+    Obj->getCOFFObj()->getSectionContents(Obj->CallgraphSec, Contents);
+    if (Contents.size() % 16 != 0)
+      fatal(toString(Obj) + ": invalid .llvm.call-graph-profile section");
+
+    ArrayRef<Symbol *> Syms = Obj->getSymbols();
+    for (size_t I = 0, E = Contents.size(); I != E; I += 16) {
+      uint32_t FromIndex = read32le(Contents.data() + I);
+      uint32_t ToIndex = read32le(Contents.data() + I + 4);
+      uint64_t Count = read64le(Contents.data() + I + 8);
+      if (FromIndex >= Syms.size() || ToIndex >= Syms.size())
+        fatal(toString(Obj) +
+              ": invalid symbol index in .llvm.call-graph-profile section");
+
+      SectionChunk *From = getCallGraphSection(Syms[FromIndex]);
+      SectionChunk *To = getCallGraphSection(Syms[ToIndex]);
+      if (From && To && Count)
+        Config->CallGraphProfile[{From, To}] += Count;
+    }
+  }
+}
+
 void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   // If the first command line argument is "/lib", link.exe acts like lib.exe.
   // We call our own implementation of lib.exe that understands bitcode files.
@@ -849,13 +1051,6 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
     return;
   }
 
-  // Needed for LTO.
-  InitializeAllTargetInfos();
-  InitializeAllTargets();
-  InitializeAllTargetMCs();
-  InitializeAllAsmParsers();
-  InitializeAllAsmPrinters();
-
   // Parse command line options.
   ArgParser Parser;
   opt::InputArgList Args = Parser.parseLINK(ArgsArr.slice(1));
@@ -885,6 +1080,34 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   if (Args.hasArg(OPT_show_timing))
     Config->ShowTiming = true;
 
+  // Handle --time-counters, which is an lld extension. The counters are
+  // opened before the root timer starts so that they cover the whole link.
+  if (Args.hasArg(OPT_time_counters)) {
+    Config->ShowTiming = true;
+    Timer::enableCounters();
+  }
+
+  // Handle --print-memory-usage, which is an lld extension.
+  Config->PrintMemoryUsage = Args.hasArg(OPT_print_memory_usage);
+
+  // Handle --time-trace, which is an lld extension. Start it before the
+  // root timer so that the trace covers the whole link.
+  Config->TimeTraceFile = Args.getLastArgValue(OPT_time_trace_eq);
+  if (!Config->TimeTraceFile.empty())
+    startTimeTrace();
+
+  // Handle /threads:N and /threads:no, which are lld extensions.
+  ThreadsEnabled = true;
+  ThreadCount = 0;
+  if (auto *Arg = Args.getLastArg(OPT_threads)) {
+    StringRef S = Arg->getValue();
+    if (S == "no")
+      ThreadsEnabled = false;
+    else if (!to_integer(S, ThreadCount, 10) || ThreadCount == 0)
+      error(Arg->getSpelling() + " positive number or 'no' expected, but got " +
+            S);
+  }
+
   ScopedTimer T(Timer::root());
   // Handle --version, which is an lld extension. This option is a bit odd
   // because it doesn't start with "/", but we deliberately chose "--" to
@@ -902,8 +1125,8 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
     SmallString<64> Path = StringRef(Arg->getValue());
     sys::path::append(Path, "repro.tar");
 
-    Expected<std::unique_ptr<TarWriter>> ErrOrWriter =
-        TarWriter::create(Path, "repro");
+    Expected<std::unique_ptr<AsyncTarWriter>> ErrOrWriter =
+        AsyncTarWriter::create(Path, "repro");
 
     if (ErrOrWriter) {
       Tar = std::move(*ErrOrWriter);
@@ -1092,6 +1315,10 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
         DoGC = false;
       } else if (S == "icf" || S.startswith("icf=")) {
         ICFLevel = 2;
+        Config->SafeICF = false;
+      } else if (S == "safeicf") {
+        ICFLevel = 2;
+        Config->SafeICF = true;
       } else if (S == "noicf") {
         ICFLevel = 0;
       } else if (S == "lldtailmerge") {
@@ -1140,12 +1367,27 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   if (auto *Arg = Args.getLastArg(OPT_lldltocache))
     Config->LTOCache = Arg->getValue();
 
+  // Handle /lldghashcache
+  if (auto *Arg = Args.getLastArg(OPT_lldghashcache))
+    Config->GHashCache = Arg->getValue();
+
   // Handle /lldsavecachepolicy
   if (auto *Arg = Args.getLastArg(OPT_lldltocachepolicy))
     Config->LTOCachePolicy = CHECK(
         parseCachePruningPolicy(Arg->getValue()),
         Twine("/lldltocachepolicy: invalid cache policy: ") + Arg->getValue());
 
+  // Handle /lldlinkcache. Inputs are recorded as they are read, so this has
+  // to be done before any input is opened.
+  if (auto *Arg = Args.getLastArg(OPT_lldlinkcache)) {
+    CachePruningPolicy Policy;
+    if (auto *P = Args.getLastArg(OPT_lldlinkcachepolicy))
+      Policy = CHECK(parseCachePruningPolicy(P->getValue()),
+                     Twine("/lldlinkcachepolicy: invalid cache policy: ") +
+                         P->getValue());
+    Config->OutputCache = make<LinkCache>(Arg->getValue(), Policy, Args);
+  }
+
   // Handle /failifmismatch
   for (auto *Arg : Args.filtered(OPT_failifmismatch))
     checkFailIfMismatch(Arg->getValue());
@@ -1209,6 +1451,7 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   Config->Incremental =
       Args.hasFlag(OPT_incremental, OPT_incremental_no,
                    !Config->DoGC && !Config->DoICF && !Args.hasArg(OPT_order) &&
+                       !Args.hasArg(OPT_call_graph_ordering_file) &&
                        !Args.hasArg(OPT_profile));
   Config->IntegrityCheck =
       Args.hasFlag(OPT_integritycheck, OPT_integritycheck_no, false);
@@ -1230,6 +1473,12 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
     Config->Incremental = false;
   }
 
+  if (Config->Incremental && Args.hasArg(OPT_call_graph_ordering_file)) {
+    warn("ignoring '/incremental' due to '/call-graph-ordering-file' "
+         "specification");
+    Config->Incremental = false;
+  }
+
   if (Config->Incremental && Config->DoGC) {
     warn("ignoring '/incremental' because REF is enabled; use '/opt:noref' to "
          "disable");
@@ -1242,6 +1491,11 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
     Config->Incremental = false;
   }
 
+  // link.exe links incrementally by default, but lld only reserves room in
+  // the image when asked to, so that default links stay compact.
+  Config->IncrementalLayout =
+      Config->Incremental && Args.hasArg(OPT_incremental);
+
   if (errorCount())
     return;
 
@@ -1295,8 +1549,8 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
 
   if (Tar)
     Tar->append("response.txt",
-                createResponseFile(Args, FilePaths,
-                                   ArrayRef<StringRef>(SearchPaths).slice(1)));
+                Saver.save(createResponseFile(
+                    Args, FilePaths, ArrayRef<StringRef>(SearchPaths).slice(1))));
 
   // Handle /largeaddressaware
   Config->LargeAddressAware = Args.hasFlag(
@@ -1443,6 +1697,8 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
       addUndefined(mangle("_load_config_used"));
   } while (run());
 
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("reading input files");
   if (errorCount())
     return;
 
@@ -1453,10 +1709,18 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
     return;
   }
 
+  // All inputs have been read now. Reuse the result of an identical earlier
+  // link if there is one.
+  std::vector<std::string> CacheOutputs = getLinkCacheOutputs(Args);
+  if (Config->OutputCache && Config->OutputCache->fetch(CacheOutputs))
+    return;
+
   // Do LTO by compiling bitcode input files to a set of native COFF files then
   // link those files.
   Symtab->addCombinedLTOObjects();
   run();
+  if (Config->PrintMemoryUsage && !BitcodeFile::Instances.empty())
+    printMemoryUsage("LTO");
 
   // Make sure we have resolved all symbols.
   Symtab->reportRemainingUndefines();
@@ -1548,11 +1812,36 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
     markLive(Symtab->getChunks());
 
   // Identify identical COMDAT sections to merge them.
-  if (Config->DoICF)
+  if (Config->DoICF) {
+    if (Config->SafeICF)
+      findKeepUniqueSections();
     doICF(Symtab->getChunks());
+  }
+
+  // Read a call graph profile. This is done after ICF so that the weights of
+  // folded sections add up. Both that and /order set the order of sections,
+  // so a profile is only used if there is no /order.
+  if (auto *Arg = Args.getLastArg(OPT_call_graph_ordering_file)) {
+    if (Args.hasArg(OPT_order))
+      error("/order and /call-graph-ordering-file may not be used together");
+    else
+      readCallGraph(Arg->getValue());
+  } else if (!Args.hasArg(OPT_order) &&
+             Args.hasFlag(OPT_call_graph_profile_sort,
+                          OPT_call_graph_profile_sort_no, true)) {
+    readCallGraphsFromObjectFiles();
+  }
+
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("section optimizations");
 
   // Write the result.
   writeResult();
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("writing the output");
+
+  if (Config->OutputCache && !errorCount())
+    Config->OutputCache->store(CacheOutputs);
 
   // Stop early so we can print the results.
   Timer::root().stop();
@@ -22,7 +22,6 @@
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
-#include "llvm/Support/TarWriter.h"
 #include <memory>
 #include <set>
 #include <vector>
@@ -79,7 +78,7 @@ public:
   MemoryBufferRef takeBuffer(std::unique_ptr<MemoryBuffer> MB);
 
 private:
-  std::unique_ptr<llvm::TarWriter> Tar; // for /linkrepro
+  std::unique_ptr<AsyncTarWriter> Tar; // for /linkrepro
 
   // Opens a file. Path has to be resolved already.
   MemoryBufferRef openFile(StringRef Path);
@@ -117,16 +116,23 @@ private:
 
   void invokeMSVC(llvm::opt::InputArgList &Args);
 
-  void addBuffer(std::unique_ptr<MemoryBuffer> MB, bool WholeArchive);
+  void addBuffer(std::unique_ptr<MemoryBuffer> MB, bool WholeArchive,
+                 ObjFile *Obj = nullptr);
   void addArchiveBuffer(MemoryBufferRef MBRef, StringRef SymName,
-                        StringRef ParentName);
+                        StringRef ParentName, ObjFile *Obj = nullptr);
 
   void enqueuePath(StringRef Path, bool WholeArchive);
 
-  void enqueueTask(std::function<void()> Task);
+  // Queues Task, which adds an input file to the link. Prepare, if given,
+  // reads and parses the file as far as that can be done without the symbol
+  // table. The preparation steps of all queued tasks run in parallel before
+  // the next task runs.
+  void enqueueTask(std::function<void()> Task,
+                   std::function<void()> Prepare = nullptr);
   bool run();
 
   std::list<std::function<void()>> TaskQueue;
+  std::vector<std::function<void()>> PrepareQueue;
   std::vector<StringRef> FilePaths;
   std::vector<MemoryBufferRef> Resources;
 
@@ -22,10 +22,10 @@
 #include "Chunks.h"
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/Support/Debug.h"
-#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <atomic>
@@ -67,8 +67,8 @@ private:
 
 // Returns a hash value for S.
 uint32_t ICF::getHash(SectionChunk *C) {
-  return hash_combine(C->getOutputCharacteristics(), C->SectionName,
-                      C->Relocs.size(), uint32_t(C->Header->SizeOfRawData),
+  return hash_combine(C->getOutputCharacteristics(), C->getSectionName(),
+                      C->getRelocs().size(), uint32_t(C->Header->SizeOfRawData),
                       C->Checksum, C->getContents());
 }
 
@@ -83,12 +83,19 @@ uint32_t ICF::getHash(SectionChunk *C) {
 // merge read-only sections in a couple of cases where the address of the
 // section is insignificant to the user program and the behaviour matches that
 // of the Visual C++ linker.
+//
+// With /opt:safeicf, the address-significance tables of the object files tell
+// which chunks may have their addresses compared. Only those are kept
+// unique, and all other read-only COMDAT chunks, data included, are folded.
 bool ICF::isEligible(SectionChunk *C) {
   // Non-comdat chunks, dead chunks, and writable chunks are not elegible.
   bool Writable = C->getOutputCharacteristics() & llvm::COFF::IMAGE_SCN_MEM_WRITE;
   if (!C->isCOMDAT() || !C->isLive() || Writable)
     return false;
 
+  if (Config->SafeICF)
+    return !C->KeepUnique;
+
   // Code sections are eligible.
   if (C->getOutputCharacteristics() & llvm::COFF::IMAGE_SCN_MEM_EXECUTE)
     return true;
@@ -132,10 +139,12 @@ void ICF::segregate(size_t Begin, size_t End, bool Constant) {
 bool ICF::assocEquals(const SectionChunk *A, const SectionChunk *B) {
   auto ChildClasses = [&](const SectionChunk *SC) {
     std::vector<uint32_t> Classes;
-    for (const SectionChunk *C : SC->children())
-      if (!C->SectionName.startswith(".debug") &&
-          C->SectionName != ".gfids$y" && C->SectionName != ".gljmp$y")
+    for (const SectionChunk *C : SC->children()) {
+      StringRef Name = C->getSectionName();
+      if (!Name.startswith(".debug") && Name != ".gfids$y" &&
+          Name != ".gljmp$y")
         Classes.push_back(C->Class[Cnt % 2]);
+    }
     return Classes;
   };
   return ChildClasses(A) == ChildClasses(B);
@@ -144,7 +153,9 @@ bool ICF::assocEquals(const SectionChunk *A, const SectionChunk *B) {
 // Compare "non-moving" part of two sections, namely everything
 // except relocation targets.
 bool ICF::equalsConstant(const SectionChunk *A, const SectionChunk *B) {
-  if (A->Relocs.size() != B->Relocs.size())
+  ArrayRef<coff_relocation> RelsA = A->getRelocs();
+  ArrayRef<coff_relocation> RelsB = B->getRelocs();
+  if (RelsA.size() != RelsB.size())
     return false;
 
   // Compare relocations.
@@ -163,12 +174,12 @@ bool ICF::equalsConstant(const SectionChunk *A, const SectionChunk *B) {
                D1->getChunk()->Class[Cnt % 2] == D2->getChunk()->Class[Cnt % 2];
     return false;
   };
-  if (!std::equal(A->Relocs.begin(), A->Relocs.end(), B->Relocs.begin(), Eq))
+  if (!std::equal(RelsA.begin(), RelsA.end(), RelsB.begin(), Eq))
     return false;
 
   // Compare section attributes and contents.
   return A->getOutputCharacteristics() == B->getOutputCharacteristics() &&
-         A->SectionName == B->SectionName &&
+         A->getSectionName() == B->getSectionName() &&
          A->Header->SizeOfRawData == B->Header->SizeOfRawData &&
          A->Checksum == B->Checksum && A->getContents() == B->getContents() &&
          assocEquals(A, B);
@@ -187,8 +198,8 @@ bool ICF::equalsVariable(const SectionChunk *A, const SectionChunk *B) {
         return D1->getChunk()->Class[Cnt % 2] == D2->getChunk()->Class[Cnt % 2];
     return false;
   };
-  return std::equal(A->Relocs.begin(), A->Relocs.end(), B->Relocs.begin(),
-                    Eq) &&
+  ArrayRef<coff_relocation> RelsA = A->getRelocs();
+  return std::equal(RelsA.begin(), RelsA.end(), B->getRelocs().begin(), Eq) &&
          assocEquals(A, B);
 }
 
@@ -228,10 +239,10 @@ void ICF::forEachClass(std::function<void(size_t, size_t)> Fn) {
   size_t Boundaries[NumShards + 1];
   Boundaries[0] = 0;
   Boundaries[NumShards] = Chunks.size();
-  for_each_n(parallel::par, size_t(1), NumShards, [&](size_t I) {
+  parallelForEachN(1, NumShards, [&](size_t I) {
     Boundaries[I] = findBoundary((I - 1) * Step, Chunks.size());
   });
-  for_each_n(parallel::par, size_t(1), NumShards + 1, [&](size_t I) {
+  parallelForEachN(1, NumShards + 1, [&](size_t I) {
     if (Boundaries[I - 1] < Boundaries[I]) {
       forEachClassRange(Boundaries[I - 1], Boundaries[I], Fn);
     }
@@ -263,7 +274,7 @@ void ICF::run(ArrayRef<Chunk *> Vec) {
       SC->Class[0] = NextId++;
 
   // Initially, we use hash values to partition sections.
-  for_each(parallel::par, Chunks.begin(), Chunks.end(), [&](SectionChunk *SC) {
+  parallelForEach(Chunks, [&](SectionChunk *SC) {
     // Set MSB to 1 to avoid collisions with non-hash classs.
     SC->Class[0] = getHash(SC) | (1 << 31);
   });
@@ -288,6 +299,8 @@ void ICF::run(ArrayRef<Chunk *> Vec) {
   log("ICF needed " + Twine(Cnt) + " iterations");
 
   // Merge sections in the same classs.
+  std::atomic<size_t> NumFolded = {0};
+  std::atomic<uint64_t> FoldedBytes = {0};
   forEachClass([&](size_t Begin, size_t End) {
     if (End - Begin == 1)
       return;
@@ -295,9 +308,13 @@ void ICF::run(ArrayRef<Chunk *> Vec) {
     log("Selected " + Chunks[Begin]->getDebugName());
     for (size_t I = Begin + 1; I < End; ++I) {
       log("  Removed " + Chunks[I]->getDebugName());
+      ++NumFolded;
+      FoldedBytes += Chunks[I]->getSize();
       Chunks[Begin]->replace(Chunks[I]);
     }
   });
+  log("ICF folded " + Twine(NumFolded.load()) + " sections (" +
+      Twine(FoldedBytes.load()) + " bytes)");
 }
 
 // Entry point to ICF.
@@ -0,0 +1,232 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An explicit /incremental keeps the layout of the image stable from one link
+// to the next, so that a relink after a small change rewrites only a small
+// part of a large image.
+//
+// The first link leaves free space after each section chunk of an object
+// file and records, in <output>.ilk, how many bytes it reserved for each of
+// them. This is not the format link.exe uses for its .ilk files. A later
+// link reserves the same number of bytes for each chunk again. If the same
+// chunks are linked and each of them still fits in its slot, every chunk
+// that did not change keeps its RVA and file offset, and the output file is
+// updated in place by writing only the pages that changed.
+//
+// If a chunk outgrew its slot, chunks were added or removed, or the set of
+// defined symbols changed, the image is laid out from scratch with new
+// slots. A new symbol may add import thunks or table entries and so move
+// every section after them, which is why the symbol set is compared at all.
+//
+// Every input file is still read and every relocation applied. The state
+// only decides where chunks go, so the output of an incremental link is
+// always a complete and correct link of its inputs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Chunks.h"
+#include "Config.h"
+#include "InputFiles.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+
+using namespace lld;
+using namespace lld::coff;
+
+static const char StateMagic[] = "lld-link-incremental 1";
+
+// The number of bytes reserved for each chunk in this link.
+static DenseMap<const Chunk *, uint64_t> Slots;
+static uint64_t SymbolHash;
+
+static std::string getStatePath() {
+  SmallString<128> Path(Config->OutputFile);
+  sys::path::replace_extension(Path, ".ilk");
+  return Path.str();
+}
+
+// A quarter of the chunk size is left free, so that a function can grow by
+// a few instructions before the layout has to change.
+static uint64_t getPadding(uint64_t Size) {
+  if (Size == 0)
+    return 0;
+  return std::max<uint64_t>(alignTo(Size / 4, 16), 16);
+}
+
+// The sum of the hashes of the names of all defined symbols. It does not
+// depend on the order in which the symbols were added.
+static uint64_t hashSymbolSet() {
+  uint64_t Hash = 0;
+  Symtab->forEachSymbol([&](Symbol *Sym) {
+    if (isa<Defined>(Sym))
+      Hash += xxHash64(Sym->getName());
+  });
+  return Hash;
+}
+
+// Unlike toString(), this keeps the full path of archives, so that members
+// of different archives with the same name are told apart.
+static std::string getFileKey(const ObjFile *F) {
+  if (F->ParentName.empty())
+    return F->getName().str();
+  return (F->ParentName + "(" + F->getName() + ")").str();
+}
+
+// Calls Callback for each section chunk of an object file that is placed in
+// the image, with the name of its file and its index in that file.
+template <class Fn> static void forEachPlacedChunk(Fn Callback) {
+  for (ObjFile *F : ObjFile::Instances) {
+    std::string FileName = getFileKey(F);
+    ArrayRef<Chunk *> Chunks = F->getChunks();
+    for (size_t I = 0, E = Chunks.size(); I != E; ++I) {
+      auto *SC = dyn_cast<SectionChunk>(Chunks[I]);
+      if (SC && SC->getOutputSection())
+        Callback(FileName, I, SC);
+    }
+  }
+}
+
+namespace {
+struct State {
+  uint64_t SymbolHash = 0;
+  size_t NumChunks = 0;
+  StringMap<DenseMap<uint32_t, uint64_t>> Slots;
+};
+} // namespace
+
+// Parses a state file. The format is line based:
+//
+//   lld-link-incremental 1
+//   symbols <hash of the symbol set>
+//   file <name>
+//   <chunk index> <slot size>
+//   ...
+static bool readState(StringRef Data, State &S) {
+  SmallVector<StringRef, 0> Lines;
+  Data.split(Lines, '\n', -1, /*KeepEmpty=*/false);
+  if (Lines.size() < 2 || Lines[0] != StateMagic ||
+      !Lines[1].consume_front("symbols ") ||
+      Lines[1].getAsInteger(16, S.SymbolHash))
+    return false;
+
+  DenseMap<uint32_t, uint64_t> *Cur = nullptr;
+  for (StringRef Line : makeArrayRef(Lines).slice(2)) {
+    if (Line.consume_front("file ")) {
+      Cur = &S.Slots[Line];
+      continue;
+    }
+    StringRef Index, Slot;
+    std::tie(Index, Slot) = Line.split(' ');
+    uint32_t I;
+    uint64_t Size;
+    if (!Cur || Index.getAsInteger(10, I) || Slot.getAsInteger(10, Size))
+      return false;
+    (*Cur)[I] = Size;
+    ++S.NumChunks;
+  }
+  return true;
+}
+
+static std::string describe(StringRef FileName, const SectionChunk *SC) {
+  return (FileName + ":(" + SC->getSectionName() + ")").str();
+}
+
+// Returns an empty string if the previous layout can be reused, or the reason
+// why it cannot.
+static std::string reuseState(const State &Old) {
+  if (Old.SymbolHash != SymbolHash)
+    return "the set of symbols changed";
+
+  size_t NumChunks = 0;
+  std::string Reason;
+  forEachPlacedChunk([&](StringRef FileName, uint32_t I, SectionChunk *SC) {
+    ++NumChunks;
+    if (!Reason.empty())
+      return;
+    auto FileIt = Old.Slots.find(FileName);
+    if (FileIt == Old.Slots.end()) {
+      Reason = FileName.str() + " was not linked before";
+      return;
+    }
+    auto It = FileIt->second.find(I);
+    if (It == FileIt->second.end())
+      Reason = describe(FileName, SC) + " was not linked before";
+    else if (SC->getSize() > It->second)
+      Reason = describe(FileName, SC) + " grew past its reserved space";
+    else
+      Slots[SC] = It->second;
+  });
+  if (Reason.empty() && NumChunks != Old.NumChunks)
+    Reason = "section chunks were removed";
+  return Reason;
+}
+
+void coff::prepareIncrementalLayout() {
+  Slots.clear();
+  SymbolHash = hashSymbolSet();
+
+  std::string Path = getStatePath();
+  std::string Reason;
+  State Old;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getFile(Path);
+  if (!MBOrErr)
+    Reason = "there is no previous state";
+  else if (!readState((*MBOrErr)->getBuffer(), Old))
+    Reason = Path + " is not a valid state file";
+  else
+    Reason = reuseState(Old);
+
+  if (Reason.empty()) {
+    log("/incremental: reusing the layout of the previous link");
+    return;
+  }
+
+  log("/incremental: laying out from scratch because " + Reason);
+  Slots.clear();
+  forEachPlacedChunk([&](StringRef, uint32_t, SectionChunk *SC) {
+    Slots[SC] = SC->getSize() + getPadding(SC->getSize());
+  });
+}
+
+uint64_t coff::getIncrementalSlotSize(const Chunk *C) {
+  auto It = Slots.find(C);
+  return It == Slots.end() ? C->getSize() : It->second;
+}
+
+void coff::writeIncrementalState() {
+  std::string Path = getStatePath();
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Path + ": " + EC.message());
+    return;
+  }
+
+  OS << StateMagic << "\nsymbols " << utohexstr(SymbolHash) << "\n";
+  const ObjFile *LastFile = nullptr;
+  forEachPlacedChunk([&](StringRef FileName, uint32_t I, SectionChunk *SC) {
+    if (SC->File != LastFile) {
+      LastFile = SC->File;
+      OS << "file " << FileName << "\n";
+    }
+    OS << I << " " << getIncrementalSlotSize(SC) << "\n";
+  });
+}
@@ -0,0 +1,34 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COFF_INCREMENTAL_H
+#define LLD_COFF_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+#include <cstdint>
+
+namespace lld {
+namespace coff {
+
+class Chunk;
+
+// Reads the layout of the previous /incremental link and decides whether
+// this link can reuse it. Must be called once output sections are known.
+void prepareIncrementalLayout();
+
+// Returns the number of bytes to reserve for C, which is at least its size.
+uint64_t getIncrementalSlotSize(const Chunk *C);
+
+// Records the layout of this link for the next one.
+void writeIncrementalState();
+
+} // namespace coff
+} // namespace lld
+
+#endif
@@ -15,6 +15,7 @@
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/TargetOptionsCommandFlags.h"
 #include "llvm-c/lto.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Triple.h"
@@ -102,7 +103,7 @@ std::vector<MemoryBufferRef> getArchiveMembers(Archive *File) {
   return V;
 }
 
-void ObjFile::parse() {
+void ObjFile::preparse() {
   // Parse a memory buffer as a COFF file.
   std::unique_ptr<Binary> Bin = CHECK(createBinary(MB), this);
 
@@ -113,8 +114,15 @@ void ObjFile::parse() {
     fatal(toString(this) + " is not a COFF file");
   }
 
-  // Read section and symbol tables.
+  // Read the section table.
   initializeChunks();
+}
+
+void ObjFile::parse() {
+  if (!COFFObj)
+    preparse();
+
+  // Read the symbol table.
   initializeSymbols();
 }
 
@@ -174,9 +182,20 @@ SectionChunk *ObjFile::readSection(uint32_t SectionNumber,
   if (!Config->Debug && Name.startswith(".debug_"))
     return nullptr;
 
+  if (Name == ".llvm_addrsig") {
+    AddrsigSec = Sec;
+    return nullptr;
+  }
+
+  if (Name == ".llvm.call-graph-profile") {
+    CallgraphSec = Sec;
+    return nullptr;
+  }
+
   if (Sec->Characteristics & llvm::COFF::IMAGE_SCN_LNK_REMOVE)
     return nullptr;
-  auto *C = make<SectionChunk>(this, Sec);
+  // Sections are read both by preparse() and parse().
+  auto *C = makeConcurrent<SectionChunk>(this, Sec);
   if (Def)
     C->Checksum = Def->CheckSum;
 
@@ -435,6 +454,8 @@ void ImportFile::parse() {
 }
 
 void BitcodeFile::parse() {
+  // LLVM targets are registered only once a bitcode file shows up.
+  initLLVMTargets();
   Obj = check(lto::InputFile::create(MemoryBufferRef(
       MB.getBuffer(), Saver.save(ParentName + MB.getBufferIdentifier()))));
   std::vector<std::pair<Symbol *, bool>> Comdat(Obj->getComdatTable().size());
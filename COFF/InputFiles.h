@@ -107,6 +107,11 @@ public:
   explicit ObjFile(MemoryBufferRef M) : InputFile(ObjectKind, M) {}
   static bool classof(const InputFile *F) { return F->kind() == ObjectKind; }
   void parse() override;
+
+  // Reads the section table and the non-COMDAT sections, and extracts the
+  // directives. This does not touch the symbol table and may be called from
+  // parallel regions before parse().
+  void preparse();
   MachineTypes getMachineType() override;
   ArrayRef<Chunk *> getChunks() { return Chunks; }
   ArrayRef<SectionChunk *> getDebugChunks() { return DebugChunks; }
@@ -144,6 +149,14 @@ public:
   // if we are not producing a PDB.
   llvm::pdb::DbiModuleDescriptorBuilder *ModuleDBI = nullptr;
 
+  // The .llvm_addrsig section, which lists the symbols whose addresses are
+  // significant, or null if the object file has none.
+  const coff_section *AddrsigSec = nullptr;
+
+  // The .llvm.call-graph-profile section, which holds call counts between
+  // the symbols of this file, or null if the object file has none.
+  const coff_section *CallgraphSec = nullptr;
+
 private:
   void initializeChunks();
   void initializeSymbols();
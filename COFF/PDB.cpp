@@ -15,7 +15,10 @@
 #include "Symbols.h"
 #include "Writer.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/DebugInfo/CodeView/DebugSubsectionRecord.h"
 #include "llvm/DebugInfo/CodeView/GlobalTypeTableBuilder.h"
 #include "llvm/DebugInfo/CodeView/LazyRandomTypeCollection.h"
@@ -48,11 +51,14 @@
 #include "llvm/Object/CVDebugRecord.h"
 #include "llvm/Support/BinaryByteStream.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/JamCRC.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include "llvm/Support/xxhash.h"
 #include <memory>
+#include <mutex>
 
 using namespace lld;
 using namespace lld::coff;
@@ -81,6 +87,40 @@ struct CVIndexMap {
   bool IsTypeServerMap = false;
 };
 
+/// A record for the globals stream, queued while merging the symbols of one
+/// object so that records are added to the shared GSIStreamBuilder in object
+/// order.
+struct PendingGlobal {
+  explicit PendingGlobal(CVSymbol Sym)
+      : Sym(Sym), Ref(SymbolRecordKind::ProcRefSym) {}
+  explicit PendingGlobal(ProcRefSym Ref) : Ref(Ref), IsProcRef(true) {}
+
+  CVSymbol Sym;
+  ProcRefSym Ref;
+  bool IsProcRef = false;
+};
+
+/// The CodeView of one object file on its way into the PDB. Its symbols are
+/// merged in parallel with those of other objects, so it has its own
+/// allocator, which must live until the PDB is written.
+struct ObjectDebugInfo {
+  explicit ObjectDebugInfo(ObjFile *File) : File(File) {}
+
+  ObjFile *File;
+  BumpPtrAllocator Alloc;
+
+  CVIndexMap ObjectIndexMap;
+
+  /// The type index map to use for symbols, or null if the object's debug
+  /// info is ignored.
+  const CVIndexMap *IndexMap = nullptr;
+
+  DebugStringTableSubsectionRef CVStrTab;
+  DebugChecksumsSubsectionRef Checksums;
+  std::vector<ulittle32_t *> StringTableReferences;
+  std::vector<PendingGlobal> Globals;
+};
+
 class PDBLinker {
 public:
   PDBLinker(SymbolTable *Symtab)
@@ -101,8 +141,16 @@ public:
   /// Link CodeView from each object file in the symbol table into the PDB.
   void addObjectsToPDB();
 
-  /// Link CodeView from a single object file into the PDB.
-  void addObjFile(ObjFile *File);
+  /// Add a module for a single object file to the PDB and merge its types.
+  void addObjFile(ObjectDebugInfo &Info);
+
+  /// Add the globals, strings and file checksums found while merging the
+  /// symbols of a single object file to the PDB.
+  void finishObjFile(ObjectDebugInfo &Info);
+
+  /// Compute the global type hashes of every /Z7 object that does not have
+  /// a usable .debug$H section, for /DEBUG:GHASH.
+  void hashObjectTypes();
 
   /// Produce a mapping from the type and item indices used in the object
   /// file to those in the destination PDB.
@@ -147,6 +195,9 @@ private:
   /// Item records that will go into the PDB IPI stream (for /DEBUG:GHASH)
   GlobalTypeTableBuilder GlobalIDTable;
 
+  /// Global type hashes computed ahead of merging by hashObjectTypes().
+  DenseMap<ObjFile *, std::vector<GloballyHashedType>> ObjectHashes;
+
   /// PDBs use a single global string table for filenames in the file checksum
   /// table.
   DebugStringTableSubsection PDBStrTab;
@@ -160,6 +211,13 @@ private:
 
   std::vector<pdb::SecMapEntry> SectionMap;
 
+  // A copy of the COFF section table. The original is in the output file,
+  // which may be committed before the PDB is.
+  std::vector<uint8_t> SectionTable;
+
+  /// The object files being linked into the PDB, in link order.
+  std::vector<std::unique_ptr<ObjectDebugInfo>> Objects;
+
   /// Type index mappings of type server PDBs that we've loaded so far.
   std::map<GUID, CVIndexMap> TypeServerIndexMappings;
 
@@ -228,6 +286,47 @@ getHashesFromDebugH(ArrayRef<uint8_t> DebugH) {
   return {reinterpret_cast<const GloballyHashedType *>(DebugH.data()), Count};
 }
 
+// Reads the hashes of Types from a /lldghashcache file. Returns false if
+// the file is missing or does not match Types.
+static bool readCachedHashes(StringRef Path, const CVTypeArray &Types,
+                             std::vector<GloballyHashedType> &Hashes) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getFile(
+      Path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!MBOrErr)
+    return false;
+  StringRef Buf = (*MBOrErr)->getBuffer();
+  size_t Count = std::distance(Types.begin(), Types.end());
+  if (Buf.size() != Count * sizeof(GloballyHashedType))
+    return false;
+
+  auto *Begin = reinterpret_cast<const GloballyHashedType *>(Buf.data());
+  Hashes.assign(Begin, Begin + Count);
+  return true;
+}
+
+// Writes Hashes to a /lldghashcache file. The cache only saves time, so
+// errors are ignored. Identical objects may write the same file
+// concurrently, so each writes a unique temporary file and renames it.
+static void writeCachedHashes(StringRef Path,
+                              ArrayRef<GloballyHashedType> Hashes) {
+  int FD;
+  SmallString<128> TmpPath;
+  if (sys::fs::createUniqueFile(Path + ".%%%%%%.tmp", FD, TmpPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS.write(reinterpret_cast<const char *>(Hashes.data()),
+             Hashes.size() * sizeof(GloballyHashedType));
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TmpPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TmpPath, Path))
+    sys::fs::remove(TmpPath);
+}
+
 static void addTypeInfo(pdb::TpiStreamBuilder &TpiBuilder,
                         TypeCollection &TypeTable) {
   // Start the TPI or IPI stream header.
@@ -283,7 +382,13 @@ Expected<const CVIndexMap&> PDBLinker::mergeDebugT(ObjFile *File,
     if (Optional<ArrayRef<uint8_t>> DebugH = getDebugH(File))
       Hashes = getHashesFromDebugH(*DebugH);
     else {
-      OwnedHashes = GloballyHashedType::hashTypes(Types);
+      // Take ownership of the precomputed hashes so that they are freed once
+      // this object has been merged.
+      auto It = ObjectHashes.find(File);
+      if (It != ObjectHashes.end())
+        OwnedHashes = std::move(It->second);
+      if (OwnedHashes.empty())
+        OwnedHashes = GloballyHashedType::hashTypes(Types);
       Hashes = OwnedHashes;
     }
 
@@ -390,9 +495,41 @@ Expected<const CVIndexMap&> PDBLinker::maybeMergeTypeServerPDB(ObjFile *File,
     // global hashes for the TPI stream, since it is independent, then we
     // synthesize hashes for the IPI stream, using the hashes for the TPI stream
     // as inputs.
-    auto TpiHashes = GloballyHashedType::hashTypes(ExpectedTpi->typeArray());
-    auto IpiHashes =
-        GloballyHashedType::hashIds(ExpectedIpi->typeArray(), TpiHashes);
+    //
+    // With /lldghashcache, the hashes are kept between links. A type server
+    // is found in the cache by its GUID and age. A type server that grew
+    // since it was cached no longer matches its record count, so it is
+    // hashed again.
+    SmallString<128> TpiPath, IpiPath;
+    if (!Config->GHashCache.empty()) {
+      std::string Key =
+          toHex(makeArrayRef(TSId.Guid)) + "-" + utostr(TS.getAge());
+      sys::fs::create_directories(Config->GHashCache);
+      TpiPath = Config->GHashCache;
+      sys::path::append(TpiPath, Key + ".tpi.ghash");
+      IpiPath = Config->GHashCache;
+      sys::path::append(IpiPath, Key + ".ipi.ghash");
+    }
+
+    std::vector<GloballyHashedType> TpiHashes, IpiHashes;
+    bool TpiCached = !TpiPath.empty() &&
+                     readCachedHashes(TpiPath, ExpectedTpi->typeArray(),
+                                      TpiHashes);
+    if (!TpiCached) {
+      TpiHashes = GloballyHashedType::hashTypes(ExpectedTpi->typeArray());
+      if (!TpiPath.empty())
+        writeCachedHashes(TpiPath, TpiHashes);
+    }
+
+    // IPI hashes depend on the TPI hashes, so they can only be reused along
+    // with them.
+    if (!TpiCached ||
+        !readCachedHashes(IpiPath, ExpectedIpi->typeArray(), IpiHashes)) {
+      IpiHashes =
+          GloballyHashedType::hashIds(ExpectedIpi->typeArray(), TpiHashes);
+      if (!IpiPath.empty())
+        writeCachedHashes(IpiPath, IpiHashes);
+    }
 
     // Merge TPI first, because the IPI stream will reference type indices.
     if (auto Err = mergeTypeRecords(GlobalTypeTable, IndexMap.TPIMap,
@@ -670,7 +807,7 @@ static bool symbolGoesInGlobalsStream(const CVSymbol &Sym) {
   }
 }
 
-static void addGlobalSymbol(pdb::GSIStreamBuilder &Builder, ObjFile &File,
+static void addGlobalSymbol(std::vector<PendingGlobal> &Globals, ObjFile &File,
                             const CVSymbol &Sym) {
   switch (Sym.kind()) {
   case SymbolKind::S_CONSTANT:
@@ -679,7 +816,7 @@ static void addGlobalSymbol(pdb::GSIStreamBuilder &Builder, ObjFile &File,
   case SymbolKind::S_LDATA32:
   case SymbolKind::S_PROCREF:
   case SymbolKind::S_LPROCREF:
-    Builder.addGlobalSymbol(Sym);
+    Globals.emplace_back(Sym);
     break;
   case SymbolKind::S_GPROC32:
   case SymbolKind::S_LPROC32: {
@@ -693,7 +830,7 @@ static void addGlobalSymbol(pdb::GSIStreamBuilder &Builder, ObjFile &File,
     PS.Name = getSymbolName(Sym);
     PS.SumName = 0;
     PS.SymOffset = File.ModuleDBI->getNextSymbolOffset();
-    Builder.addGlobalSymbol(PS);
+    Globals.emplace_back(PS);
     break;
   }
   default:
@@ -702,7 +839,7 @@ static void addGlobalSymbol(pdb::GSIStreamBuilder &Builder, ObjFile &File,
 }
 
 static void mergeSymbolRecords(BumpPtrAllocator &Alloc, ObjFile *File,
-                               pdb::GSIStreamBuilder &GsiBuilder,
+                               std::vector<PendingGlobal> &Globals,
                                const CVIndexMap &IndexMap,
                                TypeCollection &IDTable,
                                std::vector<ulittle32_t *> &StringTableRefs,
@@ -756,7 +893,7 @@ static void mergeSymbolRecords(BumpPtrAllocator &Alloc, ObjFile *File,
         // symbol offset, and writing to the module's symbol stream will update
         // that offset.
         if (symbolGoesInGlobalsStream(NewSym))
-          addGlobalSymbol(GsiBuilder, *File, NewSym);
+          addGlobalSymbol(Globals, *File, NewSym);
 
         // Add the symbol to the module.
         if (symbolGoesInModuleStream(NewSym))
@@ -766,15 +903,28 @@ static void mergeSymbolRecords(BumpPtrAllocator &Alloc, ObjFile *File,
   cantFail(std::move(EC));
 }
 
-// Allocate memory for a .debug$S section and relocate it.
-static ArrayRef<uint8_t> relocateDebugChunk(BumpPtrAllocator &Alloc,
+// Relocate a .debug$S section into Scratch, which is reused for every
+// section of an object. Only the subsections that the PDB refers to are
+// copied out of it, so the relocated section as a whole is never kept.
+static ArrayRef<uint8_t> relocateDebugChunk(std::vector<uint8_t> &Scratch,
                                             SectionChunk *DebugChunk) {
-  uint8_t *Buffer = Alloc.Allocate<uint8_t>(DebugChunk->getSize());
+  Scratch.resize(DebugChunk->getSize());
   assert(DebugChunk->OutputSectionOff == 0 &&
          "debug sections should not be in output sections");
-  DebugChunk->writeTo(Buffer);
-  return consumeDebugMagic(makeArrayRef(Buffer, DebugChunk->getSize()),
-                           ".debug$S");
+  DebugChunk->writeTo(Scratch.data());
+  return consumeDebugMagic(Scratch, ".debug$S");
+}
+
+// Copy the contents of a relocated subsection out of the scratch buffer, for
+// subsections that are added to the PDB as they are.
+static BinaryStreamRef copySubsection(BumpPtrAllocator &Alloc,
+                                      const DebugSubsectionRecord &SS) {
+  ArrayRef<uint8_t> Data;
+  BinaryStreamRef Ref = SS.getRecordData();
+  cantFail(Ref.readBytes(0, Ref.getLength(), Data));
+  uint8_t *Copy = reinterpret_cast<uint8_t *>(Alloc.Allocate(Data.size(), 4));
+  memcpy(Copy, Data.data(), Data.size());
+  return BinaryStreamRef(makeArrayRef(Copy, Data.size()), support::little);
 }
 
 static pdb::SectionContrib createSectionContrib(const Chunk *C, uint32_t Modi) {
@@ -803,7 +953,9 @@ static pdb::SectionContrib createSectionContrib(const Chunk *C, uint32_t Modi) {
   return SC;
 }
 
-void PDBLinker::addObjFile(ObjFile *File) {
+void PDBLinker::addObjFile(ObjectDebugInfo &Info) {
+  ObjFile *File = Info.File;
+
   // Add a module descriptor for every object file. We need to put an absolute
   // path to the object into the PDB. If this is a plain object, we make its
   // path absolute. If it's an object in an archive, we make the archive path
@@ -832,8 +984,7 @@ void PDBLinker::addObjFile(ObjFile *File) {
   // type information, file checksums, and the string table.  Add type info to
   // the PDB first, so that we can get the map from object file type and item
   // indices to PDB type and item indices.
-  CVIndexMap ObjectIndexMap;
-  auto IndexMapResult = mergeDebugT(File, ObjectIndexMap);
+  auto IndexMapResult = mergeDebugT(File, Info.ObjectIndexMap);
 
   // If the .debug$T sections fail to merge, assume there is no debug info.
   if (!IndexMapResult) {
@@ -842,20 +993,23 @@ void PDBLinker::addObjFile(ObjFile *File) {
     return;
   }
 
-  const CVIndexMap &IndexMap = *IndexMapResult;
-
-  ScopedTimer T(SymbolMergingTimer);
+  Info.IndexMap = &*IndexMapResult;
+}
 
-  // Now do all live .debug$S sections.
-  DebugStringTableSubsectionRef CVStrTab;
-  DebugChecksumsSubsectionRef Checksums;
-  std::vector<ulittle32_t *> StringTableReferences;
+// Merge the live .debug$S sections of one object file into its module. This
+// only touches the object's own module and allocator, and reads the type
+// tables, which are complete by now, so it runs in parallel for all objects.
+// Anything that goes into a structure shared by all modules is queued in Info
+// for finishObjFile.
+static void mergeDebugS(ObjectDebugInfo &Info, TypeCollection &IDTable) {
+  ObjFile *File = Info.File;
+  std::vector<uint8_t> Scratch;
   for (SectionChunk *DebugChunk : File->getDebugChunks()) {
     if (!DebugChunk->isLive() || DebugChunk->getSectionName() != ".debug$S")
       continue;
 
     ArrayRef<uint8_t> RelocatedDebugContents =
-        relocateDebugChunk(Alloc, DebugChunk);
+        relocateDebugChunk(Scratch, DebugChunk);
     if (RelocatedDebugContents.empty())
       continue;
 
@@ -866,31 +1020,29 @@ void PDBLinker::addObjFile(ObjFile *File) {
     for (const DebugSubsectionRecord &SS : Subsections) {
       switch (SS.kind()) {
       case DebugSubsectionKind::StringTable: {
-        assert(!CVStrTab.valid() &&
+        assert(!Info.CVStrTab.valid() &&
                "Encountered multiple string table subsections!");
-        ExitOnErr(CVStrTab.initialize(SS.getRecordData()));
+        ExitOnErr(Info.CVStrTab.initialize(copySubsection(Info.Alloc, SS)));
         break;
       }
       case DebugSubsectionKind::FileChecksums:
-        assert(!Checksums.valid() &&
+        assert(!Info.Checksums.valid() &&
                "Encountered multiple checksum subsections!");
-        ExitOnErr(Checksums.initialize(SS.getRecordData()));
+        ExitOnErr(Info.Checksums.initialize(copySubsection(Info.Alloc, SS)));
         break;
       case DebugSubsectionKind::Lines:
         // We can add the relocated line table directly to the PDB without
         // modification because the file checksum offsets will stay the same.
-        File->ModuleDBI->addDebugSubsection(SS);
+        File->ModuleDBI->addDebugSubsection(
+            DebugSubsectionRecord(SS.kind(), copySubsection(Info.Alloc, SS),
+                                  CodeViewContainer::ObjectFile));
         break;
       case DebugSubsectionKind::Symbols:
-        if (Config->DebugGHashes) {
-          mergeSymbolRecords(Alloc, File, Builder.getGsiBuilder(), IndexMap,
-                             GlobalIDTable, StringTableReferences,
-                             SS.getRecordData());
-        } else {
-          mergeSymbolRecords(Alloc, File, Builder.getGsiBuilder(), IndexMap,
-                             IDTable, StringTableReferences,
-                             SS.getRecordData());
-        }
+        // Each symbol record is copied once, into the module's allocator,
+        // while its type indices are remapped.
+        mergeSymbolRecords(Info.Alloc, File, Info.Globals, *Info.IndexMap,
+                           IDTable, Info.StringTableReferences,
+                           SS.getRecordData());
         break;
       default:
         // FIXME: Process the rest of the subsections.
@@ -898,16 +1050,30 @@ void PDBLinker::addObjFile(ObjFile *File) {
       }
     }
   }
+}
+
+void PDBLinker::finishObjFile(ObjectDebugInfo &Info) {
+  ObjFile *File = Info.File;
+
+  pdb::GSIStreamBuilder &GsiBuilder = Builder.getGsiBuilder();
+  for (const PendingGlobal &G : Info.Globals) {
+    if (G.IsProcRef)
+      GsiBuilder.addGlobalSymbol(G.Ref);
+    else
+      GsiBuilder.addGlobalSymbol(G.Sym);
+  }
+  Info.Globals.clear();
 
   // We should have seen all debug subsections across the entire object file now
   // which means that if a StringTable subsection and Checksums subsection were
   // present, now is the time to handle them.
+  DebugStringTableSubsectionRef &CVStrTab = Info.CVStrTab;
   if (!CVStrTab.valid()) {
-    if (Checksums.valid())
+    if (Info.Checksums.valid())
       fatal(".debug$S sections with a checksums subsection must also contain a "
             "string table subsection");
 
-    if (!StringTableReferences.empty())
+    if (!Info.StringTableReferences.empty())
       warn("No StringTable subsection was encountered, but there are string "
            "table references");
     return;
@@ -915,7 +1081,7 @@ void PDBLinker::addObjFile(ObjFile *File) {
 
   // Rewrite each string table reference based on the value that the string
   // assumes in the final PDB.
-  for (ulittle32_t *Ref : StringTableReferences) {
+  for (ulittle32_t *Ref : Info.StringTableReferences) {
     auto ExpectedString = CVStrTab.getString(*Ref);
     if (!ExpectedString) {
       warn("Invalid string table reference");
@@ -925,13 +1091,14 @@ void PDBLinker::addObjFile(ObjFile *File) {
 
     *Ref = PDBStrTab.insert(*ExpectedString);
   }
+  Info.StringTableReferences.clear();
 
   // Make a new file checksum table that refers to offsets in the PDB-wide
   // string table. Generally the string table subsection appears after the
   // checksum table, so we have to do this after looping over all the
   // subsections.
   auto NewChecksums = make_unique<DebugChecksumsSubsection>(PDBStrTab);
-  for (FileChecksumEntry &FC : Checksums) {
+  for (FileChecksumEntry &FC : Info.Checksums) {
     StringRef FileName = ExitOnErr(CVStrTab.getString(FC.FileNameOffset));
     ExitOnErr(Builder.getDbiBuilder().addModuleSourceFile(*File->ModuleDBI,
                                                           FileName));
@@ -957,12 +1124,87 @@ static PublicSym32 createPublic(Defined *Def) {
   return Pub;
 }
 
+// Hashing the type records of an object is independent of every other object
+// and of the type tables, so it is done in parallel here. Only inserting the
+// hashed records into the global tables, which assigns type indices in object
+// order, stays serial in mergeDebugT.
+void PDBLinker::hashObjectTypes() {
+  ScopedTimer T(TypeMergingTimer);
+
+  std::vector<ObjFile *> Files;
+  for (ObjFile *File : ObjFile::Instances) {
+    if (getDebugH(File))
+      continue;
+    ObjectHashes[File];
+    Files.push_back(File);
+  }
+  if (!Config->GHashCache.empty())
+    sys::fs::create_directories(Config->GHashCache);
+
+  parallelForEach(Files, [&](ObjFile *File) {
+    ArrayRef<uint8_t> Data = getDebugSection(File, ".debug$T");
+    if (Data.empty())
+      return;
+
+    // Malformed sections and type server references are left to mergeDebugT,
+    // which reports errors serially.
+    BinaryByteStream Stream(Data, support::little);
+    CVTypeArray Types;
+    BinaryStreamReader Reader(Stream);
+    if (auto EC = Reader.readArray(Types, Reader.getLength())) {
+      consumeError(std::move(EC));
+      return;
+    }
+    if (Types.begin() == Types.end() || Types.begin()->kind() == LF_TYPESERVER2)
+      return;
+
+    std::vector<GloballyHashedType> &Hashes = ObjectHashes.find(File)->second;
+    if (Config->GHashCache.empty()) {
+      Hashes = GloballyHashedType::hashTypes(Types);
+      return;
+    }
+
+    // Objects are found in the cache by a hash of their type records, so
+    // that an unchanged object hits even if its code or path changed.
+    SmallString<128> Path(Config->GHashCache);
+    sys::path::append(Path, utohexstr(xxHash64(toStringRef(Data))) + ".ghash");
+    if (!readCachedHashes(Path, Types, Hashes)) {
+      Hashes = GloballyHashedType::hashTypes(Types);
+      writeCachedHashes(Path, Hashes);
+    }
+  });
+}
+
 // Add all object files to the PDB. Merge .debug$T sections into IpiData and
 // TpiData.
 void PDBLinker::addObjectsToPDB() {
   ScopedTimer T1(AddObjectsTimer);
-  for (ObjFile *File : ObjFile::Instances)
-    addObjFile(File);
+  if (Config->DebugGHashes)
+    hashObjectTypes();
+
+  // Types are merged serially because type indices are assigned in object
+  // order.
+  for (ObjFile *File : ObjFile::Instances) {
+    Objects.push_back(make_unique<ObjectDebugInfo>(File));
+    addObjFile(*Objects.back());
+  }
+
+  // Symbols are merged in parallel, and their contributions to the globals
+  // stream and the string table are then added in object order, so the PDB
+  // does not depend on scheduling.
+  {
+    ScopedTimer T(SymbolMergingTimer);
+    TypeCollection &IDs = Config->DebugGHashes
+                              ? static_cast<TypeCollection &>(GlobalIDTable)
+                              : static_cast<TypeCollection &>(IDTable);
+    parallelForEach(Objects, [&](std::unique_ptr<ObjectDebugInfo> &Info) {
+      if (Info->IndexMap)
+        mergeDebugS(*Info, IDs);
+    });
+    for (std::unique_ptr<ObjectDebugInfo> &Info : Objects)
+      if (Info->IndexMap)
+        finishObjFile(*Info);
+  }
 
   Builder.getStringTableBuilder().setStrings(PDBStrTab);
   T1.stop();
@@ -981,20 +1223,26 @@ void PDBLinker::addObjectsToPDB() {
   ScopedTimer T3(GlobalsLayoutTimer);
   // Compute the public and global symbols.
   auto &GsiBuilder = Builder.getGsiBuilder();
-  std::vector<PublicSym32> Publics;
-  Symtab->forEachSymbol([&Publics](Symbol *S) {
+  std::vector<Defined *> Defs;
+  Symtab->forEachSymbol([&Defs](Symbol *S) {
     // Only emit defined, live symbols that have a chunk.
     auto *Def = dyn_cast<Defined>(S);
     if (Def && Def->isLive() && Def->getChunk())
-      Publics.push_back(createPublic(Def));
+      Defs.push_back(Def);
   });
 
-  if (!Publics.empty()) {
-    // Sort the public symbols and add them to the stream.
-    std::sort(Publics.begin(), Publics.end(),
-              [](const PublicSym32 &L, const PublicSym32 &R) {
-                return L.Name < R.Name;
-              });
+  if (!Defs.empty()) {
+    // Create and sort the public symbols in parallel, since large images
+    // have millions of them, and add them to the stream. Symbol names are
+    // unique, so the order does not depend on the sort.
+    std::vector<PublicSym32> Publics(Defs.size(),
+                                     PublicSym32(SymbolKind::S_PUB32));
+    parallelForEachN(0, Defs.size(),
+                     [&](size_t I) { Publics[I] = createPublic(Defs[I]); });
+    parallelSort(Publics.begin(), Publics.end(),
+                 [](const PublicSym32 &L, const PublicSym32 &R) {
+                   return L.Name < R.Name;
+                 });
     for (const PublicSym32 &Pub : Publics)
       GsiBuilder.addPublicSymbol(Pub);
   }
@@ -1099,21 +1347,25 @@ static void addLinkerModuleSectionSymbol(pdb::DbiModuleDescriptorBuilder &Mod,
       Sym, Allocator, CodeViewContainer::Pdb));
 }
 
-// Creates a PDB file.
-void coff::createPDB(SymbolTable *Symtab,
-                     ArrayRef<OutputSection *> OutputSections,
-                     ArrayRef<uint8_t> SectionTable,
-                     const llvm::codeview::DebugInfo &BuildId) {
+// Creates a PDB file. The file is written to disk on another thread, so
+// that it overlaps with writing the output file.
+std::future<void> coff::createPDB(SymbolTable *Symtab,
+                                  ArrayRef<OutputSection *> OutputSections,
+                                  ArrayRef<uint8_t> SectionTable,
+                                  const llvm::codeview::DebugInfo &BuildId) {
   ScopedTimer T1(TotalPdbLinkTimer);
-  PDBLinker PDB(Symtab);
+  auto PDB = std::make_shared<PDBLinker>(Symtab);
 
-  PDB.initialize(BuildId);
-  PDB.addObjectsToPDB();
-  PDB.addSections(OutputSections, SectionTable);
-  PDB.addNatvisFiles();
+  PDB->initialize(BuildId);
+  PDB->addObjectsToPDB();
+  PDB->addSections(OutputSections, SectionTable);
+  PDB->addNatvisFiles();
 
-  ScopedTimer T2(DiskCommitTimer);
-  PDB.commit();
+  auto Strategy = ThreadsEnabled ? std::launch::async : std::launch::deferred;
+  return std::async(Strategy, [=] {
+    ScopedTimer T2(DiskCommitTimer);
+    PDB->commit();
+  });
 }
 
 void PDBLinker::initialize(const llvm::codeview::DebugInfo &BuildId) {
@@ -1145,7 +1397,9 @@ void PDBLinker::initialize(const llvm::codeview::DebugInfo &BuildId) {
 }
 
 void PDBLinker::addSections(ArrayRef<OutputSection *> OutputSections,
-                            ArrayRef<uint8_t> SectionTable) {
+                            ArrayRef<uint8_t> SecTable) {
+  SectionTable.assign(SecTable.begin(), SecTable.end());
+
   // It's not entirely clear what this is, but the * Linker * module uses it.
   pdb::DbiStreamBuilder &DbiBuilder = Builder.getDbiBuilder();
   NativePath = Config->PDBPath;
@@ -1208,33 +1462,60 @@ static uint32_t getSecrelReloc() {
   }
 }
 
-// Try to find a line table for the given offset Addr into the given chunk C.
-// If a line table was found, the line table, the string and checksum tables
-// that are used to interpret the line table, and the offset of Addr in the line
-// table are stored in the output arguments. Returns whether a line table was
-// found.
-static bool findLineTable(const SectionChunk *C, uint32_t Addr,
-                          DebugStringTableSubsectionRef &CVStrTab,
-                          DebugChecksumsSubsectionRef &Checksums,
-                          DebugLinesSubsectionRef &Lines,
-                          uint32_t &OffsetInLinetable) {
+namespace {
+// A line table entry, with its offset in the section chunk it describes.
+struct LineEntry {
+  uint32_t Offset;
+  StringRef File;
+  uint32_t Line;
+};
+
+// The line table entries of a section chunk sorted by offset, and the ranges
+// of the chunk that the line tables cover.
+struct ChunkLineIndex {
+  std::vector<LineEntry> Entries;
+  std::vector<std::pair<uint32_t, uint32_t>> Ranges;
+};
+
+// A line table in a .debug$S section and the chunk it refers to.
+struct LineTableRef {
+  const SectionChunk *Chunk;
+  uint32_t OffsetInChunk;
+  DebugLinesSubsectionRef Lines;
+};
+} // namespace
+
+// The line tables of the object files that getFileLine has been asked about.
+// Diagnostics may look up many addresses, so each object's .debug$S sections
+// are parsed only once.
+static std::mutex LineIndexMu;
+static DenseSet<const ObjFile *> IndexedFiles;
+static DenseMap<const SectionChunk *, ChunkLineIndex> LineIndex;
+
+// Parses the line tables in the .debug$S sections of File and adds them to
+// LineIndex.
+static void indexLineTables(ObjFile *File) {
   ExitOnError ExitOnErr;
   uint32_t SecrelReloc = getSecrelReloc();
 
-  for (SectionChunk *DbgC : C->File->getDebugChunks()) {
+  DebugStringTableSubsectionRef CVStrTab;
+  DebugChecksumsSubsectionRef Checksums;
+  std::vector<LineTableRef> Tables;
+
+  for (SectionChunk *DbgC : File->getDebugChunks()) {
     if (DbgC->getSectionName() != ".debug$S")
       continue;
 
-    // Build a mapping of SECREL relocations in DbgC that refer to C.
-    DenseMap<uint32_t, uint32_t> Secrels;
-    for (const coff_relocation &R : DbgC->Relocs) {
+    // Build a mapping of SECREL relocations in DbgC to the chunks and offsets
+    // they refer to.
+    DenseMap<uint32_t, std::pair<const SectionChunk *, uint32_t>> Secrels;
+    for (const coff_relocation &R : DbgC->getRelocs()) {
       if (R.Type != SecrelReloc)
         continue;
 
       if (auto *S = dyn_cast_or_null<DefinedRegular>(
-              C->File->getSymbols()[R.SymbolTableIndex]))
-        if (S->getChunk() == C)
-          Secrels[R.VirtualAddress] = S->getValue();
+              File->getSymbols()[R.SymbolTableIndex]))
+        Secrels[R.VirtualAddress] = {S->getChunk(), S->getValue()};
     }
 
     ArrayRef<uint8_t> Contents =
@@ -1262,34 +1543,52 @@ static bool findLineTable(const SectionChunk *C, uint32_t Addr,
         ExitOnErr(Ref.readLongestContiguousChunk(0, Bytes));
         size_t OffsetInDbgC = Bytes.data() - DbgC->getContents().data();
 
-        // Check whether this line table refers to C.
+        // Find the chunk this line table refers to.
         auto I = Secrels.find(OffsetInDbgC);
         if (I == Secrels.end())
           break;
 
-        // Check whether this line table covers Addr in C.
-        DebugLinesSubsectionRef LinesTmp;
-        ExitOnErr(LinesTmp.initialize(BinaryStreamReader(Ref)));
-        uint32_t OffsetInC = I->second + LinesTmp.header()->RelocOffset;
-        if (Addr < OffsetInC || Addr >= OffsetInC + LinesTmp.header()->CodeSize)
-          break;
-
-        assert(!Lines.header() &&
-               "Encountered multiple line tables for function!");
-        ExitOnErr(Lines.initialize(BinaryStreamReader(Ref)));
-        OffsetInLinetable = Addr - OffsetInC;
+        LineTableRef T;
+        T.Chunk = I->second.first;
+        ExitOnErr(T.Lines.initialize(BinaryStreamReader(Ref)));
+        T.OffsetInChunk = I->second.second + T.Lines.header()->RelocOffset;
+        Tables.push_back(std::move(T));
         break;
       }
       default:
         break;
       }
+    }
+  }
 
-      if (CVStrTab.valid() && Checksums.valid() && Lines.header())
-        return true;
+  if (!CVStrTab.valid() || !Checksums.valid())
+    return;
+
+  DenseMap<const SectionChunk *, ChunkLineIndex> Index;
+  for (LineTableRef &T : Tables) {
+    ChunkLineIndex &CI = Index[T.Chunk];
+    CI.Ranges.push_back(
+        {T.OffsetInChunk, T.OffsetInChunk + T.Lines.header()->CodeSize});
+    for (LineColumnEntry &Entry : T.Lines) {
+      StringRef Filename =
+          ExitOnErr(getFileName(CVStrTab, Checksums, Entry.NameIndex));
+      for (const LineNumberEntry &LN : Entry.LineNumbers) {
+        LineInfo LI(LN.Flags);
+        CI.Entries.push_back(
+            {T.OffsetInChunk + LN.Offset, Filename, LI.getStartLine()});
+      }
     }
   }
 
-  return false;
+  for (auto &KV : Index) {
+    ChunkLineIndex &CI = KV.second;
+    std::stable_sort(CI.Entries.begin(), CI.Entries.end(),
+                     [](const LineEntry &A, const LineEntry &B) {
+                       return A.Offset < B.Offset;
+                     });
+    llvm::sort(CI.Ranges.begin(), CI.Ranges.end());
+    LineIndex[KV.first] = std::move(CI);
+  }
 }
 
 // Use CodeView line tables to resolve a file and line number for the given
@@ -1297,30 +1596,31 @@ static bool findLineTable(const SectionChunk *C, uint32_t Addr,
 // not found.
 std::pair<StringRef, uint32_t> coff::getFileLine(const SectionChunk *C,
                                                  uint32_t Addr) {
-  ExitOnError ExitOnErr;
+  std::lock_guard<std::mutex> Lock(LineIndexMu);
+  if (IndexedFiles.insert(C->File).second)
+    indexLineTables(C->File);
 
-  DebugStringTableSubsectionRef CVStrTab;
-  DebugChecksumsSubsectionRef Checksums;
-  DebugLinesSubsectionRef Lines;
-  uint32_t OffsetInLinetable;
+  auto It = LineIndex.find(C);
+  if (It == LineIndex.end())
+    return {"", 0};
+  const ChunkLineIndex &CI = It->second;
 
-  if (!findLineTable(C, Addr, CVStrTab, Checksums, Lines, OffsetInLinetable))
+  // Check whether a line table covers Addr.
+  auto R = std::upper_bound(
+      CI.Ranges.begin(), CI.Ranges.end(), Addr,
+      [](uint32_t A, const std::pair<uint32_t, uint32_t> &Range) {
+        return A < Range.first;
+      });
+  if (R == CI.Ranges.begin() || Addr >= std::prev(R)->second)
     return {"", 0};
 
-  uint32_t NameIndex;
-  uint32_t LineNumber;
-  for (LineColumnEntry &Entry : Lines) {
-    for (const LineNumberEntry &LN : Entry.LineNumbers) {
-      if (LN.Offset > OffsetInLinetable) {
-        StringRef Filename =
-            ExitOnErr(getFileName(CVStrTab, Checksums, NameIndex));
-        return {Filename, LineNumber};
-      }
-      LineInfo LI(LN.Flags);
-      NameIndex = Entry.NameIndex;
-      LineNumber = LI.getStartLine();
-    }
-  }
-  StringRef Filename = ExitOnErr(getFileName(CVStrTab, Checksums, NameIndex));
-  return {Filename, LineNumber};
+  // Find the last entry at or before Addr.
+  auto E = std::upper_bound(CI.Entries.begin(), CI.Entries.end(), Addr,
+                            [](uint32_t A, const LineEntry &LE) {
+                              return A < LE.Offset;
+                            });
+  if (E == CI.Entries.begin())
+    return {"", 0};
+  --E;
+  return {E->File, E->Line};
 }
@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
+#include <future>
 
 namespace llvm {
 namespace codeview {
@@ -25,10 +26,12 @@ class OutputSection;
 class SectionChunk;
 class SymbolTable;
 
-void createPDB(SymbolTable *Symtab,
-               llvm::ArrayRef<OutputSection *> OutputSections,
-               llvm::ArrayRef<uint8_t> SectionTable,
-               const llvm::codeview::DebugInfo &BuildId);
+// Builds the PDB and starts writing it. The PDB is complete once the
+// returned future is ready.
+std::future<void> createPDB(SymbolTable *Symtab,
+                            llvm::ArrayRef<OutputSection *> OutputSections,
+                            llvm::ArrayRef<uint8_t> SectionTable,
+                            const llvm::codeview::DebugInfo &BuildId);
 
 std::pair<llvm::StringRef, uint32_t> getFileLine(const SectionChunk *C,
                                                  uint32_t Addr);
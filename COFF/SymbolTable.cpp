@@ -97,7 +97,7 @@ static std::string getSymbolLocations(ObjFile *File, uint32_t SymIndex) {
     auto *SC = dyn_cast<SectionChunk>(C);
     if (!SC)
       continue;
-    for (const coff_relocation &R : SC->Relocs) {
+    for (const coff_relocation &R : SC->getRelocs()) {
       if (R.SymbolTableIndex != SymIndex)
         continue;
       std::pair<StringRef, uint32_t> FileLine =
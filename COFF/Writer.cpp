@@ -8,16 +8,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "Writer.h"
+#include "CallGraphSort.h"
 #include "Config.h"
 #include "DLL.h"
+#include "Incremental.h"
 #include "InputFiles.h"
 #include "MapFile.h"
 #include "PDB.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/InPlaceOutputBuffer.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "lld/Common/Timer.h"
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -25,7 +30,6 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/FileOutputBuffer.h"
-#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/RandomNumberGenerator.h"
 #include "llvm/Support/xxhash.h"
@@ -155,6 +159,7 @@ private:
   void assignAddresses();
   void removeEmptySections();
   void createSymbolAndStringTable();
+  void addDefinedSymbols();
   void openFile(StringRef OutputPath);
   template <typename PEHeaderTy> void writeHeader();
   void createSEHTable();
@@ -174,7 +179,7 @@ private:
 
   OutputSection *findSection(StringRef Name);
   void addBaserels();
-  void addBaserelBlocks(std::vector<Baserel> &V);
+  void addBaserelBlocks(ArrayRef<Baserel> V);
 
   uint32_t getSizeOfInitializedData();
   std::map<StringRef, std::vector<DefinedImportData *>> binImports();
@@ -183,6 +188,9 @@ private:
   std::vector<OutputSection *> OutputSections;
   std::vector<char> Strtab;
   std::vector<llvm::object::coff_symbol16> OutputSymtab;
+  // The base relocations of all sections, which the chunks of .reloc point
+  // into.
+  std::vector<Baserel> Baserels;
   IdataContents Idata;
   DelayLoadContents DelayIdata;
   EdataContents Edata;
@@ -336,6 +344,8 @@ void Writer::run() {
   createImportTables();
   createExportTable();
   mergeSections();
+  if (Config->IncrementalLayout)
+    prepareIncrementalLayout();
   assignAddresses();
   removeEmptySections();
   setSectionPermissions();
@@ -360,9 +370,11 @@ void Writer::run() {
 
   T1.stop();
 
+  std::future<void> PDBDone;
   if (!Config->PDBPath.empty() && Config->Debug) {
     assert(BuildId);
-    createPDB(Symtab, OutputSections, SectionTable, *BuildId->BuildId);
+    PDBDone =
+        createPDB(Symtab, OutputSections, SectionTable, *BuildId->BuildId);
   }
 
   writeMapFile(OutputSections);
@@ -370,6 +382,11 @@ void Writer::run() {
   ScopedTimer T2(DiskCommitTimer);
   if (auto E = Buffer->commit())
     fatal("failed to write the output file: " + toString(std::move(E)));
+  if (PDBDone.valid())
+    PDBDone.get();
+
+  if (Config->IncrementalLayout)
+    writeIncrementalState();
 }
 
 static StringRef getOutputSectionName(StringRef Name) {
@@ -395,6 +412,21 @@ static void sortBySectionOrder(std::vector<Chunk *> &Chunks) {
                    });
 }
 
+// For /call-graph-ordering-file and .llvm.call-graph-profile sections.
+static void
+sortByCallGraphOrder(std::vector<Chunk *> &Chunks,
+                     const DenseMap<const SectionChunk *, int> &Order) {
+  auto GetPriority = [&](Chunk *C) {
+    if (auto *Sec = dyn_cast<SectionChunk>(C))
+      return Order.lookup(Sec);
+    return 0;
+  };
+
+  std::stable_sort(Chunks.begin(), Chunks.end(), [&](Chunk *A, Chunk *B) {
+    return GetPriority(A) < GetPriority(B);
+  });
+}
+
 // Create output section objects and add them to OutputSections.
 void Writer::createSections() {
   // First, create the builtin sections.
@@ -440,10 +472,16 @@ void Writer::createSections() {
     Map[{C->getSectionName(), C->getOutputCharacteristics()}].push_back(C);
   }
 
-  // Process an /order option.
-  if (!Config->Order.empty())
+  // Process an /order option, or else lay out the sections of a call graph
+  // profile.
+  if (!Config->Order.empty()) {
     for (auto &Pair : Map)
       sortBySectionOrder(Pair.second);
+  } else if (!Config->CallGraphProfile.empty()) {
+    DenseMap<const SectionChunk *, int> Order = computeCallGraphProfileOrder();
+    for (auto &Pair : Map)
+      sortByCallGraphOrder(Pair.second, Order);
+  }
 
   // Then create an OutputSection for each section.
   // '$' and all following characters in input section names are
@@ -601,6 +639,8 @@ size_t Writer::addEntryToStringTable(StringRef Str) {
   return OffsetOfEntry;
 }
 
+// Converts Def to a COFF symbol. If its name does not fit in the symbol, the
+// caller has to fill in the string table offset.
 Optional<coff_symbol16> Writer::createSymbol(Defined *Def) {
   coff_symbol16 Sym;
   switch (Def->kind()) {
@@ -630,7 +670,7 @@ Optional<coff_symbol16> Writer::createSymbol(Defined *Def) {
   StringRef Name = Def->getName();
   if (Name.size() > COFF::NameSize) {
     Sym.Name.Offset.Zeroes = 0;
-    Sym.Name.Offset.Offset = addEntryToStringTable(Name);
+    Sym.Name.Offset.Offset = 0;
   } else {
     memset(Sym.Name.ShortName, 0, COFF::NameSize);
     memcpy(Sym.Name.ShortName, Name.data(), Name.size());
@@ -665,19 +705,8 @@ void Writer::createSymbolAndStringTable() {
     Sec->setStringTableOff(addEntryToStringTable(Sec->Name));
   }
 
-  if (Config->DebugDwarf) {
-    for (ObjFile *File : ObjFile::Instances) {
-      for (Symbol *B : File->getSymbols()) {
-        auto *D = dyn_cast_or_null<Defined>(B);
-        if (!D || D->WrittenToSymtab)
-          continue;
-        D->WrittenToSymtab = true;
-
-        if (Optional<coff_symbol16> Sym = createSymbol(D))
-          OutputSymtab.push_back(*Sym);
-      }
-    }
-  }
+  if (Config->DebugDwarf)
+    addDefinedSymbols();
 
   if (OutputSymtab.empty() && Strtab.empty())
     return;
@@ -690,6 +719,109 @@ void Writer::createSymbolAndStringTable() {
   FileSize = alignTo(FileOff, SectorSize);
 }
 
+// Adds the defined symbols of all object files to the symbol table. The
+// files are converted in parallel, and the long names are deduplicated in a
+// fixed number of shards by hash, so that the output does not depend on the
+// number of threads.
+void Writer::addDefinedSymbols() {
+  // A global symbol is in the symbol lists of all files that refer to it,
+  // but it is written only once, for the first of them, so which file
+  // writes which symbol is decided in file order. This is cheap compared
+  // to converting the symbols.
+  std::vector<ObjFile *> &Files = ObjFile::Instances;
+  std::vector<std::vector<Defined *>> Defs(Files.size());
+  for (size_t I = 0, E = Files.size(); I != E; ++I) {
+    for (Symbol *B : Files[I]->getSymbols()) {
+      auto *D = dyn_cast_or_null<Defined>(B);
+      if (!D || D->WrittenToSymtab)
+        continue;
+      D->WrittenToSymtab = true;
+      Defs[I].push_back(D);
+    }
+  }
+
+  struct LongName {
+    CachedHashStringRef Name;
+    coff_symbol16 *Sym;
+  };
+
+  // LongNames[I * NumShards + J] holds the names of file I in shard J.
+  const size_t NumShards = 32;
+  std::vector<std::vector<coff_symbol16>> Syms(Files.size());
+  std::vector<std::vector<LongName>> LongNames(Files.size() * NumShards);
+
+  parallelForEachN(0, Files.size(), [&](size_t I) {
+    // Reserved so that the pointers in LongNames stay valid.
+    Syms[I].reserve(Defs[I].size());
+    for (Defined *D : Defs[I]) {
+      Optional<coff_symbol16> Sym = createSymbol(D);
+      if (!Sym)
+        continue;
+      Syms[I].push_back(*Sym);
+
+      StringRef Name = D->getName();
+      if (Name.size() <= COFF::NameSize)
+        continue;
+      CachedHashStringRef H(Name);
+      LongNames[I * NumShards + H.hash() % NumShards].push_back(
+          {H, &Syms[I].back()});
+    }
+  });
+
+  // Give each unique name an offset from the start of its shard, in the
+  // order the names are first seen.
+  std::vector<std::vector<StringRef>> Unique(NumShards);
+  std::vector<size_t> ShardOff(NumShards);
+  parallelForEachN(0, NumShards, [&](size_t J) {
+    DenseMap<CachedHashStringRef, uint32_t> Offsets;
+    size_t Size = 0;
+    for (size_t I = 0, E = Files.size(); I != E; ++I) {
+      for (LongName &L : LongNames[I * NumShards + J]) {
+        auto P = Offsets.insert({L.Name, Size});
+        if (P.second) {
+          Unique[J].push_back(L.Name.val());
+          Size += L.Name.size() + 1;
+        }
+        L.Sym->Name.Offset.Offset = P.first->second;
+      }
+    }
+    ShardOff[J] = Size;
+  });
+
+  // The shards follow the section names in the string table.
+  size_t Off = Strtab.size();
+  for (size_t &X : ShardOff) {
+    size_t Size = X;
+    X = Off;
+    Off += Size;
+  }
+  Strtab.resize(Off);
+
+  parallelForEachN(0, NumShards, [&](size_t J) {
+    char *Buf = Strtab.data() + ShardOff[J];
+    for (StringRef S : Unique[J]) {
+      memcpy(Buf, S.data(), S.size());
+      Buf[S.size()] = '\0';
+      Buf += S.size() + 1;
+    }
+    // +4 for the size field
+    for (size_t I = 0, E = Files.size(); I != E; ++I)
+      for (LongName &L : LongNames[I * NumShards + J])
+        L.Sym->Name.Offset.Offset += ShardOff[J] + 4;
+  });
+
+  std::vector<size_t> SymOff(Files.size());
+  size_t NumSyms = OutputSymtab.size();
+  for (size_t I = 0, E = Files.size(); I != E; ++I) {
+    SymOff[I] = NumSyms;
+    NumSyms += Syms[I].size();
+  }
+  OutputSymtab.resize(NumSyms);
+  parallelForEachN(0, Files.size(), [&](size_t I) {
+    std::copy(Syms[I].begin(), Syms[I].end(), OutputSymtab.begin() + SymOff[I]);
+  });
+}
+
 void Writer::mergeSections() {
   if (!PdataSec->getChunks().empty()) {
     FirstPdata = PdataSec->getChunks().front();
@@ -743,7 +875,9 @@ void Writer::assignAddresses() {
       C->setRVA(RVA + VirtualSize);
       C->OutputSectionOff = VirtualSize;
       C->finalizeContents();
-      VirtualSize += C->getSize();
+      // With /incremental, leave room for the chunk to grow in later links.
+      VirtualSize += Config->IncrementalLayout ? getIncrementalSlotSize(C)
+                                               : C->getSize();
       if (C->hasData())
         RawSize = alignTo(VirtualSize, SectorSize);
     }
@@ -953,6 +1087,17 @@ template <typename PEHeaderTy> void Writer::writeHeader() {
 }
 
 void Writer::openFile(StringRef Path) {
+  OutputBufferBytes = FileSize;
+
+  // With /incremental, the existing output is compared with the new one so
+  // that only the pages that changed are written.
+  if (Config->IncrementalLayout) {
+    Buffer = CHECK(InPlaceOutputBuffer::create(
+                       Path, FileSize, FileOutputBuffer::F_executable),
+                   "failed to open " + Path);
+    return;
+  }
+
   Buffer = CHECK(
       FileOutputBuffer::create(Path, FileSize, FileOutputBuffer::F_executable),
       "failed to open " + Path);
@@ -1025,21 +1170,33 @@ static void markSymbolsWithRelocations(ObjFile *File,
 // address-taken functions. It is sorted and uniqued, just like the safe SEH
 // table.
 void Writer::createGuardCFTables() {
-  SymbolRVASet AddressTakenSyms;
-  SymbolRVASet LongJmpTargets;
-  for (ObjFile *File : ObjFile::Instances) {
+  // The objects are scanned in parallel into sets of their own, which are
+  // then merged in input order.
+  std::vector<SymbolRVASet> FileAddressTakenSyms(ObjFile::Instances.size());
+  std::vector<SymbolRVASet> FileLongJmpTargets(ObjFile::Instances.size());
+  parallelForEachN(0, ObjFile::Instances.size(), [&](size_t I) {
+    ObjFile *File = ObjFile::Instances[I];
     // If the object was compiled with /guard:cf, the address taken symbols
     // are in .gfids$y sections, and the longjmp targets are in .gljmp$y
     // sections. If the object was not compiled with /guard:cf, we assume there
     // were no setjmp targets, and that all code symbols with relocations are
     // possibly address-taken.
     if (File->hasGuardCF()) {
-      markSymbolsForRVATable(File, File->getGuardFidChunks(), AddressTakenSyms);
-      markSymbolsForRVATable(File, File->getGuardLJmpChunks(), LongJmpTargets);
+      markSymbolsForRVATable(File, File->getGuardFidChunks(),
+                             FileAddressTakenSyms[I]);
+      markSymbolsForRVATable(File, File->getGuardLJmpChunks(),
+                             FileLongJmpTargets[I]);
     } else {
-      markSymbolsWithRelocations(File, AddressTakenSyms);
+      markSymbolsWithRelocations(File, FileAddressTakenSyms[I]);
     }
-  }
+  });
+
+  SymbolRVASet AddressTakenSyms;
+  SymbolRVASet LongJmpTargets;
+  for (SymbolRVASet &S : FileAddressTakenSyms)
+    AddressTakenSyms.insert(S.begin(), S.end());
+  for (SymbolRVASet &S : FileLongJmpTargets)
+    LongJmpTargets.insert(S.begin(), S.end());
 
   // Mark the image entry as address-taken.
   if (Config->Entry)
@@ -1139,17 +1296,44 @@ void Writer::writeSections() {
   // against absolute symbols. See applySecIdx in Chunks.cpp..
   DefinedAbsolute::NumOutputSections = OutputSections.size();
 
+  // The chunks of all sections are written in a single parallel loop, so
+  // that small sections do not each wait for their slowest chunk.
+  struct ChunkWrite {
+    Chunk *C;
+    uint8_t *SecBuf;
+    // For code sections, the end of the gap after the chunk, relative to
+    // SecBuf. Zero for other sections.
+    uint64_t GapEnd;
+  };
+  std::vector<ChunkWrite> Writes;
+
   uint8_t *Buf = Buffer->getBufferStart();
   for (OutputSection *Sec : OutputSections) {
     uint8_t *SecBuf = Buf + Sec->getFileOff();
+    bool IsCode = Sec->Header.Characteristics & IMAGE_SCN_CNT_CODE;
+    ArrayRef<Chunk *> Chunks = Sec->getChunks();
+    for (size_t I = 0, E = Chunks.size(); I != E; ++I) {
+      uint64_t GapEnd = 0;
+      if (IsCode)
+        GapEnd = std::min<uint64_t>(
+            I + 1 == E ? Sec->getRawSize() : Chunks[I + 1]->OutputSectionOff,
+            Sec->getRawSize());
+      Writes.push_back({Chunks[I], SecBuf, GapEnd});
+    }
+  }
+
+  parallelForEach(Writes, [](const ChunkWrite &W) {
+    W.C->writeTo(W.SecBuf);
+
     // Fill gaps between functions in .text with INT3 instructions
     // instead of leaving as NUL bytes (which can be interpreted as
-    // ADD instructions).
-    if (Sec->Header.Characteristics & IMAGE_SCN_CNT_CODE)
-      memset(SecBuf, 0xCC, Sec->getRawSize());
-    for_each(parallel::par, Sec->getChunks().begin(), Sec->getChunks().end(),
-             [&](Chunk *C) { C->writeTo(SecBuf); });
-  }
+    // ADD instructions). Chunks without data are gaps too.
+    uint64_t GapBegin = W.C->OutputSectionOff;
+    if (W.C->hasData())
+      GapBegin += W.C->getSize();
+    if (GapBegin < W.GapEnd)
+      memset(W.SecBuf + GapBegin, 0xCC, W.GapEnd - GapBegin);
+  }, 16);
 }
 
 void Writer::writeBuildId() {
@@ -1214,14 +1398,18 @@ void Writer::sortExceptionTable() {
   uint8_t *End = BufAddr(LastPdata) + LastPdata->getSize();
   if (Config->Machine == AMD64) {
     struct Entry { ulittle32_t Begin, End, Unwind; };
-    sort(parallel::par, (Entry *)Begin, (Entry *)End,
-         [](const Entry &A, const Entry &B) { return A.Begin < B.Begin; });
+    parallelSort((Entry *)Begin, (Entry *)End,
+                 [](const Entry &A, const Entry &B) {
+                   return A.Begin < B.Begin;
+                 });
     return;
   }
   if (Config->Machine == ARMNT || Config->Machine == ARM64) {
     struct Entry { ulittle32_t Begin, Unwind; };
-    sort(parallel::par, (Entry *)Begin, (Entry *)End,
-         [](const Entry &A, const Entry &B) { return A.Begin < B.Begin; });
+    parallelSort((Entry *)Begin, (Entry *)End,
+                 [](const Entry &A, const Entry &B) {
+                   return A.Begin < B.Begin;
+                 });
     return;
   }
   errs() << "warning: don't know how to handle .pdata.\n";
@@ -1246,22 +1434,45 @@ uint32_t Writer::getSizeOfInitializedData() {
 void Writer::addBaserels() {
   if (!Config->Relocatable)
     return;
-  std::vector<Baserel> V;
+
+  // Collect all locations for base relocations, one chunk per task.
+  std::vector<Chunk *> Chunks;
+  std::vector<size_t> SectionEnds;
   for (OutputSection *Sec : OutputSections) {
     if (Sec == RelocSec)
       continue;
-    // Collect all locations for base relocations.
-    for (Chunk *C : Sec->getChunks())
-      C->getBaserels(&V);
+    Chunks.insert(Chunks.end(), Sec->getChunks().begin(),
+                  Sec->getChunks().end());
+    SectionEnds.push_back(Chunks.size());
+  }
+  std::vector<std::vector<Baserel>> ChunkBaserels(Chunks.size());
+  parallelForEachN(0, Chunks.size(), [&](size_t I) {
+    Chunks[I]->getBaserels(&ChunkBaserels[I]);
+  }, 64);
+
+  // Concatenate them. The vector must not be reallocated after that, as the
+  // chunks of .reloc point into it.
+  size_t Total = 0;
+  for (const std::vector<Baserel> &V : ChunkBaserels)
+    Total += V.size();
+  Baserels.reserve(Total);
+
+  size_t I = 0;
+  for (size_t End : SectionEnds) {
+    size_t Begin = Baserels.size();
+    for (; I != End; ++I)
+      Baserels.insert(Baserels.end(), ChunkBaserels[I].begin(),
+                      ChunkBaserels[I].end());
     // Add the addresses to .reloc section.
-    if (!V.empty())
-      addBaserelBlocks(V);
-    V.clear();
+    if (Baserels.size() != Begin)
+      addBaserelBlocks(makeArrayRef(Baserels).slice(Begin));
   }
 }
 
 // Add addresses to .reloc section. Note that addresses are grouped by page.
-void Writer::addBaserelBlocks(std::vector<Baserel> &V) {
+// The blocks are encoded when the section is written, which is done in
+// parallel.
+void Writer::addBaserelBlocks(ArrayRef<Baserel> V) {
   const uint32_t Mask = ~uint32_t(PageSize - 1);
   uint32_t Page = V[0].RVA & Mask;
   size_t I = 0, J = 1;
@@ -9,10 +9,12 @@
 
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Option/ArgList.h"
+#include "llvm/Support/ConvertUTF.h"
 
 using namespace llvm;
 using namespace lld;
@@ -64,3 +66,110 @@ std::vector<StringRef> lld::args::getLines(MemoryBufferRef MB) {
   }
   return Ret;
 }
+
+static bool isWhitespace(char C) {
+  return C == ' ' || C == '\t' || C == '\r' || C == '\n';
+}
+
+// Splits [P, E) into arguments with the rules of cl::TokenizeGNUCommandLine.
+// Each argument is unquoted over its own bytes and terminated by a NUL,
+// which fits because unquoting never makes an argument longer. E must be
+// writable for the NUL after the last argument.
+static void tokenizeGNUInPlace(char *P, char *E,
+                               SmallVectorImpl<const char *> &Out) {
+  for (;;) {
+    while (P != E && isWhitespace(*P))
+      ++P;
+    if (P == E)
+      return;
+
+    char *Begin = P;
+    char *W = P;
+    while (P != E && !isWhitespace(*P)) {
+      // A backslash escapes the next character.
+      if (*P == '\\' && P + 1 != E) {
+        *W++ = P[1];
+        P += 2;
+        continue;
+      }
+
+      // Copy a quoted string without its quotes.
+      if (*P == '"' || *P == '\'') {
+        char Quote = *P++;
+        while (P != E && *P != Quote) {
+          if (*P == '\\' && P + 1 != E)
+            ++P;
+          *W++ = *P++;
+        }
+        if (P != E)
+          ++P;
+        continue;
+      }
+
+      *W++ = *P++;
+    }
+
+    // Step over the whitespace that ended the argument before W, which is
+    // never past P, overwrites it.
+    if (P != E)
+      ++P;
+    if (W == Begin)
+      continue;
+    *W = '\0';
+    Out.push_back(Begin);
+  }
+}
+
+// Reads Path and appends its arguments to Out. Returns false if the file
+// cannot be read.
+static bool expandResponseFile(StringRef Path,
+                               cl::TokenizerCallback Tokenizer,
+                               SmallVectorImpl<const char *> &Out) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(Path, -1, false);
+  if (!MBOrErr)
+    return false;
+  StringRef Data = (*MBOrErr)->getBuffer();
+
+  // Other quoting styles, and UTF-16 files, which need to be converted to
+  // UTF-8 first, are left to the generic code.
+  if (Tokenizer != cl::TokenizeGNUCommandLine ||
+      hasUTF16ByteOrderMark(makeArrayRef(Data.data(), Data.size()))) {
+    SmallVector<const char *, 1> Argv = {Saver.save("@" + Path).data()};
+    cl::ExpandResponseFiles(Saver, Tokenizer, Argv);
+    if (Argv.size() == 1 && Argv[0][0] == '@')
+      return false;
+    Out.append(Argv.begin(), Argv.end());
+    return true;
+  }
+
+  if (Data.startswith("\xef\xbb\xbf"))
+    Data = Data.drop_front(3);
+  char *Buf = BAlloc.Allocate<char>(Data.size() + 1);
+  memcpy(Buf, Data.data(), Data.size());
+  tokenizeGNUInPlace(Buf, Buf + Data.size(), Out);
+  return true;
+}
+
+void lld::args::expandResponseFiles(cl::TokenizerCallback Tokenizer,
+                                    SmallVectorImpl<const char *> &Argv) {
+  // Like cl::ExpandResponseFiles, give up after 20 files so that a file
+  // that includes itself does not make us loop forever.
+  unsigned NumFiles = 0;
+  for (size_t I = 0; I != Argv.size();) {
+    if (Argv[I][0] != '@') {
+      ++I;
+      continue;
+    }
+    if (NumFiles++ > 20)
+      return;
+
+    SmallVector<const char *, 0> Expanded;
+    if (!expandResponseFile(Argv[I] + 1, Tokenizer, Expanded)) {
+      ++I;
+      continue;
+    }
+    Argv.erase(Argv.begin() + I);
+    Argv.insert(Argv.begin() + I, Expanded.begin(), Expanded.end());
+  }
+}
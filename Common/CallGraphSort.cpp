@@ -0,0 +1,428 @@
+//===- CallGraphSort.cpp --------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// Implementation of Call-Chain Clustering from: Optimizing Function Placement
+/// for Large-Scale Data-Center Applications
+/// https://research.fb.com/wp-content/uploads/2017/01/cgo2017-hfsort-final1.pdf
+///
+/// The goal of this algorithm is to improve runtime performance of the final
+/// executable by arranging code sections such that page table and i-cache
+/// misses are minimized.
+///
+/// Definitions:
+/// * Cluster
+///   * An ordered list of input sections which are layed out as a unit. At the
+///     beginning of the algorithm each input section has its own cluster and
+///     the weight of the cluster is the sum of the weight of all incomming
+///     edges.
+/// * Call-Chain Clustering (C³) Heuristic
+///   * Defines when and how clusters are combined. Pick the highest weighted
+///     input section then add it to its most likely predecessor if it wouldn't
+///     penalize it too much.
+/// * Density
+///   * The weight of the cluster divided by the size of the cluster. This is a
+///     proxy for the amount of execution time spent per byte of the cluster.
+///
+/// It does so given a call graph profile by the following:
+/// * Build a weighted call graph from the call graph profile
+/// * Sort input sections by weight
+/// * For each input section starting with the highest weight
+///   * Find its most likely predecessor cluster
+///   * Check if the combined cluster would be too large, or would have too low
+///     a density.
+///   * If not, then combine the clusters.
+/// * Sort non-empty clusters by density
+///
+/// --call-graph-sort=hfsort+ selects a variant of the algorithm described in
+/// the same paper that models the i-TLB directly. It scores a layout as the
+/// sum over all calls of the call count times the chance that the call stays
+/// within a page (--call-graph-page-size), which falls linearly from one for
+/// a callee right after the call site to zero at a distance of one page. It
+/// then repeatedly merges the pair of clusters, in whichever order, whose
+/// merge increases that score the most, until no merge improves it. It is
+/// slower than C³ but usually finds a better layout when there are many
+/// calls between functions that are not each other's hottest caller.
+///
+/// Both algorithms keep clusters below --call-graph-cluster-size, which can
+/// be raised to 2 MiB to fill huge pages, and the score of the final layout
+/// is reported by --print-stats as the fraction of calls expected to stay on
+/// a page.
+///
+/// The option names above are those of ld.lld. lld-link uses the same
+/// clustering for /call-graph-ordering-file and .llvm.call-graph-profile
+/// sections, with the default cluster and page sizes.
+///
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/CallGraphSort.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include <algorithm>
+#include <queue>
+
+using namespace llvm;
+using namespace lld;
+
+namespace {
+struct Edge {
+  int From;
+  uint64_t Weight;
+};
+
+struct Cluster {
+  Cluster(int Sec, size_t S) {
+    Sections.push_back(Sec);
+    Size = S;
+  }
+
+  double getDensity() const {
+    if (Size == 0)
+      return 0;
+    return double(Weight) / double(Size);
+  }
+
+  std::vector<int> Sections;
+  size_t Size = 0;
+  uint64_t Weight = 0;
+  uint64_t InitialWeight = 0;
+  std::vector<Edge> Preds;
+};
+
+class CallGraphSort {
+public:
+  CallGraphSort(ArrayRef<uint64_t> Sizes, ArrayRef<CallGraphArc> Arcs,
+                const CallGraphSortOptions &Opts);
+
+  std::vector<int> run(double *Locality);
+
+private:
+  std::vector<Cluster> Clusters;
+  ArrayRef<uint64_t> Sizes;
+  std::vector<CallGraphArc> Arcs;
+  const CallGraphSortOptions &Opts;
+
+  void groupClusters();
+  void groupClustersHfsortPlus();
+  void sortClusters();
+  double getLocality();
+};
+
+// Maximum amount the combined cluster density can be worse than the original
+// cluster to consider merging.
+constexpr int MAX_DENSITY_DEGRADATION = 8;
+} // end anonymous namespace
+
+// Generate a graph between the sections from the arcs, with one cluster per
+// section.
+CallGraphSort::CallGraphSort(ArrayRef<uint64_t> Sizes,
+                             ArrayRef<CallGraphArc> Profile,
+                             const CallGraphSortOptions &Opts)
+    : Sizes(Sizes), Opts(Opts) {
+  for (size_t I = 0, E = Sizes.size(); I != E; ++I)
+    Clusters.emplace_back(I, Sizes[I]);
+
+  for (const CallGraphArc &A : Profile) {
+    Clusters[A.To].Weight += A.Weight;
+
+    if (A.From == A.To)
+      continue;
+
+    // Add an edge
+    Clusters[A.To].Preds.push_back({A.From, A.Weight});
+    Arcs.push_back(A);
+  }
+  for (Cluster &C : Clusters)
+    C.InitialWeight = C.Weight;
+}
+
+// It's bad to merge clusters which would degrade the density too much.
+static bool isNewDensityBad(Cluster &A, Cluster &B) {
+  double NewDensity = double(A.Weight + B.Weight) / double(A.Size + B.Size);
+  if (NewDensity < A.getDensity() / MAX_DENSITY_DEGRADATION)
+    return true;
+  return false;
+}
+
+static void mergeClusters(Cluster &Into, Cluster &From) {
+  Into.Sections.insert(Into.Sections.end(), From.Sections.begin(),
+                       From.Sections.end());
+  Into.Size += From.Size;
+  Into.Weight += From.Weight;
+  From.Sections.clear();
+  From.Size = 0;
+  From.Weight = 0;
+}
+
+// Group sections into clusters using the Call-Chain Clustering heuristic
+// then sort the clusters by density.
+void CallGraphSort::groupClusters() {
+  std::vector<int> SortedSecs(Clusters.size());
+  std::vector<Cluster *> SecToCluster(Clusters.size());
+
+  for (int SI = 0, SE = Clusters.size(); SI != SE; ++SI) {
+    SortedSecs[SI] = SI;
+    SecToCluster[SI] = &Clusters[SI];
+  }
+
+  std::stable_sort(SortedSecs.begin(), SortedSecs.end(), [&](int A, int B) {
+    return Clusters[B].getDensity() < Clusters[A].getDensity();
+  });
+
+  for (int SI : SortedSecs) {
+    // Clusters[SI] is the same as SecToClusters[SI] here because it has not
+    // been merged into another cluster yet.
+    Cluster &C = Clusters[SI];
+
+    int BestPred = -1;
+    uint64_t BestWeight = 0;
+
+    for (Edge &E : C.Preds) {
+      if (BestPred == -1 || E.Weight > BestWeight) {
+        BestPred = E.From;
+        BestWeight = E.Weight;
+      }
+    }
+
+    // don't consider merging if the edge is unlikely.
+    if (BestWeight * 10 <= C.InitialWeight)
+      continue;
+
+    Cluster *PredC = SecToCluster[BestPred];
+    if (PredC == &C)
+      continue;
+
+    if (C.Size + PredC->Size > Opts.ClusterSize)
+      continue;
+
+    if (isNewDensityBad(*PredC, C))
+      continue;
+
+    // NOTE: Consider using a disjoint-set to track section -> cluster mapping
+    // if this is ever slow.
+    for (int SI : C.Sections)
+      SecToCluster[SI] = PredC;
+
+    mergeClusters(*PredC, C);
+  }
+
+  sortClusters();
+}
+
+// Remove empty clusters and sort the rest by density. Invalidates all cluster
+// indices.
+void CallGraphSort::sortClusters() {
+  llvm::erase_if(Clusters, [](const Cluster &C) {
+    return C.Size == 0 || C.Sections.empty();
+  });
+
+  std::stable_sort(Clusters.begin(), Clusters.end(),
+                   [](const Cluster &A, const Cluster &B) {
+                     return A.getDensity() > B.getDensity();
+                   });
+}
+
+// Returns the expected number of calls along an arc that stay within a page,
+// given the offsets of the caller and the callee. The call site is assumed to
+// be in the middle of the caller.
+static double getArcScore(uint64_t Weight, uint64_t CallerOff,
+                          uint64_t CallerSize, uint64_t CalleeOff,
+                          uint64_t PageSize) {
+  uint64_t Src = CallerOff + CallerSize / 2;
+  uint64_t Dist = Src > CalleeOff ? Src - CalleeOff : CalleeOff - Src;
+  if (Dist >= PageSize)
+    return 0;
+  return Weight * (1 - double(Dist) / PageSize);
+}
+
+namespace {
+// A merge of two clusters considered by groupClustersHfsortPlus. The
+// versions tell whether either cluster has changed since it was evaluated.
+struct MergeCandidate {
+  double Gain;
+  int A;
+  int B;
+  bool AFirst;
+  unsigned VersionA;
+  unsigned VersionB;
+};
+
+struct CandidateLess {
+  bool operator()(const MergeCandidate &X, const MergeCandidate &Y) const {
+    if (X.Gain != Y.Gain)
+      return X.Gain < Y.Gain;
+    return std::make_pair(X.A, X.B) > std::make_pair(Y.A, Y.B);
+  }
+};
+} // end anonymous namespace
+
+// Group sections into clusters by greedily merging the pair of clusters
+// that most improves the i-TLB score of the layout, then sort the clusters by
+// density.
+void CallGraphSort::groupClustersHfsortPlus() {
+  size_t N = Clusters.size();
+  std::vector<std::vector<int>> OutArcs(N);
+  std::vector<std::vector<int>> Neighbors(N);
+  for (size_t I = 0, E = Arcs.size(); I != E; ++I) {
+    OutArcs[Arcs[I].From].push_back(I);
+    Neighbors[Arcs[I].From].push_back(Arcs[I].To);
+    Neighbors[Arcs[I].To].push_back(Arcs[I].From);
+  }
+  for (std::vector<int> &V : Neighbors) {
+    llvm::sort(V.begin(), V.end());
+    V.erase(std::unique(V.begin(), V.end()), V.end());
+  }
+
+  std::vector<double> Score(N, 0);
+  std::vector<unsigned> Version(N, 0);
+  std::vector<int64_t> Offset(N, -1);
+
+  // Returns the score of the arcs within Front and Back laid out one after
+  // the other.
+  auto GetScore = [&](ArrayRef<int> Front, ArrayRef<int> Back) {
+    uint64_t Off = 0;
+    for (ArrayRef<int> Secs : {Front, Back}) {
+      for (int S : Secs) {
+        Offset[S] = Off;
+        Off += Sizes[S];
+      }
+    }
+
+    double Ret = 0;
+    for (ArrayRef<int> Secs : {Front, Back}) {
+      for (int S : Secs) {
+        for (int AI : OutArcs[S]) {
+          const CallGraphArc &E = Arcs[AI];
+          if (Offset[E.To] != -1)
+            Ret += getArcScore(E.Weight, Offset[S], Sizes[S], Offset[E.To],
+                               Opts.PageSize);
+        }
+      }
+    }
+
+    for (ArrayRef<int> Secs : {Front, Back})
+      for (int S : Secs)
+        Offset[S] = -1;
+    return Ret;
+  };
+
+  std::priority_queue<MergeCandidate, std::vector<MergeCandidate>,
+                      CandidateLess>
+      Queue;
+
+  auto AddCandidate = [&](int A, int B) {
+    Cluster &CA = Clusters[A];
+    Cluster &CB = Clusters[B];
+    if (CA.Size + CB.Size > Opts.ClusterSize)
+      return;
+    double AB = GetScore(CA.Sections, CB.Sections);
+    double BA = GetScore(CB.Sections, CA.Sections);
+    double Gain = std::max(AB, BA) - Score[A] - Score[B];
+    if (Gain > 0)
+      Queue.push({Gain, A, B, AB >= BA, Version[A], Version[B]});
+  };
+
+  for (size_t A = 0; A != N; ++A)
+    for (int B : Neighbors[A])
+      if ((int)A < B)
+        AddCandidate(A, B);
+
+  while (!Queue.empty()) {
+    MergeCandidate M = Queue.top();
+    Queue.pop();
+    if (M.VersionA != Version[M.A] || M.VersionB != Version[M.B])
+      continue;
+
+    // Merge B into A.
+    Cluster &CA = Clusters[M.A];
+    Cluster &CB = Clusters[M.B];
+    if (M.AFirst)
+      CA.Sections.insert(CA.Sections.end(), CB.Sections.begin(),
+                         CB.Sections.end());
+    else
+      CA.Sections.insert(CA.Sections.begin(), CB.Sections.begin(),
+                         CB.Sections.end());
+    CA.Size += CB.Size;
+    CA.Weight += CB.Weight;
+    CB.Sections.clear();
+    CB.Size = 0;
+    CB.Weight = 0;
+    Score[M.A] += Score[M.B] + M.Gain;
+    ++Version[M.A];
+    ++Version[M.B];
+
+    // A inherits the neighbors of B.
+    std::vector<int> &NA = Neighbors[M.A];
+    for (int X : Neighbors[M.B]) {
+      if (X == M.A)
+        continue;
+      NA.push_back(X);
+      std::vector<int> &NX = Neighbors[X];
+      std::replace(NX.begin(), NX.end(), M.B, M.A);
+      llvm::sort(NX.begin(), NX.end());
+      NX.erase(std::unique(NX.begin(), NX.end()), NX.end());
+    }
+    Neighbors[M.B].clear();
+    llvm::erase_if(NA, [&](int X) { return X == M.B; });
+    llvm::sort(NA.begin(), NA.end());
+    NA.erase(std::unique(NA.begin(), NA.end()), NA.end());
+
+    for (int X : NA)
+      AddCandidate(std::min(M.A, X), std::max(M.A, X));
+  }
+
+  sortClusters();
+}
+
+// Returns the fraction of calls in the profile that are expected to stay
+// within a page in the final layout, ignoring alignment padding.
+double CallGraphSort::getLocality() {
+  std::vector<uint64_t> Offset(Sizes.size());
+  uint64_t Off = 0;
+  for (const Cluster &C : Clusters) {
+    for (int S : C.Sections) {
+      Offset[S] = Off;
+      Off += Sizes[S];
+    }
+  }
+
+  double Score = 0;
+  uint64_t Total = 0;
+  for (const CallGraphArc &E : Arcs) {
+    Score += getArcScore(E.Weight, Offset[E.From], Sizes[E.From], Offset[E.To],
+                         Opts.PageSize);
+    Total += E.Weight;
+  }
+  return Total ? Score / Total : 1;
+}
+
+std::vector<int> CallGraphSort::run(double *Locality) {
+  if (Opts.Kind == CallGraphSortKind::HfsortPlus)
+    groupClustersHfsortPlus();
+  else
+    groupClusters();
+  if (Locality)
+    *Locality = getLocality();
+
+  std::vector<int> Order;
+  for (const Cluster &C : Clusters)
+    Order.insert(Order.end(), C.Sections.begin(), C.Sections.end());
+  return Order;
+}
+
+// Sort sections by a call graph profile.
+//
+// This first builds a call graph from the profile then merges sections
+// according to the C³ or hfsort+ heuristic. All clusters are then sorted by a
+// density metric to further improve locality.
+std::vector<int> lld::sortCallGraph(ArrayRef<uint64_t> Sizes,
+                                    ArrayRef<CallGraphArc> Arcs,
+                                    const CallGraphSortOptions &Opts,
+                                    double *Locality) {
+  return CallGraphSort(Sizes, Arcs, Opts).run(Locality);
+}
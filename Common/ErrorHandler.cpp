@@ -9,11 +9,13 @@
 
 #include "lld/Common/ErrorHandler.h"
 
+#include "lld/Common/Reproduce.h"
 #include "lld/Common/Threads.h"
 
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 #include <mutex>
@@ -29,6 +31,9 @@ using namespace lld;
 // but outs() or errs() are not thread-safe. We protect them using a mutex.
 static std::mutex Mu;
 
+// The buffer diagnostics reported on this thread go to, if any.
+static LLVM_THREAD_LOCAL DiagnosticBuffer *CurrentBuffer;
+
 // Prints "\n" or does nothing, depending on Msg contents of
 // the previous call of this function.
 static void newline(raw_ostream *ErrorOS, const Twine &Msg) {
@@ -50,6 +55,9 @@ void lld::exitLld(int Val) {
   // Delete the output buffer so that any tempory file is deleted.
   errorHandler().OutputBuffer.reset();
 
+  // Write out the files queued for --reproduce.
+  finishTarWriters();
+
   // Dealloc/destroy ManagedStatic variables before calling
   // _exit(). In a non-LTO build, this is a nop. In an LTO
   // build allows us to get the output of -time-passes.
@@ -84,17 +92,79 @@ void ErrorHandler::print(StringRef S, raw_ostream::Colors C) {
   }
 }
 
-void ErrorHandler::log(const Twine &Msg) {
-  if (Verbose) {
-    std::lock_guard<std::mutex> Lock(Mu);
+void DiagnosticBuffer::install() {
+  Prev = CurrentBuffer;
+  CurrentBuffer = this;
+}
+
+void DiagnosticBuffer::uninstall() {
+  assert(CurrentBuffer == this);
+  CurrentBuffer = Prev;
+  Prev = nullptr;
+}
+
+void DiagnosticBuffer::flush() {
+  for (const Diag &D : Diags)
+    errorHandler().report(D.K, D.Msg);
+  Diags.clear();
+  NumErrors = 0;
+}
+
+// Prints a diagnostic, or keeps it in the buffer of the calling thread.
+void ErrorHandler::report(DiagnosticBuffer::Kind K, const Twine &Msg) {
+  if (DiagnosticBuffer *B = CurrentBuffer) {
+    // Buffers are printed one after another, so at most ErrorLimit errors
+    // and the limit message can come from any one buffer. The rest would
+    // not be printed anyway and are not kept.
+    if (K == DiagnosticBuffer::Kind::Error && ErrorLimit != 0 &&
+        B->NumErrors++ > ErrorLimit)
+      return;
+    B->Diags.push_back({K, Msg.str()});
+    return;
+  }
+
+  std::lock_guard<std::mutex> Lock(Mu);
+  emit(K, Msg);
+}
+
+// Prints a diagnostic. Mu must be held.
+void ErrorHandler::emit(DiagnosticBuffer::Kind K, const Twine &Msg) {
+  switch (K) {
+  case DiagnosticBuffer::Kind::Log:
     *ErrorOS << LogName << ": " << Msg << "\n";
+    return;
+  case DiagnosticBuffer::Kind::Message:
+    outs() << Msg << "\n";
+    outs().flush();
+    return;
+  case DiagnosticBuffer::Kind::Warning:
+    newline(ErrorOS, Msg);
+    print("warning: ", raw_ostream::MAGENTA);
+    *ErrorOS << Msg << "\n";
+    return;
+  case DiagnosticBuffer::Kind::Error:
+    newline(ErrorOS, Msg);
+    if (ErrorLimit == 0 || PrintedErrors < ErrorLimit) {
+      print("error: ", raw_ostream::RED);
+      *ErrorOS << Msg << "\n";
+    } else if (PrintedErrors == ErrorLimit) {
+      print("error: ", raw_ostream::RED);
+      *ErrorOS << ErrorLimitExceededMsg << "\n";
+      if (ExitEarly)
+        exitLld(1);
+    }
+    ++PrintedErrors;
+    return;
   }
 }
 
+void ErrorHandler::log(const Twine &Msg) {
+  if (Verbose)
+    report(DiagnosticBuffer::Kind::Log, Msg);
+}
+
 void ErrorHandler::message(const Twine &Msg) {
-  std::lock_guard<std::mutex> Lock(Mu);
-  outs() << Msg << "\n";
-  outs().flush();
+  report(DiagnosticBuffer::Kind::Message, Msg);
 }
 
 void ErrorHandler::warn(const Twine &Msg) {
@@ -102,31 +172,26 @@ void ErrorHandler::warn(const Twine &Msg) {
     error(Msg);
     return;
   }
-
-  std::lock_guard<std::mutex> Lock(Mu);
-  newline(ErrorOS, Msg);
-  print("warning: ", raw_ostream::MAGENTA);
-  *ErrorOS << Msg << "\n";
+  report(DiagnosticBuffer::Kind::Warning, Msg);
 }
 
 void ErrorHandler::error(const Twine &Msg) {
-  std::lock_guard<std::mutex> Lock(Mu);
-  newline(ErrorOS, Msg);
-
-  if (ErrorLimit == 0 || ErrorCount < ErrorLimit) {
-    print("error: ", raw_ostream::RED);
-    *ErrorOS << Msg << "\n";
-  } else if (ErrorCount == ErrorLimit) {
-    print("error: ", raw_ostream::RED);
-    *ErrorOS << ErrorLimitExceededMsg << "\n";
-    if (ExitEarly)
-      exitLld(1);
-  }
-
   ++ErrorCount;
+
+  // Once the limit message has been printed, no other error will be, so a
+  // flood of errors stops here without formatting them.
+  if (ErrorLimit != 0 && PrintedErrors > ErrorLimit)
+    return;
+  report(DiagnosticBuffer::Kind::Error, Msg);
 }
 
 void ErrorHandler::fatal(const Twine &Msg) {
-  error(Msg);
+  // Print the message right away, since a buffered one would be lost when
+  // the linker exits.
+  ++ErrorCount;
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    emit(DiagnosticBuffer::Kind::Error, Msg);
+  }
   exitLld(1);
 }
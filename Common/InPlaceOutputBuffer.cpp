@@ -0,0 +1,116 @@
+//===- InPlaceOutputBuffer.cpp --------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/InPlaceOutputBuffer.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+using namespace lld;
+
+Expected<std::unique_ptr<InPlaceOutputBuffer>>
+InPlaceOutputBuffer::create(StringRef Path, uint64_t Size, unsigned Flags) {
+  std::error_code EC;
+  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(
+      Size, nullptr, sys::Memory::MF_READ | sys::Memory::MF_WRITE, EC);
+  if (EC)
+    return errorCodeToError(EC);
+  return std::unique_ptr<InPlaceOutputBuffer>(new InPlaceOutputBuffer(
+      Path, sys::OwningMemoryBlock(MB), Size, Flags));
+}
+
+// Compares the new contents with the existing file page by page and writes
+// only the runs of pages that changed. Returns false if the file has to be
+// written from scratch.
+bool InPlaceOutputBuffer::updateInPlace() {
+  sys::fs::file_status St;
+  if (sys::fs::status(FinalPath, St) || !sys::fs::is_regular_file(St) ||
+      St.getSize() != Size)
+    return false;
+  if ((Flags & F_executable) && !(St.permissions() & sys::fs::owner_exe))
+    return false;
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> OldOrErr =
+      MemoryBuffer::getFile(FinalPath, -1, /*RequiresNullTerminator=*/false);
+  if (!OldOrErr)
+    return false;
+  const uint8_t *Old =
+      reinterpret_cast<const uint8_t *>((*OldOrErr)->getBufferStart());
+  const uint8_t *New = getBufferStart();
+
+  // Compare all pages before writing any of them, as the existing file may
+  // be mapped privately and would then reflect our own writes.
+  const size_t PageSize = 4096;
+  size_t NumPages = (Size + PageSize - 1) / PageSize;
+  std::vector<uint8_t> Dirty(NumPages);
+  parallelForEachN(0, NumPages, [&](size_t I) {
+    size_t Off = I * PageSize;
+    size_t Len = std::min<size_t>(PageSize, Size - Off);
+    Dirty[I] = memcmp(Old + Off, New + Off, Len) != 0;
+  });
+  OldOrErr->reset();
+
+  // A running executable cannot be opened for writing on most systems.
+  int FD;
+  if (sys::fs::openFileForWrite(FinalPath, FD, sys::fs::CD_OpenExisting,
+                                sys::fs::F_None))
+    return false;
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+
+  size_t NumDirty = 0;
+  for (size_t I = 0; I < NumPages;) {
+    if (!Dirty[I]) {
+      ++I;
+      continue;
+    }
+    size_t J = I;
+    while (J < NumPages && Dirty[J])
+      ++J;
+    size_t Off = I * PageSize;
+    size_t Len = std::min<size_t>(J * PageSize, Size) - Off;
+    OS.seek(Off);
+    OS.write(reinterpret_cast<const char *>(New + Off), Len);
+    NumDirty += J - I;
+    I = J;
+  }
+
+  // Build systems compare timestamps, so the file must look updated even
+  // if no page changed.
+  OS.flush();
+  sys::fs::setLastModificationAndAccessTime(FD,
+                                            std::chrono::system_clock::now());
+  OS.close();
+
+  // The file may now be partially updated, but rewriting it as a whole
+  // fixes that.
+  if (OS.has_error()) {
+    OS.clear_error();
+    return false;
+  }
+  log("updated " + Twine(NumDirty) + " of " + Twine(NumPages) + " pages of " +
+      FinalPath + " in place");
+  return true;
+}
+
+Error InPlaceOutputBuffer::commit() {
+  if (updateInPlace())
+    return Error::success();
+
+  log("writing " + FinalPath + " from scratch");
+  Expected<std::unique_ptr<FileOutputBuffer>> BufOrErr =
+      FileOutputBuffer::create(FinalPath, Size, Flags);
+  if (!BufOrErr)
+    return BufOrErr.takeError();
+  memcpy((*BufOrErr)->getBufferStart(), getBufferStart(), Size);
+  return (*BufOrErr)->commit();
+}
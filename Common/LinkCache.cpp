@@ -0,0 +1,172 @@
+//===- LinkCache.cpp ------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/LinkCache.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace llvm;
+using namespace lld;
+
+LinkCache::LinkCache(StringRef Dir, CachePruningPolicy Policy,
+                     const opt::InputArgList &Args)
+    : Dir(Dir), Policy(Policy) {
+  // File times may be stored in whole seconds.
+  Start = std::chrono::time_point_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now());
+
+  raw_string_ostream OS(Description);
+  OS << "lld link cache 1\n" << getLLDVersion() << "\n";
+  for (opt::Arg *Arg : Args) {
+    OS << "arg " << Arg->getAsString(Args) << "\n";
+    for (const char *V : Arg->getValues())
+      ArgValues.push_back(V);
+  }
+  OS.flush();
+}
+
+void LinkCache::addInput(StringRef Path, MemoryBufferRef MB) {
+  std::lock_guard<std::mutex> Lock(Mu);
+  Inputs[Path] = MB;
+}
+
+std::string LinkCache::getEntryPath(size_t I) const {
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, "llvmcache-" + Key + "-" + Twine(I));
+  return Path.str();
+}
+
+// Copies a file, keeping its permissions so that cached executables stay
+// executable.
+static std::error_code copyFile(StringRef From, StringRef To) {
+  if (std::error_code EC = sys::fs::copy_file(From, To))
+    return EC;
+  ErrorOr<sys::fs::perms> Perms = sys::fs::getPermissions(From);
+  if (!Perms)
+    return Perms.getError();
+  return sys::fs::setPermissions(To, *Perms);
+}
+
+bool LinkCache::fetch(ArrayRef<std::string> Outputs) {
+  std::vector<std::pair<std::string, MemoryBufferRef>> V;
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    V.assign(Inputs.begin(), Inputs.end());
+  }
+
+  // Arguments may name files the driver reads without recording them, for
+  // example linker scripts or order files, so hash every existing file an
+  // argument names. The outputs are left out since they change every time.
+  std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
+  for (StringRef Path : ArgValues) {
+    Path.consume_front("@");
+    if (Inputs.count(Path) || is_contained(Outputs, Path) ||
+        !sys::fs::is_regular_file(Path))
+      continue;
+    auto MBOrErr = MemoryBuffer::getFile(Path, /*FileSize*/ -1,
+                                         /*RequiresNullTerminator*/ false);
+    if (!MBOrErr)
+      continue;
+    V.emplace_back(Path, (*MBOrErr)->getMemBufferRef());
+    Buffers.push_back(std::move(*MBOrErr));
+  }
+
+  // Sort by path so that the key does not depend on the order in which
+  // threads recorded the inputs.
+  std::sort(V.begin(), V.end(),
+            [](const std::pair<std::string, MemoryBufferRef> &A,
+               const std::pair<std::string, MemoryBufferRef> &B) {
+              return A.first < B.first;
+            });
+  std::vector<uint64_t> Hashes(V.size());
+  parallelForEachN(0, V.size(), [&](size_t I) {
+    Hashes[I] = xxHash64(V[I].second.getBuffer());
+  });
+
+  std::string S = Description;
+  raw_string_ostream OS(S);
+  for (size_t I = 0; I < V.size(); ++I)
+    OS << "input " << utohexstr(Hashes[I]) << " " << V[I].first << "\n";
+  for (const std::string &Out : Outputs)
+    OS << "output " << Out << "\n";
+  OS.flush();
+  std::array<uint8_t, 20> Hash = SHA1::hash(arrayRefFromStringRef(S));
+  Key = toHex(toStringRef(Hash));
+
+  // The main output is stored last, so an entry that has it is complete.
+  if (!sys::fs::exists(getEntryPath(0)))
+    return false;
+
+  // Side files the earlier link did not write are left alone, as the link
+  // would have left them.
+  for (size_t I = 0; I < Outputs.size(); ++I) {
+    std::string Entry = getEntryPath(I);
+    if (!sys::fs::exists(Entry))
+      continue;
+    sys::fs::remove(Outputs[I]);
+    if (std::error_code EC = copyFile(Entry, Outputs[I])) {
+      warn("link cache: cannot copy " + Entry + " to " + Outputs[I] + ": " +
+           EC.message());
+      return false;
+    }
+  }
+  log("link cache: reused " + Key);
+  return true;
+}
+
+// Returns true if Path was written after the link started.
+static bool isWrittenSince(StringRef Path, sys::TimePoint<> Start) {
+  sys::fs::file_status Stat;
+  return !sys::fs::status(Path, Stat) &&
+         Stat.getLastModificationTime() >= Start;
+}
+
+void LinkCache::store(ArrayRef<std::string> Outputs) {
+  if (!isWrittenSince(Outputs[0], Start))
+    return;
+
+  if (std::error_code EC = sys::fs::create_directories(Dir)) {
+    warn("link cache: cannot create " + Dir + ": " + EC.message());
+    return;
+  }
+
+  // Copy to a temporary file first and rename it into place, so that
+  // concurrent links never see a partially written file. Side files that
+  // this link did not write, e.g. an import library left by an earlier
+  // link, are not stored.
+  for (size_t J = 1; J <= Outputs.size(); ++J) {
+    size_t I = J % Outputs.size();
+    if (I != 0 && !isWrittenSince(Outputs[I], Start))
+      continue;
+    SmallString<128> Tmp;
+    std::error_code EC =
+        sys::fs::createUniqueFile(Dir + "/tmp-%%%%%%%%", Tmp);
+    if (!EC)
+      EC = copyFile(Outputs[I], Tmp);
+    if (!EC)
+      EC = sys::fs::rename(Tmp, getEntryPath(I));
+    if (EC) {
+      sys::fs::remove(Tmp);
+      warn("link cache: cannot store " + Outputs[I] + ": " + EC.message());
+      return;
+    }
+  }
+  pruneCache(Dir, Policy);
+}
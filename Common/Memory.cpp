@@ -8,6 +8,19 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Memory.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <mutex>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
 
 using namespace llvm;
 using namespace lld;
@@ -15,9 +28,116 @@ using namespace lld;
 BumpPtrAllocator lld::BAlloc;
 StringSaver lld::Saver{BAlloc};
 std::vector<SpecificAllocBase *> lld::SpecificAllocBase::Instances;
+std::atomic<uint64_t> lld::InputFileBytes;
+uint64_t lld::OutputBufferBytes;
+
+// Guards Instances and ConcurrentAllocs, which threads append to the first
+// time they allocate through makeConcurrent() or saveConcurrent().
+static std::mutex Mu;
+static std::vector<BumpPtrAllocator *> ConcurrentAllocs;
+
+SpecificAllocBase::SpecificAllocBase() {
+  std::lock_guard<std::mutex> Lock(Mu);
+  Instances.push_back(this);
+}
+
+StringRef lld::saveConcurrent(StringRef S) {
+  static LLVM_THREAD_LOCAL BumpPtrAllocator *Alloc;
+  if (!Alloc) {
+    Alloc = new BumpPtrAllocator();
+    std::lock_guard<std::mutex> Lock(Mu);
+    ConcurrentAllocs.push_back(Alloc);
+  }
+  char *P = Alloc->Allocate<char>(S.size() + 1);
+  memcpy(P, S.data(), S.size());
+  P[S.size()] = '\0';
+  return StringRef(P, S.size());
+}
 
 void lld::freeArena() {
   for (SpecificAllocBase *Alloc : SpecificAllocBase::Instances)
     Alloc->reset();
+  for (BumpPtrAllocator *Alloc : ConcurrentAllocs)
+    Alloc->Reset();
   BAlloc.Reset();
+  InputFileBytes = 0;
+  OutputBufferBytes = 0;
+}
+
+// Returns the peak resident set size of this process, or 0 if the host
+// does not tell us.
+static uint64_t getPeakRSS() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS PMC;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &PMC, sizeof(PMC)))
+    return PMC.PeakWorkingSetSize;
+  return 0;
+#elif LLVM_ON_UNIX
+  struct rusage RU;
+  if (getrusage(RUSAGE_SELF, &RU))
+    return 0;
+#if defined(__APPLE__)
+  return RU.ru_maxrss;
+#else
+  // Linux and the BSDs report kilobytes.
+  return uint64_t(RU.ru_maxrss) * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+void lld::printMemoryUsage(StringRef Phase) {
+  struct Usage {
+    StringRef Name;
+    uint64_t Count = 0;
+    uint64_t Bytes = 0;
+  };
+
+  // makeConcurrent() creates one arena per thread for each type, so sum the
+  // arenas of the same type.
+  StringMap<Usage> Map;
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    for (SpecificAllocBase *Alloc : SpecificAllocBase::Instances) {
+      if (!Alloc->NumObjects)
+        continue;
+      Usage &U = Map[Alloc->getTypeName()];
+      U.Name = Alloc->getTypeName();
+      U.Count += Alloc->NumObjects;
+      U.Bytes += Alloc->NumObjects * Alloc->getTypeSize();
+    }
+  }
+
+  std::vector<Usage> V;
+  for (auto &KV : Map)
+    V.push_back(KV.second);
+  std::sort(V.begin(), V.end(), [](const Usage &A, const Usage &B) {
+    if (A.Bytes != B.Bytes)
+      return A.Bytes > B.Bytes;
+    return A.Name < B.Name;
+  });
+
+  uint64_t StringBytes = BAlloc.getBytesAllocated();
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    for (BumpPtrAllocator *Alloc : ConcurrentAllocs)
+      StringBytes += Alloc->getBytesAllocated();
+  }
+
+  std::string S;
+  raw_string_ostream OS(S);
+  OS << "memory usage after " << Phase << ":\n";
+  OS << format("  %-50s %10s %14s\n", "arena", "objects", "bytes");
+  for (const Usage &U : V)
+    OS << format("  %-50s %10llu %14llu\n", U.Name.str().c_str(),
+                 (unsigned long long)U.Count, (unsigned long long)U.Bytes);
+  OS << format("  %-50s %10s %14llu\n", "<strings and untyped objects>", "",
+               (unsigned long long)StringBytes);
+  OS << format("  %-61s %14llu\n", "input files",
+               (unsigned long long)InputFileBytes.load());
+  OS << format("  %-61s %14llu\n", "output buffer",
+               (unsigned long long)OutputBufferBytes);
+  OS << format("  %-61s %14llu", "peak RSS", (unsigned long long)getPeakRSS());
+  message(OS.str());
 }
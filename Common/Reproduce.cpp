@@ -8,10 +8,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Reproduce.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TarWriter.h"
 
 using namespace lld;
 using namespace llvm;
@@ -64,3 +67,78 @@ std::string lld::toString(const opt::Arg &Arg) {
     return K + V;
   return K + " " + V;
 }
+
+// The number of files the link may be ahead of the background thread.
+static const size_t MaxQueuedFiles = 64;
+
+static std::mutex WritersMu;
+static SmallPtrSet<AsyncTarWriter *, 2> Writers;
+
+Expected<std::unique_ptr<AsyncTarWriter>>
+AsyncTarWriter::create(StringRef OutputPath, StringRef BaseDir) {
+  Expected<std::unique_ptr<TarWriter>> TarOrErr =
+      TarWriter::create(OutputPath, BaseDir);
+  if (!TarOrErr)
+    return TarOrErr.takeError();
+  return std::unique_ptr<AsyncTarWriter>(
+      new AsyncTarWriter(std::move(*TarOrErr)));
+}
+
+AsyncTarWriter::AsyncTarWriter(std::unique_ptr<TarWriter> Tar)
+    : Tar(std::move(Tar)) {
+  // Without threads, files are written as they are appended.
+  if (ThreadsEnabled)
+    Thread = std::thread([this] { run(); });
+  std::lock_guard<std::mutex> Lock(WritersMu);
+  Writers.insert(this);
+}
+
+AsyncTarWriter::~AsyncTarWriter() {
+  finish();
+  std::lock_guard<std::mutex> Lock(WritersMu);
+  Writers.erase(this);
+}
+
+void AsyncTarWriter::append(StringRef Path, StringRef Data) {
+  std::unique_lock<std::mutex> Lock(Mu);
+  if (!Thread.joinable()) {
+    if (!Done)
+      Tar->append(Path, Data);
+    return;
+  }
+  Cond.wait(Lock, [&] { return Queue.size() < MaxQueuedFiles; });
+  Queue.emplace_back(Path, Data);
+  Cond.notify_all();
+}
+
+void AsyncTarWriter::run() {
+  std::unique_lock<std::mutex> Lock(Mu);
+  for (;;) {
+    Cond.wait(Lock, [&] { return Done || !Queue.empty(); });
+    if (Queue.empty())
+      return;
+    std::pair<std::string, StringRef> File = std::move(Queue.front());
+    Queue.pop_front();
+    Cond.notify_all();
+
+    Lock.unlock();
+    Tar->append(File.first, File.second);
+    Lock.lock();
+  }
+}
+
+void AsyncTarWriter::finish() {
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Done = true;
+    Cond.notify_all();
+  }
+  if (Thread.joinable())
+    Thread.join();
+}
+
+void lld::finishTarWriters() {
+  std::lock_guard<std::mutex> Lock(WritersMu);
+  for (AsyncTarWriter *W : Writers)
+    W->finish();
+}
@@ -60,22 +60,96 @@ Optional<std::string> lld::demangleMSVC(StringRef S) {
 }
 
 StringMatcher::StringMatcher(ArrayRef<StringRef> Pat) {
-  for (StringRef S : Pat) {
-    Expected<GlobPattern> Pat = GlobPattern::create(S);
-    if (!Pat)
-      error(toString(Pat.takeError()));
+  const char *Meta = "?*[\\";
+  for (unsigned I = 0; I < Pat.size(); ++I) {
+    StringRef S = Pat[I];
+    if (S.find_first_of(Meta) == StringRef::npos) {
+      Literals.insert({S, I});
+      continue;
+    }
+    if (S.endswith("*") &&
+        S.drop_back().find_first_of(Meta) == StringRef::npos) {
+      Prefixes.push_back({S.drop_back().str(), I});
+      continue;
+    }
+    if (S.startswith("*") &&
+        S.drop_front().find_first_of(Meta) == StringRef::npos) {
+      Suffixes.push_back({S.drop_front().str(), I});
+      continue;
+    }
+
+    Expected<GlobPattern> Glob = GlobPattern::create(S);
+    if (!Glob)
+      error(toString(Glob.takeError()));
     else
-      Patterns.push_back(*Pat);
+      Globs.push_back({*Glob, I});
   }
 }
 
 bool StringMatcher::match(StringRef S) const {
-  for (const GlobPattern &Pat : Patterns)
-    if (Pat.match(S))
+  if (!Literals.empty() && Literals.count(S))
+    return true;
+  for (const std::pair<std::string, unsigned> &P : Prefixes)
+    if (S.startswith(P.first))
+      return true;
+  for (const std::pair<std::string, unsigned> &P : Suffixes)
+    if (S.endswith(P.first))
+      return true;
+  for (const std::pair<GlobPattern, unsigned> &P : Globs)
+    if (P.first.match(S))
       return true;
   return false;
 }
 
+int StringMatcher::find(StringRef S) const {
+  // Each group is in pattern order, so only its first match can be the
+  // first match overall.
+  unsigned Ret = -1;
+  if (!Literals.empty()) {
+    auto It = Literals.find(S);
+    if (It != Literals.end())
+      Ret = It->second;
+  }
+  for (const std::pair<std::string, unsigned> &P : Prefixes) {
+    if (P.second > Ret)
+      break;
+    if (S.startswith(P.first)) {
+      Ret = P.second;
+      break;
+    }
+  }
+  for (const std::pair<std::string, unsigned> &P : Suffixes) {
+    if (P.second > Ret)
+      break;
+    if (S.endswith(P.first)) {
+      Ret = P.second;
+      break;
+    }
+  }
+  for (const std::pair<GlobPattern, unsigned> &P : Globs) {
+    if (P.second > Ret)
+      break;
+    if (P.first.match(S)) {
+      Ret = P.second;
+      break;
+    }
+  }
+  return Ret;
+}
+
+bool StringMatcher::getLiteralsAndPrefixes(
+    std::vector<StringRef> &Lits, std::vector<StringRef> &Prefs) const {
+  if (!Suffixes.empty() || !Globs.empty())
+    return false;
+  Lits.clear();
+  Prefs.clear();
+  for (const auto &KV : Literals)
+    Lits.push_back(KV.first());
+  for (const std::pair<std::string, unsigned> &P : Prefixes)
+    Prefs.push_back(P.first);
+  return true;
+}
+
 // Converts a hex string (e.g. "deadbeef") to a vector.
 std::vector<uint8_t> lld::parseHex(StringRef S) {
   std::vector<uint8_t> Hex;
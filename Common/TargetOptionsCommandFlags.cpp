@@ -17,8 +17,22 @@
 #include "lld/Common/TargetOptionsCommandFlags.h"
 
 #include "llvm/CodeGen/CommandFlags.inc"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Target/TargetOptions.h"
 
+static llvm::once_flag InitTargetsFlag;
+
+void lld::initLLVMTargets() {
+  llvm::call_once(InitTargetsFlag, [] {
+    llvm::InitializeAllTargetInfos();
+    llvm::InitializeAllTargets();
+    llvm::InitializeAllTargetMCs();
+    llvm::InitializeAllAsmPrinters();
+    llvm::InitializeAllAsmParsers();
+  });
+}
+
 // Define an externally visible version of
 // InitTargetOptionsFromCodeGenFlags, so that its functionality can be
 // used without having to include llvm/CodeGen/CommandFlags.inc, which
@@ -8,5 +8,475 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Threads.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/TimeTrace.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/Threading.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#include <stdio.h>
+#endif
+
+using namespace llvm;
+using namespace lld;
 
 bool lld::ThreadsEnabled = true;
+unsigned lld::ThreadCount = 0;
+
+unsigned lld::getThreadCount() {
+  if (!ThreadsEnabled)
+    return 1;
+  if (ThreadCount)
+    return ThreadCount;
+  return std::max(1u, hardware_concurrency());
+}
+
+namespace {
+struct Task {
+  std::function<void()> Fn;
+  // How deeply the task is nested in other tasks; 1 if it was spawned
+  // outside of any task.
+  unsigned Depth;
+};
+
+// A work-stealing pool shared by all parallel loops and task groups.
+//
+// Every worker has a queue of its own. Tasks spawned by a worker go to the
+// back of its queue, from where it also takes its next task, so nested work
+// tends to run on the thread that created it while its data is in cache.
+// Idle workers steal from the front of the other queues, where the oldest
+// tasks are. Tasks spawned by other threads go to a shared queue.
+//
+// A thread waiting for tasks to finish runs queued tasks in the meantime
+// instead of blocking, so nested parallel loops use the threads of the pool
+// rather than adding or idling threads. It only runs tasks nested more
+// deeply than the one it is running itself, which are not blocked on
+// anything that it holds for as long as it is running them.
+class Pool {
+public:
+  explicit Pool(unsigned NumWorkers);
+  ~Pool();
+
+  void spawn(std::function<void()> Fn);
+
+  // Runs queued tasks until Done returns true. Whoever makes it return
+  // true must call notify().
+  void helpUntil(function_ref<bool()> Done);
+  void notify();
+
+private:
+  struct alignas(64) Queue {
+    std::mutex Mu;
+    std::deque<Task> Tasks;
+  };
+
+  bool tryRun();
+  void work(unsigned Index);
+
+  std::vector<std::unique_ptr<Queue>> Queues;
+  std::vector<std::thread> Threads;
+  std::atomic<size_t> NumQueued{0};
+
+  // Guards Generation and Stop. Generation is bumped for every new task so
+  // that waiting threads know to look again.
+  std::mutex Mu;
+  std::condition_variable Cond;
+  uint64_t Generation = 0;
+  bool Stop = false;
+};
+} // namespace
+
+// The queue of the calling thread if it is a worker, and the depth of the
+// task it is running, or 0 if none.
+static LLVM_THREAD_LOCAL unsigned CurrentQueue = -1;
+static LLVM_THREAD_LOCAL unsigned CurrentDepth;
+
+Pool::Pool(unsigned NumWorkers) {
+  // The last queue is the shared one.
+  for (unsigned I = 0; I <= NumWorkers; ++I)
+    Queues.emplace_back(new Queue);
+  for (unsigned I = 0; I < NumWorkers; ++I)
+    Threads.emplace_back([=] { work(I); });
+}
+
+Pool::~Pool() {
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Stop = true;
+  }
+  Cond.notify_all();
+  for (std::thread &T : Threads)
+    T.join();
+}
+
+void Pool::spawn(std::function<void()> Fn) {
+  Queue &Q = *Queues[std::min<size_t>(CurrentQueue, Queues.size() - 1)];
+  {
+    std::lock_guard<std::mutex> Lock(Q.Mu);
+    Q.Tasks.push_back({std::move(Fn), CurrentDepth + 1});
+  }
+  ++NumQueued;
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    ++Generation;
+  }
+  Cond.notify_all();
+}
+
+void Pool::notify() {
+  // Taking the lock orders this with a waiter that has just seen Done()
+  // return false and is about to sleep.
+  std::lock_guard<std::mutex> Lock(Mu);
+  Cond.notify_all();
+}
+
+// Takes the newest eligible task of the thread's own queue, or else the
+// oldest one of any other queue, and runs it. Returns false if there is
+// none.
+bool Pool::tryRun() {
+  if (NumQueued == 0)
+    return false;
+
+  size_t N = Queues.size();
+  size_t Own = std::min<size_t>(CurrentQueue, N - 1);
+  auto IsEligible = [](const Task &T) { return T.Depth > CurrentDepth; };
+  Task T;
+  bool Found = false;
+
+  for (size_t K = 0; K < N && !Found; ++K) {
+    Queue &Q = *Queues[(Own + K) % N];
+    std::lock_guard<std::mutex> Lock(Q.Mu);
+    if (K == 0) {
+      auto It = std::find_if(Q.Tasks.rbegin(), Q.Tasks.rend(), IsEligible);
+      if (It != Q.Tasks.rend()) {
+        T = std::move(*It);
+        Q.Tasks.erase(std::next(It).base());
+        Found = true;
+      }
+    } else {
+      auto It = std::find_if(Q.Tasks.begin(), Q.Tasks.end(), IsEligible);
+      if (It != Q.Tasks.end()) {
+        T = std::move(*It);
+        Q.Tasks.erase(It);
+        Found = true;
+      }
+    }
+  }
+  if (!Found)
+    return false;
+
+  --NumQueued;
+  unsigned SavedDepth = CurrentDepth;
+  CurrentDepth = T.Depth;
+  T.Fn();
+  CurrentDepth = SavedDepth;
+  return true;
+}
+
+void Pool::helpUntil(function_ref<bool()> Done) {
+  while (!Done()) {
+    uint64_t Gen;
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      Gen = Generation;
+    }
+    if (tryRun())
+      continue;
+    std::unique_lock<std::mutex> Lock(Mu);
+    Cond.wait(Lock, [&] { return Done() || Generation != Gen; });
+  }
+}
+
+void Pool::work(unsigned Index) {
+  CurrentQueue = Index;
+  for (;;) {
+    uint64_t Gen;
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      if (Stop && NumQueued == 0)
+        return;
+      Gen = Generation;
+    }
+    if (tryRun())
+      continue;
+    std::unique_lock<std::mutex> Lock(Mu);
+    Cond.wait(Lock, [&] { return Stop || Generation != Gen; });
+  }
+}
+
+// All parallel loops and task groups share one pool so that the total
+// number of threads stays at getThreadCount() no matter how they are
+// nested. A thread that waits for a loop or a group takes part in the
+// work, so the pool has one thread less.
+static Pool &getPool(unsigned NumThreads) {
+  static std::mutex Mu;
+  static std::unique_ptr<Pool> P;
+  static unsigned PoolSize;
+
+  std::lock_guard<std::mutex> Lock(Mu);
+  if (!P || PoolSize != NumThreads) {
+    P.reset();
+    P.reset(new Pool(NumThreads - 1));
+    PoolSize = NumThreads;
+  }
+  return *P;
+}
+
+namespace {
+// A contiguous part of a parallel loop. Threads claim chunks of it by
+// bumping Next until it passes End.
+struct alignas(64) Slice {
+  std::atomic<size_t> Next;
+  size_t End;
+};
+
+// A parallel loop. It is cut into one slice, or with Locality::Contiguous
+// into one slice per thread. The pool may start a helper task after the
+// loop is done, so the state is reference counted, and Fn may only be
+// called for a chunk that has been claimed.
+struct Loop {
+  Loop(Pool &P, function_ref<void(size_t)> Fn, size_t Begin, size_t End,
+       size_t Grain, size_t NumChunks, size_t NumSlices, bool Pin)
+      : P(P), Fn(Fn), Diags(NumChunks), Depth(CurrentDepth + 1),
+        Begin(Begin), End(End), Grain(Grain),
+        Slices(new Slice[NumSlices]), NumSlices(NumSlices), Pin(Pin),
+        NextSlot(0), Pending(End - Begin) {
+    // Slices start at chunk boundaries.
+    for (size_t I = 0; I < NumSlices; ++I) {
+      Slices[I].Next = Begin + NumChunks * I / NumSlices * Grain;
+      Slices[I].End =
+          std::min(End, Begin + NumChunks * (I + 1) / NumSlices * Grain);
+    }
+  }
+
+  Pool &P;
+  function_ref<void(size_t)> Fn;
+  std::string Name;
+  // The diagnostics reported by each chunk.
+  std::vector<DiagnosticBuffer> Diags;
+  // Chunks run at the depth of the helper tasks on every thread, so that
+  // a thread waiting in a nested loop does not pick up its siblings.
+  unsigned Depth;
+  size_t Begin;
+  size_t End;
+  size_t Grain;
+  std::unique_ptr<Slice[]> Slices;
+  size_t NumSlices;
+  bool Pin;
+  std::atomic<size_t> NextSlot;
+  std::atomic<size_t> Pending;
+};
+} // namespace
+
+#if defined(__linux__)
+namespace {
+// The CPUs of each NUMA node that this process may run on, and the CPUs of
+// the whole process.
+struct NumaNodes {
+  std::vector<cpu_set_t> Nodes;
+  cpu_set_t All;
+};
+} // namespace
+
+// Parses a sysfs CPU list such as "0-7,16-23".
+static bool readCPUList(const std::string &Path, cpu_set_t &Set) {
+  FILE *F = fopen(Path.c_str(), "r");
+  if (!F)
+    return false;
+  CPU_ZERO(&Set);
+  unsigned Lo, Hi;
+  int N;
+  while ((N = fscanf(F, "%u", &Lo)) == 1) {
+    Hi = Lo;
+    int C = fgetc(F);
+    if (C == '-') {
+      if (fscanf(F, "%u", &Hi) != 1)
+        break;
+      C = fgetc(F);
+    }
+    for (unsigned I = Lo; I <= Hi && I < CPU_SETSIZE; ++I)
+      CPU_SET(I, &Set);
+    if (C != ',')
+      break;
+  }
+  fclose(F);
+  return true;
+}
+
+static const NumaNodes &getNumaNodes() {
+  static NumaNodes *Ret = [] {
+    auto *R = new NumaNodes;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &R->All))
+      return R;
+    for (unsigned I = 0;; ++I) {
+      cpu_set_t Set;
+      if (!readCPUList("/sys/devices/system/node/node" + std::to_string(I) +
+                           "/cpulist",
+                       Set))
+        break;
+      CPU_AND(&Set, &Set, &R->All);
+      if (CPU_COUNT(&Set))
+        R->Nodes.push_back(Set);
+    }
+    return R;
+  }();
+  return *Ret;
+}
+
+static bool hasManyNumaNodes() { return getNumaNodes().Nodes.size() > 1; }
+
+// Pins the calling thread to the node that runs the Slot'th of NumSlots
+// slices, or to all CPUs again if NumSlots is 0.
+static void pinThread(size_t Slot, size_t NumSlots) {
+  const NumaNodes &N = getNumaNodes();
+  const cpu_set_t &Set =
+      NumSlots ? N.Nodes[Slot * N.Nodes.size() / NumSlots] : N.All;
+  sched_setaffinity(0, sizeof(cpu_set_t), &Set);
+}
+#else
+static bool hasManyNumaNodes() { return false; }
+static void pinThread(size_t Slot, size_t NumSlots) {}
+#endif
+
+// Helpers record each chunk they run for --time-trace under the name of
+// the scope that started the loop. The event must be closed before the
+// chunk is counted as done, because the caller may write the trace as soon
+// as the loop has finished.
+//
+// A thread starts with its own slice and then helps with the others, in
+// order, so that it stays close to the memory it has been working on.
+static void runChunks(Loop &L, bool IsHelper) {
+  size_t Slot = L.NextSlot.fetch_add(1) % L.NumSlices;
+  if (L.Pin)
+    pinThread(Slot, L.NumSlices);
+  unsigned SavedDepth = CurrentDepth;
+  CurrentDepth = L.Depth;
+
+  for (size_t K = 0; K < L.NumSlices; ++K) {
+    Slice &S = L.Slices[(Slot + K) % L.NumSlices];
+    for (;;) {
+      size_t I = S.Next.fetch_add(L.Grain);
+      if (I >= S.End)
+        break;
+      size_t E = std::min(I + L.Grain, S.End);
+      {
+        Optional<TimeTraceScope> Trace;
+        if (IsHelper && !L.Name.empty())
+          Trace.emplace(L.Name);
+        DiagnosticBuffer &Diags = L.Diags[(I - L.Begin) / L.Grain];
+        Diags.install();
+        for (size_t J = I; J < E; ++J)
+          L.Fn(J);
+        Diags.uninstall();
+      }
+      if (L.Pending.fetch_sub(E - I) == E - I)
+        L.P.notify();
+    }
+  }
+
+  CurrentDepth = SavedDepth;
+  if (L.Pin)
+    pinThread(0, 0);
+}
+
+void lld::parallelForEachN(size_t Begin, size_t End,
+                           function_ref<void(size_t)> Fn, size_t MinGrain,
+                           Locality Hint) {
+  if (Begin >= End)
+    return;
+
+  // Use about 32 chunks per thread so that uneven chunks balance out.
+  size_t Size = End - Begin;
+  unsigned NumThreads = getThreadCount();
+  size_t Grain = std::max<size_t>({MinGrain, 1, Size / (NumThreads * 32)});
+  size_t NumChunks = (Size + Grain - 1) / Grain;
+  if (NumThreads == 1 || NumChunks == 1) {
+    for (size_t I = Begin; I < End; ++I)
+      Fn(I);
+    return;
+  }
+
+  size_t NumHelpers = std::min<size_t>(NumThreads - 1, NumChunks - 1);
+  bool Contiguous = Hint == Locality::Contiguous;
+  Pool &P = getPool(NumThreads);
+  auto L = std::make_shared<Loop>(P, Fn, Begin, End, Grain, NumChunks,
+                                  Contiguous ? NumHelpers + 1 : 1,
+                                  Contiguous && hasManyNumaNodes());
+  if (TimeTraceEnabled)
+    L->Name = getTimeTraceScope();
+
+  // Once there is nothing left to claim, the calling thread only waits for
+  // chunks that other threads are running, and helps with their nested
+  // work meanwhile.
+  for (size_t I = 0; I < NumHelpers; ++I)
+    P.spawn([L] { runChunks(*L, /*IsHelper=*/true); });
+  runChunks(*L, /*IsHelper=*/false);
+  P.helpUntil([&] { return L->Pending == 0; });
+
+  // Print what the chunks reported in the order a serial loop would have.
+  for (DiagnosticBuffer &Diags : L->Diags)
+    Diags.flush();
+}
+
+struct TaskGroup::State {
+  explicit State(Pool &P) : P(P) {}
+
+  Pool &P;
+  std::string Name;
+  // The diagnostics reported by each task, in the order of spawn().
+  std::deque<DiagnosticBuffer> Diags;
+  std::atomic<size_t> Pending{0};
+};
+
+TaskGroup::TaskGroup() {
+  unsigned NumThreads = getThreadCount();
+  if (NumThreads > 1)
+    S = std::make_shared<State>(getPool(NumThreads));
+}
+
+TaskGroup::~TaskGroup() { wait(); }
+
+void TaskGroup::spawn(std::function<void()> Fn) {
+  if (!S) {
+    Fn();
+    return;
+  }
+  if (TimeTraceEnabled && S->Name.empty())
+    S->Name = getTimeTraceScope();
+
+  S->Diags.emplace_back();
+  DiagnosticBuffer *Diags = &S->Diags.back();
+  ++S->Pending;
+  std::shared_ptr<State> St = S;
+  S->P.spawn([=] {
+    {
+      Optional<TimeTraceScope> Trace;
+      if (!St->Name.empty())
+        Trace.emplace(St->Name);
+      Diags->install();
+      Fn();
+      Diags->uninstall();
+    }
+    if (--St->Pending == 0)
+      St->P.notify();
+  });
+}
+
+void TaskGroup::wait() {
+  if (!S)
+    return;
+  S->P.helpUntil([&] { return S->Pending == 0; });
+  for (DiagnosticBuffer &Diags : S->Diags)
+    Diags.flush();
+  S->Diags.clear();
+}
@@ -0,0 +1,151 @@
+//===- TimeTrace.cpp ------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Common/TimeTrace.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace llvm;
+using namespace lld;
+
+bool lld::TimeTraceEnabled = false;
+
+namespace {
+struct Event {
+  std::string Name;
+  uint64_t Start;
+  uint64_t Duration;
+};
+
+// The events of one thread. Threads only ever append to their own buffer,
+// so recording an event takes no lock.
+struct ThreadEvents {
+  unsigned Tid;
+  std::vector<Event> Events;
+};
+} // namespace
+
+typedef std::chrono::steady_clock Clock;
+
+static Clock::time_point StartTime;
+static std::mutex Mu;
+static std::vector<ThreadEvents *> AllThreads;
+static ThreadEvents *MainThread;
+static LLVM_THREAD_LOCAL ThreadEvents *CurrentThread;
+
+// The name of the innermost open scope. It is a copy rather than a pointer
+// into the scope because scopes are not always closed in the order they
+// were opened.
+static LLVM_THREAD_LOCAL std::string *CurrentScope;
+
+static uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               StartTime)
+      .count();
+}
+
+// Like the arenas in Memory.cpp, the per-thread state is never deleted
+// because pool threads may exit before the trace is written.
+static ThreadEvents &getThreadEvents() {
+  if (!CurrentThread) {
+    CurrentScope = new std::string();
+    std::lock_guard<std::mutex> Lock(Mu);
+    CurrentThread = new ThreadEvents();
+    CurrentThread->Tid = AllThreads.size();
+    AllThreads.push_back(CurrentThread);
+  }
+  return *CurrentThread;
+}
+
+TimeTraceScope::TimeTraceScope(StringRef Name) {
+  if (!TimeTraceEnabled)
+    return;
+  getThreadEvents();
+  this->Name = Name;
+  Parent = *CurrentScope;
+  *CurrentScope = Name;
+  Start = now();
+  Active = true;
+}
+
+void TimeTraceScope::end() {
+  if (!Active)
+    return;
+  Active = false;
+  if (!TimeTraceEnabled)
+    return;
+  getThreadEvents().Events.push_back({Name, Start, now() - Start});
+  *CurrentScope = Parent;
+}
+
+StringRef lld::getTimeTraceScope() {
+  if (!CurrentScope)
+    return "";
+  return *CurrentScope;
+}
+
+void lld::startTimeTrace() {
+  MainThread = &getThreadEvents();
+  std::lock_guard<std::mutex> Lock(Mu);
+  for (ThreadEvents *T : AllThreads)
+    T->Events.clear();
+  StartTime = Clock::now();
+  TimeTraceEnabled = true;
+}
+
+static void writeEscaped(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if ((unsigned char)C < 0x20)
+      OS << ' ';
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void lld::writeTimeTrace(StringRef Path) {
+  TimeTraceEnabled = false;
+
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Path + ": " + EC.message());
+    return;
+  }
+
+  std::lock_guard<std::mutex> Lock(Mu);
+  OS << "{\"traceEvents\":[\n";
+  bool First = true;
+  for (ThreadEvents *T : AllThreads) {
+    for (const Event &E : T->Events) {
+      if (!First)
+        OS << ",\n";
+      First = false;
+      OS << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << T->Tid << ",\"ts\":"
+         << E.Start << ",\"dur\":" << E.Duration << ",\"name\":";
+      writeEscaped(OS, E.Name);
+      OS << "}";
+    }
+    if (!T->Events.empty()) {
+      OS << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << T->Tid
+         << ",\"name\":\"thread_name\",\"args\":{\"name\":\""
+         << (T == MainThread ? "main" : "worker") << "\"}}";
+    }
+    T->Events.clear();
+  }
+  OS << "\n]}\n";
+}
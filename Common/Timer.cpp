@@ -10,16 +10,78 @@
 #include "lld/Common/Timer.h"
 #include "lld/Common/ErrorHandler.h"
 #include "llvm/Support/Format.h"
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace lld;
 using namespace llvm;
 
-ScopedTimer::ScopedTimer(Timer &T) : T(&T) { T.start(); }
+// The file descriptors of the performance counters, or -1 if they are
+// not enabled.
+static int CounterFDs[Timer::NumCounters] = {-1, -1, -1, -1};
+
+#if defined(__linux__)
+static int openCounter(uint32_t Type, uint64_t Config) {
+  perf_event_attr Attr = {};
+  Attr.size = sizeof(Attr);
+  Attr.type = Type;
+  Attr.config = Config;
+  // Count the worker threads too. A read of the counter returns the sum
+  // over this thread and all threads created after it was opened.
+  Attr.inherit = 1;
+  // Kernel events are often not allowed to unprivileged users.
+  Attr.exclude_kernel = 1;
+  Attr.exclude_hv = 1;
+  return syscall(__NR_perf_event_open, &Attr, 0, -1, -1, 0);
+}
+#endif
+
+void Timer::enableCounters() {
+  if (CounterFDs[0] != -1)
+    return;
+#if defined(__linux__)
+  int FDs[NumCounters] = {
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS),
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES),
+      openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES),
+      openCounter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS)};
+  for (int FD : FDs) {
+    if (FD != -1)
+      continue;
+    warn("cannot open performance counters: " +
+         std::error_code(errno, std::generic_category()).message());
+    for (int FD : FDs)
+      if (FD != -1)
+        close(FD);
+    return;
+  }
+  std::copy(std::begin(FDs), std::end(FDs), std::begin(CounterFDs));
+#else
+  warn("performance counters are only supported on Linux");
+#endif
+}
+
+static void readCounters(uint64_t *Values) {
+#if defined(__linux__)
+  for (int I = 0; I < Timer::NumCounters; ++I)
+    if (read(CounterFDs[I], &Values[I], sizeof(uint64_t)) != sizeof(uint64_t))
+      Values[I] = 0;
+#endif
+}
+
+ScopedTimer::ScopedTimer(Timer &T) : T(&T), Trace(T.getName()) { T.start(); }
 
 void ScopedTimer::stop() {
   if (!T)
     return;
   T->stop();
+  Trace.end();
   T = nullptr;
 }
 
@@ -33,10 +95,27 @@ void Timer::start() {
   if (Parent && Total.count() == 0)
     Parent->Children.push_back(this);
   StartTime = std::chrono::high_resolution_clock::now();
+  if (CounterFDs[0] != -1)
+    readCounters(StartCounters);
 }
 
 void Timer::stop() {
   Total += (std::chrono::high_resolution_clock::now() - StartTime);
+  if (CounterFDs[0] != -1) {
+    uint64_t Now[NumCounters];
+    readCounters(Now);
+    for (int I = 0; I < NumCounters; ++I)
+      Counters[I] += Now[I] - StartCounters[I];
+  }
+}
+
+void Timer::reset() {
+  for (Timer *Child : Children)
+    Child->reset();
+  // Children are added again when they first start.
+  Children.clear();
+  Total = std::chrono::nanoseconds::zero();
+  std::fill(std::begin(Counters), std::end(Counters), 0);
 }
 
 Timer &Timer::root() {
@@ -71,6 +150,18 @@ void Timer::print(int Depth, double TotalDuration, bool Recurse) const {
   std::string S = std::string(Depth * 2, ' ') + Name + std::string(":");
   Stream << format("%-30s%5d ms (%5.1f%%)", S.c_str(), (int)millis(), P);
 
+  // With counters, also print the instruction count, instructions per
+  // cycle, cache misses and page faults, so that it is clear whether a
+  // phase is bound by computation or by memory.
+  if (CounterFDs[0] != -1) {
+    double CycleCount = Counters[Cycles];
+    Stream << format("  %8.3fG insn  %4.2f IPC  %8.3fM LLC-miss  %8llu faults",
+                     Counters[Instructions] / 1e9,
+                     CycleCount ? Counters[Instructions] / CycleCount : 0.0,
+                     Counters[CacheMisses] / 1e6,
+                     (unsigned long long)Counters[PageFaults]);
+  }
+
   message(Str);
 
   if (Recurse) {
@@ -39,6 +39,7 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -572,44 +573,66 @@ static void implementPatch(uint64_t AdrpAddr, uint64_t PatcheeOffset,
     IS->Relocations.push_back(MakeRelToPatch(PatcheeOffset, PS->PatchSym));
 }
 
+// Scan the code in IS for the erratum sequence. Return the address of the
+// start of each sequence found and the offset in IS of the instruction that
+// needs to be patched. This only reads IS and SectionMap, so it is safe to call
+// for different InputSections in parallel.
+std::vector<std::pair<uint64_t, uint64_t>>
+AArch64Err843419Patcher::scanSection(InputSection *IS) const {
+  std::vector<std::pair<uint64_t, uint64_t>> Ret;
+  //  LLD doesn't use the erratum sequence in SyntheticSections.
+  if (isa<SyntheticSection>(IS))
+    return Ret;
+  // Use SectionMap to make sure we only scan code and not inline data.
+  // We have already sorted MapSyms in ascending order and removed consecutive
+  // mapping symbols of the same type. Our range of executable instructions to
+  // scan is therefore [CodeSym->Value, DataSym->Value) or [CodeSym->Value,
+  // section size).
+  auto It = SectionMap.find(IS);
+  if (It == SectionMap.end())
+    return Ret;
+  const std::vector<const Defined *> &MapSyms = It->second;
+
+  auto CodeSym = llvm::find_if(MapSyms, [&](const Defined *MS) {
+    return MS->getName().startswith("$x");
+  });
+
+  while (CodeSym != MapSyms.end()) {
+    auto DataSym = std::next(CodeSym);
+    uint64_t Off = (*CodeSym)->Value;
+    uint64_t Limit =
+        (DataSym == MapSyms.end()) ? IS->Data.size() : (*DataSym)->Value;
+
+    while (Off < Limit) {
+      uint64_t StartAddr = IS->getVA(Off);
+      if (uint64_t PatcheeOffset = scanCortexA53Errata843419(IS, Off, Limit))
+        Ret.push_back({StartAddr, PatcheeOffset});
+    }
+    if (DataSym == MapSyms.end())
+      break;
+    CodeSym = std::next(DataSym);
+  }
+  return Ret;
+}
+
 // Scan all the instructions in InputSectionDescription, for each instance of
 // the erratum sequence create a Patch843419Section. We return the list of
 // Patch843419Sections that need to be applied to ISD.
 std::vector<Patch843419Section *>
 AArch64Err843419Patcher::patchInputSectionDescription(
     InputSectionDescription &ISD) {
+  // The sections are scanned in parallel. Creating a patch modifies the
+  // relocations of the patched section, so the patches are created afterwards
+  // in section order to keep the output independent of the number of threads.
+  std::vector<std::vector<std::pair<uint64_t, uint64_t>>> Found(
+      ISD.Sections.size());
+  parallelForEachN(0, ISD.Sections.size(),
+                   [&](size_t I) { Found[I] = scanSection(ISD.Sections[I]); });
+
   std::vector<Patch843419Section *> Patches;
-  for (InputSection *IS : ISD.Sections) {
-    //  LLD doesn't use the erratum sequence in SyntheticSections.
-    if (isa<SyntheticSection>(IS))
-      continue;
-    // Use SectionMap to make sure we only scan code and not inline data.
-    // We have already sorted MapSyms in ascending order and removed consecutive
-    // mapping symbols of the same type. Our range of executable instructions to
-    // scan is therefore [CodeSym->Value, DataSym->Value) or [CodeSym->Value,
-    // section size).
-    std::vector<const Defined *> &MapSyms = SectionMap[IS];
-
-    auto CodeSym = llvm::find_if(MapSyms, [&](const Defined *MS) {
-      return MS->getName().startswith("$x");
-    });
-
-    while (CodeSym != MapSyms.end()) {
-      auto DataSym = std::next(CodeSym);
-      uint64_t Off = (*CodeSym)->Value;
-      uint64_t Limit =
-          (DataSym == MapSyms.end()) ? IS->Data.size() : (*DataSym)->Value;
-
-      while (Off < Limit) {
-        uint64_t StartAddr = IS->getVA(Off);
-        if (uint64_t PatcheeOffset = scanCortexA53Errata843419(IS, Off, Limit))
-          implementPatch(StartAddr, PatcheeOffset, IS, Patches);
-      }
-      if (DataSym == MapSyms.end())
-        break;
-      CodeSym = std::next(DataSym);
-    }
-  }
+  for (size_t I = 0, E = ISD.Sections.size(); I < E; ++I)
+    for (std::pair<uint64_t, uint64_t> &P : Found[I])
+      implementPatch(P.first, P.second, ISD.Sections[I], Patches);
   return Patches;
 }
 
@@ -29,6 +29,9 @@ public:
   bool createFixes();
 
 private:
+  std::vector<std::pair<uint64_t, uint64_t>>
+  scanSection(InputSection *IS) const;
+
   std::vector<Patch843419Section *>
   patchInputSectionDescription(InputSectionDescription &ISD);
 
@@ -10,6 +10,7 @@
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "TargetImpl.h"
 #include "Thunks.h"
 #include "lld/Common/ErrorHandler.h"
 #include "llvm/Object/ELF.h"
@@ -44,8 +45,11 @@ public:
   bool inBranchRange(RelType Type, uint64_t Src, uint64_t Dst) const override;
   bool usesOnlyLowPageBits(RelType Type) const override;
   void relocateOne(uint8_t *Loc, RelType Type, uint64_t Val) const override;
+  void relocateAlloc(InputSectionBase &Sec, uint8_t *Buf,
+                     uint8_t *BufEnd) const override;
   RelExpr adjustRelaxExpr(RelType Type, const uint8_t *Data,
                           RelExpr Expr) const override;
+  void relaxGot(uint8_t *Loc, uint64_t Val) const override;
   void relaxTlsGdToLe(uint8_t *Loc, RelType Type, uint64_t Val) const override;
   void relaxTlsGdToIe(uint8_t *Loc, RelType Type, uint64_t Val) const override;
   void relaxTlsIeToLe(uint8_t *Loc, RelType Type, uint64_t Val) const override;
@@ -128,6 +132,26 @@ RelExpr AArch64::adjustRelaxExpr(RelType Type, const uint8_t *Data,
       return R_RELAX_TLS_GD_TO_IE_PAGE_PC;
     return R_RELAX_TLS_GD_TO_IE_ABS;
   }
+
+  // For --relax-got, the relocations of a GOT load of a non-preemptible
+  // symbol come here in pairs, with Data pointing at the instructions:
+  //   adrp xN, :got:sym                 [R_AARCH64_ADR_GOT_PAGE]
+  //   ldr  xN, [xN, #:got_lo12:sym]     [R_AARCH64_LD64_GOT_LO12_NC]
+  // They are relaxed to
+  //   adrp xN, sym
+  //   add  xN, xN, #:lo12:sym
+  // The registers must all be the same, because only then is the GOT page
+  // address in xN dead after the ldr.
+  if (Expr == R_GOT_PAGE_PC || Expr == R_GOT) {
+    uint32_t Adrp = read32le(Data);
+    uint32_t Ldr = read32le(Data + 4);
+    uint32_t Reg = Adrp & 0x1f;
+    if ((Adrp & 0x9f000000) != 0x90000000 ||
+        (Ldr & 0xffc00000) != 0xf9400000 || (Ldr & 0x1f) != Reg ||
+        ((Ldr >> 5) & 0x1f) != Reg)
+      return Expr;
+    return Expr == R_GOT_PAGE_PC ? R_PAGE_PC : R_RELAX_GOT_PC_NOPIC;
+  }
   return Expr;
 }
 
@@ -350,6 +374,18 @@ void AArch64::relocateOne(uint8_t *Loc, RelType Type, uint64_t Val) const {
   }
 }
 
+void AArch64::relaxGot(uint8_t *Loc, uint64_t Val) const {
+  // Convert "ldr xN, [xN, #:got_lo12:sym]" to "add xN, xN, #:lo12:sym".
+  uint32_t RegNo = read32le(Loc) & 0x1f;
+  write32le(Loc, 0x91000000 | (RegNo << 5) | RegNo);
+  or32AArch64Imm(Loc, Val);
+}
+
+void AArch64::relocateAlloc(InputSectionBase &Sec, uint8_t *Buf,
+                            uint8_t *BufEnd) const {
+  relocateAllocWith(*this, Sec, Buf, BufEnd);
+}
+
 void AArch64::relaxTlsGdToLe(uint8_t *Loc, RelType Type, uint64_t Val) const {
   // TLSDESC Global-Dynamic relocation are in the form:
   //   adrp    x0, :tlsdesc:v             [R_AARCH64_TLSDESC_ADR_PAGE21]
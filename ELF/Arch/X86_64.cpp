@@ -11,6 +11,7 @@
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "TargetImpl.h"
 #include "lld/Common/ErrorHandler.h"
 #include "llvm/Object/ELF.h"
 #include "llvm/Support/Endian.h"
@@ -34,15 +35,19 @@ public:
   void writePltHeader(uint8_t *Buf) const override;
   void writePlt(uint8_t *Buf, uint64_t GotPltEntryAddr, uint64_t PltEntryAddr,
                 int32_t Index, unsigned RelOff) const override;
-  void relocateOne(uint8_t *Loc, RelType Type, uint64_t Val) const override;
+
+  // These are final so that relocateAlloc can call them directly.
+  void relocateOne(uint8_t *Loc, RelType Type, uint64_t Val) const final;
+  void relocateAlloc(InputSectionBase &Sec, uint8_t *Buf,
+                     uint8_t *BufEnd) const override;
 
   RelExpr adjustRelaxExpr(RelType Type, const uint8_t *Data,
                           RelExpr Expr) const override;
-  void relaxGot(uint8_t *Loc, uint64_t Val) const override;
-  void relaxTlsGdToIe(uint8_t *Loc, RelType Type, uint64_t Val) const override;
-  void relaxTlsGdToLe(uint8_t *Loc, RelType Type, uint64_t Val) const override;
-  void relaxTlsIeToLe(uint8_t *Loc, RelType Type, uint64_t Val) const override;
-  void relaxTlsLdToLe(uint8_t *Loc, RelType Type, uint64_t Val) const override;
+  void relaxGot(uint8_t *Loc, uint64_t Val) const final;
+  void relaxTlsGdToIe(uint8_t *Loc, RelType Type, uint64_t Val) const final;
+  void relaxTlsGdToLe(uint8_t *Loc, RelType Type, uint64_t Val) const final;
+  void relaxTlsIeToLe(uint8_t *Loc, RelType Type, uint64_t Val) const final;
+  void relaxTlsLdToLe(uint8_t *Loc, RelType Type, uint64_t Val) const final;
 
 private:
   void relaxGotNoPic(uint8_t *Loc, uint64_t Val, uint8_t Op,
@@ -334,6 +339,12 @@ void X86_64<ELFT>::relocateOne(uint8_t *Loc, RelType Type, uint64_t Val) const {
   }
 }
 
+template <class ELFT>
+void X86_64<ELFT>::relocateAlloc(InputSectionBase &Sec, uint8_t *Buf,
+                                 uint8_t *BufEnd) const {
+  relocateAllocWith(*this, Sec, Buf, BufEnd);
+}
+
 template <class ELFT>
 RelExpr X86_64<ELFT>::adjustRelaxExpr(RelType Type, const uint8_t *Data,
                                       RelExpr RelExpr) const {
@@ -0,0 +1,397 @@
+//===- Atomize.cpp --------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// --atomize-sections splits input sections that hold several functions or
+// data objects into one section per object, so that --gc-sections and --icf
+// work on objects that were built without -ffunction-sections or
+// -fdata-sections.
+//
+// A section is cut where a global STT_FUNC or STT_OBJECT symbol with a size
+// starts, unless a symbol before it extends past that point. Each piece
+// becomes an InputSection with the name and flags of the original one, and
+// the symbols in it are moved to it. The original InputSection object is
+// kept as the first piece, so that whatever refers to it by section index
+// still finds it.
+//
+// Cutting a section is only safe if every reference from one piece to
+// another goes through a relocation that the linker can redirect. We cannot
+// see references that the assembler has resolved by itself, so we leave a
+// section alone if
+//
+//  - it defines a local symbol. Assemblers resolve references to a local
+//    symbol from within its section, and turn references from other
+//    sections into references to the section symbol;
+//
+//  - it is referred to through its section symbol by a relocation whose
+//    target is not exactly the symbol plus the addend. That is true for
+//    absolute relocations, for relocations in .eh_frame and for those in
+//    non-allocated sections such as debug info, but not for a PC-relative
+//    reference from code, whose addend is off by the length of the rest of
+//    the instruction. Relocations with implicit addends (SHT_REL) cannot
+//    be redirected to a piece either, because that would mean changing the
+//    section contents.
+//
+// GNU as emits a relocation for each reference to a global symbol, and
+// code built with -fPIC refers to other functions through the PLT or the
+// GOT, so objects of either kind can be split. Objects from an assembler
+// that resolves references between global functions of one section by
+// itself must not be linked with this option.
+//
+// Debug info that describes a whole section as one range, such as the
+// line table of an object without -ffunction-sections, is left as it is
+// and is only right for the first piece.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Atomize.h"
+#include "Config.h"
+#include "InputFiles.h"
+#include "InputSection.h"
+#include "Relocations.h"
+#include "Symbols.h"
+#include "Target.h"
+#include "lld/Common/Memory.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace llvm::object;
+
+using namespace lld;
+using namespace lld::elf;
+
+namespace {
+// A section that we may split.
+struct Candidate {
+  Candidate(InputSection *Sec) : Sec(Sec) {}
+
+  InputSection *Sec;
+
+  // Cleared if the section cannot be split.
+  bool Ok = true;
+
+  // The offsets and sizes of the objects in the section.
+  std::vector<std::pair<uint64_t, uint64_t>> Objects;
+
+  // The offsets at which pieces start, in increasing order. The first one
+  // is 0.
+  std::vector<uint64_t> Starts;
+
+  // The pieces. The first one is Sec.
+  std::vector<InputSection *> Pieces;
+
+  // Section symbols of the pieces, or 0 if there is none yet. The first
+  // piece uses the section symbol of the file.
+  std::vector<uint32_t> SymIndices;
+
+  // Returns the index of the piece that contains a given offset. An offset
+  // at the end of the section belongs to the last piece.
+  size_t getPiece(uint64_t Offset) const {
+    return std::upper_bound(Starts.begin(), Starts.end(), Offset) -
+           Starts.begin() - 1;
+  }
+};
+
+template <class ELFT> class Atomizer {
+public:
+  Atomizer(ObjFile<ELFT> &File) : File(File) {}
+  void run(DenseMap<InputSectionBase *, std::vector<InputSection *>> &Out);
+
+private:
+  void findCandidates();
+  template <class RelTy>
+  void checkRelocs(InputSectionBase *Sec, ArrayRef<RelTy> Rels);
+  void split(Candidate &C);
+  template <class RelTy>
+  void rewriteRelocs(InputSectionBase *Sec, ArrayRef<RelTy> Rels);
+  uint32_t getSectionSymbol(Candidate &C, size_t I);
+
+  Candidate *findBySection(const SectionBase *Sec) {
+    Candidate *C = BySection.lookup(Sec);
+    return C && C->Ok ? C : nullptr;
+  }
+
+  Candidate *findBySymbol(uint32_t SymIndex) {
+    Candidate *C = BySectionSymbol.lookup(SymIndex);
+    return C && C->Ok ? C : nullptr;
+  }
+
+  ObjFile<ELFT> &File;
+  std::vector<Candidate> Candidates;
+  DenseMap<const SectionBase *, Candidate *> BySection;
+  DenseMap<uint32_t, Candidate *> BySectionSymbol;
+};
+} // namespace
+
+static bool isCandidate(InputSectionBase *S) {
+  if (!S || S == &InputSection::Discarded || S->kind() != SectionBase::Regular)
+    return false;
+  if (!(S->Flags & SHF_ALLOC) || (S->Flags & (SHF_LINK_ORDER | SHF_TLS)))
+    return false;
+  if (S->Type != SHT_PROGBITS && S->Type != SHT_NOBITS)
+    return false;
+  if (!S->dependentSections().empty() || S->isCompressed())
+    return false;
+
+  // .init and .fini are made of pieces of code from several files that run
+  // as one function.
+  return S->Name != ".init" && S->Name != ".fini";
+}
+
+template <class ELFT> void Atomizer<ELFT>::findCandidates() {
+  for (InputSectionBase *S : File.getSections())
+    if (isCandidate(S))
+      Candidates.emplace_back(cast<InputSection>(S));
+  for (Candidate &C : Candidates)
+    BySection[C.Sec] = &C;
+
+  ArrayRef<Symbol *> Syms = File.getSymbols();
+  for (size_t I = 1, E = Syms.size(); I != E; ++I) {
+    auto *D = dyn_cast<Defined>(Syms[I]);
+    if (!D || !D->Section)
+      continue;
+    Candidate *C = findBySection(D->Section);
+    if (!C)
+      continue;
+
+    if (D->isSection()) {
+      BySectionSymbol[I] = C;
+      continue;
+    }
+    if (D->isLocal()) {
+      // ARM and AArch64 mapping symbols mark code and data but are never
+      // referred to.
+      if (!D->getName().startswith("$"))
+        C->Ok = false;
+      continue;
+    }
+    if ((D->Type == STT_FUNC || D->Type == STT_OBJECT) && D->Size)
+      C->Objects.push_back({D->Value, D->Size});
+  }
+
+  for (Candidate &C : Candidates) {
+    if (!C.Ok)
+      continue;
+    std::sort(C.Objects.begin(), C.Objects.end());
+
+    uint64_t Size = C.Sec->getSize();
+    uint64_t End = 0;
+    C.Starts.push_back(0);
+    for (std::pair<uint64_t, uint64_t> &Obj : C.Objects) {
+      if (Obj.first >= End && Obj.first > C.Starts.back() && Obj.first < Size)
+        C.Starts.push_back(Obj.first);
+      End = std::max(End, Obj.first + Obj.second);
+    }
+    C.Ok = C.Starts.size() > 1 && End <= Size;
+  }
+}
+
+// Rejects sections that relocations in Sec make unsafe to split.
+template <class ELFT>
+template <class RelTy>
+void Atomizer<ELFT>::checkRelocs(InputSectionBase *Sec, ArrayRef<RelTy> Rels) {
+  Candidate *Self = findBySection(Sec);
+  bool IsExactAlways = !(Sec->Flags & SHF_ALLOC) || isa<EhInputSection>(Sec);
+
+  for (const RelTy &Rel : Rels) {
+    if (Self && Rel.r_offset >= Sec->getSize())
+      Self->Ok = false;
+
+    uint32_t SymIndex = Rel.getSymbol(Config->IsMips64EL);
+    Candidate *C = findBySymbol(SymIndex);
+    if (!C)
+      continue;
+    if (!RelTy::IsRela) {
+      C->Ok = false;
+      continue;
+    }
+
+    int64_t Addend = getAddend<ELFT>(Rel);
+    if (Addend < 0 || (uint64_t)Addend > C->Sec->getSize()) {
+      C->Ok = false;
+      continue;
+    }
+    if (IsExactAlways)
+      continue;
+    RelType Type = Rel.getType(Config->IsMips64EL);
+    const uint8_t *Loc = Sec->Data.data() + Rel.r_offset;
+    if (Target->getRelExpr(Type, File.getSymbol(SymIndex), Loc) != R_ABS)
+      C->Ok = false;
+  }
+}
+
+template <class ELFT> void Atomizer<ELFT>::split(Candidate &C) {
+  InputSection *Sec = C.Sec;
+  auto GetData = [&](uint64_t Begin, uint64_t End) {
+    if (Sec->Type == SHT_NOBITS)
+      return makeArrayRef<uint8_t>(nullptr, End - Begin);
+    return Sec->Data.slice(Begin, End - Begin);
+  };
+
+  C.Pieces.push_back(Sec);
+  for (size_t I = 1, E = C.Starts.size(); I != E; ++I) {
+    uint64_t Begin = C.Starts[I];
+    uint64_t End = I + 1 == E ? Sec->getSize() : C.Starts[I + 1];
+    C.Pieces.push_back(make<InputSection>(&File, Sec->Flags, Sec->Type,
+                                          MinAlign(Sec->Alignment, Begin),
+                                          GetData(Begin, End), Sec->Name));
+  }
+  Sec->Data = GetData(0, C.Starts[1]);
+  C.SymIndices.resize(C.Pieces.size());
+
+  for (Symbol *S : File.getSymbols()) {
+    auto *D = dyn_cast<Defined>(S);
+    if (!D || D->Section != Sec || D->isSection())
+      continue;
+    size_t I = C.getPiece(D->Value);
+    D->Section = C.Pieces[I];
+    D->Value -= C.Starts[I];
+  }
+}
+
+template <class ELFT>
+uint32_t Atomizer<ELFT>::getSectionSymbol(Candidate &C, size_t I) {
+  if (!C.SymIndices[I])
+    C.SymIndices[I] = File.addLocalSymbol(make<Defined>(
+        &File, "", STB_LOCAL, 0, STT_SECTION, 0, 0, C.Pieces[I]));
+  return C.SymIndices[I];
+}
+
+template <class ELFT>
+static void setAddend(typename ELFT::Rel &Rel, int64_t Addend) {
+  llvm_unreachable("SHT_REL relocations are never redirected");
+}
+
+template <class ELFT>
+static void setAddend(typename ELFT::Rela &Rel, int64_t Addend) {
+  Rel.r_addend = Addend;
+}
+
+// Points relocations in Sec that refer to a piece other than the first one
+// through a section symbol at the section symbol of that piece. If Sec
+// itself has been split, also hands each piece the relocations that apply
+// to it. Relocations are copied, as the originals are in the input file.
+template <class ELFT>
+template <class RelTy>
+void Atomizer<ELFT>::rewriteRelocs(InputSectionBase *Sec,
+                                   ArrayRef<RelTy> Rels) {
+  Candidate *Self = findBySection(Sec);
+  auto NeedsRewrite = [&](const RelTy &Rel) {
+    Candidate *C = findBySymbol(Rel.getSymbol(Config->IsMips64EL));
+    return C && C->getPiece(getAddend<ELFT>(Rel)) != 0;
+  };
+  if (!Self && llvm::none_of(Rels, NeedsRewrite))
+    return;
+
+  MutableArrayRef<RelTy> Copy(BAlloc.Allocate<RelTy>(Rels.size()),
+                              Rels.size());
+  std::copy(Rels.begin(), Rels.end(), Copy.begin());
+
+  for (RelTy &Rel : Copy) {
+    Candidate *C = findBySymbol(Rel.getSymbol(Config->IsMips64EL));
+    if (!C)
+      continue;
+    int64_t Addend = getAddend<ELFT>(Rel);
+    size_t I = C->getPiece(Addend);
+    if (I == 0)
+      continue;
+    Rel.setSymbolAndType(getSectionSymbol(*C, I),
+                         Rel.getType(Config->IsMips64EL), Config->IsMips64EL);
+    setAddend<ELFT>(Rel, Addend - C->Starts[I]);
+  }
+
+  if (!Self) {
+    Sec->FirstRelocation = Copy.data();
+    return;
+  }
+
+  // Relocations keep their order within each piece. Code that handles
+  // pairs of relocations depends on it.
+  std::stable_sort(Copy.begin(), Copy.end(),
+                   [&](const RelTy &A, const RelTy &B) {
+                     return Self->getPiece(A.r_offset) <
+                            Self->getPiece(B.r_offset);
+                   });
+
+  size_t Begin = 0;
+  for (size_t I = 0, E = Self->Pieces.size(); I != E; ++I) {
+    size_t End = Begin;
+    for (; End < Copy.size() && Self->getPiece(Copy[End].r_offset) == I; ++End)
+      Copy[End].r_offset = Copy[End].r_offset - Self->Starts[I];
+
+    InputSection *Piece = Self->Pieces[I];
+    Piece->FirstRelocation = Copy.data() + Begin;
+    Piece->NumRelocations = End - Begin;
+    Piece->AreRelocsRela = RelTy::IsRela;
+    Begin = End;
+  }
+}
+
+template <class ELFT>
+void Atomizer<ELFT>::run(
+    DenseMap<InputSectionBase *, std::vector<InputSection *>> &Out) {
+  findCandidates();
+  if (llvm::none_of(Candidates, [](Candidate &C) { return C.Ok; }))
+    return;
+
+  std::vector<InputSectionBase *> Relocated;
+  for (InputSectionBase *Sec : File.getSections())
+    if (Sec && Sec != &InputSection::Discarded && Sec->NumRelocations)
+      Relocated.push_back(Sec);
+
+  for (InputSectionBase *Sec : Relocated) {
+    if (Sec->AreRelocsRela)
+      checkRelocs(Sec, Sec->template relas<ELFT>());
+    else
+      checkRelocs(Sec, Sec->template rels<ELFT>());
+  }
+
+  // Relocations are rewritten by looking at the pieces of the sections they
+  // refer to, so split everything before rewriting anything.
+  for (Candidate &C : Candidates)
+    if (C.Ok)
+      split(C);
+
+  for (InputSectionBase *Sec : Relocated) {
+    if (Sec->AreRelocsRela)
+      rewriteRelocs(Sec, Sec->template relas<ELFT>());
+    else
+      rewriteRelocs(Sec, Sec->template rels<ELFT>());
+  }
+
+  for (Candidate &C : Candidates)
+    if (C.Ok)
+      Out[C.Sec] = std::move(C.Pieces);
+}
+
+template <class ELFT> void elf::atomizeSections() {
+  DenseMap<InputSectionBase *, std::vector<InputSection *>> Pieces;
+  for (InputFile *F : ObjectFiles)
+    Atomizer<ELFT>(*cast<ObjFile<ELFT>>(F)).run(Pieces);
+  if (Pieces.empty())
+    return;
+
+  // Put the new pieces right after the first one, so that the order of
+  // input sections is the same as if the file had one section per object.
+  std::vector<InputSectionBase *> V;
+  for (InputSectionBase *S : InputSections) {
+    V.push_back(S);
+    auto It = Pieces.find(S);
+    if (It != Pieces.end())
+      V.insert(V.end(), It->second.begin() + 1, It->second.end());
+  }
+  InputSections = std::move(V);
+}
+
+template void elf::atomizeSections<ELF32LE>();
+template void elf::atomizeSections<ELF32BE>();
+template void elf::atomizeSections<ELF64LE>();
+template void elf::atomizeSections<ELF64BE>();
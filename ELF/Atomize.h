@@ -0,0 +1,22 @@
+//===- Atomize.h ------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_ATOMIZE_H
+#define LLD_ELF_ATOMIZE_H
+
+namespace lld {
+namespace elf {
+
+// Splits input sections at symbol boundaries for --atomize-sections.
+template <class ELFT> void atomizeSections();
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -10,6 +10,7 @@
 #ifndef LLD_ELF_CONFIG_H
 #define LLD_ELF_CONFIG_H
 
+#include "lld/Common/CallGraphSort.h"
 #include "lld/Common/ErrorHandler.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -21,6 +22,8 @@
 #include <vector>
 
 namespace lld {
+class LinkCache;
+
 namespace elf {
 
 class InputFile;
@@ -37,6 +40,15 @@ enum ELFKind {
 // For --build-id.
 enum class BuildIdKind { None, Fast, Md5, Sha1, Hexstring, Uuid };
 
+// For --compress-debug-sections.
+enum class CompressionType { None, Zlib, Zstd };
+
+// For --icf={none,safe,all}.
+enum class ICFLevel { None, Safe, All };
+
+// For --map-format.
+enum class MapFormatKind { Text, Json };
+
 // For --discard-{all,locals,none}.
 enum class DiscardPolicy { Default, All, Locals, None };
 
@@ -55,6 +67,9 @@ enum class SortSectionPolicy { Default, None, Alignment, Name, Priority };
 // For --target2
 enum class Target2Policy { Abs, Rel, GotRel };
 
+// For --thunk-placement.
+enum class ThunkPlacementPolicy { First, Cover };
+
 struct SymbolVersion {
   llvm::StringRef Name;
   bool IsExternCpp;
@@ -77,12 +92,15 @@ struct VersionDefinition {
 struct Configuration {
   uint8_t OSABI = 0;
   llvm::CachePruningPolicy ThinLTOCachePolicy;
+  LinkCache *OutputCache = nullptr;
   llvm::StringMap<uint64_t> SectionStartMap;
+  llvm::StringRef ArchiveIndexCacheDir;
   llvm::StringRef Chroot;
   llvm::StringRef DynamicLinker;
   llvm::StringRef Entry;
   llvm::StringRef Emulation;
   llvm::StringRef Fini;
+  llvm::StringRef GdbIndexCacheDir;
   llvm::StringRef Init;
   llvm::StringRef LTOAAPipeline;
   llvm::StringRef LTONewPmPasses;
@@ -95,12 +113,16 @@ struct Configuration {
   llvm::StringRef SoName;
   llvm::StringRef Sysroot;
   llvm::StringRef ThinLTOCacheDir;
+  llvm::StringRef ThinLTODistributor;
+  llvm::StringRef ThinLTODistributorFallback;
   llvm::StringRef ThinLTOIndexOnlyArg;
+  llvm::StringRef TimeTraceFile;
   std::pair<llvm::StringRef, llvm::StringRef> ThinLTOObjectSuffixReplace;
   std::pair<llvm::StringRef, llvm::StringRef> ThinLTOPrefixReplace;
   std::string Rpath;
   std::vector<VersionDefinition> VersionDefinitions;
   std::vector<llvm::StringRef> AuxiliaryList;
+  std::vector<llvm::StringRef> DataOrderingFile;
   std::vector<llvm::StringRef> FilterList;
   std::vector<llvm::StringRef> SearchPaths;
   std::vector<llvm::StringRef> SymbolOrderingFile;
@@ -114,15 +136,18 @@ struct Configuration {
       CallGraphProfile;
   bool AllowMultipleDefinition;
   bool AndroidPackDynRelocs = false;
+  bool RelrPackDynRelocs = false;
   bool ARMHasBlx = false;
   bool ARMHasMovtMovw = false;
   bool ARMJ1J2BranchEncoding = false;
   bool AsNeeded = false;
+  bool AtomizeSections;
   bool Bsymbolic;
   bool BsymbolicFunctions;
   bool CheckSections;
-  bool CompressDebugSections;
   bool Cref;
+  bool DebugNames;
+  bool DedupDebugTypes;
   bool DefineCommon;
   bool Demangle = true;
   bool DisableVerify;
@@ -137,21 +162,30 @@ struct Configuration {
   bool GnuUnique;
   bool HasDynamicList = false;
   bool HasDynSymTab;
-  bool ICF;
+  ICFLevel ICF;
   bool IgnoreDataAddressEquality;
   bool IgnoreFunctionAddressEquality;
+  bool Incremental;
   bool LTODebugPassManager;
   bool LTONewPassManager;
   bool MergeArmExidx;
   bool MipsN32Abi = false;
+  bool MmapOutput;
   bool NoinhibitExec;
   bool Nostdlib;
   bool OFormatBinary;
   bool Omagic;
   bool OptRemarksWithHotness;
   bool Pie;
+  bool PrefaultOutput;
+  bool PrefetchInputs;
   bool PrintGcSections;
+  bool PrintHashStats;
   bool PrintIcfSections;
+  bool PrintMemoryUsage;
+  bool PrintStats;
+  bool ReduceMemoryOverheads;
+  bool RelaxGot;
   bool Relocatable;
   bool SaveTemps;
   bool SingleRoRx;
@@ -168,10 +202,14 @@ struct Configuration {
   bool WarnMissingEntry;
   bool WarnSymbolOrdering;
   bool WriteAddends;
+  bool WriteInPlace;
   bool ZCombreloc;
+  bool ZCompactSegments;
   bool ZCopyreloc;
   bool ZExecstack;
+  bool ZGroupRelocatedData;
   bool ZHazardplt;
+  bool ZHugepageText;
   bool ZKeepTextSectionPrefix;
   bool ZNodelete;
   bool ZNodlopen;
@@ -188,14 +226,23 @@ struct Configuration {
   StripPolicy Strip;
   UnresolvedPolicy UnresolvedSymbols;
   Target2Policy Target2;
+  ThunkPlacementPolicy ThunkPlacement;
   BuildIdKind BuildId = BuildIdKind::None;
+  CallGraphSortKind CallGraphSort = CallGraphSortKind::C3;
+  CompressionType CompressDebugSections;
+  MapFormatKind MapFormat = MapFormatKind::Text;
   ELFKind EKind = ELFNoneKind;
   uint16_t DefaultSymbolVersion = llvm::ELF::VER_NDX_GLOBAL;
   uint16_t EMachine = llvm::ELF::EM_NONE;
   llvm::Optional<uint64_t> ImageBase;
+  uint64_t CallGraphClusterSize;
+  uint64_t CallGraphPageSize;
+  uint64_t CallGraphProfileMinSamples;
   uint64_t MaxPageSize;
   uint64_t MipsGotSize;
   uint64_t ZStackSize;
+  int CompressDebugSectionsLevel;
+  unsigned HashBloomBits;
   unsigned LTOPartitions;
   unsigned LTOO;
   unsigned Optimize;
@@ -0,0 +1,1230 @@
+//===- DebugTypes.cpp -----------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// --dedup-debug-types removes type DIEs that are repeated in several compile
+// units. Every compile unit that includes a header describes the types of
+// that header again, so in large C++ programs most of .debug_info is
+// copies of the same types. Type units (-fdebug-types-section) avoid that,
+// but only if every object file was built with them.
+//
+// A type DIE at namespace scope, together with its children, is a "type
+// tree". Two type trees are identical if they have the same shape, the same
+// attributes and refer to identical type trees, which we find the same way
+// ICF finds identical sections: each tree first gets a hash of its own
+// contents, and then we repeatedly hash each tree's hash together with those
+// of the trees it refers to until the number of distinct hashes no longer
+// grows. The first tree of each class in command line order is kept. The
+// others are removed from their compile units, and references to them are
+// rewritten to DW_FORM_ref_addr references to the kept copy, with a
+// relocation against the .debug_info section that holds it. Hashing and
+// rewriting are done in parallel for each compile unit.
+//
+// Only object files with a single DWARF 3 or 4 compile unit in 32-bit
+// format are handled. Strings and file names are compared by contents, but a
+// tree that contains another relocated value, such as an address, is kept as
+// it is. Since DIE offsets change, name indices of rewritten compile units
+// (.debug_pubnames, .debug_names and the like) are discarded.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DebugTypes.h"
+#include "Config.h"
+#include "InputFiles.h"
+#include "InputSection.h"
+#include "Relocations.h"
+#include "Symbols.h"
+#include "Target.h"
+#include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <map>
+
+using namespace llvm;
+using namespace llvm::dwarf;
+using namespace llvm::ELF;
+using namespace llvm::object;
+
+using namespace lld;
+using namespace lld::elf;
+
+// The size of a DWARF 3 or 4 compile unit header in 32-bit format.
+static const uint32_t HeaderSize = 11;
+
+namespace {
+struct AttrSpec {
+  dwarf::Attribute Attr;
+  dwarf::Form Form;
+};
+
+struct Abbrev {
+  uint64_t Code;
+  dwarf::Tag Tag;
+  bool HasChildren;
+  std::vector<AttrSpec> Attrs;
+};
+
+// A DIE, or a null entry that ends a list of children.
+struct Entry {
+  uint32_t Offset;
+
+  // Null for null entries.
+  const Abbrev *Abbr;
+
+  int32_t Parent;
+
+  // The index one past the last entry of the subtree.
+  uint32_t End;
+
+  // The type tree this entry belongs to, or -1.
+  int32_t Tree = -1;
+};
+
+struct TypeTree {
+  TypeTree(uint32_t Root) : Root(Root) {}
+
+  // The index of the root entry.
+  uint32_t Root;
+
+  // Cleared if the tree cannot be compared with others.
+  bool Ok = true;
+
+  uint64_t Hash[2] = {0, 0};
+
+  // The type trees of the same unit this one refers to.
+  std::vector<uint32_t> Refs;
+
+  // Set if the tree is removed in favor of an identical one.
+  bool Removed = false;
+  uint32_t CanonUnit = 0;
+  uint32_t CanonRoot = 0;
+};
+
+// A relocation in .debug_info.
+struct InfoReloc {
+  uint32_t Offset;
+  uint32_t Index;
+  RelType Type;
+
+  // The section and offset the relocation refers to.
+  InputSectionBase *Target;
+  uint64_t Value;
+};
+} // namespace
+
+static bool isTypeTag(Tag T) {
+  switch (T) {
+  case DW_TAG_array_type:
+  case DW_TAG_base_type:
+  case DW_TAG_class_type:
+  case DW_TAG_const_type:
+  case DW_TAG_enumeration_type:
+  case DW_TAG_pointer_type:
+  case DW_TAG_ptr_to_member_type:
+  case DW_TAG_reference_type:
+  case DW_TAG_restrict_type:
+  case DW_TAG_rvalue_reference_type:
+  case DW_TAG_structure_type:
+  case DW_TAG_subroutine_type:
+  case DW_TAG_typedef:
+  case DW_TAG_union_type:
+  case DW_TAG_unspecified_type:
+  case DW_TAG_volatile_type:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Name indices refer to DIEs by offset, so they are discarded for units
+// that are rewritten.
+static bool isNameIndex(StringRef Name) {
+  return Name == ".debug_pubnames" || Name == ".debug_pubtypes" ||
+         Name == ".debug_gnu_pubnames" || Name == ".debug_gnu_pubtypes" ||
+         Name == ".debug_names" || Name.startswith(".apple_");
+}
+
+static bool isRefForm(Form F) {
+  return F == DW_FORM_ref1 || F == DW_FORM_ref2 || F == DW_FORM_ref4 ||
+         F == DW_FORM_ref8 || F == DW_FORM_ref_udata;
+}
+
+static bool isConstantForm(Form F) {
+  return F == DW_FORM_data1 || F == DW_FORM_data2 || F == DW_FORM_data4 ||
+         F == DW_FORM_data8 || F == DW_FORM_udata;
+}
+
+namespace {
+// Reads DWARF data. Reading past the end sets Err and returns zero.
+struct Reader {
+  Reader(ArrayRef<uint8_t> Data, uint32_t Off) : Data(Data), Off(Off) {}
+
+  bool has(uint64_t N) {
+    if (!Err && N <= Data.size() - Off)
+      return true;
+    Err = true;
+    return false;
+  }
+
+  void skip(uint64_t N) {
+    if (has(N))
+      Off += N;
+  }
+
+  uint64_t readFixed(unsigned N) {
+    if (!has(N))
+      return 0;
+    const uint8_t *P = Data.data() + Off;
+    Off += N;
+    switch (N) {
+    case 1:
+      return *P;
+    case 2:
+      return read16(P);
+    case 4:
+      return read32(P);
+    default:
+      return read64(P);
+    }
+  }
+
+  uint64_t readULEB() {
+    if (Err)
+      return 0;
+    unsigned N;
+    const char *Msg = nullptr;
+    uint64_t V = decodeULEB128(Data.data() + Off, &N, Data.end(), &Msg);
+    if (Msg) {
+      Err = true;
+      return 0;
+    }
+    Off += N;
+    return V;
+  }
+
+  void skipSLEB() {
+    if (Err)
+      return;
+    unsigned N;
+    const char *Msg = nullptr;
+    decodeSLEB128(Data.data() + Off, &N, Data.end(), &Msg);
+    if (Msg)
+      Err = true;
+    else
+      Off += N;
+  }
+
+  StringRef readCStr() {
+    if (Err)
+      return "";
+    StringRef S = toStringRef(Data.slice(Off));
+    size_t Pos = S.find('\0');
+    if (Pos == StringRef::npos) {
+      Err = true;
+      return "";
+    }
+    Off += Pos + 1;
+    return S.substr(0, Pos);
+  }
+
+  ArrayRef<uint8_t> Data;
+  uint32_t Off;
+  bool Err = false;
+};
+} // namespace
+
+// Skips an attribute value. Returns false for forms we do not handle.
+static bool skipValue(Reader &R, Form F, uint8_t AddrSize) {
+  switch (F) {
+  case DW_FORM_flag_present:
+    return true;
+  case DW_FORM_data1:
+  case DW_FORM_flag:
+  case DW_FORM_ref1:
+    R.skip(1);
+    return true;
+  case DW_FORM_data2:
+  case DW_FORM_ref2:
+    R.skip(2);
+    return true;
+  case DW_FORM_data4:
+  case DW_FORM_ref4:
+  case DW_FORM_sec_offset:
+  case DW_FORM_strp:
+    R.skip(4);
+    return true;
+  case DW_FORM_data8:
+  case DW_FORM_ref8:
+  case DW_FORM_ref_sig8:
+    R.skip(8);
+    return true;
+  case DW_FORM_addr:
+    R.skip(AddrSize);
+    return true;
+  case DW_FORM_udata:
+  case DW_FORM_ref_udata:
+    R.readULEB();
+    return true;
+  case DW_FORM_sdata:
+    R.skipSLEB();
+    return true;
+  case DW_FORM_string:
+    R.readCStr();
+    return true;
+  case DW_FORM_block1:
+    R.skip(R.readFixed(1));
+    return true;
+  case DW_FORM_block2:
+    R.skip(R.readFixed(2));
+    return true;
+  case DW_FORM_block4:
+    R.skip(R.readFixed(4));
+    return true;
+  case DW_FORM_block:
+  case DW_FORM_exprloc:
+    R.skip(R.readULEB());
+    return true;
+  default:
+    return false;
+  }
+}
+
+static void writeRef(uint8_t *P, Form F, uint64_t V, uint32_t Size) {
+  switch (F) {
+  case DW_FORM_ref1:
+    *P = V;
+    break;
+  case DW_FORM_ref2:
+    write16(P, V);
+    break;
+  case DW_FORM_ref4:
+    write32(P, V);
+    break;
+  case DW_FORM_ref8:
+    write64(P, V);
+    break;
+  default:
+    // Offsets only get smaller, so the value fits in the original size.
+    encodeULEB128(V, P, Size);
+    break;
+  }
+}
+
+static void appendULEB(std::vector<uint8_t> &Vec, uint64_t V) {
+  uint8_t Buf[16];
+  unsigned N = encodeULEB128(V, Buf);
+  Vec.insert(Vec.end(), Buf, Buf + N);
+}
+
+namespace {
+// Collects the bytes a type tree is hashed from.
+struct HashBuilder {
+  void add(uint64_t V) {
+    uint8_t Buf[8];
+    memcpy(Buf, &V, 8);
+    Bytes.insert(Bytes.end(), Buf, Buf + 8);
+  }
+
+  void add(StringRef S) {
+    add(S.size());
+    Bytes.insert(Bytes.end(), S.begin(), S.end());
+  }
+
+  void add(ArrayRef<uint8_t> A) {
+    add(A.size());
+    Bytes.insert(Bytes.end(), A.begin(), A.end());
+  }
+
+  uint64_t hash() const { return xxHash64(toStringRef(Bytes)); }
+
+  std::vector<uint8_t> Bytes;
+};
+
+template <class ELFT> class TypeDedup {
+public:
+  void run();
+
+private:
+  // The single compile unit of an object file.
+  struct Unit {
+    ObjFile<ELFT> *File = nullptr;
+    InputSection *Info = nullptr;
+    InputSectionBase *AbbrevSec = nullptr;
+    InputSectionBase *Line = nullptr;
+    InputSectionBase *Str = nullptr;
+    ArrayRef<uint8_t> Data;
+    uint8_t AddrSize = 0;
+
+    // The type of the relocation of the abbreviation offset in the header,
+    // which we use for DW_FORM_ref_addr values as well.
+    RelType AbsType = 0;
+
+    std::vector<Abbrev> Abbrevs;
+    DenseMap<uint64_t, uint32_t> AbbrevIndex;
+    uint64_t MaxCode = 0;
+
+    // The offset of the null entry that ends the abbreviation table. New
+    // abbreviations are inserted there, which is only possible if nothing
+    // after it is used.
+    uint32_t AbbrevEnd = 0;
+    bool CanRewrite = false;
+
+    std::vector<InfoReloc> Relocs;
+    std::vector<std::string> FileNames;
+    std::vector<Entry> Entries;
+    std::vector<TypeTree> Trees;
+
+    // Filled in if type trees are removed from this unit.
+    bool Rewrite = false;
+    std::vector<bool> Removed;
+    std::vector<uint32_t> NewOffsets;
+    std::vector<uint32_t> Variant;
+    std::map<std::pair<const Abbrev *, std::vector<bool>>, uint32_t>
+        VariantIndex;
+    std::vector<std::pair<const Abbrev *, std::vector<bool>>> Variants;
+    uint32_t NewSize = 0;
+    DenseMap<InputSection *, uint32_t> SymIndices;
+    std::vector<uint8_t> *NewData = nullptr;
+    std::vector<typename ELFT::Rel> *NewRels = nullptr;
+    std::vector<typename ELFT::Rela> *NewRelas = nullptr;
+  };
+
+  template <class Fn> void forEachAttr(const Unit &U, const Entry &E, Fn F);
+  std::vector<InfoReloc>::const_iterator findReloc(const Unit &U,
+                                                   uint32_t Off);
+  bool hasRelocs(const Unit &U, uint32_t Begin, uint32_t End);
+  int32_t findEntry(const Unit &U, uint64_t Off);
+  uint64_t readValue(const Unit &U, Form F, uint32_t Off);
+  bool readString(const Unit &U, Form F, uint32_t Off, StringRef &S);
+  bool readOffset(const Unit &U, Form F, uint32_t Off, InputSectionBase *Sec,
+                  uint64_t &V);
+
+  template <class RelTy> void collectRelocs(Unit &U, ArrayRef<RelTy> Rels);
+  template <class RelTy>
+  bool refersInto(InputSectionBase *Sec, InputSectionBase *Info,
+                  ArrayRef<RelTy> Rels);
+  bool parse(Unit &U);
+  bool parseAbbrevs(Unit &U, uint64_t Off);
+  bool parseEntries(Unit &U);
+  void readFileNames(Unit &U, uint64_t Off, StringRef CompDir);
+  void findTrees(Unit &U);
+  void hashTree(Unit &U, TypeTree &T);
+  void refine();
+  void selectCanonical();
+  void layout(Unit &U);
+  void createSymbols(Unit &U);
+  void rewriteAbbrevs(Unit &U);
+  template <class RelTy>
+  void emit(Unit &U, ArrayRef<RelTy> Rels, std::vector<RelTy> &Out);
+
+  std::vector<Unit> Units;
+  unsigned Cur = 0;
+};
+} // namespace
+
+template <class ELFT>
+template <class Fn>
+void TypeDedup<ELFT>::forEachAttr(const Unit &U, const Entry &E, Fn F) {
+  Reader R(U.Data, E.Offset);
+  R.readULEB();
+  for (const AttrSpec &A : E.Abbr->Attrs) {
+    uint32_t Begin = R.Off;
+    skipValue(R, A.Form, U.AddrSize);
+    F(A, Begin, R.Off);
+  }
+}
+
+template <class ELFT>
+std::vector<InfoReloc>::const_iterator
+TypeDedup<ELFT>::findReloc(const Unit &U, uint32_t Off) {
+  return std::lower_bound(
+      U.Relocs.begin(), U.Relocs.end(), Off,
+      [](const InfoReloc &R, uint32_t Off) { return R.Offset < Off; });
+}
+
+template <class ELFT>
+bool TypeDedup<ELFT>::hasRelocs(const Unit &U, uint32_t Begin, uint32_t End) {
+  auto It = findReloc(U, Begin);
+  return It != U.Relocs.end() && It->Offset < End;
+}
+
+// Returns the index of the DIE at a given offset, or -1.
+template <class ELFT>
+int32_t TypeDedup<ELFT>::findEntry(const Unit &U, uint64_t Off) {
+  auto It = std::lower_bound(
+      U.Entries.begin(), U.Entries.end(), Off,
+      [](const Entry &E, uint64_t Off) { return E.Offset < Off; });
+  if (It == U.Entries.end() || It->Offset != Off || !It->Abbr)
+    return -1;
+  return It - U.Entries.begin();
+}
+
+template <class ELFT>
+uint64_t TypeDedup<ELFT>::readValue(const Unit &U, Form F, uint32_t Off) {
+  Reader R(U.Data, Off);
+  switch (F) {
+  case DW_FORM_data1:
+  case DW_FORM_ref1:
+    return R.readFixed(1);
+  case DW_FORM_data2:
+  case DW_FORM_ref2:
+    return R.readFixed(2);
+  case DW_FORM_data4:
+  case DW_FORM_ref4:
+    return R.readFixed(4);
+  case DW_FORM_data8:
+  case DW_FORM_ref8:
+    return R.readFixed(8);
+  default:
+    return R.readULEB();
+  }
+}
+
+// Reads a section offset, which must be relocated against Sec.
+template <class ELFT>
+bool TypeDedup<ELFT>::readOffset(const Unit &U, Form F, uint32_t Off,
+                                 InputSectionBase *Sec, uint64_t &V) {
+  if (F != DW_FORM_data4 && F != DW_FORM_sec_offset && F != DW_FORM_strp)
+    return false;
+  auto It = findReloc(U, Off);
+  if (It == U.Relocs.end() || It->Offset != Off || !Sec ||
+      It->Target != Sec || It->Value >= Sec->Data.size())
+    return false;
+  V = It->Value;
+  return true;
+}
+
+template <class ELFT>
+bool TypeDedup<ELFT>::readString(const Unit &U, Form F, uint32_t Off,
+                                 StringRef &S) {
+  if (F == DW_FORM_string) {
+    Reader R(U.Data, Off);
+    S = R.readCStr();
+    return true;
+  }
+  uint64_t V;
+  if (!readOffset(U, F, Off, U.Str, V))
+    return false;
+  Reader R(U.Str->Data, V);
+  S = R.readCStr();
+  return !R.Err;
+}
+
+template <class ELFT>
+template <class RelTy>
+void TypeDedup<ELFT>::collectRelocs(Unit &U, ArrayRef<RelTy> Rels) {
+  for (size_t I = 0, E = Rels.size(); I != E; ++I) {
+    const RelTy &Rel = Rels[I];
+    InfoReloc R;
+    R.Offset = Rel.r_offset;
+    R.Index = I;
+    R.Type = Rel.getType(Config->IsMips64EL);
+    R.Target = nullptr;
+    R.Value = 0;
+    if (auto *D = dyn_cast<Defined>(&U.File->getRelocTargetSym(Rel))) {
+      int64_t Addend = getAddend<ELFT>(Rel);
+      if (!RelTy::IsRela && R.Offset + 4 <= U.Data.size())
+        Addend += Target->getImplicitAddend(U.Data.data() + R.Offset, R.Type);
+      R.Target = dyn_cast_or_null<InputSectionBase>(D->Section);
+      R.Value = D->Value + Addend;
+    }
+    U.Relocs.push_back(R);
+  }
+  std::stable_sort(U.Relocs.begin(), U.Relocs.end(),
+                   [](const InfoReloc &A, const InfoReloc &B) {
+                     return A.Offset < B.Offset;
+                   });
+}
+
+// Returns true if a relocation in Sec refers to a DIE in Info. DIE offsets
+// change when a unit is rewritten.
+template <class ELFT>
+template <class RelTy>
+bool TypeDedup<ELFT>::refersInto(InputSectionBase *Sec, InputSectionBase *Info,
+                                 ArrayRef<RelTy> Rels) {
+  ObjFile<ELFT> *File = Sec->getFile<ELFT>();
+  for (const RelTy &Rel : Rels) {
+    auto *D = dyn_cast<Defined>(&File->getRelocTargetSym(Rel));
+    if (!D || D->Section != Info)
+      continue;
+    int64_t Addend = getAddend<ELFT>(Rel);
+    if (!RelTy::IsRela && Rel.r_offset + 4 <= Sec->Data.size())
+      Addend += Target->getImplicitAddend(Sec->Data.data() + Rel.r_offset,
+                                          Rel.getType(Config->IsMips64EL));
+    if (D->Value + Addend != 0)
+      return true;
+  }
+  return false;
+}
+
+template <class ELFT>
+bool TypeDedup<ELFT>::parseAbbrevs(Unit &U, uint64_t Off) {
+  ArrayRef<uint8_t> Data = U.AbbrevSec->Data;
+  if (Off >= Data.size())
+    return false;
+
+  Reader R(Data, Off);
+  for (;;) {
+    uint32_t Begin = R.Off;
+    uint64_t Code = R.readULEB();
+    if (R.Err)
+      return false;
+    if (Code == 0) {
+      U.AbbrevEnd = Begin;
+      break;
+    }
+
+    Abbrev A;
+    A.Code = Code;
+    A.Tag = (dwarf::Tag)R.readULEB();
+    A.HasChildren = R.readFixed(1);
+    for (;;) {
+      uint64_t Attr = R.readULEB();
+      uint64_t F = R.readULEB();
+      if (R.Err)
+        return false;
+      if (Attr == 0 && F == 0)
+        break;
+      A.Attrs.push_back({(dwarf::Attribute)Attr, (dwarf::Form)F});
+    }
+    if (!U.AbbrevIndex.insert({Code, U.Abbrevs.size()}).second)
+      return false;
+    U.Abbrevs.push_back(std::move(A));
+    U.MaxCode = std::max(U.MaxCode, Code);
+  }
+
+  U.CanRewrite = llvm::all_of(Data.slice(R.Off), [](uint8_t C) {
+    return C == 0;
+  });
+  return true;
+}
+
+template <class ELFT> bool TypeDedup<ELFT>::parseEntries(Unit &U) {
+  std::vector<uint32_t> Stack;
+  Reader R(U.Data, HeaderSize);
+  while (R.Off < U.Data.size()) {
+    Entry E;
+    E.Offset = R.Off;
+    E.Parent = Stack.empty() ? -1 : Stack.back();
+    E.End = U.Entries.size() + 1;
+
+    uint64_t Code = R.readULEB();
+    if (R.Err)
+      return false;
+    if (Code == 0) {
+      E.Abbr = nullptr;
+      U.Entries.push_back(E);
+      if (!Stack.empty()) {
+        U.Entries[Stack.back()].End = U.Entries.size();
+        Stack.pop_back();
+      }
+      continue;
+    }
+
+    auto It = U.AbbrevIndex.find(Code);
+    if (It == U.AbbrevIndex.end())
+      return false;
+    E.Abbr = &U.Abbrevs[It->second];
+    for (const AttrSpec &A : E.Abbr->Attrs)
+      if (!skipValue(R, A.Form, U.AddrSize) || R.Err)
+        return false;
+    if (E.Abbr->HasChildren)
+      Stack.push_back(U.Entries.size());
+    U.Entries.push_back(E);
+  }
+
+  if (!Stack.empty() || U.Entries.empty() || !U.Entries[0].Abbr ||
+      U.Entries[0].Abbr->Tag != DW_TAG_compile_unit)
+    return false;
+
+  // Every reference must point to a DIE, since we need to know where it
+  // ends up.
+  for (const Entry &E : U.Entries) {
+    if (!E.Abbr)
+      continue;
+    bool Ok = true;
+    forEachAttr(U, E, [&](const AttrSpec &A, uint32_t Begin, uint32_t End) {
+      if (isRefForm(A.Form) && findEntry(U, readValue(U, A.Form, Begin)) < 0)
+        Ok = false;
+    });
+    if (!Ok)
+      return false;
+  }
+  return true;
+}
+
+// Reads the file names of a DWARF 2 to 4 line table, which DW_AT_decl_file
+// refers to by index.
+template <class ELFT>
+void TypeDedup<ELFT>::readFileNames(Unit &U, uint64_t Off, StringRef CompDir) {
+  Reader R(U.Line->Data, Off);
+  if (R.readFixed(4) >= 0xfffffff0)
+    return;
+  uint64_t Version = R.readFixed(2);
+  if (Version < 2 || Version > 4)
+    return;
+  R.skip(4);
+  R.skip(Version >= 4 ? 5 : 4);
+  uint64_t OpcodeBase = R.readFixed(1);
+  R.skip(OpcodeBase ? OpcodeBase - 1 : 0);
+
+  std::vector<StringRef> Dirs = {CompDir};
+  for (;;) {
+    StringRef Dir = R.readCStr();
+    if (R.Err || Dir.empty())
+      break;
+    Dirs.push_back(Dir);
+  }
+
+  std::vector<std::string> Names;
+  for (;;) {
+    StringRef Name = R.readCStr();
+    if (R.Err || Name.empty())
+      break;
+    uint64_t Dir = R.readULEB();
+    R.readULEB();
+    R.readULEB();
+    SmallString<128> Path;
+    if (!sys::path::is_absolute(Name) && Dir < Dirs.size())
+      Path = Dirs[Dir];
+    sys::path::append(Path, Name);
+    Names.push_back(Path.str().str());
+  }
+  if (!R.Err)
+    U.FileNames = std::move(Names);
+}
+
+template <class ELFT> bool TypeDedup<ELFT>::parse(Unit &U) {
+  auto Find = [&](StringRef Name, InputSectionBase *&Ret) {
+    for (InputSectionBase *Sec : U.File->getSections()) {
+      if (!Sec || Sec == &InputSection::Discarded || !Sec->Live ||
+          Sec->Name != Name)
+        continue;
+      if (Ret)
+        return false;
+      Ret = Sec;
+    }
+    if (Ret)
+      Ret->maybeDecompress();
+    return true;
+  };
+
+  InputSectionBase *Info = nullptr;
+  if (!Find(".debug_info", Info) || !Info || !isa<InputSection>(Info) ||
+      !Find(".debug_abbrev", U.AbbrevSec) || !U.AbbrevSec ||
+      U.AbbrevSec->NumRelocations || !Find(".debug_line", U.Line) ||
+      !Find(".debug_str", U.Str))
+    return false;
+  U.Info = cast<InputSection>(Info);
+  U.Data = U.Info->Data;
+
+  // A single compile unit in 32-bit DWARF 3 or 4 format.
+  if (U.Data.size() < HeaderSize || read32(U.Data.data()) + 4 != U.Data.size())
+    return false;
+  uint16_t Version = read16(U.Data.data() + 4);
+  if (Version != 3 && Version != 4)
+    return false;
+  U.AddrSize = U.Data[10];
+
+  if (U.Info->AreRelocsRela)
+    collectRelocs(U, U.Info->template relas<ELFT>());
+  else
+    collectRelocs(U, U.Info->template rels<ELFT>());
+
+  auto It = findReloc(U, 6);
+  if (It == U.Relocs.end() || It->Offset != 6 || It->Target != U.AbbrevSec)
+    return false;
+  U.AbsType = It->Type;
+  if (!parseAbbrevs(U, It->Value) || !parseEntries(U))
+    return false;
+
+  // Nothing else may refer to a DIE, except for name indices, which we
+  // discard.
+  for (Symbol *Sym : U.File->getSymbols())
+    if (auto *D = dyn_cast<Defined>(Sym))
+      if (D->Section == U.Info && D->Type != STT_SECTION)
+        return false;
+  for (InputSectionBase *Sec : U.File->getSections()) {
+    if (!Sec || Sec == &InputSection::Discarded || Sec == U.Info ||
+        (Sec->Flags & SHF_ALLOC) || !Sec->NumRelocations ||
+        isNameIndex(Sec->Name))
+      continue;
+    bool Refers = Sec->AreRelocsRela
+                      ? refersInto(Sec, U.Info, Sec->template relas<ELFT>())
+                      : refersInto(Sec, U.Info, Sec->template rels<ELFT>());
+    if (Refers)
+      return false;
+  }
+
+  // Read the file names of the line table for DW_AT_decl_file.
+  uint64_t StmtList = 0;
+  bool HasStmtList = false;
+  StringRef CompDir;
+  forEachAttr(U, U.Entries[0],
+              [&](const AttrSpec &A, uint32_t Begin, uint32_t End) {
+                if (A.Attr == DW_AT_stmt_list)
+                  HasStmtList = readOffset(U, A.Form, Begin, U.Line, StmtList);
+                else if (A.Attr == DW_AT_comp_dir)
+                  readString(U, A.Form, Begin, CompDir);
+              });
+  if (HasStmtList)
+    readFileNames(U, StmtList, CompDir);
+
+  findTrees(U);
+  return true;
+}
+
+// Finds the type trees of a unit and computes the hashes of their own
+// contents.
+template <class ELFT> void TypeDedup<ELFT>::findTrees(Unit &U) {
+  // Scope[I] is true if the children of entry I are at namespace scope.
+  std::vector<bool> Scope(U.Entries.size());
+  Scope[0] = true;
+
+  for (size_t I = 1, E = U.Entries.size(); I != E; ++I) {
+    Entry &Ent = U.Entries[I];
+    if (!Ent.Abbr || Ent.Parent < 0 || !Scope[Ent.Parent])
+      continue;
+
+    // Types in anonymous namespaces are local to their unit.
+    if (Ent.Abbr->Tag == DW_TAG_namespace) {
+      Scope[I] = llvm::any_of(Ent.Abbr->Attrs, [](const AttrSpec &A) {
+        return A.Attr == DW_AT_name;
+      });
+      continue;
+    }
+
+    if (!isTypeTag(Ent.Abbr->Tag))
+      continue;
+    for (uint32_t J = I; J != Ent.End; ++J)
+      U.Entries[J].Tree = U.Trees.size();
+    U.Trees.emplace_back(I);
+  }
+
+  for (TypeTree &T : U.Trees)
+    hashTree(U, T);
+}
+
+// References within a tree are hashed by their position in the tree, and
+// references to other trees by the position in that tree. The hashes of
+// the trees referred to are mixed in by refine().
+template <class ELFT> void TypeDedup<ELFT>::hashTree(Unit &U, TypeTree &T) {
+  uint32_t Begin = T.Root;
+  uint32_t End = U.Entries[Begin].End;
+
+  HashBuilder H;
+  H.add(End - Begin);
+  for (uint32_t I = Begin; I != End && T.Ok; ++I) {
+    const Entry &E = U.Entries[I];
+    if (!E.Abbr) {
+      H.add(0);
+      continue;
+    }
+
+    H.add(((uint64_t)E.Abbr->Tag << 1) | E.Abbr->HasChildren);
+    forEachAttr(U, E, [&](const AttrSpec &A, uint32_t Off, uint32_t OffEnd) {
+      if (!T.Ok || A.Attr == DW_AT_sibling)
+        return;
+      H.add(A.Attr);
+
+      if (isRefForm(A.Form)) {
+        uint32_t J = findEntry(U, readValue(U, A.Form, Off));
+        if (Begin <= J && J < End) {
+          H.add('L');
+          H.add(J - Begin);
+          return;
+        }
+        int32_t Other = U.Entries[J].Tree;
+        if (Other < 0) {
+          T.Ok = false;
+          return;
+        }
+        H.add('X');
+        H.add(J - U.Trees[Other].Root);
+        T.Refs.push_back(Other);
+        return;
+      }
+
+      if (A.Form == DW_FORM_string || A.Form == DW_FORM_strp) {
+        StringRef S;
+        if (!readString(U, A.Form, Off, S)) {
+          T.Ok = false;
+          return;
+        }
+        H.add('S');
+        H.add(S);
+        return;
+      }
+
+      if (A.Attr == DW_AT_decl_file && isConstantForm(A.Form)) {
+        uint64_t N = readValue(U, A.Form, Off);
+        if (N == 0 || N > U.FileNames.size()) {
+          T.Ok = false;
+          return;
+        }
+        H.add('F');
+        H.add(U.FileNames[N - 1]);
+        return;
+      }
+
+      if (hasRelocs(U, Off, OffEnd)) {
+        T.Ok = false;
+        return;
+      }
+      H.add(A.Form);
+      H.add(U.Data.slice(Off, OffEnd - Off));
+    });
+  }
+  T.Hash[0] = H.hash();
+}
+
+// Mixes the hashes of the trees each tree refers to into its own, until the
+// number of distinct hashes stops growing. A tree that refers to a tree we
+// cannot compare cannot be compared either.
+template <class ELFT> void TypeDedup<ELFT>::refine() {
+  auto Count = [&] {
+    std::vector<uint64_t> V;
+    for (Unit &U : Units)
+      for (TypeTree &T : U.Trees)
+        if (T.Ok)
+          V.push_back(T.Hash[Cur]);
+    std::sort(V.begin(), V.end());
+    size_t Distinct = std::unique(V.begin(), V.end()) - V.begin();
+    return std::make_pair(V.size(), Distinct);
+  };
+
+  std::pair<size_t, size_t> Prev = Count();
+  for (;;) {
+    parallelForEachN(0, Units.size(), [&](size_t I) {
+      Unit &U = Units[I];
+      for (TypeTree &T : U.Trees) {
+        if (!T.Ok)
+          continue;
+        HashBuilder H;
+        H.add(T.Hash[Cur]);
+        for (uint32_t R : T.Refs) {
+          TypeTree &Other = U.Trees[R];
+          T.Ok &= Other.Ok;
+          H.add(Other.Hash[Cur]);
+        }
+        T.Hash[1 - Cur] = H.hash();
+      }
+    });
+    Cur = 1 - Cur;
+
+    std::pair<size_t, size_t> Next = Count();
+    if (Next == Prev)
+      return;
+    Prev = Next;
+  }
+}
+
+// Keeps the first tree of each class and removes the others.
+template <class ELFT> void TypeDedup<ELFT>::selectCanonical() {
+  DenseMap<uint64_t, std::pair<uint32_t, uint32_t>> Leaders;
+  for (uint32_t I = 0, E = Units.size(); I != E; ++I) {
+    Unit &U = Units[I];
+    for (uint32_t J = 0, F = U.Trees.size(); J != F; ++J) {
+      TypeTree &T = U.Trees[J];
+      if (!T.Ok)
+        continue;
+      auto Ins = Leaders.insert({T.Hash[Cur], {I, J}});
+      if (Ins.second || !U.CanRewrite)
+        continue;
+
+      Unit &C = Units[Ins.first->second.first];
+      TypeTree &Canon = C.Trees[Ins.first->second.second];
+      const Entry &A = U.Entries[T.Root];
+      const Entry &B = C.Entries[Canon.Root];
+      if (A.End - T.Root != B.End - Canon.Root || A.Abbr->Tag != B.Abbr->Tag)
+        continue;
+
+      T.Removed = true;
+      T.CanonUnit = Ins.first->second.first;
+      T.CanonRoot = Canon.Root;
+      U.Rewrite = true;
+    }
+  }
+}
+
+static bool fitsIn(Form F, uint64_t V, uint32_t Size) {
+  switch (F) {
+  case DW_FORM_ref1:
+    return isUInt<8>(V);
+  case DW_FORM_ref2:
+    return isUInt<16>(V);
+  case DW_FORM_ref4:
+    return isUInt<32>(V);
+  case DW_FORM_ref8:
+    return true;
+  default:
+    return getULEB128Size(V) <= Size;
+  }
+}
+
+// Assigns new offsets to the entries of a unit that has removed trees.
+template <class ELFT> void TypeDedup<ELFT>::layout(Unit &U) {
+  size_t N = U.Entries.size();
+  U.Removed.resize(N);
+  for (TypeTree &T : U.Trees)
+    if (T.Removed)
+      for (uint32_t I = T.Root, E = U.Entries[T.Root].End; I != E; ++I)
+        U.Removed[I] = true;
+
+  U.NewOffsets.resize(N);
+  U.Variant.resize(N);
+  uint32_t Off = HeaderSize;
+  for (size_t I = 0; I != N; ++I) {
+    if (U.Removed[I])
+      continue;
+    U.NewOffsets[I] = Off;
+    const Entry &E = U.Entries[I];
+    if (!E.Abbr) {
+      ++Off;
+      continue;
+    }
+
+    // References to removed DIEs become DW_FORM_ref_addr, which needs an
+    // abbreviation of its own.
+    std::vector<bool> Changed;
+    uint32_t Size = 0;
+    forEachAttr(U, E, [&](const AttrSpec &A, uint32_t Begin, uint32_t End) {
+      bool C = isRefForm(A.Form) && A.Attr != DW_AT_sibling &&
+               U.Removed[findEntry(U, readValue(U, A.Form, Begin))];
+      Changed.push_back(C);
+      Size += C ? 4 : End - Begin;
+    });
+
+    uint64_t Code = E.Abbr->Code;
+    if (llvm::is_contained(Changed, true)) {
+      auto Ins = U.VariantIndex.insert(
+          {{E.Abbr, Changed}, (uint32_t)U.Variants.size() + 1});
+      if (Ins.second)
+        U.Variants.push_back({E.Abbr, Changed});
+      U.Variant[I] = Ins.first->second;
+      Code = U.MaxCode + U.Variant[I];
+    }
+    Off += getULEB128Size(Code) + Size;
+  }
+  U.NewSize = Off;
+
+  // DW_AT_sibling of a DIE followed by a removed tree points to the entry
+  // that follows the tree now.
+  uint32_t Next = Off;
+  for (size_t I = N; I--;) {
+    if (U.Removed[I])
+      U.NewOffsets[I] = Next;
+    else
+      Next = U.NewOffsets[I];
+  }
+
+  // An entry can also grow, as a DW_FORM_ref_addr value takes four bytes
+  // and a new abbreviation code may be longer. If a reference no longer
+  // fits in its form, the unit is left alone.
+  bool Ok = true;
+  for (size_t I = 0; I != N && Ok; ++I) {
+    if (U.Removed[I] || !U.Entries[I].Abbr)
+      continue;
+    forEachAttr(U, U.Entries[I],
+                [&](const AttrSpec &A, uint32_t Begin, uint32_t End) {
+                  if (!isRefForm(A.Form))
+                    return;
+                  uint32_t J = findEntry(U, readValue(U, A.Form, Begin));
+                  if (A.Attr == DW_AT_sibling || !U.Removed[J])
+                    Ok &= fitsIn(A.Form, U.NewOffsets[J], End - Begin);
+                });
+  }
+  if (Ok)
+    return;
+  U.Rewrite = false;
+  for (TypeTree &T : U.Trees)
+    T.Removed = false;
+}
+
+template <class ELFT> void TypeDedup<ELFT>::createSymbols(Unit &U) {
+  for (TypeTree &T : U.Trees) {
+    if (!T.Removed)
+      continue;
+    InputSection *Sec = Units[T.CanonUnit].Info;
+    if (!U.SymIndices.count(Sec))
+      U.SymIndices[Sec] = U.File->addLocalSymbol(
+          make<Defined>(U.File, "", STB_LOCAL, 0, STT_SECTION, 0, 0, Sec));
+  }
+
+  U.NewData = make<std::vector<uint8_t>>(U.NewSize);
+  if (U.Info->AreRelocsRela)
+    U.NewRelas = make<std::vector<typename ELFT::Rela>>();
+  else
+    U.NewRels = make<std::vector<typename ELFT::Rel>>();
+}
+
+// Adds the abbreviations for DIEs whose references have become
+// DW_FORM_ref_addr to the end of the abbreviation table.
+template <class ELFT> void TypeDedup<ELFT>::rewriteAbbrevs(Unit &U) {
+  ArrayRef<uint8_t> Old = U.AbbrevSec->Data;
+  auto *V = make<std::vector<uint8_t>>(Old.begin(), Old.begin() + U.AbbrevEnd);
+  for (size_t I = 0, E = U.Variants.size(); I != E; ++I) {
+    const Abbrev *A = U.Variants[I].first;
+    const std::vector<bool> &Changed = U.Variants[I].second;
+    appendULEB(*V, U.MaxCode + I + 1);
+    appendULEB(*V, A->Tag);
+    V->push_back(A->HasChildren);
+    for (size_t J = 0, F = A->Attrs.size(); J != F; ++J) {
+      appendULEB(*V, A->Attrs[J].Attr);
+      appendULEB(*V, Changed[J] ? DW_FORM_ref_addr : A->Attrs[J].Form);
+    }
+    V->push_back(0);
+    V->push_back(0);
+  }
+  V->insert(V->end(), Old.begin() + U.AbbrevEnd, Old.end());
+  U.AbbrevSec->Data = *V;
+}
+
+template <class ELFT>
+static void setAddend(typename ELFT::Rel &Rel, int64_t Addend) {
+  // SHT_REL addends are written to the section contents.
+}
+
+template <class ELFT>
+static void setAddend(typename ELFT::Rela &Rel, int64_t Addend) {
+  Rel.r_addend = Addend;
+}
+
+// Writes the new contents and relocations of a unit.
+template <class ELFT>
+template <class RelTy>
+void TypeDedup<ELFT>::emit(Unit &U, ArrayRef<RelTy> Rels,
+                           std::vector<RelTy> &Out) {
+  uint8_t *Buf = U.NewData->data();
+  auto CopyRelocs = [&](uint32_t Begin, uint32_t End, uint32_t To) {
+    for (auto It = findReloc(U, Begin);
+         It != U.Relocs.end() && It->Offset < End; ++It) {
+      RelTy Rel = Rels[It->Index];
+      Rel.r_offset = To + It->Offset - Begin;
+      Out.push_back(Rel);
+    }
+  };
+
+  memcpy(Buf, U.Data.data(), HeaderSize);
+  write32(Buf, U.NewSize - 4);
+  CopyRelocs(0, HeaderSize, 0);
+
+  for (size_t I = 0, N = U.Entries.size(); I != N; ++I) {
+    if (U.Removed[I])
+      continue;
+    const Entry &E = U.Entries[I];
+    uint8_t *P = Buf + U.NewOffsets[I];
+    if (!E.Abbr) {
+      *P = 0;
+      continue;
+    }
+
+    uint64_t Code = U.Variant[I] ? U.MaxCode + U.Variant[I] : E.Abbr->Code;
+    P += encodeULEB128(Code, P);
+    forEachAttr(U, E, [&](const AttrSpec &A, uint32_t Begin, uint32_t End) {
+      uint32_t Size = End - Begin;
+      if (!isRefForm(A.Form)) {
+        memcpy(P, U.Data.data() + Begin, Size);
+        CopyRelocs(Begin, End, P - Buf);
+        P += Size;
+        return;
+      }
+
+      uint32_t J = findEntry(U, readValue(U, A.Form, Begin));
+      if (A.Attr == DW_AT_sibling || !U.Removed[J]) {
+        writeRef(P, A.Form, U.NewOffsets[J], Size);
+        P += Size;
+        return;
+      }
+
+      // Refer to the same DIE in the kept copy of the tree.
+      const TypeTree &T = U.Trees[U.Entries[J].Tree];
+      const Unit &C = Units[T.CanonUnit];
+      uint32_t K = T.CanonRoot + J - T.Root;
+      uint64_t Off = C.Rewrite ? C.NewOffsets[K] : C.Entries[K].Offset;
+      write32(P, RelTy::IsRela ? 0 : Off);
+
+      RelTy Rel;
+      Rel.r_offset = P - Buf;
+      Rel.setSymbolAndType(U.SymIndices.lookup(C.Info), U.AbsType,
+                           Config->IsMips64EL);
+      setAddend<ELFT>(Rel, Off);
+      Out.push_back(Rel);
+      P += 4;
+    });
+  }
+}
+
+template <class ELFT> void TypeDedup<ELFT>::run() {
+  std::vector<Unit> All(ObjectFiles.size());
+  std::vector<uint8_t> Parsed(ObjectFiles.size());
+  parallelForEachN(0, ObjectFiles.size(), [&](size_t I) {
+    All[I].File = cast<ObjFile<ELFT>>(ObjectFiles[I]);
+    Parsed[I] = parse(All[I]);
+  });
+  for (size_t I = 0, E = All.size(); I != E; ++I)
+    if (Parsed[I])
+      Units.push_back(std::move(All[I]));
+  if (Units.empty())
+    return;
+
+  refine();
+  selectCanonical();
+
+  parallelForEachN(0, Units.size(), [&](size_t I) {
+    if (Units[I].Rewrite)
+      layout(Units[I]);
+  });
+
+  // make() is not thread-safe.
+  for (Unit &U : Units) {
+    if (U.Rewrite) {
+      createSymbols(U);
+      rewriteAbbrevs(U);
+    }
+  }
+
+  parallelForEachN(0, Units.size(), [&](size_t I) {
+    Unit &U = Units[I];
+    if (!U.Rewrite)
+      return;
+    if (U.Info->AreRelocsRela)
+      emit(U, U.Info->template relas<ELFT>(), *U.NewRelas);
+    else
+      emit(U, U.Info->template rels<ELFT>(), *U.NewRels);
+  });
+
+  for (Unit &U : Units) {
+    if (!U.Rewrite)
+      continue;
+    U.Info->Data = *U.NewData;
+    if (U.NewRelas) {
+      U.Info->FirstRelocation = U.NewRelas->data();
+      U.Info->NumRelocations = U.NewRelas->size();
+    } else {
+      U.Info->FirstRelocation = U.NewRels->data();
+      U.Info->NumRelocations = U.NewRels->size();
+    }
+    for (InputSectionBase *Sec : U.File->getSections())
+      if (Sec && Sec != &InputSection::Discarded && isNameIndex(Sec->Name))
+        Sec->Live = false;
+  }
+}
+
+template <class ELFT> void elf::dedupDebugTypes() { TypeDedup<ELFT>().run(); }
+
+template void elf::dedupDebugTypes<ELF32LE>();
+template void elf::dedupDebugTypes<ELF32BE>();
+template void elf::dedupDebugTypes<ELF64LE>();
+template void elf::dedupDebugTypes<ELF64BE>();
@@ -0,0 +1,23 @@
+//===- DebugTypes.h ---------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_DEBUG_TYPES_H
+#define LLD_ELF_DEBUG_TYPES_H
+
+namespace lld {
+namespace elf {
+
+// Removes type DIEs that are repeated across compile units for
+// --dedup-debug-types.
+template <class ELFT> void dedupDebugTypes();
+
+} // namespace elf
+} // namespace lld
+
+#endif
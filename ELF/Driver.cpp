@@ -24,7 +24,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "Driver.h"
+#include "Atomize.h"
 #include "Config.h"
+#include "DebugTypes.h"
 #include "Filesystem.h"
 #include "ICF.h"
 #include "InputFiles.h"
@@ -32,7 +34,9 @@
 #include "LinkerScript.h"
 #include "MarkLive.h"
 #include "OutputSections.h"
+#include "SampleProfile.h"
 #include "ScriptParser.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
@@ -41,19 +45,20 @@
 #include "lld/Common/Args.h"
 #include "lld/Common/Driver.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/LinkCache.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/TargetOptionsCommandFlags.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/TimeTrace.h"
 #include "lld/Common/Version.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compression.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
-#include "llvm/Support/TarWriter.h"
-#include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdlib>
 #include <utility>
@@ -71,18 +76,11 @@ LinkerDriver *elf::Driver;
 
 static void setConfigs(opt::InputArgList &Args);
 
-bool elf::link(ArrayRef<const char *> Args, bool CanExitEarly,
-               raw_ostream &Error) {
-  errorHandler().LogName = Args[0];
-  errorHandler().ErrorLimitExceededMsg =
-      "too many errors emitted, stopping now (use "
-      "-error-limit=0 to see all errors)";
-  errorHandler().ErrorOS = &Error;
-  errorHandler().ExitEarly = CanExitEarly;
-  errorHandler().ColorDiagnostics = Error.has_colors();
-
+static bool linkOnce(ArrayRef<const char *> Args, bool CanExitEarly) {
   InputSections.clear();
+  SecAux.clear();
   OutputSections.clear();
+  SymAux.clear();
   Tar = nullptr;
   BinaryFiles.clear();
   BitcodeFiles.clear();
@@ -93,20 +91,96 @@ bool elf::link(ArrayRef<const char *> Args, bool CanExitEarly,
   Driver = make<LinkerDriver>();
   Script = make<LinkerScript>();
   Symtab = make<SymbolTable>();
+  Stats = make<LinkStats>();
   Config->ProgName = Args[0];
 
   Driver->main(Args);
 
+  // Write out the files queued for --reproduce while the inputs are mapped.
+  finishTarWriters();
+
+  if (!Config->TimeTraceFile.empty())
+    writeTimeTrace(Config->TimeTraceFile);
+
   // Exit immediately if we don't need to return to the caller.
   // This saves time because the overhead of calling destructors
   // for all globally-allocated objects is not negligible.
   if (CanExitEarly)
     exitLld(errorCount() ? 1 : 0);
 
+  // A later link of the batch may use our output as an input.
+  if (InBatch)
+    forgetBatchFile(Config->OutputFile);
+
   freeArena();
   return !errorCount();
 }
 
+// --batch=<file> runs one link for each line of <file>, with the arguments
+// on that line appended to the other arguments of the command line. Empty
+// lines and lines starting with # are ignored. The links run one after
+// another in this process. Input files stay mapped, and archive symbol
+// tables stay indexed, from one link to the next, so inputs shared by the
+// links are opened and indexed only once.
+static bool linkBatch(ArrayRef<const char *> Args, size_t BatchIndex,
+                      bool CanExitEarly) {
+  StringRef Path = StringRef(Args[BatchIndex]).split('=').second;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getFile(Path);
+  if (auto EC = MBOrErr.getError()) {
+    error("--batch: cannot open " + Path + ": " + EC.message());
+    if (CanExitEarly)
+      exitLld(1);
+    return false;
+  }
+
+  BumpPtrAllocator Alloc;
+  StringSaver JobSaver(Alloc);
+  SmallVector<StringRef, 0> Lines;
+  (*MBOrErr)->getBuffer().split(Lines, '\n', -1, /*KeepEmpty=*/false);
+
+  bool Ok = true;
+  InBatch = true;
+  for (StringRef Line : Lines) {
+    Line = Line.trim();
+    if (Line.empty() || Line.startswith("#"))
+      continue;
+
+    SmallVector<const char *, 64> JobArgs;
+    for (size_t I = 0, E = Args.size(); I != E; ++I)
+      if (I != BatchIndex)
+        JobArgs.push_back(Args[I]);
+    cl::TokenizeGNUCommandLine(Line, JobSaver, JobArgs);
+
+    errorHandler().resetErrorCount();
+    if (!linkOnce(JobArgs, /*CanExitEarly=*/false))
+      Ok = false;
+  }
+  InBatch = false;
+  clearBatchCache();
+
+  if (CanExitEarly)
+    exitLld(Ok ? 0 : 1);
+  return Ok;
+}
+
+bool elf::link(ArrayRef<const char *> Args, bool CanExitEarly,
+               raw_ostream &Error) {
+  errorHandler().LogName = Args[0];
+  errorHandler().ErrorLimitExceededMsg =
+      "too many errors emitted, stopping now (use "
+      "-error-limit=0 to see all errors)";
+  errorHandler().ErrorOS = &Error;
+  errorHandler().ExitEarly = CanExitEarly;
+  errorHandler().ColorDiagnostics = Error.has_colors();
+
+  for (size_t I = 1, E = Args.size(); I != E; ++I) {
+    StringRef Arg = Args[I];
+    if (Arg.startswith("--batch=") || Arg.startswith("-batch="))
+      return linkBatch(Args, I, CanExitEarly);
+  }
+  return linkOnce(Args, CanExitEarly);
+}
+
 // Parses a linker -m option.
 static std::tuple<ELFKind, uint16_t, uint8_t> parseEmulation(StringRef Emul) {
   uint8_t OSABI = 0;
@@ -167,8 +241,10 @@ std::vector<std::pair<MemoryBufferRef, uint64_t>> static getArchiveMembers(
           toString(std::move(Err)));
 
   // Take ownership of memory buffers created for members of thin archives.
-  for (std::unique_ptr<MemoryBuffer> &MB : File->takeThinBuffers())
+  for (std::unique_ptr<MemoryBuffer> &MB : File->takeThinBuffers()) {
+    InputFileBytes += MB->getBufferSize();
     make<std::unique_ptr<MemoryBuffer>>(std::move(MB));
+  }
 
   return V;
 }
@@ -249,21 +325,54 @@ void LinkerDriver::addFile(StringRef Path, bool WithLOption) {
 
 // Add a given library by searching it from input search paths.
 void LinkerDriver::addLibrary(StringRef Name) {
-  if (Optional<std::string> Path = searchLibrary(Name))
+  addLibrary(Name, searchLibrary(Name));
+}
+
+// Add a library that has already been searched for.
+void LinkerDriver::addLibrary(StringRef Name, Optional<std::string> Path) {
+  if (Path)
     addFile(*Path, /*WithLOption=*/true);
   else
     error("unable to find library -l" + Name);
 }
 
-// This function is called on startup. We need this for LTO since
-// LTO calls LLVM functions to compile bitcode files to native code.
-// Technically this can be delayed until we read bitcode files, but
-// we don't bother to do lazily because the initialization is fast.
-static void initLLVM() {
-  InitializeAllTargets();
-  InitializeAllTargetMCs();
-  InitializeAllAsmPrinters();
-  InitializeAllAsmParsers();
+// Searches for the libraries given by -l, in parallel because each search
+// may probe every -L directory and long link lines name many libraries.
+// Whether a library may be a DSO depends on the -Bstatic and -Bdynamic
+// options before it, so they are followed here as createFiles does.
+static std::vector<Optional<std::string>>
+searchLibraries(opt::InputArgList &Args) {
+  std::vector<std::pair<StringRef, bool>> Libs;
+  std::vector<bool> Stack;
+  bool Static = Config->Static;
+  for (auto *Arg : Args) {
+    switch (Arg->getOption().getUnaliasedOption().getID()) {
+    case OPT_library:
+      Libs.push_back({Arg->getValue(), Static});
+      break;
+    case OPT_Bstatic:
+      Static = true;
+      break;
+    case OPT_Bdynamic:
+      Static = false;
+      break;
+    case OPT_push_state:
+      Stack.push_back(Static);
+      break;
+    case OPT_pop_state:
+      if (!Stack.empty()) {
+        Static = Stack.back();
+        Stack.pop_back();
+      }
+      break;
+    }
+  }
+
+  std::vector<Optional<std::string>> Paths(Libs.size());
+  parallelForEachN(0, Libs.size(), [&](size_t I) {
+    Paths[I] = searchLibrary(Libs[I].first, Libs[I].second);
+  });
+  return Paths;
 }
 
 // Some command line options or some combinations of them are not allowed.
@@ -277,9 +386,26 @@ static void checkOptions(opt::InputArgList &Args) {
   if (Config->FixCortexA53Errata843419 && Config->EMachine != EM_AARCH64)
     error("--fix-cortex-a53-843419 is only supported on AArch64 targets.");
 
+  if (Config->RelaxGot && Config->EMachine != EM_AARCH64)
+    error("--relax-got is only supported on AArch64 targets");
+
+  if (Config->AtomizeSections && Config->EMachine != EM_386 &&
+      Config->EMachine != EM_X86_64 && Config->EMachine != EM_AARCH64)
+    error("--atomize-sections is only supported on x86 and AArch64 targets");
+
   if (Config->Pie && Config->Shared)
     error("-shared and -pie may not be used together");
 
+  // Both read DIE offsets of input files, which --dedup-debug-types changes.
+  if (Config->DedupDebugTypes && Config->GdbIndex)
+    error("--dedup-debug-types and --gdb-index may not be used together");
+  if (Config->DedupDebugTypes && Config->DebugNames)
+    error("--dedup-debug-types and --debug-names may not be used together");
+
+  // -z hugepage-text needs a segment of its own for the text.
+  if (Config->ZCompactSegments && Config->ZHugepageText)
+    error("-z compact-segments and -z hugepage-text may not be used together");
+
   if (!Config->Shared && !Config->FilterList.empty())
     error("-F may not be used without -shared");
 
@@ -289,15 +415,33 @@ static void checkOptions(opt::InputArgList &Args) {
   if (!Config->Relocatable && !Config->DefineCommon)
     error("-no-define-common not supported in non relocatable output");
 
+  if (Config->WriteInPlace && !Config->MmapOutput)
+    error("--write-in-place and --no-mmap-output may not be used together");
+
+  if (Config->PrefaultOutput && !Config->MmapOutput)
+    error("--prefault-output and --no-mmap-output may not be used together");
+
+  if (!Config->ThinLTODistributor.empty() && Config->ThinLTOIndexOnly)
+    error("--thinlto-distributor and --plugin-opt=thinlto-index-only may not "
+          "be used together");
+
   if (Config->Relocatable) {
     if (Config->Shared)
       error("-r and -shared may not be used together");
+    if (Config->AtomizeSections)
+      error("-r and --atomize-sections may not be used together");
     if (Config->GcSections)
       error("-r and --gc-sections may not be used together");
-    if (Config->ICF)
+    if (Config->ICF != ICFLevel::None)
       error("-r and --icf may not be used together");
     if (Config->Pie)
       error("-r and -pie may not be used together");
+    if (Config->Incremental)
+      error("-r and --incremental may not be used together");
+    if (Config->DebugNames)
+      error("-r and --debug-names may not be used together");
+    if (Config->DedupDebugTypes)
+      error("-r and --dedup-debug-types may not be used together");
   }
 }
 
@@ -332,6 +476,9 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr) {
   // Interpret this flag early because error() depends on them.
   errorHandler().ErrorLimit = args::getInteger(Args, OPT_error_limit, 20);
 
+  if (Args.hasArg(OPT_batch))
+    error("--batch must be given on the command line");
+
   // Handle -help
   if (Args.hasArg(OPT_help)) {
     printHelp();
@@ -366,22 +513,45 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr) {
   if (const char *Path = getReproduceOption(Args)) {
     // Note that --reproduce is a debug option so you can ignore it
     // if you are trying to understand the whole picture of the code.
-    Expected<std::unique_ptr<TarWriter>> ErrOrWriter =
-        TarWriter::create(Path, path::stem(Path));
+    Expected<std::unique_ptr<AsyncTarWriter>> ErrOrWriter =
+        AsyncTarWriter::create(Path, path::stem(Path));
     if (ErrOrWriter) {
       Tar = ErrOrWriter->get();
-      Tar->append("response.txt", createResponseFile(Args));
-      Tar->append("version.txt", getLLDVersion() + "\n");
-      make<std::unique_ptr<TarWriter>>(std::move(*ErrOrWriter));
+      Tar->append("response.txt", Saver.save(createResponseFile(Args)));
+      Tar->append("version.txt", Saver.save(getLLDVersion() + "\n"));
+      make<std::unique_ptr<AsyncTarWriter>>(std::move(*ErrOrWriter));
     } else {
       error(Twine("--reproduce: failed to open ") + Path + ": " +
             toString(ErrOrWriter.takeError()));
     }
   }
 
+  // Start --time-trace before doing any real work so that the trace covers
+  // the whole link.
+  Config->TimeTraceFile = Args.getLastArgValue(OPT_time_trace_eq);
+  if (!Config->TimeTraceFile.empty())
+    startTimeTrace();
+  TimeTraceScope TotalScope("Total Link Time");
+
   readConfigs(Args);
-  initLLVM();
+
+  // Inputs are recorded for --link-cache as they are read, so the cache has
+  // to be set up before any file is opened. Links that write to stdout are
+  // not cached.
+  if (auto *Arg = Args.getLastArg(OPT_link_cache))
+    if (Config->OutputFile != "-" && Config->MapFile != "-")
+      Config->OutputCache = make<LinkCache>(
+          Arg->getValue(),
+          CHECK(parseCachePruningPolicy(
+                    Args.getLastArgValue(OPT_link_cache_policy)),
+                "--link-cache-policy: invalid cache policy"),
+          Args);
+
+  TimeTraceScope InputScope("Read input files");
   createFiles(Args);
+  InputScope.end();
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("reading input files");
   if (errorCount())
     return;
 
@@ -490,6 +660,31 @@ static DiscardPolicy getDiscard(opt::InputArgList &Args) {
   return DiscardPolicy::None;
 }
 
+static ICFLevel getICF(opt::InputArgList &Args) {
+  auto *Arg = Args.getLastArg(OPT_icf_none, OPT_icf_safe, OPT_icf_all);
+  if (!Arg || Arg->getOption().getID() == OPT_icf_none)
+    return ICFLevel::None;
+  if (Arg->getOption().getID() == OPT_icf_safe)
+    return ICFLevel::Safe;
+  return ICFLevel::All;
+}
+
+// Parses --pack-dyn-relocs. Returns whether Android packing and RELR packing
+// of relative relocations are requested.
+static std::pair<bool, bool> getPackDynRelocs(opt::InputArgList &Args) {
+  StringRef S = Args.getLastArgValue(OPT_pack_dyn_relocs, "none");
+  if (S == "android")
+    return {true, false};
+  if (S == "relr")
+    return {false, true};
+  if (S == "android+relr")
+    return {true, true};
+
+  if (S != "none")
+    error("unknown -pack-dyn-relocs format: " + S);
+  return {false, false};
+}
+
 static StringRef getDynamicLinker(opt::InputArgList &Args) {
   auto *Arg = Args.getLastArg(OPT_dynamic_linker, OPT_no_dynamic_linker);
   if (!Arg || Arg->getOption().getID() == OPT_no_dynamic_linker)
@@ -547,6 +742,24 @@ static SortSectionPolicy getSortSection(opt::InputArgList &Args) {
   return SortSectionPolicy::Default;
 }
 
+static MapFormatKind getMapFormat(opt::InputArgList &Args) {
+  StringRef S = Args.getLastArgValue(OPT_map_format, "text");
+  if (S == "json")
+    return MapFormatKind::Json;
+  if (S != "text")
+    error("unknown --map-format: " + S);
+  return MapFormatKind::Text;
+}
+
+static CallGraphSortKind getCallGraphSort(opt::InputArgList &Args) {
+  StringRef S = Args.getLastArgValue(OPT_call_graph_sort, "c3");
+  if (S == "hfsort+")
+    return CallGraphSortKind::HfsortPlus;
+  if (S != "c3")
+    error("unknown --call-graph-sort algorithm: " + S);
+  return CallGraphSortKind::C3;
+}
+
 static OrphanHandlingPolicy getOrphanHandling(opt::InputArgList &Args) {
   StringRef S = Args.getLastArgValue(OPT_orphan_handling, "place");
   if (S == "warn")
@@ -558,6 +771,15 @@ static OrphanHandlingPolicy getOrphanHandling(opt::InputArgList &Args) {
   return OrphanHandlingPolicy::Place;
 }
 
+static ThunkPlacementPolicy getThunkPlacement(opt::InputArgList &Args) {
+  StringRef S = Args.getLastArgValue(OPT_thunk_placement, "first");
+  if (S == "cover")
+    return ThunkPlacementPolicy::Cover;
+  if (S != "first")
+    error("unknown --thunk-placement mode: " + S);
+  return ThunkPlacementPolicy::First;
+}
+
 // Parse --build-id or --build-id=<style>. We handle "tree" as a
 // synonym for "sha1" because all our hash functions including
 // -build-id=sha1 are actually tree hashes for performance reasons.
@@ -587,30 +809,38 @@ getBuildId(opt::InputArgList &Args) {
   return {BuildIdKind::None, {}};
 }
 
-static void readCallGraph(MemoryBufferRef MB) {
+// Adds call graph edges between the sections that define the named
+// symbols to Config->CallGraphProfile. Source names the profile in
+// warnings. Functions with fewer samples than --call-graph-profile-min-samples
+// are left out, so that they stay with the unordered code.
+static void addCallGraphEdges(ArrayRef<CallGraphEdge> Edges,
+                              StringRef Source) {
   // Build a map from symbol name to section
   DenseMap<StringRef, const Symbol *> SymbolNameToSymbol;
   for (InputFile *File : ObjectFiles)
     for (Symbol *Sym : File->getSymbols())
       SymbolNameToSymbol[Sym->getName()] = Sym;
 
-  for (StringRef L : args::getLines(MB)) {
-    SmallVector<StringRef, 3> Fields;
-    L.split(Fields, ' ');
-    if (Fields.size() != 3)
-      fatal("parse error");
-    uint64_t Count;
-    if (!to_integer(Fields[2], Count))
-      fatal("parse error");
-    const Symbol *FromSym = SymbolNameToSymbol.lookup(Fields[0]);
-    const Symbol *ToSym = SymbolNameToSymbol.lookup(Fields[1]);
+  DenseMap<StringRef, uint64_t> Samples;
+  for (const CallGraphEdge &E : Edges) {
+    Samples[E.From] += E.Count;
+    if (E.To != E.From)
+      Samples[E.To] += E.Count;
+  }
+
+  for (const CallGraphEdge &E : Edges) {
+    const Symbol *FromSym = SymbolNameToSymbol.lookup(E.From);
+    const Symbol *ToSym = SymbolNameToSymbol.lookup(E.To);
     if (Config->WarnSymbolOrdering) {
       if (!FromSym)
-        warn("call graph file: no such symbol: " + Fields[0]);
+        warn(Source + ": no such symbol: " + E.From);
       if (!ToSym)
-        warn("call graph file: no such symbol: " + Fields[1]);
+        warn(Source + ": no such symbol: " + E.To);
     }
-    if (!FromSym || !ToSym || Count == 0)
+    if (!FromSym || !ToSym || E.Count == 0)
+      continue;
+    if (Samples[E.From] < Config->CallGraphProfileMinSamples ||
+        Samples[E.To] < Config->CallGraphProfileMinSamples)
       continue;
     warnUnorderableSymbol(FromSym);
     warnUnorderableSymbol(ToSym);
@@ -622,19 +852,75 @@ static void readCallGraph(MemoryBufferRef MB) {
     const auto *ToSB = dyn_cast_or_null<InputSectionBase>(ToSymD->Section);
     if (!FromSB || !ToSB)
       continue;
-    Config->CallGraphProfile[std::make_pair(FromSB, ToSB)] += Count;
+    Config->CallGraphProfile[std::make_pair(FromSB, ToSB)] += E.Count;
+  }
+}
+
+static void readCallGraph(MemoryBufferRef MB) {
+  std::vector<CallGraphEdge> Edges;
+  for (StringRef L : args::getLines(MB)) {
+    SmallVector<StringRef, 3> Fields;
+    L.split(Fields, ' ');
+    if (Fields.size() != 3)
+      fatal("parse error");
+    uint64_t Count;
+    if (!to_integer(Fields[2], Count))
+      fatal("parse error");
+    Edges.push_back({Fields[0], Fields[1], Count});
   }
+  addCallGraphEdges(Edges, "call graph file");
 }
 
-static bool getCompressDebugSections(opt::InputArgList &Args) {
+// Reads the sampled profiles given by --call-graph-profile-perf and
+// --call-graph-profile-autofdo.
+static void readSampleProfiles(opt::InputArgList &Args) {
+  if (auto *Arg = Args.getLastArg(OPT_call_graph_profile_perf)) {
+    StringRef Binary = Args.getLastArgValue(OPT_call_graph_profile_binary);
+    if (Binary.empty()) {
+      error("--call-graph-profile-perf requires --call-graph-profile-binary");
+    } else if (Optional<MemoryBufferRef> MB = readFile(Arg->getValue())) {
+      if (Optional<MemoryBufferRef> BinMB = readFile(Binary))
+        addCallGraphEdges(readPerfBranchProfile(*MB, *BinMB), Arg->getValue());
+    }
+  }
+  if (auto *Arg = Args.getLastArg(OPT_call_graph_profile_autofdo))
+    if (Optional<MemoryBufferRef> MB = readFile(Arg->getValue()))
+      addCallGraphEdges(readAutoFDOProfile(*MB), Arg->getValue());
+}
+
+static CompressionType getCompressDebugSections(opt::InputArgList &Args) {
   StringRef S = Args.getLastArgValue(OPT_compress_debug_sections, "none");
   if (S == "none")
-    return false;
-  if (S != "zlib")
-    error("unknown --compress-debug-sections value: " + S);
-  if (!zlib::isAvailable())
-    error("--compress-debug-sections: zlib is not available");
-  return true;
+    return CompressionType::None;
+  if (S == "zlib") {
+    if (!zlib::isAvailable())
+      error("--compress-debug-sections: zlib is not available");
+    return CompressionType::Zlib;
+  }
+  if (S == "zstd") {
+#ifndef LLD_HAS_ZSTD
+    error("--compress-debug-sections: zstd is not available");
+#endif
+    return CompressionType::Zstd;
+  }
+  error("unknown --compress-debug-sections value: " + S);
+  return CompressionType::None;
+}
+
+// Parses --compress-debug-sections-level. zlib defaults to the fastest
+// level unless -O2 is given because higher levels cost about twice the
+// time for a few percent smaller output. zstd's level 1 is both faster
+// and denser than that, so it is the default regardless of -O.
+static int getCompressDebugSectionsLevel(opt::InputArgList &Args) {
+  bool IsZlib = Config->CompressDebugSections == CompressionType::Zlib;
+  int Default = (IsZlib && Config->Optimize >= 2) ? 6 : 1;
+  int Level = args::getInteger(Args, OPT_compress_debug_sections_level,
+                               Default);
+  int Max = IsZlib ? 9 : 19;
+  if (Level < 1 || Level > Max)
+    error("--compress-debug-sections-level: level must be between 1 and " +
+          Twine(Max));
+  return Level;
 }
 
 static std::pair<StringRef, StringRef> getOldNewOptions(opt::InputArgList &Args,
@@ -676,20 +962,43 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   errorHandler().Verbose = Args.hasArg(OPT_verbose);
   errorHandler().FatalWarnings =
       Args.hasFlag(OPT_fatal_warnings, OPT_no_fatal_warnings, false);
-  ThreadsEnabled = Args.hasFlag(OPT_threads, OPT_no_threads, true);
+  ThreadsEnabled =
+      Args.hasFlag(OPT_threads, OPT_threads_eq, OPT_no_threads, true);
+  ThreadCount = 0;
+  if (Args.hasArg(OPT_threads_eq)) {
+    int N = args::getInteger(Args, OPT_threads_eq, 0);
+    if (N <= 0)
+      error("--threads: number of threads must be > 0");
+    else
+      ThreadCount = N;
+  }
 
   Config->AllowMultipleDefinition =
       Args.hasFlag(OPT_allow_multiple_definition,
                    OPT_no_allow_multiple_definition, false) ||
       hasZOption(Args, "muldefs");
+  Config->ArchiveIndexCacheDir =
+      Args.getLastArgValue(OPT_archive_index_cache_dir);
+  Config->AtomizeSections =
+      Args.hasFlag(OPT_atomize_sections, OPT_no_atomize_sections, false);
   Config->AuxiliaryList = args::getStrings(Args, OPT_auxiliary);
   Config->Bsymbolic = Args.hasArg(OPT_Bsymbolic);
   Config->BsymbolicFunctions = Args.hasArg(OPT_Bsymbolic_functions);
+  Config->CallGraphClusterSize =
+      args::getInteger(Args, OPT_call_graph_cluster_size, 1024 * 1024);
+  Config->CallGraphPageSize =
+      args::getInteger(Args, OPT_call_graph_page_size, 4096);
+  Config->CallGraphProfileMinSamples =
+      args::getInteger(Args, OPT_call_graph_profile_min_samples, 1);
+  Config->CallGraphSort = getCallGraphSort(Args);
   Config->CheckSections =
       Args.hasFlag(OPT_check_sections, OPT_no_check_sections, true);
   Config->Chroot = Args.getLastArgValue(OPT_chroot);
   Config->CompressDebugSections = getCompressDebugSections(Args);
   Config->Cref = Args.hasFlag(OPT_cref, OPT_no_cref, false);
+  Config->DebugNames = Args.hasFlag(OPT_debug_names, OPT_no_debug_names, false);
+  Config->DedupDebugTypes =
+      Args.hasFlag(OPT_dedup_debug_types, OPT_no_dedup_debug_types, false);
   Config->DefineCommon = Args.hasFlag(OPT_define_common, OPT_no_define_common,
                                       !Args.hasArg(OPT_relocatable));
   Config->Demangle = Args.hasFlag(OPT_demangle, OPT_no_demangle, true);
@@ -710,24 +1019,30 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->GcSections = Args.hasFlag(OPT_gc_sections, OPT_no_gc_sections, false);
   Config->GnuUnique = Args.hasFlag(OPT_gnu_unique, OPT_no_gnu_unique, true);
   Config->GdbIndex = Args.hasFlag(OPT_gdb_index, OPT_no_gdb_index, false);
-  Config->ICF = Args.hasFlag(OPT_icf_all, OPT_icf_none, false);
+  Config->GdbIndexCacheDir = Args.getLastArgValue(OPT_gdb_index_cache_dir);
+  Config->ICF = getICF(Args);
   Config->IgnoreDataAddressEquality =
       Args.hasArg(OPT_ignore_data_address_equality);
   Config->IgnoreFunctionAddressEquality =
       Args.hasArg(OPT_ignore_function_address_equality);
+  Config->Incremental =
+      Args.hasFlag(OPT_incremental, OPT_no_incremental, false);
   Config->Init = Args.getLastArgValue(OPT_init, "_init");
   Config->LTOAAPipeline = Args.getLastArgValue(OPT_lto_aa_pipeline);
   Config->LTODebugPassManager = Args.hasArg(OPT_lto_debug_pass_manager);
   Config->LTONewPassManager = Args.hasArg(OPT_lto_new_pass_manager);
   Config->LTONewPmPasses = Args.getLastArgValue(OPT_lto_newpm_passes);
+  Config->HashBloomBits = args::getInteger(Args, OPT_hash_bloom_bits, 12);
   Config->LTOO = args::getInteger(Args, OPT_lto_O, 2);
   Config->LTOObjPath = Args.getLastArgValue(OPT_plugin_opt_obj_path_eq);
   Config->LTOPartitions = args::getInteger(Args, OPT_lto_partitions, 1);
   Config->LTOSampleProfile = Args.getLastArgValue(OPT_lto_sample_profile);
   Config->MapFile = Args.getLastArgValue(OPT_Map);
+  Config->MapFormat = getMapFormat(Args);
   Config->MipsGotSize = args::getInteger(Args, OPT_mips_got_size, 0xfff0);
   Config->MergeArmExidx =
       Args.hasFlag(OPT_merge_exidx_entries, OPT_no_merge_exidx_entries, true);
+  Config->MmapOutput = Args.hasFlag(OPT_mmap_output, OPT_no_mmap_output, true);
   Config->NoinhibitExec = Args.hasArg(OPT_noinhibit_exec);
   Config->Nostdlib = Args.hasArg(OPT_nostdlib);
   Config->OFormatBinary = isOutputFormatBinary(Args);
@@ -735,14 +1050,24 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->OptRemarksFilename = Args.getLastArgValue(OPT_opt_remarks_filename);
   Config->OptRemarksWithHotness = Args.hasArg(OPT_opt_remarks_with_hotness);
   Config->Optimize = args::getInteger(Args, OPT_O, 1);
+  Config->CompressDebugSectionsLevel = getCompressDebugSectionsLevel(Args);
   Config->OrphanHandling = getOrphanHandling(Args);
   Config->OutputFile = Args.getLastArgValue(OPT_o);
   Config->Pie = Args.hasFlag(OPT_pie, OPT_no_pie, false);
+  Config->PrefaultOutput =
+      Args.hasFlag(OPT_prefault_output, OPT_no_prefault_output, false);
+  Config->PrefetchInputs =
+      Args.hasFlag(OPT_prefetch_inputs, OPT_no_prefetch_inputs, false);
   Config->PrintIcfSections =
       Args.hasFlag(OPT_print_icf_sections, OPT_no_print_icf_sections, false);
   Config->PrintGcSections =
       Args.hasFlag(OPT_print_gc_sections, OPT_no_print_gc_sections, false);
+  Config->PrintHashStats = Args.hasArg(OPT_print_hash_stats);
+  Config->PrintMemoryUsage = Args.hasArg(OPT_print_memory_usage);
+  Config->PrintStats = Args.hasArg(OPT_print_stats);
+  Config->ReduceMemoryOverheads = Args.hasArg(OPT_reduce_memory_overheads);
   Config->Rpath = getRpath(Args);
+  Config->RelaxGot = Args.hasFlag(OPT_relax_got, OPT_no_relax_got, false);
   Config->Relocatable = Args.hasArg(OPT_relocatable);
   Config->SaveTemps = Args.hasArg(OPT_save_temps);
   Config->SearchPaths = args::getStrings(Args, OPT_library_path);
@@ -755,10 +1080,14 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->Sysroot = Args.getLastArgValue(OPT_sysroot);
   Config->Target1Rel = Args.hasFlag(OPT_target1_rel, OPT_target1_abs, false);
   Config->Target2 = getTarget2(Args);
+  Config->ThunkPlacement = getThunkPlacement(Args);
   Config->ThinLTOCacheDir = Args.getLastArgValue(OPT_thinlto_cache_dir);
   Config->ThinLTOCachePolicy = CHECK(
       parseCachePruningPolicy(Args.getLastArgValue(OPT_thinlto_cache_policy)),
       "--thinlto-cache-policy: invalid cache policy");
+  Config->ThinLTODistributor = Args.getLastArgValue(OPT_thinlto_distributor);
+  Config->ThinLTODistributorFallback =
+      Args.getLastArgValue(OPT_thinlto_distributor_fallback);
   Config->ThinLTOEmitImportsFiles =
       Args.hasArg(OPT_plugin_opt_thinlto_emit_imports_files);
   Config->ThinLTOIndexOnly = Args.hasArg(OPT_plugin_opt_thinlto_index_only) ||
@@ -780,10 +1109,16 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   Config->WarnCommon = Args.hasFlag(OPT_warn_common, OPT_no_warn_common, false);
   Config->WarnSymbolOrdering =
       Args.hasFlag(OPT_warn_symbol_ordering, OPT_no_warn_symbol_ordering, true);
+  Config->WriteInPlace = Args.hasFlag(
+      OPT_write_in_place, OPT_no_write_in_place,
+      Config->Incremental && Config->MmapOutput);
   Config->ZCombreloc = getZFlag(Args, "combreloc", "nocombreloc", true);
+  Config->ZCompactSegments = hasZOption(Args, "compact-segments");
   Config->ZCopyreloc = getZFlag(Args, "copyreloc", "nocopyreloc", true);
   Config->ZExecstack = getZFlag(Args, "execstack", "noexecstack", false);
+  Config->ZGroupRelocatedData = hasZOption(Args, "group-relocated-data");
   Config->ZHazardplt = hasZOption(Args, "hazardplt");
+  Config->ZHugepageText = hasZOption(Args, "hugepage-text");
   Config->ZKeepTextSectionPrefix = getZFlag(
       Args, "keep-text-section-prefix", "nokeep-text-section-prefix", false);
   Config->ZNodelete = hasZOption(Args, "nodelete");
@@ -809,6 +1144,10 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
   for (auto *Arg : Args.filtered(OPT_mllvm))
     parseClangOption(Arg->getValue(), Arg->getSpelling());
 
+  if (Config->CallGraphPageSize == 0)
+    error("--call-graph-page-size: page size must be > 0");
+  if (Config->HashBloomBits == 0)
+    error("--hash-bloom-bits: number of bits must be > 0");
   if (Config->LTOO > 3)
     error("invalid optimization level for LTO: " + Twine(Config->LTOO));
   if (Config->LTOPartitions == 0)
@@ -850,17 +1189,15 @@ void LinkerDriver::readConfigs(opt::InputArgList &Args) {
 
   std::tie(Config->BuildId, Config->BuildIdVector) = getBuildId(Args);
 
-  if (auto *Arg = Args.getLastArg(OPT_pack_dyn_relocs)) {
-    StringRef S = Arg->getValue();
-    if (S == "android")
-      Config->AndroidPackDynRelocs = true;
-    else if (S != "none")
-      error("unknown -pack-dyn-relocs format: " + S);
-  }
+  std::tie(Config->AndroidPackDynRelocs, Config->RelrPackDynRelocs) =
+      getPackDynRelocs(Args);
 
   if (auto *Arg = Args.getLastArg(OPT_symbol_ordering_file))
     if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
       Config->SymbolOrderingFile = getSymbolOrderingFile(*Buffer);
+  if (auto *Arg = Args.getLastArg(OPT_data_ordering_file))
+    if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
+      Config->DataOrderingFile = getSymbolOrderingFile(*Buffer);
 
   // If --retain-symbol-file is used, we'll keep only the symbols listed in
   // the file and discard all others.
@@ -962,11 +1299,29 @@ void LinkerDriver::createFiles(opt::InputArgList &Args) {
   // For --{push,pop}-state.
   std::vector<std::tuple<bool, bool, bool>> Stack;
 
+  // Start reading the input files named on the command line, so that they
+  // are read concurrently rather than one after another. Libraries
+  // given by -l are not prefetched because where they are found depends
+  // on the options that precede them.
+  if (Config->PrefetchInputs)
+    for (auto *Arg : Args.filtered(OPT_INPUT))
+      prefetchFile(Arg->getValue());
+
+  // A linker script that we read may add search paths with SEARCH_DIR, in
+  // which case the libraries after it are searched for again.
+  std::vector<Optional<std::string>> LibPaths = searchLibraries(Args);
+  size_t NumSearchPaths = Config->SearchPaths.size();
+  size_t LibIdx = 0;
+
   // Iterate over argv to process input files and positional arguments.
   for (auto *Arg : Args) {
     switch (Arg->getOption().getUnaliasedOption().getID()) {
     case OPT_library:
-      addLibrary(Arg->getValue());
+      if (Config->SearchPaths.size() == NumSearchPaths)
+        addLibrary(Arg->getValue(), std::move(LibPaths[LibIdx]));
+      else
+        addLibrary(Arg->getValue());
+      ++LibIdx;
       break;
     case OPT_INPUT:
       addFile(Arg->getValue(), /*WithLOption=*/false);
@@ -1173,20 +1528,29 @@ template <class ELFT> static bool shouldDemote(Symbol &Sym) {
 // need to remove symbols that refer files that no longer exist, so that
 // they won't appear in the symbol table of the output file.
 //
-// We remove symbols by demoting them to undefined symbol.
+// We remove symbols by demoting them to undefined symbol. Each symbol is
+// rewritten in place, so the symbols are visited in parallel.
 template <class ELFT> static void demoteSymbols() {
-  for (Symbol *Sym : Symtab->getSymbols()) {
+  parallelForEach(Symtab->getSymbols(), [](Symbol *Sym) {
     if (shouldDemote<ELFT>(*Sym)) {
       bool Used = Sym->Used;
       replaceSymbol<Undefined>(Sym, nullptr, Sym->getName(), Sym->Binding,
                                Sym->StOther, Sym->Type);
       Sym->Used = Used;
     }
-  }
+  });
+}
+
+static void markAddrsig(Symbol *S) {
+  if (auto *D = dyn_cast_or_null<Defined>(S))
+    if (D->Section)
+      D->Section->KeepUnique = true;
 }
 
 // Record sections that define symbols mentioned in --keep-unique <symbol>
-// these sections are inelligible for ICF.
+// these sections are inelligible for ICF. With --icf=safe, sections whose
+// address is significant are inelligible too.
+template <class ELFT>
 static void findKeepUniqueSections(opt::InputArgList &Args) {
   for (auto *Arg : Args.filtered(OPT_keep_unique)) {
     StringRef Name = Arg->getValue();
@@ -1195,6 +1559,53 @@ static void findKeepUniqueSections(opt::InputArgList &Args) {
     else
       warn("could not find symbol " + Name + " to keep unique");
   }
+
+  if (Config->ICF != ICFLevel::Safe)
+    return;
+
+  // Symbols in the dynsym could be address-significant in other executables
+  // or DSOs, so we conservatively mark them as address-significant.
+  for (Symbol *S : Symtab->getSymbols())
+    if (S->includeInDynsym())
+      markAddrsig(S);
+
+  // Visit the address-significance table in each object file and mark each
+  // referenced symbol as address-significant.
+  for (InputFile *F : ObjectFiles) {
+    auto *Obj = cast<ObjFile<ELFT>>(F);
+    ArrayRef<Symbol *> Syms = Obj->getSymbols();
+    if (!Obj->AddrsigSec) {
+      // If an object file does not have an address-significance table,
+      // conservatively mark all of its symbols as address-significant.
+      for (Symbol *S : Syms)
+        markAddrsig(S);
+      continue;
+    }
+
+    ArrayRef<uint8_t> Contents =
+        CHECK(Obj->getObj().getSectionContents(Obj->AddrsigSec), Obj);
+    const uint8_t *Cur = Contents.begin();
+    while (Cur != Contents.end()) {
+      unsigned Size;
+      const char *Err;
+      uint64_t SymIndex = decodeULEB128(Cur, &Size, Contents.end(), &Err);
+      if (Err)
+        fatal(toString(F) + ": could not decode addrsig section: " + Err);
+      if (SymIndex >= Syms.size())
+        fatal(toString(F) + ": invalid symbol index in addrsig section: " +
+              Twine(SymIndex));
+      markAddrsig(Syms[SymIndex]);
+      Cur += Size;
+    }
+  }
+}
+
+// Returns the files a link may write, which are what --link-cache stores.
+static std::vector<std::string> getLinkCacheOutputs() {
+  std::vector<std::string> V = {Config->OutputFile};
+  if (!Config->MapFile.empty())
+    V.push_back(Config->MapFile);
+  return V;
 }
 
 // Do actual linking. Note that when this function is called,
@@ -1228,6 +1639,10 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   if (errorCount())
     return;
 
+  // Reuse the result of an identical earlier link if there is one.
+  if (Config->OutputCache && Config->OutputCache->fetch(getLinkCacheOutputs()))
+    return;
+
   // Use default entry point name if no name was given via the command
   // line nor linker scripts. For some reason, MIPS entry point name is
   // different from others.
@@ -1242,6 +1657,8 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
 
   // Add all files to the symbol table. This will add almost all
   // symbols that we need to the symbol table.
+  TimeTraceScope ResolveScope("Resolve symbols");
+  Symtab->preinsert<ELFT>(Files);
   for (InputFile *F : Files)
     Symtab->addFile<ELFT>(F);
 
@@ -1267,6 +1684,9 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   // to complete the symbol table. After this, no new names except a
   // few linker-synthesized ones will be added to the symbol table.
   handleUndefined<ELFT>(Config->Entry);
+  ResolveScope.end();
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("symbol resolution");
 
   // Return if there were name resolution errors.
   if (errorCount())
@@ -1308,7 +1728,11 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
 
   // Do link-time optimization if given files are LLVM bitcode files.
   // This compiles bitcode files into real object files.
+  TimeTraceScope LTOScope("LTO");
   Symtab->addCombinedLTOObject<ELFT>();
+  LTOScope.end();
+  if (Config->PrintMemoryUsage && !BitcodeFiles.empty())
+    printMemoryUsage("LTO");
   if (errorCount())
     return;
 
@@ -1332,13 +1756,6 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
     for (InputSectionBase *S : F->getSections())
       InputSections.push_back(cast<InputSection>(S));
 
-  // We do not want to emit debug sections if --strip-all
-  // or -strip-debug are given.
-  if (Config->Strip != StripPolicy::None)
-    llvm::erase_if(InputSections, [](InputSectionBase *S) {
-      return S->Name.startswith(".debug") || S->Name.startswith(".zdebug");
-    });
-
   Config->EFlags = Target->calcEFlags();
 
   if (Config->EMachine == EM_ARM) {
@@ -1364,21 +1781,54 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
 
   // Do size optimizations: garbage collection, merging of SHF_MERGE sections
   // and identical code folding.
-  decompressSections();
-  splitSections<ELFT>();
-  markLive<ELFT>();
-  demoteSymbols<ELFT>();
-  mergeSections();
-  if (Config->ICF) {
-    findKeepUniqueSections(Args);
+  {
+    TimeTraceScope Scope("Split sections");
+    decompressSections();
+    splitSections<ELFT>();
+    if (Config->AtomizeSections)
+      atomizeSections<ELFT>();
+  }
+  {
+    TimeTraceScope Scope("GC");
+    markLive<ELFT>();
+    demoteSymbols<ELFT>();
+  }
+  Stats->InputSections = InputSections.size();
+  Stats->LiveSections = llvm::count_if(
+      InputSections, [](InputSectionBase *S) { return S->Live; });
+  {
+    TimeTraceScope Scope("Merge sections");
+    mergeSections();
+  }
+  if (Config->ICF != ICFLevel::None) {
+    TimeTraceScope Scope("ICF");
+    findKeepUniqueSections<ELFT>(Args);
     doIcf<ELFT>();
   }
+  if (Config->DedupDebugTypes) {
+    TimeTraceScope Scope("Dedup debug types");
+    dedupDebugTypes<ELFT>();
+  }
 
   // Read the callgraph now that we know what was gced or icfed
   if (auto *Arg = Args.getLastArg(OPT_call_graph_ordering_file))
     if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
       readCallGraph(*Buffer);
+  readSampleProfiles(Args);
+
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("section optimizations");
 
   // Write the result to the file.
+  TimeTraceScope WriteScope("Write output");
   writeResult<ELFT>();
+  WriteScope.end();
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("writing the output");
+
+  if (Config->OutputCache && !errorCount())
+    Config->OutputCache->store(getLinkCacheOutputs());
+
+  if (Config->PrintStats)
+    printStats();
 }
@@ -29,6 +29,7 @@ public:
   void main(ArrayRef<const char *> Args);
   void addFile(StringRef Path, bool WithLOption);
   void addLibrary(StringRef Name);
+  void addLibrary(StringRef Name, llvm::Optional<std::string> Path);
 
 private:
   void readConfigs(llvm::opt::InputArgList &Args);
@@ -69,6 +70,7 @@ std::string createResponseFile(const llvm::opt::InputArgList &Args);
 llvm::Optional<std::string> findFromSearchPaths(StringRef Path);
 llvm::Optional<std::string> searchLinkerScript(StringRef Path);
 llvm::Optional<std::string> searchLibrary(StringRef Path);
+llvm::Optional<std::string> searchLibrary(StringRef Path, bool Static);
 
 } // namespace elf
 } // namespace lld
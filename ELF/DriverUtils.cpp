@@ -14,6 +14,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Driver.h"
+#include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Reproduce.h"
@@ -125,7 +126,7 @@ opt::InputArgList ELFOptTable::parse(ArrayRef<const char *> Argv) {
 
   // Expand response files (arguments in the form of @<filename>)
   // and then parse the argument again.
-  cl::ExpandResponseFiles(Saver, getQuotingStyle(Args), Vec);
+  args::expandResponseFiles(getQuotingStyle(Args), Vec);
   concatLTOPluginOptions(Vec);
   Args = this->ParseArgs(Vec, MissingIndex, MissingCount);
 
@@ -173,6 +174,7 @@ std::string elf::createResponseFile(const opt::InputArgList &Args) {
       // Strip directories to prevent the issue.
       OS << "-o " << quote(sys::path::filename(Arg->getValue())) << "\n";
       break;
+    case OPT_data_ordering_file:
     case OPT_dynamic_list:
     case OPT_library_path:
     case OPT_rpath:
@@ -214,11 +216,16 @@ Optional<std::string> elf::findFromSearchPaths(StringRef Path) {
 // This is for -lfoo. We'll look for libfoo.so or libfoo.a from
 // search paths.
 Optional<std::string> elf::searchLibrary(StringRef Name) {
+  return searchLibrary(Name, Config->Static);
+}
+
+// Same as above, but for a given -Bstatic state. This is thread-safe.
+Optional<std::string> elf::searchLibrary(StringRef Name, bool Static) {
   if (Name.startswith(":"))
     return findFromSearchPaths(Name.substr(1));
 
   for (StringRef Dir : Config->SearchPaths) {
-    if (!Config->Static)
+    if (!Static)
       if (Optional<std::string> S = findFile(Dir, "lib" + Name + ".so"))
         return S;
     if (Optional<std::string> S = findFile(Dir, "lib" + Name + ".a"))
@@ -13,13 +13,22 @@
 
 #include "Filesystem.h"
 #include "Config.h"
+#include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Threads.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
 #if LLVM_ON_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 #include <thread>
 
 using namespace llvm;
@@ -65,6 +74,35 @@ void elf::unlinkAsync(StringRef Path) {
 #endif
 }
 
+// Tells the kernel that Data, which is usually part of a mapped file, will
+// be read soon, so that it starts reading it into the page cache without
+// blocking the calling thread. This is a hint and may do nothing.
+void elf::adviseWillNeed(StringRef Data) {
+#if LLVM_ON_UNIX && defined(MADV_WILLNEED)
+  if (Data.empty())
+    return;
+  uintptr_t PageSize = getpagesize();
+  uintptr_t Begin = reinterpret_cast<uintptr_t>(Data.data()) & ~(PageSize - 1);
+  uintptr_t End = reinterpret_cast<uintptr_t>(Data.data()) + Data.size();
+  madvise(reinterpret_cast<void *>(Begin), End - Begin, MADV_WILLNEED);
+#endif
+}
+
+// Tells the kernel that the pages of Data, which must be part of a mapped
+// file that is not written to, are not needed anymore, so that they stop
+// counting toward our resident set. They are read back from the file if they
+// are accessed again. Only pages entirely within Data are released.
+void elf::adviseDontNeed(StringRef Data) {
+#if LLVM_ON_UNIX && defined(MADV_DONTNEED)
+  uintptr_t PageSize = getpagesize();
+  uintptr_t Begin = alignTo(reinterpret_cast<uintptr_t>(Data.data()), PageSize);
+  uintptr_t End = (reinterpret_cast<uintptr_t>(Data.data()) + Data.size()) &
+                  ~(PageSize - 1);
+  if (Begin < End)
+    madvise(reinterpret_cast<void *>(Begin), End - Begin, MADV_DONTNEED);
+#endif
+}
+
 // Simulate file creation to see if Path is writable.
 //
 // Determining whether a file is writable or not is amazingly hard,
@@ -84,3 +122,216 @@ std::error_code elf::tryCreateFile(StringRef Path) {
     return std::error_code();
   return errorToErrorCode(FileOutputBuffer::create(Path, 1).takeError());
 }
+
+MappedOutputBuffer::MappedOutputBuffer(
+    StringRef Path, sys::fs::TempFile T,
+    std::unique_ptr<sys::fs::mapped_file_region> Region)
+    : FileOutputBuffer(Path), Temp(std::move(T)), Region(std::move(Region)) {}
+
+MappedOutputBuffer::~MappedOutputBuffer() {
+  // Removes the temporary file unless commit() has renamed it.
+  Region.reset();
+  consumeError(Temp.discard());
+}
+
+Expected<std::unique_ptr<MappedOutputBuffer>>
+MappedOutputBuffer::create(StringRef Path, uint64_t Size, unsigned Flags,
+                           bool Prefault) {
+  unsigned Mode = sys::fs::all_read | sys::fs::all_write;
+  if (Flags & F_executable)
+    Mode |= sys::fs::all_exe;
+
+  Expected<sys::fs::TempFile> T =
+      sys::fs::TempFile::create(Path + ".tmp%%%%%%%", Mode);
+  if (!T)
+    return T.takeError();
+
+#if defined(__linux__)
+  // Allocating all blocks at once is cheaper than allocating them in page
+  // faults. Not all file systems support it, and the mapping works without.
+  if (Prefault)
+    posix_fallocate(T->FD, 0, Size);
+#endif
+
+  std::error_code EC = sys::fs::resize_file(T->FD, Size);
+  std::unique_ptr<sys::fs::mapped_file_region> Region;
+  if (!EC)
+    Region.reset(new sys::fs::mapped_file_region(
+        T->FD, sys::fs::mapped_file_region::readwrite, Size, 0, EC));
+  if (EC) {
+    consumeError(T->discard());
+    return errorCodeToError(EC);
+  }
+
+  std::unique_ptr<MappedOutputBuffer> Buf(
+      new MappedOutputBuffer(Path, std::move(*T), std::move(Region)));
+  if (Prefault)
+    Buf->prefault();
+  return std::move(Buf);
+}
+
+// Faults in all pages of the mapping. Transparent huge pages are requested
+// first where the file system supports them for file mappings, which
+// reduces the number of faults and TLB misses when writing sections.
+void MappedOutputBuffer::prefault() {
+  uint8_t *Buf = getBufferStart();
+  size_t Size = getBufferSize();
+
+#if defined(__linux__)
+#ifdef MADV_HUGEPAGE
+  madvise(Buf, Size, MADV_HUGEPAGE);
+#endif
+#ifdef MADV_POPULATE_WRITE
+  // Populates the whole range in one system call since Linux 5.14.
+  if (madvise(Buf, Size, MADV_POPULATE_WRITE) == 0)
+    return;
+#endif
+#endif
+
+  // Otherwise touch every page. The file is new, so writing zeros does not
+  // change its contents. Chunks are large enough that threads do not fault
+  // in pages that neighbour each other.
+  const size_t PageSize = 4096;
+  const size_t ChunkSize = 1024 * PageSize;
+  parallelForEachN(0, (Size + ChunkSize - 1) / ChunkSize, [&](size_t I) {
+    size_t End = std::min(Size, (I + 1) * ChunkSize);
+    for (size_t Off = I * ChunkSize; Off < End; Off += PageSize)
+      *reinterpret_cast<volatile uint8_t *>(Buf + Off) = 0;
+  });
+}
+
+Error MappedOutputBuffer::commit() {
+#if defined(_WIN32)
+  // A file that is mapped cannot be renamed on Windows.
+  Region.reset();
+  return Temp.keep(FinalPath);
+#else
+  if (Error E = Temp.keep(FinalPath))
+    return E;
+  if (!ThreadsEnabled) {
+    Region.reset();
+    return Error::success();
+  }
+
+  // The mapping is shared, so the renamed file already has the contents.
+  sys::fs::mapped_file_region *R = Region.release();
+  std::thread([=] { delete R; }).detach();
+  return Error::success();
+#endif
+}
+
+StreamOutputBuffer::StreamOutputBuffer(StringRef Path, sys::fs::TempFile T,
+                                       uint64_t Size)
+    : FileOutputBuffer(Path), Temp(std::move(T)),
+      OS(Temp.FD, /*shouldClose=*/false), Size(Size) {}
+
+StreamOutputBuffer::~StreamOutputBuffer() {
+  // A write error is reported by commit(). If we get here without calling
+  // it, the output is discarded anyway, so the error does not matter.
+  OS.flush();
+  OS.clear_error();
+
+  // Removes the temporary file unless commit() has renamed it.
+  consumeError(Temp.discard());
+
+  for (auto &KV : InputFDs)
+    if (KV.second != -1)
+      sys::Process::SafelyCloseFileDescriptor(KV.second);
+}
+
+Expected<std::unique_ptr<StreamOutputBuffer>>
+StreamOutputBuffer::create(StringRef Path, uint64_t Size, unsigned Flags) {
+  unsigned Mode = sys::fs::all_read | sys::fs::all_write;
+  if (Flags & F_executable)
+    Mode |= sys::fs::all_exe;
+
+  Expected<sys::fs::TempFile> T =
+      sys::fs::TempFile::create(Path + ".tmp%%%%%%%", Mode);
+  if (!T)
+    return T.takeError();
+
+  // Size the file up front so that sections can be written in any order.
+  // Gaps that are never written read as zeros, as in a mapped output.
+  if (std::error_code EC = sys::fs::resize_file(T->FD, Size)) {
+    consumeError(T->discard());
+    return errorCodeToError(EC);
+  }
+  return std::unique_ptr<StreamOutputBuffer>(
+      new StreamOutputBuffer(Path, std::move(*T), Size));
+}
+
+void StreamOutputBuffer::write(uint64_t Offset, ArrayRef<uint8_t> Data) {
+  OS.seek(Offset);
+  OS.write(reinterpret_cast<const char *>(Data.data()), Data.size());
+}
+
+uint64_t StreamOutputBuffer::copyFrom(uint64_t Offset, StringRef Path,
+                                      uint64_t InOffset, uint64_t Size) {
+#if defined(__linux__)
+  auto P = InputFDs.insert({Path, -1});
+  if (P.second) {
+    int FD;
+    if (!sys::fs::openFileForRead(Path, FD))
+      P.first->second = FD;
+  }
+  int InFD = P.first->second;
+  if (InFD == -1)
+    return 0;
+
+  // What has been written through OS must reach the file first, or it
+  // could overwrite the copied bytes later.
+  OS.flush();
+
+#ifdef FICLONERANGE
+  // A reflink shares whole blocks, so it needs block-aligned offsets. The
+  // size only needs to be aligned unless the range ends at the end of the
+  // input file, which it rarely does for an input section.
+  if (Offset % 4096 == 0 && InOffset % 4096 == 0 && Size % 4096 == 0) {
+    struct file_clone_range Range;
+    Range.src_fd = InFD;
+    Range.src_offset = InOffset;
+    Range.src_length = Size;
+    Range.dest_offset = Offset;
+    if (ioctl(Temp.FD, FICLONERANGE, &Range) == 0)
+      return Size;
+  }
+#endif
+
+#ifdef SYS_copy_file_range
+  // copy_file_range may copy less than asked for, and fails with EXDEV
+  // across file systems on older kernels, in which case the caller writes
+  // whatever is left.
+  uint64_t Done = 0;
+  while (Done < Size) {
+    loff_t In = InOffset + Done;
+    loff_t Out = Offset + Done;
+    ssize_t N = syscall(SYS_copy_file_range, InFD, &In, Temp.FD, &Out,
+                        size_t(Size - Done), 0u);
+    if (N <= 0)
+      break;
+    Done += N;
+  }
+  return Done;
+#endif
+#endif
+  return 0;
+}
+
+Expected<std::unique_ptr<MemoryBuffer>> StreamOutputBuffer::getContents() {
+  OS.flush();
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getOpenFile(
+      Temp.FD, Temp.TmpName, Size, /*RequiresNullTerminator=*/false);
+  if (!MBOrErr)
+    return errorCodeToError(MBOrErr.getError());
+  return std::move(*MBOrErr);
+}
+
+Error StreamOutputBuffer::commit() {
+  OS.flush();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return make_error<StringError>("write failed",
+                                   inconvertibleErrorCode());
+  }
+  return Temp.keep(FinalPath);
+}
@@ -11,12 +11,102 @@
 #define LLD_ELF_FILESYSTEM_H
 
 #include "lld/Common/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
 #include <system_error>
 
 namespace lld {
 namespace elf {
 void unlinkAsync(StringRef Path);
 std::error_code tryCreateFile(StringRef Path);
+void adviseWillNeed(StringRef Data);
+void adviseDontNeed(StringRef Data);
+
+// A memory-mapped output file. It differs from the one that
+// FileOutputBuffer::create returns in two ways. With Prefault, the blocks
+// of the file are allocated and the pages of the mapping faulted in up
+// front, in parallel, instead of one page at a time whenever a thread
+// writing a section touches a new one. And commit() renames the file into
+// place first and unmaps it on a background thread, because tearing down
+// the mapping of a large file takes a while and the output is complete
+// without it.
+class MappedOutputBuffer final : public llvm::FileOutputBuffer {
+public:
+  static llvm::Expected<std::unique_ptr<MappedOutputBuffer>>
+  create(StringRef Path, uint64_t Size, unsigned Flags, bool Prefault);
+
+  ~MappedOutputBuffer() override;
+
+  uint8_t *getBufferStart() const override {
+    return reinterpret_cast<uint8_t *>(Region->data());
+  }
+  uint8_t *getBufferEnd() const override {
+    return getBufferStart() + Region->size();
+  }
+  size_t getBufferSize() const override { return Region->size(); }
+
+  llvm::Error commit() override;
+
+private:
+  MappedOutputBuffer(
+      StringRef Path, llvm::sys::fs::TempFile Temp,
+      std::unique_ptr<llvm::sys::fs::mapped_file_region> Region);
+
+  void prefault();
+
+  llvm::sys::fs::TempFile Temp;
+  std::unique_ptr<llvm::sys::fs::mapped_file_region> Region;
+};
+
+// An output file that is written with explicit writes at given offsets
+// instead of through a memory mapping of the whole file. It is used for
+// --no-mmap-output, where the writer renders one section at a time into a
+// temporary buffer, so that peak memory usage is bounded by the largest
+// section rather than by the size of the output.
+//
+// Like FileOutputBuffer, it writes to a temporary file that is renamed to
+// the final path by commit() and removed otherwise.
+class StreamOutputBuffer final : public llvm::FileOutputBuffer {
+public:
+  static llvm::Expected<std::unique_ptr<StreamOutputBuffer>>
+  create(StringRef Path, uint64_t Size, unsigned Flags);
+
+  ~StreamOutputBuffer() override;
+
+  // There is no buffer to write into; use write() instead.
+  uint8_t *getBufferStart() const override { return nullptr; }
+  uint8_t *getBufferEnd() const override { return nullptr; }
+  size_t getBufferSize() const override { return Size; }
+
+  void write(uint64_t Offset, ArrayRef<uint8_t> Data);
+
+  // Copies Size bytes at InOffset in the file at Path to Offset, letting the
+  // kernel copy them from file to file or, on file systems that support it,
+  // share the blocks with the input file. Returns the number of bytes copied,
+  // which is less than Size if the rest has to be written with write().
+  uint64_t copyFrom(uint64_t Offset, StringRef Path, uint64_t InOffset,
+                    uint64_t Size);
+
+  // Maps what has been written so far read-only, e.g. to compute a build
+  // ID. The pages are backed by the file and can be evicted under pressure.
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> getContents();
+
+  llvm::Error commit() override;
+
+private:
+  StreamOutputBuffer(StringRef Path, llvm::sys::fs::TempFile Temp,
+                     uint64_t Size);
+
+  llvm::sys::fs::TempFile Temp;
+  llvm::raw_fd_ostream OS;
+  uint64_t Size;
+
+  // Input files opened by copyFrom, or -1 if they cannot be opened.
+  llvm::StringMap<int> InputFDs;
+};
 } // namespace elf
 } // namespace lld
 
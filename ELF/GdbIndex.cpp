@@ -29,18 +29,24 @@ template <class ELFT> LLDDwarfObj<ELFT>::LLDDwarfObj(ObjFile<ELFT> *Obj) {
   for (InputSectionBase *Sec : Obj->getSections()) {
     if (!Sec)
       continue;
+    if (Sec->Name.startswith(".debug"))
+      Sec->maybeDecompress();
     if (LLDDWARFSection *M = StringSwitch<LLDDWARFSection *>(Sec->Name)
                                  .Case(".debug_info", &InfoSection)
                                  .Case(".debug_ranges", &RangeSection)
                                  .Case(".debug_line", &LineSection)
+                                 .Case(".debug_names", &DebugNamesSection)
                                  .Default(nullptr)) {
-      Sec->maybeDecompress();
       M->Data = toStringRef(Sec->Data);
       M->Sec = Sec;
       continue;
     }
     if (Sec->Name == ".debug_abbrev")
       AbbrevSection = toStringRef(Sec->Data);
+    else if (Sec->Name == ".debug_pubnames")
+      PubNamesSection = toStringRef(Sec->Data);
+    else if (Sec->Name == ".debug_pubtypes")
+      PubTypesSection = toStringRef(Sec->Data);
     else if (Sec->Name == ".debug_gnu_pubnames")
       GnuPubNamesSection = toStringRef(Sec->Data);
     else if (Sec->Name == ".debug_gnu_pubtypes")
@@ -27,7 +27,10 @@ template <class ELFT> class LLDDwarfObj final : public llvm::DWARFObject {
   LLDDWARFSection InfoSection;
   LLDDWARFSection RangeSection;
   LLDDWARFSection LineSection;
+  LLDDWARFSection DebugNamesSection;
   StringRef AbbrevSection;
+  StringRef PubNamesSection;
+  StringRef PubTypesSection;
   StringRef GnuPubNamesSection;
   StringRef GnuPubTypesSection;
   StringRef StrSection;
@@ -48,10 +51,15 @@ public:
   const llvm::DWARFSection &getLineSection() const override {
     return LineSection;
   }
+  const llvm::DWARFSection &getDebugNamesSection() const override {
+    return DebugNamesSection;
+  }
   StringRef getFileName() const override { return ""; }
   StringRef getCUIndexSection() const override { return ""; }
   StringRef getAbbrevSection() const override { return AbbrevSection; }
   StringRef getStringSection() const override { return StrSection; }
+  StringRef getPubNamesSection() const override { return PubNamesSection; }
+  StringRef getPubTypesSection() const override { return PubTypesSection; }
   StringRef getGnuPubNamesSection() const override {
     return GnuPubNamesSection;
   }
@@ -75,6 +75,7 @@
 
 #include "ICF.h"
 #include "Config.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
@@ -123,6 +124,9 @@ private:
   // We repeat the main loop while `Repeat` is true.
   std::atomic<bool> Repeat;
 
+  // The number of classes split in the current iteration.
+  std::atomic<uint64_t> Splits{0};
+
   // The main loop counter.
   int Cnt = 0;
 
@@ -155,10 +159,58 @@ private:
 };
 }
 
-// Returns a hash value for S. Note that the information about
-// relocation targets is not included in the hash value.
+// Returns a hash value for the constant part of relocations RA, namely the
+// parts that constantEq requires to be equal. Addends of relocations
+// referring to MergeInputSections are left out because constantEq compares
+// their offsets in the output section instead.
+template <class ELFT, class RelTy>
+static hash_code hashRelocs(InputSection *S, ArrayRef<RelTy> RA) {
+  hash_code Hash = hash_value(RA.size());
+  for (const RelTy &Rel : RA) {
+    uint64_t Addend = getAddend<ELFT>(Rel);
+    Symbol &Sym = S->template getFile<ELFT>()->getRelocTargetSym(Rel);
+    if (auto *D = dyn_cast<Defined>(&Sym)) {
+      if (D->Section && isa<MergeInputSection>(D->Section))
+        Addend = 0;
+      else
+        Addend += D->Value;
+    }
+    Hash = hash_combine(Hash, uint64_t(Rel.r_offset),
+                        Rel.getType(Config->IsMips64EL), Addend);
+  }
+  return Hash;
+}
+
+// Returns a hash value for S. Relocation targets are not included in the
+// hash value; combineRelocHashes adds the classes of the target sections.
 template <class ELFT> static uint32_t getHash(InputSection *S) {
-  return hash_combine(S->Flags, S->getSize(), S->NumRelocations, S->Data);
+  hash_code Hash =
+      hash_combine(S->Flags, S->getSize(), S->NumRelocations, S->Data);
+  if (!S->NumRelocations)
+    return Hash;
+  if (S->AreRelocsRela)
+    return hash_combine(Hash, hashRelocs<ELFT>(S, S->template relas<ELFT>()));
+  return hash_combine(Hash, hashRelocs<ELFT>(S, S->template rels<ELFT>()));
+}
+
+// Combines the hash of S in Class[Round % 2] with the classes of the
+// InputSections its relocations refer to, and stores the result in
+// Class[(Round + 1) % 2]. Sections that end up in the same equivalence class
+// refer to sections in the same classes, so they still get the same hash,
+// but sections that only differ in their relocation targets are told apart
+// before the first refinement iteration.
+template <class ELFT, class RelTy>
+static void combineRelocHashes(unsigned Round, InputSection *S,
+                               ArrayRef<RelTy> RA) {
+  uint32_t Hash = S->Class[Round % 2];
+  for (const RelTy &Rel : RA) {
+    Symbol &Sym = S->template getFile<ELFT>()->getRelocTargetSym(Rel);
+    if (auto *D = dyn_cast<Defined>(&Sym))
+      if (auto *Target = dyn_cast_or_null<InputSection>(D->Section))
+        // Set MSB to 1 to avoid collisions with non-hash IDs.
+        Hash = hash_combine(Hash, Target->Class[Round % 2]) | (1U << 31);
+  }
+  S->Class[(Round + 1) % 2] = Hash;
 }
 
 // Returns true if section S is subject of ICF.
@@ -173,8 +225,11 @@ static bool isEligible(InputSection *S) {
     return false;
 
   // Don't merge read only data sections unless
-  // --ignore-data-address-equality was passed.
-  if (!(S->Flags & SHF_EXECINSTR) && !Config->IgnoreDataAddressEquality)
+  // --ignore-data-address-equality or --icf=safe was passed. With
+  // --icf=safe, the sections whose address is significant have already
+  // been marked KeepUnique.
+  if (!(S->Flags & SHF_EXECINSTR) &&
+      !(Config->IgnoreDataAddressEquality || Config->ICF == ICFLevel::Safe))
     return false;
 
   // Don't merge synthetic sections as their Data member is not valid and empty.
@@ -227,8 +282,10 @@ void ICF<ELFT>::segregate(size_t Begin, size_t End, bool Constant) {
       Sections[I]->Class[Next] = Mid;
 
     // If we created a group, we need to iterate the main loop again.
-    if (Mid != End)
+    if (Mid != End) {
       Repeat = true;
+      ++Splits;
+    }
 
     Begin = Mid;
   }
@@ -400,6 +457,7 @@ void ICF<ELFT>::forEachClass(std::function<void(size_t, size_t)> Fn) {
   // too small to use threading, call Fn sequentially.
   if (!ThreadsEnabled || Sections.size() < 1024) {
     forEachClassRange(0, Sections.size(), Fn);
+    Stats->ICFSplitsPerIteration.push_back(Splits.exchange(0));
     ++Cnt;
     return;
   }
@@ -425,6 +483,7 @@ void ICF<ELFT>::forEachClass(std::function<void(size_t, size_t)> Fn) {
     if (Boundaries[I - 1] < Boundaries[I])
       forEachClassRange(Boundaries[I - 1], Boundaries[I], Fn);
   });
+  Stats->ICFSplitsPerIteration.push_back(Splits.exchange(0));
   ++Cnt;
 }
 
@@ -447,6 +506,19 @@ template <class ELFT> void ICF<ELFT>::run() {
     S->Class[0] = getHash<ELFT>(S) | (1 << 31);
   });
 
+  // Mix the hashes of relocation targets into the hashes twice, so that
+  // sections calling different functions rarely start out in the same
+  // class. Each round reads one slot of Class and writes the other, and the
+  // result ends up back in Class[0].
+  for (unsigned Round = 0; Round != 2; ++Round) {
+    parallelForEach(Sections, [&](InputSection *S) {
+      if (S->AreRelocsRela)
+        combineRelocHashes<ELFT>(Round, S, S->template relas<ELFT>());
+      else
+        combineRelocHashes<ELFT>(Round, S, S->template rels<ELFT>());
+    });
+  }
+
   // From now on, sections in Sections vector are ordered so that sections
   // in the same equivalence class are consecutive in the vector.
   std::stable_sort(Sections.begin(), Sections.end(),
@@ -465,12 +537,14 @@ template <class ELFT> void ICF<ELFT>::run() {
   } while (Repeat);
 
   log("ICF needed " + Twine(Cnt) + " iterations");
+  Stats->ICFIterations = Cnt;
 
   // Merge sections by the equivalence class.
   forEachClassRange(0, Sections.size(), [&](size_t Begin, size_t End) {
     if (End - Begin == 1)
       return;
     print("selected section " + toString(Sections[Begin]));
+    Stats->ICFFolded += End - Begin - 1;
     for (size_t I = Begin + 1; I < End; ++I) {
       print("  removing identical section " + toString(Sections[I]));
       Sections[Begin]->replace(Sections[I]);
@@ -478,7 +552,7 @@ template <class ELFT> void ICF<ELFT>::run() {
       // At this point we know sections merged are fully identical and hence
       // we want to remove duplicate implicit dependencies such as link order
       // and relocation sections.
-      for (InputSection *IS : Sections[I]->DependentSections)
+      for (InputSection *IS : Sections[I]->dependentSections())
         IS->Live = false;
     }
   });
@@ -0,0 +1,216 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// --incremental keeps the layout of the output stable from one link to the
+// next, so that a relink after a small change rewrites only a small part of
+// a large output file.
+//
+// The first link leaves free space after each input section and records, in
+// <output>.incr, how many bytes it reserved for every section. A later link
+// reserves the same number of bytes for each section again. If the same
+// input sections are linked and each of them still fits in its slot, every
+// section that did not change keeps its address and file offset. Together
+// with --write-in-place, which --incremental turns on, only the pages that
+// really changed are written to the output file.
+//
+// If a section outgrew its slot, sections were added or removed, or the set
+// of global symbols changed, the output is laid out from scratch with new
+// slots. A new symbol may add an entry to .dynsym or .got and so move every
+// section after them, which is why the symbol set is compared at all.
+//
+// Every input file is still read and every relocation applied. The state
+// only decides where sections go, so the output of an incremental link is
+// always a complete and correct link of its inputs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Config.h"
+#include "InputFiles.h"
+#include "InputSection.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+
+using namespace lld;
+using namespace lld::elf;
+
+static const char StateMagic[] = "lld-incremental 1";
+
+// The number of bytes reserved for each input section in this link.
+static DenseMap<const InputSection *, uint64_t> Slots;
+static uint64_t SymbolHash;
+
+static std::string getStatePath() {
+  return (Config->OutputFile + ".incr").str();
+}
+
+// A quarter of the section size is left free, so that a function can grow by
+// a few instructions before the layout has to change.
+static uint64_t getPadding(uint64_t Size) {
+  if (Size == 0)
+    return 0;
+  return std::max<uint64_t>(alignTo(Size / 4, 16), 16);
+}
+
+// The sum of the hashes of the names of all defined and shared symbols. It
+// does not depend on the order in which the symbols were added.
+static uint64_t hashSymbolSet() {
+  uint64_t Hash = 0;
+  for (Symbol *Sym : Symtab->getSymbols())
+    if (Sym->isDefined() || Sym->isShared())
+      Hash += xxHash64(Sym->getName());
+  return Hash;
+}
+
+// Calls Callback for each input section that is placed in the output, with the
+// name of its file and its index in that file.
+template <class Fn> static void forEachPlacedSection(Fn Callback) {
+  for (InputFile *F : ObjectFiles) {
+    std::string FileName = toString(F);
+    ArrayRef<InputSectionBase *> Sections = F->getSections();
+    for (size_t I = 0, E = Sections.size(); I != E; ++I) {
+      auto *IS = dyn_cast_or_null<InputSection>(Sections[I]);
+      if (IS && IS != &InputSection::Discarded && IS->Live && IS->getParent())
+        Callback(FileName, I, IS);
+    }
+  }
+}
+
+namespace {
+struct State {
+  uint64_t SymbolHash = 0;
+  size_t NumSections = 0;
+  StringMap<DenseMap<uint32_t, uint64_t>> Slots;
+};
+} // namespace
+
+// Parses a state file. The format is line based:
+//
+//   lld-incremental 1
+//   symbols <hash of the symbol set>
+//   file <name>
+//   <section index> <slot size>
+//   ...
+static bool readState(StringRef Data, State &S) {
+  SmallVector<StringRef, 0> Lines;
+  Data.split(Lines, '\n', -1, /*KeepEmpty=*/false);
+  if (Lines.size() < 2 || Lines[0] != StateMagic ||
+      !Lines[1].consume_front("symbols ") ||
+      Lines[1].getAsInteger(16, S.SymbolHash))
+    return false;
+
+  DenseMap<uint32_t, uint64_t> *Cur = nullptr;
+  for (StringRef Line : makeArrayRef(Lines).slice(2)) {
+    if (Line.consume_front("file ")) {
+      Cur = &S.Slots[Line];
+      continue;
+    }
+    StringRef Index, Slot;
+    std::tie(Index, Slot) = Line.split(' ');
+    uint32_t I;
+    uint64_t Size;
+    if (!Cur || Index.getAsInteger(10, I) || Slot.getAsInteger(10, Size))
+      return false;
+    (*Cur)[I] = Size;
+    ++S.NumSections;
+  }
+  return true;
+}
+
+// Returns an empty string if the previous layout can be reused, or the reason
+// why it cannot.
+static std::string reuseState(const State &Old) {
+  if (Old.SymbolHash != SymbolHash)
+    return "the set of symbols changed";
+
+  size_t NumSections = 0;
+  std::string Reason;
+  forEachPlacedSection([&](StringRef FileName, uint32_t I, InputSection *IS) {
+    ++NumSections;
+    if (!Reason.empty())
+      return;
+    auto FileIt = Old.Slots.find(FileName);
+    if (FileIt == Old.Slots.end()) {
+      Reason = FileName.str() + " was not linked before";
+      return;
+    }
+    auto It = FileIt->second.find(I);
+    if (It == FileIt->second.end())
+      Reason = toString(IS) + " was not linked before";
+    else if (IS->getSize() > It->second)
+      Reason = toString(IS) + " grew past its reserved space";
+    else
+      Slots[IS] = It->second;
+  });
+  if (Reason.empty() && NumSections != Old.NumSections)
+    Reason = "input sections were removed";
+  return Reason;
+}
+
+void elf::prepareIncrementalLayout() {
+  Slots.clear();
+  SymbolHash = hashSymbolSet();
+
+  std::string Path = getStatePath();
+  std::string Reason;
+  State Old;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getFile(Path);
+  if (!MBOrErr)
+    Reason = "there is no previous state";
+  else if (!readState((*MBOrErr)->getBuffer(), Old))
+    Reason = Path + " is not a valid state file";
+  else
+    Reason = reuseState(Old);
+
+  if (Reason.empty()) {
+    log("--incremental: reusing the layout of the previous link");
+    return;
+  }
+
+  log("--incremental: laying out from scratch because " + Reason);
+  Slots.clear();
+  forEachPlacedSection([&](StringRef, uint32_t, InputSection *IS) {
+    Slots[IS] = IS->getSize() + getPadding(IS->getSize());
+  });
+}
+
+uint64_t elf::getIncrementalSlotSize(const InputSection *S) {
+  auto It = Slots.find(S);
+  return It == Slots.end() ? S->getSize() : It->second;
+}
+
+void elf::writeIncrementalState() {
+  std::string Path = getStatePath();
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Path + ": " + EC.message());
+    return;
+  }
+
+  OS << StateMagic << "\nsymbols " << utohexstr(SymbolHash) << "\n";
+  InputFile *LastFile = nullptr;
+  forEachPlacedSection([&](StringRef FileName, uint32_t I, InputSection *IS) {
+    if (IS->File != LastFile) {
+      LastFile = IS->File;
+      OS << "file " << FileName << "\n";
+    }
+    OS << I << " " << getIncrementalSlotSize(IS) << "\n";
+  });
+}
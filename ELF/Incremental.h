@@ -0,0 +1,34 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_INCREMENTAL_H
+#define LLD_ELF_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+#include <cstdint>
+
+namespace lld {
+namespace elf {
+
+class InputSection;
+
+// Reads the layout of the previous --incremental link and decides whether
+// this link can reuse it. Must be called once output sections are known.
+void prepareIncrementalLayout();
+
+// Returns the number of bytes to reserve for S, which is at least its size.
+uint64_t getIncrementalSlotSize(const InputSection *S);
+
+// Records the layout of this link for the next one.
+void writeIncrementalState();
+
+} // namespace elf
+} // namespace lld
+
+#endif
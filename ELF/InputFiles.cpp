@@ -8,14 +8,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "InputFiles.h"
+#include "Filesystem.h"
 #include "InputSection.h"
 #include "LinkerScript.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/LinkCache.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/TargetOptionsCommandFlags.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/BinaryFormat/Magic.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/IR/LLVMContext.h"
@@ -26,14 +32,17 @@
 #include "llvm/Support/ARMAttributeParser.h"
 #include "llvm/Support/ARMBuildAttributes.h"
 #include "llvm/Support/Path.h"
-#include "llvm/Support/TarWriter.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Support/raw_ostream.h"
+#include <map>
 
 using namespace llvm;
 using namespace llvm::ELF;
 using namespace llvm::object;
 using namespace llvm::sys;
 using namespace llvm::sys::fs;
+using namespace llvm::support::endian;
 
 using namespace lld;
 using namespace lld::elf;
@@ -46,7 +55,7 @@ std::vector<LazyObjFile *> elf::LazyObjFiles;
 std::vector<InputFile *> elf::ObjectFiles;
 std::vector<InputFile *> elf::SharedFiles;
 
-TarWriter *elf::Tar;
+AsyncTarWriter *elf::Tar;
 
 InputFile::InputFile(Kind K, MemoryBufferRef M)
     : MB(M), GroupId(NextGroupId), FileKind(K) {
@@ -56,15 +65,130 @@ InputFile::InputFile(Kind K, MemoryBufferRef M)
     ++NextGroupId;
 }
 
-Optional<MemoryBufferRef> elf::readFile(StringRef Path) {
-  // The --chroot option changes our virtual root directory.
-  // This is useful when you are dealing with files created by --reproduce.
+// The --chroot option changes our virtual root directory.
+// This is useful when you are dealing with files created by --reproduce.
+static StringRef applyChroot(StringRef Path) {
   if (!Config->Chroot.empty() && Path.startswith("/"))
-    Path = Saver.save(Config->Chroot + Path);
+    return Saver.save(Config->Chroot + Path);
+  return Path;
+}
+
+namespace {
+// A file that is being read by --prefetch-inputs.
+struct PrefetchedFile {
+  std::shared_future<void> Done;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB = std::error_code();
+};
+} // namespace
+
+static StringMap<PrefetchedFile> PrefetchedFiles;
+
+bool elf::InBatch;
+
+namespace {
+// A file that --batch keeps for the following links. For an archive,
+// ArchiveIndex is its symbol table in the --archive-index-cache-dir format.
+struct BatchFile {
+  std::unique_ptr<MemoryBuffer> MB;
+  std::string ArchiveIndex;
+};
+} // namespace
+
+static StringMap<BatchFile> BatchFiles;
+
+// Files are opened on a pool of their own because the threads mostly wait
+// for I/O. It is declared after PrefetchedFiles so that it is destroyed,
+// and waits for its tasks, first.
+static std::unique_ptr<ThreadPool> PrefetchPool;
+
+// Opens a file on a background thread and faults in its pages, so that
+// readFile finds it in memory. Archives are only advised to be read
+// because most of their members are usually not used.
+void elf::prefetchFile(StringRef Path) {
+  Path = applyChroot(Path);
+  if (!ThreadsEnabled || PrefetchedFiles.count(Path) || BatchFiles.count(Path))
+    return;
+  if (!PrefetchPool)
+    PrefetchPool = llvm::make_unique<ThreadPool>();
+
+  PrefetchedFile &F = PrefetchedFiles[Path];
+  std::string P = Path.str();
+  F.Done = PrefetchPool->async([&F, P] {
+    F.MB = MemoryBuffer::getFile(P, -1, false);
+    if (!F.MB)
+      return;
+    StringRef Data = (*F.MB)->getBuffer();
+    adviseWillNeed(Data);
+    if (identify_magic(Data) == file_magic::archive)
+      return;
+    volatile char Sink = 0;
+    for (size_t I = 0; I < Data.size(); I += 4096)
+      Sink += Data[I];
+    (void)Sink;
+  });
+}
+
+// The files read by readFile that are mapped into memory rather than read
+// into the heap, by start address.
+namespace {
+struct MappedFile {
+  size_t Size;
+  std::string Path;
+};
+} // namespace
+
+static std::map<const char *, MappedFile> MappedBuffers;
+
+static const std::pair<const char *const, MappedFile> *
+findMappedFile(const char *Data, size_t Size) {
+  auto It = MappedBuffers.upper_bound(Data);
+  if (It == MappedBuffers.begin())
+    return nullptr;
+  --It;
+  if (Data + Size <= It->first + It->second.Size)
+    return &*It;
+  return nullptr;
+}
+
+// Releases the memory of Data if it is part of a mapped file. Heap buffers
+// are left alone because their contents would be lost.
+static void releaseMappedData(StringRef Data) {
+  if (findMappedFile(Data.data(), Data.size()))
+    adviseDontNeed(Data);
+}
 
+Optional<std::pair<StringRef, uint64_t>>
+elf::getMappedFileOffset(ArrayRef<uint8_t> Data) {
+  const char *P = reinterpret_cast<const char *>(Data.data());
+  if (auto *KV = findMappedFile(P, Data.size()))
+    return std::make_pair(StringRef(KV->second.Path),
+                          uint64_t(P - KV->first));
+  return None;
+}
+
+Optional<MemoryBufferRef> elf::readFile(StringRef Path) {
+  Path = applyChroot(Path);
   log(Path);
 
-  auto MBOrErr = MemoryBuffer::getFile(Path, -1, false);
+  auto BatchIt = BatchFiles.find(Path);
+  if (BatchIt != BatchFiles.end()) {
+    MemoryBufferRef MBRef = BatchIt->second.MB->getMemBufferRef();
+    if (Tar)
+      Tar->append(relativeToRoot(Path), MBRef.getBuffer());
+    if (Config->OutputCache)
+      Config->OutputCache->addInput(Path, MBRef);
+    return MBRef;
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = std::error_code();
+  auto It = PrefetchedFiles.find(Path);
+  if (It != PrefetchedFiles.end()) {
+    It->second.Done.wait();
+    MBOrErr = std::move(It->second.MB);
+    PrefetchedFiles.erase(It);
+  } else {
+    MBOrErr = MemoryBuffer::getFile(Path, -1, false);
+  }
   if (auto EC = MBOrErr.getError()) {
     error("cannot open " + Path + ": " + EC.message());
     return None;
@@ -72,13 +196,36 @@ Optional<MemoryBufferRef> elf::readFile(StringRef Path) {
 
   std::unique_ptr<MemoryBuffer> &MB = *MBOrErr;
   MemoryBufferRef MBRef = MB->getMemBufferRef();
-  make<std::unique_ptr<MemoryBuffer>>(std::move(MB)); // take MB ownership
+  InputFileBytes += MBRef.getBufferSize();
+  if (MB->getBufferKind() == MemoryBuffer::MemoryBuffer_MMap)
+    MappedBuffers[MBRef.getBufferStart()] = {MBRef.getBufferSize(),
+                                             Path.str()};
+  if (InBatch)
+    BatchFiles[Path].MB = std::move(MB);
+  else
+    make<std::unique_ptr<MemoryBuffer>>(std::move(MB)); // take MB ownership
 
   if (Tar)
     Tar->append(relativeToRoot(Path), MBRef.getBuffer());
+  if (Config->OutputCache)
+    Config->OutputCache->addInput(Path, MBRef);
   return MBRef;
 }
 
+void elf::forgetBatchFile(StringRef Path) {
+  auto It = BatchFiles.find(applyChroot(Path));
+  if (It == BatchFiles.end())
+    return;
+  MappedBuffers.erase(It->second.MB->getBufferStart());
+  BatchFiles.erase(It);
+}
+
+void elf::clearBatchCache() {
+  for (auto &KV : BatchFiles)
+    MappedBuffers.erase(KV.second.MB->getBufferStart());
+  BatchFiles.clear();
+}
+
 // Concatenates arguments to construct a string representing an error location.
 static std::string createFileLineMsg(StringRef Path, unsigned Line) {
   std::string Filename = path::filename(Path);
@@ -181,6 +328,31 @@ template <class ELFT> void ObjFile<ELFT>::initializeDwarf() {
   }
 }
 
+// Frees what is only needed to write the sections of this file. Mapped file
+// contents are still readable afterwards, for example for the symbol names
+// that .strtab refers to, but decompressed sections are gone.
+template <class ELFT> void ObjFile<ELFT>::releaseContents() {
+  bool HasDecompressed = llvm::any_of(this->Sections, [](InputSectionBase *S) {
+    return S && S != &InputSection::Discarded && S->isDecompressed();
+  });
+
+  // Debug info for diagnostics refers to the section contents. If it has not
+  // been read yet, prevent it from being read later; otherwise keep the
+  // decompressed sections alive.
+  bool FreeDecompressed = false;
+  if (HasDecompressed)
+    llvm::call_once(InitDwarfLine, [&] { FreeDecompressed = true; });
+
+  for (InputSectionBase *S : this->Sections) {
+    if (!S || S == &InputSection::Discarded)
+      continue;
+    std::vector<Relocation>().swap(S->Relocations);
+    if (FreeDecompressed)
+      S->releaseDecompressBuf();
+  }
+  releaseMappedData(this->MB.getBuffer());
+}
+
 // Returns the pair of file name and line number describing location of data
 // object (variable, array, etc) definition.
 template <class ELFT>
@@ -289,7 +461,9 @@ template <class ELFT> ArrayRef<Symbol *> ObjFile<ELFT>::getLocalSymbols() {
 }
 
 template <class ELFT> ArrayRef<Symbol *> ObjFile<ELFT>::getGlobalSymbols() {
-  return makeArrayRef(this->Symbols).slice(this->FirstGlobal);
+  // Symbols added by addLocalSymbol come after the global ones.
+  return makeArrayRef(this->Symbols)
+      .slice(this->FirstGlobal, this->ELFSyms.size() - this->FirstGlobal);
 }
 
 template <class ELFT>
@@ -302,6 +476,64 @@ void ObjFile<ELFT>::parse(DenseSet<CachedHashStringRef> &ComdatGroups) {
 
   // Read a symbol table.
   initializeSymbols();
+  this->GlobalNames = {};
+}
+
+template <class ELFT> void ELFFileBase<ELFT>::hashGlobalNames() {
+  uint32_t Type = this->kind() == InputFile::SharedKind ? SHT_DYNSYM : SHT_SYMTAB;
+  GlobalNames = readGlobalNames<ELFT>(this->MB, Type);
+}
+
+// This is called from more than one thread, so it must not report errors.
+template <class ELFT>
+std::vector<CachedHashStringRef> elf::readGlobalNames(MemoryBufferRef MB,
+                                                     uint32_t SymtabType,
+                                                     bool DefinedOnly) {
+  Expected<ELFFile<ELFT>> ObjOrErr = ELFFile<ELFT>::create(MB.getBuffer());
+  if (!ObjOrErr) {
+    consumeError(ObjOrErr.takeError());
+    return {};
+  }
+  const ELFFile<ELFT> &Obj = *ObjOrErr;
+
+  Expected<ArrayRef<typename ELFT::Shdr>> ObjSections = Obj.sections();
+  if (!ObjSections) {
+    consumeError(ObjSections.takeError());
+    return {};
+  }
+
+  // Leave files with no or more than one symbol table to parse.
+  const typename ELFT::Shdr *SymtabSec = nullptr;
+  for (const typename ELFT::Shdr &Sec : *ObjSections) {
+    if (Sec.sh_type != SymtabType)
+      continue;
+    if (SymtabSec)
+      return {};
+    SymtabSec = &Sec;
+  }
+  if (!SymtabSec)
+    return {};
+
+  auto Syms = Obj.symbols(SymtabSec);
+  auto StrTab = Obj.getStringTableForSymtab(*SymtabSec, *ObjSections);
+  if (!Syms || !StrTab) {
+    consumeError(Syms.takeError());
+    consumeError(StrTab.takeError());
+    return {};
+  }
+  if (SymtabSec->sh_info == 0 || SymtabSec->sh_info > Syms->size())
+    return {};
+
+  std::vector<CachedHashStringRef> Names;
+  Names.reserve(Syms->size() - SymtabSec->sh_info);
+  for (const typename ELFT::Sym &Sym : Syms->slice(SymtabSec->sh_info)) {
+    if (Sym.st_name >= StrTab->size())
+      return {};
+    if (DefinedOnly && Sym.st_shndx == SHN_UNDEF)
+      continue;
+    Names.emplace_back(StringRef(StrTab->data() + Sym.st_name));
+  }
+  return Names;
 }
 
 // Sections with SHT_GROUP and comdat bits define comdat section groups.
@@ -408,6 +640,10 @@ template <class ELFT> void ObjFile<ELFT>::initializeJustSymbols() {
   }
 }
 
+static bool isDebugSection(StringRef Name) {
+  return Name.startswith(".debug") || Name.startswith(".zdebug");
+}
+
 template <class ELFT>
 void ObjFile<ELFT>::initializeSections(
     DenseSet<CachedHashStringRef> &ComdatGroups) {
@@ -419,6 +655,35 @@ void ObjFile<ELFT>::initializeSections(
   this->SectionStringTable =
       CHECK(Obj.getSectionStringTable(ObjSections), this);
 
+  // De-duplicate section groups by their signatures before anything else is
+  // done with the sections, so that members of groups that lose never get
+  // section objects. In C++ programs most groups lose.
+  //
+  // Group leader sections, which contain indices of group members, are
+  // discarded because they are useless beyond this point. The only
+  // exception is the -r option because in order to produce re-linkable
+  // object files, we want to pass through basically everything.
+  for (size_t I = 0, E = ObjSections.size(); I < E; I++) {
+    const Elf_Shdr &Sec = ObjSections[I];
+    if (Sec.sh_type != SHT_GROUP)
+      continue;
+    StringRef Signature = getShtGroupSignature(ObjSections, Sec);
+    bool IsNew = ComdatGroups.insert(CachedHashStringRef(Signature)).second;
+    if (IsNew) {
+      if (!Config->Relocatable)
+        this->Sections[I] = &InputSection::Discarded;
+      continue;
+    }
+
+    this->Sections[I] = &InputSection::Discarded;
+    for (uint32_t SecIndex : getShtGroupEntries(Sec)) {
+      if (SecIndex >= Size)
+        fatal(toString(this) +
+              ": invalid section index in group: " + Twine(SecIndex));
+      this->Sections[SecIndex] = &InputSection::Discarded;
+    }
+  }
+
   for (size_t I = 0, E = ObjSections.size(); I < E; I++) {
     if (this->Sections[I] == &InputSection::Discarded)
       continue;
@@ -432,33 +697,20 @@ void ObjFile<ELFT>::initializeSections(
       continue;
     }
 
-    switch (Sec.sh_type) {
-    case SHT_GROUP: {
-      // De-duplicate section groups by their signatures.
-      StringRef Signature = getShtGroupSignature(ObjSections, Sec);
-      bool IsNew = ComdatGroups.insert(CachedHashStringRef(Signature)).second;
+    // --strip-debug and --strip-all discard debug sections. Do it here,
+    // before creating section objects for them or reading their contents.
+    // Their relocation sections are then discarded by getRelocTarget.
+    if (Config->Strip != StripPolicy::None &&
+        isDebugSection(getSectionName(Sec))) {
       this->Sections[I] = &InputSection::Discarded;
+      continue;
+    }
 
-      // If it is a new section group, we want to keep group members.
-      // Group leader sections, which contain indices of group members, are
-      // discarded because they are useless beyond this point. The only
-      // exception is the -r option because in order to produce re-linkable
-      // object files, we want to pass through basically everything.
-      if (IsNew) {
-        if (Config->Relocatable)
-          this->Sections[I] = createInputSection(Sec);
-        continue;
-      }
-
-      // Otherwise, discard group members.
-      for (uint32_t SecIndex : getShtGroupEntries(Sec)) {
-        if (SecIndex >= Size)
-          fatal(toString(this) +
-                ": invalid section index in group: " + Twine(SecIndex));
-        this->Sections[SecIndex] = &InputSection::Discarded;
-      }
+    switch (Sec.sh_type) {
+    case SHT_GROUP:
+      // Only groups kept by -r get here.
+      this->Sections[I] = createInputSection(Sec);
       break;
-    }
     case SHT_SYMTAB:
       this->initSymtab(ObjSections, &Sec);
       break;
@@ -468,6 +720,17 @@ void ObjFile<ELFT>::initializeSections(
     case SHT_STRTAB:
     case SHT_NULL:
       break;
+    case SHT_LLVM_ADDRSIG:
+      // The address-significance table refers to symbols by index. objcopy
+      // and ld -r reorder the symbol table without updating it, and clear
+      // sh_link while doing so, so a table without sh_link cannot be trusted.
+      if (Sec.sh_link != 0)
+        AddrsigSec = &Sec;
+      else if (Config->ICF == ICFLevel::Safe)
+        warn(toString(this) + ": --icf=safe is incompatible with object "
+                              "files created using objcopy or ld -r");
+      this->Sections[I] = &InputSection::Discarded;
+      break;
     default:
       this->Sections[I] = createInputSection(Sec);
     }
@@ -481,7 +744,7 @@ void ObjFile<ELFT>::initializeSections(
 
       InputSectionBase *LinkSec = this->Sections[Sec.sh_link];
       InputSection *IS = cast<InputSection>(this->Sections[I]);
-      LinkSec->DependentSections.push_back(IS);
+      LinkSec->addDependentSection(IS);
       if (!isa<InputSection>(LinkSec))
         error("a section " + IS->Name +
               " with SHF_LINK_ORDER should not refer a non-regular "
@@ -630,7 +893,7 @@ InputSectionBase *ObjFile<ELFT>::createInputSection(const Elf_Shdr &Sec) {
     if (Config->EmitRelocs) {
       InputSection *RelocSec = make<InputSection>(*this, Sec, Name);
       // We will not emit relocation section if target was discarded.
-      Target->DependentSections.push_back(RelocSec);
+      Target->addDependentSection(RelocSec);
       return RelocSec;
     }
     return nullptr;
@@ -696,6 +959,9 @@ StringRef ObjFile<ELFT>::getSectionName(const Elf_Shdr &Sec) {
 }
 
 template <class ELFT> void ObjFile<ELFT>::initializeSymbols() {
+  if (GlobalNames.size() != this->getGlobalELFSyms().size())
+    GlobalNames.clear();
+
   this->Symbols.reserve(this->ELFSyms.size());
   for (const Elf_Sym &Sym : this->ELFSyms)
     this->Symbols.push_back(createSymbol(&Sym));
@@ -728,7 +994,10 @@ template <class ELFT> Symbol *ObjFile<ELFT>::createSymbol(const Elf_Sym *Sym) {
     return make<Defined>(this, Name, Binding, StOther, Type, Value, Size, Sec);
   }
 
-  StringRef Name = CHECK(Sym->getName(this->StringTable), this);
+  CachedHashStringRef Name =
+      GlobalNames.empty()
+          ? CachedHashStringRef(CHECK(Sym->getName(this->StringTable), this))
+          : GlobalNames[Sym - this->ELFSyms.begin() - this->FirstGlobal];
 
   switch (Sym->st_shndx) {
   case SHN_UNDEF:
@@ -736,7 +1005,7 @@ template <class ELFT> Symbol *ObjFile<ELFT>::createSymbol(const Elf_Sym *Sym) {
                                       /*CanOmitFromDynSym=*/false, this);
   case SHN_COMMON:
     if (Value == 0 || Value >= UINT32_MAX)
-      fatal(toString(this) + ": common symbol '" + Name +
+      fatal(toString(this) + ": common symbol '" + Name.val() +
             "' has invalid alignment: " + Twine(Value));
     return Symtab->addCommon(Name, Size, Value, Binding, StOther, Type, *this);
   }
@@ -759,9 +1028,164 @@ ArchiveFile::ArchiveFile(std::unique_ptr<Archive> &&File)
     : InputFile(ArchiveKind, File->getMemoryBufferRef()),
       File(std::move(File)) {}
 
+// --archive-index-cache-dir keeps the symbol table of each archive along
+// with the hash of each name, so that archives that did not change since the
+// last link can be added to the symbol table without walking and hashing
+// their names again. Entries are named after the archive's path, file ID,
+// modification time and size.
+//
+// An entry is a magic string followed by little-endian fixed-size fields,
+// so it can be used directly from a mapped file:
+//   u32 HashCheck, NumSymbols
+//   NumSymbols x { u32 SymbolIndex, u32 StringIndex, u32 Size, u32 Hash }
+// HashCheck is the hash of the magic string; it rejects entries written by a
+// linker whose string hash function differs from ours.
+static const char ArchiveIndexCacheMagic[] = "LLDARIX1";
+
+static uint32_t getArchiveIndexHashCheck() {
+  return CachedHashStringRef(ArchiveIndexCacheMagic).hash();
+}
+
+static std::string getArchiveIndexCachePath(StringRef ArchivePath,
+                                            uint64_t Size) {
+  file_status St;
+  if (sys::fs::status(ArchivePath, St) || St.getSize() != Size)
+    return "";
+  UniqueID ID = St.getUniqueID();
+  std::string Key = (ArchivePath + ":" + Twine(ID.getDevice()) + ":" +
+                     Twine(ID.getFile()) + ":" +
+                     Twine(St.getLastModificationTime()
+                               .time_since_epoch()
+                               .count()) +
+                     ":" + Twine(Size))
+                        .str();
+  SmallString<128> Path(Config->ArchiveIndexCacheDir);
+  path::append(Path, "archive-" + utohexstr(xxHash64(Key)));
+  return Path.str().str();
+}
+
+// Adds the symbols in a cache entry to the symbol table. Returns false
+// without adding anything if the entry does not fit the archive.
+template <class ELFT>
+static bool addCachedArchiveSymbols(ArchiveFile &F, const Archive &A,
+                                    StringRef Data) {
+  size_t HeaderSize = strlen(ArchiveIndexCacheMagic) + 8;
+  if (!Data.startswith(ArchiveIndexCacheMagic) || Data.size() < HeaderSize)
+    return false;
+  const uint8_t *P = Data.bytes_begin() + strlen(ArchiveIndexCacheMagic);
+  uint32_t NumSymbols = read32le(P + 4);
+  if (read32le(P) != getArchiveIndexHashCheck() ||
+      NumSymbols != A.getNumberOfSymbols() ||
+      Data.size() != HeaderSize + NumSymbols * 16ULL)
+    return false;
+
+  // Check every entry first so that a stale entry adds nothing.
+  StringRef SymTab = A.getSymbolTable();
+  P += 8;
+  for (uint32_t I = 0; I < NumSymbols; ++I) {
+    uint64_t StringIndex = read32le(P + I * 16 + 4);
+    uint64_t Size = read32le(P + I * 16 + 8);
+    if (StringIndex + Size > SymTab.size())
+      return false;
+  }
+
+  for (uint32_t I = 0; I < NumSymbols; ++I, P += 16) {
+    uint32_t StringIndex = read32le(P + 4);
+    StringRef Name(SymTab.data() + StringIndex, read32le(P + 8));
+    Symtab->addLazyArchive<ELFT>(CachedHashStringRef(Name, read32le(P + 12)),
+                                 F, Archive::Symbol(&A, read32le(P),
+                                                    StringIndex));
+  }
+  return true;
+}
+
+// Writes an entry to a temporary file and renames it into place, so that
+// concurrent links never see a partially written entry.
+static void writeArchiveIndexCacheEntry(StringRef Path, StringRef Contents) {
+  int FD;
+  SmallString<128> TmpPath;
+  if (sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, TmpPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Contents;
+  }
+  if (sys::fs::rename(TmpPath, Path))
+    sys::fs::remove(TmpPath);
+}
+
 template <class ELFT> void ArchiveFile::parse() {
-  for (const Archive::Symbol &Sym : File->symbols())
-    Symtab->addLazyArchive<ELFT>(Sym.getName(), *this, Sym);
+  // An archive read by an earlier link of a --batch keeps its index.
+  BatchFile *Batch = nullptr;
+  auto BatchIt = BatchFiles.find(MB.getBufferIdentifier());
+  if (BatchIt != BatchFiles.end() &&
+      BatchIt->second.MB->getBufferStart() == MB.getBufferStart()) {
+    Batch = &BatchIt->second;
+    if (addCachedArchiveSymbols<ELFT>(*this, *File, Batch->ArchiveIndex)) {
+      ++Stats->ArchiveIndexCacheHits;
+      return;
+    }
+  }
+
+  std::string CachePath;
+  if (!Config->ArchiveIndexCacheDir.empty())
+    CachePath = getArchiveIndexCachePath(getName(), MB.getBufferSize());
+
+  if (!CachePath.empty()) {
+    if (ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+            MemoryBuffer::getFile(CachePath)) {
+      if (addCachedArchiveSymbols<ELFT>(*this, *File,
+                                        (*MBOrErr)->getBuffer())) {
+        ++Stats->ArchiveIndexCacheHits;
+        if (Batch)
+          Batch->ArchiveIndex = (*MBOrErr)->getBuffer();
+        return;
+      }
+    }
+  }
+
+  std::string Entry;
+  auto Add = [&](uint32_t V) {
+    char Buf[4];
+    write32le(Buf, V);
+    Entry.append(Buf, 4);
+  };
+  bool BuildEntry = Batch || !CachePath.empty();
+  if (BuildEntry) {
+    Entry = ArchiveIndexCacheMagic;
+    Add(getArchiveIndexHashCheck());
+    Add(File->getNumberOfSymbols());
+  }
+
+  // Archive::Symbol does not expose its indices, but the symbol index is
+  // the position in the symbol table and the name points into the string
+  // table.
+  StringRef SymTab = File->getSymbolTable();
+  uint32_t SymbolIndex = 0;
+  for (const Archive::Symbol &Sym : File->symbols()) {
+    CachedHashStringRef Name(Sym.getName());
+    if (BuildEntry) {
+      Add(SymbolIndex);
+      Add(Name.val().data() - SymTab.data());
+      Add(Name.size());
+      Add(Name.hash());
+    }
+    ++SymbolIndex;
+    Symtab->addLazyArchive<ELFT>(Name, *this, Sym);
+  }
+
+  if (BuildEntry)
+    ++Stats->ArchiveIndexCacheMisses;
+  if (Batch)
+    Batch->ArchiveIndex = Entry;
+
+  if (!CachePath.empty()) {
+    if (std::error_code EC = create_directories(Config->ArchiveIndexCacheDir))
+      warn("--archive-index-cache-dir: cannot create " +
+           Config->ArchiveIndexCacheDir + ": " + EC.message());
+    else
+      writeArchiveIndexCacheEntry(CachePath, Entry);
+  }
 }
 
 // Returns a buffer pointing to a member file containing a given symbol.
@@ -780,6 +1204,14 @@ InputFile *ArchiveFile::fetch(const Archive::Symbol &Sym) {
                 ": could not get the buffer for the member defining symbol " +
                 Sym.getName());
 
+  // Members that are fetched together tend to be next to each other, so
+  // ask for the following part of the archive to be read ahead.
+  if (Config->PrefetchInputs && !C.getParent()->isThin()) {
+    StringRef Buf = C.getParent()->getMemoryBufferRef().getBuffer();
+    size_t End = MB.getBufferEnd() - Buf.data();
+    adviseWillNeed(Buf.slice(End, End + (1 << 20)));
+  }
+
   if (Tar && C.getParent()->isThin())
     Tar->append(relativeToRoot(CHECK(C.getFullName(), this)), MB.getBuffer());
 
@@ -934,12 +1366,19 @@ template <class ELFT> void SharedFile<ELFT>::parseRest() {
 
   // Add symbols to the symbol table.
   ArrayRef<Elf_Sym> Syms = this->getGlobalELFSyms();
+  if (this->GlobalNames.size() != Syms.size())
+    this->GlobalNames.clear();
+
   for (size_t I = 0; I < Syms.size(); ++I) {
     const Elf_Sym &Sym = Syms[I];
 
-    StringRef Name = CHECK(Sym.getName(this->StringTable), this);
+    CachedHashStringRef HashedName =
+        this->GlobalNames.empty()
+            ? CachedHashStringRef(CHECK(Sym.getName(this->StringTable), this))
+            : this->GlobalNames[I];
+    StringRef Name = HashedName.val();
     if (Sym.isUndefined()) {
-      Symbol *S = Symtab->addUndefined<ELFT>(Name, Sym.getBinding(),
+      Symbol *S = Symtab->addUndefined<ELFT>(HashedName, Sym.getBinding(),
                                              Sym.st_other, Sym.getType(),
                                              /*CanOmitFromDynSym=*/false, this);
       S->ExportDynamic = true;
@@ -966,7 +1405,7 @@ template <class ELFT> void SharedFile<ELFT>::parseRest() {
 
     uint64_t Alignment = getAlignment(Sections, Sym);
     if (!(Versyms[I] & VERSYM_HIDDEN))
-      Symtab->addShared(Name, *this, Sym, Alignment, Idx);
+      Symtab->addShared(HashedName, *this, Sym, Alignment, Idx);
 
     // Also add the symbol with the versioned name to handle undefined symbols
     // with explicit versions.
@@ -984,8 +1423,10 @@ template <class ELFT> void SharedFile<ELFT>::parseRest() {
         this->StringTable.data() + Verdefs[Idx]->getAux()->vda_name;
     VersionedNameBuffer.clear();
     Name = (Name + "@" + VerName).toStringRef(VersionedNameBuffer);
-    Symtab->addShared(Saver.save(Name), *this, Sym, Alignment, Idx);
+    Symtab->addShared(CachedHashStringRef(Saver.save(Name)), *this, Sym,
+                      Alignment, Idx);
   }
+  this->GlobalNames = {};
 }
 
 static ELFKind getBitcodeELFKind(const Triple &T) {
@@ -1043,6 +1484,8 @@ BitcodeFile::BitcodeFile(MemoryBufferRef MB, StringRef ArchiveName,
       Saver.save(ArchiveName + Path +
                  (ArchiveName.empty() ? "" : utostr(OffsetInArchive))));
 
+  // LLVM targets are registered only once a bitcode file shows up.
+  initLLVMTargets();
   Obj = CHECK(lto::InputFile::create(MBRef), this);
 
   Triple T(Obj->getTargetTriple());
@@ -1198,11 +1641,20 @@ InputFile *LazyObjFile::fetch() {
 template <class ELFT> void LazyObjFile::parse() {
   // A lazy object file wraps either a bitcode file or an ELF file.
   if (isBitcode(this->MB)) {
+    initLLVMTargets();
     std::unique_ptr<lto::InputFile> Obj =
         CHECK(lto::InputFile::create(this->MB), this);
     for (const lto::InputFile::Symbol &Sym : Obj->symbols())
       if (!Sym.isUndefined())
-        Symtab->addLazyObject<ELFT>(Saver.save(Sym.getName()), *this);
+        Symtab->addLazyObject<ELFT>(
+            CachedHashStringRef(Saver.save(Sym.getName())), *this);
+    return;
+  }
+
+  if (!DefinedNames.empty()) {
+    for (CachedHashStringRef Name : DefinedNames)
+      Symtab->addLazyObject<ELFT>(Name, *this);
+    DefinedNames = {};
     return;
   }
 
@@ -1224,6 +1676,10 @@ template <class ELFT> void LazyObjFile::parse() {
   }
 }
 
+template <class ELFT> void LazyObjFile::hashDefinedNames() {
+  DefinedNames = readGlobalNames<ELFT>(MB, SHT_SYMTAB, /*DefinedOnly=*/true);
+}
+
 template <class ELFT> void LazyObjFile::addElfSymbols() {
   ELFFile<ELFT> Obj = check(ELFFile<ELFT>::create(MB.getBuffer()));
   ArrayRef<typename ELFT::Shdr> Sections = CHECK(Obj.sections(), this);
@@ -1239,8 +1695,8 @@ template <class ELFT> void LazyObjFile::addElfSymbols() {
 
     for (const typename ELFT::Sym &Sym : Syms.slice(FirstGlobal))
       if (Sym.st_shndx != SHN_UNDEF)
-        Symtab->addLazyObject<ELFT>(CHECK(Sym.getName(StringTable), this),
-                                    *this);
+        Symtab->addLazyObject<ELFT>(
+            CachedHashStringRef(CHECK(Sym.getName(StringTable), this)), *this);
     return;
   }
 }
@@ -1272,6 +1728,20 @@ template void LazyObjFile::parse<ELF32BE>();
 template void LazyObjFile::parse<ELF64LE>();
 template void LazyObjFile::parse<ELF64BE>();
 
+template void LazyObjFile::hashDefinedNames<ELF32LE>();
+template void LazyObjFile::hashDefinedNames<ELF32BE>();
+template void LazyObjFile::hashDefinedNames<ELF64LE>();
+template void LazyObjFile::hashDefinedNames<ELF64BE>();
+
+template std::vector<CachedHashStringRef>
+    elf::readGlobalNames<ELF32LE>(MemoryBufferRef, uint32_t, bool);
+template std::vector<CachedHashStringRef>
+    elf::readGlobalNames<ELF32BE>(MemoryBufferRef, uint32_t, bool);
+template std::vector<CachedHashStringRef>
+    elf::readGlobalNames<ELF64LE>(MemoryBufferRef, uint32_t, bool);
+template std::vector<CachedHashStringRef>
+    elf::readGlobalNames<ELF64BE>(MemoryBufferRef, uint32_t, bool);
+
 template class elf::ELFFileBase<ELF32LE>;
 template class elf::ELFFileBase<ELF32BE>;
 template class elf::ELFFileBase<ELF64LE>;
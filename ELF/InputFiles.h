@@ -26,7 +26,6 @@
 #include <map>
 
 namespace llvm {
-class TarWriter;
 struct DILineInfo;
 namespace lto {
 class InputFile;
@@ -50,11 +49,30 @@ class Symbol;
 
 // If -reproduce option is given, all input files are written
 // to this tar archive.
-extern llvm::TarWriter *Tar;
+extern AsyncTarWriter *Tar;
 
 // Opens a given file.
 llvm::Optional<MemoryBufferRef> readFile(StringRef Path);
 
+// If Data is part of an input file that readFile has mapped into memory,
+// returns the path of that file and the offset of Data in it.
+llvm::Optional<std::pair<StringRef, uint64_t>>
+getMappedFileOffset(ArrayRef<uint8_t> Data);
+
+// Starts reading a file on a background thread for a later readFile call.
+void prefetchFile(StringRef Path);
+
+// Set during the links of a --batch. readFile then keeps input files mapped,
+// and archive symbol tables stay indexed, from one link to the next.
+extern bool InBatch;
+
+// Drops a file from the --batch cache, for example because a link of the
+// batch has overwritten it.
+void forgetBatchFile(StringRef Path);
+
+// Drops all files from the --batch cache.
+void clearBatchCache();
+
 // The root class of input files.
 class InputFile {
 public:
@@ -153,6 +171,16 @@ public:
   Elf_Sym_Range getGlobalELFSyms();
   Elf_Sym_Range getELFSyms() const { return ELFSyms; }
 
+  // Reads and hashes the names of the global symbols ahead of parsing, from
+  // .symtab of object files and from .dynsym of shared objects.
+  // This does not report errors; if the symbol table is broken,
+  // GlobalNames is left empty and parsing diagnoses the file as usual.
+  void hashGlobalNames();
+
+  // The names of the global symbols with their hash values, in symbol
+  // table order. Filled by hashGlobalNames and released by parsing.
+  std::vector<llvm::CachedHashStringRef> GlobalNames;
+
 protected:
   ArrayRef<Elf_Sym> ELFSyms;
   uint32_t FirstGlobal = 0;
@@ -194,12 +222,24 @@ public:
     return getSymbol(SymIndex);
   }
 
+  // Appends a local symbol that is not in the symbol table of the file and
+  // returns its index. Used by --atomize-sections and --dedup-debug-types,
+  // which point relocations at section symbols of their own.
+  uint32_t addLocalSymbol(Symbol *Sym) {
+    this->Symbols.push_back(Sym);
+    return this->Symbols.size() - 1;
+  }
+
   // Returns source line information for a given offset.
   // If no information is available, returns "".
   std::string getLineInfo(InputSectionBase *S, uint64_t Offset);
   llvm::Optional<llvm::DILineInfo> getDILineInfo(InputSectionBase *, uint64_t);
   llvm::Optional<std::pair<std::string, unsigned>> getVariableLoc(StringRef Name);
 
+  // The .llvm_addrsig section, which lists the symbols whose address is
+  // significant, or null if the file does not have a usable one.
+  const Elf_Shdr *AddrsigSec = nullptr;
+
   // MIPS GP0 value defined by this file. This value represents the gp value
   // used to create the relocatable object and required to support
   // R_MIPS_GPREL16 / R_MIPS_GPREL32 relocations.
@@ -210,6 +250,10 @@ public:
   // symbol table.
   StringRef SourceFile;
 
+  // For --reduce-memory-overheads. Called once all sections of this file
+  // have been written.
+  void releaseContents();
+
 private:
   void
   initializeSections(llvm::DenseSet<llvm::CachedHashStringRef> &ComdatGroups);
@@ -263,6 +307,14 @@ public:
   InputFile *fetch();
   bool AddedToLink = false;
 
+  // Reads and hashes the names of the defined global symbols ahead of
+  // parsing, which then only has to add them to the symbol table. Like
+  // ELFFileBase::hashGlobalNames, it does not report errors.
+  template <class ELFT> void hashDefinedNames();
+
+  // Filled by hashDefinedNames and released by parsing.
+  std::vector<llvm::CachedHashStringRef> DefinedNames;
+
 private:
   template <class ELFT> void addElfSymbols();
 
@@ -349,6 +401,14 @@ public:
   void parse();
 };
 
+// Reads and hashes the names of the global symbols, or only of the defined
+// ones, of an ELF file's symbol table of the given type, in symbol table
+// order. Returns an empty vector if the file is broken.
+template <class ELFT>
+std::vector<llvm::CachedHashStringRef>
+readGlobalNames(MemoryBufferRef MB, uint32_t SymtabType = llvm::ELF::SHT_SYMTAB,
+                bool DefinedOnly = false);
+
 InputFile *createObjectFile(MemoryBufferRef MB, StringRef ArchiveName = "",
                             uint64_t OffsetInArchive = 0);
 InputFile *createSharedFile(MemoryBufferRef MB, StringRef DefaultSoName);
@@ -39,6 +39,7 @@ using namespace lld;
 using namespace lld::elf;
 
 std::vector<InputSectionBase *> elf::InputSections;
+std::vector<SectionAux> elf::SecAux;
 
 // Returns a string to construct an error message.
 std::string lld::toString(const InputSectionBase *Sec) {
@@ -69,6 +70,8 @@ InputSectionBase::InputSectionBase(InputFile *File, uint64_t Flags,
 
   NumRelocations = 0;
   AreRelocsRela = false;
+  IsCompressed = false;
+  IsGnuCompressed = false;
 
   // The ELF spec states that a value of 0 means the section has
   // no alignment constraits.
@@ -124,10 +127,20 @@ InputSectionBase::InputSectionBase(ObjFile<ELFT> &File,
 size_t InputSectionBase::getSize() const {
   if (auto *S = dyn_cast<SyntheticSection>(this))
     return S->getSize();
+  if (IsCompressed)
+    return UncompressedSize;
 
   return Data.size();
 }
 
+void InputSectionBase::addDependentSection(InputSection *IS) {
+  if (AuxIdx == -1U) {
+    AuxIdx = SecAux.size();
+    SecAux.emplace_back();
+  }
+  SecAux[AuxIdx].DependentSections.push_back(IS);
+}
+
 uint64_t InputSectionBase::getOffsetInFile() const {
   const uint8_t *FileStart = (const uint8_t *)File->MB.getBufferStart();
   const uint8_t *SecStart = Data.begin();
@@ -176,34 +189,64 @@ OutputSection *SectionBase::getOutputSection() {
   return Sec ? Sec->getParent() : nullptr;
 }
 
-// Decompress section contents if required. Note that this function
-// is called from parallelForEach, so it must be thread-safe.
-void InputSectionBase::maybeDecompress() {
-  if (DecompressBuf)
-    return;
+// Reads the header of a compressed section. Note that this function
+// is called from parallelForEach, so it must be thread-safe. The
+// caller renames .zdebug sections.
+void InputSectionBase::parseCompressedHeader() {
   if (!(Flags & SHF_COMPRESSED) && !Name.startswith(".zdebug"))
     return;
 
-  // Decompress a section.
   Decompressor Dec = check(Decompressor::create(Name, toStringRef(Data),
                                                 Config->IsLE, Config->Is64));
+  UncompressedSize = Dec.getDecompressedSize();
+  IsCompressed = true;
+  IsGnuCompressed = Name.startswith(".zdebug");
+  Flags &= ~(uint64_t)SHF_COMPRESSED;
+
+  // Nothing but the output writer reads non-alloc sections, so they can stay
+  // compressed until then. SHF_COMPRESSED is not allowed on SHF_ALLOC
+  // sections, but if we see one anyway, inflate it now so that relocation
+  // scanning sees its real contents.
+  if (Flags & SHF_ALLOC)
+    maybeDecompress();
+}
 
-  size_t Size = Dec.getDecompressedSize();
-  DecompressBuf.reset(new char[Size + Name.size()]());
-  if (Error E = Dec.decompress({DecompressBuf.get(), Size}))
+void InputSectionBase::decompressTo(uint8_t *Buf) {
+  // The name of a section has been restored at this point, so tell
+  // Decompressor which header to expect with a name of the right kind.
+  Decompressor Dec =
+      check(Decompressor::create(IsGnuCompressed ? ".zdebug" : ".debug",
+                                 toStringRef(Data), Config->IsLE, Config->Is64));
+  if (Error E = Dec.decompress({(char *)Buf, UncompressedSize}))
     fatal(toString(this) +
           ": decompress failed: " + llvm::toString(std::move(E)));
+}
 
-  Data = makeArrayRef((uint8_t *)DecompressBuf.get(), Size);
-  Flags &= ~(uint64_t)SHF_COMPRESSED;
+// Decompresses section contents into memory if they are still compressed.
+// This is thread-safe as long as no two threads work on the same section.
+void InputSectionBase::maybeDecompress() {
+  if (!IsCompressed)
+    return;
+  DecompressBuf.reset(new char[UncompressedSize]());
+  decompressTo((uint8_t *)DecompressBuf.get());
+  Data = makeArrayRef((uint8_t *)DecompressBuf.get(), UncompressedSize);
+  IsCompressed = false;
+}
 
-  // A section name may have been altered if compressed. If that's
-  // the case, restore the original name. (i.e. ".zdebug_" -> ".debug_")
-  if (Name.startswith(".zdebug")) {
-    DecompressBuf[Size] = '.';
-    memcpy(&DecompressBuf[Size + 1], Name.data() + 2, Name.size() - 2);
-    Name = StringRef(&DecompressBuf[Size], Name.size() - 1);
-  }
+// Copies section contents to Buf. A section that is still compressed is
+// inflated directly into Buf without an intermediate buffer.
+void InputSectionBase::copyContents(uint8_t *Buf) {
+  if (IsCompressed)
+    decompressTo(Buf);
+  else
+    memcpy(Buf, Data.data(), Data.size());
+}
+
+void InputSectionBase::releaseDecompressBuf() {
+  if (!DecompressBuf)
+    return;
+  DecompressBuf.reset();
+  Data = makeArrayRef<uint8_t>(nullptr, Data.size());
 }
 
 InputSection *InputSectionBase::getLinkOrderDep() const {
@@ -338,6 +381,9 @@ InputSectionBase *InputSection::getRelocatedSection() const {
 template <class ELFT, class RelTy>
 void InputSection::copyRelocations(uint8_t *Buf, ArrayRef<RelTy> Rels) {
   InputSectionBase *Sec = getRelocatedSection();
+  // Addends of REL relocations are read from the relocated section.
+  if (!RelTy::IsRela)
+    Sec->maybeDecompress();
 
   for (const RelTy &Rel : Rels) {
     RelType Type = Rel.getType(Config->IsMips64EL);
@@ -477,8 +523,8 @@ static uint64_t getARMStaticBase(const Symbol &Sym) {
   return OS->PtLoad->FirstSec->Addr;
 }
 
-static uint64_t getRelocTargetVA(const InputFile *File, RelType Type, int64_t A,
-                                 uint64_t P, const Symbol &Sym, RelExpr Expr) {
+uint64_t elf::getRelocTargetVA(const InputFile *File, RelType Type, int64_t A,
+                               uint64_t P, const Symbol &Sym, RelExpr Expr) {
   switch (Expr) {
   case R_INVALID:
     return 0;
@@ -740,63 +786,11 @@ void InputSectionBase::relocate(uint8_t *Buf, uint8_t *BufEnd) {
 }
 
 void InputSectionBase::relocateAlloc(uint8_t *Buf, uint8_t *BufEnd) {
-  assert(Flags & SHF_ALLOC);
-  const unsigned Bits = Config->Wordsize * 8;
-
-  for (const Relocation &Rel : Relocations) {
-    uint64_t Offset = Rel.Offset;
-    if (auto *Sec = dyn_cast<InputSection>(this))
-      Offset += Sec->OutSecOff;
-    uint8_t *BufLoc = Buf + Offset;
-    RelType Type = Rel.Type;
-
-    uint64_t AddrLoc = getOutputSection()->Addr + Offset;
-    RelExpr Expr = Rel.Expr;
-    uint64_t TargetVA = SignExtend64(
-        getRelocTargetVA(File, Type, Rel.Addend, AddrLoc, *Rel.Sym, Expr),
-        Bits);
-
-    switch (Expr) {
-    case R_RELAX_GOT_PC:
-    case R_RELAX_GOT_PC_NOPIC:
-      Target->relaxGot(BufLoc, TargetVA);
-      break;
-    case R_RELAX_TLS_IE_TO_LE:
-      Target->relaxTlsIeToLe(BufLoc, Type, TargetVA);
-      break;
-    case R_RELAX_TLS_LD_TO_LE:
-      Target->relaxTlsLdToLe(BufLoc, Type, TargetVA);
-      break;
-    case R_RELAX_TLS_GD_TO_LE:
-    case R_RELAX_TLS_GD_TO_LE_NEG:
-      Target->relaxTlsGdToLe(BufLoc, Type, TargetVA);
-      break;
-    case R_RELAX_TLS_GD_TO_IE:
-    case R_RELAX_TLS_GD_TO_IE_ABS:
-    case R_RELAX_TLS_GD_TO_IE_PAGE_PC:
-    case R_RELAX_TLS_GD_TO_IE_END:
-      Target->relaxTlsGdToIe(BufLoc, Type, TargetVA);
-      break;
-    case R_PPC_CALL:
-      // Patch a nop (0x60000000) to a ld.
-      if (Rel.Sym->NeedsTocRestore) {
-        if (BufLoc + 8 > BufEnd || read32(BufLoc + 4) != 0x60000000) {
-          error(getErrorLocation(BufLoc) + "call lacks nop, can't restore toc");
-          break;
-        }
-        write32(BufLoc + 4, 0xe8410018); // ld %r2, 24(%r1)
-      }
-      Target->relocateOne(BufLoc, Type, TargetVA);
-      break;
-    default:
-      Target->relocateOne(BufLoc, Type, TargetVA);
-      break;
-    }
-  }
+  Target->relocateAlloc(*this, Buf, BufEnd);
 }
 
 template <class ELFT> void InputSection::writeTo(uint8_t *Buf) {
-  if (Type == SHT_NOBITS)
+  if (Type == SHT_NOBITS || CopiedByWriter)
     return;
 
   if (auto *S = dyn_cast<SyntheticSection>(this)) {
@@ -823,8 +817,8 @@ template <class ELFT> void InputSection::writeTo(uint8_t *Buf) {
 
   // Copy section contents from source object file to output file
   // and then apply relocations.
-  memcpy(Buf + OutSecOff, Data.data(), Data.size());
-  uint8_t *BufEnd = Buf + OutSecOff + Data.size();
+  copyContents(Buf + OutSecOff);
+  uint8_t *BufEnd = Buf + OutSecOff + getSize();
   relocate<ELFT>(Buf, BufEnd);
 }
 
@@ -959,10 +953,6 @@ void MergeInputSection::splitIntoPieces() {
     splitStrings(Data, Entsize);
   else
     splitNonStrings(Data, Entsize);
-
-  OffsetMap.reserve(Pieces.size());
-  for (size_t I = 0, E = Pieces.size(); I != E; ++I)
-    OffsetMap[Pieces[I].InputOff] = I;
 }
 
 template <class It, class T, class Compare>
@@ -978,43 +968,45 @@ static It fastUpperBound(It First, It Last, const T &Value, Compare Comp) {
   return Comp(Value, *First) ? First : First + 1;
 }
 
-// Do binary search to get a section piece at a given input offset.
-static SectionPiece *findSectionPiece(MergeInputSection *Sec, uint64_t Offset) {
-  if (Sec->Data.size() <= Offset)
-    fatal(toString(Sec) + ": entry is past the end of the section");
+// Returns the index of the piece that contains a given input offset.
+size_t MergeInputSection::findPiece(uint64_t Offset) const {
+  if (Data.size() <= Offset)
+    fatal(toString(this) + ": entry is past the end of the section");
+
+  // Records of fixed size can be indexed directly.
+  if (!(Flags & SHF_STRINGS))
+    return Offset / Entsize;
+
+  // Try the last piece found and the one after it before searching.
+  auto Contains = [&](size_t I) {
+    return Pieces[I].InputOff <= Offset &&
+           (I + 1 == Pieces.size() || Offset < Pieces[I + 1].InputOff);
+  };
+  size_t I = LastPiece.load(std::memory_order_relaxed);
+  if (I < Pieces.size() && Contains(I))
+    return I;
+  if (I + 1 < Pieces.size() && Contains(I + 1)) {
+    LastPiece.store(I + 1, std::memory_order_relaxed);
+    return I + 1;
+  }
 
-  // Find the element this offset points to.
-  auto I = fastUpperBound(
-      Sec->Pieces.begin(), Sec->Pieces.end(), Offset,
+  auto It = fastUpperBound(
+      Pieces.begin(), Pieces.end(), Offset,
       [](const uint64_t &A, const SectionPiece &B) { return A < B.InputOff; });
-  --I;
-  return &*I;
+  I = It - Pieces.begin() - 1;
+  LastPiece.store(I, std::memory_order_relaxed);
+  return I;
 }
 
 SectionPiece *MergeInputSection::getSectionPiece(uint64_t Offset) {
-  // Find a piece starting at a given offset.
-  auto It = OffsetMap.find(Offset);
-  if (It != OffsetMap.end())
-    return &Pieces[It->second];
-
-  // If Offset is not at beginning of a section piece, it is not in the map.
-  // In that case we need to search from the original section piece vector.
-  return findSectionPiece(this, Offset);
+  return &Pieces[findPiece(Offset)];
 }
 
 // Returns the offset in an output section for a given input offset.
 // Because contents of a mergeable section is not contiguous in output,
 // it is not just an addition to a base output offset.
 uint64_t MergeInputSection::getParentOffset(uint64_t Offset) const {
-  // Find a string starting at a given offset.
-  auto It = OffsetMap.find(Offset);
-  if (It != OffsetMap.end())
-    return Pieces[It->second].OutputOff;
-
-  // If Offset is not at beginning of a section piece, it is not in the map.
-  // In that case we need to search from the original section piece vector.
-  const SectionPiece &Piece =
-      *findSectionPiece(const_cast<MergeInputSection *>(this), Offset);
+  const SectionPiece &Piece = Pieces[findPiece(Offset)];
   uint64_t Addend = Offset - Piece.InputOff;
   return Piece.OutputOff + Addend;
 }
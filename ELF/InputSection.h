@@ -18,6 +18,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Object/ELF.h"
+#include <atomic>
 
 namespace lld {
 namespace elf {
@@ -52,8 +53,8 @@ public:
 
   unsigned SectionKind : 3;
 
-  // The next two bit fields are only used by InputSectionBase, but we
-  // put them here so the struct packs better.
+  // The following bit fields are only used by InputSectionBase and
+  // InputSection, but we put them here so the struct packs better.
 
   // The garbage collector sets sections' Live bits.
   // If GC is disabled, all sections are considered live by default.
@@ -64,6 +65,27 @@ public:
   // Set for sections that should not be folded by ICF.
   unsigned KeepUnique : 1;
 
+  // True if this section has already been placed to a linker script
+  // output section. This is needed because, in a linker script, you
+  // can refer to the same section more than once. For example, in
+  // the following linker script,
+  //
+  //   .foo : { *(.text) }
+  //   .bar : { *(.text) }
+  //
+  // .foo takes all .text sections, and .bar becomes empty. To achieve
+  // this, we need to memorize whether a section has been placed or
+  // not for each input section.
+  unsigned Assigned : 1;
+
+  // True if the writer copies the contents of this section from the input
+  // file to the output file by itself, in which case writeTo skips it.
+  unsigned CopiedByWriter : 1;
+
+  // True if the loader has to write to this section to apply a dynamic
+  // relocation. Set by scanRelocations.
+  unsigned HasDynamicRelocs : 1;
+
   // These corresponds to the fields in Elf_Shdr.
   uint32_t Alignment;
   uint64_t Flags;
@@ -88,10 +110,23 @@ protected:
               uint64_t Entsize, uint64_t Alignment, uint32_t Type,
               uint32_t Info, uint32_t Link)
       : Name(Name), Repl(this), SectionKind(SectionKind), Live(false),
-        Bss(false), KeepUnique(false), Alignment(Alignment), Flags(Flags),
+        Bss(false), KeepUnique(false), Assigned(false), CopiedByWriter(false),
+        HasDynamicRelocs(false), Alignment(Alignment), Flags(Flags),
         Entsize(Entsize), Type(Type), Link(Link), Info(Info) {}
 };
 
+// The sections that depend on a section (reverse dependencies for GC).
+// Only .ARM.exidx and the relocation sections kept by --emit-relocs have
+// such a dependency, so rather than making every section larger, the
+// sections that have dependents keep an index into this table. Entries are
+// only added while input files are parsed and .eh_frame is built, which is
+// done serially.
+struct SectionAux {
+  llvm::TinyPtrVector<InputSection *> DependentSections;
+};
+
+extern std::vector<SectionAux> SecAux;
+
 // This corresponds to a section of an input file.
 class InputSectionBase : public SectionBase {
 public:
@@ -106,6 +141,13 @@ public:
 
   static bool classof(const SectionBase *S) { return S->kind() != Output; }
 
+  // Relocations that refer to this section. These are read by every pass
+  // over the sections, so they come first, next to the fields of
+  // SectionBase.
+  unsigned NumRelocations : 31;
+  unsigned AreRelocsRela : 1;
+  const void *FirstRelocation = nullptr;
+
   // The file which contains this section. It's dynamic type is always
   // ObjFile<ELFT>, but in order to avoid ELFT, we use InputFile as
   // its static type.
@@ -118,30 +160,12 @@ public:
   ArrayRef<uint8_t> Data;
   uint64_t getOffsetInFile() const;
 
-  // True if this section has already been placed to a linker script
-  // output section. This is needed because, in a linker script, you
-  // can refer to the same section more than once. For example, in
-  // the following linker script,
-  //
-  //   .foo : { *(.text) }
-  //   .bar : { *(.text) }
-  //
-  // .foo takes all .text sections, and .bar becomes empty. To achieve
-  // this, we need to memorize whether a section has been placed or
-  // not for each input section.
-  bool Assigned = false;
-
   // Input sections are part of an output section. Special sections
   // like .eh_frame and merge sections are first combined into a
   // synthetic section that is then added to an output section. In all
   // cases this points one level up.
   SectionBase *Parent = nullptr;
 
-  // Relocations that refer to this section.
-  const void *FirstRelocation = nullptr;
-  unsigned NumRelocations : 31;
-  unsigned AreRelocsRela : 1;
-
   template <class ELFT> ArrayRef<typename ELFT::Rel> rels() const {
     assert(!AreRelocsRela);
     return llvm::makeArrayRef(
@@ -157,7 +181,12 @@ public:
   }
 
   // InputSections that are dependent on us (reverse dependency for GC)
-  llvm::TinyPtrVector<InputSection *> DependentSections;
+  ArrayRef<InputSection *> dependentSections() const {
+    if (AuxIdx == -1U)
+      return {};
+    return SecAux[AuxIdx].DependentSections;
+  }
+  void addDependentSection(InputSection *IS);
 
   // Returns the size of this section (even if this is a common or BSS.)
   size_t getSize() const;
@@ -165,9 +194,19 @@ public:
   InputSection *getLinkOrderDep() const;
 
   // Compilers emit zlib-compressed debug sections if the -gz option
-  // is given. This function checks if this section is compressed, and
-  // if so, decompress in memory.
+  // is given. parseCompressedHeader checks if this section is compressed,
+  // and if so, only reads the uncompressed size; the contents are inflated
+  // by maybeDecompress when something needs them in memory, or straight into
+  // the output buffer by copyContents.
+  void parseCompressedHeader();
   void maybeDecompress();
+  void copyContents(uint8_t *Buf);
+  bool isCompressed() const { return IsCompressed; }
+
+  // Frees the decompressed contents of this section, keeping its size. Used
+  // by --reduce-memory-overheads once the section has been written.
+  bool isDecompressed() const { return DecompressBuf != nullptr; }
+  void releaseDecompressBuf();
 
   // Returns a source location string. Used to construct an error message.
   template <class ELFT> std::string getLocation(uint64_t Offset);
@@ -195,6 +234,17 @@ private:
   // A pointer that owns decompressed data if a section is compressed by zlib.
   // Since the feature is not used often, this is usually a nullptr.
   std::unique_ptr<char[]> DecompressBuf;
+
+  // If the contents are still compressed, Data is the compressed section
+  // and this is the size it inflates to.
+  size_t UncompressedSize = 0;
+
+  // An index into SecAux, or -1 if this section has no entry there.
+  uint32_t AuxIdx = -1;
+  unsigned IsCompressed : 1;
+  unsigned IsGnuCompressed : 1;
+
+  void decompressTo(uint8_t *Buf);
 };
 
 // SectionPiece represents a piece of splittable section contents.
@@ -233,7 +283,6 @@ public:
   // Splittable sections are handled as a sequence of data
   // rather than a single large blob of data.
   std::vector<SectionPiece> Pieces;
-  llvm::DenseMap<uint32_t, uint32_t> OffsetMap;
 
   // Returns I'th piece's data. This function is very hot when
   // string merging is enabled, so we want to inline.
@@ -256,6 +305,12 @@ public:
 private:
   void splitStrings(ArrayRef<uint8_t> A, size_t Size);
   void splitNonStrings(ArrayRef<uint8_t> A, size_t Size);
+  size_t findPiece(uint64_t Offset) const;
+
+  // The index of the piece found last. Relocations mostly refer to pieces
+  // in increasing order, so the next lookup usually hits this piece or the
+  // one after it. Lookups may run on several threads, hence the atomic.
+  mutable std::atomic<uint32_t> LastPiece{0};
 };
 
 struct EhSectionPiece {
@@ -337,8 +392,18 @@ private:
   template <class ELFT> void copyShtGroup(uint8_t *Buf);
 };
 
+// There can be millions of input sections, so keep an eye on their size.
+// The limit is 168 bytes on 64-bit hosts plus 8 for ABIs that do not put
+// NumRelocations into the tail padding of SectionBase.
+static_assert(sizeof(void *) != 8 || sizeof(InputSection) <= 176,
+              "InputSection is too big");
+
 // The list of all input sections.
 extern std::vector<InputSectionBase *> InputSections;
+
+// Returns the value a relocation of kind Expr at address P refers to.
+uint64_t getRelocTargetVA(const InputFile *File, RelType Type, int64_t A,
+                          uint64_t P, const Symbol &Sym, RelExpr Expr);
 } // namespace elf
 
 std::string toString(const elf::InputSectionBase *);
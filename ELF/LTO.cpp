@@ -31,9 +31,14 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <vector>
@@ -75,6 +80,10 @@ static lto::Config createConfig() {
   C.Options.FunctionSections = true;
   C.Options.DataSections = true;
 
+  // --icf=safe needs to know which sections of the LTO output have their
+  // address taken.
+  C.Options.EmitAddrsig = Config->ICF == ICFLevel::Safe;
+
   if (Config->Relocatable)
     C.RelocModel = None;
   else if (Config->Pic)
@@ -122,6 +131,16 @@ BitcodeCompiler::BitcodeCompiler() {
     Backend = lto::createWriteIndexesThinBackend(
         Config->ThinLTOPrefixReplace.first, Config->ThinLTOPrefixReplace.second,
         Config->ThinLTOEmitImportsFiles, IndexFile.get(), OnIndexWrite);
+  } else if (!Config->ThinLTODistributor.empty()) {
+    // The backends run as --thinlto-distributor jobs, which compile() starts
+    // once the index and the import list of each module have been written.
+    auto OnIndexWrite = [&](const std::string &Identifier) {
+      ObjectToIndexFileState[Identifier] = true;
+    };
+
+    Backend = lto::createWriteIndexesThinBackend(
+        Config->ThinLTOPrefixReplace.first, Config->ThinLTOPrefixReplace.second,
+        /*ShouldEmitImportsFiles=*/true, nullptr, OnIndexWrite);
   } else if (Config->ThinLTOJobs != -1U) {
     Backend = lto::createInProcessThinBackend(Config->ThinLTOJobs);
   }
@@ -151,6 +170,8 @@ void BitcodeCompiler::add(BitcodeFile &F) {
 
   if (Config->ThinLTOIndexOnly)
     ObjectToIndexFileState.insert({Obj.getName(), false});
+  if (!Config->ThinLTODistributor.empty())
+    DistributedModules.push_back({Obj.getName(), F.MB});
 
   ArrayRef<Symbol *> Syms = F.getSymbols();
   ArrayRef<lto::InputFile::Symbol> ObjSyms = Obj.symbols();
@@ -216,30 +237,208 @@ static void createEmptyIndex(StringRef ModulePath) {
     openFile(Path + ".imports");
 }
 
+// Runs a --thinlto-distributor command for one backend job. Returns false
+// and sets ErrMsg if the command could not be run or did not succeed.
+static bool runDistributorCommand(StringRef Command, StringRef Input,
+                                  StringRef Index, StringRef Imports,
+                                  StringRef Output, std::string &ErrMsg) {
+  SmallVector<StringRef, 16> Words;
+  Command.split(Words, ' ', -1, /*KeepEmpty=*/false);
+  if (Words.empty()) {
+    ErrMsg = "empty command";
+    return false;
+  }
+
+  std::vector<std::string> Args;
+  for (StringRef Word : Words) {
+    std::string Arg = Word;
+    for (std::pair<StringRef, StringRef> Var :
+         {std::make_pair("{input}", Input), std::make_pair("{index}", Index),
+          std::make_pair("{imports}", Imports),
+          std::make_pair("{output}", Output)}) {
+      for (size_t Pos = Arg.find(Var.first.data(), 0, Var.first.size());
+           Pos != std::string::npos;
+           Pos = Arg.find(Var.first.data(), Pos + Var.second.size(),
+                          Var.first.size()))
+        Arg.replace(Pos, Var.first.size(), Var.second.data(),
+                    Var.second.size());
+    }
+    Args.push_back(std::move(Arg));
+  }
+
+  ErrorOr<std::string> Exe = sys::findProgramByName(Args[0]);
+  if (!Exe) {
+    ErrMsg = "unable to find " + Args[0] + " in PATH: " +
+             Exe.getError().message();
+    return false;
+  }
+
+  std::vector<StringRef> Argv(Args.begin(), Args.end());
+  int Ret = sys::ExecuteAndWait(*Exe, Argv, None, {}, 0, 0, &ErrMsg);
+  if (Ret == 0)
+    return true;
+  if (ErrMsg.empty())
+    ErrMsg = Args[0] + " exited with status " + std::to_string(Ret);
+  return false;
+}
+
+// Runs the backend job of one module. Returns the path of the native object
+// file, or an empty string if neither --thinlto-distributor nor its fallback
+// could create it.
+static std::string runDistributedBackend(StringRef ModulePath,
+                                         MemoryBufferRef MB) {
+  std::string Path = getThinLTOOutputFile(ModulePath);
+  std::string Index = Path + ".thinlto.bc";
+  std::string Imports = Path + ".imports";
+  std::string Output = Path + ".thinlto.o";
+
+  // The identifiers of archive members are not file names, so write such
+  // modules out for the job to read.
+  std::string Input = ModulePath;
+  if (!sys::fs::exists(Input)) {
+    Input = Path + ".bc";
+    saveBuffer(MB.getBuffer(), Input);
+  }
+
+  std::string ErrMsg;
+  for (StringRef Command :
+       {Config->ThinLTODistributor, Config->ThinLTODistributorFallback}) {
+    if (Command.empty())
+      continue;
+    sys::fs::remove(Output);
+    if (runDistributorCommand(Command, Input, Index, Imports, Output,
+                              ErrMsg) &&
+        sys::fs::exists(Output))
+      return Output;
+    if (ErrMsg.empty())
+      ErrMsg = "no output file " + Output;
+    log("ThinLTO backend job for " + ModulePath + " failed: " + ErrMsg);
+  }
+  error("ThinLTO backend job for " + ModulePath + " failed: " + ErrMsg);
+  return "";
+}
+
+// Runs a backend job for each module that has an index, up to --thinlto-jobs
+// at a time. Returns the object file of each module in the order the
+// modules were added, or empty strings for those that need not or could
+// not be compiled.
+static std::vector<std::string> runDistributedBackends(
+    ArrayRef<std::pair<std::string, MemoryBufferRef>> Modules,
+    const StringMap<bool> &HasIndex) {
+  std::vector<std::string> Ret(Modules.size());
+  ThreadPool Pool(Config->ThinLTOJobs == -1U
+                      ? llvm::heavyweight_hardware_concurrency()
+                      : Config->ThinLTOJobs);
+  for (size_t I = 0, E = Modules.size(); I != E; ++I)
+    if (HasIndex.lookup(Modules[I].first))
+      Pool.async([&, I] {
+        Ret[I] = runDistributedBackend(Modules[I].first, Modules[I].second);
+      });
+  Pool.wait();
+  return Ret;
+}
+
 // Merge all the bitcode files we have seen, codegen the result
 // and return the resulting ObjectFile(s).
+namespace {
+// A native object stream that calls Done once the backend writing to it has
+// finished, on the thread that ran the backend.
+class NotifyingObjectStream : public lto::NativeObjectStream {
+public:
+  NotifyingObjectStream(SmallString<0> &Buf, std::function<void()> Done)
+      : NativeObjectStream(llvm::make_unique<raw_svector_ostream>(Buf)),
+        Done(std::move(Done)) {}
+  ~NotifyingObjectStream() override {
+    OS.reset();
+    Done();
+  }
+
+private:
+  std::function<void()> Done;
+};
+} // namespace
+
+static void hashGlobalNames(InputFile *F) {
+  switch (Config->EKind) {
+  case ELF32LEKind:
+    cast<ObjFile<ELF32LE>>(F)->hashGlobalNames();
+    break;
+  case ELF32BEKind:
+    cast<ObjFile<ELF32BE>>(F)->hashGlobalNames();
+    break;
+  case ELF64LEKind:
+    cast<ObjFile<ELF64LE>>(F)->hashGlobalNames();
+    break;
+  case ELF64BEKind:
+    cast<ObjFile<ELF64BE>>(F)->hashGlobalNames();
+    break;
+  default:
+    llvm_unreachable("unknown Config->EKind");
+  }
+}
+
 std::vector<InputFile *> BitcodeCompiler::compile() {
   unsigned MaxTasks = LTOObj->getMaxTasks();
   Buf.resize(MaxTasks);
   Files.resize(MaxTasks);
 
+  // The object of each backend task is turned into an ObjFile, and its
+  // symbol names are read and hashed, on the thread that ran the task as
+  // soon as it is done, so that this overlaps with code generation for the
+  // other modules. Only the allocation of the ObjFile is serialized.
+  std::vector<InputFile *> BufObjs(MaxTasks);
+  std::vector<InputFile *> FileObjs(MaxTasks);
+  uint32_t GroupId = InputFile::NextGroupId;
+  std::mutex Mu;
+
+  auto AddObject = [&](InputFile *&Obj, MemoryBufferRef MB) {
+    if (Config->ThinLTOIndexOnly)
+      return;
+    {
+      std::lock_guard<std::mutex> Lock(Mu);
+      Obj = createObjectFile(MB);
+    }
+    hashGlobalNames(Obj);
+  };
+
+  auto AddStream = [&](size_t Task) {
+    return llvm::make_unique<NotifyingObjectStream>(Buf[Task], [&, Task] {
+      if (Buf[Task].empty())
+        return;
+      if (Config->SaveTemps) {
+        if (Task == 0)
+          saveBuffer(Buf[Task], Config->OutputFile + ".lto.o");
+        else
+          saveBuffer(Buf[Task], Config->OutputFile + Twine(Task) + ".lto.o");
+      }
+      AddObject(BufObjs[Task], MemoryBufferRef(Buf[Task], "lto.tmp"));
+    });
+  };
+
   // The --thinlto-cache-dir option specifies the path to a directory in which
   // to cache native object files for ThinLTO incremental builds. If a path was
-  // specified, configure LTO to use it as the cache directory.
+  // specified, configure LTO to use it as the cache directory. Cached objects
+  // are mapped from the cache, not copied.
   lto::NativeObjectCache Cache;
   if (!Config->ThinLTOCacheDir.empty())
     Cache = check(
         lto::localCache(Config->ThinLTOCacheDir,
                         [&](size_t Task, std::unique_ptr<MemoryBuffer> MB) {
                           Files[Task] = std::move(MB);
+                          AddObject(FileObjs[Task], *Files[Task]);
                         }));
 
-  checkError(LTOObj->run(
-      [&](size_t Task) {
-        return llvm::make_unique<lto::NativeObjectStream>(
-            llvm::make_unique<raw_svector_ostream>(Buf[Task]));
-      },
-      Cache));
+  checkError(LTOObj->run(AddStream, Cache));
+
+  std::vector<InputFile *> DistributedObjs;
+  if (!Config->ThinLTODistributor.empty())
+    for (StringRef Path :
+         runDistributedBackends(DistributedModules, ObjectToIndexFileState))
+      if (!Path.empty())
+        if (Optional<MemoryBufferRef> MB = readFile(Path)) {
+          DistributedObjs.push_back(nullptr);
+          AddObject(DistributedObjs.back(), *MB);
+        }
 
   // Emit empty index files for non-indexed files
   if (Config->ThinLTOIndexOnly) {
@@ -276,21 +475,19 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
     pruneCache(Config->ThinLTOCacheDir, Config->ThinLTOCachePolicy);
 
   std::vector<InputFile *> Ret;
-  for (unsigned I = 0; I != MaxTasks; ++I) {
-    if (Buf[I].empty())
-      continue;
-    if (Config->SaveTemps) {
-      if (I == 0)
-        saveBuffer(Buf[I], Config->OutputFile + ".lto.o");
-      else
-        saveBuffer(Buf[I], Config->OutputFile + Twine(I) + ".lto.o");
-    }
-    InputFile *Obj = createObjectFile(MemoryBufferRef(Buf[I], "lto.tmp"));
-    Ret.push_back(Obj);
-  }
-
-  for (std::unique_ptr<MemoryBuffer> &File : Files)
-    if (File)
-      Ret.push_back(createObjectFile(*File));
+  for (InputFile *Obj : BufObjs)
+    if (Obj)
+      Ret.push_back(Obj);
+  for (InputFile *Obj : DistributedObjs)
+    if (Obj)
+      Ret.push_back(Obj);
+  for (InputFile *Obj : FileObjs)
+    if (Obj)
+      Ret.push_back(Obj);
+
+  // The files were created in the order their backends finished. Number
+  // their groups in task order so that the output does not depend on it.
+  for (InputFile *Obj : Ret)
+    Obj->GroupId = GroupId++;
   return Ret;
 }
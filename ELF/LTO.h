@@ -56,6 +56,7 @@ private:
   llvm::DenseSet<StringRef> UsedStartStop;
   std::unique_ptr<llvm::raw_fd_ostream> IndexFile;
   llvm::StringMap<bool> ObjectToIndexFileState;
+  std::vector<std::pair<std::string, MemoryBufferRef>> DistributedModules;
 };
 } // namespace elf
 } // namespace lld
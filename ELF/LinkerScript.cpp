@@ -13,8 +13,10 @@
 
 #include "LinkerScript.h"
 #include "Config.h"
+#include "Incremental.h"
 #include "InputSection.h"
 #include "OutputSections.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
@@ -23,6 +25,7 @@
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/BinaryFormat/ELF.h"
@@ -269,9 +272,10 @@ void LinkerScript::assignSymbol(SymbolAssignment *Cmd, bool InSec) {
     return;
   }
 
-  if (!Cmd->Sym)
+  if (!Cmd->Sym || Cmd->IsConstant)
     return;
 
+  ReadState = false;
   ExprValue V = Cmd->Expression();
   if (V.isAbsolute()) {
     Cmd->Sym->Section = nullptr;
@@ -280,6 +284,10 @@ void LinkerScript::assignSymbol(SymbolAssignment *Cmd, bool InSec) {
     Cmd->Sym->Section = V.Sec;
     Cmd->Sym->Value = V.getSectionOffset();
   }
+
+  // If the expression read nothing, its value cannot change. The symbol
+  // keeps it unless another command assigns to the symbol as well.
+  Cmd->IsConstant = !ReadState && !ReassignedSymbols.count(Cmd->Sym);
 }
 
 static std::string getFilename(InputFile *File) {
@@ -368,18 +376,90 @@ static void sortInputSections(MutableArrayRef<InputSection *> Vec,
   sortSections(Vec, Pat.SortOuter);
 }
 
+// computeInputSections is called for each input section description, and
+// looking at every input section for each of them is slow for scripts with
+// many rules. Sort the sections by name once, so that patterns that are only
+// literal names or prefixes look at just the sections they can match, and
+// compute the filename of each section once per file.
+void LinkerScript::buildSectionIndex() {
+  SectionsByName.clear();
+  SectionFilenames.clear();
+  SectionsByName.reserve(InputSections.size());
+  SectionFilenames.reserve(InputSections.size());
+
+  DenseMap<InputFile *, StringRef> Filenames;
+  for (size_t I = 0, E = InputSections.size(); I != E; ++I) {
+    InputSectionBase *Sec = InputSections[I];
+    SectionsByName.push_back({Sec->Name, I});
+    auto P = Filenames.insert({Sec->File, ""});
+    if (P.second)
+      P.first->second = Saver.save(getFilename(Sec->File));
+    SectionFilenames.push_back(P.first->second);
+  }
+  parallelSort(SectionsByName.begin(), SectionsByName.end(),
+               [](const std::pair<StringRef, uint32_t> &A,
+                  const std::pair<StringRef, uint32_t> &B) {
+                 return A < B;
+               });
+}
+
+// Returns the indices into InputSections of the sections whose names may
+// match Pat, in increasing order, or None if Pat has wildcards other than a
+// trailing '*' and every section has to be tried.
+Optional<std::vector<uint32_t>>
+LinkerScript::getSectionCandidates(const StringMatcher &Pat) {
+  std::vector<StringRef> Literals;
+  std::vector<StringRef> Prefixes;
+  if (!Pat.getLiteralsAndPrefixes(Literals, Prefixes))
+    return None;
+
+  auto ByName = [](const std::pair<StringRef, uint32_t> &A, StringRef B) {
+    return A.first < B;
+  };
+  std::vector<uint32_t> Ret;
+  for (StringRef Name : Literals)
+    for (auto It = std::lower_bound(SectionsByName.begin(),
+                                    SectionsByName.end(), Name, ByName);
+         It != SectionsByName.end() && It->first == Name; ++It)
+      Ret.push_back(It->second);
+  for (StringRef Prefix : Prefixes)
+    for (auto It = std::lower_bound(SectionsByName.begin(),
+                                    SectionsByName.end(), Prefix, ByName);
+         It != SectionsByName.end() && It->first.startswith(Prefix); ++It)
+      Ret.push_back(It->second);
+
+  // Patterns may overlap, e.g. ".text" and ".text*".
+  llvm::sort(Ret.begin(), Ret.end());
+  Ret.erase(std::unique(Ret.begin(), Ret.end()), Ret.end());
+  return Ret;
+}
+
 // Compute and remember which sections the InputSectionDescription matches.
 std::vector<InputSection *>
 LinkerScript::computeInputSections(const InputSectionDescription *Cmd) {
   std::vector<InputSection *> Ret;
 
+  // InputSections only grows, so the index is stale iff its size differs.
+  if (SectionFilenames.size() != InputSections.size())
+    buildSectionIndex();
+
   // Collects all sections that satisfy constraints of Cmd.
   for (const SectionPattern &Pat : Cmd->SectionPatterns) {
     size_t SizeBefore = Ret.size();
 
-    for (InputSectionBase *Sec : InputSections) {
+    Optional<std::vector<uint32_t>> Candidates =
+        getSectionCandidates(Pat.SectionPat);
+    size_t NumCandidates =
+        Candidates ? Candidates->size() : InputSections.size();
+
+    // Matching is independent for each section, so do it in parallel and
+    // then take the matches in input order.
+    std::vector<uint8_t> Matches(NumCandidates);
+    parallelForEachN(0, NumCandidates, [&](size_t I) {
+      size_t Idx = Candidates ? (*Candidates)[I] : I;
+      InputSectionBase *Sec = InputSections[Idx];
       if (!Sec->Live || Sec->Assigned)
-        continue;
+        return;
 
       // For -emit-relocs we have to ignore entries like
       //   .rela.dyn : { *(.rela.data) }
@@ -388,13 +468,18 @@ LinkerScript::computeInputSections(const InputSectionDescription *Cmd) {
       // want to support scripts that do custom layout for them.
       if (auto *IS = dyn_cast<InputSection>(Sec))
         if (IS->getRelocatedSection())
-          continue;
+          return;
 
-      std::string Filename = getFilename(Sec->File);
-      if (!Cmd->FilePat.match(Filename) ||
-          Pat.ExcludedFilePat.match(Filename) ||
-          !Pat.SectionPat.match(Sec->Name))
+      StringRef Filename = SectionFilenames[Idx];
+      Matches[I] = Cmd->FilePat.match(Filename) &&
+                   !Pat.ExcludedFilePat.match(Filename) &&
+                   Pat.SectionPat.match(Sec->Name);
+    });
+
+    for (size_t I = 0; I < NumCandidates; ++I) {
+      if (!Matches[I])
         continue;
+      InputSectionBase *Sec = InputSections[Candidates ? (*Candidates)[I] : I];
 
       // It is safe to assume that Sec is an InputSection
       // because mergeable or EH input sections have already been
@@ -425,7 +510,7 @@ void LinkerScript::discard(ArrayRef<InputSection *> V) {
 
     S->Assigned = false;
     S->Live = false;
-    discard(S->DependentSections);
+    discard(S->dependentSections());
   }
 }
 
@@ -524,6 +609,9 @@ void LinkerScript::processSectionCommands() {
     }
   }
   Ctx = nullptr;
+
+  SectionsByName.clear();
+  SectionFilenames.clear();
 }
 
 static OutputSection *findByName(ArrayRef<BaseCommand *> Vec,
@@ -701,6 +789,10 @@ void LinkerScript::output(InputSection *S) {
   uint64_t Pos = advance(S->getSize(), S->Alignment);
   S->OutSecOff = Pos - S->getSize() - Ctx->OutSec->Addr;
 
+  // With --incremental, leave room for the section to grow in later links.
+  if (Config->Incremental)
+    Pos = advance(getIncrementalSlotSize(S) - S->getSize(), 1);
+
   // Update output section size after adding each section. This is so that
   // SIZEOF works correctly in the case below:
   // .foo { *(.aaa) a = SIZEOF(.foo); *(.bbb) }
@@ -1033,6 +1125,11 @@ static uint64_t getInitialDot() {
 // Here we assign addresses as instructed by linker script SECTIONS
 // sub-commands. Doing that allows us to use final VA values, so here
 // we also handle rest commands like symbol assignments and ASSERTs.
+//
+// This is called again each time thunks or erratum patches are added. Only
+// the commands from the first one whose result may have changed are
+// evaluated again, and symbol assignments whose expressions read nothing
+// are not evaluated again at all.
 void LinkerScript::assignAddresses() {
   Dot = getInitialDot();
 
@@ -1041,18 +1138,163 @@ void LinkerScript::assignAddresses() {
   ErrorOnMissingSection = true;
   switchTo(Aether);
 
-  for (BaseCommand *Base : SectionCommands) {
+  size_t Begin = findFirstChangedCommand();
+  if (Begin > 0)
+    restoreCommandState(Begin);
+
+  for (size_t I = Begin, E = SectionCommands.size(); I != E; ++I) {
+    saveCommandState(I);
+    LastDependency = -1;
+
+    BaseCommand *Base = SectionCommands[I];
     if (auto *Cmd = dyn_cast<SymbolAssignment>(Base)) {
       Cmd->Addr = Dot;
       assignSymbol(Cmd, false);
       Cmd->Size = Dot - Cmd->Addr;
-      continue;
+    } else {
+      assignOffsets(cast<OutputSection>(Base));
     }
-    assignOffsets(cast<OutputSection>(Base));
+    CommandStates[I].LastDependency = LastDependency;
   }
+  saveCommandState(SectionCommands.size());
+
+  Stats->ScriptCommandsEvaluated += SectionCommands.size() - Begin;
+  Stats->ScriptCommandsSkipped += Begin;
   Ctx = nullptr;
 }
 
+// Records that the expression being evaluated read the address, size or
+// alignment of the output section of Sec.
+void LinkerScript::noteUse(SectionBase *Sec) {
+  ReadState = true;
+  if (OutputSection *OS = Sec->getOutputSection()) {
+    auto It = CommandIndices.find(OS);
+    if (It != CommandIndices.end())
+      LastDependency = std::max<int64_t>(LastDependency, It->second);
+  }
+}
+
+// Records that the expression being evaluated read the value of Sym.
+// Absolute symbols that the script does not assign to never change.
+void LinkerScript::noteUse(Defined *Sym) {
+  auto It = SymbolCommandIndices.find(Sym);
+  if (It != SymbolCommandIndices.end()) {
+    ReadState = true;
+    LastDependency = std::max<int64_t>(LastDependency, It->second);
+  }
+  if (Sym->Section)
+    noteUse(Sym->Section);
+}
+
+static uint64_t getContentHash(OutputSection *Sec) {
+  hash_code H = hash_combine(Sec->Flags, Sec->Alignment);
+  for (BaseCommand *Base : Sec->SectionCommands) {
+    auto *ISD = dyn_cast<InputSectionDescription>(Base);
+    if (!ISD)
+      continue;
+    for (InputSection *IS : ISD->Sections) {
+      bool Empty = !IS->Live;
+      if (auto *SS = dyn_cast<SyntheticSection>(IS))
+        Empty |= SS->empty();
+      H = hash_combine(H, IS, IS->Alignment, Empty ? -1 : IS->getSize());
+    }
+  }
+  return H;
+}
+
+// Returns the index of the first command of SectionCommands whose result may
+// differ from that of the previous call. That is the first output section
+// whose input sections changed, or an earlier command that read the address
+// or the size of a later section, or a symbol that a later command assigns.
+size_t LinkerScript::findFirstChangedCommand() {
+  size_t N = SectionCommands.size();
+  bool Valid = CommandStates.size() == N + 1 && Dot == InitialDot;
+  InitialDot = Dot;
+
+  size_t Begin = N;
+  for (size_t I = 0; I < N; ++I) {
+    BaseCommand *Base = SectionCommands[I];
+    if (Valid && CommandStates[I].Cmd != Base)
+      Valid = false;
+    if (!Valid)
+      break;
+    if (auto *Sec = dyn_cast<OutputSection>(Base)) {
+      uint64_t Hash = getContentHash(Sec);
+      if (Hash != CommandStates[I].ContentHash && Begin == N)
+        Begin = I;
+      CommandStates[I].ContentHash = Hash;
+    }
+  }
+  if (!Valid) {
+    resetCommandStates();
+    return 0;
+  }
+
+  for (;;) {
+    size_t I = 0;
+    while (I < Begin && CommandStates[I].LastDependency < (int64_t)Begin)
+      ++I;
+    if (I == Begin)
+      return Begin;
+    Begin = I;
+  }
+}
+
+// Forgets the results of previous calls, which is necessary when the list
+// of commands changed.
+void LinkerScript::resetCommandStates() {
+  size_t N = SectionCommands.size();
+  CommandStates.assign(N + 1, CommandState(Dot, *Ctx));
+  CommandIndices.clear();
+  SymbolCommandIndices.clear();
+  ReassignedSymbols.clear();
+
+  for (size_t I = 0; I < N; ++I) {
+    auto Add = [&](BaseCommand *Base) {
+      auto *Cmd = dyn_cast<SymbolAssignment>(Base);
+      if (!Cmd)
+        return;
+      Cmd->IsConstant = false;
+      if (!Cmd->Sym)
+        return;
+      auto P = SymbolCommandIndices.insert({Cmd->Sym, I});
+      if (!P.second) {
+        ReassignedSymbols.insert(Cmd->Sym);
+        P.first->second = I;
+      }
+    };
+
+    BaseCommand *Base = SectionCommands[I];
+    CommandStates[I].Cmd = Base;
+    if (auto *Sec = dyn_cast<OutputSection>(Base)) {
+      CommandIndices[Sec] = I;
+      CommandStates[I].ContentHash = getContentHash(Sec);
+      for (BaseCommand *Base2 : Sec->SectionCommands)
+        Add(Base2);
+    } else {
+      Add(Base);
+    }
+  }
+}
+
+void LinkerScript::saveCommandState(size_t I) {
+  CommandState &S = CommandStates[I];
+  S.Dot = Dot;
+  S.Ctx = *Ctx;
+  S.RegionPos.clear();
+  for (auto &KV : MemoryRegions)
+    S.RegionPos.push_back(KV.second->CurPos);
+}
+
+void LinkerScript::restoreCommandState(size_t I) {
+  const CommandState &S = CommandStates[I];
+  Dot = S.Dot;
+  *Ctx = S.Ctx;
+  size_t J = 0;
+  for (auto &KV : MemoryRegions)
+    KV.second->CurPos = S.RegionPos[J++];
+}
+
 // Creates program headers as instructed by PHDRS linker script command.
 std::vector<PhdrEntry *> LinkerScript::createPhdrs() {
   std::vector<PhdrEntry *> Ret;
@@ -1102,6 +1344,7 @@ bool LinkerScript::needsInterpSection() {
 
 ExprValue LinkerScript::getSymbolValue(StringRef Name, const Twine &Loc) {
   if (Name == ".") {
+    ReadState = true;
     if (Ctx)
       return {Ctx->OutSec, false, Dot - Ctx->OutSec->Addr, Loc};
     error(Loc + ": unable to get location counter value");
@@ -1109,8 +1352,10 @@ ExprValue LinkerScript::getSymbolValue(StringRef Name, const Twine &Loc) {
   }
 
   if (Symbol *Sym = Symtab->find(Name)) {
-    if (auto *DS = dyn_cast<Defined>(Sym))
+    if (auto *DS = dyn_cast<Defined>(Sym)) {
+      noteUse(DS);
       return {DS->Section, false, DS->Value, Loc};
+    }
     if (isa<SharedSymbol>(Sym))
       if (!ErrorOnMissingSection)
         return {nullptr, false, 0, Loc};
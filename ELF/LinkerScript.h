@@ -103,6 +103,10 @@ struct SymbolAssignment : BaseCommand {
   bool Provide = false;
   bool Hidden = false;
 
+  // True if the expression read no symbol, section or location counter
+  // when it was last evaluated, so that it need not be evaluated again.
+  bool IsConstant = false;
+
   // Holds file name and line number for error reporting.
   std::string Location;
 
@@ -218,6 +222,25 @@ class LinkerScript final {
     uint64_t LMAOffset = 0;
   };
 
+  // The state at the start of a command of SectionCommands, and what the
+  // last evaluation of the command read. assignAddresses uses these to
+  // resume from the first command whose result may have changed since the
+  // previous call.
+  struct CommandState {
+    CommandState(uint64_t Dot, const AddressState &Ctx) : Dot(Dot), Ctx(Ctx) {}
+
+    BaseCommand *Cmd = nullptr;
+    uint64_t Dot;
+    AddressState Ctx;
+    std::vector<uint64_t> RegionPos;
+
+    // A hash of the input sections of an output section command.
+    uint64_t ContentHash = 0;
+
+    // The index of the last command whose result this command read, or -1.
+    int64_t LastDependency = -1;
+  };
+
   llvm::DenseMap<StringRef, OutputSection *> NameToOutputSection;
 
   void addSymbol(SymbolAssignment *Cmd);
@@ -229,6 +252,10 @@ class LinkerScript final {
   std::vector<InputSection *>
   computeInputSections(const InputSectionDescription *);
 
+  void buildSectionIndex();
+  llvm::Optional<std::vector<uint32_t>>
+  getSectionCandidates(const StringMatcher &Pat);
+
   std::vector<InputSection *> createInputSectionList(OutputSection &Cmd);
 
   std::vector<size_t> getPhdrIndices(OutputSection *Sec);
@@ -241,6 +268,12 @@ class LinkerScript final {
 
   void assignOffsets(OutputSection *Sec);
 
+  size_t findFirstChangedCommand();
+  void resetCommandStates();
+  void saveCommandState(size_t I);
+  void restoreCommandState(size_t I);
+  void noteUse(Defined *Sym);
+
   // Ctx captures the local AddressState and makes it accessible
   // deliberately. This is needed as there are some cases where we cannot just
   // thread the current state through to a lambda function created by the
@@ -251,14 +284,36 @@ class LinkerScript final {
 
   OutputSection *Aether;
 
+  // Input sections sorted by name and the filename of each input section,
+  // used by computeInputSections. See buildSectionIndex.
+  std::vector<std::pair<StringRef, uint32_t>> SectionsByName;
+  std::vector<StringRef> SectionFilenames;
+
   uint64_t Dot;
 
+  std::vector<CommandState> CommandStates;
+  uint64_t InitialDot = 0;
+
+  // The index in SectionCommands of each output section, and of the last
+  // command that assigns to each symbol.
+  llvm::DenseMap<OutputSection *, size_t> CommandIndices;
+  llvm::DenseMap<Symbol *, size_t> SymbolCommandIndices;
+  llvm::DenseSet<Symbol *> ReassignedSymbols;
+
+  // What the expressions evaluated since these were last reset have read.
+  bool ReadState = false;
+  int64_t LastDependency = -1;
+
 public:
   OutputSection *createOutputSection(StringRef Name, StringRef Location);
   OutputSection *getOrCreateOutputSection(StringRef Name);
 
   bool hasPhdrsCommands() { return !PhdrsCommands.empty(); }
-  uint64_t getDot() { return Dot; }
+  uint64_t getDot() {
+    ReadState = true;
+    return Dot;
+  }
+  void noteUse(SectionBase *Sec);
   void discard(ArrayRef<InputSection *> V);
 
   ExprValue getSymbolValue(StringRef Name, const Twine &Loc);
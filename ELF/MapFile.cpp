@@ -17,6 +17,9 @@
 //   0020100e 00000000     0                 local
 //   00201005 00000000     0                 f(int)
 //
+// With --map-format=json, the same information and the sections removed by
+// --gc-sections and --icf are written as a JSON object for tools to read.
+//
 //===----------------------------------------------------------------------===//
 
 #include "MapFile.h"
@@ -26,6 +29,7 @@
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
+#include "Thunks.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
 #include "llvm/ADT/MapVector.h"
@@ -141,18 +145,7 @@ static void printEhFrame(raw_ostream &OS, OutputSection *OSec) {
   }
 }
 
-void elf::writeMapFile() {
-  if (Config->MapFile.empty())
-    return;
-
-  // Open a map file for writing.
-  std::error_code EC;
-  raw_fd_ostream OS(Config->MapFile, EC, sys::fs::F_None);
-  if (EC) {
-    error("cannot open " + Config->MapFile + ": " + EC.message());
-    return;
-  }
-
+static void writeTextMap(raw_ostream &OS) {
   // Collect symbol info that we want to print out.
   std::vector<Defined *> Syms = getSymbols();
   SymbolMapTy SectionSyms = getSectionSyms(Syms);
@@ -217,6 +210,153 @@ void elf::writeMapFile() {
   }
 }
 
+static void writeJsonString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+// Writes the fields that identify an input section.
+static void writeJsonSectionName(raw_ostream &OS, const InputSectionBase *S) {
+  OS << "\"file\": ";
+  writeJsonString(OS, toString(S->File));
+  OS << ", \"name\": ";
+  writeJsonString(OS, S->Name);
+}
+
+static void writeJsonInputSection(raw_ostream &OS, InputSection *IS,
+                                  const SymbolMapTy &SectionSyms) {
+  OS << "    {";
+  writeJsonSectionName(OS, IS);
+  OS << ", \"address\": " << IS->getVA(0)
+     << ", \"offset\": " << IS->OutSecOff << ", \"size\": " << IS->getSize()
+     << ", \"align\": " << IS->Alignment;
+
+  if (auto *TS = dyn_cast<ThunkSection>(IS)) {
+    OS << ", \"thunks\": [";
+    bool First = true;
+    for (Thunk *T : TS->getThunks()) {
+      OS << (First ? "" : ", ") << "{\"target\": ";
+      writeJsonString(OS, toString(T->Destination));
+      OS << ", \"address\": " << T->getThunkTargetSym()->getVA()
+         << ", \"size\": " << T->size() << "}";
+      First = false;
+    }
+    OS << "]";
+  }
+
+  auto It = SectionSyms.find(IS);
+  if (It != SectionSyms.end()) {
+    OS << ", \"symbols\": [";
+    bool First = true;
+    for (Defined *Sym : It->second) {
+      OS << (First ? "\n" : ",\n") << "      {\"name\": ";
+      writeJsonString(OS, toString(*Sym));
+      OS << ", \"address\": " << Sym->getVA()
+         << ", \"size\": " << Sym->getSize() << "}";
+      First = false;
+    }
+    OS << "]";
+  }
+  OS << "}";
+}
+
+static void writeJsonOutputSection(raw_ostream &OS, OutputSection *OSec,
+                                   const SymbolMapTy &SectionSyms) {
+  OS << "  {\"name\": ";
+  writeJsonString(OS, OSec->Name);
+  OS << ", \"address\": " << OSec->Addr << ", \"load_address\": "
+     << OSec->getLMA() << ", \"offset\": " << OSec->Offset
+     << ", \"size\": " << OSec->Size << ", \"align\": " << OSec->Alignment
+     << ", \"input_sections\": [";
+  bool First = true;
+  for (InputSection *IS : getInputSections(OSec)) {
+    OS << (First ? "\n" : ",\n");
+    writeJsonInputSection(OS, IS, SectionSyms);
+    First = false;
+  }
+  OS << "]}";
+}
+
+// Writes the map as a JSON object. Output sections are formatted to strings
+// in parallel, a few at a time, and written out in order, so that the map
+// is never held in memory as a whole.
+static void writeJsonMap(raw_ostream &OS) {
+  SymbolMapTy SectionSyms = getSectionSyms(getSymbols());
+
+  std::vector<OutputSection *> OSecs;
+  for (BaseCommand *Base : Script->SectionCommands)
+    if (auto *OSec = dyn_cast<OutputSection>(Base))
+      OSecs.push_back(OSec);
+
+  OS << "{\"output_sections\": [";
+  const size_t Window = 32;
+  for (size_t Begin = 0; Begin < OSecs.size(); Begin += Window) {
+    size_t End = std::min(Begin + Window, OSecs.size());
+    std::vector<std::string> Str(End - Begin);
+    parallelForEachN(Begin, End, [&](size_t I) {
+      raw_string_ostream SOS(Str[I - Begin]);
+      writeJsonOutputSection(SOS, OSecs[I], SectionSyms);
+    });
+    for (size_t I = Begin; I < End; ++I)
+      OS << (I ? ",\n" : "\n") << Str[I - Begin];
+  }
+  OS << "],\n";
+
+  // Sections folded by ICF point to the section that replaces them. Other
+  // sections from input files that are not live have been garbage-collected.
+  OS << "\"icf_folds\": [";
+  bool First = true;
+  for (InputSectionBase *S : InputSections) {
+    if (S->Repl == S)
+      continue;
+    OS << (First ? "\n" : ",\n") << "  {";
+    writeJsonSectionName(OS, S);
+    OS << ", \"size\": " << S->getSize() << ", \"folded_into\": {";
+    writeJsonSectionName(OS, cast<InputSectionBase>(S->Repl));
+    OS << "}}";
+    First = false;
+  }
+  OS << "],\n";
+
+  OS << "\"gc_sections\": [";
+  First = true;
+  for (InputSectionBase *S : InputSections) {
+    if (S->Live || S->Repl != S || !S->File)
+      continue;
+    OS << (First ? "\n" : ",\n") << "  {";
+    writeJsonSectionName(OS, S);
+    OS << ", \"size\": " << S->getSize() << "}";
+    First = false;
+  }
+  OS << "]}\n";
+}
+
+void elf::writeMapFile() {
+  if (Config->MapFile.empty())
+    return;
+
+  // Open a map file for writing.
+  std::error_code EC;
+  raw_fd_ostream OS(Config->MapFile, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Config->MapFile + ": " + EC.message());
+    return;
+  }
+
+  if (Config->MapFormat == MapFormatKind::Json)
+    writeJsonMap(OS);
+  else
+    writeTextMap(OS);
+}
+
 static void print(StringRef A, StringRef B) {
   outs() << left_justify(A, 49) << " " << B << "\n";
 }
@@ -29,6 +29,7 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Object/ELF.h"
 #include <functional>
@@ -59,17 +60,19 @@ static typename ELFT::uint getAddend(InputSectionBase &Sec,
 // identifiers, so we just store a std::vector instead of a multimap.
 static DenseMap<StringRef, std::vector<InputSectionBase *>> CNamedSections;
 
-template <class ELFT, class RelT>
-static void resolveReloc(InputSectionBase &Sec, RelT &Rel,
-                         std::function<void(InputSectionBase *, uint64_t)> Fn) {
-  Symbol &B = Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
-
-  // If a symbol is referenced in a live section, it is used.
+// If a symbol is referenced in a live section, it is used.
+template <class ELFT> static void markUsed(Symbol &B) {
   B.Used = true;
   if (auto *SS = dyn_cast<SharedSymbol>(&B))
     if (!SS->isWeak())
       SS->getFile<ELFT>().IsNeeded = true;
+}
 
+// Calls Fn for each section that a relocation against B refers to.
+template <class ELFT, class RelT>
+static void
+resolveTarget(InputSectionBase &Sec, RelT &Rel, Symbol &B,
+              std::function<void(InputSectionBase *, uint64_t)> Fn) {
   if (auto *D = dyn_cast<Defined>(&B)) {
     auto *RelSec = dyn_cast_or_null<InputSectionBase>(D->Section);
     if (!RelSec)
@@ -86,6 +89,14 @@ static void resolveReloc(InputSectionBase &Sec, RelT &Rel,
       Fn(Sec, 0);
 }
 
+template <class ELFT, class RelT>
+static void resolveReloc(InputSectionBase &Sec, RelT &Rel,
+                         std::function<void(InputSectionBase *, uint64_t)> Fn) {
+  Symbol &B = Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
+  markUsed<ELFT>(B);
+  resolveTarget<ELFT>(Sec, Rel, B, Fn);
+}
+
 // Calls Fn for each section that Sec refers to via relocations.
 template <class ELFT>
 static void
@@ -99,10 +110,49 @@ forEachSuccessor(InputSection &Sec,
       resolveReloc<ELFT>(Sec, Rel, Fn);
   }
 
-  for (InputSectionBase *IS : Sec.DependentSections)
+  for (InputSectionBase *IS : Sec.dependentSections())
     Fn(IS, 0);
 }
 
+namespace {
+// An edge found by collectSuccessors. Sym, if not null, is a symbol to be
+// marked used, and Sec, if not null, is a section to be marked live.
+struct Successor {
+  Symbol *Sym;
+  InputSectionBase *Sec;
+  uint64_t Offset;
+};
+} // namespace
+
+// Same as forEachSuccessor, but records the edges in Out instead of
+// following them, without changing any state, so that it can be called for
+// many sections in parallel.
+template <class ELFT, class RelT>
+static void collectSuccessors(InputSection &Sec, ArrayRef<RelT> Rels,
+                              std::vector<Successor> &Out) {
+  for (const RelT &Rel : Rels) {
+    Symbol &B = Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
+    Out.push_back({&B, nullptr, 0});
+    resolveTarget<ELFT>(Sec, Rel, B, [&](InputSectionBase *S, uint64_t Off) {
+      if (Out.back().Sec)
+        Out.push_back({nullptr, S, Off});
+      else
+        Out.back() = {&B, S, Off};
+    });
+  }
+}
+
+template <class ELFT>
+static void collectSuccessors(InputSection &Sec, std::vector<Successor> &Out) {
+  if (Sec.AreRelocsRela)
+    collectSuccessors<ELFT>(Sec, Sec.template relas<ELFT>(), Out);
+  else
+    collectSuccessors<ELFT>(Sec, Sec.template rels<ELFT>(), Out);
+
+  for (InputSectionBase *IS : Sec.dependentSections())
+    Out.push_back({nullptr, IS, 0});
+}
+
 // The .eh_frame section is an unfortunate special case.
 // The section is divided in CIEs and FDEs and the relocations it can have are
 // * CIEs can refer to a personality function.
@@ -258,8 +308,38 @@ template <class ELFT> static void doGcSections() {
   }
 
   // Mark all reachable sections.
-  while (!Q.empty())
-    forEachSuccessor<ELFT>(*Q.pop_back_val(), Enqueue);
+  if (getThreadCount() == 1) {
+    while (!Q.empty())
+      forEachSuccessor<ELFT>(*Q.pop_back_val(), Enqueue);
+    return;
+  }
+
+  // With threads, the graph is traversed breadth-first. The edges out of
+  // all sections found live in the previous round are collected in
+  // parallel, and then followed serially in a fixed order. Reachability
+  // does not depend on the order of the traversal, so the result is the
+  // same as that of the serial loop above.
+  std::vector<InputSection *> Frontier;
+  std::vector<std::vector<Successor>> Edges;
+  while (!Q.empty()) {
+    Frontier.assign(Q.begin(), Q.end());
+    Q.clear();
+
+    Edges.resize(Frontier.size());
+    parallelForEachN(0, Frontier.size(), [&](size_t I) {
+      Edges[I].clear();
+      collectSuccessors<ELFT>(*Frontier[I], Edges[I]);
+    });
+
+    for (size_t I = 0, E = Frontier.size(); I != E; ++I) {
+      for (const Successor &S : Edges[I]) {
+        if (S.Sym)
+          markUsed<ELFT>(*S.Sym);
+        if (S.Sec)
+          Enqueue(S.Sec, S.Offset);
+      }
+    }
+  }
 }
 
 // Before calling this function, Live bits are off for all
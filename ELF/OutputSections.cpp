@@ -22,6 +22,13 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SHA1.h"
 
+#ifdef LLD_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef LLD_HAS_ZSTD
+#include <zstd.h>
+#endif
+
 using namespace llvm;
 using namespace llvm::dwarf;
 using namespace llvm::object;
@@ -178,30 +185,141 @@ static void fill(uint8_t *Buf, size_t Size, uint32_t Filler) {
   memcpy(Buf + I, &Filler, Size - I);
 }
 
+// The ELF gABI value for zstd-compressed sections. It is not defined by
+// llvm/BinaryFormat/ELF.h yet.
+static const uint32_t ELFCOMPRESS_ZSTD = 2;
+
+#ifdef LLD_HAS_ZLIB
+// Compresses a shard into a raw deflate stream. Every shard but the last is
+// ended with Z_SYNC_FLUSH, which pads the output to a byte boundary with an
+// empty stored block, so the shards can simply be concatenated.
+static std::vector<uint8_t> deflateShard(ArrayRef<uint8_t> In, int Level,
+                                         int Flush) {
+  z_stream S = {};
+  // A negative window size means no zlib header and trailer.
+  if (deflateInit2(&S, Level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    fatal("compress failed: deflateInit2");
+  S.next_in = const_cast<uint8_t *>(In.data());
+  S.avail_in = In.size();
+
+  std::vector<uint8_t> Out(deflateBound(&S, In.size()) + 16);
+  size_t Pos = 0;
+  do {
+    if (Pos == Out.size())
+      Out.resize(Out.size() * 3 / 2);
+    S.next_out = Out.data() + Pos;
+    S.avail_out = Out.size() - Pos;
+    deflate(&S, Flush);
+    Pos = S.next_out - Out.data();
+  } while (S.avail_out == 0);
+  deflateEnd(&S);
+  Out.resize(Pos);
+  return Out;
+}
+
+// Returns the two-byte zlib stream header for a given compression level.
+// The level is only informational; FCHECK makes the header a multiple of 31.
+static uint16_t getZlibHeader(int Level) {
+  uint16_t CMF = 0x78; // Deflate with a 32 KiB window
+  uint16_t FLevel = Level < 2 ? 0 : Level < 6 ? 1 : Level == 6 ? 2 : 3;
+  uint16_t Hdr = (CMF << 8) | (FLevel << 6);
+  return Hdr + (31 - Hdr % 31) % 31;
+}
+#endif
+
+#ifdef LLD_HAS_ZSTD
+// Compresses a shard into a complete zstd frame. A sequence of frames is a
+// valid zstd stream, so nothing needs to be done to join them.
+static std::vector<uint8_t> zstdShard(ArrayRef<uint8_t> In, int Level) {
+  std::vector<uint8_t> Out(ZSTD_compressBound(In.size()));
+  size_t N =
+      ZSTD_compress(Out.data(), Out.size(), In.data(), In.size(), Level);
+  if (ZSTD_isError(N))
+    fatal("compress failed: " + StringRef(ZSTD_getErrorName(N)));
+  Out.resize(N);
+  return Out;
+}
+#endif
+
 // Compress section contents if this section contains debug info.
+//
+// The contents are split into 1 MiB shards that are compressed in parallel.
+// That loses a little compression at shard boundaries but is several times
+// faster than compressing a multi-gigabyte section on a single thread. The
+// output does not depend on the number of threads.
 template <class ELFT> void OutputSection::maybeCompress() {
   typedef typename ELFT::Chdr Elf_Chdr;
 
   // Compress only DWARF debug sections.
-  if (!Config->CompressDebugSections || (Flags & SHF_ALLOC) ||
-      !Name.startswith(".debug_"))
+  if (Config->CompressDebugSections == CompressionType::None ||
+      (Flags & SHF_ALLOC) || !Name.startswith(".debug_"))
     return;
 
   // Create a section header.
   ZDebugHeader.resize(sizeof(Elf_Chdr));
   auto *Hdr = reinterpret_cast<Elf_Chdr *>(ZDebugHeader.data());
-  Hdr->ch_type = ELFCOMPRESS_ZLIB;
+  Hdr->ch_type = Config->CompressDebugSections == CompressionType::Zstd
+                     ? ELFCOMPRESS_ZSTD
+                     : ELFCOMPRESS_ZLIB;
   Hdr->ch_size = Size;
   Hdr->ch_addralign = Alignment;
 
-  // Write section contents to a temporary buffer and compress it.
+  // Write section contents to a temporary buffer.
   std::vector<uint8_t> Buf(Size);
   writeTo<ELFT>(Buf.data());
-  if (Error E = zlib::compress(toStringRef(Buf), CompressedData))
-    fatal("compress failed: " + llvm::toString(std::move(E)));
+
+  const size_t ShardSize = 1 << 20;
+  size_t NumShards =
+      std::max<size_t>(1, (Buf.size() + ShardSize - 1) / ShardSize);
+  auto GetShard = [&](size_t I) {
+    return makeArrayRef(Buf).slice(I * ShardSize).take_front(ShardSize);
+  };
+  int Level = Config->CompressDebugSectionsLevel;
+  CompressedShards.resize(NumShards);
+
+  if (Config->CompressDebugSections == CompressionType::Zstd) {
+#ifdef LLD_HAS_ZSTD
+    parallelForEachN(0, NumShards, [&](size_t I) {
+      CompressedShards[I] = zstdShard(GetShard(I), Level);
+    });
+#endif
+  } else {
+#ifdef LLD_HAS_ZLIB
+    // A zlib stream is a header, the deflate data and the Adler-32 checksum
+    // of the uncompressed data, so compute a checksum per shard and combine
+    // them afterwards.
+    std::vector<uint32_t> Checksums(NumShards);
+    parallelForEachN(0, NumShards, [&](size_t I) {
+      ArrayRef<uint8_t> In = GetShard(I);
+      CompressedShards[I] = deflateShard(
+          In, Level, I + 1 == NumShards ? Z_FINISH : Z_SYNC_FLUSH);
+      Checksums[I] = adler32(1, In.data(), In.size());
+    });
+
+    uint32_t Checksum = 1;
+    for (size_t I = 0; I < NumShards; ++I)
+      Checksum = adler32_combine(Checksum, Checksums[I], GetShard(I).size());
+
+    std::vector<uint8_t> &First = CompressedShards.front();
+    First.insert(First.begin(), 2, 0);
+    support::endian::write16be(First.data(), getZlibHeader(Level));
+    std::vector<uint8_t> &Last = CompressedShards.back();
+    Last.resize(Last.size() + 4);
+    support::endian::write32be(Last.data() + Last.size() - 4, Checksum);
+#else
+    // Without direct access to zlib, compress the section as a whole.
+    SmallVector<char, 0> Out;
+    if (Error E = zlib::compress(toStringRef(Buf), Out, Level))
+      fatal("compress failed: " + llvm::toString(std::move(E)));
+    CompressedShards.resize(1);
+    CompressedShards[0].assign(Out.begin(), Out.end());
+#endif
+  }
 
   // Update section headers.
-  Size = sizeof(Elf_Chdr) + CompressedData.size();
+  Size = sizeof(Elf_Chdr);
+  for (const std::vector<uint8_t> &Shard : CompressedShards)
+    Size += Shard.size();
   Flags |= SHF_COMPRESSED;
 }
 
@@ -227,10 +345,16 @@ template <class ELFT> void OutputSection::writeTo(uint8_t *Buf) {
   // If -compress-debug-section is specified and if this is a debug seciton,
   // we've already compressed section contents. If that's the case,
   // just write it down.
-  if (!CompressedData.empty()) {
+  if (!CompressedShards.empty()) {
     memcpy(Buf, ZDebugHeader.data(), ZDebugHeader.size());
-    memcpy(Buf + ZDebugHeader.size(), CompressedData.data(),
-           CompressedData.size());
+    std::vector<size_t> Offsets(CompressedShards.size());
+    Offsets[0] = ZDebugHeader.size();
+    for (size_t I = 1; I < CompressedShards.size(); ++I)
+      Offsets[I] = Offsets[I - 1] + CompressedShards[I - 1].size();
+    parallelForEachN(0, CompressedShards.size(), [&](size_t I) {
+      memcpy(Buf + Offsets[I], CompressedShards[I].data(),
+             CompressedShards[I].size());
+    });
     return;
   }
 
@@ -240,6 +364,11 @@ template <class ELFT> void OutputSection::writeTo(uint8_t *Buf) {
   if (Filler)
     fill(Buf, Sections.empty() ? Size : Sections[0]->OutSecOff, Filler);
 
+  // Copying a few sections is cheaper than handing them to other threads,
+  // so each thread takes at least 16 of them. Sections are in address
+  // order, so each thread writes, and applies relocations to, one
+  // contiguous range of the output, whose pages are then allocated on the
+  // thread's NUMA node when they are first touched.
   parallelForEachN(0, Sections.size(), [&](size_t I) {
     InputSection *IS = Sections[I];
     IS->writeTo<ELFT>(Buf);
@@ -254,7 +383,7 @@ template <class ELFT> void OutputSection::writeTo(uint8_t *Buf) {
         End = Buf + Sections[I + 1]->OutSecOff;
       fill(Start, End - Start, Filler);
     }
-  });
+  }, 16, Locality::Contiguous);
 
   // Linker scripts may have BYTE()-family commands with which you
   // can write arbitrary bytes to the output. Process them if any.
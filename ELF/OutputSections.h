@@ -106,6 +106,7 @@ public:
   template <class ELFT> void finalize();
   template <class ELFT> void writeTo(uint8_t *Buf);
   template <class ELFT> void maybeCompress();
+  bool isCompressed() const { return !CompressedShards.empty(); }
 
   void sort(std::function<int(InputSectionBase *S)> Order);
   void sortInitFini();
@@ -114,7 +115,7 @@ public:
 private:
   // Used for implementation of --compress-debug-sections option.
   std::vector<uint8_t> ZDebugHeader;
-  llvm::SmallVector<char, 1> CompressedData;
+  std::vector<std::vector<uint8_t>> CompressedShards;
 
   uint32_t getFiller();
 };
@@ -45,6 +45,7 @@
 #include "Config.h"
 #include "LinkerScript.h"
 #include "OutputSections.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
@@ -52,10 +53,13 @@
 #include "Thunks.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <numeric>
 
 using namespace llvm;
 using namespace llvm::ELF;
@@ -463,8 +467,7 @@ static void replaceWithDefined(Symbol &Sym, SectionBase *Sec, uint64_t Value,
   Symbol Old = Sym;
   replaceSymbol<Defined>(&Sym, Sym.File, Sym.getName(), Sym.Binding,
                          Sym.StOther, Sym.Type, Value, Size, Sec);
-  Sym.PltIndex = Old.PltIndex;
-  Sym.GotIndex = Old.GotIndex;
+  Sym.AuxIdx = Old.AuxIdx;
   Sym.VerdefIndex = Old.VerdefIndex;
   Sym.IsPreemptible = true;
   Sym.ExportDynamic = true;
@@ -703,6 +706,25 @@ static void addPltEntry(PltSection *Plt, GotPltSection *GotPlt,
       {Type, GotPlt, Sym.getGotPltOffset(), !Sym.IsPreemptible, &Sym, 0});
 }
 
+// Add a relative relocation. If RelrDyn section is enabled, and the
+// relocation offset is guaranteed to be even, add the relocation to
+// the RelrDyn section, otherwise add it to the RelaDyn section.
+// RelrDyn sections don't support odd offsets. Also, RelrDyn sections
+// don't store the addend values, so we must write it to the relocated
+// address.
+static void addRelativeReloc(InputSectionBase *IS, uint64_t OffsetInSec,
+                             Symbol *Sym, int64_t Addend, RelExpr Expr,
+                             RelType Type) {
+  if (InX::RelrDyn && IS->Alignment >= 2 && OffsetInSec % 2 == 0) {
+    IS->Relocations.push_back({Expr, Type, OffsetInSec, Addend, Sym});
+    InX::RelrDyn->Relocs.push_back({IS, OffsetInSec});
+    ++Stats->DynamicRelocs;
+    return;
+  }
+  InX::RelaDyn->addReloc(Target->RelativeRel, IS, OffsetInSec, Sym, Addend,
+                         Expr, Type);
+}
+
 template <class ELFT> static void addGotEntry(Symbol &Sym) {
   InX::Got->addEntry(Sym);
 
@@ -725,14 +747,12 @@ template <class ELFT> static void addGotEntry(Symbol &Sym) {
 
   // Otherwise, we emit a dynamic relocation to .rel[a].dyn so that
   // the GOT slot will be fixed at load-time.
-  RelType Type;
-  if (Sym.isTls())
-    Type = Target->TlsGotRel;
-  else if (!Sym.IsPreemptible && Config->Pic && !isAbsolute(Sym))
-    Type = Target->RelativeRel;
-  else
-    Type = Target->GotRel;
-  InX::RelaDyn->addReloc(Type, InX::Got, Off, &Sym, 0,
+  if (!Sym.isTls() && !Sym.IsPreemptible && Config->Pic && !isAbsolute(Sym)) {
+    addRelativeReloc(InX::Got, Off, &Sym, 0, R_ABS, Target->GotRel);
+    return;
+  }
+  InX::RelaDyn->addReloc(Sym.isTls() ? Target->TlsGotRel : Target->GotRel,
+                         InX::Got, Off, &Sym, 0,
                          Sym.IsPreemptible ? R_ADDEND : R_ABS, Target->GotRel);
 }
 
@@ -783,10 +803,11 @@ static void processRelocAux(InputSectionBase &Sec, RelExpr Expr, RelType Type,
     bool IsPreemptibleValue = Sym.IsPreemptible && Expr != R_GOT;
 
     if (!IsPreemptibleValue) {
-      InX::RelaDyn->addReloc(Target->RelativeRel, &Sec, Offset, &Sym, Addend,
-                             Expr, Type);
+      Sec.HasDynamicRelocs = true;
+      addRelativeReloc(&Sec, Offset, &Sym, Addend, Expr, Type);
       return;
     } else if (RelType Rel = Target->getDynRel(Type)) {
+      Sec.HasDynamicRelocs = true;
       InX::RelaDyn->addReloc(Rel, &Sec, Offset, &Sym, Addend, R_ADDEND, Type);
 
       // MIPS ABI turns using of GOT and dynamic relocations inside out.
@@ -905,36 +926,69 @@ static void processRelocAux(InputSectionBase &Sec, RelExpr Expr, RelType Type,
               getLocation(Sec, Sym, Offset));
 }
 
+namespace {
+// The part of scanning a relocation that only reads the relocation, the
+// section contents and symbol state that is fixed before the scan starts.
+// Once a relocation is classified, processReloc decides what it needs and
+// creates GOT and PLT entries, copy relocations and dynamic relocations.
+struct RelocClass {
+  Symbol *Sym;
+  uint64_t Offset;
+  RelType Type;
+  RelExpr Expr;
+  // The number of relocation records this relocation was made of. It is
+  // greater than one only for MIPS N32, see getMipsN32RelType.
+  unsigned NumRecords;
+};
+} // namespace
+
+// Returns true if Adrp and Ldr are the relocations of an AArch64 GOT load
+// that --relax-got may turn into an address computation. The target checks
+// the instructions in adjustRelaxExpr.
 template <class ELFT, class RelTy>
-static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
-                      RelTy *End) {
+static bool isRelaxableGotPair(InputSectionBase &Sec, const RelTy &Adrp,
+                               const RelTy &Ldr) {
+  if (Adrp.getType(false) != R_AARCH64_ADR_GOT_PAGE ||
+      Ldr.getType(false) != R_AARCH64_LD64_GOT_LO12_NC ||
+      Adrp.getSymbol(false) != Ldr.getSymbol(false) ||
+      Ldr.r_offset != Adrp.r_offset + 4 ||
+      Ldr.r_offset + 4 > Sec.Data.size() || getAddend<ELFT>(Adrp) != 0 ||
+      getAddend<ELFT>(Ldr) != 0)
+    return false;
+
+  // The symbol must be at a fixed offset from the code.
+  Symbol &Sym = Sec.getFile<ELFT>()->getRelocTargetSym(Adrp);
+  return Sym.isDefined() && !Sym.IsPreemptible && !Sym.isGnuIFunc() &&
+         !isAbsoluteValue(Sym);
+}
+
+template <class ELFT, class RelTy>
+static RelocClass classifyReloc(InputSectionBase &Sec, OffsetGetter &GetOffset,
+                                const RelTy *Begin, const RelTy *I,
+                                const RelTy *End) {
   const RelTy &Rel = *I;
-  Symbol &Sym = Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
-  RelType Type;
+  RelocClass C;
+  C.Sym = &Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
+  C.Expr = R_NONE;
 
   // Deal with MIPS oddity.
   if (Config->MipsN32Abi) {
-    Type = getMipsN32RelType(I, End);
+    const RelTy *Next = I;
+    C.Type = getMipsN32RelType(Next, End);
+    C.NumRecords = Next - I;
   } else {
-    Type = Rel.getType(Config->IsMips64EL);
-    ++I;
+    C.Type = Rel.getType(Config->IsMips64EL);
+    C.NumRecords = 1;
   }
 
   // Get an offset in an output section this relocation is applied to.
-  uint64_t Offset = GetOffset.get(Rel.r_offset);
-  if (Offset == uint64_t(-1))
-    return;
-
-  // Skip if the target symbol is an erroneous undefined symbol.
-  if (maybeReportUndefined(Sym, Sec, Rel.r_offset))
-    return;
+  C.Offset = GetOffset.get(Rel.r_offset);
+  if (C.Offset == uint64_t(-1))
+    return C;
 
+  Symbol &Sym = *C.Sym;
   const uint8_t *RelocatedAddr = Sec.Data.begin() + Rel.r_offset;
-  RelExpr Expr = Target->getRelExpr(Type, Sym, RelocatedAddr);
-
-  // Ignore "hint" relocations because they are only markers for relaxation.
-  if (isRelExprOneOf<R_HINT, R_NONE>(Expr))
-    return;
+  RelExpr Expr = Target->getRelExpr(C.Type, Sym, RelocatedAddr);
 
   // Strenghten or relax relocations.
   //
@@ -950,10 +1004,43 @@ static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
   if (Sym.isGnuIFunc())
     Expr = toPlt(Expr);
   else if (!Sym.IsPreemptible && Expr == R_GOT_PC && !isAbsoluteValue(Sym))
-    Expr = Target->adjustRelaxExpr(Type, RelocatedAddr, Expr);
+    Expr = Target->adjustRelaxExpr(C.Type, RelocatedAddr, Expr);
   else if (!Sym.IsPreemptible)
     Expr = fromPlt(Expr);
 
+  if (Config->RelaxGot) {
+    if (Expr == R_GOT_PAGE_PC && I + 1 != End &&
+        isRelaxableGotPair<ELFT>(Sec, *I, I[1]))
+      Expr = Target->adjustRelaxExpr(C.Type, RelocatedAddr, Expr);
+    else if (Expr == R_GOT && I != Begin &&
+             isRelaxableGotPair<ELFT>(Sec, I[-1], *I))
+      Expr = Target->adjustRelaxExpr(C.Type, RelocatedAddr - 4, Expr);
+  }
+  C.Expr = Expr;
+  return C;
+}
+
+// Returns the number of relocation records following Rel's that have been
+// processed together with it.
+template <class ELFT, class RelTy>
+static unsigned processReloc(InputSectionBase &Sec, const RelTy &Rel,
+                             const RelTy *End, const RelocClass &C) {
+  if (C.Offset == uint64_t(-1))
+    return 0;
+
+  // Skip if the target symbol is an erroneous undefined symbol.
+  Symbol &Sym = *C.Sym;
+  if (maybeReportUndefined(Sym, Sec, Rel.r_offset))
+    return 0;
+
+  // Ignore "hint" relocations because they are only markers for relaxation.
+  RelExpr Expr = C.Expr;
+  if (isRelExprOneOf<R_HINT, R_NONE>(Expr))
+    return 0;
+
+  RelType Type = C.Type;
+  uint64_t Offset = C.Offset;
+
   // This relocation does not require got entry, but it is relative to got and
   // needs it to be created. Here we request for that.
   if (isRelExprOneOf<R_GOTONLY_PC, R_GOTONLY_PC_FROM_END, R_GOTREL,
@@ -966,10 +1053,8 @@ static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
   // Process some TLS relocations, including relaxing TLS relocations.
   // Note that this function does not handle all TLS relocations.
   if (unsigned Processed =
-          handleTlsRelocation<ELFT>(Type, Sym, Sec, Offset, Addend, Expr)) {
-    I += (Processed - 1);
-    return;
-  }
+          handleTlsRelocation<ELFT>(Type, Sym, Sec, Offset, Addend, Expr))
+    return Processed - 1;
 
   // If a relocation needs PLT, we create PLT and GOTPLT slots for the symbol.
   if (needsPlt(Expr) && !Sym.isInPlt()) {
@@ -998,24 +1083,88 @@ static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
   }
 
   processRelocAux<ELFT>(Sec, Expr, Type, Offset, Sym, Rel, Addend);
+  return 0;
 }
 
 template <class ELFT, class RelTy>
-static void scanRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels) {
+static void classifyRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels,
+                           RelocClass *Out) {
   OffsetGetter GetOffset(Sec);
+  for (size_t I = 0, E = Rels.size(); I != E;) {
+    Out[I] = classifyReloc<ELFT>(Sec, GetOffset, Rels.begin(),
+                                 Rels.begin() + I, Rels.end());
+    I += Out[I].NumRecords;
+  }
+}
 
+template <class ELFT, class RelTy>
+static void processRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels,
+                          const RelocClass *In) {
   // Not all relocations end up in Sec.Relocations, but a lot do.
   Sec.Relocations.reserve(Rels.size());
+  Stats->RelocsScanned += Rels.size();
+
+  for (size_t I = 0, E = Rels.size(); I != E;) {
+    const RelocClass &C = In[I];
+    unsigned Skip = processReloc<ELFT>(Sec, Rels[I], Rels.end(), C);
+    I += C.NumRecords + Skip;
+  }
+}
 
-  for (auto I = Rels.begin(), End = Rels.end(); I != End;)
-    scanReloc<ELFT>(Sec, GetOffset, I, End);
+template <class ELFT> static void classifyRelocs(InputSectionBase &S,
+                                                 RelocClass *Out) {
+  if (S.AreRelocsRela)
+    classifyRelocs<ELFT>(S, S.relas<ELFT>(), Out);
+  else
+    classifyRelocs<ELFT>(S, S.rels<ELFT>(), Out);
 }
 
-template <class ELFT> void elf::scanRelocations(InputSectionBase &S) {
+template <class ELFT> static void processRelocs(InputSectionBase &S,
+                                                const RelocClass *In) {
   if (S.AreRelocsRela)
-    scanRelocs<ELFT>(S, S.relas<ELFT>());
+    processRelocs<ELFT>(S, S.relas<ELFT>(), In);
   else
-    scanRelocs<ELFT>(S, S.rels<ELFT>());
+    processRelocs<ELFT>(S, S.rels<ELFT>(), In);
+}
+
+// Relocations are scanned in two passes over a batch of sections at a time.
+// Classifying relocations does not change any state, so it is done for all
+// sections of a batch in parallel. Then the classified relocations are
+// processed serially in input order, so GOT and PLT slots and dynamic
+// relocations are created in the same order as if the whole scan were
+// serial, and the output does not depend on the number of threads.
+template <class ELFT>
+void elf::scanRelocations(ArrayRef<InputSectionBase *> Sections) {
+  // Classified relocations are kept for at most this many relocations plus
+  // one section at a time to bound the memory used by the scan.
+  const size_t BatchSize = 1 << 20;
+
+  std::vector<RelocClass> Classes;
+  std::vector<size_t> Starts;
+  for (size_t Begin = 0, End; Begin != Sections.size(); Begin = End) {
+    size_t Total = 0;
+    Starts.clear();
+    for (End = Begin; End != Sections.size() && Total < BatchSize; ++End) {
+      Starts.push_back(Total);
+      Total += Sections[End]->NumRelocations;
+    }
+    Classes.resize(Total);
+
+    auto Classify = [&](size_t I) {
+      classifyRelocs<ELFT>(*Sections[Begin + I], Classes.data() + Starts[I]);
+    };
+
+    // AVR's getRelExpr reports unknown relocation types, so it is classified
+    // serially to keep its diagnostics in input order.
+    if (Config->EMachine == EM_AVR)
+      for (size_t I = 0; I != End - Begin; ++I)
+        Classify(I);
+    else
+      parallelForEachN(0, End - Begin, Classify);
+
+    for (size_t I = Begin; I != End; ++I)
+      processRelocs<ELFT>(*Sections[I], Classes.data() + Starts[I - Begin]);
+  }
 }
 
 // Thunk Implementation
@@ -1160,19 +1309,23 @@ void ThunkCreator::mergeThunks(ArrayRef<OutputSection *> OutputSections) {
       });
 }
 
+// Return true if a branch at Src can reach any Thunk in TS.
+static bool isThunkSecInRange(OutputSection *OS, ThunkSection *TS,
+                              RelType Type, uint64_t Src) {
+  uint64_t TSBase = OS->Addr + TS->OutSecOff;
+  uint64_t TSLimit = TSBase + TS->getSize();
+  return Target->inBranchRange(Type, Src, (Src > TSLimit) ? TSBase : TSLimit);
+}
+
 // Find or create a ThunkSection within the InputSectionDescription (ISD) that
 // is in range of Src. An ISD maps to a range of InputSections described by a
 // linker script section pattern such as { .text .text.* }.
 ThunkSection *ThunkCreator::getISDThunkSec(OutputSection *OS, InputSection *IS,
                                            InputSectionDescription *ISD,
                                            uint32_t Type, uint64_t Src) {
-  for (std::pair<ThunkSection *, uint32_t> TP : ISD->ThunkSections) {
-    ThunkSection *TS = TP.first;
-    uint64_t TSBase = OS->Addr + TS->OutSecOff;
-    uint64_t TSLimit = TSBase + TS->getSize();
-    if (Target->inBranchRange(Type, Src, (Src > TSLimit) ? TSBase : TSLimit))
-      return TS;
-  }
+  for (std::pair<ThunkSection *, uint32_t> TP : ISD->ThunkSections)
+    if (isThunkSecInRange(OS, TP.first, Type, Src))
+      return TP.first;
 
   // No suitable ThunkSection exists. This can happen when there is a branch
   // with lower range than the ThunkSection spacing or when there are too
@@ -1270,27 +1423,109 @@ ThunkSection *ThunkCreator::addThunkSection(OutputSection *OS,
   return TS;
 }
 
-std::pair<Thunk *, bool> ThunkCreator::getThunk(Symbol &Sym, RelType Type,
-                                                uint64_t Src) {
-  std::vector<Thunk *> *ThunkVec = nullptr;
+// Return the Thunks created so far for Sym.
+std::vector<Thunk *> &ThunkCreator::getThunkVec(Symbol &Sym) {
   // We use (section, offset) pair to find the thunk position if possible so
   // that we create only one thunk for aliased symbols or ICFed sections.
   if (auto *D = dyn_cast<Defined>(&Sym))
     if (!D->isInPlt() && D->Section)
-      ThunkVec = &ThunkedSymbolsBySection[{D->Section->Repl, D->Value}];
-  if (!ThunkVec)
-    ThunkVec = &ThunkedSymbols[&Sym];
-  // Check existing Thunks for Sym to see if they can be reused
-  for (Thunk *ET : *ThunkVec)
+      return ThunkedSymbolsBySection[{D->Section->Repl, D->Value}];
+  return ThunkedSymbols[&Sym];
+}
+
+// Return an existing compatible Thunk in ThunkVec that Src can reach, or
+// null if there is none.
+static Thunk *findThunk(ArrayRef<Thunk *> ThunkVec, RelType Type,
+                        uint64_t Src) {
+  for (Thunk *ET : ThunkVec)
     if (ET->isCompatibleWith(Type) &&
         Target->inBranchRange(Type, Src, ET->getThunkTargetSym()->getVA()))
-      return std::make_pair(ET, false);
+      return ET;
+  return nullptr;
+}
+
+std::pair<Thunk *, bool> ThunkCreator::getThunk(Symbol &Sym, RelType Type,
+                                                uint64_t Src) {
+  std::vector<Thunk *> &ThunkVec = getThunkVec(Sym);
+  // Check existing Thunks for Sym to see if they can be reused
+  if (Thunk *ET = findThunk(ThunkVec, Type, Src))
+    return std::make_pair(ET, false);
   // No existing compatible Thunk in range, create a new one
   Thunk *T = addThunk(Type, Sym);
-  ThunkVec->push_back(T);
+  ThunkVec.push_back(T);
   return std::make_pair(T, true);
 }
 
+// For --thunk-placement=cover. By default a new Thunk goes to the first
+// ThunkSection that is in range of the caller that needs it, and the callers
+// of the same target that are out of range of that Thunk get Thunks of their
+// own, so a target called from all over a large binary gets more Thunks than
+// it needs.
+//
+// Here the callers in ISD of each target are instead sorted by address and
+// covered greedily: the lowest caller that no Thunk serves gets a Thunk in
+// the highest ThunkSection it can reach, which also serves every later
+// caller that can reach that ThunkSection. For points on a line that is the
+// least number of Thunks the ThunkSections allow. The Candidates this
+// function has redirected are removed; the rest are left to the default
+// placement. Returns the number of Thunks created.
+uint64_t ThunkCreator::coverThunks(OutputSection *OS,
+                                   InputSectionDescription *ISD,
+                                   std::vector<ThunkCandidate> &Candidates) {
+  // Group the Candidates that no existing Thunk can serve by target and
+  // relocation type, in order of first appearance so that the Thunks are
+  // created in the same order every time. The vectors of Thunks stay put as
+  // no more targets are added to the maps until we are done.
+  typedef std::pair<std::vector<Thunk *> *, RelType> GroupKey;
+  MapVector<GroupKey, std::vector<ThunkCandidate *>> Groups;
+  for (ThunkCandidate &C : Candidates) {
+    std::vector<Thunk *> &ThunkVec = getThunkVec(*C.Rel->Sym);
+    if (!findThunk(ThunkVec, C.Rel->Type, C.Src))
+      Groups[{&ThunkVec, C.Rel->Type}].push_back(&C);
+  }
+
+  uint64_t NumNewThunks = 0;
+  for (auto &G : Groups) {
+    std::vector<Thunk *> &ThunkVec = *G.first.first;
+    RelType Type = G.first.second;
+    std::vector<ThunkCandidate *> &Callers = G.second;
+    std::stable_sort(Callers.begin(), Callers.end(),
+                     [](const ThunkCandidate *A, const ThunkCandidate *B) {
+                       return A->Src < B->Src;
+                     });
+
+    for (size_t I = 0; I < Callers.size();) {
+      ThunkSection *Best = nullptr;
+      for (std::pair<ThunkSection *, uint32_t> TP : ISD->ThunkSections)
+        if (isThunkSecInRange(OS, TP.first, Type, Callers[I]->Src) &&
+            (!Best || TP.first->OutSecOff > Best->OutSecOff))
+          Best = TP.first;
+      if (!Best)
+        break;
+
+      Thunk *T = addThunk(Type, *Callers[I]->Rel->Sym);
+      ThunkVec.push_back(T);
+      Best->addThunk(T);
+      Thunks[T->getThunkTargetSym()] = T;
+      Stats->ThunkBytes += T->size();
+      ++NumNewThunks;
+
+      for (; I < Callers.size() &&
+             isThunkSecInRange(OS, Best, Type, Callers[I]->Src);
+           ++I) {
+        Relocation &Rel = *Callers[I]->Rel;
+        Rel.Sym = T->getThunkTargetSym();
+        Rel.Expr = fromPlt(Rel.Expr);
+      }
+    }
+  }
+
+  llvm::erase_if(Candidates, [&](const ThunkCandidate &C) {
+    return Thunks.count(C.Rel->Sym);
+  });
+  return NumNewThunks;
+}
+
 // Call Fn on every executable InputSection accessed via the linker script
 // InputSectionDescription::Sections.
 void ThunkCreator::forEachInputSectionDescription(
@@ -1305,6 +1540,29 @@ void ThunkCreator::forEachInputSectionDescription(
   }
 }
 
+// Record the address and size of every InputSection so that the next pass
+// can tell which ones have moved.
+void ThunkCreator::recordAddresses(ArrayRef<OutputSection *> OutputSections) {
+  ScannedAddrs.clear();
+  for (OutputSection *OS : OutputSections)
+    for (BaseCommand *BC : OS->SectionCommands)
+      if (auto *ISD = dyn_cast<InputSectionDescription>(BC))
+        for (InputSection *IS : ISD->Sections)
+          ScannedAddrs[IS] = {IS->getVA(0), IS->getSize()};
+}
+
+// Return true if Sec may have moved or changed size since the previous pass.
+// A ThunkSection that has grown may have moved the Thunks within it. A
+// section that was not recorded, such as an OutputSection that a linker
+// script symbol is relative to, is assumed to have moved.
+bool ThunkCreator::hasMoved(const SectionBase *Sec) const {
+  auto It = ScannedAddrs.find(Sec);
+  if (It == ScannedAddrs.end())
+    return true;
+  auto *IS = cast<InputSection>(Sec);
+  return It->second != std::make_pair(IS->getVA(0), IS->getSize());
+}
+
 // Return true if the relocation target is an in range Thunk.
 // Return false if the relocation is not to a Thunk. If the relocation target
 // was originally to a Thunk, but is no longer in range we revert the
@@ -1347,6 +1605,7 @@ bool ThunkCreator::normalizeExistingThunk(Relocation &Rel, uint64_t Src) {
 // relocation out of range error.
 bool ThunkCreator::createThunks(ArrayRef<OutputSection *> OutputSections) {
   bool AddressesChanged = false;
+  uint64_t NumNewThunks = 0;
   if (Pass == 0 && Target->ThunkSectionSpacing)
     createInitialThunkSections(OutputSections);
   else if (Pass == 10)
@@ -1354,56 +1613,94 @@ bool ThunkCreator::createThunks(ArrayRef<OutputSection *> OutputSections) {
     // converge quickly; if we get to 10 something has gone wrong.
     fatal("thunk creation not converged");
 
+  // Find the relocations that need a Thunk. This only reads addresses and the
+  // Thunks created by previous passes, so the InputSectionDescriptions are
+  // scanned in parallel. A relocation whose place and target have neither
+  // moved nor changed size since the previous pass is skipped, as the
+  // decision made for it then still holds.
+  std::vector<std::pair<OutputSection *, InputSectionDescription *>> ISDs;
+  forEachInputSectionDescription(
+      OutputSections, [&](OutputSection *OS, InputSectionDescription *ISD) {
+        ISDs.push_back({OS, ISD});
+      });
+
+  std::vector<std::vector<ThunkCandidate>> Candidates(ISDs.size());
+  std::vector<uint64_t> NumScanned(ISDs.size());
+  parallelForEachN(0, ISDs.size(), [&](size_t I) {
+    for (InputSection *IS : ISDs[I].second->Sections) {
+      bool SrcMoved = hasMoved(IS);
+      for (Relocation &Rel : IS->Relocations) {
+        if (!SrcMoved) {
+          auto *D = dyn_cast<Defined>(Rel.Sym);
+          if (D && D->Section && !D->isInPlt() && !hasMoved(D->Section->Repl))
+            continue;
+        }
+        ++NumScanned[I];
+        uint64_t Src = IS->getVA(Rel.Offset);
+
+        // If we are a relocation to an existing Thunk, check if it is still
+        // in range. If not then Rel will be altered to point to its original
+        // target so another Thunk can be generated.
+        if (Pass > 0 && normalizeExistingThunk(Rel, Src))
+          continue;
+
+        if (Target->needsThunk(Rel.Expr, Rel.Type, IS->File, Src, *Rel.Sym))
+          Candidates[I].push_back({IS, &Rel, Src});
+      }
+    }
+  });
+  recordAddresses(OutputSections);
+
   // Create all the Thunks and insert them into synthetic ThunkSections. The
   // ThunkSections are later inserted back into InputSectionDescriptions.
   // We separate the creation of ThunkSections from the insertion of the
   // ThunkSections as ThunkSections are not always inserted into the same
-  // InputSectionDescription as the caller.
-  forEachInputSectionDescription(
-      OutputSections, [&](OutputSection *OS, InputSectionDescription *ISD) {
-        for (InputSection *IS : ISD->Sections)
-          for (Relocation &Rel : IS->Relocations) {
-            uint64_t Src = IS->getVA(Rel.Offset);
-
-            // If we are a relocation to an existing Thunk, check if it is
-            // still in range. If not then Rel will be altered to point to its
-            // original target so another Thunk can be generated.
-            if (Pass > 0 && normalizeExistingThunk(Rel, Src))
-              continue;
-
-            if (!Target->needsThunk(Rel.Expr, Rel.Type, IS->File, Src,
-                                    *Rel.Sym))
-              continue;
-            Thunk *T;
-            bool IsNew;
-            std::tie(T, IsNew) = getThunk(*Rel.Sym, Rel.Type, Src);
-            if (IsNew) {
-              // Find or create a ThunkSection for the new Thunk
-              ThunkSection *TS;
-              if (auto *TIS = T->getTargetInputSection())
-                TS = getISThunkSec(TIS);
-              else
-                TS = getISDThunkSec(OS, IS, ISD, Rel.Type, Src);
-              TS->addThunk(T);
-              Thunks[T->getThunkTargetSym()] = T;
-            }
-            // Redirect relocation to Thunk, we never go via the PLT to a Thunk
-            Rel.Sym = T->getThunkTargetSym();
-            Rel.Expr = fromPlt(Rel.Expr);
-          }
-        for (auto &P : ISD->ThunkSections)
-          AddressesChanged |= P.first->assignOffsets();
-      });
+  // InputSectionDescription as the caller. This is done serially in the
+  // original order so that the same Thunks are created for any number of
+  // threads.
+  for (size_t I = 0, E = ISDs.size(); I < E; ++I) {
+    OutputSection *OS = ISDs[I].first;
+    InputSectionDescription *ISD = ISDs[I].second;
+    if (Config->ThunkPlacement == ThunkPlacementPolicy::Cover &&
+        Target->ThunkSectionSpacing)
+      NumNewThunks += coverThunks(OS, ISD, Candidates[I]);
+    for (const ThunkCandidate &C : Candidates[I]) {
+      Relocation &Rel = *C.Rel;
+      Thunk *T;
+      bool IsNew;
+      std::tie(T, IsNew) = getThunk(*Rel.Sym, Rel.Type, C.Src);
+      if (IsNew) {
+        // Find or create a ThunkSection for the new Thunk
+        ThunkSection *TS;
+        if (auto *TIS = T->getTargetInputSection())
+          TS = getISThunkSec(TIS);
+        else
+          TS = getISDThunkSec(OS, C.IS, ISD, Rel.Type, C.Src);
+        TS->addThunk(T);
+        Thunks[T->getThunkTargetSym()] = T;
+        Stats->ThunkBytes += T->size();
+        ++NumNewThunks;
+      }
+      // Redirect relocation to Thunk, we never go via the PLT to a Thunk
+      Rel.Sym = T->getThunkTargetSym();
+      Rel.Expr = fromPlt(Rel.Expr);
+    }
+    for (auto &P : ISD->ThunkSections)
+      AddressesChanged |= P.first->assignOffsets();
+  }
   for (auto &P : ThunkedSections)
     AddressesChanged |= P.second->assignOffsets();
 
   // Merge all created synthetic ThunkSections back into OutputSection
   mergeThunks(OutputSections);
+  Stats->ThunksPerPass.push_back(NumNewThunks);
+  Stats->ThunkRelocsPerPass.push_back(
+      std::accumulate(NumScanned.begin(), NumScanned.end(), uint64_t(0)));
   ++Pass;
   return AddressesChanged;
 }
 
-template void elf::scanRelocations<ELF32LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF32BE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64BE>(InputSectionBase &);
+template void elf::scanRelocations<ELF32LE>(ArrayRef<InputSectionBase *>);
+template void elf::scanRelocations<ELF32BE>(ArrayRef<InputSectionBase *>);
+template void elf::scanRelocations<ELF64LE>(ArrayRef<InputSectionBase *>);
+template void elf::scanRelocations<ELF64BE>(ArrayRef<InputSectionBase *>);
@@ -124,7 +124,7 @@ struct Relocation {
   Symbol *Sym;
 };
 
-template <class ELFT> void scanRelocations(InputSectionBase &);
+template <class ELFT> void scanRelocations(ArrayRef<InputSectionBase *>);
 
 class ThunkSection;
 class Thunk;
@@ -141,6 +141,13 @@ public:
   uint32_t Pass = 0;
 
 private:
+  // A relocation that needs a Thunk, and the address of its place.
+  struct ThunkCandidate {
+    InputSection *IS;
+    Relocation *Rel;
+    uint64_t Src;
+  };
+
   void mergeThunks(ArrayRef<OutputSection *> OutputSections);
 
   ThunkSection *getISDThunkSec(OutputSection *OS, InputSection *IS,
@@ -155,13 +162,22 @@ private:
       ArrayRef<OutputSection *> OutputSections,
       std::function<void(OutputSection *, InputSectionDescription *)> Fn);
 
+  std::vector<Thunk *> &getThunkVec(Symbol &Sym);
+
   std::pair<Thunk *, bool> getThunk(Symbol &Sym, RelType Type, uint64_t Src);
 
+  uint64_t coverThunks(OutputSection *OS, InputSectionDescription *ISD,
+                       std::vector<ThunkCandidate> &Candidates);
+
   ThunkSection *addThunkSection(OutputSection *OS, InputSectionDescription *,
                                 uint64_t Off);
 
   bool normalizeExistingThunk(Relocation &Rel, uint64_t Src);
 
+  void recordAddresses(ArrayRef<OutputSection *> OutputSections);
+
+  bool hasMoved(const SectionBase *Sec) const;
+
   // Record all the available Thunks for a Symbol
   llvm::DenseMap<std::pair<SectionBase *, uint64_t>, std::vector<Thunk *>>
       ThunkedSymbolsBySection;
@@ -176,6 +192,11 @@ private:
   // so we need to make sure that there is only one of them.
   // The Mips LA25 Thunk is an example of an inline ThunkSection.
   llvm::DenseMap<InputSection *, ThunkSection *> ThunkedSections;
+
+  // The address and size of each InputSection when the previous pass scanned
+  // the relocations.
+  llvm::DenseMap<const SectionBase *, std::pair<uint64_t, uint64_t>>
+      ScannedAddrs;
 };
 
 // Return a int64_t to make sure we get the sign extension out of the way as
@@ -0,0 +1,175 @@
+//===- SampleProfile.cpp --------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SampleProfile.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Object/ELFObjectFile.h"
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace llvm::object;
+
+using namespace lld;
+using namespace lld::elf;
+
+static std::vector<CallGraphEdge>
+toEdges(const MapVector<std::pair<StringRef, StringRef>, uint64_t> &Counts) {
+  std::vector<CallGraphEdge> Ret;
+  for (const auto &KV : Counts)
+    Ret.push_back({KV.first.first, KV.first.second, KV.second});
+  return Ret;
+}
+
+namespace {
+struct FunctionRange {
+  uint64_t Addr;
+  uint64_t Size;
+  StringRef Name;
+};
+} // namespace
+
+std::vector<CallGraphEdge> elf::readPerfBranchProfile(MemoryBufferRef MB,
+                                                      MemoryBufferRef Binary) {
+  std::unique_ptr<ObjectFile> Obj =
+      check2(ObjectFile::createObjectFile(Binary),
+             [&] { return Binary.getBufferIdentifier().str(); });
+  auto *ELFObj = dyn_cast<ELFObjectFileBase>(Obj.get());
+  if (!ELFObj) {
+    error(Binary.getBufferIdentifier() + ": not an ELF file");
+    return {};
+  }
+
+  // The names point into Binary, which outlives the returned edges.
+  std::vector<FunctionRange> Funcs;
+  for (const ELFSymbolRef Sym : ELFObj->symbols()) {
+    if (Sym.getELFType() != STT_FUNC && Sym.getELFType() != STT_GNU_IFUNC)
+      continue;
+    Expected<uint64_t> Addr = Sym.getAddress();
+    Expected<StringRef> Name = Sym.getName();
+    if (!Addr || !Name || Sym.getSize() == 0) {
+      if (!Addr)
+        consumeError(Addr.takeError());
+      if (!Name)
+        consumeError(Name.takeError());
+      continue;
+    }
+    Funcs.push_back({*Addr, Sym.getSize(), *Name});
+  }
+  llvm::sort(Funcs.begin(), Funcs.end(),
+             [](const FunctionRange &A, const FunctionRange &B) {
+               return A.Addr < B.Addr;
+             });
+
+  auto Find = [&](uint64_t Addr) -> const FunctionRange * {
+    auto It = std::upper_bound(
+        Funcs.begin(), Funcs.end(), Addr,
+        [](uint64_t A, const FunctionRange &F) { return A < F.Addr; });
+    if (It == Funcs.begin())
+      return nullptr;
+    --It;
+    if (Addr - It->Addr >= It->Size)
+      return nullptr;
+    return &*It;
+  };
+
+  // Each record is FROM/TO/PREDICTED/IN_TX/ABORT/CYCLES. Other fields that
+  // perf script may print are skipped.
+  MapVector<std::pair<StringRef, StringRef>, uint64_t> Counts;
+  SmallVector<StringRef, 0> Lines;
+  MB.getBuffer().split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    while (!Line.empty()) {
+      StringRef Tok;
+      std::tie(Tok, Line) = getToken(Line);
+      StringRef FromStr, ToStr;
+      std::tie(FromStr, ToStr) = Tok.split('/');
+      ToStr = ToStr.split('/').first;
+      uint64_t FromAddr, ToAddr;
+      if (!FromStr.startswith("0x") || !ToStr.startswith("0x") ||
+          !to_integer(FromStr, FromAddr) || !to_integer(ToStr, ToAddr))
+        continue;
+
+      const FunctionRange *From = Find(FromAddr);
+      const FunctionRange *To = Find(ToAddr);
+      if (!From || !To)
+        continue;
+      if (From == To)
+        ++Counts[{From->Name, From->Name}];
+      else if (ToAddr == To->Addr)
+        ++Counts[{From->Name, To->Name}];
+    }
+  }
+  return toEdges(Counts);
+}
+
+std::vector<CallGraphEdge> elf::readAutoFDOProfile(MemoryBufferRef MB) {
+  // A function starts with an unindented "name:total:head" line, which is
+  // followed by indented lines of the form
+  //   offset[.discriminator]: count [target:count]...
+  // for samples, or
+  //   offset[.discriminator]: callee:total
+  // for inlined call sites, whose bodies are indented further.
+  MapVector<std::pair<StringRef, StringRef>, uint64_t> Counts;
+  StringRef Func;
+  SmallVector<StringRef, 0> Lines;
+  MB.getBuffer().split(Lines, '\n');
+  for (size_t I = 0; I < Lines.size(); ++I) {
+    StringRef Line = Lines[I].rtrim();
+    if (Line.empty() || Line[0] == '#')
+      continue;
+
+    auto ParseError = [&] {
+      error(MB.getBufferIdentifier() + ":" + Twine(I + 1) +
+            ": malformed AutoFDO profile line: " + Line);
+    };
+
+    if (!isSpace(Line[0])) {
+      StringRef Rest, Head, Total;
+      std::tie(Rest, Head) = Line.rsplit(':');
+      std::tie(Func, Total) = Rest.rsplit(':');
+      uint64_t N;
+      if (Func.empty() || !to_integer(Total, N)) {
+        ParseError();
+        Func = "";
+        continue;
+      }
+      if (N)
+        Counts[{Func, Func}] += N;
+      continue;
+    }
+
+    Line = Line.ltrim();
+    if (Func.empty() || Line[0] == '!')
+      continue;
+    StringRef Body = Line.split(':').second;
+    StringRef Tok;
+    std::tie(Tok, Body) = getToken(Body);
+    uint64_t N;
+    if (!to_integer(Tok, N))
+      continue; // An inlined call site.
+
+    while (!Body.empty()) {
+      std::tie(Tok, Body) = getToken(Body);
+      if (Tok.empty())
+        break;
+      StringRef Target, Count;
+      std::tie(Target, Count) = Tok.rsplit(':');
+      if (Target.empty() || !to_integer(Count, N)) {
+        ParseError();
+        break;
+      }
+      if (N)
+        Counts[{Func, Target}] += N;
+    }
+  }
+  return toEdges(Counts);
+}
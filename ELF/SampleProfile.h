@@ -0,0 +1,49 @@
+//===- SampleProfile.h ------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Readers that turn sampled execution profiles into call graph edges between
+// functions, for use by the call graph based section ordering.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_SAMPLE_PROFILE_H
+#define LLD_ELF_SAMPLE_PROFILE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+// An edge between two functions, named by their symbols. An edge from a
+// function to itself carries the samples taken inside the function.
+struct CallGraphEdge {
+  StringRef From;
+  StringRef To;
+  uint64_t Count;
+};
+
+// Reads the output of "perf script -F brstack" (last branch records) and
+// maps the branch addresses to the function symbols of Binary, the program
+// the profile was recorded from. Branches to the start of another function
+// are calls; branches within a function count as samples of it.
+std::vector<CallGraphEdge> readPerfBranchProfile(MemoryBufferRef MB,
+                                                 MemoryBufferRef Binary);
+
+// Reads an AutoFDO profile in the text format of llvm-profdata. Call targets
+// listed in the body of a function are calls from it, including those in
+// inlined code, and the total sample count of a function counts as samples
+// of it.
+std::vector<CallGraphEdge> readAutoFDOProfile(MemoryBufferRef MB);
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -18,8 +18,10 @@
 // emphasis on simplicity when we wrote this lexer. Compatibility with the
 // GNU linkers is important, but we did not try to clone every tiny corner
 // case of their lexers, as even ld.bfd and ld.gold are subtly different
-// in various corner cases. We do not care much about efficiency because
-// the time spent in parsing linker scripts is usually negligible.
+// in various corner cases. The time spent in parsing linker scripts is
+// usually negligible, but generated scripts may have millions of symbol
+// assignments. Tokens are therefore read on demand instead of all at once,
+// and line numbers are counted incrementally.
 //
 // Our grammar of the linker script is LL(2), meaning that it needs at
 // most two-token lookahead to parse. The only place we need two-token
@@ -42,8 +44,8 @@ using namespace lld::elf;
 
 // Returns a whole line containing the current token.
 StringRef ScriptLexer::getLine() {
-  StringRef S = getCurrentMB().getBuffer();
-  StringRef Tok = Tokens[Pos - 1];
+  StringRef S = MBs[Current.MB].getBuffer();
+  StringRef Tok = Current.Str;
 
   size_t Pos = S.rfind('\n', Tok.data() - S.data());
   if (Pos != StringRef::npos)
@@ -51,23 +53,28 @@ StringRef ScriptLexer::getLine() {
   return S.substr(0, S.find_first_of("\r\n"));
 }
 
-// Returns 1-based line number of the current token.
+// Returns 1-based line number of the current token. Tokens are usually
+// asked for in order, so counting starts where the last call left off.
 size_t ScriptLexer::getLineNumber() {
-  StringRef S = getCurrentMB().getBuffer();
-  StringRef Tok = Tokens[Pos - 1];
-  return S.substr(0, Tok.data() - S.data()).count('\n') + 1;
+  StringRef S = MBs[Current.MB].getBuffer();
+  LineCache &C = Lines[Current.MB];
+  const char *P = Current.Str.data();
+  if (P < C.Pos)
+    C = {S.data(), 1};
+  C.Line += StringRef(C.Pos, P - C.Pos).count('\n');
+  C.Pos = P;
+  return C.Line;
 }
 
 // Returns 0-based column number of the current token.
 size_t ScriptLexer::getColumnNumber() {
-  StringRef Tok = Tokens[Pos - 1];
-  return Tok.data() - getLine().data();
+  return Current.Str.data() - getLine().data();
 }
 
 std::string ScriptLexer::getCurrentLocation() {
-  std::string Filename = getCurrentMB().getBufferIdentifier();
-  if (!Pos)
-    return Filename;
+  if (!HasCurrent)
+    return MBs[0].getBufferIdentifier();
+  std::string Filename = MBs[Current.MB].getBufferIdentifier();
   return (Filename + ":" + Twine(getLineNumber())).str();
 }
 
@@ -79,23 +86,58 @@ void ScriptLexer::setError(const Twine &Msg) {
     return;
 
   std::string S = (getCurrentLocation() + ": " + Msg).str();
-  if (Pos)
+  if (HasCurrent)
     S += "\n>>> " + getLine().str() + "\n>>> " +
          std::string(getColumnNumber(), ' ') + "^";
   error(S);
 }
 
-// Split S into linker script tokens.
+// Makes the tokens of MB the next ones to be read.
 void ScriptLexer::tokenize(MemoryBufferRef MB) {
-  std::vector<StringRef> Vec;
+  // Tokens already read ahead from the current buffer come after MB, so
+  // put them back.
+  if (!Lookahead.empty()) {
+    Source &Src = Sources.back();
+    assert(Lookahead.front().MB == Src.MB);
+    const char *End = Src.Rest.data() + Src.Rest.size();
+    const char *Begin = Lookahead.front().Str.data();
+    Src.Rest = StringRef(Begin, End - Begin);
+    Lookahead.clear();
+  }
+
   MBs.push_back(MB);
-  StringRef S = MB.getBuffer();
-  StringRef Begin = S;
+  Lines.push_back({MB.getBufferStart(), 1});
+  Sources.push_back({MB.getBuffer(), (unsigned)MBs.size() - 1});
+}
 
-  for (;;) {
-    S = skipSpace(S);
-    if (S.empty())
-      break;
+namespace {
+// The characters of unquoted tokens.
+struct WordCharTable {
+  WordCharTable() {
+    StringRef Chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+                      "0123456789_.$/\\~=+[]*?-!^:";
+    for (char C : Chars)
+      Table[(uint8_t)C] = true;
+  }
+  bool operator[](uint8_t C) const { return Table[C]; }
+  bool Table[256] = {};
+};
+} // namespace
+
+// Reads one linker script token from the input and appends it to Lookahead.
+// Returns false if there are no more tokens.
+bool ScriptLexer::lex() {
+  static const WordCharTable WordChars;
+
+  while (!Sources.empty()) {
+    Source &Src = Sources.back();
+    StringRef S = skipSpace(Src.Rest);
+    if (S.empty()) {
+      Sources.pop_back();
+      continue;
+    }
+
+    StringRef Tok;
 
     // Quoted token. Note that double-quote characters are parts of a token
     // because, in a glob match context, only unquoted tokens are interpreted
@@ -104,40 +146,46 @@ void ScriptLexer::tokenize(MemoryBufferRef MB) {
     if (S.startswith("\"")) {
       size_t E = S.find("\"", 1);
       if (E == StringRef::npos) {
-        StringRef Filename = MB.getBufferIdentifier();
+        StringRef Begin = MBs[Src.MB].getBuffer();
+        StringRef Filename = MBs[Src.MB].getBufferIdentifier();
         size_t Lineno = Begin.substr(0, S.data() - Begin.data()).count('\n');
         error(Filename + ":" + Twine(Lineno + 1) + ": unclosed quote");
-        return;
+        Sources.clear();
+        return false;
       }
-
-      Vec.push_back(S.take_front(E + 1));
-      S = S.substr(E + 1);
-      continue;
-    }
-
-    // ">foo" is parsed to ">" and "foo", but ">>" is parsed to ">>".
-    if (S.startswith("<<") || S.startswith("<=") || S.startswith(">>") ||
-        S.startswith(">=")) {
-      Vec.push_back(S.substr(0, 2));
-      S = S.substr(2);
-      continue;
+      Tok = S.take_front(E + 1);
+    } else if (S.startswith("<<") || S.startswith("<=") ||
+               S.startswith(">>") || S.startswith(">=")) {
+      // ">foo" is parsed to ">" and "foo", but ">>" is parsed to ">>".
+      Tok = S.substr(0, 2);
+    } else {
+      // Unquoted token. This is more relaxed than tokens in C-like language,
+      // so that you can write "file-name.cpp" as one bare token, for example.
+      size_t Pos = 0;
+      while (Pos < S.size() && WordChars[(uint8_t)S[Pos]])
+        ++Pos;
+
+      // A character that cannot start a word (which is usually a
+      // punctuation) forms a single character token.
+      if (Pos == 0)
+        Pos = 1;
+      Tok = S.substr(0, Pos);
     }
 
-    // Unquoted token. This is more relaxed than tokens in C-like language,
-    // so that you can write "file-name.cpp" as one bare token, for example.
-    size_t Pos = S.find_first_not_of(
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
-        "0123456789_.$/\\~=+[]*?-!^:");
-
-    // A character that cannot start a word (which is usually a
-    // punctuation) forms a single character token.
-    if (Pos == 0)
-      Pos = 1;
-    Vec.push_back(S.substr(0, Pos));
-    S = S.substr(Pos);
+    Src.Rest = S.substr(Tok.size());
+    Lookahead.push_back({Tok, Src.MB});
+    return true;
   }
+  return false;
+}
 
-  Tokens.insert(Tokens.begin() + Pos, Vec.begin(), Vec.end());
+// Reads tokens until at least N are looked ahead at. Returns false if there
+// are not enough tokens left.
+bool ScriptLexer::fill(size_t N) {
+  while (Lookahead.size() < N)
+    if (!lex())
+      return false;
+  return true;
 }
 
 // Skip leading whitespace characters or comments.
@@ -167,7 +215,7 @@ StringRef ScriptLexer::skipSpace(StringRef S) {
 }
 
 // An erroneous token is handled as if it were the last token before EOF.
-bool ScriptLexer::atEOF() { return errorCount() || Tokens.size() == Pos; }
+bool ScriptLexer::atEOF() { return errorCount() || !fill(1); }
 
 // Split a given string as an expression.
 // This function returns "3", "*" and "5" for "3*5" for example.
@@ -213,20 +261,28 @@ static std::vector<StringRef> tokenizeExpr(StringRef S) {
 // For example, "foo*3" should be tokenized to "foo", "*" and "3" only
 // in the expression context.
 //
-// This function may split the current token into multiple tokens.
-void ScriptLexer::maybeSplitExpr() {
-  if (!InExpr || errorCount() || atEOF())
+// This function may split the I'th token looked ahead at into multiple
+// tokens.
+void ScriptLexer::maybeSplitExpr(size_t I) {
+  if (!InExpr || errorCount() || !fill(I + 1))
     return;
 
-  std::vector<StringRef> V = tokenizeExpr(Tokens[Pos]);
+  // Most tokens need no splitting, so avoid building a vector for them.
+  Token Tok = Lookahead[I];
+  if (Tok.Str.size() == 1 || Tok.Str == "!=" ||
+      Tok.Str.find_first_of("+-*/:!~") == StringRef::npos)
+    return;
+
+  std::vector<StringRef> V = tokenizeExpr(Tok.Str);
   if (V.size() == 1)
     return;
-  Tokens.erase(Tokens.begin() + Pos);
-  Tokens.insert(Tokens.begin() + Pos, V.begin(), V.end());
+  Lookahead.erase(Lookahead.begin() + I);
+  for (size_t J = 0; J < V.size(); ++J)
+    Lookahead.insert(Lookahead.begin() + I + J, {V[J], Tok.MB});
 }
 
 StringRef ScriptLexer::next() {
-  maybeSplitExpr();
+  maybeSplitExpr(0);
 
   if (errorCount())
     return "";
@@ -234,15 +290,37 @@ StringRef ScriptLexer::next() {
     setError("unexpected EOF");
     return "";
   }
-  return Tokens[Pos++];
+  Current = Lookahead.front();
+  HasCurrent = true;
+  Lookahead.pop_front();
+
+  if (Recording) {
+    if (!Recorded.empty())
+      Recorded += ' ';
+    Recorded += Current.Str;
+  }
+  return Current.Str;
 }
 
 StringRef ScriptLexer::peek() {
-  StringRef Tok = next();
+  maybeSplitExpr(0);
+
   if (errorCount())
     return "";
-  Pos = Pos - 1;
-  return Tok;
+  if (atEOF()) {
+    setError("unexpected EOF");
+    return "";
+  }
+  return Lookahead.front().Str;
+}
+
+// Returns the token after the one peek() returns, or "" if there is none.
+StringRef ScriptLexer::peek2() {
+  peek();
+  maybeSplitExpr(1);
+  if (errorCount() || !fill(2))
+    return "";
+  return Lookahead[1].Str;
 }
 
 bool ScriptLexer::consume(StringRef Tok) {
@@ -257,9 +335,10 @@ bool ScriptLexer::consume(StringRef Tok) {
 bool ScriptLexer::consumeLabel(StringRef Tok) {
   if (consume((Tok + ":").str()))
     return true;
-  if (Tokens.size() >= Pos + 2 && Tokens[Pos] == Tok &&
-      Tokens[Pos + 1] == ":") {
-    Pos += 2;
+  if (!errorCount() && fill(2) && Lookahead[0].Str == Tok &&
+      Lookahead[1].Str == ":") {
+    skip();
+    skip();
     return true;
   }
   return false;
@@ -275,19 +354,13 @@ void ScriptLexer::expect(StringRef Expect) {
     setError(Expect + " expected, but got " + Tok);
 }
 
-// Returns true if S encloses T.
-static bool encloses(StringRef S, StringRef T) {
-  return S.bytes_begin() <= T.bytes_begin() && T.bytes_end() <= S.bytes_end();
+void ScriptLexer::startRecording() {
+  assert(!Recording);
+  Recording = true;
+  Recorded.clear();
 }
 
-MemoryBufferRef ScriptLexer::getCurrentMB() {
-  // Find input buffer containing the current token.
-  assert(!MBs.empty());
-  if (!Pos)
-    return MBs[0];
-
-  for (MemoryBufferRef MB : MBs)
-    if (encloses(MB.getBuffer(), Tokens[Pos - 1]))
-      return MB;
-  llvm_unreachable("getCurrentMB: failed to find a token");
+std::string ScriptLexer::stopRecording() {
+  Recording = false;
+  return std::move(Recorded);
 }
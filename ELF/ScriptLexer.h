@@ -13,12 +13,16 @@
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include <deque>
+#include <string>
 #include <utility>
 #include <vector>
 
 namespace lld {
 namespace elf {
 
+// Tokens are read from the input on demand, so only the tokens the parser
+// is looking ahead at are kept in memory.
 class ScriptLexer {
 public:
   explicit ScriptLexer(MemoryBufferRef MB);
@@ -29,24 +33,56 @@ public:
   bool atEOF();
   StringRef next();
   StringRef peek();
+  StringRef peek2();
   void skip();
   bool consume(StringRef Tok);
   void expect(StringRef Expect);
   bool consumeLabel(StringRef Tok);
   std::string getCurrentLocation();
 
+  // Tokens returned by next() between these calls are joined by spaces and
+  // returned by stopRecording().
+  void startRecording();
+  std::string stopRecording();
+
   std::vector<MemoryBufferRef> MBs;
-  std::vector<StringRef> Tokens;
   bool InExpr = false;
-  size_t Pos = 0;
 
 private:
-  void maybeSplitExpr();
+  struct Token {
+    StringRef Str;
+    // Index into MBs of the buffer the token is in.
+    unsigned MB;
+  };
+
+  // A buffer being read. INCLUDE pushes a new one, which is read to the end
+  // before the rest of the including buffer.
+  struct Source {
+    StringRef Rest;
+    unsigned MB;
+  };
+
+  // The last position of each buffer whose line number was computed, so
+  // that line numbers are computed incrementally.
+  struct LineCache {
+    const char *Pos;
+    size_t Line;
+  };
+
+  bool lex();
+  bool fill(size_t N);
+  void maybeSplitExpr(size_t I);
   StringRef getLine();
   size_t getLineNumber();
   size_t getColumnNumber();
 
-  MemoryBufferRef getCurrentMB();
+  std::vector<Source> Sources;
+  std::deque<Token> Lookahead;
+  std::vector<LineCache> Lines;
+  Token Current = {StringRef(), 0};
+  bool HasCurrent = false;
+  bool Recording = false;
+  std::string Recorded;
 };
 
 } // namespace elf
@@ -778,7 +778,7 @@ SymbolAssignment *ScriptParser::readAssignment(StringRef Tok) {
   if (Tok == "ASSERT")
     return make<SymbolAssignment>(".", readAssert(), getCurrentLocation());
 
-  size_t OldPos = Pos;
+  startRecording();
   SymbolAssignment *Cmd = nullptr;
   if (peek() == "=" || peek() == "+=")
     Cmd = readSymbolAssignment(Tok);
@@ -788,11 +788,10 @@ SymbolAssignment *ScriptParser::readAssignment(StringRef Tok) {
     Cmd = readProvideHidden(false, true);
   else if (Tok == "PROVIDE_HIDDEN")
     Cmd = readProvideHidden(true, true);
+  std::string Rest = stopRecording();
 
   if (Cmd) {
-    Cmd->CommandString =
-        Tok.str() + " " +
-        llvm::join(Tokens.begin() + OldPos, Tokens.begin() + Pos, " ");
+    Cmd->CommandString = Tok.str() + " " + Rest;
     expect(";");
   }
   return Cmd;
@@ -961,11 +960,9 @@ ByteCommand *ScriptParser::readByteCommand(StringRef Tok) {
   if (Size == -1)
     return nullptr;
 
-  size_t OldPos = Pos;
+  startRecording();
   Expr E = readParenExpr();
-  std::string CommandString =
-      Tok.str() + " " +
-      llvm::join(Tokens.begin() + OldPos, Tokens.begin() + Pos, " ");
+  std::string CommandString = Tok.str() + " " + stopRecording();
   return make<ByteCommand>(E, Size, CommandString);
 }
 
@@ -1019,6 +1016,7 @@ Expr ScriptParser::readPrimary() {
     OutputSection *Sec = Script->getOrCreateOutputSection(Name);
     return [=]() -> ExprValue {
       checkIfExists(Sec, Location);
+      Script->noteUse(Sec);
       return {Sec, false, 0, Location};
     };
   }
@@ -1043,6 +1041,7 @@ Expr ScriptParser::readPrimary() {
     OutputSection *Cmd = Script->getOrCreateOutputSection(Name);
     return [=] {
       checkIfExists(Cmd, Location);
+      Script->noteUse(Cmd);
       return Cmd->Alignment;
     };
   }
@@ -1095,6 +1094,7 @@ Expr ScriptParser::readPrimary() {
     OutputSection *Cmd = Script->getOrCreateOutputSection(Name);
     return [=] {
       checkIfExists(Cmd, Location);
+      Script->noteUse(Cmd);
       return Cmd->getLMA();
     };
   }
@@ -1130,7 +1130,10 @@ Expr ScriptParser::readPrimary() {
     // Linker script does not create an output section if its content is empty.
     // We want to allow SIZEOF(.foo) where .foo is a section which happened to
     // be empty.
-    return [=] { return Cmd->Size; };
+    return [=] {
+      Script->noteUse(Cmd);
+      return Cmd->Size;
+    };
   }
   if (Tok == "SIZEOF_HEADERS")
     return [=] { return elf::getHeaderSize(); };
@@ -0,0 +1,103 @@
+//===- Stats.cpp ----------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Stats.h"
+#include "Config.h"
+#include "InputFiles.h"
+#include "LinkerScript.h"
+#include "OutputSections.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::ELF;
+
+using namespace lld;
+using namespace lld::elf;
+
+LinkStats *elf::Stats;
+
+static void print(const Twine &Name, const Twine &Value) {
+  std::string S;
+  raw_string_ostream OS(S);
+  OS << format("%-24s", (Name + ":").str().c_str()) << Value;
+  message(OS.str());
+}
+
+void elf::printStats() {
+  print("input files", Twine(ObjectFiles.size()) + " objects, " +
+                           Twine(SharedFiles.size()) + " shared, " +
+                           Twine(BitcodeFiles.size()) + " bitcode, " +
+                           Twine(BinaryFiles.size()) + " binary");
+  print("input sections", Twine(Stats->InputSections.load()) + " total, " +
+                              Twine(Stats->LiveSections.load()) + " live");
+  print("section pieces", Twine(Stats->PiecesBeforeMerge.load()) +
+                              " before merging, " +
+                              Twine(Stats->PiecesAfterMerge.load()) + " after");
+  print("relocations scanned", Twine(Stats->RelocsScanned.load()));
+  print("dynamic relocations", Twine(Stats->DynamicRelocs.load()));
+  if (Config->Pic || Stats->DirtyPages)
+    print("pages dirtied at load", Twine(Stats->DirtyPages.load()) + " of " +
+                                       Twine(Stats->WritablePages.load()) +
+                                       " writable");
+  if (Config->ZCompactSegments)
+    print("compact segments", Twine(Stats->LoadSegments.load()) +
+                                  " PT_LOADs, about " +
+                                  Twine(Stats->SegmentPaddingSaved.load()) +
+                                  " bytes of padding saved");
+
+  std::string Thunks;
+  for (size_t I = 0; I < Stats->ThunksPerPass.size(); ++I)
+    Thunks += (Twine(I ? ", " : "") + Twine(Stats->ThunksPerPass[I]) +
+               " in pass " + Twine(I) + " (" +
+               Twine(Stats->ThunkRelocsPerPass[I]) + " relocations)")
+                  .str();
+  print("thunks created", Thunks.empty() ? "0" : Thunks);
+  print("thunk bytes", Twine(Stats->ThunkBytes.load()));
+  if (Config->EMachine == EM_MIPS)
+    print("MIPS GOTs", Twine(Stats->MipsGots.load()) + " GOTs, " +
+                           Twine(Stats->MipsGotEntries.load()) + " entries");
+
+  print("ICF", Twine(Stats->ICFIterations.load()) + " iterations, " +
+                   Twine(Stats->ICFFolded.load()) + " sections folded");
+
+  std::string Splits;
+  for (size_t I = 0; I < Stats->ICFSplitsPerIteration.size(); ++I)
+    Splits += (Twine(I ? ", " : "") + Twine(Stats->ICFSplitsPerIteration[I]) +
+               " in iteration " + Twine(I))
+                  .str();
+  print("ICF classes split", Splits.empty() ? "0" : Splits);
+
+  if (!Config->GdbIndexCacheDir.empty())
+    print("gdb index cache", Twine(Stats->GdbIndexCacheHits.load()) +
+                                 " hits, " +
+                                 Twine(Stats->GdbIndexCacheMisses.load()) +
+                                 " misses");
+  if (!Config->ArchiveIndexCacheDir.empty() || InBatch)
+    print("archive index cache",
+          Twine(Stats->ArchiveIndexCacheHits.load()) + " hits, " +
+              Twine(Stats->ArchiveIndexCacheMisses.load()) + " misses");
+  if (Script->HasSectionsCommand)
+    print("linker script commands",
+          Twine(Stats->ScriptCommandsEvaluated.load()) + " evaluated, " +
+              Twine(Stats->ScriptCommandsSkipped.load()) + " skipped");
+  if (Stats->CallGraphLocality >= 0) {
+    std::string S;
+    raw_string_ostream OS(S);
+    OS << format("%.3f", Stats->CallGraphLocality);
+    print("call graph locality", OS.str());
+  }
+
+  message("bytes written:");
+  for (OutputSection *Sec : OutputSections) {
+    uint64_t Size = Sec->Type == SHT_NOBITS ? 0 : Sec->Size;
+    print("  " + Sec->Name, Twine(Size));
+  }
+}
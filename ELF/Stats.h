@@ -0,0 +1,73 @@
+//===- Stats.h --------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Counters that describe the size of a link's workload, printed by
+// --print-stats. When a link gets slower they tell whether it got more
+// input or whether one of the passes got slower on the same input.
+//
+// The counters are atomic so that parallel passes can bump them, but hot
+// loops should add their totals once per section rather than once per item.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_STATS_H
+#define LLD_ELF_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+struct LinkStats {
+  std::atomic<uint64_t> InputSections{0};
+  std::atomic<uint64_t> LiveSections{0};
+  std::atomic<uint64_t> PiecesBeforeMerge{0};
+  std::atomic<uint64_t> PiecesAfterMerge{0};
+  std::atomic<uint64_t> RelocsScanned{0};
+  std::atomic<uint64_t> DynamicRelocs{0};
+  std::atomic<uint64_t> DirtyPages{0};
+  std::atomic<uint64_t> WritablePages{0};
+  std::atomic<uint64_t> LoadSegments{0};
+  std::atomic<uint64_t> SegmentPaddingSaved{0};
+  std::atomic<uint64_t> ICFIterations{0};
+  std::atomic<uint64_t> ICFFolded{0};
+  std::atomic<uint64_t> GdbIndexCacheHits{0};
+  std::atomic<uint64_t> GdbIndexCacheMisses{0};
+  std::atomic<uint64_t> ArchiveIndexCacheHits{0};
+  std::atomic<uint64_t> ArchiveIndexCacheMisses{0};
+  std::atomic<uint64_t> ThunkBytes{0};
+  std::atomic<uint64_t> MipsGots{0};
+  std::atomic<uint64_t> MipsGotEntries{0};
+  std::atomic<uint64_t> ScriptCommandsEvaluated{0};
+  std::atomic<uint64_t> ScriptCommandsSkipped{0};
+
+  // The fraction of profiled calls expected to stay within a page, or -1 if
+  // no sections were ordered by a call graph profile.
+  double CallGraphLocality = -1;
+
+  // The number of thunks created by each pass of ThunkCreator.
+  std::vector<uint64_t> ThunksPerPass;
+
+  // The number of equivalence classes split by each iteration of ICF.
+  std::vector<uint64_t> ICFSplitsPerIteration;
+
+  // The number of relocations each pass of ThunkCreator had to examine.
+  std::vector<uint64_t> ThunkRelocsPerPass;
+};
+
+extern LinkStats *Stats;
+
+void printStats();
+
+} // namespace elf
+} // namespace lld
+
+#endif
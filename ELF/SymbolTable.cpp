@@ -22,6 +22,7 @@
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 
 using namespace llvm;
@@ -94,8 +95,10 @@ template <class ELFT> void SymbolTable::addFile(InputFile *File) {
   if (auto *F = dyn_cast<SharedFile<ELFT>>(File)) {
     // DSOs are uniquified not by filename but by soname.
     F->parseSoName();
-    if (errorCount() || !SoNames.insert(F->SoName).second)
+    if (errorCount() || !SoNames.insert(F->SoName).second) {
+      F->GlobalNames = {};
       return;
+    }
     SharedFiles.push_back(F);
     F->parseRest();
     return;
@@ -109,8 +112,83 @@ template <class ELFT> void SymbolTable::addFile(InputFile *File) {
   }
 
   // Regular object file
-  ObjectFiles.push_back(File);
-  cast<ObjFile<ELFT>>(File)->parse(ComdatGroups);
+  auto *F = cast<ObjFile<ELFT>>(File);
+  ObjectFiles.push_back(F);
+  if (!PrehashedNames.empty()) {
+    auto It = PrehashedNames.find(F->MB.getBufferStart());
+    if (It != PrehashedNames.end()) {
+      F->GlobalNames = std::move(It->second);
+      PrehashedNames.erase(It);
+    }
+  }
+  prehashMembers(*F);
+  F->parse(ComdatGroups);
+}
+
+// Returns the buffer of the file that fetching Sym would add to the link,
+// or an empty buffer if Sym is not lazy or the buffer cannot be found
+// cheaply. Thin archive members are skipped because getting their buffers
+// opens the member files.
+static MemoryBufferRef getLazyBuffer(Symbol *Sym) {
+  if (auto *S = dyn_cast<LazyArchive>(Sym)) {
+    Expected<Archive::Child> C = S->getArchiveSymbol().getMember();
+    if (!C) {
+      consumeError(C.takeError());
+      return {};
+    }
+    if (C->getParent()->isThin())
+      return {};
+    Expected<MemoryBufferRef> MB = C->getMemoryBufferRef();
+    if (!MB) {
+      consumeError(MB.takeError());
+      return {};
+    }
+    return *MB;
+  }
+  if (auto *S = dyn_cast<LazyObject>(Sym)) {
+    auto *F = cast<LazyObjFile>(S->File);
+    if (!F->AddedToLink)
+      return F->MB;
+  }
+  return {};
+}
+
+// Archive members are fetched one at a time, when an undefined symbol that
+// needs one is inserted, and each member is parsed before the rest of the
+// file that fetched it. Parsing them in rounds would change that order and
+// with it the result of the link, so instead we guess which members File is
+// going to fetch and read their symbol names on all cores before File is
+// parsed. The guess is that every global name of File that is now lazy
+// fetches its member. A wrong guess costs only the wasted work.
+template <class ELFT> void SymbolTable::prehashMembers(ObjFile<ELFT> &File) {
+  if (getThreadCount() == 1)
+    return;
+  if (File.GlobalNames.empty())
+    File.hashGlobalNames();
+
+  std::vector<MemoryBufferRef> MBs;
+  for (CachedHashStringRef Name : File.GlobalNames) {
+    auto &Shard = getShard(Name);
+    auto It = Shard.find(Name);
+    if (It == Shard.end() || It->second < 0)
+      continue;
+    MemoryBufferRef MB = getLazyBuffer(SymVector[It->second]);
+    if (MB.getBufferSize() == 0 || isBitcode(MB))
+      continue;
+    if (PrehashedNames.insert({MB.getBufferStart(), {}}).second)
+      MBs.push_back(MB);
+  }
+  if (MBs.empty())
+    return;
+
+  std::vector<std::vector<CachedHashStringRef>> Names(MBs.size());
+  parallelForEachN(0, MBs.size(), [&](size_t I) {
+    Names[I] = readGlobalNames<ELFT>(MBs[I]);
+  });
+  reserve(std::vector<ArrayRef<CachedHashStringRef>>(Names.begin(),
+                                                     Names.end()));
+  for (size_t I = 0; I < MBs.size(); ++I)
+    PrehashedNames[MBs[I].getBufferStart()] = std::move(Names[I]);
 }
 
 // This function is where all the optimizations of link-time
@@ -149,7 +227,8 @@ Defined *SymbolTable::addAbsolute(StringRef Name, uint8_t Visibility,
 // Set a flag for --trace-symbol so that we can print out a log message
 // if a new symbol with the same name is inserted into the symbol table.
 void SymbolTable::trace(StringRef Name) {
-  SymMap.insert({CachedHashStringRef(Name), -1});
+  CachedHashStringRef Key(Name);
+  getShard(Key).insert({Key, -1});
 }
 
 // Rename SYM as __wrap_SYM. The original symbol is preserved as __real_SYM.
@@ -214,26 +293,85 @@ static uint8_t getMinVisibility(uint8_t VA, uint8_t VB) {
   return std::min(VA, VB);
 }
 
+// Returns true if Name is <name>@@<version>. That means the symbol is the
+// default version, and <name>@@<version> will be used to resolve references
+// to <name>.
+//
+// Since this is a hot path, the following string search code is
+// optimized for speed. StringRef::find(char) is much faster than
+// StringRef::find(StringRef).
+static bool hasDefaultVersion(StringRef Name, size_t &Pos) {
+  Pos = Name.find('@');
+  return Pos != StringRef::npos && Pos + 1 < Name.size() &&
+         Name[Pos + 1] == '@';
+}
+
+// Reserve entries in the symbol map for the global symbols of all regular
+// object files and shared objects, and for the defined global symbols of
+// all --start-lib objects, in Files before they are added in order by
+// addFile.
+//
+// Reading and hashing symbol names and growing the map are the parts of
+// symbol resolution that do not depend on the order of the files, so they
+// are done here in parallel: first for all files, then for each shard of the
+// map. Reserved entries are invisible until addFile inserts them, so symbols
+// are still resolved and numbered exactly as if they were inserted serially.
+template <class ELFT>
+void SymbolTable::preinsert(ArrayRef<InputFile *> Files) {
+  if (getThreadCount() == 1)
+    return;
+
+  std::vector<ELFFileBase<ELFT> *> Objs;
+  std::vector<LazyObjFile *> LazyObjs;
+  for (InputFile *F : Files) {
+    if ((F->kind() == InputFile::ObjKind ||
+         F->kind() == InputFile::SharedKind) &&
+        F->EKind == Config->EKind)
+      Objs.push_back(cast<ELFFileBase<ELFT>>(F));
+    else if (F->kind() == InputFile::LazyObjKind && !isBitcode(F->MB))
+      LazyObjs.push_back(cast<LazyObjFile>(F));
+  }
+
+  parallelForEach(Objs, [](ELFFileBase<ELFT> *F) { F->hashGlobalNames(); });
+  parallelForEach(LazyObjs,
+                  [](LazyObjFile *F) { F->hashDefinedNames<ELFT>(); });
+
+  std::vector<ArrayRef<CachedHashStringRef>> Names;
+  for (ELFFileBase<ELFT> *F : Objs)
+    Names.push_back(F->GlobalNames);
+  for (LazyObjFile *F : LazyObjs)
+    Names.push_back(F->DefinedNames);
+  reserve(Names);
+}
+
+// Reserves SymMap entries for the given names, one shard per task.
+void SymbolTable::reserve(ArrayRef<ArrayRef<CachedHashStringRef>> Names) {
+  parallelForEachN(0, array_lengthof(SymMap), [&](size_t I) {
+    for (ArrayRef<CachedHashStringRef> V : Names) {
+      for (CachedHashStringRef Name : V) {
+        size_t Pos;
+        if (getShardIndex(Name) == I && !hasDefaultVersion(Name.val(), Pos))
+          SymMap[I].insert({Name, -2});
+      }
+    }
+  });
+}
+
 // Find an existing symbol or create and insert a new one.
-std::pair<Symbol *, bool> SymbolTable::insert(StringRef Name) {
-  // <name>@@<version> means the symbol is the default version. In that
-  // case <name>@@<version> will be used to resolve references to <name>.
-  //
-  // Since this is a hot path, the following string search code is
-  // optimized for speed. StringRef::find(char) is much faster than
-  // StringRef::find(StringRef).
-  size_t Pos = Name.find('@');
-  if (Pos != StringRef::npos && Pos + 1 < Name.size() && Name[Pos + 1] == '@')
-    Name = Name.take_front(Pos);
-
-  auto P = SymMap.insert({CachedHashStringRef(Name), (int)SymVector.size()});
+std::pair<Symbol *, bool> SymbolTable::insert(CachedHashStringRef Name) {
+  size_t Pos;
+  if (hasDefaultVersion(Name.val(), Pos))
+    Name = CachedHashStringRef(Name.val().take_front(Pos));
+
+  auto P = getShard(Name).insert({Name, (int)SymVector.size()});
   int &SymIndex = P.first->second;
   bool IsNew = P.second;
   bool Traced = false;
 
-  if (SymIndex == -1) {
+  if (SymIndex < 0) {
+    Traced = SymIndex == -1;
     SymIndex = SymVector.size();
-    IsNew = Traced = true;
+    IsNew = true;
   }
 
   Symbol *Sym;
@@ -254,8 +392,8 @@ std::pair<Symbol *, bool> SymbolTable::insert(StringRef Name) {
 
 // Find an existing symbol or create and insert a new one, then apply the given
 // attributes.
-std::pair<Symbol *, bool> SymbolTable::insert(StringRef Name, uint8_t Type,
-                                              uint8_t Visibility,
+std::pair<Symbol *, bool> SymbolTable::insert(CachedHashStringRef Name,
+                                              uint8_t Type, uint8_t Visibility,
                                               bool CanOmitFromDynSym,
                                               InputFile *File) {
   Symbol *S;
@@ -289,14 +427,15 @@ template <class ELFT> Symbol *SymbolTable::addUndefined(StringRef Name) {
 static uint8_t getVisibility(uint8_t StOther) { return StOther & 3; }
 
 template <class ELFT>
-Symbol *SymbolTable::addUndefined(StringRef Name, uint8_t Binding,
+Symbol *SymbolTable::addUndefined(CachedHashStringRef Key, uint8_t Binding,
                                   uint8_t StOther, uint8_t Type,
                                   bool CanOmitFromDynSym, InputFile *File) {
+  StringRef Name = Key.val();
   Symbol *S;
   bool WasInserted;
   uint8_t Visibility = getVisibility(StOther);
   std::tie(S, WasInserted) =
-      insert(Name, Type, Visibility, CanOmitFromDynSym, File);
+      insert(Key, Type, Visibility, CanOmitFromDynSym, File);
 
   // An undefined symbol with non default visibility must be satisfied
   // in the same DSO.
@@ -439,12 +578,13 @@ static int compareDefinedNonCommon(Symbol *S, bool WasInserted, uint8_t Binding,
   return 0;
 }
 
-Symbol *SymbolTable::addCommon(StringRef N, uint64_t Size, uint32_t Alignment,
-                               uint8_t Binding, uint8_t StOther, uint8_t Type,
-                               InputFile &File) {
+Symbol *SymbolTable::addCommon(CachedHashStringRef Key, uint64_t Size,
+                               uint32_t Alignment, uint8_t Binding,
+                               uint8_t StOther, uint8_t Type, InputFile &File) {
+  StringRef N = Key.val();
   Symbol *S;
   bool WasInserted;
-  std::tie(S, WasInserted) = insert(N, Type, getVisibility(StOther),
+  std::tie(S, WasInserted) = insert(Key, Type, getVisibility(StOther),
                                     /*CanOmitFromDynSym*/ false, &File);
 
   int Cmp = compareDefined(S, WasInserted, Binding, N);
@@ -521,12 +661,14 @@ static void reportDuplicate(Symbol *Sym, InputFile *NewFile,
   error(Msg);
 }
 
-Symbol *SymbolTable::addRegular(StringRef Name, uint8_t StOther, uint8_t Type,
-                                uint64_t Value, uint64_t Size, uint8_t Binding,
-                                SectionBase *Section, InputFile *File) {
+Symbol *SymbolTable::addRegular(CachedHashStringRef Key, uint8_t StOther,
+                                uint8_t Type, uint64_t Value, uint64_t Size,
+                                uint8_t Binding, SectionBase *Section,
+                                InputFile *File) {
+  StringRef Name = Key.val();
   Symbol *S;
   bool WasInserted;
-  std::tie(S, WasInserted) = insert(Name, Type, getVisibility(StOther),
+  std::tie(S, WasInserted) = insert(Key, Type, getVisibility(StOther),
                                     /*CanOmitFromDynSym*/ false, File);
   int Cmp = compareDefinedNonCommon(S, WasInserted, Binding, Section == nullptr,
                                     Value, Name);
@@ -540,7 +682,7 @@ Symbol *SymbolTable::addRegular(StringRef Name, uint8_t StOther, uint8_t Type,
 }
 
 template <typename ELFT>
-void SymbolTable::addShared(StringRef Name, SharedFile<ELFT> &File,
+void SymbolTable::addShared(CachedHashStringRef Name, SharedFile<ELFT> &File,
                             const typename ELFT::Sym &Sym, uint32_t Alignment,
                             uint32_t VerdefIndex) {
   // DSO symbols do not affect visibility in the output, so we pass STV_DEFAULT
@@ -560,9 +702,9 @@ void SymbolTable::addShared(StringRef Name, SharedFile<ELFT> &File,
       ((S->isUndefined() || S->isLazy()) && S->Visibility == STV_DEFAULT)) {
     uint8_t Binding = S->Binding;
     bool WasUndefined = S->isUndefined();
-    replaceSymbol<SharedSymbol>(S, File, Name, Sym.getBinding(), Sym.st_other,
-                                Sym.getType(), Sym.st_value, Sym.st_size,
-                                Alignment, VerdefIndex);
+    replaceSymbol<SharedSymbol>(S, File, Name.val(), Sym.getBinding(),
+                                Sym.st_other, Sym.getType(), Sym.st_value,
+                                Sym.st_size, Alignment, VerdefIndex);
     if (!WasInserted) {
       S->Binding = Binding;
       if (!S->isWeak() && !Config->GcSections && WasUndefined)
@@ -588,10 +730,12 @@ Symbol *SymbolTable::addBitcode(StringRef Name, uint8_t Binding,
 }
 
 Symbol *SymbolTable::find(StringRef Name) {
-  auto It = SymMap.find(CachedHashStringRef(Name));
-  if (It == SymMap.end())
+  CachedHashStringRef Key(Name);
+  auto &Shard = getShard(Key);
+  auto It = Shard.find(Key);
+  if (It == Shard.end())
     return nullptr;
-  if (It->second == -1)
+  if (It->second < 0)
     return nullptr;
   return SymVector[It->second];
 }
@@ -599,7 +743,7 @@ Symbol *SymbolTable::find(StringRef Name) {
 // This is used to handle lazy symbols. May replace existent
 // symbol with lazy version or request to Fetch it.
 template <class ELFT, typename LazyT, typename... ArgT>
-static void replaceOrFetchLazy(StringRef Name, InputFile &File,
+static void replaceOrFetchLazy(CachedHashStringRef Name, InputFile &File,
                                llvm::function_ref<InputFile *()> Fetch,
                                ArgT &&... Arg) {
   Symbol *S;
@@ -626,16 +770,16 @@ static void replaceOrFetchLazy(StringRef Name, InputFile &File,
 }
 
 template <class ELFT>
-void SymbolTable::addLazyArchive(StringRef Name, ArchiveFile &F,
+void SymbolTable::addLazyArchive(CachedHashStringRef Name, ArchiveFile &F,
                                  const object::Archive::Symbol Sym) {
   replaceOrFetchLazy<ELFT, LazyArchive>(Name, F, [&]() { return F.fetch(Sym); },
                                         Sym);
 }
 
 template <class ELFT>
-void SymbolTable::addLazyObject(StringRef Name, LazyObjFile &Obj) {
+void SymbolTable::addLazyObject(CachedHashStringRef Name, LazyObjFile &Obj) {
   replaceOrFetchLazy<ELFT, LazyObject>(Name, Obj, [&]() { return Obj.fetch(); },
-                                       Name);
+                                       Name.val());
 }
 
 template <class ELFT> void SymbolTable::fetchLazy(Symbol *Sym) {
@@ -650,6 +794,38 @@ template <class ELFT> void SymbolTable::fetchLazy(Symbol *Sym) {
     addFile<ELFT>(File);
 }
 
+// Returns the outermost scope of an "extern C++" pattern, e.g. "foo" for
+// "foo::bar*", or "" if the pattern may match names that start with
+// anything. "std" is excluded because its names are mangled with
+// abbreviations such as "St" and "Ss".
+static StringRef getCppPatternScope(StringRef Pat) {
+  size_t Pos = Pat.find("::");
+  if (Pos == StringRef::npos)
+    return "";
+  StringRef Scope = Pat.take_front(Pos);
+  if (Scope == "std" || !isValidCIdentifier(Scope))
+    return "";
+  return Scope;
+}
+
+// Returns true if a mangled name may demangle to a name that starts with
+// "<scope>::" for one of Scopes. Such names are nested names, optionally in
+// a local name, whose first component is the scope, e.g. _ZN3foo3barEv or
+// _ZZN3foo3barEvE1x. Names with a return type demangle to a string that
+// starts with the type, so they cannot match either.
+static bool mayBeInScope(StringRef Name, const DenseSet<StringRef> &Scopes) {
+  if (!Name.consume_front("_Z"))
+    return false;
+  Name.consume_front("Z");
+  if (!Name.consume_front("N"))
+    return false;
+  Name = Name.ltrim("rVKRO");
+  size_t Len;
+  if (Name.consumeInteger(10, Len) || Len > Name.size())
+    return false;
+  return Scopes.count(Name.take_front(Len));
+}
+
 // Initialize DemangledSyms with a map from demangled symbols to symbol
 // objects. Used to handle "extern C++" directive in version scripts.
 //
@@ -663,17 +839,53 @@ template <class ELFT> void SymbolTable::fetchLazy(Symbol *Sym) {
 // other than trying to match a pattern against all demangled symbols.
 // So, if "extern C++" feature is used, we need to demangle all known
 // symbols.
+//
+// If every "extern C++" pattern starts with a namespace or class name,
+// symbols that are not mangled as members of one of them cannot match, so
+// they are entered under their mangled names, as if demangling had failed,
+// without being demangled.
 StringMap<std::vector<Symbol *>> &SymbolTable::getDemangledSyms() {
-  if (!DemangledSyms) {
-    DemangledSyms.emplace();
-    for (Symbol *Sym : SymVector) {
-      if (!Sym->isDefined())
+  if (DemangledSyms)
+    return *DemangledSyms;
+  DemangledSyms.emplace();
+
+  DenseSet<StringRef> Scopes;
+  bool UseScopes = true;
+  auto AddPatterns = [&](ArrayRef<SymbolVersion> Vers) {
+    for (const SymbolVersion &Ver : Vers) {
+      if (!Ver.IsExternCpp)
         continue;
-      if (Optional<std::string> S = demangleItanium(Sym->getName()))
-        (*DemangledSyms)[*S].push_back(Sym);
+      StringRef Scope = getCppPatternScope(Ver.Name);
+      if (Scope.empty())
+        UseScopes = false;
       else
-        (*DemangledSyms)[Sym->getName()].push_back(Sym);
+        Scopes.insert(Scope);
     }
+  };
+  AddPatterns(Config->DynamicList);
+  AddPatterns(Config->VersionScriptGlobals);
+  AddPatterns(Config->VersionScriptLocals);
+  for (VersionDefinition &V : Config->VersionDefinitions)
+    AddPatterns(V.Globals);
+
+  std::vector<Optional<std::string>> Demangled(SymVector.size());
+  parallelForEachN(0, SymVector.size(), [&](size_t I) {
+    Symbol *Sym = SymVector[I];
+    if (!Sym->isDefined())
+      return;
+    if (UseScopes && !mayBeInScope(Sym->getName(), Scopes))
+      return;
+    Demangled[I] = demangleItanium(Sym->getName());
+  });
+
+  for (size_t I = 0; I < SymVector.size(); ++I) {
+    Symbol *Sym = SymVector[I];
+    if (!Sym->isDefined())
+      continue;
+    if (Demangled[I])
+      (*DemangledSyms)[*Demangled[I]].push_back(Sym);
+    else
+      (*DemangledSyms)[Sym->getName()].push_back(Sym);
   }
   return *DemangledSyms;
 }
@@ -708,14 +920,19 @@ std::vector<Symbol *> SymbolTable::findAllByVersion(SymbolVersion Ver) {
 // script file, the script does not actually define any symbol version,
 // but just specifies symbols visibilities.
 void SymbolTable::handleAnonymousVersion() {
-  for (SymbolVersion &Ver : Config->VersionScriptGlobals)
+  std::vector<std::pair<SymbolVersion, uint16_t>> Globals;
+  for (SymbolVersion &Ver : Config->VersionScriptGlobals) {
     assignExactVersion(Ver, VER_NDX_GLOBAL, "global");
-  for (SymbolVersion &Ver : Config->VersionScriptGlobals)
-    assignWildcardVersion(Ver, VER_NDX_GLOBAL);
-  for (SymbolVersion &Ver : Config->VersionScriptLocals)
+    Globals.push_back({Ver, VER_NDX_GLOBAL});
+  }
+  assignWildcardVersions(Globals);
+
+  std::vector<std::pair<SymbolVersion, uint16_t>> Locals;
+  for (SymbolVersion &Ver : Config->VersionScriptLocals) {
     assignExactVersion(Ver, VER_NDX_LOCAL, "local");
-  for (SymbolVersion &Ver : Config->VersionScriptLocals)
-    assignWildcardVersion(Ver, VER_NDX_LOCAL);
+    Locals.push_back({Ver, VER_NDX_LOCAL});
+  }
+  assignWildcardVersions(Locals);
 }
 
 // Handles -dynamic-list.
@@ -767,16 +984,79 @@ void SymbolTable::assignExactVersion(SymbolVersion Ver, uint16_t VersionId,
   }
 }
 
-void SymbolTable::assignWildcardVersion(SymbolVersion Ver, uint16_t VersionId) {
-  if (!Ver.HasWildcard)
-    return;
+// Set symbol versions to symbols. This function handles patterns
+// containing wildcard characters, all of them in one pass over the symbols
+// rather than one pass per pattern.
+//
+// Exact matching takes precendence over fuzzy matching,
+// so we set a version to a symbol only if no version has been assigned
+// to the symbol. This behavior is compatible with GNU. Among the given
+// patterns the first one that matches a symbol wins, which is what applying
+// them one by one in this order would do.
+void SymbolTable::assignWildcardVersions(
+    ArrayRef<std::pair<SymbolVersion, uint16_t>> Patterns) {
+  std::vector<StringRef> Names;
+  std::vector<StringRef> CppNames;
+  std::vector<unsigned> NameIndices;
+  std::vector<unsigned> CppNameIndices;
+  for (unsigned I = 0; I < Patterns.size(); ++I) {
+    const SymbolVersion &Ver = Patterns[I].first;
+    if (!Ver.HasWildcard)
+      continue;
+    if (Ver.IsExternCpp) {
+      CppNames.push_back(Ver.Name);
+      CppNameIndices.push_back(I);
+    } else {
+      Names.push_back(Ver.Name);
+      NameIndices.push_back(I);
+    }
+  }
 
-  // Exact matching takes precendence over fuzzy matching,
-  // so we set a version to a symbol only if no version has been assigned
-  // to the symbol. This behavior is compatible with GNU.
-  for (Symbol *B : findAllByVersion(Ver))
-    if (B->VersionId == Config->DefaultSymbolVersion)
-      B->VersionId = VersionId;
+  // The index of the first pattern that matches each symbol.
+  const unsigned NoMatch = -1;
+  DenseMap<Symbol *, unsigned> Matches;
+
+  if (!Names.empty()) {
+    StringMatcher M(Names);
+    std::vector<unsigned> Res(SymVector.size(), NoMatch);
+    parallelForEachN(0, SymVector.size(), [&](size_t I) {
+      Symbol *Sym = SymVector[I];
+      if (!Sym->isDefined())
+        return;
+      int J = M.find(Sym->getName());
+      if (J != -1)
+        Res[I] = NameIndices[J];
+    });
+    for (size_t I = 0; I < SymVector.size(); ++I)
+      if (Res[I] != NoMatch)
+        Matches[SymVector[I]] = Res[I];
+  }
+
+  if (!CppNames.empty()) {
+    StringMatcher M(CppNames);
+    std::vector<StringMapEntry<std::vector<Symbol *>> *> Entries;
+    for (auto &P : getDemangledSyms())
+      Entries.push_back(&P);
+    std::vector<unsigned> Res(Entries.size(), NoMatch);
+    parallelForEachN(0, Entries.size(), [&](size_t I) {
+      int J = M.find(Entries[I]->first());
+      if (J != -1)
+        Res[I] = CppNameIndices[J];
+    });
+    for (size_t I = 0; I < Entries.size(); ++I) {
+      if (Res[I] == NoMatch)
+        continue;
+      for (Symbol *Sym : Entries[I]->second) {
+        auto P = Matches.insert({Sym, Res[I]});
+        if (!P.second)
+          P.first->second = std::min(P.first->second, Res[I]);
+      }
+    }
+  }
+
+  for (std::pair<Symbol *, unsigned> &P : Matches)
+    if (P.first->VersionId == Config->DefaultSymbolVersion)
+      P.first->VersionId = Patterns[P.second].second;
 }
 
 // This function processes version scripts by updating VersionId
@@ -800,9 +1080,11 @@ void SymbolTable::scanVersionScript() {
   // i.e. version definitions containing glob meta-characters.
   // Note that because the last match takes precedence over previous matches,
   // we iterate over the definitions in the reverse order.
+  std::vector<std::pair<SymbolVersion, uint16_t>> Patterns;
   for (VersionDefinition &V : llvm::reverse(Config->VersionDefinitions))
     for (SymbolVersion &Ver : V.Globals)
-      assignWildcardVersion(Ver, V.Id);
+      Patterns.push_back({Ver, V.Id});
+  assignWildcardVersions(Patterns);
 
   // Symbol themselves might know their versions because symbols
   // can contain versions in the form of <name>@<version>.
@@ -816,6 +1098,11 @@ template void SymbolTable::addFile<ELF32BE>(InputFile *);
 template void SymbolTable::addFile<ELF64LE>(InputFile *);
 template void SymbolTable::addFile<ELF64BE>(InputFile *);
 
+template void SymbolTable::preinsert<ELF32LE>(ArrayRef<InputFile *>);
+template void SymbolTable::preinsert<ELF32BE>(ArrayRef<InputFile *>);
+template void SymbolTable::preinsert<ELF64LE>(ArrayRef<InputFile *>);
+template void SymbolTable::preinsert<ELF64BE>(ArrayRef<InputFile *>);
+
 template void SymbolTable::addSymbolWrap<ELF32LE>(StringRef);
 template void SymbolTable::addSymbolWrap<ELF32BE>(StringRef);
 template void SymbolTable::addSymbolWrap<ELF64LE>(StringRef);
@@ -826,14 +1113,18 @@ template Symbol *SymbolTable::addUndefined<ELF32BE>(StringRef);
 template Symbol *SymbolTable::addUndefined<ELF64LE>(StringRef);
 template Symbol *SymbolTable::addUndefined<ELF64BE>(StringRef);
 
-template Symbol *SymbolTable::addUndefined<ELF32LE>(StringRef, uint8_t, uint8_t,
-                                                    uint8_t, bool, InputFile *);
-template Symbol *SymbolTable::addUndefined<ELF32BE>(StringRef, uint8_t, uint8_t,
-                                                    uint8_t, bool, InputFile *);
-template Symbol *SymbolTable::addUndefined<ELF64LE>(StringRef, uint8_t, uint8_t,
-                                                    uint8_t, bool, InputFile *);
-template Symbol *SymbolTable::addUndefined<ELF64BE>(StringRef, uint8_t, uint8_t,
-                                                    uint8_t, bool, InputFile *);
+template Symbol *
+SymbolTable::addUndefined<ELF32LE>(CachedHashStringRef, uint8_t, uint8_t,
+                                   uint8_t, bool, InputFile *);
+template Symbol *
+SymbolTable::addUndefined<ELF32BE>(CachedHashStringRef, uint8_t, uint8_t,
+                                   uint8_t, bool, InputFile *);
+template Symbol *
+SymbolTable::addUndefined<ELF64LE>(CachedHashStringRef, uint8_t, uint8_t,
+                                   uint8_t, bool, InputFile *);
+template Symbol *
+SymbolTable::addUndefined<ELF64BE>(CachedHashStringRef, uint8_t, uint8_t,
+                                   uint8_t, bool, InputFile *);
 
 template void SymbolTable::addCombinedLTOObject<ELF32LE>();
 template void SymbolTable::addCombinedLTOObject<ELF32BE>();
@@ -841,37 +1132,45 @@ template void SymbolTable::addCombinedLTOObject<ELF64LE>();
 template void SymbolTable::addCombinedLTOObject<ELF64BE>();
 
 template void
-SymbolTable::addLazyArchive<ELF32LE>(StringRef, ArchiveFile &,
+SymbolTable::addLazyArchive<ELF32LE>(CachedHashStringRef, ArchiveFile &,
                                      const object::Archive::Symbol);
 template void
-SymbolTable::addLazyArchive<ELF32BE>(StringRef, ArchiveFile &,
+SymbolTable::addLazyArchive<ELF32BE>(CachedHashStringRef, ArchiveFile &,
                                      const object::Archive::Symbol);
 template void
-SymbolTable::addLazyArchive<ELF64LE>(StringRef, ArchiveFile &,
+SymbolTable::addLazyArchive<ELF64LE>(CachedHashStringRef, ArchiveFile &,
                                      const object::Archive::Symbol);
 template void
-SymbolTable::addLazyArchive<ELF64BE>(StringRef, ArchiveFile &,
+SymbolTable::addLazyArchive<ELF64BE>(CachedHashStringRef, ArchiveFile &,
                                      const object::Archive::Symbol);
 
-template void SymbolTable::addLazyObject<ELF32LE>(StringRef, LazyObjFile &);
-template void SymbolTable::addLazyObject<ELF32BE>(StringRef, LazyObjFile &);
-template void SymbolTable::addLazyObject<ELF64LE>(StringRef, LazyObjFile &);
-template void SymbolTable::addLazyObject<ELF64BE>(StringRef, LazyObjFile &);
+template void SymbolTable::addLazyObject<ELF32LE>(CachedHashStringRef,
+                                                LazyObjFile &);
+template void SymbolTable::addLazyObject<ELF32BE>(CachedHashStringRef,
+                                                LazyObjFile &);
+template void SymbolTable::addLazyObject<ELF64LE>(CachedHashStringRef,
+                                                LazyObjFile &);
+template void SymbolTable::addLazyObject<ELF64BE>(CachedHashStringRef,
+                                                LazyObjFile &);
 
 template void SymbolTable::fetchLazy<ELF32LE>(Symbol *);
 template void SymbolTable::fetchLazy<ELF32BE>(Symbol *);
 template void SymbolTable::fetchLazy<ELF64LE>(Symbol *);
 template void SymbolTable::fetchLazy<ELF64BE>(Symbol *);
 
-template void SymbolTable::addShared<ELF32LE>(StringRef, SharedFile<ELF32LE> &,
+template void SymbolTable::addShared<ELF32LE>(CachedHashStringRef,
+                                              SharedFile<ELF32LE> &,
                                               const typename ELF32LE::Sym &,
                                               uint32_t Alignment, uint32_t);
-template void SymbolTable::addShared<ELF32BE>(StringRef, SharedFile<ELF32BE> &,
+template void SymbolTable::addShared<ELF32BE>(CachedHashStringRef,
+                                              SharedFile<ELF32BE> &,
                                               const typename ELF32BE::Sym &,
                                               uint32_t Alignment, uint32_t);
-template void SymbolTable::addShared<ELF64LE>(StringRef, SharedFile<ELF64LE> &,
+template void SymbolTable::addShared<ELF64LE>(CachedHashStringRef,
+                                              SharedFile<ELF64LE> &,
                                               const typename ELF64LE::Sym &,
                                               uint32_t Alignment, uint32_t);
-template void SymbolTable::addShared<ELF64BE>(StringRef, SharedFile<ELF64BE> &,
+template void SymbolTable::addShared<ELF64BE>(CachedHashStringRef,
+                                              SharedFile<ELF64BE> &,
                                               const typename ELF64BE::Sym &,
                                               uint32_t Alignment, uint32_t);
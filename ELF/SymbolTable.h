@@ -36,6 +36,7 @@ class SectionBase;
 class SymbolTable {
 public:
   template <class ELFT> void addFile(InputFile *File);
+  template <class ELFT> void preinsert(ArrayRef<InputFile *> Files);
   template <class ELFT> void addCombinedLTOObject();
   template <class ELFT> void addSymbolWrap(StringRef Name);
   void applySymbolWrap();
@@ -48,34 +49,68 @@ public:
 
   template <class ELFT> Symbol *addUndefined(StringRef Name);
   template <class ELFT>
+  Symbol *addUndefined(llvm::CachedHashStringRef Name, uint8_t Binding,
+                       uint8_t StOther, uint8_t Type, bool CanOmitFromDynSym,
+                       InputFile *File);
+  template <class ELFT>
   Symbol *addUndefined(StringRef Name, uint8_t Binding, uint8_t StOther,
-                       uint8_t Type, bool CanOmitFromDynSym, InputFile *File);
+                       uint8_t Type, bool CanOmitFromDynSym, InputFile *File) {
+    return addUndefined<ELFT>(llvm::CachedHashStringRef(Name), Binding,
+                              StOther, Type, CanOmitFromDynSym, File);
+  }
+  Symbol *addRegular(llvm::CachedHashStringRef Name, uint8_t StOther,
+                     uint8_t Type, uint64_t Value, uint64_t Size,
+                     uint8_t Binding, SectionBase *Section, InputFile *File);
   Symbol *addRegular(StringRef Name, uint8_t StOther, uint8_t Type,
                      uint64_t Value, uint64_t Size, uint8_t Binding,
-                     SectionBase *Section, InputFile *File);
+                     SectionBase *Section, InputFile *File) {
+    return addRegular(llvm::CachedHashStringRef(Name), StOther, Type, Value,
+                      Size, Binding, Section, File);
+  }
 
   template <class ELFT>
-  void addShared(StringRef Name, SharedFile<ELFT> &F,
+  void addShared(llvm::CachedHashStringRef Name, SharedFile<ELFT> &F,
                  const typename ELFT::Sym &Sym, uint32_t Alignment,
                  uint32_t VerdefIndex);
 
   template <class ELFT>
-  void addLazyArchive(StringRef Name, ArchiveFile &F,
+  void addLazyArchive(llvm::CachedHashStringRef Name, ArchiveFile &F,
                       const llvm::object::Archive::Symbol S);
+  template <class ELFT>
+  void addLazyArchive(StringRef Name, ArchiveFile &F,
+                      const llvm::object::Archive::Symbol S) {
+    addLazyArchive<ELFT>(llvm::CachedHashStringRef(Name), F, S);
+  }
 
-  template <class ELFT> void addLazyObject(StringRef Name, LazyObjFile &Obj);
+  template <class ELFT>
+  void addLazyObject(llvm::CachedHashStringRef Name, LazyObjFile &Obj);
 
   Symbol *addBitcode(StringRef Name, uint8_t Binding, uint8_t StOther,
                      uint8_t Type, bool CanOmitFromDynSym, BitcodeFile &File);
 
+  Symbol *addCommon(llvm::CachedHashStringRef Name, uint64_t Size,
+                    uint32_t Alignment, uint8_t Binding, uint8_t StOther,
+                    uint8_t Type, InputFile &File);
   Symbol *addCommon(StringRef Name, uint64_t Size, uint32_t Alignment,
                     uint8_t Binding, uint8_t StOther, uint8_t Type,
-                    InputFile &File);
-
-  std::pair<Symbol *, bool> insert(StringRef Name);
+                    InputFile &File) {
+    return addCommon(llvm::CachedHashStringRef(Name), Size, Alignment, Binding,
+                     StOther, Type, File);
+  }
+
+  std::pair<Symbol *, bool> insert(llvm::CachedHashStringRef Name);
+  std::pair<Symbol *, bool> insert(StringRef Name) {
+    return insert(llvm::CachedHashStringRef(Name));
+  }
+  std::pair<Symbol *, bool> insert(llvm::CachedHashStringRef Name,
+                                   uint8_t Type, uint8_t Visibility,
+                                   bool CanOmitFromDynSym, InputFile *File);
   std::pair<Symbol *, bool> insert(StringRef Name, uint8_t Type,
                                    uint8_t Visibility, bool CanOmitFromDynSym,
-                                   InputFile *File);
+                                   InputFile *File) {
+    return insert(llvm::CachedHashStringRef(Name), Type, Visibility,
+                  CanOmitFromDynSym, File);
+  }
 
   template <class ELFT> void fetchLazy(Symbol *Sym);
 
@@ -88,6 +123,9 @@ public:
   void handleDynamicList();
 
 private:
+  void reserve(ArrayRef<ArrayRef<llvm::CachedHashStringRef>> Names);
+  template <class ELFT> void prehashMembers(ObjFile<ELFT> &File);
+
   std::vector<Symbol *> findByVersion(SymbolVersion Ver);
   std::vector<Symbol *> findAllByVersion(SymbolVersion Ver);
 
@@ -95,7 +133,8 @@ private:
   void handleAnonymousVersion();
   void assignExactVersion(SymbolVersion Ver, uint16_t VersionId,
                           StringRef VersionName);
-  void assignWildcardVersion(SymbolVersion Ver, uint16_t VersionId);
+  void assignWildcardVersions(
+      ArrayRef<std::pair<SymbolVersion, uint16_t>> Patterns);
 
   // The order the global symbols are in is not defined. We can use an arbitrary
   // order, but it has to be reproducible. That is true even when cross linking.
@@ -104,9 +143,29 @@ private:
   // but a bit inefficient.
   // FIXME: Experiment with passing in a custom hashing or sorting the symbols
   // once symbol resolution is finished.
-  llvm::DenseMap<llvm::CachedHashStringRef, int> SymMap;
+  //
+  // The map is split into shards by the top bits of the name hashes so that
+  // preinsert can fill the shards in parallel. A value of -1 means the name
+  // is traced by --trace-symbol but not yet inserted, and -2 means the name
+  // has been reserved by preinsert but not yet inserted.
+  enum { NumShardBits = 6 };
+  llvm::DenseMap<llvm::CachedHashStringRef, int> SymMap[1 << NumShardBits];
   std::vector<Symbol *> SymVector;
 
+  static size_t getShardIndex(llvm::CachedHashStringRef Name) {
+    return Name.hash() >> (32 - NumShardBits);
+  }
+  llvm::DenseMap<llvm::CachedHashStringRef, int> &
+  getShard(llvm::CachedHashStringRef Name) {
+    return SymMap[getShardIndex(Name)];
+  }
+
+  // Global symbol names of archive members and lazy object files that are
+  // likely to be fetched soon, keyed by the start of the file's buffer.
+  // Filled by prehashMembers and taken by addFile.
+  llvm::DenseMap<const char *, std::vector<llvm::CachedHashStringRef>>
+      PrehashedNames;
+
   // Comdat groups define "link once" sections. If two comdat groups have the
   // same name, only one of them is linked, and the other is ignored. This set
   // is used to uniquify them.
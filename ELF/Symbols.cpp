@@ -27,6 +27,8 @@ using namespace llvm::ELF;
 using namespace lld;
 using namespace lld::elf;
 
+std::vector<SymbolAux> elf::SymAux;
+
 Defined *ElfSym::Bss;
 Defined *ElfSym::Etext1;
 Defined *ElfSym::Etext2;
@@ -115,7 +117,7 @@ uint64_t Symbol::getVA(int64_t Addend) const {
 uint64_t Symbol::getGotVA() const { return InX::Got->getVA() + getGotOffset(); }
 
 uint64_t Symbol::getGotOffset() const {
-  return GotIndex * Target->GotEntrySize;
+  return getGotIndex() * Target->GotEntrySize;
 }
 
 uint64_t Symbol::getGotPltVA() const {
@@ -126,19 +128,20 @@ uint64_t Symbol::getGotPltVA() const {
 
 uint64_t Symbol::getGotPltOffset() const {
   if (IsInIgot)
-    return PltIndex * Target->GotPltEntrySize;
-  return (PltIndex + Target->GotPltHeaderEntriesNum) * Target->GotPltEntrySize;
+    return getPltIndex() * Target->GotPltEntrySize;
+  return (getPltIndex() + Target->GotPltHeaderEntriesNum) *
+         Target->GotPltEntrySize;
 }
 
 uint64_t Symbol::getPltVA() const {
   if (this->IsInIplt)
-    return InX::Iplt->getVA() + PltIndex * Target->PltEntrySize;
-  return InX::Plt->getVA() + Target->getPltEntryOffset(PltIndex);
+    return InX::Iplt->getVA() + getPltIndex() * Target->PltEntrySize;
+  return InX::Plt->getVA() + Target->getPltEntryOffset(getPltIndex());
 }
 
 uint64_t Symbol::getPltOffset() const {
   assert(!this->IsInIplt);
-  return Target->getPltEntryOffset(PltIndex);
+  return Target->getPltEntryOffset(getPltIndex());
 }
 
 uint64_t Symbol::getSize() const {
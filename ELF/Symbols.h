@@ -46,6 +46,19 @@ struct StringRefZ {
   const uint32_t Size;
 };
 
+// The GOT and PLT indices of a symbol. Only a small fraction of symbols get
+// GOT or PLT entries, so rather than making every Symbol larger, the symbols
+// that do get them keep an index into this table. Entries are only added
+// while relocations are scanned and GOT and PLT are built, which is done
+// serially.
+struct SymbolAux {
+  uint32_t GotIndex = -1;
+  uint32_t PltIndex = -1;
+  uint32_t GlobalDynIndex = -1;
+};
+
+extern std::vector<SymbolAux> SymAux;
+
 // The base class for real symbol classes.
 class Symbol {
 public:
@@ -68,9 +81,10 @@ protected:
 
 public:
   uint32_t DynsymIndex = 0;
-  uint32_t GotIndex = -1;
-  uint32_t PltIndex = -1;
-  uint32_t GlobalDynIndex = -1;
+
+  // Index into SymbolAux of the GOT and PLT indices of this symbol, or -1
+  // if it has none.
+  uint32_t AuxIdx = -1;
 
   // This field is a index to the symbol's version definition.
   uint32_t VerdefIndex = -1;
@@ -91,29 +105,32 @@ public:
 
   const uint8_t SymbolKind;
 
+  // The flags below are uint8_t bit-fields so that they pack into the two
+  // bytes after SymbolKind with any compiler.
+
   // Symbol visibility. This is the computed minimum visibility of all
   // observed non-DSO symbols.
-  unsigned Visibility : 2;
+  uint8_t Visibility : 2;
 
   // True if the symbol was used for linking and thus need to be added to the
   // output file's symbol table. This is true for all symbols except for
   // unreferenced DSO symbols and bitcode symbols that are unreferenced except
   // by other bitcode objects.
-  unsigned IsUsedInRegularObj : 1;
+  uint8_t IsUsedInRegularObj : 1;
 
   // If this flag is true and the symbol has protected or default visibility, it
   // will appear in .dynsym. This flag is set by interposable DSO symbols in
   // executables, by most symbols in DSOs and executables built with
   // --export-dynamic, and by dynamic lists.
-  unsigned ExportDynamic : 1;
+  uint8_t ExportDynamic : 1;
 
   // False if LTO shouldn't inline whatever this symbol points to. If a symbol
   // is overwritten after LTO, LTO shouldn't inline the symbol because it
   // doesn't know the final contents of the symbol.
-  unsigned CanInline : 1;
+  uint8_t CanInline : 1;
 
   // True if this symbol is specified by --trace-symbol option.
-  unsigned Traced : 1;
+  uint8_t Traced : 1;
 
   bool includeInDynsym() const;
   uint8_t computeBinding() const;
@@ -139,8 +156,15 @@ public:
 
   void parseSymbolVersion();
 
-  bool isInGot() const { return GotIndex != -1U; }
-  bool isInPlt() const { return PltIndex != -1U; }
+  uint32_t getGotIndex() const;
+  uint32_t getPltIndex() const;
+  uint32_t getGlobalDynIndex() const;
+  void setGotIndex(uint32_t I) { allocateAux().GotIndex = I; }
+  void setPltIndex(uint32_t I) { allocateAux().PltIndex = I; }
+  void setGlobalDynIndex(uint32_t I) { allocateAux().GlobalDynIndex = I; }
+
+  bool isInGot() const { return getGotIndex() != -1U; }
+  bool isInPlt() const { return getPltIndex() != -1U; }
 
   uint64_t getVA(int64_t Addend = 0) const;
 
@@ -164,23 +188,23 @@ protected:
 public:
   // True the symbol should point to its PLT entry.
   // For SharedSymbol only.
-  unsigned NeedsPltAddr : 1;
+  uint8_t NeedsPltAddr : 1;
 
   // True if this symbol is in the Iplt sub-section of the Plt.
-  unsigned IsInIplt : 1;
+  uint8_t IsInIplt : 1;
 
   // True if this symbol is in the Igot sub-section of the .got.plt or .got.
-  unsigned IsInIgot : 1;
+  uint8_t IsInIgot : 1;
 
   // True if this symbol is preemptible at load time.
-  unsigned IsPreemptible : 1;
+  uint8_t IsPreemptible : 1;
 
   // True if an undefined or shared symbol is used from a live section.
-  unsigned Used : 1;
+  uint8_t Used : 1;
 
   // True if a call to this symbol needs to be followed by a restore of the
   // PPC64 toc pointer.
-  unsigned NeedsTocRestore : 1;
+  uint8_t NeedsTocRestore : 1;
 
   // The Type field may also have this value. It means that we have not yet seen
   // a non-Lazy symbol with this name, so we don't know what its type is. The
@@ -195,8 +219,31 @@ public:
   bool isGnuIFunc() const { return Type == llvm::ELF::STT_GNU_IFUNC; }
   bool isObject() const { return Type == llvm::ELF::STT_OBJECT; }
   bool isFile() const { return Type == llvm::ELF::STT_FILE; }
+
+private:
+  SymbolAux &allocateAux();
 };
 
+inline SymbolAux &Symbol::allocateAux() {
+  if (AuxIdx == -1U) {
+    AuxIdx = SymAux.size();
+    SymAux.emplace_back();
+  }
+  return SymAux[AuxIdx];
+}
+
+inline uint32_t Symbol::getGotIndex() const {
+  return AuxIdx == -1U ? -1U : SymAux[AuxIdx].GotIndex;
+}
+
+inline uint32_t Symbol::getPltIndex() const {
+  return AuxIdx == -1U ? -1U : SymAux[AuxIdx].PltIndex;
+}
+
+inline uint32_t Symbol::getGlobalDynIndex() const {
+  return AuxIdx == -1U ? -1U : SymAux[AuxIdx].GlobalDynIndex;
+}
+
 // Represents a symbol that is defined in the current output file.
 class Defined : public Symbol {
 public:
@@ -286,6 +333,7 @@ public:
   static bool classof(const Symbol *S) { return S->kind() == LazyArchiveKind; }
 
   InputFile *fetch();
+  const llvm::object::Archive::Symbol &getArchiveSymbol() const { return Sym; }
 
 private:
   const llvm::object::Archive::Symbol Sym;
@@ -345,6 +393,10 @@ union SymbolUnion {
   alignas(LazyObject) char F[sizeof(LazyObject)];
 };
 
+// Every symbol is allocated as a SymbolUnion, so this is what a symbol
+// costs. Make sure that we don't make it larger by accident.
+static_assert(sizeof(SymbolUnion) <= 64, "SymbolUnion too large");
+
 void printTraceSymbol(Symbol *Sym);
 
 template <typename T, typename... ArgT>
@@ -20,6 +20,7 @@
 #include "InputFiles.h"
 #include "LinkerScript.h"
 #include "OutputSections.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "Target.h"
@@ -34,13 +35,18 @@
 #include "llvm/DebugInfo/DWARF/DWARFDebugPubTable.h"
 #include "llvm/Object/Decompressor.h"
 #include "llvm/Object/ELFObjectFile.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/RandomNumberGenerator.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/xxhash.h"
 #include <cstdlib>
+#include <map>
 #include <thread>
 
 using namespace llvm;
@@ -367,17 +373,9 @@ EhFrameSection::EhFrameSection()
 // Search for an existing CIE record or create a new one.
 // CIE records from input object files are uniquified by their contents
 // and where their relocations point to.
-template <class ELFT, class RelTy>
-CieRecord *EhFrameSection::addCie(EhSectionPiece &Cie, ArrayRef<RelTy> Rels) {
-  auto *Sec = cast<EhInputSection>(Cie.Sec);
+CieRecord *EhFrameSection::addCie(EhSectionPiece &Cie, Symbol *Personality) {
   if (read32(Cie.data().data() + 4) != 0)
-    fatal(toString(Sec) + ": CIE expected at beginning of .eh_frame");
-
-  Symbol *Personality = nullptr;
-  unsigned FirstRelI = Cie.FirstRelocation;
-  if (FirstRelI != (unsigned)-1)
-    Personality =
-        &Sec->template getFile<ELFT>()->getRelocTargetSym(Rels[FirstRelI]);
+    fatal(toString(Cie.Sec) + ": CIE expected at beginning of .eh_frame");
 
   // Search for an existing CIE by CIE contents/relocation target pair.
   CieRecord *&Rec = CieMap[{Cie.data(), Personality}];
@@ -418,11 +416,13 @@ bool EhFrameSection::isFdeLive(EhSectionPiece &Fde, ArrayRef<RelTy> Rels) {
 
 // .eh_frame is a sequence of CIE or FDE records. In general, there
 // is one CIE record per input object file which is followed by
-// a list of FDEs. This function searches an existing CIE or create a new
-// one and associates FDEs to the CIE.
+// a list of FDEs. This function collects the CIEs of a section and
+// associates live FDEs with them. It does not change any state, so
+// that sections can be parsed in parallel.
 template <class ELFT, class RelTy>
-void EhFrameSection::addSectionAux(EhInputSection *Sec, ArrayRef<RelTy> Rels) {
-  OffsetToCie.clear();
+void EhFrameSection::parseSection(EhInputSection *Sec, ArrayRef<RelTy> Rels,
+                                  ParsedSection &Out) {
+  DenseMap<size_t, unsigned> OffsetToCie;
   for (EhSectionPiece &Piece : Sec->Pieces) {
     // The empty record is the end marker.
     if (Piece.Size == 4)
@@ -431,39 +431,65 @@ void EhFrameSection::addSectionAux(EhInputSection *Sec, ArrayRef<RelTy> Rels) {
     size_t Offset = Piece.InputOff;
     uint32_t ID = read32(Piece.data().data() + 4);
     if (ID == 0) {
-      OffsetToCie[Offset] = addCie<ELFT>(Piece, Rels);
+      Symbol *Personality = nullptr;
+      unsigned FirstRelI = Piece.FirstRelocation;
+      if (FirstRelI != (unsigned)-1)
+        Personality =
+            &Sec->template getFile<ELFT>()->getRelocTargetSym(Rels[FirstRelI]);
+      OffsetToCie[Offset] = Out.Cies.size();
+      Out.Cies.push_back({&Piece, Personality});
       continue;
     }
 
     uint32_t CieOffset = Offset + 4 - ID;
-    CieRecord *Rec = OffsetToCie[CieOffset];
-    if (!Rec)
-      fatal(toString(Sec) + ": invalid CIE reference");
+    auto It = OffsetToCie.find(CieOffset);
+    if (It == OffsetToCie.end()) {
+      Out.HasInvalidCieRef = true;
+      return;
+    }
 
-    if (!isFdeLive<ELFT>(Piece, Rels))
-      continue;
-    Rec->Fdes.push_back(&Piece);
-    NumFdes++;
+    if (isFdeLive<ELFT>(Piece, Rels))
+      Out.Fdes.push_back({&Piece, It->second});
   }
 }
 
-template <class ELFT> void EhFrameSection::addSection(InputSectionBase *C) {
-  auto *Sec = cast<EhInputSection>(C);
-  Sec->Parent = this;
+// Input sections are parsed in parallel. Then their CIEs are uniquified
+// and FDEs are attached to them serially in input order, so that the
+// output does not depend on the number of threads.
+template <class ELFT>
+void EhFrameSection::addSections(ArrayRef<EhInputSection *> Secs) {
+  std::vector<ParsedSection> Parsed(Secs.size());
+  parallelForEachN(0, Secs.size(), [&](size_t I) {
+    EhInputSection *Sec = Secs[I];
+    if (Sec->Pieces.empty())
+      return;
+    if (Sec->AreRelocsRela)
+      parseSection<ELFT>(Sec, Sec->template relas<ELFT>(), Parsed[I]);
+    else
+      parseSection<ELFT>(Sec, Sec->template rels<ELFT>(), Parsed[I]);
+  });
 
-  Alignment = std::max(Alignment, Sec->Alignment);
-  Sections.push_back(Sec);
+  std::vector<CieRecord *> Recs;
+  for (size_t I = 0, E = Secs.size(); I != E; ++I) {
+    EhInputSection *Sec = Secs[I];
+    Sec->Parent = this;
 
-  for (auto *DS : Sec->DependentSections)
-    DependentSections.push_back(DS);
+    Alignment = std::max(Alignment, Sec->Alignment);
+    Sections.push_back(Sec);
 
-  if (Sec->Pieces.empty())
-    return;
+    for (InputSection *DS : Sec->dependentSections())
+      addDependentSection(DS);
 
-  if (Sec->AreRelocsRela)
-    addSectionAux<ELFT>(Sec, Sec->template relas<ELFT>());
-  else
-    addSectionAux<ELFT>(Sec, Sec->template rels<ELFT>());
+    Recs.clear();
+    for (std::pair<EhSectionPiece *, Symbol *> &Cie : Parsed[I].Cies)
+      Recs.push_back(addCie(*Cie.first, Cie.second));
+    for (std::pair<EhSectionPiece *, unsigned> &Fde : Parsed[I].Fdes)
+      Recs[Fde.second]->Fdes.push_back(Fde.first);
+    NumFdes += Parsed[I].Fdes.size();
+
+    if (Parsed[I].HasInvalidCieRef)
+      fatal(toString(Sec) + ": invalid CIE reference");
+  }
 }
 
 static void writeCieFde(uint8_t *Buf, ArrayRef<uint8_t> D) {
@@ -507,16 +533,27 @@ void EhFrameSection::finalizeContents() {
 // returns a list of such pairs.
 std::vector<EhFrameSection::FdeData> EhFrameSection::getFdeData() const {
   uint8_t *Buf = getParent()->Loc + OutSecOff;
-  std::vector<FdeData> Ret;
 
+  // Each CIE's FDEs go to a fixed range of the result, so CIEs
+  // can be processed in parallel.
+  std::vector<size_t> Begins;
+  size_t N = 0;
   for (CieRecord *Rec : CieRecords) {
+    Begins.push_back(N);
+    N += Rec->Fdes.size();
+  }
+
+  std::vector<FdeData> Ret(N);
+  parallelForEachN(0, CieRecords.size(), [&](size_t I) {
+    CieRecord *Rec = CieRecords[I];
     uint8_t Enc = getFdeEncoding(Rec->Cie);
+    FdeData *Out = &Ret[Begins[I]];
     for (EhSectionPiece *Fde : Rec->Fdes) {
       uint32_t Pc = getFdePc(Buf, Fde->OutputOff, Enc);
       uint32_t FdeVA = getParent()->Addr + Fde->OutputOff;
-      Ret.push_back({Pc, FdeVA});
+      *Out++ = {Pc, FdeVA};
     }
-  }
+  });
   return Ret;
 }
 
@@ -551,7 +588,7 @@ uint64_t EhFrameSection::getFdePc(uint8_t *Buf, size_t FdeOff,
 
 void EhFrameSection::writeTo(uint8_t *Buf) {
   // Write CIE and FDE records.
-  for (CieRecord *Rec : CieRecords) {
+  parallelForEach(CieRecords, [&](CieRecord *Rec) {
     size_t CieOffset = Rec->Cie->OutputOff;
     writeCieFde(Buf + CieOffset, Rec->Cie->data());
 
@@ -563,13 +600,13 @@ void EhFrameSection::writeTo(uint8_t *Buf) {
       // Write it.
       write32(Buf + Off + 4, Off + 4 - CieOffset);
     }
-  }
+  });
 
   // Apply relocations. .eh_frame section contents are not contiguous
   // in the output buffer, but relocateAlloc() still works because
   // getOffset() takes care of discontiguous section pieces.
-  for (EhInputSection *S : Sections)
-    S->relocateAlloc(Buf, nullptr);
+  parallelForEach(Sections,
+                  [&](EhInputSection *S) { S->relocateAlloc(Buf, nullptr); });
 }
 
 GotSection::GotSection()
@@ -585,14 +622,14 @@ GotSection::GotSection()
 }
 
 void GotSection::addEntry(Symbol &Sym) {
-  Sym.GotIndex = NumEntries;
+  Sym.setGotIndex(NumEntries);
   ++NumEntries;
 }
 
 bool GotSection::addDynTlsEntry(Symbol &Sym) {
-  if (Sym.GlobalDynIndex != -1U)
+  if (Sym.getGlobalDynIndex() != -1U)
     return false;
-  Sym.GlobalDynIndex = NumEntries;
+  Sym.setGlobalDynIndex(NumEntries);
   // Global Dynamic TLS entries take two GOT slots.
   NumEntries += 2;
   return true;
@@ -609,11 +646,11 @@ bool GotSection::addTlsIndex() {
 }
 
 uint64_t GotSection::getGlobalDynAddr(const Symbol &B) const {
-  return this->getVA() + B.GlobalDynIndex * Config->Wordsize;
+  return this->getVA() + B.getGlobalDynIndex() * Config->Wordsize;
 }
 
 uint64_t GotSection::getGlobalDynOffset(const Symbol &B) const {
-  return B.GlobalDynIndex * Config->Wordsize;
+  return B.getGlobalDynIndex() * Config->Wordsize;
 }
 
 void GotSection::finalizeContents() {
@@ -764,22 +801,45 @@ unsigned MipsGotSection::getLocalEntriesNum() const {
          Gots.front().Local16.size();
 }
 
-bool MipsGotSection::tryMergeGots(FileGot &Dst, FileGot &Src, bool IsPrimary) {
-  FileGot Tmp = Dst;
-  set_union(Tmp.PagesMap, Src.PagesMap);
-  set_union(Tmp.Local16, Src.Local16);
-  set_union(Tmp.Global, Src.Global);
-  set_union(Tmp.Relocs, Src.Relocs);
-  set_union(Tmp.Tls, Src.Tls);
-  set_union(Tmp.DynTlsSymbols, Src.DynTlsSymbols);
+// Returns the number of keys of Src that are not in Dst.
+template <class MapT> static size_t countNew(const MapT &Dst, const MapT &Src) {
+  size_t Num = 0;
+  for (const auto &P : Src)
+    if (!Dst.count(P.first))
+      ++Num;
+  return Num;
+}
 
+// Merges Src into Dst unless that makes Dst too large. The size of the
+// union is counted before anything is copied, so an attempt costs time in
+// proportion to the size of Src, not of the GOT merged so far.
+bool MipsGotSection::tryMergeGots(FileGot &Dst, FileGot &Src, bool IsPrimary) {
+  size_t Pages = Dst.getPageEntriesNum();
+  for (const std::pair<const OutputSection *, FileGot::PageBlock> &P :
+       Src.PagesMap)
+    if (!Dst.PagesMap.count(P.first))
+      Pages += P.second.Count;
+  size_t Tls = Dst.Tls.size() + countNew(Dst.Tls, Src.Tls);
+  size_t DynTls =
+      Dst.DynTlsSymbols.size() + countNew(Dst.DynTlsSymbols, Src.DynTlsSymbols);
+
+  // This is getIndexedEntriesNum of the union.
   size_t Count = IsPrimary ? HeaderEntriesNum : 0;
-  Count += Tmp.getIndexedEntriesNum();
+  Count += Pages + Dst.Local16.size() + countNew(Dst.Local16, Src.Local16) +
+           Dst.Global.size() + countNew(Dst.Global, Src.Global);
+  if (Tls || DynTls)
+    Count += Dst.Relocs.size() + countNew(Dst.Relocs, Src.Relocs) + Tls +
+             DynTls * 2;
 
   if (Count * Config->Wordsize > Config->MipsGotSize)
     return false;
 
-  std::swap(Tmp, Dst);
+  set_union(Dst.PagesMap, Src.PagesMap);
+  set_union(Dst.Local16, Src.Local16);
+  set_union(Dst.Global, Src.Global);
+  set_union(Dst.Relocs, Src.Relocs);
+  set_union(Dst.Tls, Src.Tls);
+  set_union(Dst.DynTlsSymbols, Src.DynTlsSymbols);
   return true;
 }
 
@@ -798,28 +858,51 @@ template <class ELFT> void MipsGotSection::build() {
 
   std::vector<FileGot> MergedGots(1);
 
-  // For each GOT move non-preemptible symbols from the `Global`
-  // to `Local16` list. Preemptible symbol might become non-preemptible
-  // one if, for example, it gets a related copy relocation.
-  for (FileGot &Got : Gots) {
+  // The number of "page" entries an output section needs depends only on
+  // the section, so compute it once per section rather than once per GOT.
+  DenseMap<const OutputSection *, size_t> PageCounts;
+  for (FileGot &Got : Gots)
+    for (std::pair<const OutputSection *, FileGot::PageBlock> &P :
+         Got.PagesMap)
+      PageCounts.insert({P.first, 0});
+  for (std::pair<const OutputSection *, size_t> &P : PageCounts) {
+    uint64_t SecSize = 0;
+    for (BaseCommand *Cmd : P.first->SectionCommands) {
+      if (auto *ISD = dyn_cast<InputSectionDescription>(Cmd))
+        for (InputSection *IS : ISD->Sections) {
+          uint64_t Off = alignTo(SecSize, IS->Alignment);
+          SecSize = Off + IS->getSize();
+        }
+    }
+    P.second = getMipsPageCount(SecSize);
+  }
+
+  // Each GOT is prepared for merging on its own, so do them in parallel.
+  parallelForEach(Gots, [&](FileGot &Got) {
+    // Move non-preemptible symbols from the `Global` to `Local16` list.
+    // Preemptible symbol might become non-preemptible one if, for example,
+    // it gets a related copy relocation.
     for (auto &P: Got.Global)
       if (!P.first->IsPreemptible)
         Got.Local16.insert({{P.first, 0}, 0});
     Got.Global.remove_if([&](const std::pair<Symbol *, size_t> &P) {
       return !P.first->IsPreemptible;
     });
-  }
 
-  // For each GOT remove "reloc-only" entry if there is "global"
-  // entry for the same symbol. And add local entries which indexed
-  // using 32-bit value at the end of 16-bit entries.
-  for (FileGot &Got : Gots) {
+    // Remove "reloc-only" entry if there is "global" entry for the same
+    // symbol. And add local entries which indexed using 32-bit value at
+    // the end of 16-bit entries.
     Got.Relocs.remove_if([&](const std::pair<Symbol *, size_t> &P) {
       return Got.Global.count(P.first);
     });
     set_union(Got.Local16, Got.Local32);
     Got.Local32.clear();
-  }
+
+    // Evaluate number of "page" entries.
+    for (std::pair<const OutputSection *, FileGot::PageBlock> &P :
+         Got.PagesMap)
+      P.second.Count = PageCounts.lookup(P.first);
+  });
 
   // Evaluate number of "reloc-only" entries in the resulting GOT.
   // To do that put all unique "reloc-only" and "global" entries
@@ -831,23 +914,6 @@ template <class ELFT> void MipsGotSection::build() {
     Got.Relocs.clear();
   }
 
-  // Evaluate number of "page" entries in each GOT.
-  for (FileGot &Got : Gots) {
-    for (std::pair<const OutputSection *, FileGot::PageBlock> &P :
-         Got.PagesMap) {
-      const OutputSection *OS = P.first;
-      uint64_t SecSize = 0;
-      for (BaseCommand *Cmd : OS->SectionCommands) {
-        if (auto *ISD = dyn_cast<InputSectionDescription>(Cmd))
-          for (InputSection *IS : ISD->Sections) {
-            uint64_t Off = alignTo(SecSize, IS->Alignment);
-            SecSize = Off + IS->getSize();
-          }
-      }
-      P.second.Count = getMipsPageCount(SecSize);
-    }
-  }
-
   // Merge GOTs. Try to join as much as possible GOTs but do not
   // exceed maximum GOT size. In case of overflow create new GOT
   // and continue merging.
@@ -897,13 +963,15 @@ template <class ELFT> void MipsGotSection::build() {
       Index += 2;
     }
   }
+  Stats->MipsGots = Gots.size();
+  Stats->MipsGotEntries = Index;
 
-  // Update Symbol::GotIndex field to use this
+  // Update the GOT index of symbols to use this
   // value later in the `sortMipsSymbols` function.
   for (auto &P : PrimGot->Global)
-    P.first->GotIndex = P.second;
+    P.first->setGotIndex(P.second);
   for (auto &P : PrimGot->Relocs)
-    P.first->GotIndex = P.second;
+    P.first->setGotIndex(P.second);
 
   // Create dynamic relocations.
   for (FileGot &Got : Gots) {
@@ -1060,7 +1128,7 @@ GotPltSection::GotPltSection()
                        Config->EMachine == EM_PPC64 ? ".plt" : ".got.plt") {}
 
 void GotPltSection::addEntry(Symbol &Sym) {
-  assert(Sym.PltIndex == Entries.size());
+  assert(Sym.getPltIndex() == Entries.size());
   Entries.push_back(&Sym);
 }
 
@@ -1108,7 +1176,7 @@ IgotPltSection::IgotPltSection()
 
 void IgotPltSection::addEntry(Symbol &Sym) {
   Sym.IsInIgot = true;
-  assert(Sym.PltIndex == Entries.size());
+  assert(Sym.getPltIndex() == Entries.size());
   Entries.push_back(&Sym);
 }
 
@@ -1136,7 +1204,8 @@ StringTableSection::StringTableSection(StringRef Name, bool Dynamic)
 // them with some other string that happens to be the same.
 unsigned StringTableSection::addString(StringRef S, bool HashIt) {
   if (HashIt) {
-    auto R = StringMap.insert(std::make_pair(S, this->Size));
+    CachedHashStringRef Key(S);
+    auto R = StringMap[Key.hash() % NumShards].insert({Key, this->Size});
     if (!R.second)
       return R.first->second;
   }
@@ -1146,6 +1215,62 @@ unsigned StringTableSection::addString(StringRef S, bool HashIt) {
   return Ret;
 }
 
+// Adds hashed strings and returns their offsets. The result is the same as
+// calling addString(S) for each string in order, but the strings are hashed
+// and deduplicated in parallel, one shard of StringMap per task, and only the
+// offsets of new strings are assigned serially.
+std::vector<unsigned> StringTableSection::addStrings(ArrayRef<StringRef> Strs) {
+  const uint32_t Existing = -1;
+  std::vector<uint32_t> Hashes(Strs.size());
+  parallelForEachN(0, Strs.size(), [&](size_t I) {
+    Hashes[I] = CachedHashStringRef(Strs[I]).hash();
+  });
+
+  std::vector<uint32_t> ShardIndices[NumShards];
+  for (size_t I = 0, E = Strs.size(); I != E; ++I)
+    ShardIndices[Hashes[I] % NumShards].push_back(I);
+
+  // First[I] is the index of the first occurrence of Strs[I] in Strs, or
+  // Existing if the string was already in the table, in which case its
+  // offset is stored in Offsets[I].
+  std::vector<uint32_t> First(Strs.size());
+  std::vector<unsigned> Offsets(Strs.size());
+  parallelForEachN(0, NumShards, [&](size_t Shard) {
+    DenseMap<CachedHashStringRef, unsigned> &Map = StringMap[Shard];
+    DenseMap<CachedHashStringRef, uint32_t> Added;
+    for (uint32_t I : ShardIndices[Shard]) {
+      CachedHashStringRef Key(Strs[I], Hashes[I]);
+      auto It = Map.find(Key);
+      if (It != Map.end()) {
+        First[I] = Existing;
+        Offsets[I] = It->second;
+        continue;
+      }
+      First[I] = Added.insert({Key, I}).first->second;
+    }
+  });
+
+  for (size_t I = 0, E = Strs.size(); I != E; ++I) {
+    if (First[I] == Existing)
+      continue;
+    if (First[I] != I) {
+      Offsets[I] = Offsets[First[I]];
+      continue;
+    }
+    Offsets[I] = this->Size;
+    this->Size += Strs[I].size() + 1;
+    Strings.push_back(Strs[I]);
+  }
+
+  // Enter the new strings into StringMap for later calls to addString.
+  parallelForEachN(0, NumShards, [&](size_t Shard) {
+    for (uint32_t I : ShardIndices[Shard])
+      if (First[I] == I)
+        StringMap[Shard][CachedHashStringRef(Strs[I], Hashes[I])] = Offsets[I];
+  });
+  return Offsets;
+}
+
 void StringTableSection::writeTo(uint8_t *Buf) {
   for (StringRef S : Strings) {
     memcpy(Buf, S.data(), S.size());
@@ -1288,6 +1413,11 @@ template <class ELFT> void DynamicSection<ELFT>::finalizeContents() {
         addInt(IsRela ? DT_RELACOUNT : DT_RELCOUNT, NumRelativeRels);
     }
   }
+  if (InX::RelrDyn && !InX::RelrDyn->Relocs.empty()) {
+    addInSec(DT_RELR, InX::RelrDyn);
+    addSize(DT_RELRSZ, InX::RelrDyn->getParent());
+    addInt(DT_RELRENT, sizeof(Elf_Relr));
+  }
   // .rel[a].plt section usually consists of two parts, containing plt and
   // iplt relocations. It is possible to have only iplt relocations in the
   // output. In that case RelaPlt is empty and have zero offset, the same offset
@@ -1447,6 +1577,7 @@ void RelocationBaseSection::addReloc(RelType DynType,
 void RelocationBaseSection::addReloc(const DynamicReloc &Reloc) {
   if (Reloc.Type == Target->RelativeRel)
     ++NumRelativeRelocs;
+  ++Stats->DynamicRelocs;
   Relocs.push_back(Reloc);
 }
 
@@ -1478,22 +1609,35 @@ RelocationSection<ELFT>::RelocationSection(StringRef Name, bool Sort)
   this->Entsize = Config->IsRela ? sizeof(Elf_Rela) : sizeof(Elf_Rel);
 }
 
-static bool compRelocations(const DynamicReloc &A, const DynamicReloc &B) {
-  bool AIsRel = A.Type == Target->RelativeRel;
-  bool BIsRel = B.Type == Target->RelativeRel;
-  if (AIsRel != BIsRel)
-    return AIsRel;
-  return A.getSymIndex() < B.getSymIndex();
+// Stable-sorts relocations so that relative relocations come first and the
+// rest are ordered by symbol index. The sort keys are computed in parallel and
+// include the original position, so that a parallel sort is stable.
+static void sortRelocations(std::vector<DynamicReloc> &Relocs) {
+  std::vector<std::pair<uint64_t, uint32_t>> Keys(Relocs.size());
+  parallelForEachN(0, Relocs.size(), [&](size_t I) {
+    const DynamicReloc &Rel = Relocs[I];
+    uint64_t IsNotRel = Rel.Type != Target->RelativeRel;
+    Keys[I] = {(IsNotRel << 32) | Rel.getSymIndex(), I};
+  });
+  parallelSort(Keys.begin(), Keys.end(),
+               std::less<std::pair<uint64_t, uint32_t>>());
+
+  std::vector<DynamicReloc> Sorted;
+  Sorted.reserve(Relocs.size());
+  for (const std::pair<uint64_t, uint32_t> &K : Keys)
+    Sorted.push_back(Relocs[K.second]);
+  Relocs = std::move(Sorted);
 }
 
 template <class ELFT> void RelocationSection<ELFT>::writeTo(uint8_t *Buf) {
   if (Sort)
-    std::stable_sort(Relocs.begin(), Relocs.end(), compRelocations);
+    sortRelocations(Relocs);
 
-  for (const DynamicReloc &Rel : Relocs) {
-    encodeDynamicReloc<ELFT>(reinterpret_cast<Elf_Rela *>(Buf), Rel);
-    Buf += Config->IsRela ? sizeof(Elf_Rela) : sizeof(Elf_Rel);
-  }
+  size_t EntSize = Config->IsRela ? sizeof(Elf_Rela) : sizeof(Elf_Rel);
+  parallelForEachN(0, Relocs.size(), [&](size_t I) {
+    encodeDynamicReloc<ELFT>(reinterpret_cast<Elf_Rela *>(Buf + I * EntSize),
+                             Relocs[I]);
+  }, 1, Locality::Contiguous);
 }
 
 template <class ELFT> unsigned RelocationSection<ELFT>::getRelocOffset() {
@@ -1557,6 +1701,23 @@ bool AndroidPackedRelocationSection<ELFT>::updateAllocSize() {
   //   RELOCATION_GROUPED_BY_ADDEND_FLAG is not set) the r_addend delta for
   //   this relocation.
 
+  // Resolve the relocations in parallel. The contents of the section only
+  // depend on them, so if they are the same as in the previous iteration there
+  // is nothing to do. That is the case in most iterations, because only
+  // the sections before this one can move.
+  std::vector<Elf_Rela> Encoded(Relocs.size());
+  parallelForEachN(0, Relocs.size(), [&](size_t I) {
+    encodeDynamicReloc<ELFT>(&Encoded[I], Relocs[I]);
+  });
+
+  auto IsSame = [](const Elf_Rela &A, const Elf_Rela &B) {
+    return A.r_offset == B.r_offset && A.r_info == B.r_info &&
+           (!Config->IsRela || A.r_addend == B.r_addend);
+  };
+  if (!RelocData.empty() && Encoded.size() == EncodedRelocs.size() &&
+      std::equal(Encoded.begin(), Encoded.end(), EncodedRelocs.begin(), IsSame))
+    return false;
+
   size_t OldSize = RelocData.size();
 
   RelocData = {'A', 'P', 'S', '2'};
@@ -1571,20 +1732,18 @@ bool AndroidPackedRelocationSection<ELFT>::updateAllocSize() {
 
   std::vector<Elf_Rela> Relatives, NonRelatives;
 
-  for (const DynamicReloc &Rel : Relocs) {
-    Elf_Rela R;
-    encodeDynamicReloc<ELFT>(&R, Rel);
-
+  for (const Elf_Rela &R : Encoded) {
     if (R.getType(Config->IsMips64EL) == Target->RelativeRel)
       Relatives.push_back(R);
     else
       NonRelatives.push_back(R);
   }
+  EncodedRelocs = std::move(Encoded);
 
-  llvm::sort(Relatives.begin(), Relatives.end(),
-             [](const Elf_Rel &A, const Elf_Rel &B) {
-               return A.r_offset < B.r_offset;
-             });
+  parallelSort(Relatives.begin(), Relatives.end(),
+               [](const Elf_Rel &A, const Elf_Rel &B) {
+                 return A.r_offset < B.r_offset;
+               });
 
   // Try to find groups of relative relocations which are spaced one word
   // apart from one another. These generally correspond to vtable entries. The
@@ -1662,10 +1821,10 @@ bool AndroidPackedRelocationSection<ELFT>::updateAllocSize() {
   }
 
   // Finally the non-relative relocations.
-  llvm::sort(NonRelatives.begin(), NonRelatives.end(),
-             [](const Elf_Rela &A, const Elf_Rela &B) {
-               return A.r_offset < B.r_offset;
-             });
+  parallelSort(NonRelatives.begin(), NonRelatives.end(),
+               [](const Elf_Rela &A, const Elf_Rela &B) {
+                 return A.r_offset < B.r_offset;
+               });
   if (!NonRelatives.empty()) {
     Add(NonRelatives.size());
     Add(HasAddendIfRela);
@@ -1688,6 +1847,104 @@ bool AndroidPackedRelocationSection<ELFT>::updateAllocSize() {
   return RelocData.size() != OldSize;
 }
 
+RelrBaseSection::RelrBaseSection()
+    : SyntheticSection(SHF_ALLOC, SHT_RELR, Config->Wordsize, ".relr.dyn") {}
+
+template <class ELFT> RelrSection<ELFT>::RelrSection() {
+  this->Entsize = Config->Wordsize;
+}
+
+template <class ELFT> bool RelrSection<ELFT>::updateAllocSize() {
+  // This function computes the contents of an SHT_RELR packed relocation
+  // section.
+  //
+  // Proposal for adding SHT_RELR sections to generic-abi is here:
+  //   https://groups.google.com/forum/#!topic/generic-abi/bX460iggiKg
+  //
+  // The encoded sequence of Elf64_Relr entries in a SHT_RELR section looks
+  // like [ AAAAAAAA BBBBBBB1 BBBBBBB1 ... AAAAAAAA BBBBBB1 ... ]
+  //
+  // i.e. start with an address, followed by any number of bitmaps. The address
+  // entry encodes 1 relocation. The subsequent bitmap entries encode up to 63
+  // relocations each, at subsequent offsets following the last address entry.
+  //
+  // The bitmap entries must have 1 in the least significant bit. The
+  // assumption here is that an address cannot have 1 in lsb. Odd addresses
+  // are not supported.
+  //
+  // Excluding the least significant bit in the bitmap, each non-zero bit in
+  // the bitmap represents a relocation to be applied to a corresponding
+  // machine word that follows the base address word. The second least
+  // significant bit represents the machine word immediately following the
+  // initial address, and each bit that follows represents the next word, in
+  // linear order. As such, a single bitmap can encode up to 31 relocations in
+  // a 32-bit object, and 63 relocations in a 64-bit object.
+  //
+  // This encoding has a couple of interesting properties:
+  // 1. Looking at any entry, it is clear whether it's an address or a bitmap:
+  //    even means address, odd means bitmap.
+  // 2. Just a simple list of addresses is a valid encoding.
+
+  size_t OldSize = RelrRelocs.size();
+  RelrRelocs.clear();
+
+  // Same as Config->Wordsize but faster because this is a compile-time
+  // constant.
+  const size_t Wordsize = sizeof(typename ELFT::uint);
+
+  // Number of bits to use for the relocation offsets bitmap.
+  // Must be either 63 or 31.
+  const size_t NBits = Wordsize * 8 - 1;
+
+  // Get offsets for all relative relocations and sort them.
+  std::vector<uint64_t> Offsets;
+  Offsets.reserve(Relocs.size());
+  for (const RelativeReloc &Rel : Relocs)
+    Offsets.push_back(Rel.getOffset());
+  llvm::sort(Offsets.begin(), Offsets.end());
+
+  // For each leading relocation, find following ones that can be folded
+  // as a bitmap and fold them.
+  for (size_t I = 0, E = Offsets.size(); I < E;) {
+    // Add a leading relocation.
+    RelrRelocs.push_back(Elf_Relr(Offsets[I]));
+    uint64_t Base = Offsets[I] + Wordsize;
+    ++I;
+
+    // Find foldable relocations to construct bitmaps.
+    while (I < E) {
+      uint64_t Bitmap = 0;
+
+      while (I < E) {
+        uint64_t Delta = Offsets[I] - Base;
+
+        // If it is too far, it cannot be folded.
+        if (Delta >= NBits * Wordsize)
+          break;
+
+        // If it is not a multiple of wordsize away, it cannot be folded.
+        if (Delta % Wordsize)
+          break;
+
+        // Fold it.
+        Bitmap |= 1ULL << (Delta / Wordsize);
+        ++I;
+      }
+
+      if (!Bitmap)
+        break;
+
+      RelrRelocs.push_back(Elf_Relr((Bitmap << 1) | 1));
+      Base += NBits * Wordsize;
+    }
+  }
+
+  // Returns whether the section size changed. Like the Android packer, the
+  // number of entries depends on the relocation offsets, so we need to keep
+  // recomputing until section layout converges.
+  return RelrRelocs.size() != OldSize;
+}
+
 SymbolTableBaseSection::SymbolTableBaseSection(StringTableSection &StrTabSec)
     : SyntheticSection(StrTabSec.isDynamic() ? (uint64_t)SHF_ALLOC : 0,
                        StrTabSec.isDynamic() ? SHT_DYNSYM : SHT_SYMTAB,
@@ -1706,7 +1963,7 @@ static bool sortMipsSymbols(const SymbolTableEntry &L,
   // All other entries go to the first part of GOT in arbitrary order.
   if (!L.Sym->isInGot() || !R.Sym->isInGot())
     return !L.Sym->isInGot();
-  return L.Sym->GotIndex < R.Sym->GotIndex;
+  return L.Sym->getGotIndex() < R.Sym->getGotIndex();
 }
 
 void SymbolTableBaseSection::finalizeContents() {
@@ -1745,27 +2002,53 @@ void SymbolTableBaseSection::postThunkContents() {
   if (this->Type == SHT_DYNSYM)
     return;
 
-  // Move all local symbols before global symbols.
-  auto E = std::stable_partition(
-      Symbols.begin(), Symbols.end(), [](const SymbolTableEntry &S) {
-        return S.Sym->isLocal() || S.Sym->computeBinding() == STB_LOCAL;
-      });
-  size_t NumLocals = E - Symbols.begin();
-  getParent()->Info = NumLocals + 1;
+  // Move all local symbols before global symbols. computeBinding is not
+  // trivial, so compute it for all symbols in parallel first.
+  std::vector<uint8_t> IsLocal(Symbols.size());
+  parallelForEachN(0, Symbols.size(), [&](size_t I) {
+    Symbol *Sym = Symbols[I].Sym;
+    IsLocal[I] = Sym->isLocal() || Sym->computeBinding() == STB_LOCAL;
+  });
 
-  // Assign the growing unique ID for each local symbol's file.
+  // Assign the growing unique ID for each local symbol's file. Local symbols
+  // of a file are usually adjacent, so only look up the map when the file
+  // changes.
   DenseMap<InputFile *, unsigned> FileIDs;
-  for (auto I = Symbols.begin(); I != E; ++I)
-    FileIDs.insert({I->Sym->File, FileIDs.size()});
-
-  // Sort the local symbols to group them by file. We do not need to care about
-  // the STT_FILE symbols, they are already naturally placed first in each group.
-  // That happens because STT_FILE is always the first symbol in the object and
-  // hence precede all other local symbols we add for a file.
-  std::stable_sort(Symbols.begin(), E,
-                   [&](const SymbolTableEntry &L, const SymbolTableEntry &R) {
-                     return FileIDs[L.Sym->File] < FileIDs[R.Sym->File];
-                   });
+  std::vector<uint32_t> FileID(Symbols.size());
+  size_t NumLocals = 0;
+  InputFile *LastFile = nullptr;
+  unsigned LastID = 0;
+  for (size_t I = 0, E = Symbols.size(); I != E; ++I) {
+    if (!IsLocal[I])
+      continue;
+    ++NumLocals;
+    InputFile *File = Symbols[I].Sym->File;
+    if (!LastFile || File != LastFile) {
+      LastID = FileIDs.insert({File, FileIDs.size()}).first->second;
+      LastFile = File;
+    }
+    FileID[I] = LastID;
+  }
+  getParent()->Info = NumLocals + 1;
+
+  // Sort the local symbols to group them by file, and put global symbols
+  // after them. We do not need to care about the STT_FILE symbols, they are
+  // already naturally placed first in each group. That happens because
+  // STT_FILE is always the first symbol in the object and hence precede all
+  // other local symbols we add for a file. The keys include the original
+  // position, so the parallel sort gives the same result as a stable sort.
+  std::vector<uint64_t> Keys(Symbols.size());
+  parallelForEachN(0, Symbols.size(), [&](size_t I) {
+    uint64_t Group = IsLocal[I] ? FileID[I] : FileIDs.size();
+    Keys[I] = (Group << 32) | I;
+  });
+  parallelSort(Keys.begin(), Keys.end(), std::less<uint64_t>());
+
+  std::vector<SymbolTableEntry> Sorted(Symbols.size());
+  parallelForEachN(0, Symbols.size(), [&](size_t I) {
+    Sorted[I] = Symbols[Keys[I] & 0xffffffff];
+  });
+  Symbols = std::move(Sorted);
 }
 
 void SymbolTableBaseSection::addSymbol(Symbol *B) {
@@ -1776,6 +2059,22 @@ void SymbolTableBaseSection::addSymbol(Symbol *B) {
   Symbols.push_back({B, StrTabSec.addString(B->getName(), HashIt)});
 }
 
+// Adds local symbols. Their names are added to the string table as one
+// batch so that they are deduplicated in parallel.
+void SymbolTableBaseSection::addLocalSymbols(ArrayRef<Symbol *> Syms) {
+  assert(this->Type != SHT_DYNSYM);
+
+  std::vector<StringRef> Names;
+  Names.reserve(Syms.size());
+  for (Symbol *B : Syms)
+    Names.push_back(B->getName());
+  std::vector<unsigned> Offsets = StrTabSec.addStrings(Names);
+
+  Symbols.reserve(Symbols.size() + Syms.size());
+  for (size_t I = 0, E = Syms.size(); I != E; ++I)
+    Symbols.push_back({Syms[I], Offsets[I]});
+}
+
 size_t SymbolTableBaseSection::getSymbolIndex(Symbol *Sym) {
   // Initializes symbol lookup tables lazily. This is used only
   // for -r or -emit-relocs.
@@ -1932,12 +2231,13 @@ GnuHashTableSection::GnuHashTableSection()
 void GnuHashTableSection::finalizeContents() {
   getParent()->Link = InX::DynSymTab->getParent()->SectionIndex;
 
-  // Computes bloom filter size in word size. We want to allocate 12
-  // bits for each symbol. It must be a power of two.
+  // Computes bloom filter size in word size. We want to allocate 12 bits
+  // for each symbol by default, which --hash-bloom-bits overrides. It must
+  // be a power of two.
   if (Symbols.empty()) {
     MaskWords = 1;
   } else {
-    uint64_t NumBits = Symbols.size() * 12;
+    uint64_t NumBits = Symbols.size() * uint64_t(Config->HashBloomBits);
     MaskWords = NextPowerOf2(NumBits / (Config->Wordsize * 8));
   }
 
@@ -1945,6 +2245,55 @@ void GnuHashTableSection::finalizeContents() {
   Size += Config->Wordsize * MaskWords; // Bloom filter
   Size += NBuckets * 4;                 // Hash buckets
   Size += Symbols.size() * 4;           // Hash values
+
+  if (Config->PrintHashStats)
+    printStats();
+}
+
+// Prints the shape of the table for --print-hash-stats. The false positive
+// rate is that of a lookup for a name that is not in the table: it picks a
+// bloom filter word and needs both of its bits to be set. The probe counts
+// are the average number of hash values the dynamic loader compares.
+void GnuHashTableSection::printStats() {
+  unsigned C = Config->Wordsize * 8;
+  std::vector<uint64_t> Bloom(MaskWords);
+  for (const Entry &Sym : Symbols) {
+    uint64_t &Word = Bloom[(Sym.Hash / C) & (MaskWords - 1)];
+    Word |= uint64_t(1) << (Sym.Hash % C);
+    Word |= uint64_t(1) << ((Sym.Hash >> Shift2) % C);
+  }
+  double FalsePositive = 0;
+  for (uint64_t Word : Bloom) {
+    double Fill = double(countPopulation(Word)) / C;
+    FalsePositive += Fill * Fill;
+  }
+  FalsePositive /= MaskWords;
+
+  std::vector<size_t> ChainLen(NBuckets);
+  for (const Entry &Sym : Symbols)
+    ++ChainLen[Sym.BucketIdx];
+  size_t Empty = llvm::count(ChainLen, 0);
+  size_t Longest = *std::max_element(ChainLen.begin(), ChainLen.end());
+
+  // A successful lookup walks the chain up to and including its symbol,
+  // and an unsuccessful one that passed the bloom filter walks it all.
+  uint64_t HitProbes = 0;
+  for (size_t Len : ChainLen)
+    HitProbes += Len * (Len + 1) / 2;
+  double Hit = Symbols.empty() ? 0 : double(HitProbes) / Symbols.size();
+  double Miss = double(Symbols.size()) / NBuckets;
+
+  std::string Str;
+  raw_string_ostream OS(Str);
+  OS << ".gnu.hash: " << Symbols.size() << " symbols, " << NBuckets
+     << " buckets, " << MaskWords << " bloom filter words\n";
+  OS << "  bloom filter: " << Config->HashBloomBits
+     << " bits per symbol, estimated false positive rate "
+     << format("%.2f%%", FalsePositive * 100) << "\n";
+  OS << "  chains: " << Empty << " empty buckets, longest " << Longest
+     << ", average probes " << format("%.2f", Hit) << " per hit and "
+     << format("%.2f", Miss) << " per miss";
+  message(OS.str());
 }
 
 void GnuHashTableSection::writeTo(uint8_t *Buf) {
@@ -2038,20 +2387,27 @@ void GnuHashTableSection::addSymbols(std::vector<SymbolTableEntry> &V) {
   if (Mid == V.end())
     return;
 
-  for (SymbolTableEntry &Ent : llvm::make_range(Mid, V.end())) {
-    Symbol *B = Ent.Sym;
-    uint32_t Hash = hashGnu(B->getName());
-    uint32_t BucketIdx = Hash % NBuckets;
-    Symbols.push_back({B, Ent.StrTabOffset, Hash, BucketIdx});
-  }
+  // Hash the names in parallel, then sort the symbols by bucket with a
+  // stable counting sort.
+  size_t Begin = Mid - V.begin();
+  std::vector<Entry> Unsorted(V.size() - Begin);
+  parallelForEachN(0, Unsorted.size(), [&](size_t I) {
+    const SymbolTableEntry &Ent = V[Begin + I];
+    uint32_t Hash = hashGnu(Ent.Sym->getName());
+    Unsorted[I] = {Ent.Sym, Ent.StrTabOffset, Hash, uint32_t(Hash % NBuckets)};
+  });
 
-  std::stable_sort(
-      Symbols.begin(), Symbols.end(),
-      [](const Entry &L, const Entry &R) { return L.BucketIdx < R.BucketIdx; });
+  std::vector<size_t> BucketStart(NBuckets + 1);
+  for (const Entry &Ent : Unsorted)
+    ++BucketStart[Ent.BucketIdx + 1];
+  for (size_t I = 1; I <= NBuckets; ++I)
+    BucketStart[I] += BucketStart[I - 1];
+  Symbols.resize(Unsorted.size());
+  for (const Entry &Ent : Unsorted)
+    Symbols[BucketStart[Ent.BucketIdx]++] = Ent;
 
-  V.erase(Mid, V.end());
-  for (const Entry &Ent : Symbols)
-    V.push_back({Ent.Sym, Ent.StrTabOffset});
+  for (size_t I = 0, E = Symbols.size(); I != E; ++I)
+    V[Begin + I] = {Symbols[I].Sym, Symbols[I].StrTabOffset};
 }
 
 HashTableSection::HashTableSection()
@@ -2119,13 +2475,13 @@ void PltSection::writeTo(uint8_t *Buf) {
     unsigned RelOff = I.second + PltOff;
     uint64_t Got = B->getGotPltVA();
     uint64_t Plt = this->getVA() + Off;
-    Target->writePlt(Buf + Off, Got, Plt, B->PltIndex, RelOff);
+    Target->writePlt(Buf + Off, Got, Plt, B->getPltIndex(), RelOff);
     Off += Target->PltEntrySize;
   }
 }
 
 template <class ELFT> void PltSection::addEntry(Symbol &Sym) {
-  Sym.PltIndex = Entries.size();
+  Sym.setPltIndex(Entries.size());
   RelocationBaseSection *PltRelocSection = InX::RelaPlt;
   if (IsIplt) {
     PltRelocSection = InX::RelaIplt;
@@ -2172,32 +2528,55 @@ static std::vector<GdbIndexChunk::CuEntry> readCuList(DWARFContext &Dwarf) {
   return Ret;
 }
 
-static std::vector<GdbIndexChunk::AddressEntry>
-readAddressAreas(DWARFContext &Dwarf, InputSection *Sec) {
-  std::vector<GdbIndexChunk::AddressEntry> Ret;
+namespace {
+// An address range of a compilation unit as it appears in the object file.
+// Unlike GdbIndexChunk::AddressEntry it does not depend on which sections
+// are live in this link, so it can be cached across links.
+struct GdbAddressRange {
+  uint32_t SectionIndex;
+  uint32_t CuIndex;
+  uint64_t LowPC;
+  uint64_t HighPC;
+};
+} // namespace
+
+static std::vector<GdbAddressRange> readAddressRanges(DWARFContext &Dwarf) {
+  std::vector<GdbAddressRange> Ret;
 
   uint32_t CuIdx = 0;
   for (std::unique_ptr<DWARFCompileUnit> &Cu : Dwarf.compile_units()) {
     DWARFAddressRangesVector Ranges;
     Cu->collectAddressRanges(Ranges);
 
-    ArrayRef<InputSectionBase *> Sections = Sec->File->getSections();
     for (DWARFAddressRange &R : Ranges) {
-      InputSectionBase *S = Sections[R.SectionIndex];
-      if (!S || S == &InputSection::Discarded || !S->Live)
-        continue;
       // Range list with zero size has no effect.
       if (R.LowPC == R.HighPC)
         continue;
-      auto *IS = cast<InputSection>(S);
-      uint64_t Offset = IS->getOffsetInFile();
-      Ret.push_back({IS, R.LowPC - Offset, R.HighPC - Offset, CuIdx});
+      Ret.push_back({uint32_t(R.SectionIndex), CuIdx, R.LowPC, R.HighPC});
     }
     ++CuIdx;
   }
   return Ret;
 }
 
+static std::vector<GdbIndexChunk::AddressEntry>
+readAddressAreas(ArrayRef<GdbAddressRange> Ranges, InputSection *Sec) {
+  std::vector<GdbIndexChunk::AddressEntry> Ret;
+
+  ArrayRef<InputSectionBase *> Sections = Sec->File->getSections();
+  for (const GdbAddressRange &R : Ranges) {
+    if (R.SectionIndex >= Sections.size())
+      continue;
+    InputSectionBase *S = Sections[R.SectionIndex];
+    if (!S || S == &InputSection::Discarded || !S->Live)
+      continue;
+    auto *IS = cast<InputSection>(S);
+    uint64_t Offset = IS->getOffsetInFile();
+    Ret.push_back({IS, R.LowPC - Offset, R.HighPC - Offset, R.CuIndex});
+  }
+  return Ret;
+}
+
 static std::vector<GdbIndexChunk::NameTypeEntry>
 readPubNamesAndTypes(DWARFContext &Dwarf) {
   StringRef Sec1 = Dwarf.getDWARFObj().getGnuPubNamesSection();
@@ -2234,49 +2613,254 @@ void GdbIndexSection::fixCuIndex() {
   }
 }
 
+// Merges the names of all chunks. Names are partitioned by hash into shards
+// that are deduplicated in parallel. Symbols are then numbered in the order
+// in which they first appear, so the result is the same as that of a serial
+// merge.
 std::vector<std::vector<uint32_t>> GdbIndexSection::createCuVectors() {
-  std::vector<std::vector<uint32_t>> Ret;
-  uint32_t Idx = 0;
-  uint32_t Off = 0;
+  struct ShardSymbol {
+    uint64_t FirstUse;
+    CachedHashStringRef Name;
+    std::vector<uint32_t> CuVector;
+  };
 
-  for (GdbIndexChunk &Chunk : Chunks) {
-    for (GdbIndexChunk::NameTypeEntry &Ent : Chunk.NamesAndTypes) {
-      GdbSymbol *&Sym = Symbols[Ent.Name];
-      if (!Sym) {
-        Sym = make<GdbSymbol>(GdbSymbol{Ent.Name.hash(), Off, Ret.size()});
-        Off += Ent.Name.size() + 1;
-        Ret.push_back({});
-      }
+  std::vector<uint32_t> CuBase(Chunks.size());
+  for (size_t I = 1; I < Chunks.size(); ++I)
+    CuBase[I] = CuBase[I - 1] + Chunks[I - 1].CompilationUnits.size();
 
-      // gcc 5.4.1 produces a buggy .debug_gnu_pubnames that contains
-      // duplicate entries, so we want to dedup them.
-      std::vector<uint32_t> &Vec = Ret[Sym->CuVectorIndex];
-      uint32_t Val = (Ent.Type << 24) | Idx;
-      if (Vec.empty() || Vec.back() != Val)
-        Vec.push_back(Val);
+  // Split the names of each chunk by shard first, so that each shard only
+  // visits its own names below.
+  const size_t NumShards = 32;
+  std::vector<std::vector<uint32_t>> ByShard(Chunks.size() * NumShards);
+  parallelForEachN(0, Chunks.size(), [&](size_t I) {
+    ArrayRef<GdbIndexChunk::NameTypeEntry> Names = Chunks[I].NamesAndTypes;
+    for (size_t J = 0; J < Names.size(); ++J)
+      ByShard[I * NumShards + Names[J].Name.hash() % NumShards].push_back(J);
+  });
+
+  std::vector<std::vector<ShardSymbol>> Shards(NumShards);
+  parallelForEachN(0, NumShards, [&](size_t Shard) {
+    std::vector<ShardSymbol> &Syms = Shards[Shard];
+    DenseMap<CachedHashStringRef, size_t> Map;
+    for (size_t I = 0; I < Chunks.size(); ++I) {
+      ArrayRef<GdbIndexChunk::NameTypeEntry> Names = Chunks[I].NamesAndTypes;
+      for (uint32_t J : ByShard[I * NumShards + Shard]) {
+        const GdbIndexChunk::NameTypeEntry &Ent = Names[J];
+        auto P = Map.insert({Ent.Name, Syms.size()});
+        if (P.second)
+          Syms.push_back({(uint64_t(I) << 32) | J, Ent.Name, {}});
+
+        // gcc 5.4.1 produces a buggy .debug_gnu_pubnames that contains
+        // duplicate entries, so we want to dedup them.
+        std::vector<uint32_t> &Vec = Syms[P.first->second].CuVector;
+        uint32_t Val = (Ent.Type << 24) | CuBase[I];
+        if (Vec.empty() || Vec.back() != Val)
+          Vec.push_back(Val);
+      }
     }
-    Idx += Chunk.CompilationUnits.size();
+  });
+
+  std::vector<ShardSymbol *> All;
+  for (std::vector<ShardSymbol> &Syms : Shards)
+    for (ShardSymbol &Sym : Syms)
+      All.push_back(&Sym);
+  parallelSort(All.begin(), All.end(), [](ShardSymbol *A, ShardSymbol *B) {
+    return A->FirstUse < B->FirstUse;
+  });
+
+  Symbols.reserve(All.size());
+  size_t Off = 0;
+  for (ShardSymbol *Sym : All) {
+    Symbols.push_back({Sym->Name, Off});
+    Off += Sym->Name.size() + 1;
   }
 
+  std::vector<std::vector<uint32_t>> Ret(All.size());
+  parallelForEachN(0, All.size(),
+                   [&](size_t I) { Ret[I] = std::move(All[I]->CuVector); });
+
   StringPoolSize = Off;
   return Ret;
 }
 
+// --gdb-index-cache-dir keeps what was read from the DWARF of each object
+// in a file named after a hash of the object's contents, so that objects
+// that did not change since the last link need not be parsed again.
+//
+// An entry is a magic string followed by little-endian counts and arrays:
+//   u32 NumCUs, NumRanges, NumNames
+//   NumCUs    x { u64 Offset, u64 Length }
+//   NumRanges x { u32 SectionIndex, u32 CuIndex, u64 LowPC, u64 HighPC }
+//   NumNames  x { u32 Hash, u8 Type, u32 Size, Size bytes of name }
+static const char GdbIndexCacheMagic[] = "LLDGDBI1";
+
+static std::string getGdbIndexCachePath(InputFile *File) {
+  SmallString<128> Path(Config->GdbIndexCacheDir);
+  sys::path::append(Path, "gdbindex-" +
+                              utohexstr(xxHash64(File->MB.getBuffer())) +
+                              "-" + utohexstr(File->MB.getBufferSize()));
+  return Path.str().str();
+}
+
+static std::string
+serializeGdbIndexCacheEntry(const GdbIndexChunk &Chunk,
+                            ArrayRef<GdbAddressRange> Ranges) {
+  std::string Ret = GdbIndexCacheMagic;
+  auto Add = [&](uint64_t V, size_t Size) {
+    char Buf[8];
+    write64le(Buf, V);
+    Ret.append(Buf, Size);
+  };
+
+  Add(Chunk.CompilationUnits.size(), 4);
+  Add(Ranges.size(), 4);
+  Add(Chunk.NamesAndTypes.size(), 4);
+  for (const GdbIndexChunk::CuEntry &Cu : Chunk.CompilationUnits) {
+    Add(Cu.CuOffset, 8);
+    Add(Cu.CuLength, 8);
+  }
+  for (const GdbAddressRange &R : Ranges) {
+    Add(R.SectionIndex, 4);
+    Add(R.CuIndex, 4);
+    Add(R.LowPC, 8);
+    Add(R.HighPC, 8);
+  }
+  for (const GdbIndexChunk::NameTypeEntry &Ent : Chunk.NamesAndTypes) {
+    Add(Ent.Name.hash(), 4);
+    Add(Ent.Type, 1);
+    Add(Ent.Name.size(), 4);
+    Ret.append(Ent.Name.val().data(), Ent.Name.size());
+  }
+  return Ret;
+}
+
+// Reads a cache entry. Names refer to Data, which must outlive the chunk.
+// Returns false if the entry is truncated or otherwise malformed.
+static bool parseGdbIndexCacheEntry(StringRef Data, GdbIndexChunk &Chunk,
+                                    std::vector<GdbAddressRange> &Ranges) {
+  if (!Data.startswith(GdbIndexCacheMagic))
+    return false;
+  const uint8_t *P = Data.bytes_begin() + strlen(GdbIndexCacheMagic);
+  const uint8_t *End = Data.bytes_end();
+  bool Ok = true;
+  auto Read = [&](size_t Size) -> uint64_t {
+    if (!Ok || size_t(End - P) < Size) {
+      Ok = false;
+      return 0;
+    }
+    uint64_t V = 0;
+    for (size_t I = 0; I < Size; ++I)
+      V |= uint64_t(P[I]) << (I * 8);
+    P += Size;
+    return V;
+  };
+
+  uint32_t NumCus = Read(4);
+  uint32_t NumRanges = Read(4);
+  uint32_t NumNames = Read(4);
+  for (uint32_t I = 0; Ok && I < NumCus; ++I) {
+    uint64_t Offset = Read(8);
+    Chunk.CompilationUnits.push_back({Offset, Read(8)});
+  }
+  for (uint32_t I = 0; Ok && I < NumRanges; ++I) {
+    GdbAddressRange R;
+    R.SectionIndex = Read(4);
+    R.CuIndex = Read(4);
+    R.LowPC = Read(8);
+    R.HighPC = Read(8);
+    Ranges.push_back(R);
+  }
+  for (uint32_t I = 0; Ok && I < NumNames; ++I) {
+    uint32_t Hash = Read(4);
+    uint8_t Type = Read(1);
+    uint32_t Size = Read(4);
+    if (!Ok || size_t(End - P) < Size)
+      return false;
+    StringRef Name(reinterpret_cast<const char *>(P), Size);
+    P += Size;
+    Chunk.NamesAndTypes.push_back({CachedHashStringRef(Name, Hash), Type});
+  }
+  return Ok && P == End;
+}
+
+// Writes an entry to a temporary file and renames it into place, so that
+// concurrent links never see a partially written entry.
+static void writeGdbIndexCacheEntry(StringRef Path, StringRef Contents) {
+  int FD;
+  SmallString<128> TmpPath;
+  if (sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, TmpPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Contents;
+  }
+  if (sys::fs::rename(TmpPath, Path))
+    sys::fs::remove(TmpPath);
+}
+
 template <class ELFT> GdbIndexSection *elf::createGdbIndex() {
   // Gather debug info to create a .gdb_index section.
   std::vector<InputSection *> Sections = getDebugInfoSections();
   std::vector<GdbIndexChunk> Chunks(Sections.size());
 
+  bool UseCache = !Config->GdbIndexCacheDir.empty();
+  if (UseCache) {
+    if (std::error_code EC =
+            sys::fs::create_directories(Config->GdbIndexCacheDir)) {
+      warn("--gdb-index-cache-dir: cannot create " +
+           Config->GdbIndexCacheDir + ": " + EC.message());
+      UseCache = false;
+    }
+  }
+
+  std::vector<std::unique_ptr<MemoryBuffer>> CacheBuffers(Sections.size());
+  std::vector<std::string> CacheMisses(Sections.size());
   parallelForEachN(0, Chunks.size(), [&](size_t I) {
     ObjFile<ELFT> *File = Sections[I]->getFile<ELFT>();
-    DWARFContext Dwarf(make_unique<LLDDwarfObj<ELFT>>(File));
-
     Chunks[I].DebugInfoSec = Sections[I];
+
+    if (UseCache) {
+      if (ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+              MemoryBuffer::getFile(getGdbIndexCachePath(File))) {
+        std::vector<GdbAddressRange> Ranges;
+        if (parseGdbIndexCacheEntry((*MBOrErr)->getBuffer(), Chunks[I],
+                                    Ranges)) {
+          Chunks[I].AddressAreas = readAddressAreas(Ranges, Sections[I]);
+          CacheBuffers[I] = std::move(*MBOrErr);
+          ++Stats->GdbIndexCacheHits;
+          return;
+        }
+        Chunks[I].CompilationUnits.clear();
+        Chunks[I].NamesAndTypes.clear();
+      }
+    }
+
+    DWARFContext Dwarf(make_unique<LLDDwarfObj<ELFT>>(File));
+    std::vector<GdbAddressRange> Ranges = readAddressRanges(Dwarf);
     Chunks[I].CompilationUnits = readCuList(Dwarf);
-    Chunks[I].AddressAreas = readAddressAreas(Dwarf, Sections[I]);
+    Chunks[I].AddressAreas = readAddressAreas(Ranges, Sections[I]);
     Chunks[I].NamesAndTypes = readPubNamesAndTypes(Dwarf);
+
+    if (UseCache) {
+      CacheMisses[I] = serializeGdbIndexCacheEntry(Chunks[I], Ranges);
+      ++Stats->GdbIndexCacheMisses;
+    }
   });
 
+  // Keep the cache entries alive because names point into them.
+  for (std::unique_ptr<MemoryBuffer> &MB : CacheBuffers)
+    if (MB)
+      make<std::unique_ptr<MemoryBuffer>>(std::move(MB));
+
+  // Do not remember debug info that we failed to parse.
+  if (UseCache && errorCount() == 0) {
+    parallelForEachN(0, Chunks.size(), [&](size_t I) {
+      if (!CacheMisses[I].empty())
+        writeGdbIndexCacheEntry(
+            getGdbIndexCachePath(Sections[I]->File), CacheMisses[I]);
+    });
+  }
+
   // .debug_gnu_pub{names,types} are useless in executables.
   // They are present in input object files solely for creating
   // a .gdb_index. So we can remove it from the output.
@@ -2307,17 +2891,19 @@ std::vector<GdbSymbol *> GdbIndexSection::createGdbSymtab() {
   if (Size < 1024)
     Size = 1024;
 
+  // Symbols are inserted in symbol order, which does not depend on the
+  // number of threads, so collisions are always resolved the same way.
   uint32_t Mask = Size - 1;
   std::vector<GdbSymbol *> Ret(Size);
 
-  for (auto &KV : Symbols) {
-    GdbSymbol *Sym = KV.second;
-    uint32_t I = Sym->NameHash & Mask;
-    uint32_t Step = ((Sym->NameHash * 17) & Mask) | 1;
+  for (GdbSymbol &Sym : Symbols) {
+    uint32_t Hash = Sym.Name.hash();
+    uint32_t I = Hash & Mask;
+    uint32_t Step = ((Hash * 17) & Mask) | 1;
 
     while (Ret[I])
       I = (I + Step) & Mask;
-    Ret[I] = Sym;
+    Ret[I] = &Sym;
   }
   return Ret;
 }
@@ -2380,32 +2966,478 @@ void GdbIndexSection::writeTo(uint8_t *Buf) {
   for (GdbSymbol *Sym : GdbSymtab) {
     if (Sym) {
       write32le(Buf, Sym->NameOffset + StringPoolOffset - ConstantPoolOffset);
-      write32le(Buf + 4, CuVectorOffsets[Sym->CuVectorIndex]);
+      write32le(Buf + 4, CuVectorOffsets[Sym - Symbols.data()]);
     }
     Buf += 8;
   }
 
-  // Write the CU vectors.
-  for (ArrayRef<uint32_t> Vec : CuVectors) {
-    write32le(Buf, Vec.size());
-    Buf += 4;
-    for (uint32_t Val : Vec) {
-      write32le(Buf, Val);
+  // Write the CU vectors and the string pool. Their offsets are known, so
+  // the entries are written in parallel.
+  parallelForEachN(0, CuVectors.size(), [&](size_t I) {
+    uint8_t *P = Buf + CuVectorOffsets[I];
+    write32le(P, CuVectors[I].size());
+    for (uint32_t Val : CuVectors[I]) {
+      P += 4;
+      write32le(P, Val);
+    }
+  });
+  Buf += StringPoolOffset - ConstantPoolOffset;
+
+  parallelForEach(Symbols, [&](const GdbSymbol &Sym) {
+    StringRef S = Sym.Name.val();
+    memcpy(Buf + Sym.NameOffset, S.data(), S.size());
+    Buf[Sym.NameOffset + S.size()] = '\0';
+  });
+
+  // Nothing reads the index after it has been written. The sizes that
+  // getSize uses are kept.
+  if (Config->ReduceMemoryOverheads) {
+    Chunks = {};
+    Symbols = {};
+    CuVectors = {};
+    CuVectorOffsets = {};
+    GdbSymtab = {};
+  }
+}
+
+bool GdbIndexSection::empty() const { return !Out::DebugInfo; }
+
+// The hash function of DWARF v5 name indices.
+static uint32_t computeDebugNamesHash(StringRef S) {
+  return caseFoldingDjbHash(S);
+}
+
+namespace {
+// An abbreviation of an input .debug_names name index.
+struct DebugNamesAbbrev {
+  uint32_t Tag;
+  // Pairs of DW_IDX_* indices and DW_FORM_* forms.
+  std::vector<std::pair<uint32_t, uint32_t>> Attributes;
+};
+} // namespace
+
+// Reads the value of an attribute of a .debug_names entry. Returns false if
+// the form is not one that name indices use.
+static bool readDebugNamesValue(const DWARFDataExtractor &Data, uint32_t Form,
+                                uint32_t *Off, uint64_t &Val) {
+  switch (Form) {
+  case dwarf::DW_FORM_flag_present:
+    Val = 1;
+    return true;
+  case dwarf::DW_FORM_data1:
+  case dwarf::DW_FORM_ref1:
+  case dwarf::DW_FORM_flag:
+    Val = Data.getU8(Off);
+    return true;
+  case dwarf::DW_FORM_data2:
+  case dwarf::DW_FORM_ref2:
+    Val = Data.getU16(Off);
+    return true;
+  case dwarf::DW_FORM_data4:
+  case dwarf::DW_FORM_ref4:
+    Val = Data.getU32(Off);
+    return true;
+  case dwarf::DW_FORM_data8:
+  case dwarf::DW_FORM_ref8:
+  case dwarf::DW_FORM_ref_sig8:
+    Val = Data.getU64(Off);
+    return true;
+  case dwarf::DW_FORM_udata:
+  case dwarf::DW_FORM_ref_udata:
+    Val = Data.getULEB128(Off);
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Reads the names of the compilation units of a file from its .debug_names
+// section. Entries of type units are ignored. Returns false if the section
+// is malformed or uses something we do not support, such as the 64-bit
+// DWARF format.
+template <class ELFT>
+static bool readDebugNames(const LLDDwarfObj<ELFT> &Obj,
+                           DebugNamesChunk &Chunk) {
+  DWARFDataExtractor Data(Obj, Obj.getDebugNamesSection(), Config->IsLE,
+                          Config->Wordsize);
+  StringRef Str = Obj.getStringSection();
+
+  uint32_t Off = 0;
+  while (Data.isValidOffset(Off)) {
+    uint32_t Length = Data.getU32(&Off);
+    if (Length >= 0xfffffff0 || !Data.isValidOffsetForDataOfSize(Off, Length))
+      return false;
+    uint32_t End = Off + Length;
+    uint16_t Version = Data.getU16(&Off);
+    Data.getU16(&Off); // Padding
+    uint32_t CuCount = Data.getU32(&Off);
+    uint32_t LocalTuCount = Data.getU32(&Off);
+    uint32_t ForeignTuCount = Data.getU32(&Off);
+    uint32_t BucketCount = Data.getU32(&Off);
+    uint32_t NameCount = Data.getU32(&Off);
+    uint32_t AbbrevTableSize = Data.getU32(&Off);
+    uint32_t AugmentationSize = Data.getU32(&Off);
+    if (Version != 5)
+      return false;
+    Off += alignTo(AugmentationSize, 4);
+
+    // Map the compilation units of this index to those of the file.
+    std::vector<uint32_t> CuIndices;
+    for (uint32_t I = 0; I < CuCount; ++I) {
+      uint64_t CuOffset = Data.getRelocatedValue(4, &Off);
+      auto It = llvm::find(Chunk.CuOffsets, CuOffset);
+      CuIndices.push_back(It == Chunk.CuOffsets.end()
+                              ? UINT32_MAX
+                              : It - Chunk.CuOffsets.begin());
+    }
+
+    Off += LocalTuCount * 4 + ForeignTuCount * 8 + BucketCount * 4;
+    if (BucketCount)
+      Off += NameCount * 4;
+    uint64_t StrOffsets = Off;
+    uint64_t EntryOffsets = StrOffsets + uint64_t(NameCount) * 4;
+    uint64_t AbbrevOff = EntryOffsets + uint64_t(NameCount) * 4;
+    uint64_t EntryPool = AbbrevOff + AbbrevTableSize;
+    if (EntryPool > End)
+      return false;
+
+    std::map<uint64_t, DebugNamesAbbrev> Abbrevs;
+    for (uint32_t P = AbbrevOff;;) {
+      uint64_t Code = Data.getULEB128(&P);
+      if (Code == 0)
+        break;
+      DebugNamesAbbrev &Abbrev = Abbrevs[Code];
+      Abbrev.Tag = Data.getULEB128(&P);
+      if (Abbrev.Tag == 0 || Abbrev.Tag > dwarf::DW_TAG_hi_user)
+        return false;
+      for (;;) {
+        uint32_t Index = Data.getULEB128(&P);
+        uint32_t Form = Data.getULEB128(&P);
+        if (Index == 0 && Form == 0)
+          break;
+        Abbrev.Attributes.push_back({Index, Form});
+      }
+      if (P > EntryPool)
+        return false;
+    }
+
+    for (uint32_t I = 0; I < NameCount; ++I) {
+      uint32_t P = StrOffsets + I * 4;
+      uint64_t StrOff = Data.getRelocatedValue(4, &P);
+      if (StrOff >= Str.size())
+        return false;
+      StringRef S = Str.substr(StrOff);
+      S = S.substr(0, S.find('\0'));
+      CachedHashStringRef Name(S, computeDebugNamesHash(S));
+
+      P = EntryOffsets + I * 4;
+      P = EntryPool + Data.getU32(&P);
+      for (;;) {
+        if (P >= End)
+          return false;
+        uint64_t Code = Data.getULEB128(&P);
+        if (Code == 0)
+          break;
+        auto It = Abbrevs.find(Code);
+        if (It == Abbrevs.end())
+          return false;
+
+        // An index of a single compilation unit need not name it.
+        uint64_t Cu = CuCount == 1 ? 0 : UINT64_MAX;
+        uint64_t Die = UINT64_MAX;
+        bool InTypeUnit = false;
+        for (std::pair<uint32_t, uint32_t> Attr : It->second.Attributes) {
+          uint64_t Val;
+          if (!readDebugNamesValue(Data, Attr.second, &P, Val))
+            return false;
+          if (Attr.first == dwarf::DW_IDX_compile_unit)
+            Cu = Val;
+          else if (Attr.first == dwarf::DW_IDX_type_unit)
+            InTypeUnit = true;
+          else if (Attr.first == dwarf::DW_IDX_die_offset)
+            Die = Val;
+        }
+        if (InTypeUnit || Cu >= CuIndices.size() ||
+            CuIndices[Cu] == UINT32_MAX || Die > UINT32_MAX)
+          continue;
+        Chunk.Names.push_back({Name, CuIndices[Cu], uint32_t(Die),
+                               It->second.Tag});
+      }
+    }
+    Off = End;
+  }
+  return true;
+}
+
+// Guesses the tag of a DIE from the kind that .debug_gnu_pubnames records
+// for its name. This is needed for split DWARF, whose DIEs are not in the
+// object files.
+static uint32_t getPubNameTag(dwarf::PubIndexEntryDescriptor Desc) {
+  switch (Desc.Kind) {
+  case dwarf::GIEK_TYPE:
+    return dwarf::DW_TAG_structure_type;
+  case dwarf::GIEK_VARIABLE:
+    return dwarf::DW_TAG_variable;
+  case dwarf::GIEK_FUNCTION:
+    return dwarf::DW_TAG_subprogram;
+  default:
+    return 0;
+  }
+}
+
+// Reads the names of the compilation units of a file from its
+// .debug_{gnu_,}pub{names,types} sections.
+static void readDebugNamesFromPubNames(DWARFContext &Dwarf,
+                                       DebugNamesChunk &Chunk) {
+  const DWARFObject &Obj = Dwarf.getDWARFObj();
+  std::pair<StringRef, bool> Secs[] = {
+      {Obj.getPubNamesSection(), false},
+      {Obj.getPubTypesSection(), false},
+      {Obj.getGnuPubNamesSection(), true},
+      {Obj.getGnuPubTypesSection(), true}};
+
+  for (std::pair<StringRef, bool> Sec : Secs) {
+    DWARFDebugPubTable Table(Sec.first, Config->IsLE, Sec.second);
+    for (const DWARFDebugPubTable::Set &Set : Table.getData()) {
+      auto It = llvm::find(Chunk.CuOffsets, Set.Offset);
+      if (It == Chunk.CuOffsets.end())
+        continue;
+      uint32_t CuIndex = It - Chunk.CuOffsets.begin();
+      DWARFCompileUnit *Cu = Dwarf.getCompileUnitAtIndex(CuIndex);
+
+      for (const DWARFDebugPubTable::Entry &Ent : Set.Entries) {
+        uint32_t Tag = 0;
+        if (DWARFDie Die = Cu->getDIEForOffset(Set.Offset + Ent.SecOffset))
+          Tag = Die.getTag();
+        else if (Sec.second)
+          Tag = getPubNameTag(Ent.Descriptor);
+        if (!Tag || Ent.Name.empty())
+          continue;
+        CachedHashStringRef Name(Ent.Name, computeDebugNamesHash(Ent.Name));
+        Chunk.Names.push_back({Name, CuIndex, Ent.SecOffset, Tag});
+      }
+    }
+  }
+}
+
+template <class ELFT> DebugNamesSection *elf::createDebugNames() {
+  std::vector<InputSection *> Sections = getDebugInfoSections();
+  std::vector<DebugNamesChunk> Chunks(Sections.size());
+
+  parallelForEachN(0, Chunks.size(), [&](size_t I) {
+    DebugNamesChunk &Chunk = Chunks[I];
+    Chunk.DebugInfoSec = Sections[I];
+
+    ObjFile<ELFT> *File = Sections[I]->getFile<ELFT>();
+    DWARFContext Dwarf(make_unique<LLDDwarfObj<ELFT>>(File));
+    for (std::unique_ptr<DWARFCompileUnit> &Cu : Dwarf.compile_units())
+      Chunk.CuOffsets.push_back(Cu->getOffset());
+
+    auto &Obj = static_cast<const LLDDwarfObj<ELFT> &>(Dwarf.getDWARFObj());
+    if (!Obj.getDebugNamesSection().Data.empty()) {
+      if (readDebugNames(Obj, Chunk))
+        return;
+      warn(toString(File) +
+           ": cannot merge .debug_names section; using pubnames instead");
+      Chunk.Names.clear();
+    }
+    readDebugNamesFromPubNames(Dwarf, Chunk);
+  });
+
+  // The name indices of the input files are replaced by ours.
+  for (InputSectionBase *S : InputSections)
+    if (S->Name == ".debug_names")
+      S->Live = false;
+
+  return make<DebugNamesSection>(std::move(Chunks));
+}
+
+// Returns the number of buckets of a name index, as LLVM chooses it.
+static uint32_t getDebugNamesBucketCount(size_t NumHashes) {
+  if (NumHashes > 1024)
+    return NumHashes / 4;
+  if (NumHashes > 16)
+    return NumHashes / 2;
+  return std::max<size_t>(NumHashes, 1);
+}
+
+DebugNamesStrSection::DebugNamesStrSection(std::string &&S)
+    : SyntheticSection(SHF_MERGE | SHF_STRINGS, SHT_PROGBITS, 1, ".debug_str"),
+      Strings(std::move(S)) {
+  this->Entsize = 1;
+}
+
+void DebugNamesStrSection::writeTo(uint8_t *Buf) {
+  memcpy(Buf, Strings.data(), Strings.size());
+}
+
+DebugNamesSection::DebugNamesSection(std::vector<DebugNamesChunk> &&C)
+    : SyntheticSection(0, SHT_PROGBITS, 4, ".debug_names"),
+      Chunks(std::move(C)) {
+  CuBase.resize(Chunks.size());
+  for (size_t I = 1; I < Chunks.size(); ++I)
+    CuBase[I] = CuBase[I - 1] + Chunks[I - 1].CuOffsets.size();
+  NumCus = Chunks.empty() ? 0 : CuBase.back() + Chunks.back().CuOffsets.size();
+
+  mergeNames();
+
+  // Names with the same hash have to be next to each other in the bucket
+  // of the hash.
+  parallelSort(Names.begin(), Names.end(),
+               [](const NameData &A, const NameData &B) {
+                 if (A.Str.hash() != B.Str.hash())
+                   return A.Str.hash() < B.Str.hash();
+                 return A.FirstUse < B.FirstUse;
+               });
+  size_t NumHashes = 0;
+  for (size_t I = 0; I < Names.size(); ++I)
+    if (I == 0 || Names[I].Str.hash() != Names[I - 1].Str.hash())
+      ++NumHashes;
+  uint32_t NumBuckets = getDebugNamesBucketCount(NumHashes);
+  std::stable_sort(Names.begin(), Names.end(),
+                   [&](const NameData &A, const NameData &B) {
+                     return A.Str.hash() % NumBuckets <
+                            B.Str.hash() % NumBuckets;
+                   });
+  Buckets.resize(NumBuckets);
+  for (size_t I = Names.size(); I > 0; --I)
+    Buckets[Names[I - 1].Str.hash() % NumBuckets] = I;
+
+  // Create an abbreviation for each tag.
+  for (const NameData &N : Names)
+    for (const Entry &E : N.Entries)
+      if (AbbrevCodes.insert({E.Tag, 0}).second)
+        Tags.push_back(E.Tag);
+  llvm::sort(Tags.begin(), Tags.end());
+  AbbrevTableSize = 1;
+  for (size_t I = 0; I < Tags.size(); ++I) {
+    AbbrevCodes[Tags[I]] = I + 1;
+    AbbrevTableSize += getULEB128Size(I + 1) + getULEB128Size(Tags[I]) + 6;
+  }
+
+  // Lay out the strings and the entries of names.
+  std::string Strings;
+  size_t EntryPoolSize = 0;
+  for (NameData &N : Names) {
+    N.StrOffset = Strings.size();
+    Strings += N.Str.val();
+    Strings += '\0';
+    N.EntryOffset = EntryPoolSize;
+    for (const Entry &E : N.Entries)
+      EntryPoolSize += getULEB128Size(AbbrevCodes[E.Tag]) + 8;
+    ++EntryPoolSize;
+  }
+  StrSec = make<DebugNamesStrSection>(std::move(Strings));
+
+  EntryPoolOffset = 36 + (NumCus + NumBuckets + Names.size() * 3) * 4 +
+                    AbbrevTableSize;
+  Size = EntryPoolOffset + EntryPoolSize;
+}
+
+// Merges the names of all chunks. As in GdbIndexSection::createCuVectors,
+// names are partitioned by hash into shards that are deduplicated in
+// parallel, and the order in which names first appear is kept so that the
+// output does not depend on the sharding.
+void DebugNamesSection::mergeNames() {
+  const size_t NumShards = 32;
+  std::vector<std::vector<NameData>> Shards(NumShards);
+  parallelForEachN(0, NumShards, [&](size_t Shard) {
+    std::vector<NameData> &V = Shards[Shard];
+    DenseMap<CachedHashStringRef, size_t> Map;
+    for (size_t I = 0; I < Chunks.size(); ++I) {
+      ArrayRef<DebugNamesChunk::NameEntry> Ents = Chunks[I].Names;
+      for (size_t J = 0; J < Ents.size(); ++J) {
+        const DebugNamesChunk::NameEntry &Ent = Ents[J];
+        if (Ent.Name.hash() % NumShards != Shard)
+          continue;
+        auto P = Map.insert({Ent.Name, V.size()});
+        if (P.second)
+          V.push_back({Ent.Name, (uint64_t(I) << 32) | J, 0, 0, {}});
+
+        // A DIE may be listed both in pubnames and in pubtypes.
+        std::vector<Entry> &Entries = V[P.first->second].Entries;
+        Entry E = {CuBase[I] + Ent.CuIndex, Ent.DieOffset, Ent.Tag};
+        if (Entries.empty() || Entries.back().CuIndex != E.CuIndex ||
+            Entries.back().DieOffset != E.DieOffset)
+          Entries.push_back(E);
+      }
+    }
+  });
+
+  for (std::vector<NameData> &V : Shards)
+    for (NameData &N : V)
+      Names.push_back(std::move(N));
+}
+
+void DebugNamesSection::writeTo(uint8_t *Buf) {
+  uint8_t *EntryPool = Buf + EntryPoolOffset;
+  uint32_t NumNames = Names.size();
+
+  // Write the header.
+  write32(Buf, Size - 4);
+  write16(Buf + 4, 5);
+  write16(Buf + 6, 0);
+  write32(Buf + 8, NumCus);
+  write32(Buf + 12, 0);
+  write32(Buf + 16, 0);
+  write32(Buf + 20, Buckets.size());
+  write32(Buf + 24, NumNames);
+  write32(Buf + 28, AbbrevTableSize);
+  write32(Buf + 32, 0);
+  Buf += 36;
+
+  // Write the CU list.
+  for (DebugNamesChunk &Chunk : Chunks) {
+    for (uint64_t CuOffset : Chunk.CuOffsets) {
+      write32(Buf, Chunk.DebugInfoSec->OutSecOff + CuOffset);
       Buf += 4;
     }
   }
 
-  // Write the string pool.
-  for (auto &KV : Symbols) {
-    CachedHashStringRef S = KV.first;
-    GdbSymbol *Sym = KV.second;
-    size_t Off = Sym->NameOffset;
-    memcpy(Buf + Off, S.val().data(), S.size());
-    Buf[Off + S.size()] = '\0';
+  // Write the buckets.
+  for (uint32_t Index : Buckets) {
+    write32(Buf, Index);
+    Buf += 4;
+  }
+
+  // Write the hashes, string offsets and entry offsets of names, and
+  // their entries.
+  uint8_t *Hashes = Buf;
+  uint8_t *StrOffsets = Hashes + NumNames * 4;
+  uint8_t *EntryOffsets = StrOffsets + NumNames * 4;
+  uint64_t StrBase = StrSec->OutSecOff;
+  parallelForEachN(0, NumNames, [&](size_t I) {
+    const NameData &N = Names[I];
+    write32(Hashes + I * 4, N.Str.hash());
+    write32(StrOffsets + I * 4, StrBase + N.StrOffset);
+    write32(EntryOffsets + I * 4, N.EntryOffset);
+
+    uint8_t *P = EntryPool + N.EntryOffset;
+    for (const Entry &E : N.Entries) {
+      P += encodeULEB128(AbbrevCodes.lookup(E.Tag), P);
+      write32(P, E.CuIndex);
+      write32(P + 4, E.DieOffset);
+      P += 8;
+    }
+    *P = 0;
+  });
+
+  // Write the abbreviation table.
+  Buf = EntryOffsets + NumNames * 4;
+  for (size_t I = 0; I < Tags.size(); ++I) {
+    Buf += encodeULEB128(I + 1, Buf);
+    Buf += encodeULEB128(Tags[I], Buf);
+    *Buf++ = dwarf::DW_IDX_compile_unit;
+    *Buf++ = dwarf::DW_FORM_data4;
+    *Buf++ = dwarf::DW_IDX_die_offset;
+    *Buf++ = dwarf::DW_FORM_ref4;
+    *Buf++ = 0;
+    *Buf++ = 0;
   }
+  *Buf = 0;
 }
 
-bool GdbIndexSection::empty() const { return !Out::DebugInfo; }
+bool DebugNamesSection::empty() const { return Names.empty(); }
 
 EhFrameHeader::EhFrameHeader()
     : SyntheticSection(SHF_ALLOC, SHT_PROGBITS, 4, ".eh_frame_hdr") {}
@@ -2421,9 +3453,14 @@ void EhFrameHeader::writeTo(uint8_t *Buf) {
 
   // Sort the FDE list by their PC and uniqueify. Usually there is only
   // one FDE for a PC (i.e. function), but if ICF merges two functions
-  // into one, there can be more than one FDEs pointing to the address.
-  auto Less = [](const FdeData &A, const FdeData &B) { return A.Pc < B.Pc; };
-  std::stable_sort(Fdes.begin(), Fdes.end(), Less);
+  // into one, there can be more than one FDEs pointing to the address,
+  // and then we keep the first one. getFdeData returns FDEs in the order
+  // of their addresses, so sorting by address as well keeps them in the
+  // same order as a stable sort would.
+  auto Less = [](const FdeData &A, const FdeData &B) {
+    return std::tie(A.Pc, A.FdeVA) < std::tie(B.Pc, B.FdeVA);
+  };
+  parallelSort(Fdes.begin(), Fdes.end(), Less);
   auto Eq = [](const FdeData &A, const FdeData &B) { return A.Pc == B.Pc; };
   Fdes.erase(std::unique(Fdes.begin(), Fdes.end(), Eq), Fdes.end());
 
@@ -2632,31 +3669,103 @@ void MergeSyntheticSection::addSection(MergeInputSection *MS) {
 
 MergeTailSection::MergeTailSection(StringRef Name, uint32_t Type,
                                    uint64_t Flags, uint32_t Alignment)
-    : MergeSyntheticSection(Name, Type, Flags, Alignment),
-      Builder(StringTableBuilder::RAW, Alignment) {}
+    : MergeSyntheticSection(Name, Type, Flags, Alignment) {}
+
+void MergeTailSection::writeTo(uint8_t *Buf) {
+  parallelForEach(Contents, [&](const std::pair<StringRef, size_t> &P) {
+    memcpy(Buf + P.second, P.first.data(), P.first.size());
+  }, 1024);
+}
+
+// Returns true if A reversed is greater than B reversed. Sorting strings in
+// this order puts each string right after the longest string it is a suffix
+// of, which is the order StringTableBuilder uses for tail merging.
+static bool compareTails(StringRef A, StringRef B) {
+  for (size_t I = 1, E = std::min(A.size(), B.size()); I <= E; ++I) {
+    uint8_t CA = A[A.size() - I];
+    uint8_t CB = B[B.size() - I];
+    if (CA != CB)
+      return CA > CB;
+  }
+  return A.size() > B.size();
+}
 
-size_t MergeTailSection::getSize() const { return Builder.getSize(); }
+// This produces the same layout as a StringTableBuilder in RAW mode with
+// tail merging, but most of the work is done in parallel.
+//
+// As in MergeNoTailSection::finalizeContents, equal strings have the same
+// hash value, so pieces are first deduplicated in shards in parallel. Then
+// the unique strings are sorted by their tails, again in parallel. Only the
+// final pass that assigns offsets, which is linear, is serial. The order of
+// the strings is fully determined by their contents, so the output does
+// not depend on the number of threads.
+void MergeTailSection::finalizeContents() {
+  Shards.resize(NumShards);
 
-void MergeTailSection::writeTo(uint8_t *Buf) { Builder.write(Buf); }
+  // Concurrency level. Must be a power of 2 to avoid expensive modulo
+  // operations in the following tight loop.
+  size_t Concurrency =
+      std::min<size_t>(PowerOf2Floor(getThreadCount()), NumShards);
 
-void MergeTailSection::finalizeContents() {
-  // Add all string pieces to the string table builder to create section
-  // contents.
-  for (MergeInputSection *Sec : Sections)
-    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I)
-      if (Sec->Pieces[I].Live)
-        Builder.add(Sec->getData(I));
+  // Add section pieces to the shards.
+  parallelForEachN(0, Concurrency, [&](size_t ThreadId) {
+    uint64_t NumPieces = 0;
+    uint64_t NumUnique = 0;
+    for (MergeInputSection *Sec : Sections) {
+      for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+        SectionPiece &Piece = Sec->Pieces[I];
+        size_t ShardId = getShardId(Piece.Hash);
+        if ((ShardId & (Concurrency - 1)) != ThreadId || !Piece.Live)
+          continue;
+        ++NumPieces;
+        NumUnique += Shards[ShardId].insert({Sec->getData(I), 0}).second;
+      }
+    }
+    Stats->PiecesBeforeMerge += NumPieces;
+    Stats->PiecesAfterMerge += NumUnique;
+  });
 
-  // Fix the string table content. After this, the contents will never change.
-  Builder.finalize();
+  // Sort the unique strings by their tails.
+  std::vector<std::pair<StringRef, size_t *>> Strings;
+  for (DenseMap<CachedHashStringRef, size_t> &Shard : Shards)
+    for (auto &P : Shard)
+      Strings.push_back({P.first.val(), &P.second});
+  parallelSort(Strings.begin(), Strings.end(),
+               [](const std::pair<StringRef, size_t *> &A,
+                  const std::pair<StringRef, size_t *> &B) {
+                 return compareTails(A.first, B.first);
+               });
+
+  // Assign offsets. A string that is a suffix of the string before it
+  // shares that string's tail if the alignment allows.
+  StringRef Previous;
+  for (std::pair<StringRef, size_t *> &P : Strings) {
+    StringRef S = P.first;
+    if (Previous.endswith(S)) {
+      size_t Pos = Size - S.size();
+      if (!(Pos & (Alignment - 1))) {
+        *P.second = Pos;
+        continue;
+      }
+    }
+    Size = alignTo(Size, Alignment);
+    *P.second = Size;
+    Contents.push_back({S, Size});
+    Size += S.size();
+    Previous = S;
+  }
 
-  // finalize() fixed tail-optimized strings, so we can now get
-  // offsets of strings. Get an offset for each string and save it
-  // to a corresponding StringPiece for easy access.
-  for (MergeInputSection *Sec : Sections)
-    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I)
-      if (Sec->Pieces[I].Live)
-        Sec->Pieces[I].OutputOff = Builder.getOffset(Sec->getData(I));
+  // Get an offset for each string and save it to a corresponding
+  // StringPiece for easy access.
+  parallelForEach(Sections, [&](MergeInputSection *Sec) {
+    for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
+      SectionPiece &Piece = Sec->Pieces[I];
+      if (Piece.Live)
+        Piece.OutputOff =
+            Shards[getShardId(Piece.Hash)].lookup(Sec->getData(I));
+    }
+  });
+  Shards.clear();
 }
 
 void MergeNoTailSection::writeTo(uint8_t *Buf) {
@@ -2679,20 +3788,26 @@ void MergeNoTailSection::finalizeContents() {
 
   // Concurrency level. Must be a power of 2 to avoid expensive modulo
   // operations in the following tight loop.
-  size_t Concurrency = 1;
-  if (ThreadsEnabled)
-    Concurrency =
-        std::min<size_t>(PowerOf2Floor(hardware_concurrency()), NumShards);
+  size_t Concurrency =
+      std::min<size_t>(PowerOf2Floor(getThreadCount()), NumShards);
 
   // Add section pieces to the builders.
   parallelForEachN(0, Concurrency, [&](size_t ThreadId) {
+    uint64_t NumPieces = 0;
+    uint64_t NumUnique = 0;
     for (MergeInputSection *Sec : Sections) {
       for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
         size_t ShardId = getShardId(Sec->Pieces[I].Hash);
-        if ((ShardId & (Concurrency - 1)) == ThreadId && Sec->Pieces[I].Live)
-          Sec->Pieces[I].OutputOff = Shards[ShardId].add(Sec->getData(I));
+        if ((ShardId & (Concurrency - 1)) != ThreadId || !Sec->Pieces[I].Live)
+          continue;
+        size_t OldSize = Shards[ShardId].getSize();
+        Sec->Pieces[I].OutputOff = Shards[ShardId].add(Sec->getData(I));
+        ++NumPieces;
+        NumUnique += Shards[ShardId].getSize() != OldSize;
       }
     }
+    Stats->PiecesBeforeMerge += NumPieces;
+    Stats->PiecesAfterMerge += NumUnique;
   });
 
   // Compute an in-section offset for each shard.
@@ -2726,23 +3841,69 @@ static MergeSyntheticSection *createMergeSynthetic(StringRef Name,
   return make<MergeNoTailSection>(Name, Type, Flags, Alignment);
 }
 
-// Debug sections may be compressed by zlib. Decompress if exists.
+// Debug sections may be compressed by zlib. Only their headers are read
+// here; their contents are decompressed when they are first needed, which
+// for most of them is when they are written to the output.
 void elf::decompressSections() {
   parallelForEach(InputSections,
-                  [](InputSectionBase *Sec) { Sec->maybeDecompress(); });
+                  [](InputSectionBase *Sec) { Sec->parseCompressedHeader(); });
+
+  // A section name may have been altered if compressed. If that's
+  // the case, restore the original name. (i.e. ".zdebug_" -> ".debug_")
+  for (InputSectionBase *Sec : InputSections)
+    if (Sec->Name.startswith(".zdebug"))
+      Sec->Name = Saver.save("." + Sec->Name.substr(2));
 }
 
 template <class ELFT> void elf::splitSections() {
   // splitIntoPieces needs to be called on each MergeInputSection
   // before calling finalizeContents().
   parallelForEach(InputSections, [](InputSectionBase *Sec) {
-    if (auto *S = dyn_cast<MergeInputSection>(Sec))
+    if (auto *S = dyn_cast<MergeInputSection>(Sec)) {
+      S->maybeDecompress();
       S->splitIntoPieces();
-    else if (auto *Eh = dyn_cast<EhInputSection>(Sec))
+    } else if (auto *Eh = dyn_cast<EhInputSection>(Sec)) {
       Eh->split<ELFT>();
+    }
   });
 }
 
+namespace {
+// Mergeable input sections with equal keys are merged into the same
+// synthetic section.
+//
+// While we could create a single synthetic section for two different values
+// of Entsize, it is better to take Entsize into consideration. With a single
+// synthetic section no two pieces with different Entsize could be equal, so
+// we may as well have two sections. Using Entsize in here also allows us to
+// propagate it to the synthetic section.
+struct MergeKey {
+  CachedHashStringRef Name;
+  uint64_t Flags;
+  uint64_t Entsize;
+  uint32_t Alignment;
+};
+} // namespace
+
+namespace llvm {
+template <> struct DenseMapInfo<MergeKey> {
+  static MergeKey getEmptyKey() {
+    return {DenseMapInfo<CachedHashStringRef>::getEmptyKey(), 0, 0, 0};
+  }
+  static MergeKey getTombstoneKey() {
+    return {DenseMapInfo<CachedHashStringRef>::getTombstoneKey(), 0, 0, 0};
+  }
+  static unsigned getHashValue(const MergeKey &K) {
+    return hash_combine(K.Name.hash(), K.Flags, K.Entsize, K.Alignment);
+  }
+  static bool isEqual(const MergeKey &A, const MergeKey &B) {
+    return DenseMapInfo<CachedHashStringRef>::isEqual(A.Name, B.Name) &&
+           A.Flags == B.Flags && A.Entsize == B.Entsize &&
+           A.Alignment == B.Alignment;
+  }
+};
+} // namespace llvm
+
 // This function scans over the inputsections to create mergeable
 // synthetic sections.
 //
@@ -2751,46 +3912,52 @@ template <class ELFT> void elf::splitSections() {
 // that it replaces. It then finalizes each synthetic section in order
 // to compute an output offset for each piece of each input section.
 void elf::mergeSections() {
-  std::vector<MergeSyntheticSection *> MergeSections;
-  for (InputSectionBase *&S : InputSections) {
-    MergeInputSection *MS = dyn_cast<MergeInputSection>(S);
-    if (!MS)
-      continue;
-
-    // We do not want to handle sections that are not alive, so just remove
-    // them instead of trying to merge.
-    if (!MS->Live)
-      continue;
+  // We do not want to handle sections that are not alive, so just remove
+  // them instead of trying to merge.
+  std::vector<size_t> Indices;
+  for (size_t I = 0, E = InputSections.size(); I != E; ++I)
+    if (auto *MS = dyn_cast<MergeInputSection>(InputSections[I]))
+      if (MS->Live)
+        Indices.push_back(I);
+
+  // Computing output section names involves a series of prefix matches,
+  // so do it in parallel. Grouping is done afterwards in input order, so
+  // the result does not depend on the number of threads.
+  std::vector<StringRef> Names(Indices.size());
+  std::vector<uint32_t> Hashes(Indices.size());
+  parallelForEachN(0, Indices.size(), [&](size_t I) {
+    Names[I] = getOutputSectionName(InputSections[Indices[I]]);
+    Hashes[I] = CachedHashStringRef(Names[I]).hash();
+  });
 
-    StringRef OutsecName = getOutputSectionName(MS);
+  std::vector<MergeSyntheticSection *> MergeSections;
+  DenseMap<MergeKey, MergeSyntheticSection *> Map;
+  for (size_t I = 0, E = Indices.size(); I != E; ++I) {
+    InputSectionBase *&S = InputSections[Indices[I]];
+    auto *MS = cast<MergeInputSection>(S);
     uint32_t Alignment = std::max<uint32_t>(MS->Alignment, MS->Entsize);
+    MergeKey Key = {CachedHashStringRef(Names[I], Hashes[I]), MS->Flags,
+                    MS->Entsize, Alignment};
 
-    auto I = llvm::find_if(MergeSections, [=](MergeSyntheticSection *Sec) {
-      // While we could create a single synthetic section for two different
-      // values of Entsize, it is better to take Entsize into consideration.
-      //
-      // With a single synthetic section no two pieces with different Entsize
-      // could be equal, so we may as well have two sections.
-      //
-      // Using Entsize in here also allows us to propagate it to the synthetic
-      // section.
-      return Sec->Name == OutsecName && Sec->Flags == MS->Flags &&
-             Sec->Entsize == MS->Entsize && Sec->Alignment == Alignment;
-    });
-    if (I == MergeSections.end()) {
-      MergeSyntheticSection *Syn =
-          createMergeSynthetic(OutsecName, MS->Type, MS->Flags, Alignment);
+    MergeSyntheticSection *&Syn = Map[Key];
+    if (!Syn) {
+      Syn = createMergeSynthetic(Names[I], MS->Type, MS->Flags, Alignment);
+      Syn->Entsize = MS->Entsize;
       MergeSections.push_back(Syn);
-      I = std::prev(MergeSections.end());
       S = Syn;
-      Syn->Entsize = MS->Entsize;
     } else {
       S = nullptr;
     }
-    (*I)->addSection(MS);
+    Syn->addSection(MS);
   }
+
+  // The sections are independent of each other, and each of them runs its
+  // own parallel loops, which do not saturate the threads for the many
+  // small sections.
+  TaskGroup TG;
   for (auto *MS : MergeSections)
-    MS->finalizeContents();
+    TG.spawn([=] { MS->finalizeContents(); });
+  TG.wait();
 
   std::vector<InputSectionBase *> &V = InputSections;
   V.erase(std::remove(V.begin(), V.end(), nullptr), V.end());
@@ -2874,6 +4041,7 @@ SyntheticSection *InX::Dynamic;
 StringTableSection *InX::DynStrTab;
 SymbolTableBaseSection *InX::DynSymTab;
 InputSection *InX::Interp;
+DebugNamesSection *InX::DebugNames;
 GdbIndexSection *InX::GdbIndex;
 GotSection *InX::Got;
 GotPltSection *InX::GotPlt;
@@ -2887,6 +4055,7 @@ PltSection *InX::Iplt;
 RelocationBaseSection *InX::RelaDyn;
 RelocationBaseSection *InX::RelaPlt;
 RelocationBaseSection *InX::RelaIplt;
+RelrBaseSection *InX::RelrDyn;
 StringTableSection *InX::ShStrTab;
 StringTableSection *InX::StrTab;
 SymbolTableBaseSection *InX::SymTab;
@@ -2896,15 +4065,24 @@ template GdbIndexSection *elf::createGdbIndex<ELF32BE>();
 template GdbIndexSection *elf::createGdbIndex<ELF64LE>();
 template GdbIndexSection *elf::createGdbIndex<ELF64BE>();
 
+template DebugNamesSection *elf::createDebugNames<ELF32LE>();
+template DebugNamesSection *elf::createDebugNames<ELF32BE>();
+template DebugNamesSection *elf::createDebugNames<ELF64LE>();
+template DebugNamesSection *elf::createDebugNames<ELF64BE>();
+
 template void elf::splitSections<ELF32LE>();
 template void elf::splitSections<ELF32BE>();
 template void elf::splitSections<ELF64LE>();
 template void elf::splitSections<ELF64BE>();
 
-template void EhFrameSection::addSection<ELF32LE>(InputSectionBase *);
-template void EhFrameSection::addSection<ELF32BE>(InputSectionBase *);
-template void EhFrameSection::addSection<ELF64LE>(InputSectionBase *);
-template void EhFrameSection::addSection<ELF64BE>(InputSectionBase *);
+template void
+EhFrameSection::addSections<ELF32LE>(ArrayRef<EhInputSection *>);
+template void
+EhFrameSection::addSections<ELF32BE>(ArrayRef<EhInputSection *>);
+template void
+EhFrameSection::addSections<ELF64LE>(ArrayRef<EhInputSection *>);
+template void
+EhFrameSection::addSections<ELF64BE>(ArrayRef<EhInputSection *>);
 
 template void PltSection::addEntry<ELF32LE>(Symbol &Sym);
 template void PltSection::addEntry<ELF32BE>(Symbol &Sym);
@@ -2946,6 +4124,11 @@ template class elf::AndroidPackedRelocationSection<ELF32BE>;
 template class elf::AndroidPackedRelocationSection<ELF64LE>;
 template class elf::AndroidPackedRelocationSection<ELF64BE>;
 
+template class elf::RelrSection<ELF32LE>;
+template class elf::RelrSection<ELF32BE>;
+template class elf::RelrSection<ELF64LE>;
+template class elf::RelrSection<ELF64BE>;
+
 template class elf::SymbolTableSection<ELF32LE>;
 template class elf::SymbolTableSection<ELF32BE>;
 template class elf::SymbolTableSection<ELF64LE>;
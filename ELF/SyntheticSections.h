@@ -72,7 +72,7 @@ public:
   bool empty() const override { return Sections.empty(); }
   size_t getSize() const override { return Size; }
 
-  template <class ELFT> void addSection(InputSectionBase *S);
+  template <class ELFT> void addSections(ArrayRef<EhInputSection *> Secs);
 
   std::vector<EhInputSection *> Sections;
   size_t NumFdes = 0;
@@ -86,17 +86,22 @@ public:
   ArrayRef<CieRecord *> getCieRecords() const { return CieRecords; }
 
 private:
-  // This is used only when parsing EhInputSection. We keep it here to avoid
-  // allocating one for each EhInputSection.
-  llvm::DenseMap<size_t, CieRecord *> OffsetToCie;
+  // The CIEs and live FDEs of an input section in the order they appear in
+  // the section. Each CIE is paired with its personality function and each
+  // FDE with the index of its CIE in Cies.
+  struct ParsedSection {
+    std::vector<std::pair<EhSectionPiece *, Symbol *>> Cies;
+    std::vector<std::pair<EhSectionPiece *, unsigned>> Fdes;
+    bool HasInvalidCieRef = false;
+  };
 
   uint64_t Size = 0;
 
   template <class ELFT, class RelTy>
-  void addSectionAux(EhInputSection *S, llvm::ArrayRef<RelTy> Rels);
+  void parseSection(EhInputSection *S, llvm::ArrayRef<RelTy> Rels,
+                    ParsedSection &Out);
 
-  template <class ELFT, class RelTy>
-  CieRecord *addCie(EhSectionPiece &Piece, ArrayRef<RelTy> Rels);
+  CieRecord *addCie(EhSectionPiece &Piece, Symbol *Personality);
 
   template <class ELFT, class RelTy>
   bool isFdeLive(EhSectionPiece &Piece, ArrayRef<RelTy> Rels);
@@ -382,6 +387,7 @@ class StringTableSection final : public SyntheticSection {
 public:
   StringTableSection(StringRef Name, bool Dynamic);
   unsigned addString(StringRef S, bool HashIt = true);
+  std::vector<unsigned> addStrings(ArrayRef<StringRef> Strs);
   void writeTo(uint8_t *Buf) override;
   size_t getSize() const override { return Size; }
   bool isDynamic() const { return Dynamic; }
@@ -391,7 +397,10 @@ private:
 
   uint64_t Size = 0;
 
-  llvm::DenseMap<StringRef, unsigned> StringMap;
+  // The offsets of hashed strings, sharded by hash so that addStrings can
+  // deduplicate each shard in parallel.
+  enum { NumShards = 16 };
+  llvm::DenseMap<llvm::CachedHashStringRef, unsigned> StringMap[NumShards];
   std::vector<StringRef> Strings;
 };
 
@@ -438,6 +447,7 @@ template <class ELFT> class DynamicSection final : public SyntheticSection {
   typedef typename ELFT::Dyn Elf_Dyn;
   typedef typename ELFT::Rel Elf_Rel;
   typedef typename ELFT::Rela Elf_Rela;
+  typedef typename ELFT::Relr Elf_Relr;
   typedef typename ELFT::Shdr Elf_Shdr;
   typedef typename ELFT::Sym Elf_Sym;
 
@@ -477,6 +487,7 @@ public:
   bool empty() const override { return Relocs.empty(); }
   size_t getSize() const override { return Relocs.size() * this->Entsize; }
   size_t getRelativeRelocCount() const { return NumRelativeRelocs; }
+  ArrayRef<DynamicReloc> getRelocs() const { return Relocs; }
   void finalizeContents() override;
   int32_t DynamicTag, SizeDynamicTag;
 
@@ -515,6 +526,44 @@ public:
 
 private:
   SmallVector<char, 0> RelocData;
+
+  // The relocations that RelocData was encoded from. If a layout iteration
+  // does not change any of them, RelocData is not recomputed.
+  std::vector<Elf_Rela> EncodedRelocs;
+};
+
+struct RelativeReloc {
+  uint64_t getOffset() const { return InputSec->getVA(OffsetInSec); }
+
+  const InputSectionBase *InputSec;
+  uint64_t OffsetInSec;
+};
+
+class RelrBaseSection : public SyntheticSection {
+public:
+  RelrBaseSection();
+  bool empty() const override { return Relocs.empty(); }
+  std::vector<RelativeReloc> Relocs;
+};
+
+// RelrSection is used to encode offsets for relative relocations.
+// Proposal for adding SHT_RELR sections to generic-abi is here:
+//   https://groups.google.com/forum/#!topic/generic-abi/bX460iggiKg
+// For more details, see the comment in RelrSection::updateAllocSize().
+template <class ELFT> class RelrSection final : public RelrBaseSection {
+  typedef typename ELFT::Relr Elf_Relr;
+
+public:
+  RelrSection();
+
+  bool updateAllocSize() override;
+  size_t getSize() const override { return RelrRelocs.size() * this->Entsize; }
+  void writeTo(uint8_t *Buf) override {
+    memcpy(Buf, RelrRelocs.data(), getSize());
+  }
+
+private:
+  std::vector<Elf_Relr> RelrRelocs;
 };
 
 struct SymbolTableEntry {
@@ -529,6 +578,7 @@ public:
   void postThunkContents() override;
   size_t getSize() const override { return getNumSymbols() * Entsize; }
   void addSymbol(Symbol *Sym);
+  void addLocalSymbols(ArrayRef<Symbol *> Syms);
   unsigned getNumSymbols() const { return Symbols.size() + 1; }
   size_t getSymbolIndex(Symbol *Sym);
   ArrayRef<SymbolTableEntry> getSymbols() const { return Symbols; }
@@ -571,6 +621,7 @@ private:
 
   void writeBloomFilter(uint8_t *Buf);
   void writeHashTable(uint8_t *Buf);
+  void printStats();
 
   struct Entry {
     Symbol *Sym;
@@ -643,11 +694,11 @@ struct GdbIndexChunk {
   std::vector<NameTypeEntry> NamesAndTypes;
 };
 
-// The symbol type for the .gdb_index section.
+// The symbol type for the .gdb_index section. The name is hashed with the
+// .gdb_index hash function.
 struct GdbSymbol {
-  uint32_t NameHash;
+  llvm::CachedHashStringRef Name;
   size_t NameOffset;
-  size_t CuVectorIndex;
 };
 
 class GdbIndexSection final : public SyntheticSection {
@@ -668,8 +719,8 @@ private:
   // CU vector is a part of constant pool area of section.
   std::vector<std::vector<uint32_t>> CuVectors;
 
-  // Symbol table contents.
-  llvm::DenseMap<llvm::CachedHashStringRef, GdbSymbol *> Symbols;
+  // Symbol table contents. Symbols[I] uses CuVectors[I].
+  std::vector<GdbSymbol> Symbols;
 
   // Each chunk contains information gathered from a debug sections of single
   // object and used to build different areas of gdb index.
@@ -687,6 +738,79 @@ private:
 
 template <class ELFT> GdbIndexSection *createGdbIndex();
 
+// DebugNamesChunk is created for each .debug_info section and contains the
+// names of the compilation units in it.
+struct DebugNamesChunk {
+  struct NameEntry {
+    // Hashed with the DWARF v5 name table hash function.
+    llvm::CachedHashStringRef Name;
+    uint32_t CuIndex;
+    uint32_t DieOffset;
+    uint32_t Tag;
+  };
+
+  InputSection *DebugInfoSec;
+  std::vector<uint64_t> CuOffsets;
+  std::vector<NameEntry> Names;
+};
+
+// The strings of .debug_names. They are appended to .debug_str.
+class DebugNamesStrSection final : public SyntheticSection {
+public:
+  DebugNamesStrSection(std::string &&Strings);
+  void writeTo(uint8_t *Buf) override;
+  size_t getSize() const override { return Strings.size(); }
+
+private:
+  std::string Strings;
+};
+
+// --debug-names creates a DWARF v5 .debug_names section with a single name
+// index for all compilation units. Names are taken from the .debug_names
+// sections of the inputs, or from their pubnames if they have none.
+class DebugNamesSection final : public SyntheticSection {
+public:
+  DebugNamesSection(std::vector<DebugNamesChunk> &&Chunks);
+  void writeTo(uint8_t *Buf) override;
+  size_t getSize() const override { return Size; }
+  bool empty() const override;
+
+  DebugNamesStrSection *StrSec;
+
+private:
+  struct Entry {
+    uint32_t CuIndex;
+    uint32_t DieOffset;
+    uint32_t Tag;
+  };
+
+  struct NameData {
+    llvm::CachedHashStringRef Str;
+    uint64_t FirstUse;
+    uint32_t StrOffset;
+    uint32_t EntryOffset;
+    std::vector<Entry> Entries;
+  };
+
+  void mergeNames();
+
+  std::vector<DebugNamesChunk> Chunks;
+  std::vector<uint32_t> CuBase;
+  uint32_t NumCus;
+  std::vector<NameData> Names;
+  std::vector<uint32_t> Buckets;
+
+  // Each tag has an abbreviation whose code is its index in Tags plus one.
+  std::vector<uint32_t> Tags;
+  llvm::DenseMap<uint32_t, uint32_t> AbbrevCodes;
+
+  uint32_t AbbrevTableSize;
+  size_t EntryPoolOffset;
+  size_t Size;
+};
+
+template <class ELFT> DebugNamesSection *createDebugNames();
+
 // --eh-frame-hdr option tells linker to construct a header for all the
 // .eh_frame sections. This header is placed to a section named .eh_frame_hdr
 // and also to a PT_GNU_EH_FRAME segment.
@@ -793,12 +917,27 @@ public:
   MergeTailSection(StringRef Name, uint32_t Type, uint64_t Flags,
                    uint32_t Alignment);
 
-  size_t getSize() const override;
+  size_t getSize() const override { return Size; }
   void writeTo(uint8_t *Buf) override;
   void finalizeContents() override;
 
 private:
-  llvm::StringTableBuilder Builder;
+  // See MergeNoTailSection::getShardId.
+  size_t getShardId(uint32_t Hash) {
+    return Hash >> (32 - llvm::countTrailingZeros(NumShards));
+  }
+
+  // Section size
+  size_t Size = 0;
+
+  // Unique strings are collected in shards in parallel. Each shard maps a
+  // string to its offset in the section.
+  constexpr static size_t NumShards = 32;
+  std::vector<llvm::DenseMap<llvm::CachedHashStringRef, size_t>> Shards;
+
+  // The strings that are not tail-merged into another string and their
+  // offsets. The other strings are written as part of these.
+  std::vector<std::pair<StringRef, size_t>> Contents;
 };
 
 class MergeNoTailSection final : public MergeSyntheticSection {
@@ -920,6 +1059,7 @@ public:
   void writeTo(uint8_t *Buf) override;
   InputSection *getTargetInputSection() const;
   bool assignOffsets();
+  ArrayRef<Thunk *> getThunks() const { return Thunks; }
 
 private:
   std::vector<Thunk *> Thunks;
@@ -949,6 +1089,7 @@ struct InX {
   static GnuHashTableSection *GnuHashTab;
   static HashTableSection *HashTab;
   static InputSection *Interp;
+  static DebugNamesSection *DebugNames;
   static GdbIndexSection *GdbIndex;
   static GotSection *Got;
   static GotPltSection *GotPlt;
@@ -960,6 +1101,7 @@ struct InX {
   static RelocationBaseSection *RelaDyn;
   static RelocationBaseSection *RelaPlt;
   static RelocationBaseSection *RelaIplt;
+  static RelrBaseSection *RelrDyn;
   static StringTableSection *ShStrTab;
   static StringTableSection *StrTab;
   static SymbolTableBaseSection *SymTab;
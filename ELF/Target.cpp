@@ -29,6 +29,7 @@
 #include "OutputSections.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
+#include "TargetImpl.h"
 #include "lld/Common/ErrorHandler.h"
 #include "llvm/Object/ELF.h"
 
@@ -143,6 +144,11 @@ RelExpr TargetInfo::adjustRelaxExpr(RelType Type, const uint8_t *Data,
   return Expr;
 }
 
+void TargetInfo::relocateAlloc(InputSectionBase &Sec, uint8_t *Buf,
+                               uint8_t *BufEnd) const {
+  relocateAllocWith(*this, Sec, Buf, BufEnd);
+}
+
 void TargetInfo::relaxGot(uint8_t *Loc, uint64_t Val) const {
   llvm_unreachable("Should not have claimed to be relaxable");
 }
@@ -67,6 +67,11 @@ public:
 
   virtual void relocateOne(uint8_t *Loc, RelType Type, uint64_t Val) const = 0;
 
+  // Applies the relocations of an allocated section. Targets override this
+  // to call relocateAllocWith on their own class; see TargetImpl.h.
+  virtual void relocateAlloc(InputSectionBase &Sec, uint8_t *Buf,
+                             uint8_t *BufEnd) const;
+
   virtual ~TargetInfo();
 
   unsigned TlsGdRelaxSkip = 1;
@@ -0,0 +1,104 @@
+//===- TargetImpl.h ---------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Applying relocations to allocated sections is the largest parallel part of
+// writing the output, and for each relocation it used to make a virtual call
+// to Target->relocateOne. relocateAllocWith is the relocation loop as a
+// template over the target class. Instantiated with TargetInfo it is the
+// generic loop; a target that declares its relocateOne and relax functions
+// final can instantiate it with its own class from the file that defines
+// them, so that those calls are direct and can be inlined.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_TARGET_IMPL_H
+#define LLD_ELF_TARGET_IMPL_H
+
+#include "InputSection.h"
+#include "OutputSections.h"
+#include "Symbols.h"
+#include "Target.h"
+#include "llvm/Support/MathExtras.h"
+
+namespace lld {
+namespace elf {
+
+template <class TargetT>
+void relocateAllocWith(const TargetT &T, InputSectionBase &Sec, uint8_t *Buf,
+                       uint8_t *BufEnd) {
+  assert(Sec.Flags & llvm::ELF::SHF_ALLOC);
+  const unsigned Bits = Config->Wordsize * 8;
+
+  uint64_t SecOff = 0;
+  if (auto *IS = dyn_cast<InputSection>(&Sec))
+    SecOff = IS->OutSecOff;
+  uint64_t SecAddr = Sec.getOutputSection()->Addr + SecOff;
+
+  for (const Relocation &Rel : Sec.Relocations) {
+    uint8_t *BufLoc = Buf + SecOff + Rel.Offset;
+    RelType Type = Rel.Type;
+    uint64_t AddrLoc = SecAddr + Rel.Offset;
+    RelExpr Expr = Rel.Expr;
+
+    // Absolute and PC-relative references to non-weak symbols are most of
+    // the relocations in a typical program, so don't go through the big
+    // switch in getRelocTargetVA for them.
+    uint64_t TargetVA;
+    if (Expr == R_ABS)
+      TargetVA = Rel.Sym->getVA(Rel.Addend);
+    else if (Expr == R_PC && !Rel.Sym->isUndefWeak())
+      TargetVA = Rel.Sym->getVA(Rel.Addend) - AddrLoc;
+    else
+      TargetVA = getRelocTargetVA(Sec.File, Type, Rel.Addend, AddrLoc,
+                                  *Rel.Sym, Expr);
+    TargetVA = llvm::SignExtend64(TargetVA, Bits);
+
+    switch (Expr) {
+    case R_RELAX_GOT_PC:
+    case R_RELAX_GOT_PC_NOPIC:
+      T.relaxGot(BufLoc, TargetVA);
+      break;
+    case R_RELAX_TLS_IE_TO_LE:
+      T.relaxTlsIeToLe(BufLoc, Type, TargetVA);
+      break;
+    case R_RELAX_TLS_LD_TO_LE:
+      T.relaxTlsLdToLe(BufLoc, Type, TargetVA);
+      break;
+    case R_RELAX_TLS_GD_TO_LE:
+    case R_RELAX_TLS_GD_TO_LE_NEG:
+      T.relaxTlsGdToLe(BufLoc, Type, TargetVA);
+      break;
+    case R_RELAX_TLS_GD_TO_IE:
+    case R_RELAX_TLS_GD_TO_IE_ABS:
+    case R_RELAX_TLS_GD_TO_IE_PAGE_PC:
+    case R_RELAX_TLS_GD_TO_IE_END:
+      T.relaxTlsGdToIe(BufLoc, Type, TargetVA);
+      break;
+    case R_PPC_CALL:
+      // Patch a nop (0x60000000) to a ld.
+      if (Rel.Sym->NeedsTocRestore) {
+        if (BufLoc + 8 > BufEnd || read32(BufLoc + 4) != 0x60000000) {
+          error(getErrorLocation(BufLoc) + "call lacks nop, can't restore toc");
+          break;
+        }
+        write32(BufLoc + 4, 0xe8410018); // ld %r2, 24(%r1)
+      }
+      T.relocateOne(BufLoc, Type, TargetVA);
+      break;
+    default:
+      T.relocateOne(BufLoc, Type, TargetVA);
+      break;
+    }
+  }
+}
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -12,17 +12,22 @@
 #include "CallGraphSort.h"
 #include "Config.h"
 #include "Filesystem.h"
+#include "Incremental.h"
 #include "LinkerScript.h"
 #include "MapFile.h"
 #include "OutputSections.h"
 #include "Relocations.h"
+#include "Stats.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "lld/Common/InPlaceOutputBuffer.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/TimeTrace.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include <climits>
@@ -64,16 +69,26 @@ private:
   void assignFileOffsetsBinary();
   void setPhdrs();
   void checkSections();
+  void countDirtyPages();
   void fixSectionAlignments();
   void openFile();
   void writeTrapInstr();
   void writeHeader();
+  void writeHeaderTo(uint8_t *Buf, uint8_t *SHdrBuf);
+  void writeSection(OutputSection *Sec);
   void writeSections();
   void writeSectionsBinary();
   void writeBuildId();
 
   std::unique_ptr<FileOutputBuffer> &Buffer;
 
+  // Non-null if the output is written with --no-mmap-output. Buffer owns it.
+  StreamOutputBuffer *Stream = nullptr;
+
+  // With --no-mmap-output, the contents of sections that are read or
+  // patched after they have been written.
+  llvm::DenseMap<OutputSection *, std::vector<uint8_t>> KeptSections;
+
   void addRelIpltSymbols();
   void addStartEndSymbols();
   void addStartStopSymbols(OutputSection *Sec);
@@ -156,14 +171,16 @@ template <class ELFT> void Writer<ELFT>::removeEmptyPTLoad() {
 }
 
 template <class ELFT> static void combineEhFrameSections() {
+  std::vector<EhInputSection *> Sections;
   for (InputSectionBase *&S : InputSections) {
     EhInputSection *ES = dyn_cast<EhInputSection>(S);
     if (!ES || !ES->Live)
       continue;
 
-    InX::EhFrame->addSection<ELFT>(ES);
+    Sections.push_back(ES);
     S = nullptr;
   }
+  InX::EhFrame->addSections<ELFT>(Sections);
 
   std::vector<InputSectionBase *> &V = InputSections;
   V.erase(std::remove(V.begin(), V.end(), nullptr), V.end());
@@ -274,6 +291,10 @@ template <class ELFT> static void createSyntheticSections() {
     InX::RelaDyn = make<RelocationSection<ELFT>>(
         Config->IsRela ? ".rela.dyn" : ".rel.dyn", Config->ZCombreloc);
   }
+  if (Config->RelrPackDynRelocs)
+    InX::RelrDyn = make<RelrSection<ELFT>>();
+  else
+    InX::RelrDyn = nullptr;
   InX::ShStrTab = make<StringTableSection>(".shstrtab", false);
 
   Out::ProgramHeaders = make<OutputSection>("", 0, SHF_ALLOC);
@@ -349,6 +370,8 @@ template <class ELFT> static void createSyntheticSections() {
     Add(InX::Dynamic);
     Add(InX::DynStrTab);
     Add(InX::RelaDyn);
+    if (InX::RelrDyn)
+      Add(InX::RelrDyn);
   }
 
   // Add .got. MIPS' .got is so different from the other archs,
@@ -371,6 +394,12 @@ template <class ELFT> static void createSyntheticSections() {
     Add(InX::GdbIndex);
   }
 
+  if (Config->DebugNames) {
+    InX::DebugNames = createDebugNames<ELFT>();
+    Add(InX::DebugNames);
+    Add(InX::DebugNames->StrSec);
+  }
+
   // We always need to add rel[a].plt to output if it has entries.
   // Even for static linking it can contain R_[*]_IRELATIVE relocations.
   InX::RelaPlt = make<RelocationSection<ELFT>>(
@@ -420,6 +449,7 @@ template <class ELFT> static void createSyntheticSections() {
 template <class ELFT> void Writer<ELFT>::run() {
   // Create linker-synthesized sections such as .got or .plt.
   // Such sections are of type input section.
+  TimeTraceScope CreateScope("Create output sections");
   createSyntheticSections<ELFT>();
 
   if (!Config->Relocatable)
@@ -434,20 +464,28 @@ template <class ELFT> void Writer<ELFT>::run() {
   // they are assigned to output sections by the default rule. Process that.
   Script->addOrphanSections();
 
+  // Input sections are final now, so the sizes they need are known.
+  if (Config->Incremental)
+    prepareIncrementalLayout();
+
   if (Config->Discard != DiscardPolicy::All)
     copyLocalSymbols();
 
   if (Config->CopyRelocs)
     addSectionSymbols();
+  CreateScope.end();
 
   // Now that we have a complete set of output sections. This function
   // completes section contents. For example, we need to add strings
   // to the string table, and add entries to .got and .plt.
   // finalizeSections does that.
+  TimeTraceScope FinalizeScope("Finalize sections");
   finalizeSections();
+  FinalizeScope.end();
   if (errorCount())
     return;
 
+  TimeTraceScope LayoutScope("Assign addresses");
   Script->assignAddresses();
 
   // If -compressed-debug-sections is specified, we need to compress
@@ -477,6 +515,9 @@ template <class ELFT> void Writer<ELFT>::run() {
 
   if (Config->CheckSections)
     checkSections();
+  if (Config->PrintStats && !Config->Relocatable)
+    countDirtyPages();
+  LayoutScope.end();
 
   // It does not make sense try to open the file if we have error already.
   if (errorCount())
@@ -486,6 +527,7 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (errorCount())
     return;
 
+  TimeTraceScope WriteScope("Write sections");
   if (!Config->OFormatBinary) {
     writeTrapInstr();
     writeHeader();
@@ -493,21 +535,31 @@ template <class ELFT> void Writer<ELFT>::run() {
   } else {
     writeSectionsBinary();
   }
+  WriteScope.end();
 
   // Backfill .note.gnu.build-id section content. This is done at last
   // because the content is usually a hash value of the entire output file.
+  TimeTraceScope BuildIdScope("Write build ID");
   writeBuildId();
+  BuildIdScope.end();
   if (errorCount())
     return;
 
   // Handle -Map and -cref options.
+  TimeTraceScope MapScope("Write map file");
   writeMapFile();
   writeCrossReferenceTable();
+  MapScope.end();
   if (errorCount())
     return;
 
+  TimeTraceScope CommitScope("Commit output");
   if (auto E = Buffer->commit())
     error("failed to write to the output file: " + toString(std::move(E)));
+  CommitScope.end();
+
+  if (Config->Incremental && !errorCount())
+    writeIncrementalState();
 }
 
 static bool shouldKeepInSymtab(SectionBase *Sec, StringRef SymName,
@@ -559,11 +611,15 @@ static bool includeInSymtab(const Symbol &B) {
 
 // Local symbols are not in the linker's symbol table. This function scans
 // each object file's symbol table to copy local symbols to the output.
+// Files are scanned in parallel, and the symbols are then added in file
+// order so that the output does not depend on the number of threads.
 template <class ELFT> void Writer<ELFT>::copyLocalSymbols() {
   if (!InX::SymTab)
     return;
-  for (InputFile *File : ObjectFiles) {
-    ObjFile<ELFT> *F = cast<ObjFile<ELFT>>(File);
+
+  std::vector<std::vector<Symbol *>> Locals(ObjectFiles.size());
+  parallelForEachN(0, ObjectFiles.size(), [&](size_t I) {
+    ObjFile<ELFT> *F = cast<ObjFile<ELFT>>(ObjectFiles[I]);
     for (Symbol *B : F->getLocalSymbols()) {
       if (!B->isLocal())
         fatal(toString(F) +
@@ -579,9 +635,14 @@ template <class ELFT> void Writer<ELFT>::copyLocalSymbols() {
       SectionBase *Sec = DR->Section;
       if (!shouldKeepInSymtab(Sec, B->getName(), *B))
         continue;
-      InX::SymTab->addSymbol(B);
+      Locals[I].push_back(B);
     }
-  }
+  });
+
+  std::vector<Symbol *> Syms;
+  for (std::vector<Symbol *> &V : Locals)
+    Syms.insert(Syms.end(), V.begin(), V.end());
+  InX::SymTab->addLocalSymbols(Syms);
 }
 
 template <class ELFT> void Writer<ELFT>::addSectionSymbols() {
@@ -1062,27 +1123,23 @@ findOrphanPos(std::vector<BaseCommand *>::iterator B,
   return I;
 }
 
-// Builds section order for handling --symbol-ordering-file.
-static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
-  DenseMap<const InputSectionBase *, int> SectionOrder;
-  // Use the rarely used option -call-graph-ordering-file to sort sections.
-  if (!Config->CallGraphProfile.empty())
-    return computeCallGraphProfileOrder();
-
-  if (Config->SymbolOrderingFile.empty())
-    return SectionOrder;
-
+// Gives the sections that define the symbols in Names priorities from
+// Priority onwards, in the order of Names, unless they already have a higher
+// one. If DataOnly is true, sections that contain code are left alone.
+static void
+addSymbolOrder(DenseMap<const InputSectionBase *, int> &SectionOrder,
+               ArrayRef<StringRef> Names, int Priority, StringRef FileKind,
+               bool DataOnly) {
   struct SymbolOrderEntry {
     int Priority;
     bool Present;
   };
 
   // Build a map from symbols to their priorities. Symbols that didn't
-  // appear in the symbol ordering file have the lowest priority 0.
+  // appear in the ordering file have the lowest priority 0.
   // All explicitly mentioned symbols have negative (higher) priorities.
   DenseMap<StringRef, SymbolOrderEntry> SymbolOrder;
-  int Priority = -Config->SymbolOrderingFile.size();
-  for (StringRef S : Config->SymbolOrderingFile)
+  for (StringRef S : Names)
     SymbolOrder.insert({S, {Priority++, false}});
 
   // Build a map from sections to their priorities.
@@ -1097,6 +1154,12 @@ static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
 
     if (auto *D = dyn_cast<Defined>(&Sym)) {
       if (auto *Sec = dyn_cast_or_null<InputSectionBase>(D->Section)) {
+        if (DataOnly && (Sec->Flags & SHF_EXECINSTR)) {
+          if (Config->WarnSymbolOrdering)
+            warn(toString(Sym.File) + ": unable to order code symbol: " +
+                 Sym.getName());
+          return;
+        }
         int &Priority = SectionOrder[cast<InputSectionBase>(Sec->Repl)];
         Priority = std::min(Priority, Ent.Priority);
       }
@@ -1115,8 +1178,33 @@ static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
   if (Config->WarnSymbolOrdering)
     for (auto OrderEntry : SymbolOrder)
       if (!OrderEntry.second.Present)
-        warn("symbol ordering file: no such symbol: " + OrderEntry.first);
+        warn(FileKind + " ordering file: no such symbol: " + OrderEntry.first);
+}
 
+// Builds section order for handling --symbol-ordering-file and
+// --data-ordering-file.
+static DenseMap<const InputSectionBase *, int> buildSectionOrder() {
+  DenseMap<const InputSectionBase *, int> SectionOrder;
+  // Use the rarely used option -call-graph-ordering-file to sort sections.
+  if (!Config->CallGraphProfile.empty())
+    SectionOrder = computeCallGraphProfileOrder();
+  else if (!Config->SymbolOrderingFile.empty())
+    addSymbolOrder(SectionOrder, Config->SymbolOrderingFile,
+                   -(int)Config->SymbolOrderingFile.size(), "symbol",
+                   /*DataOnly=*/false);
+
+  // Hot data named by --data-ordering-file goes before everything else in
+  // its output section, so that it shares as few cache lines and pages as
+  // possible. Its priorities are above those of the other orders so that
+  // it wins if a symbol is named by both.
+  if (!Config->DataOrderingFile.empty()) {
+    int Min = 0;
+    for (const auto &KV : SectionOrder)
+      Min = std::min(Min, KV.second);
+    addSymbolOrder(SectionOrder, Config->DataOrderingFile,
+                   Min - (int)Config->DataOrderingFile.size(), "data",
+                   /*DataOnly=*/true);
+  }
   return SectionOrder;
 }
 
@@ -1170,8 +1258,12 @@ sortISDBySectionOrder(InputSectionDescription *ISD,
   // of the second block of cold code can call the hot code without a thunk. So
   // we effectively double the amount of code that could potentially call into
   // the hot code without a thunk.
+  //
+  // Data is not reached by branches, so ordered data sections always go first
+  // and the unordered, cold ones after them.
   size_t InsPt = 0;
-  if (Target->ThunkSectionSpacing && !OrderedSections.empty()) {
+  if (Target->ThunkSectionSpacing && !OrderedSections.empty() &&
+      (OrderedSections[0].first->Flags & SHF_EXECINSTR)) {
     uint64_t UnorderedPos = 0;
     for (; InsPt != UnorderedSections.size(); ++InsPt) {
       UnorderedPos += UnorderedSections[InsPt]->getSize();
@@ -1212,16 +1304,40 @@ static void sortSection(OutputSection *Sec,
   if (Name == ".init" || Name == ".fini")
     return;
 
-  // Sort input sections by priority using the list provided
-  // by --symbol-ordering-file.
+  // With -z hugepage-text, put .text.hot input sections first so that the
+  // hottest code shares the first huge page. Sections ordered by a profile
+  // are still placed before them.
+  if (Config->ZHugepageText && (Sec->Flags & SHF_EXECINSTR))
+    for (BaseCommand *B : Sec->SectionCommands)
+      if (auto *ISD = dyn_cast<InputSectionDescription>(B))
+        std::stable_partition(ISD->Sections.begin(), ISD->Sections.end(),
+                              [](InputSection *IS) {
+                                return isSectionPrefix(".text.hot.", IS->Name);
+                              });
+
+  // Sort input sections by priority using the lists provided
+  // by --symbol-ordering-file and --data-ordering-file.
   if (!Order.empty())
     for (BaseCommand *B : Sec->SectionCommands)
       if (auto *ISD = dyn_cast<InputSectionDescription>(B))
         sortISDBySectionOrder(ISD, Order);
+
+  // With -z group-relocated-data, put the data sections that the loader
+  // has to relocate before the ones it does not touch, so that applying
+  // the dynamic relocations dirties as few pages as possible. This keeps
+  // the order given by the lists above within each group.
+  if (Config->ZGroupRelocatedData && (Sec->Flags & SHF_WRITE) &&
+      !(Sec->Flags & SHF_EXECINSTR) && Sec->Type != SHT_NOBITS)
+    for (BaseCommand *B : Sec->SectionCommands)
+      if (auto *ISD = dyn_cast<InputSectionDescription>(B))
+        std::stable_partition(
+            ISD->Sections.begin(), ISD->Sections.end(),
+            [](InputSection *IS) { return IS->HasDynamicRelocs; });
 }
 
 // If no layout was provided by linker script, we want to apply default
-// sorting for special input sections. This also handles --symbol-ordering-file.
+// sorting for special input sections. This also handles --symbol-ordering-file
+// and --data-ordering-file.
 template <class ELFT> void Writer<ELFT>::sortInputSections() {
   // Build the order once since it is expensive.
   DenseMap<const InputSectionBase *, int> Order = buildSectionOrder();
@@ -1480,6 +1596,57 @@ static void applySynthetic(const std::vector<SyntheticSection *> &Sections,
       Fn(SS);
 }
 
+namespace {
+// A synthetic section and the sections whose finalizeContents must have run
+// before its own.
+struct FinalizeNode {
+  SyntheticSection *Sec;
+  std::vector<SyntheticSection *> Deps;
+};
+} // namespace
+
+// Calls finalizeContents on the sections of Nodes that are in use. Each node
+// must come after its dependencies. Nodes are put into waves by the length
+// of their dependency chain, and the sections of a wave are finalized in
+// parallel. finalizeContents sets the sh_link and sh_info of the parent, so
+// sections that share an output section are finalized by the same task.
+static void finalizeSynthetic(ArrayRef<FinalizeNode> Nodes) {
+  typedef std::vector<SyntheticSection *> Task;
+  std::vector<std::vector<Task>> Waves;
+  DenseMap<SyntheticSection *, size_t> WaveOf;
+
+  for (const FinalizeNode &N : Nodes) {
+    SyntheticSection *SS = N.Sec;
+    if (!SS || !SS->getParent() || SS->empty())
+      continue;
+
+    size_t W = 0;
+    for (SyntheticSection *Dep : N.Deps) {
+      auto It = WaveOf.find(Dep);
+      if (It != WaveOf.end())
+        W = std::max(W, It->second + 1);
+    }
+    WaveOf[SS] = W;
+    if (Waves.size() <= W)
+      Waves.resize(W + 1);
+
+    std::vector<Task> &Tasks = Waves[W];
+    auto It = llvm::find_if(Tasks, [&](const Task &T) {
+      return T[0]->getParent() == SS->getParent();
+    });
+    if (It == Tasks.end())
+      Tasks.push_back({SS});
+    else
+      It->push_back(SS);
+  }
+
+  for (std::vector<Task> &Tasks : Waves)
+    parallelForEach(Tasks, [](const Task &T) {
+      for (SyntheticSection *SS : T)
+        SS->finalizeContents();
+    });
+}
+
 // In order to allow users to manipulate linker-synthesized sections,
 // we had to add synthetic sections to the input section list early,
 // even before we make decisions whether they are needed. This allows
@@ -1578,13 +1745,17 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   applySynthetic({InX::EhFrame},
                  [](SyntheticSection *SS) { SS->finalizeContents(); });
 
-  for (Symbol *S : Symtab->getSymbols())
+  parallelForEach(Symtab->getSymbols(), [](Symbol *S) {
     S->IsPreemptible |= computeIsPreemptible(*S);
+  });
 
   // Scan relocations. This must be done after every symbol is declared so that
   // we can correctly decide if a dynamic relocation is needed.
-  if (!Config->Relocatable)
-    forEachRelSec(scanRelocations<ELFT>);
+  if (!Config->Relocatable) {
+    std::vector<InputSectionBase *> Sections;
+    forEachRelSec([&](InputSectionBase &S) { Sections.push_back(&S); });
+    scanRelocations<ELFT>(Sections);
+  }
 
   if (InX::Plt && !InX::Plt->empty())
     InX::Plt->addSymbols();
@@ -1593,18 +1764,35 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
 
   // Now that we have defined all possible global symbols including linker-
   // synthesized ones. Visit all symbols to give the finishing touches.
-  for (Symbol *Sym : Symtab->getSymbols()) {
+  // Deciding where each symbol goes reads the symbol and its section, which
+  // is mostly cache misses, so that is done in parallel in a single pass.
+  // The symbols are then added in symbol table order.
+  enum : uint8_t { InSymtab = 1, InDynsym = 2, InVerNeed = 4 };
+  ArrayRef<Symbol *> Syms = Symtab->getSymbols();
+  std::vector<uint8_t> Where(Syms.size());
+  parallelForEachN(0, Syms.size(), [&](size_t I) {
+    Symbol *Sym = Syms[I];
     if (!includeInSymtab(*Sym))
-      continue;
-    if (InX::SymTab)
-      InX::SymTab->addSymbol(Sym);
-
+      return;
+    uint8_t W = InSymtab;
     if (InX::DynSymTab && Sym->includeInDynsym()) {
-      InX::DynSymTab->addSymbol(Sym);
+      W |= InDynsym;
       if (auto *File = dyn_cast_or_null<SharedFile<ELFT>>(Sym->File))
         if (File->IsNeeded && !Sym->isUndefined())
-          In<ELFT>::VerNeed->addSymbol(Sym);
+          W |= InVerNeed;
     }
+    Where[I] = W;
+  });
+
+  for (size_t I = 0, E = Syms.size(); I != E; ++I) {
+    if (!Where[I])
+      continue;
+    if (InX::SymTab)
+      InX::SymTab->addSymbol(Syms[I]);
+    if (Where[I] & InDynsym)
+      InX::DynSymTab->addSymbol(Syms[I]);
+    if (Where[I] & InVerNeed)
+      In<ELFT>::VerNeed->addSymbol(Syms[I]);
   }
 
   // Do not proceed if there was an undefined symbol.
@@ -1655,16 +1843,30 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   // have the headers, we can find out which sections they point to.
   setReservedSymbolSections();
 
-  // Dynamic section must be the last one in this list and dynamic
-  // symbol table section (DynSymTab) must be the first one.
-  applySynthetic(
-      {InX::DynSymTab,   InX::Bss,          InX::BssRelRo, InX::GnuHashTab,
-       InX::HashTab,     InX::SymTab,       InX::ShStrTab, InX::StrTab,
-       In<ELFT>::VerDef, InX::DynStrTab,    InX::Got,      InX::MipsGot,
-       InX::IgotPlt,     InX::GotPlt,       InX::RelaDyn,  InX::RelaIplt,
-       InX::RelaPlt,     InX::Plt,          InX::Iplt,     InX::EhFrameHdr,
-       In<ELFT>::VerSym, In<ELFT>::VerNeed, InX::Dynamic},
-      [](SyntheticSection *SS) { SS->finalizeContents(); });
+  // .dynsym sorts its symbols for .gnu.hash and assigns their dynsym
+  // indices, so it goes before the hash tables and .gnu.version. .gnu.version_d
+  // and .dynamic add strings to .dynstr, and .dynamic refers to the sizes of
+  // almost every other section, so it is finalized after all of them. The
+  // rest do not depend on each other.
+  std::vector<SyntheticSection *> Independent = {
+      InX::DynSymTab,  InX::Bss,       InX::BssRelRo,     InX::SymTab,
+      InX::ShStrTab,   InX::StrTab,    In<ELFT>::VerDef,  InX::DynStrTab,
+      InX::Got,        InX::MipsGot,   InX::IgotPlt,      InX::GotPlt,
+      InX::RelaDyn,    InX::RelaIplt,  InX::RelaPlt,      InX::Plt,
+      InX::Iplt,       InX::EhFrameHdr, In<ELFT>::VerNeed};
+
+  std::vector<FinalizeNode> Nodes;
+  for (SyntheticSection *SS : Independent)
+    Nodes.push_back({SS, {}});
+  Nodes.push_back({InX::GnuHashTab, {InX::DynSymTab}});
+  Nodes.push_back({InX::HashTab, {InX::DynSymTab}});
+  Nodes.push_back({In<ELFT>::VerSym, {InX::DynSymTab}});
+
+  std::vector<SyntheticSection *> All;
+  for (const FinalizeNode &N : Nodes)
+    All.push_back(N.Sec);
+  Nodes.push_back({InX::Dynamic, All});
+  finalizeSynthetic(Nodes);
 
   if (!Script->HasSectionsCommand && !Config->Relocatable)
     fixSectionAlignments();
@@ -1678,7 +1880,8 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   // for jump instructions that is the linker's responsibility for creating
   // range extension thunks for. As the generation of the content may also
   // alter InputSection addresses we must converge to a fixed point.
-  if (Target->NeedsThunks || Config->AndroidPackDynRelocs) {
+  if (Target->NeedsThunks || Config->AndroidPackDynRelocs ||
+      Config->RelrPackDynRelocs) {
     ThunkCreator TC;
     AArch64Err843419Patcher A64P;
     bool Changed;
@@ -1695,6 +1898,8 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
       if (InX::MipsGot)
         InX::MipsGot->updateAllocSize();
       Changed |= InX::RelaDyn->updateAllocSize();
+      if (InX::RelrDyn)
+        Changed |= InX::RelrDyn->updateAllocSize();
     } while (Changed);
   }
 
@@ -1775,11 +1980,11 @@ static bool needsPtLoad(OutputSection *Sec) {
 // Linker scripts are responsible for aligning addresses. Unfortunately, most
 // linker scripts are designed for creating two PT_LOADs only, one RX and one
 // RW. This means that there is no alignment in the RO to RX transition and we
-// cannot create a PT_LOAD there.
+// cannot create a PT_LOAD there. -z compact-segments asks for the same.
 static uint64_t computeFlags(uint64_t Flags) {
   if (Config->Omagic)
     return PF_R | PF_W | PF_X;
-  if (Config->SingleRoRx && !(Flags & PF_W))
+  if ((Config->SingleRoRx || Config->ZCompactSegments) && !(Flags & PF_W))
     return Flags | PF_X;
   return Flags;
 }
@@ -1821,9 +2026,15 @@ template <class ELFT> std::vector<PhdrEntry *> Writer<ELFT>::createPhdrs() {
     // script command. At the same time, we don't want to create a separate
     // load segment for the headers, even if the first output section has
     // an AT attribute.
+    // With -z hugepage-text, executable sections also get their own segment
+    // even if they would share one with read-only data (-no-rosegment).
     uint64_t NewFlags = computeFlags(Sec->getPhdrFlags());
+    bool NewText = Config->ZHugepageText &&
+                   (Sec->Flags & SHF_EXECINSTR) !=
+                       (Load->LastSec->Flags & SHF_EXECINSTR);
     if ((Sec->LMAExpr && Load->LastSec != Out::ProgramHeaders) ||
-        Sec->MemRegion != Load->FirstSec->MemRegion || Flags != NewFlags) {
+        Sec->MemRegion != Load->FirstSec->MemRegion || Flags != NewFlags ||
+        NewText) {
 
       Load = AddHdr(PT_LOAD, NewFlags);
       Flags = NewFlags;
@@ -1931,6 +2142,32 @@ void Writer<ELFT>::addPtArmExid(std::vector<PhdrEntry *> &Phdrs) {
 // first section after PT_GNU_RELRO have to be page aligned so that the dynamic
 // linker can set the permissions.
 template <class ELFT> void Writer<ELFT>::fixSectionAlignments() {
+  // With -z hugepage-text, executable segments start and end on 2 MiB
+  // boundaries so that they can be remapped onto huge pages at runtime. The
+  // start is aligned in the file too because loaders require p_offset and
+  // p_vaddr to be congruent modulo p_align, but the end is only aligned in
+  // memory so that no file space is wasted after the text.
+  if (Config->ZHugepageText) {
+    const uint64_t HugePageSize = 2 * 1024 * 1024;
+    for (PhdrEntry *P : Phdrs) {
+      if (P->p_type != PT_LOAD || !P->FirstSec ||
+          !(P->FirstSec->Flags & SHF_EXECINSTR))
+        continue;
+      P->FirstSec->Alignment =
+          std::max<uint32_t>(P->FirstSec->Alignment, HugePageSize);
+      P->p_align = std::max<uint64_t>(P->p_align, HugePageSize);
+
+      auto I = llvm::find(OutputSections, P->LastSec);
+      if (I == OutputSections.end() || I + 1 == OutputSections.end())
+        continue;
+      OutputSection *Next = *(I + 1);
+      if (needsPtLoad(Next) && !Next->AddrExpr)
+        Next->AddrExpr = [=] {
+          return alignTo(Script->getDot(), HugePageSize);
+        };
+    }
+  }
+
   auto PageAlign = [](OutputSection *Cmd) {
     if (Cmd && !Cmd->AddrExpr)
       Cmd->AddrExpr = [=] {
@@ -1938,9 +2175,27 @@ template <class ELFT> void Writer<ELFT>::fixSectionAlignments() {
       };
   };
 
-  for (const PhdrEntry *P : Phdrs)
-    if (P->p_type == PT_LOAD && P->FirstSec)
+  // With -z compact-segments, a PT_LOAD starts on the page after the end of
+  // the previous one, but at the same offset within the page, so that it
+  // follows the previous one in the file without padding. The last file
+  // page of one segment is then mapped twice, once with the permissions of
+  // each.
+  auto CompactAlign = [](OutputSection *Cmd) {
+    if (Cmd && !Cmd->AddrExpr)
+      Cmd->AddrExpr = [=] {
+        uint64_t Dot = Script->getDot();
+        return alignTo(Dot, Config->MaxPageSize) + Dot % Config->MaxPageSize;
+      };
+  };
+
+  for (const PhdrEntry *P : Phdrs) {
+    if (P->p_type != PT_LOAD || !P->FirstSec)
+      continue;
+    if (Config->ZCompactSegments)
+      CompactAlign(P->FirstSec);
+    else
       PageAlign(P->FirstSec);
+  }
 
   for (const PhdrEntry *P : Phdrs) {
     if (P->p_type != PT_GNU_RELRO)
@@ -2022,15 +2277,47 @@ template <class ELFT> void Writer<ELFT>::assignFileOffsets() {
     if (P->p_type == PT_LOAD && (P->p_flags & PF_X))
       LastRX = P;
 
+  // For --print-stats, -z compact-segments estimates the padding that the
+  // default layout would have added: a page-aligned file offset for each
+  // PT_LOAD and for each switch between read-only data and code, and the
+  // alignment after the last executable segment.
+  uint64_t Saved = 0;
+  bool PrevExec = false;
+
   for (OutputSection *Sec : OutputSections) {
+    uint64_t Start = Off;
     Off = setOffset(Sec, Off);
+
+    if (Config->ZCompactSegments && Sec->PtLoad) {
+      bool Exec = Sec->Flags & SHF_EXECINSTR;
+      bool NewRoSegment = !Config->SingleRoRx && !(Sec->Flags & SHF_WRITE) &&
+                          Exec != PrevExec;
+      uint64_t Aligned = alignTo(Start, Config->MaxPageSize);
+      if ((Sec == Sec->PtLoad->FirstSec || NewRoSegment) &&
+          Aligned > Sec->Offset)
+        Saved += Aligned - Sec->Offset;
+      PrevExec = Exec;
+    }
+
     if (Script->HasSectionsCommand)
       continue;
     // If this is a last section of the last executable segment and that
     // segment is the last loadable segment, align the offset of the
     // following section to avoid loading non-segments parts of the file.
-    if (LastRX && LastRX->LastSec == Sec)
-      Off = alignTo(Off, Target->PageSize);
+    // -z compact-segments lets the next segment map the rest of the page.
+    if (LastRX && LastRX->LastSec == Sec) {
+      uint64_t Aligned = alignTo(Off, Target->PageSize);
+      if (Config->ZCompactSegments)
+        Saved += Aligned - Off;
+      else
+        Off = Aligned;
+    }
+  }
+
+  if (Config->ZCompactSegments) {
+    Stats->SegmentPaddingSaved = Saved;
+    Stats->LoadSegments = llvm::count_if(
+        Phdrs, [](PhdrEntry *P) { return P->p_type == PT_LOAD; });
   }
 
   SectionHeaderOff = alignTo(Off, Config->Wordsize);
@@ -2174,6 +2461,32 @@ template <class ELFT> void Writer<ELFT>::checkSections() {
   checkOverlap("load address", LMAs);
 }
 
+// Estimates how many pages the loader dirties when it applies the dynamic
+// relocations, for --print-stats. Every page that contains the place of a
+// dynamic relocation is counted, out of the pages of writable segments that
+// are backed by the file.
+template <class ELFT> void Writer<ELFT>::countDirtyPages() {
+  uint64_t PageSize = Target->PageSize;
+  std::vector<uint64_t> Pages;
+  for (RelocationBaseSection *Sec : {InX::RelaDyn, InX::RelaPlt, InX::RelaIplt})
+    if (Sec)
+      for (const DynamicReloc &Rel : Sec->getRelocs())
+        Pages.push_back(Rel.getOffset() / PageSize);
+  if (InX::RelrDyn)
+    for (const RelativeReloc &Rel : InX::RelrDyn->Relocs)
+      Pages.push_back(Rel.getOffset() / PageSize);
+  llvm::sort(Pages.begin(), Pages.end());
+  Stats->DirtyPages = std::unique(Pages.begin(), Pages.end()) - Pages.begin();
+
+  uint64_t Writable = 0;
+  for (PhdrEntry *P : Phdrs)
+    if (P->p_type == PT_LOAD && (P->p_flags & PF_W) && P->p_filesz)
+      Writable += (alignTo(P->p_vaddr + P->p_filesz, PageSize) -
+                   alignDown(P->p_vaddr, PageSize)) /
+                  PageSize;
+  Stats->WritablePages = Writable;
+}
+
 // The entry point address is chosen in the following ways.
 //
 // 1. the '-e' entry command-line option;
@@ -2224,7 +2537,23 @@ static uint8_t getAbiVersion() {
 }
 
 template <class ELFT> void Writer<ELFT>::writeHeader() {
-  uint8_t *Buf = Buffer->getBufferStart();
+  if (!Stream) {
+    uint8_t *Buf = Buffer->getBufferStart();
+    writeHeaderTo(Buf, Buf + SectionHeaderOff);
+    return;
+  }
+
+  std::vector<uint8_t> Hdr(sizeof(Elf_Ehdr) + Phdrs.size() * sizeof(Elf_Phdr));
+  std::vector<uint8_t> SHdr((OutputSections.size() + 1) * sizeof(Elf_Shdr));
+  writeHeaderTo(Hdr.data(), SHdr.data());
+  Stream->write(0, Hdr);
+  Stream->write(SectionHeaderOff, SHdr);
+}
+
+// Writes the ELF header and the program header table to Buf and the section
+// header table to SHdrBuf.
+template <class ELFT>
+void Writer<ELFT>::writeHeaderTo(uint8_t *Buf, uint8_t *SHdrBuf) {
   // For executable segments, the trap instructions are written before writing
   // the header. Setting Elf header bytes to zero ensures that any unused bytes
   // in header are zero-cleared, instead of having trap instructions.
@@ -2270,7 +2599,7 @@ template <class ELFT> void Writer<ELFT>::writeHeader() {
   }
 
   // Write the section header table. Note that the first table entry is null.
-  auto *SHdrs = reinterpret_cast<Elf_Shdr *>(Buf + EHdr->e_shoff);
+  auto *SHdrs = reinterpret_cast<Elf_Shdr *>(SHdrBuf);
   for (OutputSection *Sec : OutputSections)
     Sec->writeHeaderTo<ELFT>(++SHdrs);
 }
@@ -2281,11 +2610,57 @@ template <class ELFT> void Writer<ELFT>::openFile() {
     error("output file too large: " + Twine(FileSize) + " bytes");
     return;
   }
+  OutputBufferBytes = FileSize;
 
-  unlinkAsync(Config->OutputFile);
   unsigned Flags = 0;
   if (!Config->Relocatable)
     Flags = FileOutputBuffer::F_executable;
+
+  // The existing file is compared with the new one, so keep it around.
+  if (Config->WriteInPlace) {
+    Expected<std::unique_ptr<InPlaceOutputBuffer>> BufferOrErr =
+        InPlaceOutputBuffer::create(Config->OutputFile, FileSize, Flags);
+    if (!BufferOrErr)
+      error("failed to open " + Config->OutputFile + ": " +
+            llvm::toString(BufferOrErr.takeError()));
+    else
+      Buffer = std::move(*BufferOrErr);
+    return;
+  }
+
+  unlinkAsync(Config->OutputFile);
+
+  // Writing to the standard output needs an in-memory buffer anyway.
+  if (!Config->MmapOutput && Config->OutputFile != "-") {
+    Expected<std::unique_ptr<StreamOutputBuffer>> StreamOrErr =
+        StreamOutputBuffer::create(Config->OutputFile, FileSize, Flags);
+    if (!StreamOrErr) {
+      error("failed to open " + Config->OutputFile + ": " +
+            llvm::toString(StreamOrErr.takeError()));
+      return;
+    }
+    Stream = StreamOrErr->get();
+    Buffer = std::move(*StreamOrErr);
+    return;
+  }
+
+  // FileOutputBuffer writes special files such as /dev/null through an
+  // in-memory buffer, which needs no mapping.
+  sys::fs::file_status St;
+  sys::fs::status(Config->OutputFile, St);
+  if (Config->OutputFile != "-" &&
+      (!sys::fs::exists(St) || sys::fs::is_regular_file(St))) {
+    Expected<std::unique_ptr<MappedOutputBuffer>> MappedOrErr =
+        MappedOutputBuffer::create(Config->OutputFile, FileSize, Flags,
+                                   Config->PrefaultOutput);
+    if (!MappedOrErr)
+      error("failed to open " + Config->OutputFile + ": " +
+            llvm::toString(MappedOrErr.takeError()));
+    else
+      Buffer = std::move(*MappedOrErr);
+    return;
+  }
+
   Expected<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
       FileOutputBuffer::create(Config->OutputFile, FileSize, Flags);
 
@@ -2296,11 +2671,86 @@ template <class ELFT> void Writer<ELFT>::openFile() {
     Buffer = std::move(*BufferOrErr);
 }
 
+// With --no-mmap-output, large input sections whose contents are written
+// verbatim are copied by the kernel from the input file to the output file,
+// so that they never pass through our memory. That needs the offsets of the
+// section in both files to be block-aligned, which is the case for sections
+// such as embedded blobs that are aligned to a page. Returns such sections
+// of Sec in output order, marked so that OutputSection::writeTo skips them.
+static std::vector<InputSection *> getFileCopies(OutputSection *Sec) {
+  const uint64_t BlockSize = 4096;
+  std::vector<InputSection *> Ret;
+
+  for (InputSection *IS : getInputSections(Sec)) {
+    if (IS->kind() != SectionBase::Regular || IS->Type == SHT_NOBITS ||
+        IS->Type == SHT_REL || IS->Type == SHT_RELA || IS->Type == SHT_GROUP)
+      continue;
+    // Sections that need relocating, and the compressed contents of debug
+    // sections, are not copies of the input.
+    if (!IS->Relocations.empty() || IS->NumRelocations || IS->isCompressed())
+      continue;
+    if (IS->Data.size() < 16 * BlockSize ||
+        (Sec->Offset + IS->OutSecOff) % BlockSize)
+      continue;
+    Optional<std::pair<StringRef, uint64_t>> In =
+        getMappedFileOffset(IS->Data);
+    if (!In || In->second % BlockSize)
+      continue;
+    IS->CopiedByWriter = true;
+    Ret.push_back(IS);
+  }
+  return Ret;
+}
+
+// Writes a section to the output. With --no-mmap-output, the section is
+// rendered into a zero-initialized temporary buffer that is freed as soon
+// as it has been written, unless a later step still needs its contents.
+template <class ELFT> void Writer<ELFT>::writeSection(OutputSection *Sec) {
+  if (!Stream) {
+    Sec->writeTo<ELFT>(Buffer->getBufferStart() + Sec->Offset);
+    return;
+  }
+  if (Sec->Type == SHT_NOBITS)
+    return;
+
+  // .eh_frame_hdr reads the contents of .eh_frame, and the build ID is
+  // filled in after the whole file has been written.
+  bool Keep = (InX::EhFrameHdr && InX::EhFrame->getParent() == Sec) ||
+              (InX::BuildId && InX::BuildId->getParent() == Sec);
+
+  std::vector<InputSection *> Copies;
+  if (!Keep && !Sec->isCompressed())
+    Copies = getFileCopies(Sec);
+
+  std::vector<uint8_t> Buf(Sec->Size);
+  Sec->writeTo<ELFT>(Buf.data());
+
+  // Write everything but the sections that are copied from their files.
+  uint64_t Pos = 0;
+  for (InputSection *IS : Copies) {
+    Stream->write(Sec->Offset + Pos,
+                  makeArrayRef(Buf.data() + Pos, IS->OutSecOff - Pos));
+    Pos = IS->OutSecOff + IS->getSize();
+  }
+  Stream->write(Sec->Offset + Pos,
+                makeArrayRef(Buf.data() + Pos, Buf.size() - Pos));
+
+  for (InputSection *IS : Copies) {
+    std::pair<StringRef, uint64_t> In = *getMappedFileOffset(IS->Data);
+    uint64_t Off = Sec->Offset + IS->OutSecOff;
+    uint64_t Done = Stream->copyFrom(Off, In.first, In.second, IS->Data.size());
+    Stream->write(Off + Done, IS->Data.slice(Done));
+    IS->CopiedByWriter = false;
+  }
+
+  if (Keep)
+    KeptSections[Sec] = std::move(Buf);
+}
+
 template <class ELFT> void Writer<ELFT>::writeSectionsBinary() {
-  uint8_t *Buf = Buffer->getBufferStart();
   for (OutputSection *Sec : OutputSections)
     if (Sec->Flags & SHF_ALLOC)
-      Sec->writeTo<ELFT>(Buf + Sec->Offset);
+      writeSection(Sec);
 }
 
 static void fillTrap(uint8_t *I, uint8_t *End) {
@@ -2319,11 +2769,20 @@ template <class ELFT> void Writer<ELFT>::writeTrapInstr() {
     return;
 
   // Fill the last page.
-  uint8_t *Buf = Buffer->getBufferStart();
-  for (PhdrEntry *P : Phdrs)
-    if (P->p_type == PT_LOAD && (P->p_flags & PF_X))
-      fillTrap(Buf + alignDown(P->p_offset + P->p_filesz, Target->PageSize),
-               Buf + alignTo(P->p_offset + P->p_filesz, Target->PageSize));
+  for (PhdrEntry *P : Phdrs) {
+    if (P->p_type != PT_LOAD || !(P->p_flags & PF_X))
+      continue;
+    uint64_t Begin = alignDown(P->p_offset + P->p_filesz, Target->PageSize);
+    uint64_t End = alignTo(P->p_offset + P->p_filesz, Target->PageSize);
+    if (Stream) {
+      std::vector<uint8_t> Page(End - Begin);
+      fillTrap(Page.data(), Page.data() + Page.size());
+      Stream->write(Begin, Page);
+    } else {
+      uint8_t *Buf = Buffer->getBufferStart();
+      fillTrap(Buf + Begin, Buf + End);
+    }
+  }
 
   // Round up the file size of the last segment to the page boundary iff it is
   // an executable segment to ensure that other tools don't accidentally
@@ -2337,10 +2796,8 @@ template <class ELFT> void Writer<ELFT>::writeTrapInstr() {
     Last->p_memsz = Last->p_filesz = alignTo(Last->p_filesz, Target->PageSize);
 }
 
-// Write section contents to a mmap'ed file.
+// Write section contents to the output file.
 template <class ELFT> void Writer<ELFT>::writeSections() {
-  uint8_t *Buf = Buffer->getBufferStart();
-
   OutputSection *EhFrameHdr = nullptr;
   if (InX::EhFrameHdr && !InX::EhFrameHdr->empty())
     EhFrameHdr = InX::EhFrameHdr->getParent();
@@ -2348,18 +2805,81 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
   // In -r or -emit-relocs mode, write the relocation sections first as in
   // ELf_Rel targets we might find out that we need to modify the relocated
   // section while doing it.
+  std::vector<OutputSection *> Order;
   for (OutputSection *Sec : OutputSections)
     if (Sec->Type == SHT_REL || Sec->Type == SHT_RELA)
-      Sec->writeTo<ELFT>(Buf + Sec->Offset);
+      Order.push_back(Sec);
 
   for (OutputSection *Sec : OutputSections)
     if (Sec != EhFrameHdr && Sec->Type != SHT_REL && Sec->Type != SHT_RELA)
-      Sec->writeTo<ELFT>(Buf + Sec->Offset);
+      Order.push_back(Sec);
 
   // The .eh_frame_hdr depends on .eh_frame section contents, therefore
   // it should be written after .eh_frame is written.
   if (EhFrameHdr)
-    EhFrameHdr->writeTo<ELFT>(Buf + EhFrameHdr->Offset);
+    Order.push_back(EhFrameHdr);
+
+  // With --reduce-memory-overheads, find the last output section written
+  // that reads from each object file so that the file can be released right
+  // after it. .gdb_index refers to the debug sections of all files.
+  DenseMap<OutputSection *, std::vector<ObjFile<ELFT> *>> LastUses;
+  if (Config->ReduceMemoryOverheads) {
+    DenseMap<OutputSection *, size_t> Pos;
+    for (size_t I = 0, E = Order.size(); I != E; ++I)
+      Pos[Order[I]] = I;
+
+    DenseMap<InputFile *, size_t> LastPos;
+    for (InputSectionBase *S : InputSections) {
+      if (!S->Live || !S->File || !isa<ObjFile<ELFT>>(S->File))
+        continue;
+      if (OutputSection *OS = S->getOutputSection()) {
+        size_t &P = LastPos[S->File];
+        P = std::max(P, Pos.lookup(OS));
+      }
+    }
+    if (InX::GdbIndex && InX::GdbIndex->getParent())
+      for (InputFile *F : ObjectFiles)
+        LastPos[F] = std::max(LastPos[F], Pos[InX::GdbIndex->getParent()]);
+
+    for (InputFile *F : ObjectFiles) {
+      auto It = LastPos.find(F);
+      if (It != LastPos.end())
+        LastUses[Order[It->second]].push_back(cast<ObjFile<ELFT>>(F));
+    }
+  }
+
+  // With -r, sections are not combined by name prefix, so there are many
+  // output sections with few input sections each, and writing them one at
+  // a time leaves most threads idle. Once the relocation sections have been
+  // written, the sections are independent of each other, so they are then
+  // written in parallel. The output buffer has to be mapped for this.
+  if (Config->Relocatable && !Stream && !Config->ReduceMemoryOverheads) {
+    size_t NumRels = llvm::count_if(Order, [](OutputSection *Sec) {
+      return Sec->Type == SHT_REL || Sec->Type == SHT_RELA;
+    });
+    size_t NumRest = Order.size() - NumRels - (EhFrameHdr ? 1 : 0);
+    ArrayRef<OutputSection *> V = Order;
+    parallelForEach(V.slice(0, NumRels),
+                    [&](OutputSection *Sec) { writeSection(Sec); });
+    parallelForEach(V.slice(NumRels, NumRest),
+                    [&](OutputSection *Sec) { writeSection(Sec); });
+    if (EhFrameHdr)
+      writeSection(EhFrameHdr);
+    return;
+  }
+
+  for (OutputSection *Sec : Order) {
+    writeSection(Sec);
+    if (!Config->ReduceMemoryOverheads)
+      continue;
+    for (InputSection *IS : getInputSections(Sec))
+      std::vector<Relocation>().swap(IS->Relocations);
+    for (ObjFile<ELFT> *F : LastUses.lookup(Sec))
+      F->releaseContents();
+  }
+
+  if (EhFrameHdr && Stream)
+    KeptSections.erase(InX::EhFrame->getParent());
 }
 
 template <class ELFT> void Writer<ELFT>::writeBuildId() {
@@ -2367,9 +2887,26 @@ template <class ELFT> void Writer<ELFT>::writeBuildId() {
     return;
 
   // Compute a hash of all sections of the output file.
-  uint8_t *Start = Buffer->getBufferStart();
-  uint8_t *End = Start + FileSize;
-  InX::BuildId->writeBuildId({Start, End});
+  if (!Stream) {
+    uint8_t *Start = Buffer->getBufferStart();
+    uint8_t *End = Start + FileSize;
+    InX::BuildId->writeBuildId({Start, End});
+    return;
+  }
+
+  // With --no-mmap-output, hash what has been written to the file and then
+  // write the section again with the build ID filled in.
+  Expected<std::unique_ptr<MemoryBuffer>> MBOrErr = Stream->getContents();
+  if (!MBOrErr) {
+    error("failed to read the output file: " +
+          llvm::toString(MBOrErr.takeError()));
+    return;
+  }
+  StringRef Contents = (*MBOrErr)->getBuffer();
+  InX::BuildId->writeBuildId(
+      {reinterpret_cast<const uint8_t *>(Contents.data()), Contents.size()});
+  OutputSection *Sec = InX::BuildId->getParent();
+  Stream->write(Sec->Offset, KeptSections[Sec]);
 }
 
 template void elf::writeResult<ELF32LE>();
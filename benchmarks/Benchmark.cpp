@@ -0,0 +1,236 @@
+//===- Benchmark.cpp ------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+using namespace lld;
+using namespace lld::bench;
+
+static cl::opt<std::string>
+    Filter("benchmark_filter", cl::init(".*"),
+           cl::desc("Run only the benchmarks whose names match this regex"));
+
+static cl::opt<double>
+    MinTime("benchmark_min_time", cl::init(0.5),
+            cl::desc("Minimum number of seconds to run each benchmark"));
+
+static cl::opt<std::string>
+    Format("benchmark_format", cl::init("console"),
+           cl::desc("Output format: console or json"));
+
+static cl::opt<std::string>
+    OutFile("benchmark_out", cl::init("-"),
+            cl::desc("Write the results to this file"));
+
+static cl::opt<bool> NoThreads("no-threads",
+                               cl::desc("Run the kernels on one thread"));
+
+namespace {
+struct Benchmark {
+  std::string Name;
+  BenchmarkFn Fn;
+  uint64_t Arg;
+};
+
+struct Result {
+  std::string Name;
+  uint64_t Iterations;
+  double Wall;
+  double Cpu;
+  uint64_t Items;
+};
+} // namespace
+
+static std::vector<Benchmark> &getBenchmarks() {
+  static std::vector<Benchmark> Benchmarks;
+  return Benchmarks;
+}
+
+static std::chrono::duration<double> getCpuTime() {
+  sys::TimePoint<> Elapsed;
+  std::chrono::nanoseconds User, Sys;
+  sys::Process::GetTimeUsage(Elapsed, User, Sys);
+  return User + Sys;
+}
+
+void State::pauseTiming() {
+  Wall += std::chrono::steady_clock::now() - WallStart;
+  Cpu += getCpuTime() - CpuStart;
+}
+
+void State::resumeTiming() {
+  WallStart = std::chrono::steady_clock::now();
+  CpuStart = getCpuTime();
+}
+
+void State::skipWithError(StringRef Msg) {
+  errs() << "error: " << Msg << "\n";
+  Error = true;
+}
+
+void bench::registerBenchmark(StringRef Name, BenchmarkFn Fn,
+                              ArrayRef<uint64_t> Args) {
+  for (uint64_t Arg : Args)
+    getBenchmarks().push_back({(Name + "/" + Twine(Arg)).str(), Fn, Arg});
+}
+
+// Runs B with a growing number of iterations until one run takes at least
+// MinTime seconds, the way Google Benchmark does.
+static Result run(const Benchmark &B) {
+  uint64_t Iters = 1;
+  for (;;) {
+    State S(B.Arg, Iters);
+    B.Fn(S);
+    if (S.hasError())
+      return {B.Name, 0, 0, 0, 0};
+
+    double Wall = S.wallSeconds();
+    if (Wall >= MinTime || Iters >= 1000000000)
+      return {B.Name, S.iterations(), Wall, S.cpuSeconds(),
+              S.itemsProcessed()};
+
+    // Aim 40% past MinTime so that noise does not force another round, but
+    // grow by at most 10x because the first runs are mostly warm-up.
+    double Multiplier = Wall > 0 ? std::min(10.0, MinTime * 1.4 / Wall) : 10;
+    Iters = std::max<uint64_t>(Iters + 1, Iters * Multiplier);
+  }
+}
+
+static void printConsoleHeader(raw_ostream &OS) {
+  OS << format("%-48s %14s %14s %12s %14s\n", "Benchmark", "Time", "CPU",
+               "Iterations", "Items/s");
+}
+
+static void printConsoleRow(raw_ostream &OS, const Result &R) {
+  if (R.Iterations == 0) {
+    OS << format("%-48s %s\n", R.Name.c_str(), "ERROR");
+    return;
+  }
+  OS << format("%-48s %11.0f ns %11.0f ns %12llu", R.Name.c_str(),
+               R.Wall * 1e9 / R.Iterations, R.Cpu * 1e9 / R.Iterations,
+               (unsigned long long)R.Iterations);
+  if (R.Items)
+    OS << format(" %14.4g", R.Items / R.Wall);
+  OS << "\n";
+}
+
+static void printJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\';
+    OS << C;
+  }
+  OS << '"';
+}
+
+static void printJSON(raw_ostream &OS, ArrayRef<Result> Results,
+                      StringRef Argv0) {
+  char Date[64];
+  time_t Now = time(nullptr);
+  strftime(Date, sizeof(Date), "%Y-%m-%d %H:%M:%S", localtime(&Now));
+
+  OS << "{\n  \"context\": {\n    \"date\": ";
+  printJSONString(OS, Date);
+  OS << ",\n    \"executable\": ";
+  printJSONString(OS, Argv0);
+  OS << ",\n    \"num_cpus\": " << std::thread::hardware_concurrency();
+  OS << ",\n    \"num_threads\": " << getThreadCount();
+#ifdef NDEBUG
+  OS << ",\n    \"library_build_type\": \"release\"";
+#else
+  OS << ",\n    \"library_build_type\": \"debug\"";
+#endif
+  OS << "\n  },\n  \"benchmarks\": [";
+
+  bool First = true;
+  for (const Result &R : Results) {
+    OS << (First ? "\n" : ",\n") << "    {\n      \"name\": ";
+    First = false;
+    printJSONString(OS, R.Name);
+    if (R.Iterations == 0) {
+      OS << ",\n      \"error_occurred\": true\n    }";
+      continue;
+    }
+    OS << ",\n      \"iterations\": " << R.Iterations;
+    OS << ",\n      \"real_time\": "
+       << format("%.6g", R.Wall * 1e9 / R.Iterations);
+    OS << ",\n      \"cpu_time\": "
+       << format("%.6g", R.Cpu * 1e9 / R.Iterations);
+    OS << ",\n      \"time_unit\": \"ns\"";
+    if (R.Items)
+      OS << ",\n      \"items_per_second\": "
+         << format("%.6g", R.Items / R.Wall);
+    OS << "\n    }";
+  }
+  OS << "\n  ]\n}\n";
+}
+
+int bench::runBenchmarks(int Argc, const char **Argv) {
+  cl::ParseCommandLineOptions(Argc, Argv, "lld microbenchmarks\n");
+
+  if (Format != "console" && Format != "json") {
+    errs() << "error: unknown --benchmark_format: " << Format << "\n";
+    return 1;
+  }
+
+  Regex Re(Filter);
+  std::string Err;
+  if (!Re.isValid(Err)) {
+    errs() << "error: invalid --benchmark_filter: " << Err << "\n";
+    return 1;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(OutFile, EC, sys::fs::F_None);
+  if (EC) {
+    errs() << "error: cannot open " << OutFile << ": " << EC.message() << "\n";
+    return 1;
+  }
+
+  if (NoThreads)
+    ThreadsEnabled = false;
+
+  // The console format is printed as the results come in, the JSON
+  // format once at the end.
+  bool IsJSON = Format == "json";
+  if (!IsJSON)
+    printConsoleHeader(OS);
+
+  std::vector<Result> Results;
+  bool Failed = false;
+  for (const Benchmark &B : getBenchmarks()) {
+    if (!Re.match(B.Name))
+      continue;
+    Results.push_back(run(B));
+    Failed |= Results.back().Iterations == 0;
+    if (!IsJSON) {
+      printConsoleRow(OS, Results.back());
+      OS.flush();
+    }
+  }
+
+  if (IsJSON)
+    printJSON(OS, Results, Argv[0]);
+  return Failed;
+}
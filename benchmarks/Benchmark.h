@@ -0,0 +1,102 @@
+//===- Benchmark.h ------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A small harness for microbenchmarks of linker internals. A benchmark is a
+// function that runs its kernel once per iteration of a keepRunning() loop,
+// and is registered with a list of workload sizes, each of which becomes a
+// separate benchmark named "<name>/<size>". The harness picks an iteration
+// count so that each benchmark runs for at least --benchmark_min_time
+// seconds and prints a table or, with --benchmark_format=json, the same
+// JSON that Google Benchmark writes, so that existing tooling can compare
+// the results of two runs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_BENCHMARKS_BENCHMARK_H
+#define LLD_BENCHMARKS_BENCHMARK_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace lld {
+namespace bench {
+
+class State {
+public:
+  State(uint64_t Arg, uint64_t MaxIterations)
+      : Arg(Arg), MaxIterations(MaxIterations) {}
+
+  // Returns true while the kernel should run again. The clock starts at the
+  // first call and stops once the iteration count is reached, so set-up
+  // before the loop is not measured.
+  bool keepRunning() {
+    if (!Started) {
+      Started = true;
+      resumeTiming();
+      return true;
+    }
+    if (++Iterations < MaxIterations)
+      return true;
+    pauseTiming();
+    return false;
+  }
+
+  // Excludes the work between the two calls from the measurement, e.g.
+  // rebuilding inputs that an iteration consumed.
+  void pauseTiming();
+  void resumeTiming();
+
+  // The workload size this benchmark was registered with.
+  uint64_t arg() const { return Arg; }
+
+  // The number of items (symbols, relocations, ...) processed in total, for
+  // the items_per_second column.
+  void setItemsProcessed(uint64_t N) { Items = N; }
+
+  void skipWithError(llvm::StringRef Msg);
+
+  uint64_t iterations() const { return Iterations; }
+  uint64_t itemsProcessed() const { return Items; }
+  double wallSeconds() const { return Wall.count(); }
+  double cpuSeconds() const { return Cpu.count(); }
+  bool hasError() const { return Error; }
+
+private:
+  typedef std::chrono::duration<double> Seconds;
+
+  uint64_t Arg;
+  uint64_t MaxIterations;
+  uint64_t Iterations = 0;
+  uint64_t Items = 0;
+  bool Started = false;
+  bool Error = false;
+
+  std::chrono::steady_clock::time_point WallStart;
+  Seconds CpuStart{0};
+  Seconds Wall{0};
+  Seconds Cpu{0};
+};
+
+typedef std::function<void(State &)> BenchmarkFn;
+
+// Registers Fn to be run once for each of Args.
+void registerBenchmark(llvm::StringRef Name, BenchmarkFn Fn,
+                       llvm::ArrayRef<uint64_t> Args);
+
+// Parses the command line and runs the registered benchmarks that match
+// --benchmark_filter. Returns the exit code of the program.
+int runBenchmarks(int Argc, const char **Argv);
+
+} // namespace bench
+} // namespace lld
+
+#endif
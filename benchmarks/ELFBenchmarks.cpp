@@ -0,0 +1,439 @@
+//===- ELFBenchmarks.cpp --------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Microbenchmarks for the hot kernels of the ELF linker. Each benchmark sets
+// up the linker globals the way a link would, builds a synthetic workload of
+// the size it is registered with and times one kernel on it, so that a
+// change to one of these paths can be measured in seconds rather than with
+// a full link.
+//
+//   $ ninja lld-elf-bench
+//   $ ./bin/lld-elf-bench --benchmark_filter=ICF --benchmark_format=json
+//
+//===----------------------------------------------------------------------===//
+
+#include "Benchmark.h"
+#include "Config.h"
+#include "ICF.h"
+#include "InputFiles.h"
+#include "InputSection.h"
+#include "OutputSections.h"
+#include "Stats.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "SyntheticSections.h"
+#include "Target.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
+#include "llvm/Object/ELF.h"
+#include "llvm/Support/InitLLVM.h"
+#include <random>
+
+using namespace llvm;
+using namespace llvm::ELF;
+using namespace llvm::object;
+using namespace lld;
+using namespace lld::bench;
+using namespace lld::elf;
+
+// Discards everything the previous iteration allocated and sets up the
+// globals the way linkOnce and setConfigs would for a link of the given
+// kind and machine.
+static void resetLinker(ELFKind Kind, uint16_t Machine) {
+  freeArena();
+  InputSections.clear();
+  SymAux.clear();
+  ObjectFiles.clear();
+
+  Config = make<Configuration>();
+  Symtab = make<SymbolTable>();
+  Stats = make<LinkStats>();
+
+  Config->EKind = Kind;
+  Config->EMachine = Machine;
+  Config->Is64 = (Kind == ELF64LEKind || Kind == ELF64BEKind);
+  Config->IsLE = (Kind == ELF32LEKind || Kind == ELF64LEKind);
+  Config->Endianness =
+      Config->IsLE ? support::endianness::little : support::endianness::big;
+  Config->Wordsize = Config->Is64 ? 8 : 4;
+  Config->IsRela = Config->Is64 || Machine == EM_X86_64 || Machine == EM_PPC;
+  Config->DefaultSymbolVersion = VER_NDX_GLOBAL;
+  Target = getTarget();
+}
+
+// Returns NumSyms distinct names that look like mangled C++ symbols, so
+// that they share long prefixes the way real names do.
+static std::vector<std::string> createNames(size_t NumSyms) {
+  std::mt19937 Rng(42);
+  std::vector<std::string> Names;
+  Names.reserve(NumSyms);
+  for (size_t I = 0; I < NumSyms; ++I)
+    Names.push_back("_ZN4llvm" + std::to_string(Rng() % 64) + "Namespace" +
+                    std::to_string(I) + "E");
+  return Names;
+}
+
+// Defines absolute symbols, which is all relocateAlloc and the hash table
+// need from them.
+static std::vector<Symbol *> createSymbols(ArrayRef<std::string> Names) {
+  std::vector<Symbol *> Syms;
+  Syms.reserve(Names.size());
+  for (size_t I = 0; I < Names.size(); ++I)
+    Syms.push_back(make<Defined>(nullptr, StringRef(Names[I]), STB_GLOBAL,
+                                 STV_DEFAULT, STT_FUNC, 0x300000 + I * 16, 0,
+                                 nullptr));
+  return Syms;
+}
+
+// SymbolTable::insert for NumSyms new names, i.e. the shard lookup and the
+// creation of a Symbol for each of them.
+static void benchSymtabInsert(State &S) {
+  std::vector<std::string> Names = createNames(S.arg());
+  std::vector<CachedHashStringRef> Keys(Names.begin(), Names.end());
+
+  while (S.keepRunning()) {
+    S.pauseTiming();
+    resetLinker(ELF64LEKind, EM_X86_64);
+    S.resumeTiming();
+
+    for (CachedHashStringRef Key : Keys)
+      Symtab->insert(Key);
+  }
+  S.setItemsProcessed(S.iterations() * Keys.size());
+}
+
+// GnuHashTableSection::addSymbols, which hashes the names and sorts the
+// symbols by bucket. finalizeContents and writeTo need the rest of the
+// dynamic sections, so they are not measured.
+static void benchGnuHash(State &S) {
+  resetLinker(ELF64LEKind, EM_X86_64);
+  std::vector<std::string> Names = createNames(S.arg());
+  std::vector<SymbolTableEntry> Entries;
+  size_t StrTabOffset = 1;
+  for (Symbol *Sym : createSymbols(Names)) {
+    Entries.push_back({Sym, StrTabOffset});
+    StrTabOffset += Sym->getName().size() + 1;
+  }
+
+  std::unique_ptr<GnuHashTableSection> Sec;
+  std::vector<SymbolTableEntry> V;
+  while (S.keepRunning()) {
+    S.pauseTiming();
+    Sec.reset(new GnuHashTableSection());
+    V = Entries;
+    S.resumeTiming();
+
+    Sec->addSymbols(V);
+  }
+  S.setItemsProcessed(S.iterations() * Entries.size());
+}
+
+// Returns SHF_MERGE|SHF_STRINGS section contents with NumStrings strings in
+// total, about a third of which are duplicates, split into sections of the
+// size a compiler typically emits.
+static std::vector<std::string> createStringSections(size_t NumStrings) {
+  std::mt19937 Rng(42);
+  std::vector<std::string> Sections;
+  for (size_t I = 0; I < NumStrings; ++I) {
+    if (I % 256 == 0)
+      Sections.emplace_back();
+    std::string &Data = Sections.back();
+    Data += "string literal number " + std::to_string(Rng() % NumStrings);
+    Data += '\0';
+  }
+  return Sections;
+}
+
+static std::vector<MergeInputSection *>
+createMergeSections(ArrayRef<std::string> Contents) {
+  std::vector<MergeInputSection *> Sections;
+  for (const std::string &Data : Contents) {
+    auto *Sec = make<MergeInputSection>(
+        SHF_ALLOC | SHF_MERGE | SHF_STRINGS, SHT_PROGBITS, 1,
+        makeArrayRef((const uint8_t *)Data.data(), Data.size()),
+        ".rodata.str1.1");
+    Sections.push_back(Sec);
+  }
+  return Sections;
+}
+
+// splitSections, which calls MergeInputSection::splitIntoPieces on each
+// mergeable section in parallel.
+static void benchSplitIntoPieces(State &S) {
+  resetLinker(ELF64LEKind, EM_X86_64);
+  std::vector<std::string> Contents = createStringSections(S.arg());
+  std::vector<MergeInputSection *> Sections = createMergeSections(Contents);
+  InputSections.assign(Sections.begin(), Sections.end());
+
+  while (S.keepRunning()) {
+    S.pauseTiming();
+    for (MergeInputSection *Sec : Sections)
+      std::vector<SectionPiece>().swap(Sec->Pieces);
+    S.resumeTiming();
+
+    splitSections<ELF64LE>();
+  }
+  S.setItemsProcessed(S.iterations() * S.arg());
+}
+
+// MergeNoTailSection::finalizeContents, which deduplicates the pieces of
+// all input sections in parallel shards.
+static void benchMergeNoTail(State &S) {
+  resetLinker(ELF64LEKind, EM_X86_64);
+  std::vector<std::string> Contents = createStringSections(S.arg());
+  std::vector<MergeInputSection *> Sections = createMergeSections(Contents);
+  for (MergeInputSection *Sec : Sections)
+    Sec->splitIntoPieces();
+
+  // Sections are replaced while the clock is stopped so that the previous
+  // one is not destroyed inside the measurement.
+  std::unique_ptr<MergeNoTailSection> Out;
+  while (S.keepRunning()) {
+    S.pauseTiming();
+    Out.reset(new MergeNoTailSection(".rodata.str1.1", SHT_PROGBITS,
+                                     SHF_ALLOC | SHF_MERGE | SHF_STRINGS, 1));
+    for (MergeInputSection *Sec : Sections)
+      Out->addSection(Sec);
+    S.resumeTiming();
+
+    Out->finalizeContents();
+  }
+  S.setItemsProcessed(S.iterations() * S.arg());
+}
+
+namespace {
+struct RelocKind {
+  RelExpr Expr;
+  RelType Type;
+  int64_t Addend;
+};
+
+struct RelocTarget {
+  const char *Name;
+  ELFKind Kind;
+  uint16_t Machine;
+  // Relocations are spread evenly over these two kinds, a PC-relative call
+  // or branch and an absolute pointer, which are most of the relocations
+  // in a typical program.
+  RelocKind Kinds[2];
+};
+} // namespace
+
+static const RelocTarget RelocTargets[] = {
+    {"x86_64",
+     ELF64LEKind,
+     EM_X86_64,
+     {{R_PC, R_X86_64_PC32, -4}, {R_ABS, R_X86_64_64, 0}}},
+    {"i386",
+     ELF32LEKind,
+     EM_386,
+     {{R_PC, R_386_PC32, -4}, {R_ABS, R_386_32, 0}}},
+    {"aarch64",
+     ELF64LEKind,
+     EM_AARCH64,
+     {{R_PC, R_AARCH64_CALL26, 0}, {R_ABS, R_AARCH64_ABS64, 0}}},
+};
+
+// InputSectionBase::relocateAlloc on one section with NumRelocs relocations
+// 8 bytes apart, referring to random symbols out of NumRelocs / 4.
+static void benchRelocateAlloc(State &S, const RelocTarget &T) {
+  resetLinker(T.Kind, T.Machine);
+  size_t NumRelocs = S.arg();
+  std::vector<uint8_t> Buf(NumRelocs * 8);
+  std::vector<std::string> Names = createNames(NumRelocs / 4 + 1);
+  std::vector<Symbol *> Syms = createSymbols(Names);
+
+  OutputSection Out(".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR);
+  Out.Addr = 0x201000;
+  auto *Sec = make<InputSection>(nullptr, SHF_ALLOC | SHF_EXECINSTR,
+                                 SHT_PROGBITS, 16, Buf, ".text");
+  Sec->Parent = &Out;
+
+  std::mt19937 Rng(42);
+  Sec->Relocations.reserve(NumRelocs);
+  for (size_t I = 0; I < NumRelocs; ++I) {
+    const RelocKind &K = T.Kinds[I % 2];
+    Sec->Relocations.push_back(
+        {K.Expr, K.Type, I * 8, K.Addend, Syms[Rng() % Syms.size()]});
+  }
+
+  while (S.keepRunning())
+    Sec->relocateAlloc(Buf.data(), Buf.data() + Buf.size());
+  S.setItemsProcessed(S.iterations() * NumRelocs);
+}
+
+// Returns an x86-64 relocatable object with NumFuncs functions, each in its
+// own section and calling four others. The functions form groups of Copies
+// that differ only in their callees: copy C of group G calls copy C of the
+// groups that G calls. The copies are therefore only found to be identical
+// by refining the classes over a few iterations, and ICF folds them all.
+static std::vector<uint8_t> createICFObject(size_t NumFuncs, size_t Copies) {
+  typedef ELF64LE::Ehdr Elf_Ehdr;
+  typedef ELF64LE::Shdr Elf_Shdr;
+  typedef ELF64LE::Sym Elf_Sym;
+  typedef ELF64LE::Rela Elf_Rela;
+
+  const size_t NumCalls = 4;
+  size_t NumGroups = NumFuncs / Copies;
+  uint32_t SymTabIndex = NumFuncs * 2 + 1;
+  // The section indices must fit in st_shndx and e_shnum.
+  assert(SymTabIndex + 2 < SHN_LORESERVE);
+
+  std::vector<uint8_t> Out(sizeof(Elf_Ehdr));
+  std::vector<Elf_Shdr> Shdrs(1);
+  std::string ShStrTab(1, '\0');
+  std::string StrTab(1, '\0');
+
+  auto AddSection = [&](const Twine &Name, uint32_t Type, uint64_t Flags,
+                        ArrayRef<uint8_t> Data, uint64_t Align) {
+    Out.resize(alignTo(Out.size(), Align));
+    Shdrs.emplace_back();
+    Elf_Shdr &Hdr = Shdrs.back();
+    Hdr.sh_name = ShStrTab.size();
+    Hdr.sh_type = Type;
+    Hdr.sh_flags = Flags;
+    Hdr.sh_offset = Out.size();
+    Hdr.sh_size = Data.size();
+    Hdr.sh_addralign = Align;
+    ShStrTab += Name.str();
+    ShStrTab += '\0';
+    Out.insert(Out.end(), Data.begin(), Data.end());
+    return &Hdr;
+  };
+
+  // mov $(G % 16), %eax, then the calls, then ret.
+  for (size_t I = 0; I < NumFuncs; ++I) {
+    std::vector<uint8_t> Body = {0xb8, uint8_t(I % NumGroups % 16), 0, 0, 0};
+    for (size_t K = 0; K < NumCalls; ++K)
+      Body.insert(Body.end(), {0xe8, 0, 0, 0, 0});
+    Body.push_back(0xc3);
+    AddSection(".text.f" + Twine(I), SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR,
+               Body, 16);
+  }
+
+  for (size_t I = 0; I < NumFuncs; ++I) {
+    size_t Group = I % NumGroups;
+    size_t Copy = I / NumGroups;
+    std::vector<Elf_Rela> Relas(NumCalls);
+    for (size_t K = 0; K < NumCalls; ++K) {
+      size_t Callee = (Group * 2654435761U + K * 40503U) % NumGroups;
+      Relas[K].r_offset = 6 + K * 5;
+      Relas[K].setSymbolAndType(1 + Callee + Copy * NumGroups,
+                                R_X86_64_PLT32, false);
+      Relas[K].r_addend = -4;
+    }
+    Elf_Shdr *Hdr = AddSection(
+        ".rela.text.f" + Twine(I), SHT_RELA, SHF_INFO_LINK,
+        makeArrayRef((const uint8_t *)Relas.data(),
+                     Relas.size() * sizeof(Elf_Rela)),
+        8);
+    Hdr->sh_link = SymTabIndex;
+    Hdr->sh_info = I + 1;
+    Hdr->sh_entsize = sizeof(Elf_Rela);
+  }
+
+  std::vector<Elf_Sym> Syms(NumFuncs + 1);
+  for (size_t I = 0; I < NumFuncs; ++I) {
+    Elf_Sym &Sym = Syms[I + 1];
+    Sym.st_name = StrTab.size();
+    Sym.setBindingAndType(STB_GLOBAL, STT_FUNC);
+    Sym.st_shndx = I + 1;
+    Sym.st_size = 6 + NumCalls * 5;
+    StrTab += "f" + std::to_string(I);
+    StrTab += '\0';
+  }
+  Elf_Shdr *Hdr = AddSection(
+      ".symtab", SHT_SYMTAB, 0,
+      makeArrayRef((const uint8_t *)Syms.data(), Syms.size() * sizeof(Elf_Sym)),
+      8);
+  Hdr->sh_link = SymTabIndex + 1;
+  Hdr->sh_info = 1;
+  Hdr->sh_entsize = sizeof(Elf_Sym);
+
+  AddSection(".strtab", SHT_STRTAB, 0,
+             makeArrayRef((const uint8_t *)StrTab.data(), StrTab.size()), 1);
+
+  // .shstrtab has to contain its own name before it is written.
+  uint32_t ShStrTabName = ShStrTab.size();
+  ShStrTab += ".shstrtab";
+  ShStrTab += '\0';
+  Hdr = AddSection(
+      "", SHT_STRTAB, 0,
+      makeArrayRef((const uint8_t *)ShStrTab.data(), ShStrTab.size()), 1);
+  Hdr->sh_name = ShStrTabName;
+
+  Out.resize(alignTo(Out.size(), 8));
+  uint64_t ShOff = Out.size();
+  Out.insert(Out.end(), (const uint8_t *)Shdrs.data(),
+             (const uint8_t *)(Shdrs.data() + Shdrs.size()));
+
+  Elf_Ehdr Ehdr = {};
+  memcpy(Ehdr.e_ident, ElfMagic, strlen(ElfMagic));
+  Ehdr.e_ident[EI_CLASS] = ELFCLASS64;
+  Ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+  Ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+  Ehdr.e_type = ET_REL;
+  Ehdr.e_machine = EM_X86_64;
+  Ehdr.e_version = EV_CURRENT;
+  Ehdr.e_shoff = ShOff;
+  Ehdr.e_ehsize = sizeof(Elf_Ehdr);
+  Ehdr.e_shentsize = sizeof(Elf_Shdr);
+  Ehdr.e_shnum = Shdrs.size();
+  Ehdr.e_shstrndx = Shdrs.size() - 1;
+  memcpy(Out.data(), &Ehdr, sizeof(Ehdr));
+  return Out;
+}
+
+// ICF<ELF64LE> with --icf=all on NumFuncs functions, including the initial
+// hashing and the refinement iterations. ICF folds sections in place, so
+// the object is read again before each iteration.
+static void benchICF(State &S) {
+  std::vector<uint8_t> Obj = createICFObject(S.arg(), 4);
+  MemoryBufferRef MB(toStringRef(Obj), "icf.o");
+
+  while (S.keepRunning()) {
+    S.pauseTiming();
+    resetLinker(ELF64LEKind, EM_X86_64);
+    Config->ICF = ICFLevel::All;
+    Symtab->addFile<ELF64LE>(make<ObjFile<ELF64LE>>(MB, ""));
+    for (InputFile *F : ObjectFiles)
+      for (InputSectionBase *Sec : F->getSections())
+        if (Sec && Sec != &InputSection::Discarded)
+          InputSections.push_back(Sec);
+    if (errorCount()) {
+      S.skipWithError("cannot read the generated object");
+      return;
+    }
+    S.resumeTiming();
+
+    doIcf<ELF64LE>();
+  }
+  S.setItemsProcessed(S.iterations() * S.arg());
+}
+
+int main(int Argc, const char **Argv) {
+  InitLLVM X(Argc, Argv);
+
+  registerBenchmark("SymbolTable::insert", benchSymtabInsert,
+                    {1 << 12, 1 << 16, 1 << 20});
+  registerBenchmark("GnuHashTableSection::addSymbols", benchGnuHash,
+                    {1 << 12, 1 << 16, 1 << 20});
+  registerBenchmark("MergeInputSection::splitIntoPieces", benchSplitIntoPieces,
+                    {1 << 12, 1 << 16, 1 << 20});
+  registerBenchmark("MergeNoTailSection::finalizeContents", benchMergeNoTail,
+                    {1 << 12, 1 << 16, 1 << 20});
+  for (const RelocTarget &T : RelocTargets)
+    registerBenchmark(
+        "relocateAlloc<" + std::string(T.Name) + ">",
+        [T](State &S) { benchRelocateAlloc(S, T); },
+        {1 << 12, 1 << 16, 1 << 20});
+  registerBenchmark("ICF", benchICF, {1 << 10, 1 << 12, 1 << 14});
+
+  return runBenchmarks(Argc, Argv);
+}
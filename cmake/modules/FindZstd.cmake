@@ -0,0 +1,12 @@
+# - Find zstd.
+# Defines:
+# Zstd_FOUND
+# Zstd_INCLUDE_DIRS
+# Zstd_LIBRARIES
+
+find_path(Zstd_INCLUDE_DIRS zstd.h)
+find_library(Zstd_LIBRARIES NAMES zstd zstd_static)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+    Zstd DEFAULT_MSG Zstd_LIBRARIES Zstd_INCLUDE_DIRS)
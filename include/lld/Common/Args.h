@@ -11,6 +11,7 @@
 #define LLD_ARGS_H
 
 #include "lld/Common/LLVM.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <vector>
 
@@ -29,6 +30,13 @@ uint64_t getZOptionValue(llvm::opt::InputArgList &Args, int Id, StringRef Key,
                          uint64_t Default);
 
 std::vector<StringRef> getLines(MemoryBufferRef MB);
+
+// Replaces the arguments of the form @<file> in Argv with the arguments in
+// the files, like llvm::cl::ExpandResponseFiles. For GNU quoting, each file
+// is copied into memory once and split in place, so that link lines with
+// hundreds of thousands of arguments are not saved one string at a time.
+void expandResponseFiles(llvm::cl::TokenizerCallback Tokenizer,
+                         SmallVectorImpl<const char *> &Argv);
 } // namespace args
 } // namespace lld
 
@@ -0,0 +1,52 @@
+//===- CallGraphSort.h ------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The section clustering behind ELF --call-graph-ordering-file and COFF
+// /call-graph-ordering-file. It works on sections numbered by the caller, so
+// that each linker can build the graph from its own section type.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COMMON_CALL_GRAPH_SORT_H
+#define LLD_COMMON_CALL_GRAPH_SORT_H
+
+#include "lld/Common/LLVM.h"
+#include <cstdint>
+#include <vector>
+
+namespace lld {
+
+enum class CallGraphSortKind { C3, HfsortPlus };
+
+// Weight calls from section From to section To.
+struct CallGraphArc {
+  int From;
+  int To;
+  uint64_t Weight;
+};
+
+struct CallGraphSortOptions {
+  CallGraphSortKind Kind = CallGraphSortKind::C3;
+  uint64_t ClusterSize = 1024 * 1024;
+  uint64_t PageSize = 4096;
+};
+
+// Returns the sections, given by their sizes, in the order in which they
+// should be laid out to keep the calls in Arcs short. Arcs may contain calls
+// from a section to itself. Sections of size zero are left out. If Locality
+// is not null, it is set to the fraction of calls expected to stay within a
+// page.
+std::vector<int> sortCallGraph(ArrayRef<uint64_t> Sizes,
+                               ArrayRef<CallGraphArc> Arcs,
+                               const CallGraphSortOptions &Opts,
+                               double *Locality = nullptr);
+
+} // namespace lld
+
+#endif
@@ -62,7 +62,9 @@
 //
 // It is not recommended to use llvm::outs() or llvm::errs() directly in lld
 // because they are not thread-safe. The functions declared in this file are
-// thread-safe.
+// thread-safe. Diagnostics reported inside parallelForEachN are collected per
+// chunk and printed when the loop is done, in the order a serial loop would
+// have printed them.
 //
 //===----------------------------------------------------------------------===//
 
@@ -74,6 +76,9 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileOutputBuffer.h"
+#include <atomic>
+#include <string>
+#include <vector>
 
 namespace llvm {
 class DiagnosticInfo;
@@ -81,9 +86,40 @@ class DiagnosticInfo;
 
 namespace lld {
 
+// Holds the diagnostics reported on a thread while the buffer is installed
+// on it, instead of printing them. parallelForEachN installs one for each
+// chunk of a parallel loop and flushes them in chunk order when the loop is
+// done, so that workers do not wait on each other to print and the output
+// does not depend on how the chunks were scheduled.
+class DiagnosticBuffer {
+public:
+  // Makes this the buffer of the calling thread until uninstall().
+  void install();
+  void uninstall();
+
+  // Reports the buffered diagnostics again on the calling thread, which
+  // prints them or adds them to the buffer installed there.
+  void flush();
+
+private:
+  friend class ErrorHandler;
+
+  enum class Kind : uint8_t { Log, Message, Warning, Error };
+  struct Diag {
+    Kind K;
+    std::string Msg;
+  };
+
+  std::vector<Diag> Diags;
+  uint64_t NumErrors = 0;
+  DiagnosticBuffer *Prev = nullptr;
+};
+
 class ErrorHandler {
 public:
-  uint64_t ErrorCount = 0;
+  // Errors are counted when they are reported, even if they are printed
+  // later, so that errorCount() is accurate in parallel code too.
+  std::atomic<uint64_t> ErrorCount{0};
   uint64_t ErrorLimit = 20;
   StringRef ErrorLimitExceededMsg = "too many errors emitted, stopping now";
   StringRef LogName = "lld";
@@ -99,10 +135,24 @@ public:
   void message(const Twine &Msg);
   void warn(const Twine &Msg);
 
+  // Clears the error count between the links of a batch.
+  void resetErrorCount() {
+    ErrorCount = 0;
+    PrintedErrors = 0;
+  }
+
   std::unique_ptr<llvm::FileOutputBuffer> OutputBuffer;
 
 private:
+  friend class DiagnosticBuffer;
+
+  void report(DiagnosticBuffer::Kind K, const Twine &Msg);
+  void emit(DiagnosticBuffer::Kind K, const Twine &Msg);
   void print(StringRef S, raw_ostream::Colors C);
+
+  // The number of errors which have reached the output, including those
+  // past ErrorLimit which were not shown.
+  std::atomic<uint64_t> PrintedErrors{0};
 };
 
 /// Returns the default error handler.
@@ -0,0 +1,51 @@
+//===- InPlaceOutputBuffer.h ------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COMMON_IN_PLACE_OUTPUT_BUFFER_H
+#define LLD_COMMON_IN_PLACE_OUTPUT_BUFFER_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/Memory.h"
+
+namespace lld {
+
+// An in-memory output buffer that, on commit(), updates an existing output
+// file of the same size by writing only the pages that differ from it. It
+// is used by ELF --write-in-place and COFF /incremental. If the existing
+// file cannot be updated, e.g. because its size changed or it is a running
+// executable, the output is written to a new file as usual.
+class InPlaceOutputBuffer final : public llvm::FileOutputBuffer {
+public:
+  static llvm::Expected<std::unique_ptr<InPlaceOutputBuffer>>
+  create(StringRef Path, uint64_t Size, unsigned Flags);
+
+  uint8_t *getBufferStart() const override {
+    return reinterpret_cast<uint8_t *>(Mem.base());
+  }
+  uint8_t *getBufferEnd() const override { return getBufferStart() + Size; }
+  size_t getBufferSize() const override { return Size; }
+
+  llvm::Error commit() override;
+
+private:
+  InPlaceOutputBuffer(StringRef Path, llvm::sys::OwningMemoryBlock Mem,
+                      uint64_t Size, unsigned Flags)
+      : FileOutputBuffer(Path), Mem(std::move(Mem)), Size(Size),
+        Flags(Flags) {}
+
+  bool updateInPlace();
+
+  llvm::sys::OwningMemoryBlock Mem;
+  uint64_t Size;
+  unsigned Flags;
+};
+} // namespace lld
+
+#endif
@@ -0,0 +1,77 @@
+//===- LinkCache.h ----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A cache of whole link results, used by ELF, COFF and wasm --link-cache.
+// An entry is keyed by the linker version, the command line and the contents
+// of every file the link read. If a link with the same key has been done
+// before, its output and side files (map files, PDBs and the like) are copied
+// from the cache instead of linking again.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COMMON_LINK_CACHE_H
+#define LLD_COMMON_LINK_CACHE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+namespace opt {
+class InputArgList;
+}
+} // namespace llvm
+
+namespace lld {
+
+class LinkCache {
+public:
+  LinkCache(StringRef Dir, llvm::CachePruningPolicy Policy,
+            const llvm::opt::InputArgList &Args);
+
+  // Records an input file the link has read. May be called from several
+  // threads. The buffer must stay alive until fetch() returns.
+  void addInput(StringRef Path, MemoryBufferRef MB);
+
+  // Outputs are the files the link may write. The first one is the output
+  // file, the others are side files such as map files that a link need not
+  // write.
+
+  // Copies the cached results for this link to Outputs and returns true,
+  // or returns false if there are none. Must be called once all inputs have
+  // been recorded. Files named by arguments that the link did not record are
+  // hashed as well, so that e.g. linker scripts and order files are covered.
+  bool fetch(ArrayRef<std::string> Outputs);
+
+  // Copies those of Outputs which the link has written into the cache, and
+  // prunes it.
+  void store(ArrayRef<std::string> Outputs);
+
+private:
+  std::string getEntryPath(size_t I) const;
+
+  std::string Dir;
+  llvm::CachePruningPolicy Policy;
+  std::string Description;
+  std::vector<std::string> ArgValues;
+  std::string Key;
+  llvm::sys::TimePoint<> Start;
+
+  std::mutex Mu;
+  std::map<std::string, MemoryBufferRef> Inputs;
+};
+
+} // namespace lld
+
+#endif
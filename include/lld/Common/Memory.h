@@ -17,13 +17,21 @@
 // Arena allocators are efficient and easy to understand.
 // Most objects are allocated using the arena allocators defined by this file.
 //
+// The arenas behind make() and Saver are shared and must not be used from
+// parallel regions. Code running inside parallelForEach uses
+// makeConcurrent() and saveConcurrent() instead, which allocate from
+// arenas private to the calling thread.
+//
 //===----------------------------------------------------------------------===//
 
 #ifndef LLD_COMMON_MEMORY_H
 #define LLD_COMMON_MEMORY_H
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/StringSaver.h"
+#include "llvm/Support/TypeName.h"
+#include <atomic>
 #include <vector>
 
 namespace lld {
@@ -34,17 +42,33 @@ extern llvm::StringSaver Saver;
 
 void freeArena();
 
+// Like Saver.save(), but may be called from parallel regions.
+llvm::StringRef saveConcurrent(llvm::StringRef S);
+
 // These two classes are hack to keep track of all
 // SpecificBumpPtrAllocator instances.
 struct SpecificAllocBase {
-  SpecificAllocBase() { Instances.push_back(this); }
+  SpecificAllocBase();
   virtual ~SpecificAllocBase() = default;
   virtual void reset() = 0;
+  virtual llvm::StringRef getTypeName() const = 0;
+  virtual size_t getTypeSize() const = 0;
+
+  // The number of live objects in this arena, for --print-memory-usage.
+  size_t NumObjects = 0;
+
   static std::vector<SpecificAllocBase *> Instances;
 };
 
 template <class T> struct SpecificAlloc : public SpecificAllocBase {
-  void reset() override { Alloc.DestroyAll(); }
+  void reset() override {
+    Alloc.DestroyAll();
+    NumObjects = 0;
+  }
+  llvm::StringRef getTypeName() const override {
+    return llvm::getTypeName<T>();
+  }
+  size_t getTypeSize() const override { return sizeof(T); }
   llvm::SpecificBumpPtrAllocator<T> Alloc;
 };
 
@@ -52,9 +76,32 @@ template <class T> struct SpecificAlloc : public SpecificAllocBase {
 // Your destructor will be invoked from freeArena().
 template <typename T, typename... U> T *make(U &&... Args) {
   static SpecificAlloc<T> Alloc;
+  ++Alloc.NumObjects;
   return new (Alloc.Alloc.Allocate()) T(std::forward<U>(Args)...);
 }
 
+// Like make(), but may be called from parallel regions. Each thread gets
+// its own arena for T the first time it allocates one. The arenas are
+// never deleted because objects in them outlive the thread, for example
+// when the thread pool is resized, and they are reset by freeArena().
+template <typename T, typename... U> T *makeConcurrent(U &&... Args) {
+  static LLVM_THREAD_LOCAL SpecificAlloc<T> *Alloc;
+  if (!Alloc)
+    Alloc = new SpecificAlloc<T>();
+  ++Alloc->NumObjects;
+  return new (Alloc->Alloc.Allocate()) T(std::forward<U>(Args)...);
+}
+
+// The number of bytes of input files that the driver has read or mapped,
+// and the size of the output buffer. Drivers update these as they go.
+extern std::atomic<uint64_t> InputFileBytes;
+extern uint64_t OutputBufferBytes;
+
+// Prints the number of objects and bytes in each arena, followed by the
+// input and output sizes and the peak RSS, for --print-memory-usage.
+// Phase names the point of the link at which this is called.
+void printMemoryUsage(llvm::StringRef Phase);
+
 } // namespace lld
 
 #endif
@@ -13,8 +13,15 @@
 #include "lld/Common/LLVM.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
 namespace llvm {
+class TarWriter;
 namespace opt { class Arg; }
 }
 
@@ -34,6 +41,40 @@ std::string rewritePath(StringRef S);
 
 // Returns the string form of the given argument.
 std::string toString(const llvm::opt::Arg &Arg);
+
+// A tar file for --reproduce and /linkrepro that is written on a background
+// thread, so that the link does not wait for the inputs to be copied. The
+// data passed to append() is not copied. It has to stay alive until finish()
+// returns, which input files do since they are kept mapped for the whole
+// link.
+class AsyncTarWriter {
+public:
+  static llvm::Expected<std::unique_ptr<AsyncTarWriter>>
+  create(StringRef OutputPath, StringRef BaseDir);
+
+  ~AsyncTarWriter();
+
+  // Queues a file. Blocks if the writer is too far behind.
+  void append(StringRef Path, StringRef Data);
+
+  // Writes out the queued files and stops the background thread.
+  void finish();
+
+private:
+  AsyncTarWriter(std::unique_ptr<llvm::TarWriter> Tar);
+  void run();
+
+  std::unique_ptr<llvm::TarWriter> Tar;
+  std::mutex Mu;
+  std::condition_variable Cond;
+  std::deque<std::pair<std::string, StringRef>> Queue;
+  bool Done = false;
+  std::thread Thread;
+};
+
+// Finishes all live AsyncTarWriters. Called by exitLld so that a tar file
+// is complete even if the link ends with a fatal error.
+void finishTarWriters();
 }
 
 #endif
@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/GlobPattern.h"
 #include <string>
@@ -29,7 +30,11 @@ bool isValidCIdentifier(llvm::StringRef S);
 // Write the contents of the a buffer to a file
 void saveBuffer(llvm::StringRef Buffer, const llvm::Twine &Path);
 
-// This class represents multiple glob patterns.
+// This class represents multiple glob patterns. Most patterns in linker
+// scripts and version scripts are plain names, "prefix*" or "*suffix", so
+// those are kept apart from true globs: plain names are looked up in a hash
+// table and prefixes and suffixes are compared directly, and only the
+// remaining patterns are matched one by one.
 class StringMatcher {
 public:
   StringMatcher() = default;
@@ -37,8 +42,27 @@ public:
 
   bool match(llvm::StringRef S) const;
 
+  // Returns the index of the first pattern that matches S, or -1 if none
+  // does.
+  int find(llvm::StringRef S) const;
+
+  // If every pattern is a literal string or a literal prefix followed by a
+  // single '*', returns true and fills in Literals and Prefixes, so that the
+  // caller can look matching strings up in an index instead.
+  bool getLiteralsAndPrefixes(std::vector<llvm::StringRef> &Literals,
+                              std::vector<llvm::StringRef> &Prefixes) const;
+
 private:
-  std::vector<llvm::GlobPattern> Patterns;
+  // Patterns without wildcards, mapped to the index of their first
+  // occurrence.
+  llvm::StringMap<unsigned> Literals;
+
+  // "foo*" and "*foo" patterns, in pattern order. "*" is the empty prefix.
+  std::vector<std::pair<std::string, unsigned>> Prefixes;
+  std::vector<std::pair<std::string, unsigned>> Suffixes;
+
+  // All other patterns, in pattern order.
+  std::vector<std::pair<llvm::GlobPattern, unsigned>> Globs;
 };
 
 inline llvm::ArrayRef<uint8_t> toArrayRef(llvm::StringRef S) {
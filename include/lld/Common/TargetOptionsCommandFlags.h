@@ -16,6 +16,12 @@
 #include "llvm/Target/TargetOptions.h"
 
 namespace lld {
+// Registers all LLVM targets, which is needed to read and compile bitcode.
+// Drivers call this only once they see a bitcode file, so that links
+// without LTO do not pay for it. It is safe to call more than once and from
+// several threads.
+void initLLVMTargets();
+
 llvm::TargetOptions InitTargetOptionsFromCodeGenFlags();
 llvm::Optional<llvm::CodeModel::Model> GetCodeModelFromCMModel();
 std::string GetCPUStr();
@@ -59,26 +59,107 @@
 #ifndef LLD_COMMON_THREADS_H
 #define LLD_COMMON_THREADS_H
 
-#include "llvm/Support/Parallel.h"
+#include "llvm/ADT/STLExtras.h"
+#include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <memory>
 
 namespace lld {
 
 extern bool ThreadsEnabled;
 
-template <typename R, class FuncTy> void parallelForEach(R &&Range, FuncTy Fn) {
-  if (ThreadsEnabled)
-    for_each(llvm::parallel::par, std::begin(Range), std::end(Range), Fn);
-  else
-    for_each(llvm::parallel::seq, std::begin(Range), std::end(Range), Fn);
+// The number of threads the parallel loops below may use, including the
+// calling thread. Zero means one per hardware thread. Set by --threads=N.
+extern unsigned ThreadCount;
+
+// Returns the number of threads a parallel loop actually runs on. This is
+// 1 if threading is disabled.
+unsigned getThreadCount();
+
+// A hint for how a parallel loop hands out its indices to threads.
+enum class Locality {
+  // Threads take the next chunk from anywhere in the range.
+  Any,
+
+  // Each thread works through its own contiguous part of the range and
+  // only takes chunks from other parts once its own is done. On hosts with
+  // more than one NUMA node, the threads are also pinned so that adjacent
+  // parts run on the same node. Use this for loops whose indices follow
+  // the addresses they write, such as copying sections to the output, so
+  // that each output page is first touched, and therefore allocated, on
+  // the node of the thread that writes it.
+  Contiguous,
+};
+
+// Calls Fn for each index in [Begin, End). The work is split into chunks
+// of at least MinGrain indices which are run on an lld-owned thread pool
+// of getThreadCount() threads, so loops whose entire range fits in one
+// chunk run serially on the calling thread.
+void parallelForEachN(size_t Begin, size_t End,
+                      llvm::function_ref<void(size_t)> Fn,
+                      size_t MinGrain = 1, Locality Hint = Locality::Any);
+
+template <typename R, class FuncTy>
+void parallelForEach(R &&Range, FuncTy Fn, size_t MinGrain = 1,
+                     Locality Hint = Locality::Any) {
+  auto Begin = std::begin(Range);
+  size_t Size = std::distance(Begin, std::end(Range));
+  parallelForEachN(0, Size, [&](size_t I) { Fn(Begin[I]); }, MinGrain, Hint);
 }
 
-inline void parallelForEachN(size_t Begin, size_t End,
-                             std::function<void(size_t)> Fn) {
-  if (ThreadsEnabled)
-    for_each_n(llvm::parallel::par, Begin, End, Fn);
-  else
-    for_each_n(llvm::parallel::seq, Begin, End, Fn);
+// Runs independent tasks concurrently on the pool of the parallel loops,
+// such as passes of the link that do not depend on each other. Tasks may
+// themselves run parallel loops. wait(), which the destructor calls too,
+// returns when all tasks spawned so far have finished, and reports their
+// diagnostics in the order the tasks were spawned.
+//
+// Parallel loops and tasks may nest freely. A thread that waits for a loop
+// or a group runs other queued work, nested more deeply than its own, in
+// the meantime, so it must not hold a lock across the wait that such work
+// may take.
+class TaskGroup {
+public:
+  TaskGroup();
+  ~TaskGroup();
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  // Runs Fn on the pool, or right away if threading is disabled.
+  void spawn(std::function<void()> Fn);
+  void wait();
+
+private:
+  struct State;
+  std::shared_ptr<State> S;
+};
+
+// Sorts [Begin, End) on the same pool. The range is cut into one block per
+// thread, the blocks are sorted in parallel and then merged pairwise.
+template <class RandomIt, class Comparator>
+void parallelSort(RandomIt Begin, RandomIt End, Comparator Comp) {
+  size_t Size = End - Begin;
+  size_t NumBlocks = std::min<size_t>(getThreadCount(), Size / 1024);
+  if (NumBlocks <= 1) {
+    std::sort(Begin, End, Comp);
+    return;
+  }
+
+  auto Block = [&](size_t I) { return Begin + Size * I / NumBlocks; };
+  parallelForEachN(0, NumBlocks, [&](size_t I) {
+    std::sort(Block(I), Block(I + 1), Comp);
+  });
+  for (size_t Width = 1; Width < NumBlocks; Width *= 2) {
+    parallelForEachN(0, (NumBlocks + Width * 2 - 1) / (Width * 2),
+                     [&](size_t I) {
+                       size_t Lo = I * Width * 2;
+                       size_t Mid = std::min(Lo + Width, NumBlocks);
+                       size_t Hi = std::min(Lo + Width * 2, NumBlocks);
+                       std::inplace_merge(Block(Lo), Block(Mid), Block(Hi),
+                                          Comp);
+                     });
+  }
 }
 
 } // namespace lld
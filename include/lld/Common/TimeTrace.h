@@ -0,0 +1,59 @@
+//===- TimeTrace.h ----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --time-trace. When enabled, every TimeTraceScope
+// records when it began and ended and on which thread, and the events are
+// written out at the end of the link in the Chrome trace event format, which
+// chrome://tracing and Perfetto can display.
+//
+// Unlike Timer, which only keeps a total per phase, a trace shows how the
+// work of a parallel loop is spread over the threads of the pool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_COMMON_TIME_TRACE_H
+#define LLD_COMMON_TIME_TRACE_H
+
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <string>
+
+namespace lld {
+
+extern bool TimeTraceEnabled;
+
+// Records an event covering the lifetime of this object, or until end() is
+// called, on the calling thread.
+class TimeTraceScope {
+public:
+  explicit TimeTraceScope(llvm::StringRef Name);
+  ~TimeTraceScope() { end(); }
+
+  void end();
+
+private:
+  std::string Name;
+  std::string Parent;
+  uint64_t Start = 0;
+  bool Active = false;
+};
+
+// Returns the name of the innermost scope open on the calling thread.
+// parallelForEachN labels the work it runs on pool threads with it.
+llvm::StringRef getTimeTraceScope();
+
+// Discards previously recorded events and starts recording.
+void startTimeTrace();
+
+// Writes the recorded events to Path and stops recording.
+void writeTimeTrace(llvm::StringRef Path);
+
+} // namespace lld
+
+#endif
@@ -10,6 +10,7 @@
 #ifndef LLD_COMMON_TIMER_H
 #define LLD_COMMON_TIMER_H
 
+#include "lld/Common/TimeTrace.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringRef.h"
 #include <assert.h>
@@ -21,6 +22,7 @@ namespace lld {
 
 class Timer;
 
+// Times a phase, and also records it for --time-trace.
 struct ScopedTimer {
   explicit ScopedTimer(Timer &T);
 
@@ -29,6 +31,7 @@ struct ScopedTimer {
   void stop();
 
   Timer *T = nullptr;
+  TimeTraceScope Trace;
 };
 
 class Timer {
@@ -37,11 +40,25 @@ public:
 
   static Timer &root();
 
+  // Attaches hardware performance counters (instructions, cycles, last
+  // level cache misses and page faults) to every timer, and prints them
+  // in the timer tree. This is only supported on Linux. The counters
+  // include threads that are created after this call, so it should be
+  // called before the link starts any threads.
+  static void enableCounters();
+
   void start();
   void stop();
   void print();
 
+  // Clears the times and counters of this timer and its children, so that
+  // a driver that links more than once per process reports each link alone.
+  void reset();
+
   double millis() const;
+  llvm::StringRef getName() const { return Name; }
+
+  enum { Instructions, Cycles, CacheMisses, PageFaults, NumCounters };
 
 private:
   explicit Timer(llvm::StringRef Name);
@@ -49,6 +66,8 @@ private:
 
   std::chrono::time_point<std::chrono::high_resolution_clock> StartTime;
   std::chrono::nanoseconds Total;
+  uint64_t StartCounters[NumCounters];
+  uint64_t Counters[NumCounters] = {};
   std::vector<Timer *> Children;
   std::string Name;
   Timer *Parent;
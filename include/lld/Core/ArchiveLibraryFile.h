@@ -34,6 +34,14 @@ public:
   /// specified name and return the File object for that member, or nullptr.
   virtual File *find(StringRef name) = 0;
 
+  /// Return the names of all the symbols that find() may succeed for, so that
+  /// the Resolver can index the archives of a group together.
+  virtual std::vector<StringRef> symbols() = 0;
+
+  /// Tell the archive that find() is about to be called for these names, so
+  /// that it can get the members that define them ready ahead of time.
+  virtual void preload(ArrayRef<StringRef> names) {}
+
   virtual std::error_code
   parseAllMembers(std::vector<std::unique_ptr<File>> &result) = 0;
 
@@ -0,0 +1,113 @@
+//===- Core/DefinedAtomTable.h - Flat copy of defined atom attributes -----===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_CORE_DEFINED_ATOM_TABLE_H
+#define LLD_CORE_DEFINED_ATOM_TABLE_H
+
+#include "lld/Common/LLVM.h"
+#include "lld/Core/DefinedAtom.h"
+#include "llvm/ADT/DenseMap.h"
+#include <vector>
+
+namespace lld {
+class SimpleFile;
+
+/// The attributes, content and references of a list of defined atoms, read
+/// once through the DefinedAtom interface and stored in arrays indexed by the
+/// position of the atom in the list.
+///
+/// Passes which look at every atom several times, or at the references of
+/// every atom, can use this instead of making virtual calls on each atom
+/// every time. The table is a snapshot: it has to be rebuilt after atoms are
+/// added or removed, or after their references are changed.
+class DefinedAtomTable {
+public:
+  DefinedAtomTable() = default;
+  explicit DefinedAtomTable(ArrayRef<const DefinedAtom *> atoms);
+  explicit DefinedAtomTable(const SimpleFile &file);
+
+  size_t size() const { return _atoms.size(); }
+  ArrayRef<const DefinedAtom *> atoms() const { return _atoms; }
+  const DefinedAtom *atom(uint32_t id) const { return _atoms[id]; }
+
+  /// Returns the id of the given atom, or -1 if it is not in the table.
+  int64_t find(const Atom *atom) const {
+    auto pos = _ids.find(atom);
+    return pos == _ids.end() ? -1 : (int64_t)pos->second;
+  }
+
+  DefinedAtom::ContentType contentType(uint32_t id) const {
+    return (DefinedAtom::ContentType)_attributes[id].contentType;
+  }
+  DefinedAtom::Scope scope(uint32_t id) const {
+    return (DefinedAtom::Scope)_attributes[id].scope;
+  }
+  DefinedAtom::Interposable interposable(uint32_t id) const {
+    return (DefinedAtom::Interposable)_attributes[id].interposable;
+  }
+  DefinedAtom::Merge merge(uint32_t id) const {
+    return (DefinedAtom::Merge)_attributes[id].merge;
+  }
+  DefinedAtom::DeadStripKind deadStrip(uint32_t id) const {
+    return (DefinedAtom::DeadStripKind)_attributes[id].deadStrip;
+  }
+  DefinedAtom::SectionChoice sectionChoice(uint32_t id) const {
+    return (DefinedAtom::SectionChoice)_attributes[id].sectionChoice;
+  }
+  DefinedAtom::ContentPermissions permissions(uint32_t id) const {
+    return (DefinedAtom::ContentPermissions)_attributes[id].permissions;
+  }
+  uint64_t atomSize(uint32_t id) const { return _sizes[id]; }
+  DefinedAtom::Alignment alignment(uint32_t id) const {
+    return _alignments[id];
+  }
+  ArrayRef<uint8_t> rawContent(uint32_t id) const { return _contents[id]; }
+
+  /// The references of the atom, in the order DefinedAtom::begin() returns
+  /// them.
+  ArrayRef<const Reference *> references(uint32_t id) const {
+    return makeArrayRef(_references).slice(
+        _referenceBegin[id], _referenceBegin[id + 1] - _referenceBegin[id]);
+  }
+
+  /// The references of all atoms, one atom after another. The references of
+  /// atom id start at firstReference(id), so that passes can keep their own
+  /// arrays indexed like this one.
+  ArrayRef<const Reference *> allReferences() const { return _references; }
+  uint32_t firstReference(uint32_t id) const { return _referenceBegin[id]; }
+
+private:
+  // The attributes passes select atoms by, one byte each.
+  struct Attributes {
+    uint8_t contentType;
+    uint8_t scope;
+    uint8_t interposable;
+    uint8_t merge;
+    uint8_t deadStrip;
+    uint8_t sectionChoice;
+    uint8_t permissions;
+  };
+
+  void build();
+
+  std::vector<const DefinedAtom *> _atoms;
+  llvm::DenseMap<const Atom *, uint32_t> _ids;
+  std::vector<Attributes> _attributes;
+  std::vector<uint64_t> _sizes;
+  std::vector<DefinedAtom::Alignment> _alignments;
+  std::vector<ArrayRef<uint8_t>> _contents;
+  // The references of atom i are _references[_referenceBegin[i]] up to
+  // _references[_referenceBegin[i + 1]].
+  std::vector<uint32_t> _referenceBegin;
+  std::vector<const Reference *> _references;
+};
+
+} // namespace lld
+
+#endif // LLD_CORE_DEFINED_ATOM_TABLE_H
@@ -10,6 +10,10 @@
 /// \file
 /// Provide an Instrumentation API that optionally uses VTune interfaces.
 ///
+/// Without VTune, a ScopedTask is recorded for --time-trace and, once
+/// enableTaskTimers() has been called, timed with an lld::Timer so that it
+/// shows up in the -time report.
+///
 //===----------------------------------------------------------------------===//
 
 #ifndef LLD_CORE_INSTRUMENTATION_H
@@ -20,6 +24,8 @@
 
 #ifdef LLD_HAS_VTUNE
 # include <ittnotify.h>
+#else
+# include "lld/Common/TimeTrace.h"
 #endif
 
 namespace lld {
@@ -100,27 +106,55 @@ public:
     __itt_marker(d, __itt_null, s, __itt_scope_global);
   }
 };
+
+inline void enableTaskTimers() {}
 #else
+class Timer;
+
 class Domain {
 public:
   Domain(const char *name) {}
 };
 
 class StringHandle {
+  const char *_name;
+
 public:
-  StringHandle(const char *name) {}
+  StringHandle(const char *name) : _name(name) {}
+
+  const char *name() const { return _name; }
 };
 
+/// A task on a single thread. Nests within other tasks.
+///
+/// Tasks started on the thread which called enableTaskTimers() are timed, each
+/// under the innermost task open on that thread when it started. Tasks with the
+/// same name and parent share a Timer, so a task run several times is reported
+/// once with its total time. Tasks on other threads are only traced.
 class ScopedTask {
+  Timer *_timer = nullptr;
+  Timer *_parent = nullptr;
+  TimeTraceScope _trace;
+
+  ScopedTask(const ScopedTask &) = delete;
+  ScopedTask &operator=(const ScopedTask &) = delete;
+
 public:
-  ScopedTask(const Domain &d, const StringHandle &s) {}
-  void end() {}
+  ScopedTask(const Domain &d, const StringHandle &s);
+
+  /// Prematurely end this task.
+  void end();
+
+  ~ScopedTask() { end(); }
 };
 
 class Marker {
 public:
   Marker(const Domain &d, const StringHandle &s) {}
 };
+
+/// Start timing the tasks run on the calling thread, under Timer::root().
+void enableTaskTimers();
 #endif
 
 inline const Domain &getDefaultDomain() {
@@ -30,6 +30,9 @@ class Pass {
 public:
   virtual ~Pass() = default;
 
+  /// The name the pass is reported under by -time and -time-trace.
+  virtual const char *name() const = 0;
+
   /// Do the actual work of the Pass.
   virtual llvm::Error perform(SimpleFile &mergedFile) = 0;
 
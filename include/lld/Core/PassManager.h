@@ -11,6 +11,7 @@
 #define LLD_CORE_PASS_MANAGER_H
 
 #include "lld/Common/LLVM.h"
+#include "lld/Core/Instrumentation.h"
 #include "lld/Core/Pass.h"
 #include "llvm/Support/Error.h"
 #include <memory>
@@ -22,10 +23,11 @@ class Pass;
 
 /// Owns and runs a collection of passes.
 ///
-/// This class is currently just a container for passes and a way to run them.
+/// Each pass is run as a ScopedTask named after the pass, so it shows up in the
+/// -time report and the -time-trace output.
 ///
-/// In the future this should handle timing pass runs, running parallel passes,
-/// and validate/satisfy pass dependencies.
+/// In the future this should handle running parallel passes, and
+/// validate/satisfy pass dependencies.
 class PassManager {
 public:
   void add(std::unique_ptr<Pass> pass) {
@@ -33,9 +35,11 @@ public:
   }
 
   llvm::Error runOnFile(SimpleFile &file) {
-    for (std::unique_ptr<Pass> &pass : _passes)
+    for (std::unique_ptr<Pass> &pass : _passes) {
+      ScopedTask task(getDefaultDomain(), pass->name());
       if (llvm::Error EC = pass->perform(file))
         return EC;
+    }
     return llvm::Error::success();
   }
 
@@ -18,6 +18,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/ErrorOr.h"
+#include <atomic>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -35,7 +36,7 @@ public:
   Resolver(LinkingContext &ctx) : _ctx(ctx), _result(new MergedFile()) {}
 
   // InputFiles::Handler methods
-  void doDefinedAtom(OwningAtomPtr<DefinedAtom> atom);
+  void doDefinedAtom(OwningAtomPtr<DefinedAtom> atom, unsigned contentHash);
   bool doUndefinedAtom(OwningAtomPtr<UndefinedAtom> atom);
   void doSharedLibraryAtom(OwningAtomPtr<SharedLibraryAtom> atom);
   void doAbsoluteAtom(OwningAtomPtr<AbsoluteAtom> atom);
@@ -58,8 +59,8 @@ public:
 private:
   typedef std::function<llvm::Expected<bool>(StringRef)> UndefCallback;
 
-  bool undefinesAdded(int begin, int end);
-  File *getFile(int &index);
+  bool resolveGroup(size_t begin, size_t end);
+  std::vector<StringRef> pendingUndefines(size_t begin);
 
   /// The main function that iterates over the files to resolve
   bool resolveUndefines();
@@ -69,7 +70,7 @@ private:
   void removeCoalescedAwayAtoms();
   llvm::Expected<bool> forEachUndefines(File &file, UndefCallback callback);
 
-  void markLive(const Atom *atom);
+  bool isLive(const Atom *atom) const;
 
   class MergedFile : public SimpleFile {
   public:
@@ -81,14 +82,13 @@ private:
   SymbolTable _symbolTable;
   std::vector<OwningAtomPtr<Atom>>     _atoms;
   std::set<const Atom *>        _deadStripRoots;
-  llvm::DenseSet<const Atom *>  _liveAtoms;
   llvm::DenseSet<const Atom *>  _deadAtoms;
   std::unique_ptr<MergedFile>   _result;
-  std::unordered_multimap<const Atom *, const Atom *> _reverseRef;
 
-  // --start-group and --end-group
-  std::vector<File *> _files;
-  std::map<File *, bool> _newUndefinesAdded;
+  // For dead stripping, the position of each atom in _atoms before dead
+  // atoms were removed, and whether the atom at that position is live.
+  llvm::DenseMap<const Atom *, uint32_t> _atomIndex;
+  std::vector<std::atomic<bool>> _live;
 
   // List of undefined symbols.
   std::vector<StringRef> _undefines;
@@ -37,6 +37,17 @@ public:
   /// add atom to symbol table
   bool add(const DefinedAtom &);
 
+  /// add atom to symbol table, given the contentHash() of the atom if
+  /// isMergedByContent() is true for it
+  bool add(const DefinedAtom &, unsigned contentHash);
+
+  /// returns true if add() coalesces the atom with others of the same content
+  static bool isMergedByContent(const DefinedAtom &);
+
+  /// returns the hash by which atoms merged by content are looked up. This
+  /// only reads the atom, so it can be computed ahead of add() in parallel.
+  static unsigned contentHash(const DefinedAtom &);
+
   /// add atom to symbol table
   bool add(const UndefinedAtom &);
 
@@ -74,17 +85,27 @@ private:
   typedef llvm::DenseMap<StringRef, const Atom *,
                                            StringRefMappingInfo> NameToAtom;
 
+  // An atom merged by content, along with its content hash, so that the
+  // hash is not computed again when the table grows.
+  struct AtomContentKey {
+    unsigned hash;
+    const DefinedAtom *atom;
+  };
+
   struct AtomMappingInfo {
-    static const DefinedAtom * getEmptyKey() { return nullptr; }
-    static const DefinedAtom * getTombstoneKey() { return (DefinedAtom*)(-1); }
-    static unsigned getHashValue(const DefinedAtom * const Val);
-    static bool isEqual(const DefinedAtom * const LHS,
-                        const DefinedAtom * const RHS);
+    static AtomContentKey getEmptyKey() { return {0, nullptr}; }
+    static AtomContentKey getTombstoneKey() {
+      return {0, (const DefinedAtom *)(-1)};
+    }
+    static unsigned getHashValue(const AtomContentKey &Val) {
+      return Val.hash;
+    }
+    static bool isEqual(const AtomContentKey &LHS, const AtomContentKey &RHS);
   };
-  typedef llvm::DenseSet<const DefinedAtom*, AtomMappingInfo> AtomContentSet;
+  typedef llvm::DenseSet<AtomContentKey, AtomMappingInfo> AtomContentSet;
 
   bool addByName(const Atom &);
-  bool addByContent(const DefinedAtom &);
+  bool addByContent(const DefinedAtom &, unsigned contentHash);
 
   AtomToAtom _replacedAtoms;
   NameToAtom _nameTable;
@@ -138,12 +138,38 @@ public:
 
   void appendOrderedSymbol(StringRef symbol, StringRef filename);
 
+  /// The number of calls from one symbol to another, as listed in a
+  /// -call_graph_ordering_file.
+  struct CallGraphEdge {
+    StringRef from;
+    StringRef to;
+    uint64_t count;
+  };
+  void addCallGraphEdge(StringRef from, StringRef to, uint64_t count) {
+    _callGraphProfile.push_back({copy(from), copy(to), count});
+  }
+  ArrayRef<CallGraphEdge> callGraphProfile() const {
+    return _callGraphProfile;
+  }
+
   bool keepPrivateExterns() const { return _keepPrivateExterns; }
   void setKeepPrivateExterns(bool v) { _keepPrivateExterns = v; }
   bool demangleSymbols() const { return _demangle; }
   void setDemangleSymbols(bool d) { _demangle = d; }
   bool mergeObjCCategories() const { return _mergeObjCCategories; }
   void setMergeObjCCategories(bool v) { _mergeObjCCategories = v; }
+  StringRef yamlCacheDirectory() const { return _yamlCacheDirectory; }
+  void setYamlCacheDirectory(StringRef dir) { _yamlCacheDirectory = dir; }
+
+  /// Print the time spent in each phase and pass of the link (-time).
+  bool printTiming() const { return _printTiming; }
+  void setPrintTiming(bool value) { _printTiming = value; }
+
+  /// The file to write a Chrome trace of the link to (-time-trace=).
+  StringRef timeTraceFile() const { return _timeTraceFile; }
+  void setTimeTraceFile(StringRef path) { _timeTraceFile = path; }
+  bool deduplicate() const { return _deduplicate; }
+  void setDeduplicate(bool v) { _deduplicate = v; }
   /// Create file at specified path which will contain a binary encoding
   /// of all input and output file paths.
   std::error_code createDependencyFile(StringRef path);
@@ -358,6 +384,9 @@ public:
   /// Pass to add objc image info and optimized objc data.
   bool needsObjCPass() const;
 
+  /// Pass to fold identical functions.
+  bool needsICFPass() const;
+
   /// Magic symbol name stubs will need to help lazy bind.
   StringRef binderSymbolName() const;
 
@@ -413,8 +442,8 @@ public:
 
   llvm::Error handleLoadedFile(File &file) override;
 
-  bool customAtomOrderer(const DefinedAtom *left, const DefinedAtom *right,
-                         bool &leftBeforeRight) const;
+  /// Returns true and sets ordinal if the atom is listed in the order file.
+  bool orderFileOrdinal(const DefinedAtom *atom, unsigned &ordinal) const;
 
   /// Return the 'flat namespace' file. This is the file that supplies
   /// atoms for otherwise undefined symbols when the -flat_namespace or
@@ -450,6 +479,8 @@ private:
 
   static ArchInfo _s_archInfos[];
 
+  bool mayBeInDirListing(StringRef path) const;
+
   std::set<StringRef> _existingPaths; // For testing only.
   StringRefVector _searchDirs;
   StringRefVector _syslibRoots;
@@ -481,10 +512,14 @@ private:
   bool _keepPrivateExterns = false;
   bool _demangle = false;
   bool _mergeObjCCategories = true;
+  bool _deduplicate = false;
   bool _generateVersionLoadCommand = false;
   bool _generateFunctionStartsLoadCommand = false;
   bool _generateDataInCodeLoadCommand = false;
   StringRef _bundleLoader;
+  StringRef _yamlCacheDirectory;
+  bool _printTiming = false;
+  StringRef _timeTraceFile;
   mutable std::unique_ptr<mach_o::ArchHandler> _archHandler;
   mutable std::unique_ptr<Writer> _writer;
   std::vector<SectionAlign> _sectAligns;
@@ -493,12 +528,17 @@ private:
   mutable std::set<mach_o::MachODylibFile*> _upwardDylibs;
   mutable std::vector<std::unique_ptr<File>> _indirectDylibs;
   mutable std::mutex _dylibsMutex;
+  // The lowercased names of the entries of each directory fileExists() has
+  // looked in, or None if the directory could not be read.
+  mutable llvm::StringMap<llvm::Optional<llvm::StringSet<>>> _dirListings;
+  mutable std::mutex _dirListingsMutex;
   ExportMode _exportMode = ExportMode::globals;
   llvm::StringSet<> _exportedSymbols;
   DebugInfoMode _debugInfoMode = DebugInfoMode::addDebugMap;
   std::unique_ptr<llvm::raw_fd_ostream> _dependencyInfo;
   llvm::StringMap<std::vector<OrderFileNode>> _orderFiles;
   unsigned _orderFileEntries = 0;
+  std::vector<CallGraphEdge> _callGraphProfile;
   File *_flatNamespaceFile = nullptr;
   mach_o::SectCreateFile *_sectCreateFile = nullptr;
 };
@@ -0,0 +1,71 @@
+//===- Core/DefinedAtomTable.cpp - Flat copy of defined atom attributes ---===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Core/DefinedAtomTable.h"
+#include "lld/Core/Simple.h"
+#include "llvm/Support/Parallel.h"
+
+using namespace lld;
+
+DefinedAtomTable::DefinedAtomTable(ArrayRef<const DefinedAtom *> atoms)
+    : _atoms(atoms.begin(), atoms.end()) {
+  build();
+}
+
+DefinedAtomTable::DefinedAtomTable(const SimpleFile &file) {
+  for (const DefinedAtom *atom : file.defined())
+    _atoms.push_back(atom);
+  build();
+}
+
+void DefinedAtomTable::build() {
+  size_t numAtoms = _atoms.size();
+  _ids.reserve(numAtoms);
+  for (size_t i = 0; i < numAtoms; ++i)
+    _ids[_atoms[i]] = i;
+
+  // Each atom's attributes are read with one round of virtual calls, in
+  // parallel. The reference counts are recorded in _referenceBegin and turned
+  // into offsets afterwards.
+  _attributes.resize(numAtoms);
+  _sizes.resize(numAtoms);
+  _alignments.assign(numAtoms, DefinedAtom::Alignment(1));
+  _contents.resize(numAtoms);
+  _referenceBegin.assign(numAtoms + 1, 0);
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), numAtoms, [&](size_t i) {
+        const DefinedAtom *atom = _atoms[i];
+        Attributes &attrs = _attributes[i];
+        attrs.contentType = atom->contentType();
+        attrs.scope = atom->scope();
+        attrs.interposable = atom->interposable();
+        attrs.merge = atom->merge();
+        attrs.deadStrip = atom->deadStrip();
+        attrs.sectionChoice = atom->sectionChoice();
+        attrs.permissions = atom->permissions();
+        _sizes[i] = atom->size();
+        _alignments[i] = atom->alignment();
+        _contents[i] = atom->rawContent();
+        uint32_t numReferences = 0;
+        for (auto it = atom->begin(), end = atom->end(); it != end; ++it)
+          ++numReferences;
+        _referenceBegin[i + 1] = numReferences;
+      });
+
+  for (size_t i = 0; i < numAtoms; ++i)
+    _referenceBegin[i + 1] += _referenceBegin[i];
+
+  _references.resize(_referenceBegin[numAtoms]);
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), numAtoms, [&](size_t i) {
+        const Reference **out = &_references[_referenceBegin[i]];
+        for (const Reference *ref : *_atoms[i])
+          *out++ = ref;
+      });
+}
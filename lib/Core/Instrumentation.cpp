@@ -0,0 +1,59 @@
+//===- lib/Core/Instrumentation.cpp - Instrumentation API -----------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lld/Core/Instrumentation.h"
+
+#ifndef LLD_HAS_VTUNE
+#include "lld/Common/Timer.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace lld;
+
+static bool timersEnabled = false;
+static std::thread::id timerThread;
+
+// The timer of the innermost task open on timerThread.
+static Timer *currentTask = nullptr;
+
+// Timers are handed to their parent when they first start and so have to
+// live until the report is printed.
+static std::map<std::pair<Timer *, std::string>, std::unique_ptr<Timer>>
+    taskTimers;
+
+void lld::enableTaskTimers() {
+  timerThread = std::this_thread::get_id();
+  currentTask = &Timer::root();
+  timersEnabled = true;
+}
+
+ScopedTask::ScopedTask(const Domain &d, const StringHandle &s)
+    : _trace(s.name()) {
+  if (!timersEnabled || std::this_thread::get_id() != timerThread)
+    return;
+  std::unique_ptr<Timer> &timer = taskTimers[{currentTask, s.name()}];
+  if (!timer)
+    timer.reset(new Timer(s.name(), *currentTask));
+  _parent = currentTask;
+  _timer = timer.get();
+  currentTask = _timer;
+  _timer->start();
+}
+
+void ScopedTask::end() {
+  _trace.end();
+  if (!_timer)
+    return;
+  _timer->stop();
+  currentTask = _parent;
+  _timer = nullptr;
+}
+#endif
@@ -17,11 +17,15 @@
 #include "lld/Core/SharedLibraryFile.h"
 #include "lld/Core/SymbolTable.h"
 #include "lld/Core/UndefinedAtom.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -34,8 +38,20 @@ llvm::Expected<bool> Resolver::handleFile(File &file) {
   if (auto ec = _ctx.handleLoadedFile(file))
     return std::move(ec);
   bool undefAdded = false;
-  for (auto &atom : file.defined().owning_ptrs())
-    doDefinedAtom(std::move(atom));
+
+  // Hash the contents of the atoms that are merged by content up front, in
+  // parallel. Adding the atoms to the symbol table stays in order.
+  auto defined = file.defined().owning_ptrs();
+  size_t numDefined = std::distance(defined.begin(), defined.end());
+  std::vector<unsigned> contentHashes(numDefined);
+  llvm::parallel::for_each_n(llvm::parallel::par, size_t(0), numDefined,
+                             [&](size_t i) {
+    const DefinedAtom &atom = *defined.begin()[i].get();
+    if (SymbolTable::isMergedByContent(atom))
+      contentHashes[i] = SymbolTable::contentHash(atom);
+  });
+  for (size_t i = 0; i < numDefined; ++i)
+    doDefinedAtom(std::move(defined.begin()[i]), contentHashes[i]);
   for (auto &atom : file.undefined().owning_ptrs()) {
     if (doUndefinedAtom(std::move(atom)))
       undefAdded = true;
@@ -72,8 +88,24 @@ llvm::Expected<bool> Resolver::forEachUndefines(File &file,
   return undefAdded;
 }
 
+// Returns the names in _undefines from index begin on that are still
+// undefined.
+std::vector<StringRef> Resolver::pendingUndefines(size_t begin) {
+  std::vector<StringRef> names;
+  for (size_t i = begin, e = _undefines.size(); i < e; ++i) {
+    StringRef undefName = _undefines[i];
+    if (undefName.empty())
+      continue;
+    const Atom *atom = _symbolTable.findByName(undefName);
+    if (isa<UndefinedAtom>(atom) && !_symbolTable.isCoalescedAway(atom))
+      names.push_back(undefName);
+  }
+  return names;
+}
+
 llvm::Expected<bool> Resolver::handleArchiveFile(File &file) {
   ArchiveLibraryFile *archiveFile = cast<ArchiveLibraryFile>(&file);
+  archiveFile->preload(pendingUndefines(_undefineIndex[&file]));
   return forEachUndefines(file,
                           [&](StringRef undefName) -> llvm::Expected<bool> {
     if (File *member = archiveFile->find(undefName)) {
@@ -122,7 +154,8 @@ bool Resolver::doUndefinedAtom(OwningAtomPtr<UndefinedAtom> atom) {
 
 // Called on each atom when a file is added. Returns true if a given
 // atom is added to the symbol table.
-void Resolver::doDefinedAtom(OwningAtomPtr<DefinedAtom> atom) {
+void Resolver::doDefinedAtom(OwningAtomPtr<DefinedAtom> atom,
+                             unsigned contentHash) {
   DEBUG_WITH_TYPE("resolver", llvm::dbgs()
                     << "         DefinedAtom: "
                     << llvm::format("0x%09lX", atom.get())
@@ -143,7 +176,7 @@ void Resolver::doDefinedAtom(OwningAtomPtr<DefinedAtom> atom) {
   }
 
   // add to list of known atoms
-  _symbolTable.add(*atom.get());
+  _symbolTable.add(*atom.get(), contentHash);
   _atoms.push_back(OwningAtomPtr<Atom>(atom.release()));
 }
 
@@ -178,51 +211,108 @@ void Resolver::doAbsoluteAtom(OwningAtomPtr<AbsoluteAtom> atom) {
   _atoms.push_back(OwningAtomPtr<Atom>(atom.release()));
 }
 
-// Returns true if at least one of N previous files has created an
-// undefined symbol.
-bool Resolver::undefinesAdded(int begin, int end) {
+// Called at the end of a --start-group/--end-group range once each of its
+// files has been visited. Rather than walking the group again for as long
+// as its libraries add undefined symbols, look up each pending undefined
+// symbol once, in an index of the symbols of all the archives in the group
+// and in the group's shared libraries. Archive members loaded on the way
+// append their own undefined symbols to _undefines, which are looked up in
+// turn. The first library of the group that defines a symbol wins.
+//
+// Each time the worklist catches up with _undefines, the members that the
+// symbols added since are expected to load are parsed in parallel.
+bool Resolver::resolveGroup(size_t begin, size_t end) {
   std::vector<std::unique_ptr<Node>> &inputs = _ctx.getNodes();
-  for (int i = begin; i < end; ++i)
-    if (FileNode *node = dyn_cast<FileNode>(inputs[i].get()))
-      if (_newUndefinesAdded[node->getFile()])
-        return true;
-  return false;
-}
+  std::vector<File *> libraries;
+  llvm::DenseMap<StringRef, llvm::TinyPtrVector<ArchiveLibraryFile *>> index;
+  size_t i = _undefines.size();
+  for (size_t j = begin; j < end; ++j) {
+    FileNode *node = dyn_cast<FileNode>(inputs[j].get());
+    if (!node)
+      continue;
+    File *file = node->getFile();
+    if (auto *archive = dyn_cast<ArchiveLibraryFile>(file)) {
+      for (StringRef name : archive->symbols())
+        index[name].push_back(archive);
+    } else if (!isa<SharedLibraryFile>(file)) {
+      continue;
+    }
+    libraries.push_back(file);
+    i = std::min(i, _undefineIndex[file]);
+  }
 
-File *Resolver::getFile(int &index) {
-  std::vector<std::unique_ptr<Node>> &inputs = _ctx.getNodes();
-  if ((size_t)index >= inputs.size())
-    return nullptr;
-  if (GroupEnd *group = dyn_cast<GroupEnd>(inputs[index].get())) {
-    // We are at the end of the current group. If one or more new
-    // undefined atom has been added in the last groupSize files, we
-    // reiterate over the files.
-    int size = group->getSize();
-    if (undefinesAdded(index - size, index)) {
-      index -= size;
-      return getFile(index);
+  size_t preloaded = i;
+  for (; i < _undefines.size(); ++i) {
+    if (i == preloaded) {
+      llvm::DenseMap<ArchiveLibraryFile *, std::vector<StringRef>> batches;
+      for (StringRef name : pendingUndefines(i)) {
+        auto it = index.find(name);
+        if (it != index.end())
+          batches[it->second.front()].push_back(name);
+      }
+      for (auto &batch : batches)
+        batch.first->preload(batch.second);
+      preloaded = _undefines.size();
+    }
+
+    StringRef undefName = _undefines[i];
+    if (undefName.empty())
+      continue;
+    const Atom *atom = _symbolTable.findByName(undefName);
+    if (!isa<UndefinedAtom>(atom) || _symbolTable.isCoalescedAway(atom)) {
+      _undefines[i] = "";
+      continue;
+    }
+
+    auto it = index.find(undefName);
+    for (File *file : libraries) {
+      if (auto *archive = dyn_cast<ArchiveLibraryFile>(file)) {
+        if (it == index.end() || !llvm::is_contained(it->second, archive))
+          continue;
+        File *member = archive->find(undefName);
+        if (!member)
+          continue;
+        member->setOrdinal(_ctx.getNextOrdinalAndIncrement());
+        auto undefAddedOrError = handleFile(*member);
+        if (auto EC = undefAddedOrError.takeError()) {
+          // FIXME: This should be passed to logAllUnhandledErrors but it needs
+          // to be passed a Twine instead of a string.
+          llvm::errs() << "Error in " + file->path() << ": ";
+          logAllUnhandledErrors(std::move(EC), llvm::errs(), std::string());
+          return false;
+        }
+        break;
+      }
+      auto sharedAtom = cast<SharedLibraryFile>(file)->exports(undefName);
+      if (sharedAtom.get()) {
+        doSharedLibraryAtom(std::move(sharedAtom));
+        break;
+      }
     }
-    ++index;
-    return getFile(index);
   }
-  return cast<FileNode>(inputs[index++].get())->getFile();
+
+  for (File *file : libraries)
+    _undefineIndex[file] = i;
+  return true;
 }
 
-// Keep adding atoms until _ctx.getNextFile() returns an error. This
+// Keep adding atoms until all the input files have been visited. This
 // function is where undefined atoms are resolved.
 bool Resolver::resolveUndefines() {
   DEBUG_WITH_TYPE("resolver",
                   llvm::dbgs() << "******** Resolving undefines:\n");
   ScopedTask task(getDefaultDomain(), "resolveUndefines");
-  int index = 0;
+  std::vector<std::unique_ptr<Node>> &inputs = _ctx.getNodes();
   std::set<File *> seen;
-  for (;;) {
-    bool undefAdded = false;
+  for (size_t index = 0; index < inputs.size(); ++index) {
+    if (GroupEnd *group = dyn_cast<GroupEnd>(inputs[index].get())) {
+      if (!resolveGroup(index - group->getSize(), index))
+        return false;
+      continue;
+    }
     DEBUG_WITH_TYPE("resolver",
                     llvm::dbgs() << "Loading file #" << index << "\n");
-    File *file = getFile(index);
-    if (!file)
-      return true;
+    File *file = cast<FileNode>(inputs[index].get())->getFile();
     if (std::error_code ec = file->parse()) {
       llvm::errs() << "Cannot open " + file->path()
                    << ": " << ec.message() << "\n";
@@ -241,9 +331,8 @@ bool Resolver::resolveUndefines() {
     case File::kindStubHelperObject:
     case File::kindResolverMergedObject:
     case File::kindSectCreateObject: {
-      // The same file may be visited more than once if the file is
-      // in --start-group and --end-group. Only library files should
-      // be processed more than once.
+      // The same file may be given more than once. Only library files
+      // should be processed more than once.
       if (seen.count(file))
         break;
       seen.insert(file);
@@ -257,7 +346,6 @@ bool Resolver::resolveUndefines() {
         logAllUnhandledErrors(std::move(EC), llvm::errs(), std::string());
         return false;
       }
-      undefAdded = undefAddedOrError.get();
       break;
     }
     case File::kindArchiveLibrary: {
@@ -271,7 +359,6 @@ bool Resolver::resolveUndefines() {
         logAllUnhandledErrors(std::move(EC), llvm::errs(), std::string());
         return false;
       }
-      undefAdded = undefAddedOrError.get();
       break;
     }
     case File::kindSharedLibrary:
@@ -286,8 +373,8 @@ bool Resolver::resolveUndefines() {
       }
       break;
     }
-    _newUndefinesAdded[file] = undefAdded;
   }
+  return true;
 }
 
 // switch all references to undefined or coalesced away atoms
@@ -316,22 +403,9 @@ void Resolver::updateReferences() {
   }
 }
 
-// For dead code stripping, recursively mark atoms "live"
-void Resolver::markLive(const Atom *atom) {
-  // Mark the atom is live. If it's already marked live, then stop recursion.
-  auto exists = _liveAtoms.insert(atom);
-  if (!exists.second)
-    return;
-
-  // Mark all atoms it references as live
-  if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom)) {
-    for (const Reference *ref : *defAtom)
-      markLive(ref->target());
-    for (auto &p : llvm::make_range(_reverseRef.equal_range(defAtom))) {
-      const Atom *target = p.second;
-      markLive(target);
-    }
-  }
+bool Resolver::isLive(const Atom *atom) const {
+  auto it = _atomIndex.find(atom);
+  return it != _atomIndex.end() && _live[it->second];
 }
 
 static bool isBackref(const Reference *ref) {
@@ -349,18 +423,47 @@ void Resolver::deadStripOptimize() {
   if (!_ctx.deadStrip())
     return;
 
-  // Some type of references prevent referring atoms to be dead-striped.
-  // Make a reverse map of such references before traversing the graph.
+  // Number the atoms, so that the liveness of each atom and the atoms it
+  // keeps alive can be kept in flat arrays.
+  size_t numAtoms = _atoms.size();
+  _atomIndex.reserve(numAtoms);
+  for (size_t i = 0; i < numAtoms; ++i)
+    _atomIndex[_atoms[i].get()] = i;
+  _live = std::vector<std::atomic<bool>>(numAtoms);
+
+  // Find the atoms each atom references, in parallel. Some type of
+  // references prevent referring atoms to be dead-striped; those are
+  // collected separately and reversed below.
+  std::vector<std::vector<uint32_t>> succs(numAtoms);
+  std::vector<std::vector<uint32_t>> backrefs(numAtoms);
+  llvm::parallel::for_each_n(llvm::parallel::par, size_t(0), numAtoms,
+                             [&](size_t i) {
+    const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(_atoms[i].get());
+    if (!defAtom)
+      return;
+    for (const Reference *ref : *defAtom) {
+      auto it = _atomIndex.find(ref->target());
+      if (it == _atomIndex.end())
+        continue;
+      succs[i].push_back(it->second);
+      if (isBackref(ref))
+        backrefs[i].push_back(it->second);
+    }
+  });
+  for (size_t i = 0; i < numAtoms; ++i)
+    for (uint32_t target : backrefs[i])
+      succs[target].push_back(i);
+
   // While traversing the list of atoms, mark AbsoluteAtoms as live
   // in order to avoid reclaim.
-  for (const OwningAtomPtr<Atom> &atom : _atoms) {
-    if (const DefinedAtom *defAtom = dyn_cast<DefinedAtom>(atom.get()))
-      for (const Reference *ref : *defAtom)
-        if (isBackref(ref))
-          _reverseRef.insert(std::make_pair(ref->target(), atom.get()));
-    if (const AbsoluteAtom *absAtom = dyn_cast<AbsoluteAtom>(atom.get()))
-      markLive(absAtom);
-  }
+  std::vector<uint32_t> worklist;
+  auto markLive = [&](uint32_t i) {
+    if (!_live[i].exchange(true, std::memory_order_relaxed))
+      worklist.push_back(i);
+  };
+  for (size_t i = 0; i < numAtoms; ++i)
+    if (isa<AbsoluteAtom>(_atoms[i].get()))
+      markLive(i);
 
   // By default, shared libraries are built with all globals as dead strip roots
   if (_ctx.globalsAreDeadStripRoots())
@@ -376,14 +479,36 @@ void Resolver::deadStripOptimize() {
     _deadStripRoots.insert(symAtom);
   }
 
-  // mark all roots as live, and recursively all atoms they reference
-  for (const Atom *dsrAtom : _deadStripRoots)
-    markLive(dsrAtom);
+  // mark all roots as live, and then all atoms they reference. This goes one
+  // level of the graph at a time, with each level split into chunks that are
+  // walked in parallel. An atom is added to the next level by whichever chunk
+  // marks it live first.
+  for (const Atom *dsrAtom : _deadStripRoots) {
+    auto it = _atomIndex.find(dsrAtom);
+    if (it != _atomIndex.end())
+      markLive(it->second);
+  }
+  const size_t chunkSize = 1024;
+  while (!worklist.empty()) {
+    size_t numChunks = (worklist.size() + chunkSize - 1) / chunkSize;
+    std::vector<std::vector<uint32_t>> next(numChunks);
+    llvm::parallel::for_each_n(llvm::parallel::par, size_t(0), numChunks,
+                               [&](size_t c) {
+      size_t end = std::min(worklist.size(), (c + 1) * chunkSize);
+      for (size_t j = c * chunkSize; j < end; ++j)
+        for (uint32_t succ : succs[worklist[j]])
+          if (!_live[succ].exchange(true, std::memory_order_relaxed))
+            next[c].push_back(succ);
+    });
+    worklist.clear();
+    for (std::vector<uint32_t> &v : next)
+      worklist.insert(worklist.end(), v.begin(), v.end());
+  }
 
   // now remove all non-live atoms from _atoms
   _atoms.erase(std::remove_if(_atoms.begin(), _atoms.end(),
                               [&](OwningAtomPtr<Atom> &a) {
-                 return _liveAtoms.count(a.get()) == 0;
+                 return !isLive(a.get());
                }),
                _atoms.end());
 }
@@ -399,7 +524,7 @@ bool Resolver::checkUndefines() {
     // When dead code stripping, we don't care if dead atoms are undefined.
     undefinedAtoms.erase(
         std::remove_if(undefinedAtoms.begin(), undefinedAtoms.end(),
-                       [&](const Atom *a) { return _liveAtoms.count(a) == 0; }),
+                       [&](const Atom *a) { return !isLive(a); }),
         undefinedAtoms.end());
   }
 
@@ -35,6 +35,10 @@ bool SymbolTable::add(const SharedLibraryAtom &atom) { return addByName(atom); }
 bool SymbolTable::add(const AbsoluteAtom &atom) { return addByName(atom); }
 
 bool SymbolTable::add(const DefinedAtom &atom) {
+  return add(atom, isMergedByContent(atom) ? contentHash(atom) : 0);
+}
+
+bool SymbolTable::add(const DefinedAtom &atom, unsigned contentHash) {
   if (!atom.name().empty() &&
       atom.scope() != DefinedAtom::scopeTranslationUnit) {
     // Named atoms cannot be merged by content.
@@ -42,17 +46,22 @@ bool SymbolTable::add(const DefinedAtom &atom) {
     // Track named atoms that are not scoped to file (static).
     return addByName(atom);
   }
-  if (atom.merge() == DefinedAtom::mergeByContent) {
-    // Named atoms cannot be merged by content.
-    assert(atom.name().empty());
-    // Currently only read-only constants can be merged.
-    if (atom.permissions() == DefinedAtom::permR__)
-      return addByContent(atom);
-    // TODO: support mergeByContent of data atoms by comparing content & fixups.
-  }
+  if (isMergedByContent(atom))
+    return addByContent(atom, contentHash);
   return false;
 }
 
+bool SymbolTable::isMergedByContent(const DefinedAtom &atom) {
+  if (atom.merge() != DefinedAtom::mergeByContent)
+    return false;
+  // Named atoms cannot be merged by content.
+  assert(atom.name().empty() ||
+         atom.scope() == DefinedAtom::scopeTranslationUnit);
+  // Currently only read-only constants can be merged.
+  // TODO: support mergeByContent of data atoms by comparing content & fixups.
+  return atom.permissions() == DefinedAtom::permR__;
+}
+
 enum NameCollisionResolution {
   NCR_First,
   NCR_Second,
@@ -211,21 +220,25 @@ bool SymbolTable::addByName(const Atom &newAtom) {
   return false;
 }
 
-unsigned SymbolTable::AtomMappingInfo::getHashValue(const DefinedAtom *atom) {
-  auto content = atom->rawContent();
-  return llvm::hash_combine(atom->size(),
-                            atom->contentType(),
+unsigned SymbolTable::contentHash(const DefinedAtom &atom) {
+  auto content = atom.rawContent();
+  return llvm::hash_combine(atom.size(),
+                            atom.contentType(),
                             llvm::hash_combine_range(content.begin(),
                                                      content.end()));
 }
 
-bool SymbolTable::AtomMappingInfo::isEqual(const DefinedAtom * const l,
-                                           const DefinedAtom * const r) {
+bool SymbolTable::AtomMappingInfo::isEqual(const AtomContentKey &lk,
+                                           const AtomContentKey &rk) {
+  const DefinedAtom *l = lk.atom;
+  const DefinedAtom *r = rk.atom;
   if (l == r)
     return true;
-  if (l == getEmptyKey() || r == getEmptyKey())
+  if (l == getEmptyKey().atom || r == getEmptyKey().atom)
     return false;
-  if (l == getTombstoneKey() || r == getTombstoneKey())
+  if (l == getTombstoneKey().atom || r == getTombstoneKey().atom)
+    return false;
+  if (lk.hash != rk.hash)
     return false;
   if (l->contentType() != r->contentType())
     return false;
@@ -242,13 +255,12 @@ bool SymbolTable::AtomMappingInfo::isEqual(const DefinedAtom * const l,
   return memcmp(lc.data(), rc.data(), lc.size()) == 0;
 }
 
-bool SymbolTable::addByContent(const DefinedAtom &newAtom) {
-  AtomContentSet::iterator pos = _contentTable.find(&newAtom);
-  if (pos == _contentTable.end()) {
-    _contentTable.insert(&newAtom);
+bool SymbolTable::addByContent(const DefinedAtom &newAtom,
+                               unsigned contentHash) {
+  auto ins = _contentTable.insert({contentHash, &newAtom});
+  if (ins.second)
     return true;
-  }
-  const Atom* existing = *pos;
+  const Atom* existing = (*ins.first).atom;
   // New atom is not being used.  Add it to replacement table.
   _replacedAtoms[&newAtom] = existing;
   return false;
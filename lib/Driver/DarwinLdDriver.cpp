@@ -16,6 +16,9 @@
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/TimeTrace.h"
+#include "lld/Common/Timer.h"
 #include "lld/Core/ArchiveLibraryFile.h"
 #include "lld/Core/Error.h"
 #include "lld/Core/File.h"
@@ -43,6 +46,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -239,6 +243,34 @@ static std::error_code parseOrderFile(StringRef orderFilePath,
   return std::error_code();
 }
 
+/// Call graph ordering files have one call per line: the caller, the callee
+/// and the number of calls, separated by spaces. Blank lines are ignored and
+/// trailing comments start with #. Example:
+///     _main _foo 100
+static std::error_code parseCallGraphFile(StringRef path,
+                                          MachOLinkingContext &ctx) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mb = MemoryBuffer::getFileOrSTDIN(path);
+  if (std::error_code ec = mb.getError())
+    return ec;
+  ctx.addInputFileDependency(path);
+  StringRef buffer = mb->get()->getBuffer();
+  while (!buffer.empty()) {
+    std::pair<StringRef, StringRef> lineAndRest = buffer.split('\n');
+    StringRef line = lineAndRest.first.split('#').first.trim();
+    buffer = lineAndRest.second;
+    if (line.empty())
+      continue;
+    SmallVector<StringRef, 3> fields;
+    line.split(fields, ' ', -1, false);
+    uint64_t count;
+    if (fields.size() != 3 || fields[2].getAsInteger(10, count))
+      return make_dynamic_error_code(("malformed line: " + line).str());
+    if (count)
+      ctx.addCallGraphEdge(fields[0], fields[1], count);
+  }
+  return std::error_code();
+}
+
 //
 // There are two variants of the  -filelist option:
 //
@@ -469,6 +501,10 @@ bool parse(llvm::ArrayRef<const char *> args, MachOLinkingContext &ctx) {
   if (parsedArgs.getLastArg(OPT_dead_strip))
     ctx.setDeadStripping(true);
 
+  // Handle -deduplicate and -no_deduplicate
+  if (auto *arg = parsedArgs.getLastArg(OPT_deduplicate, OPT_no_deduplicate))
+    ctx.setDeduplicate(arg->getOption().getID() == OPT_deduplicate);
+
   bool globalWholeArchive = false;
   // Handle -all_load
   if (parsedArgs.getLastArg(OPT_all_load))
@@ -554,6 +590,15 @@ bool parse(llvm::ArrayRef<const char *> args, MachOLinkingContext &ctx) {
   if (parsedArgs.getLastArg(OPT_t))
     ctx.setLogInputFiles(true);
 
+  // Handle -time, -time-counters and -time-trace=.
+  if (parsedArgs.getLastArg(OPT_time))
+    ctx.setPrintTiming(true);
+  if (parsedArgs.getLastArg(OPT_time_counters)) {
+    ctx.setPrintTiming(true);
+    Timer::enableCounters();
+  }
+  ctx.setTimeTraceFile(parsedArgs.getLastArgValue(OPT_time_trace_eq));
+
   // Handle -demangle option.
   if (parsedArgs.getLastArg(OPT_demangle))
     ctx.setDemangleSymbols(true);
@@ -587,6 +632,16 @@ bool parse(llvm::ArrayRef<const char *> args, MachOLinkingContext &ctx) {
     }
   }
 
+  // Handle -yaml_cache_dir
+  if (llvm::opt::Arg *cacheDir = parsedArgs.getLastArg(OPT_yaml_cache_dir)) {
+    if (std::error_code ec =
+            llvm::sys::fs::create_directories(cacheDir->getValue()))
+      warn("cannot create -yaml_cache_dir " + Twine(cacheDir->getValue()) +
+           ": " + ec.message());
+    else
+      ctx.setYamlCacheDirectory(cacheDir->getValue());
+  }
+
   // Register possible input file parsers.
   if (!ctx.doNothing()) {
     ctx.registry().addSupportMachOObjects(ctx);
@@ -972,6 +1027,21 @@ bool parse(llvm::ArrayRef<const char *> args, MachOLinkingContext &ctx) {
     }
   }
 
+  // Handle -call_graph_ordering_file <file>
+  if (llvm::opt::Arg *callGraph =
+          parsedArgs.getLastArg(OPT_call_graph_ordering_file)) {
+    if (parsedArgs.hasArg(OPT_order_file)) {
+      error("-order_file and -call_graph_ordering_file may not be used "
+            "together");
+      return false;
+    }
+    if (std::error_code ec = parseCallGraphFile(callGraph->getValue(), ctx)) {
+      error(ec.message() + ", processing '-call_graph_ordering_file " +
+            callGraph->getValue() + "'");
+      return false;
+    }
+  }
+
   // Handle -flat_namespace.
   if (llvm::opt::Arg *ns =
           parsedArgs.getLastArg(OPT_flat_namespace, OPT_twolevel_namespace)) {
@@ -1159,9 +1229,22 @@ bool link(llvm::ArrayRef<const char *> args, bool CanExitEarly,
   if (ctx.getNodes().empty())
     return false;
 
+  if (!ctx.timeTraceFile().empty())
+    startTimeTrace();
+  if (ctx.printTiming())
+    enableTaskTimers();
+  ScopedTimer totalTimer(Timer::root());
+
+  // Read the input files and convert them to atoms in parallel. The resolver
+  // then takes the parsed files in command line order. Parse errors are kept
+  // by each file and reported when the resolver gets to it.
+  ScopedTask readTask(getDefaultDomain(), "Read");
+  std::vector<File *> files;
   for (std::unique_ptr<Node> &ie : ctx.getNodes())
     if (FileNode *node = dyn_cast<FileNode>(ie.get()))
-      node->getFile()->parse();
+      files.push_back(node->getFile());
+  parallelForEach(files, [](File *file) { file->parse(); });
+  readTask.end();
 
   createFiles(ctx, false /* Implicit */);
 
@@ -1214,6 +1297,13 @@ bool link(llvm::ArrayRef<const char *> args, bool CanExitEarly,
                           std::string());
     return false;
   }
+  writeTask.end();
+
+  totalTimer.stop();
+  if (ctx.printTiming())
+    Timer::root().print();
+  if (!ctx.timeTraceFile().empty())
+    writeTimeTrace(ctx.timeTraceFile());
 
   // Call exit() if we can to avoid calling destructors.
   if (CanExitEarly)
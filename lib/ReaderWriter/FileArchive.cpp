@@ -21,7 +21,9 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -66,9 +68,17 @@ public:
       return nullptr;
     _membersInstantiated.insert(memberStart);
 
+    if (_logLoading)
+      logMember(c);
+
     std::unique_ptr<File> result;
-    if (instantiateMember(c, result))
+    auto preloaded = _membersPreloaded.find(memberStart);
+    if (preloaded != _membersPreloaded.end()) {
+      result = std::move(preloaded->second);
+      _membersPreloaded.erase(preloaded);
+    } else if (instantiateMember(c, result)) {
       return nullptr;
+    }
 
     File *file = result.get();
     _filesReturned.push_back(std::move(result));
@@ -77,6 +87,49 @@ public:
     return file;
   }
 
+  /// Parse the members that define any of the given names in parallel, so
+  /// that find() can return them without parsing them itself. Members that
+  /// find() never asks for are parsed for nothing, which is harmless.
+  void preload(ArrayRef<StringRef> names) override {
+    std::vector<std::pair<const char *, Archive::Child>> members;
+    std::set<const char *> seen;
+    for (StringRef name : names) {
+      auto member = _symbolMemberMap.find(name);
+      if (member == _symbolMemberMap.end())
+        continue;
+      Expected<StringRef> buf = member->second.getBuffer();
+      if (!buf) {
+        consumeError(buf.takeError());
+        continue;
+      }
+      const char *memberStart = buf->data();
+      if (_membersInstantiated.count(memberStart) ||
+          _membersPreloaded.count(memberStart) ||
+          !seen.insert(memberStart).second)
+        continue;
+      members.push_back(std::make_pair(memberStart, member->second));
+    }
+
+    std::vector<std::unique_ptr<File>> files(members.size());
+    llvm::parallel::for_each_n(llvm::parallel::par, size_t(0), members.size(),
+                               [&](size_t i) {
+      // Errors are reported when find() parses the member again.
+      if (instantiateMember(members[i].second, files[i]))
+        files[i].reset();
+    });
+    for (size_t i = 0, e = members.size(); i < e; ++i)
+      if (files[i])
+        _membersPreloaded[members[i].first] = std::move(files[i]);
+  }
+
+  std::vector<StringRef> symbols() override {
+    std::vector<StringRef> names;
+    names.reserve(_symbolMemberMap.size());
+    for (const auto &entry : _symbolMemberMap)
+      names.push_back(entry.first);
+    return names;
+  }
+
   /// parse each member
   std::error_code
   parseAllMembers(std::vector<std::unique_ptr<File>> &result) override {
@@ -85,6 +138,8 @@ public:
     llvm::Error err = llvm::Error::success();
     for (auto mf = _archive->child_begin(err), me = _archive->child_end();
          mf != me; ++mf) {
+      if (_logLoading)
+        logMember(*mf);
       std::unique_ptr<File> file;
       if (std::error_code ec = instantiateMember(*mf, file)) {
         // err is Success (or we wouldn't be in the loop body) but we can't
@@ -136,17 +191,24 @@ protected:
   }
 
 private:
+  void logMember(Archive::Child member) const {
+    Expected<llvm::MemoryBufferRef> mbOrErr = member.getMemoryBufferRef();
+    if (!mbOrErr) {
+      consumeError(mbOrErr.takeError());
+      return;
+    }
+    llvm::errs() << _archive->getFileName() << "("
+                 << mbOrErr->getBufferIdentifier() << ")\n";
+  }
+
+  // This is called from several threads at once by preload(), so it must
+  // not touch the state of the archive.
   std::error_code instantiateMember(Archive::Child member,
                                     std::unique_ptr<File> &result) const {
     Expected<llvm::MemoryBufferRef> mbOrErr = member.getMemoryBufferRef();
     if (!mbOrErr)
       return errorToErrorCode(mbOrErr.takeError());
     llvm::MemoryBufferRef mb = mbOrErr.get();
-    std::string memberPath = (_archive->getFileName() + "("
-                           + mb.getBufferIdentifier() + ")").str();
-
-    if (_logLoading)
-      llvm::errs() << memberPath << "\n";
 
     std::unique_ptr<MemoryBuffer> memberMB(MemoryBuffer::getMemBuffer(
         mb.getBuffer(), mb.getBufferIdentifier(), false));
@@ -188,12 +250,14 @@ private:
 
   typedef std::unordered_map<StringRef, Archive::Child> MemberMap;
   typedef std::set<const char *> InstantiatedSet;
+  typedef std::map<const char *, std::unique_ptr<File>> PreloadedMap;
 
   std::shared_ptr<MemoryBuffer> _mb;
   const Registry &_registry;
   std::unique_ptr<Archive> _archive;
   MemberMap _symbolMemberMap;
   InstantiatedSet _membersInstantiated;
+  PreloadedMap _membersPreloaded;
   bool _logLoading;
   std::vector<std::unique_ptr<MemoryBuffer>> _memberBuffers;
   std::vector<std::unique_ptr<File>> _filesReturned;
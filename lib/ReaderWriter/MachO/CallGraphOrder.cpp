@@ -0,0 +1,91 @@
+//===- lib/ReaderWriter/MachO/CallGraphOrder.cpp ----------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphOrder.h"
+#include "MachOPasses.h"
+#include "lld/Common/CallGraphSort.h"
+#include "lld/Core/DefinedAtom.h"
+#include "lld/Core/Simple.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include <vector>
+
+using namespace lld;
+using namespace lld::mach_o;
+
+// The layout pass only orders atoms within a section, so calls between
+// functions which end up in different sections are not worth weighing.
+static bool inSameSection(const DefinedAtom *a, const DefinedAtom *b) {
+  if (a->sectionChoice() != b->sectionChoice())
+    return false;
+  return a->sectionChoice() != DefinedAtom::sectionCustomRequired ||
+         a->customSectionName() == b->customSectionName();
+}
+
+llvm::Error CallGraphOrder::perform(SimpleFile &mergedFile) {
+  _ordinals.clear();
+
+  // Static functions of different files may share a name. As for names
+  // without a file prefix in an -order_file, the profile cannot tell them
+  // apart, and the first one is used.
+  llvm::StringMap<const DefinedAtom *> atomsByName;
+  for (const DefinedAtom *atom : mergedFile.defined())
+    if (atom->contentType() == DefinedAtom::typeCode && !atom->name().empty())
+      atomsByName.insert({atom->name(), atom});
+
+  std::vector<const DefinedAtom *> atoms;
+  std::vector<uint64_t> sizes;
+  std::vector<CallGraphArc> arcs;
+  llvm::DenseMap<const DefinedAtom *, int> atomToNode;
+
+  auto getOrCreateNode = [&](const DefinedAtom *atom) -> int {
+    auto res = atomToNode.insert({atom, (int)atoms.size()});
+    if (res.second) {
+      atoms.push_back(atom);
+      sizes.push_back(atom->size());
+    }
+    return res.first->second;
+  };
+
+  // Functions folded away or dead stripped no longer have an atom, and
+  // their calls are dropped.
+  for (const MachOLinkingContext::CallGraphEdge &edge :
+       _ctx.callGraphProfile()) {
+    const DefinedAtom *from = atomsByName.lookup(edge.from);
+    const DefinedAtom *to = atomsByName.lookup(edge.to);
+    if (!from || !to || !inSameSection(from, to))
+      continue;
+    int fromNode = getOrCreateNode(from);
+    int toNode = getOrCreateNode(to);
+    arcs.push_back({fromNode, toNode, edge.count});
+  }
+
+  CallGraphSortOptions opts;
+  opts.PageSize = _ctx.pageSize();
+  unsigned order = 0;
+  for (int i : sortCallGraph(sizes, arcs, opts))
+    _ordinals[atoms[i]] = order++;
+  return llvm::Error::success();
+}
+
+bool CallGraphOrder::ordinal(const DefinedAtom *atom, unsigned &ordinal) const {
+  auto pos = _ordinals.find(atom);
+  if (pos == _ordinals.end())
+    return false;
+  ordinal = pos->second;
+  return true;
+}
+
+CallGraphOrder &mach_o::addCallGraphOrder(PassManager &pm,
+                                          const MachOLinkingContext &ctx) {
+  auto order = llvm::make_unique<CallGraphOrder>(ctx);
+  CallGraphOrder &ret = *order;
+  pm.add(std::move(order));
+  return ret;
+}
@@ -0,0 +1,47 @@
+//===- lib/ReaderWriter/MachO/CallGraphOrder.h ------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_READER_WRITER_MACHO_CALL_GRAPH_ORDER_H
+#define LLD_READER_WRITER_MACHO_CALL_GRAPH_ORDER_H
+
+#include "lld/Common/LLVM.h"
+#include "lld/Core/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+
+namespace lld {
+class DefinedAtom;
+class MachOLinkingContext;
+class SimpleFile;
+
+namespace mach_o {
+
+/// The order of the functions in the -call_graph_ordering_file, as computed
+/// by the clustering in lld/Common/CallGraphSort.h. It runs as a pass of its
+/// own, after identical code folding and before the layout pass, which puts
+/// the functions it ordered first, like those of an -order_file.
+class CallGraphOrder : public Pass {
+public:
+  explicit CallGraphOrder(const MachOLinkingContext &ctx) : _ctx(ctx) {}
+
+  const char *name() const override { return "CallGraphOrder"; }
+
+  llvm::Error perform(SimpleFile &mergedFile) override;
+
+  /// Returns true and sets ordinal if the atom was ordered by the profile.
+  bool ordinal(const DefinedAtom *atom, unsigned &ordinal) const;
+
+private:
+  const MachOLinkingContext &_ctx;
+  llvm::DenseMap<const DefinedAtom *, unsigned> _ordinals;
+};
+
+} // namespace mach_o
+} // namespace lld
+
+#endif // LLD_READER_WRITER_MACHO_CALL_GRAPH_ORDER_H
@@ -25,6 +25,7 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 
 #define DEBUG_TYPE "macho-compact-unwind"
 
@@ -61,6 +62,16 @@ struct CompactUnwindEntry {
 struct UnwindInfoPage {
   ArrayRef<CompactUnwindEntry> entries;
 };
+
+/// The unwind info the inputs provide for one function: its first
+/// __compact_unwind entry and its last __eh_frame FDE, either of which may be
+/// missing.
+struct FunctionUnwind {
+  const CompactUnwindEntry *compactUnwind = nullptr;
+  const Atom *ehFrame = nullptr;
+};
+
+typedef llvm::DenseMap<const Atom *, FunctionUnwind> FunctionUnwindMap;
 }
 
 class UnwindInfoAtom : public SimpleDefinedAtom {
@@ -280,24 +291,26 @@ public:
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
+  const char *name() const override { return "CompactUnwindPass"; }
+
 private:
   llvm::Error perform(SimpleFile &mergedFile) override {
     LLVM_DEBUG(llvm::dbgs() << "MachO Compact Unwind pass\n");
 
-    std::map<const Atom *, CompactUnwindEntry> unwindLocs;
-    std::map<const Atom *, const Atom *> dwarfFrames;
+    std::vector<CompactUnwindEntry> unwindLocs;
+    FunctionUnwindMap functionUnwind;
     std::vector<const Atom *> personalities;
     uint32_t numLSDAs = 0;
 
     // First collect all __compact_unwind and __eh_frame entries, addressable by
     // the function referred to.
-    collectCompactUnwindEntries(mergedFile, unwindLocs, personalities,
-                                numLSDAs);
+    collectCompactUnwindEntries(mergedFile, unwindLocs, functionUnwind,
+                                personalities, numLSDAs);
 
-    collectDwarfFrameEntries(mergedFile, dwarfFrames);
+    collectDwarfFrameEntries(mergedFile, functionUnwind);
 
     // Skip rest of pass if no unwind info.
-    if (unwindLocs.empty() && dwarfFrames.empty())
+    if (functionUnwind.empty())
       return llvm::Error::success();
 
     // FIXME: if there are more than 4 personality functions then we need to
@@ -311,11 +324,11 @@ private:
     // Now sort the entries by final address and fixup the compact encoding to
     // its final form (i.e. set personality function bits & create DWARF
     // references where needed).
-    std::vector<CompactUnwindEntry> unwindInfos = createUnwindInfoEntries(
-        mergedFile, unwindLocs, personalities, dwarfFrames);
+    std::vector<CompactUnwindEntry> unwindInfos =
+        createUnwindInfoEntries(mergedFile, functionUnwind, personalities);
 
     // Remove any unused eh-frame atoms.
-    pruneUnusedEHFrames(mergedFile, unwindInfos, unwindLocs, dwarfFrames);
+    pruneUnusedEHFrames(mergedFile, unwindInfos, functionUnwind);
 
     // Finally, we can start creating pages based on these entries.
 
@@ -358,18 +371,38 @@ private:
     return llvm::Error::success();
   }
 
-  void collectCompactUnwindEntries(
-      const SimpleFile &mergedFile,
-      std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
-      std::vector<const Atom *> &personalities, uint32_t &numLSDAs) {
-    LLVM_DEBUG(llvm::dbgs() << "  Collecting __compact_unwind entries\n");
+  /// Collects the defined atoms of the given content type, in order.
+  static std::vector<const DefinedAtom *>
+  atomsOfType(const SimpleFile &mergedFile, DefinedAtom::ContentType type) {
+    std::vector<const DefinedAtom *> atoms;
+    for (const DefinedAtom *atom : mergedFile.defined())
+      if (atom->contentType() == type)
+        atoms.push_back(atom);
+    return atoms;
+  }
 
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      if (atom->contentType() != DefinedAtom::typeCompactUnwindInfo)
-        continue;
+  void collectCompactUnwindEntries(const SimpleFile &mergedFile,
+                                   std::vector<CompactUnwindEntry> &unwindLocs,
+                                   FunctionUnwindMap &functionUnwind,
+                                   std::vector<const Atom *> &personalities,
+                                   uint32_t &numLSDAs) {
+    LLVM_DEBUG(llvm::dbgs() << "  Collecting __compact_unwind entries\n");
 
-      auto unwindEntry = extractCompactUnwindEntry(atom);
-      unwindLocs.insert(std::make_pair(unwindEntry.rangeStart, unwindEntry));
+    // Decoding an entry only reads its own atom, so do that in parallel.
+    std::vector<const DefinedAtom *> atoms =
+        atomsOfType(mergedFile, DefinedAtom::typeCompactUnwindInfo);
+    unwindLocs.resize(atoms.size());
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, size_t(0), atoms.size(),
+        [&](size_t i) { unwindLocs[i] = extractCompactUnwindEntry(atoms[i]); });
+
+    // unwindLocs is not resized from here on, so functionUnwind can point into
+    // it.
+    for (const CompactUnwindEntry &unwindEntry : unwindLocs) {
+      // The first entry for a function wins.
+      FunctionUnwind &info = functionUnwind[unwindEntry.rangeStart];
+      if (!info.compactUnwind)
+        info.compactUnwind = &unwindEntry;
 
       LLVM_DEBUG(llvm::dbgs() << "    Entry for "
                               << unwindEntry.rangeStart->name() << ", encoding="
@@ -430,18 +463,23 @@ private:
     return entry;
   }
 
-  void
-  collectDwarfFrameEntries(const SimpleFile &mergedFile,
-                           std::map<const Atom *, const Atom *> &dwarfFrames) {
-    for (const DefinedAtom *ehFrameAtom : mergedFile.defined()) {
-      if (ehFrameAtom->contentType() != DefinedAtom::typeCFI)
-        continue;
-      if (ArchHandler::isDwarfCIE(_isBig, ehFrameAtom))
-        continue;
-
-      if (const Atom *function = _archHandler.fdeTargetFunction(ehFrameAtom))
-        dwarfFrames[function] = ehFrameAtom;
-    }
+  void collectDwarfFrameEntries(const SimpleFile &mergedFile,
+                                FunctionUnwindMap &functionUnwind) {
+    // Finding the function an FDE covers means walking its references, so
+    // do that in parallel and record the results in order afterwards.
+    std::vector<const DefinedAtom *> atoms =
+        atomsOfType(mergedFile, DefinedAtom::typeCFI);
+    std::vector<const Atom *> functions(atoms.size());
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, size_t(0), atoms.size(), [&](size_t i) {
+          if (!ArchHandler::isDwarfCIE(_isBig, atoms[i]))
+            functions[i] = _archHandler.fdeTargetFunction(atoms[i]);
+        });
+
+    // The last FDE for a function wins.
+    for (size_t i = 0, e = atoms.size(); i != e; ++i)
+      if (functions[i])
+        functionUnwind[functions[i]].ehFrame = atoms[i];
   }
 
   /// Every atom defined in __TEXT,__text needs an entry in the final
@@ -450,29 +488,29 @@ private:
   ///      personality function offset which is only known now).
   ///   + A synthesised reference to __eh_frame if there's no __compact_unwind
   ///     or too many personality functions to be accommodated.
-  std::vector<CompactUnwindEntry> createUnwindInfoEntries(
-      const SimpleFile &mergedFile,
-      const std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
-      const std::vector<const Atom *> &personalities,
-      const std::map<const Atom *, const Atom *> &dwarfFrames) {
-    std::vector<CompactUnwindEntry> unwindInfos;
-
+  std::vector<CompactUnwindEntry>
+  createUnwindInfoEntries(const SimpleFile &mergedFile,
+                          const FunctionUnwindMap &functionUnwind,
+                          const std::vector<const Atom *> &personalities) {
     LLVM_DEBUG(llvm::dbgs() << "  Creating __unwind_info entries\n");
     // The final order in the __unwind_info section must be derived from the
     // order of typeCode atoms, since that's how they'll be put into the object
     // file eventually (yuck!).
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      if (atom->contentType() != DefinedAtom::typeCode)
-        continue;
-
-      unwindInfos.push_back(finalizeUnwindInfoEntryForAtom(
-          atom, unwindLocs, personalities, dwarfFrames));
-
-      LLVM_DEBUG(llvm::dbgs()
-                 << "    Entry for " << atom->name() << ", final encoding="
-                 << llvm::format("0x%08x", unwindInfos.back().encoding)
-                 << '\n');
-    }
+    std::vector<const DefinedAtom *> functions =
+        atomsOfType(mergedFile, DefinedAtom::typeCode);
+    std::vector<CompactUnwindEntry> unwindInfos(functions.size());
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, size_t(0), functions.size(), [&](size_t i) {
+          unwindInfos[i] = finalizeUnwindInfoEntryForAtom(
+              functions[i], functionUnwind, personalities);
+        });
+
+    LLVM_DEBUG({
+      for (const CompactUnwindEntry &entry : unwindInfos)
+        llvm::dbgs() << "    Entry for " << entry.rangeStart->name()
+                     << ", final encoding="
+                     << llvm::format("0x%08x", entry.encoding) << '\n';
+    });
 
     return unwindInfos;
   }
@@ -481,11 +519,9 @@ private:
   ///
   /// An EH frame is considered unused if there is a corresponding compact
   /// unwind atom that doesn't require the EH frame.
-  void pruneUnusedEHFrames(
-                   SimpleFile &mergedFile,
-                   const std::vector<CompactUnwindEntry> &unwindInfos,
-                   const std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
-                   const std::map<const Atom *, const Atom *> &dwarfFrames) {
+  void pruneUnusedEHFrames(SimpleFile &mergedFile,
+                           const std::vector<CompactUnwindEntry> &unwindInfos,
+                           const FunctionUnwindMap &functionUnwind) {
 
     // Worklist of all 'used' FDEs.
     std::vector<const DefinedAtom *> usedDwarfWorklist;
@@ -498,9 +534,9 @@ private:
 
     // (2) EH frames that reference functions with no corresponding compact
     //     unwind info.
-    for (auto &entry : dwarfFrames)
-      if (!unwindLocs.count(entry.first))
-        usedDwarfWorklist.push_back(cast<DefinedAtom>(entry.second));
+    for (auto &entry : functionUnwind)
+      if (entry.second.ehFrame && !entry.second.compactUnwind)
+        usedDwarfWorklist.push_back(cast<DefinedAtom>(entry.second.ehFrame));
 
     // Add all transitively referenced CFI atoms by processing the worklist.
     std::set<const Atom *> usedDwarfFrames;
@@ -525,31 +561,28 @@ private:
   }
 
   CompactUnwindEntry finalizeUnwindInfoEntryForAtom(
-      const DefinedAtom *function,
-      const std::map<const Atom *, CompactUnwindEntry> &unwindLocs,
-      const std::vector<const Atom *> &personalities,
-      const std::map<const Atom *, const Atom *> &dwarfFrames) {
-    auto unwindLoc = unwindLocs.find(function);
+      const DefinedAtom *function, const FunctionUnwindMap &functionUnwind,
+      const std::vector<const Atom *> &personalities) {
+    // A single lookup gives both the __compact_unwind entry and the FDE.
+    FunctionUnwind info = functionUnwind.lookup(function);
 
     CompactUnwindEntry entry;
-    if (unwindLoc == unwindLocs.end()) {
+    if (!info.compactUnwind) {
       // Default entry has correct encoding (0 => no unwind), but we need to
       // synthesise the function.
       entry.rangeStart = function;
       entry.rangeLength = function->size();
     } else
-      entry = unwindLoc->second;
+      entry = *info.compactUnwind;
 
 
     // If there's no __compact_unwind entry, or it explicitly says to use
     // __eh_frame, we need to try and fill in the correct DWARF atom.
-    if (entry.encoding == _archHandler.dwarfCompactUnwindType() ||
-        entry.encoding == 0) {
-      auto dwarfFrame = dwarfFrames.find(function);
-      if (dwarfFrame != dwarfFrames.end()) {
-        entry.encoding = _archHandler.dwarfCompactUnwindType();
-        entry.ehFrame = dwarfFrame->second;
-      }
+    if ((entry.encoding == _archHandler.dwarfCompactUnwindType() ||
+         entry.encoding == 0) &&
+        info.ehFrame) {
+      entry.encoding = _archHandler.dwarfCompactUnwindType();
+      entry.ehFrame = info.ehFrame;
     }
 
     auto personality = std::find(personalities.begin(), personalities.end(),
@@ -307,6 +307,12 @@ public:
     _nameToAtom[name] = info;
   }
 
+  /// Makes exports() look up symbols in the export trie of the dylib, which
+  /// must stay mapped, instead of in the symbols added above. Dylibs export
+  /// many more symbols than a link uses, so this is cheaper than adding
+  /// them all.
+  void setExportTrie(ArrayRef<uint8_t> trie) { _exportTrie = trie; }
+
   void addReExportedDylib(StringRef dylibPath) {
     _reExportedDylibs.emplace_back(dylibPath);
   }
@@ -321,17 +327,16 @@ public:
 
   typedef std::function<MachODylibFile *(StringRef)> FindDylib;
 
-  void loadReExportedDylibs(FindDylib find) {
-    for (ReExportedDylib &entry : _reExportedDylibs) {
-      entry.file = find(entry.path);
-    }
-  }
+  /// Sets the function used to load re-exported dylibs. They are loaded
+  /// when a symbol is first looked up in them.
+  void loadReExportedDylibs(FindDylib find) { _findDylib = std::move(find); }
 
   StringRef getDSOName() const override { return _installName; }
 
   std::error_code doParse() override {
     // Convert binary file to normalized mach-o.
-    auto normFile = normalized::readBinary(_mb, _ctx->arch());
+    auto normFile = normalized::readBinary(_mb, _ctx->arch(),
+                                         /*expandExports=*/false);
     if (auto ec = normFile.takeError())
       return llvm::errorToErrorCode(std::move(ec));
     // Convert normalized mach-o to atoms.
@@ -345,6 +350,13 @@ private:
                                    StringRef installName) const {
     // First, check if requested symbol is directly implemented by this dylib.
     auto entry = _nameToAtom.find(name);
+    uint64_t flags;
+    if (entry == _nameToAtom.end() && !_exportTrie.empty() &&
+        normalized::lookupExportTrie(_exportTrie, name, flags)) {
+      bool weakDef = flags & llvm::MachO::EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION;
+      name = name.copy(allocator());
+      entry = _nameToAtom.insert({name, AtomAndFlags(weakDef)}).first;
+    }
     if (entry != _nameToAtom.end()) {
       // FIXME: Make this map a set and only used in assert builds.
       // Note, its safe to assert here as the resolver is the only client of
@@ -361,8 +373,15 @@ private:
     }
 
     // Next, check if symbol is implemented in some re-exported dylib.
-    for (const ReExportedDylib &dylib : _reExportedDylibs) {
-      assert(dylib.file);
+    for (ReExportedDylib &dylib : _reExportedDylibs) {
+      if (!dylib.loaded && _findDylib) {
+        dylib.loaded = true;
+        dylib.file = _findDylib(dylib.path);
+        if (dylib.file)
+          dylib.file->loadReExportedDylibs(_findDylib);
+      }
+      if (!dylib.file)
+        continue;
       auto atom = dylib.file->exports(name, installName);
       if (atom.get())
         return atom;
@@ -373,9 +392,10 @@ private:
   }
 
   struct ReExportedDylib {
-    ReExportedDylib(StringRef p) : path(p), file(nullptr) { }
+    ReExportedDylib(StringRef p) : path(p), file(nullptr), loaded(false) { }
     StringRef       path;
     MachODylibFile *file;
+    bool            loaded;
   };
 
   struct AtomAndFlags {
@@ -390,7 +410,9 @@ private:
   StringRef                                  _installName;
   uint32_t                                   _currentVersion;
   uint32_t                                   _compatVersion;
-  std::vector<ReExportedDylib>               _reExportedDylibs;
+  mutable std::vector<ReExportedDylib>       _reExportedDylibs;
+  FindDylib                                  _findDylib;
+  ArrayRef<uint8_t>                          _exportTrie;
   mutable std::unordered_map<StringRef, AtomAndFlags> _nameToAtom;
 };
 
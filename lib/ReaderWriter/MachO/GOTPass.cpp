@@ -35,6 +35,7 @@
 #include "ArchHandler.h"
 #include "File.h"
 #include "MachOPasses.h"
+#include "ReferenceScan.h"
 #include "lld/Common/LLVM.h"
 #include "lld/Core/DefinedAtom.h"
 #include "lld/Core/File.h"
@@ -91,34 +92,31 @@ private:
 ///
 class GOTPass : public Pass {
 public:
-  GOTPass(const MachOLinkingContext &context)
-      : _ctx(context), _archHandler(_ctx.archHandler()),
+  GOTPass(const MachOLinkingContext &context, const ReferenceScan &scan)
+      : _ctx(context), _archHandler(_ctx.archHandler()), _scan(scan),
         _file(*_ctx.make_file<MachOFile>("<mach-o GOT Pass>")) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
+  const char *name() const override { return "GOTPass"; }
+
 private:
   llvm::Error perform(SimpleFile &mergedFile) override {
-    // Scan all references in all atoms.
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        // Look at instructions accessing the GOT.
-        bool canBypassGOT;
-        if (!_archHandler.isGOTAccess(*ref, canBypassGOT))
-          continue;
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-
-        if (!shouldReplaceTargetWithGOTAtom(target, canBypassGOT)) {
-          // Update reference kind to reflect that target is a direct accesss.
-          _archHandler.updateReferenceToGOT(ref, false);
-        } else {
-          // Replace the target with a reference to a GOT entry.
-          const DefinedAtom *gotEntry = makeGOTEntry(target);
-          const_cast<Reference *>(ref)->setTarget(gotEntry);
-          // Update reference kind to reflect that target is now a GOT entry.
-          _archHandler.updateReferenceToGOT(ref, true);
-        }
+    // Look at all instructions accessing the GOT.
+    for (const ReferenceScan::Use &use : _scan.gotAccesses()) {
+      const Reference *ref = use.ref;
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+
+      if (!shouldReplaceTargetWithGOTAtom(target, use.canBypassGOT)) {
+        // Update reference kind to reflect that target is a direct accesss.
+        _archHandler.updateReferenceToGOT(ref, false);
+      } else {
+        // Replace the target with a reference to a GOT entry.
+        const DefinedAtom *gotEntry = makeGOTEntry(target);
+        const_cast<Reference *>(ref)->setTarget(gotEntry);
+        // Update reference kind to reflect that target is now a GOT entry.
+        _archHandler.updateReferenceToGOT(ref, true);
       }
     }
 
@@ -171,13 +169,15 @@ private:
 
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler                             &_archHandler;
+  const ReferenceScan                             &_scan;
   MachOFile                                       &_file;
   llvm::DenseMap<const Atom*, const GOTEntryAtom*> _targetToGOT;
 };
 
-void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx) {
+void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceScan &scan) {
   assert(ctx.needsGOTPass());
-  pm.add(llvm::make_unique<GOTPass>(ctx));
+  pm.add(llvm::make_unique<GOTPass>(ctx, scan));
 }
 
 } // end namesapce mach_o
@@ -0,0 +1,382 @@
+//===- lib/ReaderWriter/MachO/ICFPass.cpp -----------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This linker pass folds identical functions (-deduplicate). Two code atoms
+/// are identical if they have the same content and attributes, the same
+/// compact unwind encoding, and references of the same kinds at the same
+/// offsets to the same targets, where two targets which are themselves
+/// foldable count as the same if they are identical. References to every
+/// folded atom are redirected to the first atom of its class, and the
+/// folded atoms are removed.
+///
+/// Like ELF and COFF ICF, this starts from classes of atoms that agree on
+/// everything except the targets which are themselves foldable, then splits
+/// classes by the classes of those targets until nothing changes.
+///
+/// An atom is only folded if nothing can tell: it must be local to the
+/// linkage unit, not interposable, and only ever called or branched to. An
+/// atom whose address is taken by some other reference, or which has an
+/// LSDA or an __eh_frame FDE, is left alone.
+///
+//===----------------------------------------------------------------------===//
+
+#include "ArchHandler.h"
+#include "MachONormalizedFileBinaryUtils.h"
+#include "MachOPasses.h"
+#include "lld/Common/LLVM.h"
+#include "lld/Core/DefinedAtom.h"
+#include "lld/Core/DefinedAtomTable.h"
+#include "lld/Core/File.h"
+#include "lld/Core/Reference.h"
+#include "lld/Core/Simple.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+#define DEBUG_TYPE "macho-icf"
+
+namespace lld {
+namespace mach_o {
+
+class ICFPass : public Pass {
+public:
+  ICFPass(const MachOLinkingContext &context)
+      : _ctx(context), _archHandler(_ctx.archHandler()) {}
+
+  const char *name() const override { return "ICFPass"; }
+
+  llvm::Error perform(SimpleFile &mergedFile) override {
+    LLVM_DEBUG(llvm::dbgs() << "MachO ICF pass\n");
+
+    // Atoms are compared many times, so read them into arrays once.
+    DefinedAtomTable table(mergedFile);
+    _table = &table;
+    collectCandidates();
+    if (_ids.size() < 2)
+      return llvm::Error::success();
+
+    // Start from a single class and split it by everything but the classes
+    // of the targets, then by those until the number of classes is stable.
+    size_t numAtoms = _ids.size();
+    _classes.assign(numAtoms, 0);
+    std::vector<uint64_t> hashes(numAtoms);
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, size_t(0), numAtoms,
+        [&](size_t i) { hashes[i] = constantHash(i); });
+    size_t numClasses = segregate(hashes, [&](uint32_t a, uint32_t b) {
+      return equalsConstant(a, b);
+    });
+
+    for (;;) {
+      llvm::parallel::for_each_n(
+          llvm::parallel::par, size_t(0), numAtoms,
+          [&](size_t i) { hashes[i] = variableHash(i); });
+      size_t n = segregate(hashes, [&](uint32_t a, uint32_t b) {
+        return equalsVariable(a, b);
+      });
+      if (n == numClasses)
+        break;
+      numClasses = n;
+    }
+    if (numClasses == numAtoms)
+      return llvm::Error::success();
+
+    // The representative of a class is its first atom in input order.
+    std::vector<int64_t> leaders(numClasses, -1);
+    llvm::DenseMap<const Atom *, const Atom *> replacements;
+    for (uint32_t i = 0; i < numAtoms; ++i) {
+      int64_t &leader = leaders[_classes[i]];
+      if (leader < 0) {
+        leader = i;
+        continue;
+      }
+      const DefinedAtom *atom = table.atom(_ids[i]);
+      const DefinedAtom *into = table.atom(_ids[leader]);
+      LLVM_DEBUG(llvm::dbgs() << "  Folding " << atom->name() << " into "
+                              << into->name() << '\n');
+      replacements[atom] = into;
+    }
+
+    // Each reference belongs to one atom, so they can be redirected in
+    // parallel.
+    ArrayRef<const Reference *> refs = table.allReferences();
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, size_t(0), refs.size(), [&](size_t i) {
+          auto pos = replacements.find(refs[i]->target());
+          if (pos != replacements.end())
+            const_cast<Reference *>(refs[i])->setTarget(pos->second);
+        });
+
+    mergedFile.removeDefinedAtomsIf([&](const DefinedAtom *atom) {
+      return replacements.count(atom);
+    });
+    return llvm::Error::success();
+  }
+
+private:
+  /// The compact unwind encoding and personality function of an atom.
+  struct UnwindKey {
+    uint32_t encoding = 0;
+    const Atom *personality = nullptr;
+
+    bool operator==(const UnwindKey &other) const {
+      return encoding == other.encoding && personality == other.personality;
+    }
+  };
+
+  // What a reference of a candidate points to, in _targets.
+  enum : int32_t { targetSelf = -2, targetOther = -1 };
+
+  bool mayFold(uint32_t id) const {
+    return _table->contentType(id) == DefinedAtom::typeCode &&
+           _table->scope(id) != DefinedAtom::scopeGlobal &&
+           _table->interposable(id) == DefinedAtom::interposeNo &&
+           _table->deadStrip(id) != DefinedAtom::deadStripNever &&
+           _table->sectionChoice(id) == DefinedAtom::sectionBasedOnContent;
+  }
+
+  /// Finds the code atoms that may be folded and their unwind info.
+  void collectCandidates() {
+    const DefinedAtomTable &table = *_table;
+    llvm::DenseSet<const Atom *> pinned;
+    llvm::DenseMap<const Atom *, UnwindKey> unwind;
+
+    for (uint32_t id = 0, e = table.size(); id != e; ++id) {
+      const DefinedAtom *atom = table.atom(id);
+      switch (table.contentType(id)) {
+      case DefinedAtom::typeCompactUnwindInfo: {
+        // See CompactUnwindPass for the layout of these entries.
+        const Atom *function = nullptr;
+        UnwindKey key;
+        bool hasLSDA = false;
+        for (const Reference *ref : table.references(id)) {
+          if (ref->offsetInAtom() == 0)
+            function = ref->target();
+          else if (ref->offsetInAtom() == 0x10)
+            key.personality = ref->target();
+          else if (ref->offsetInAtom() == 0x18)
+            hasLSDA = true;
+        }
+        if (!function)
+          break;
+        ArrayRef<uint8_t> content = table.rawContent(id);
+        if (content.size() >= 4 * sizeof(uint32_t))
+          key.encoding = normalized::read32(
+              content.data() + 3 * sizeof(uint32_t),
+              MachOLinkingContext::isBigEndian(_ctx.arch()));
+        // A function with an LSDA or more than one entry is not folded.
+        if (hasLSDA || !unwind.insert(std::make_pair(function, key)).second)
+          pinned.insert(function);
+        break;
+      }
+      case DefinedAtom::typeCFI:
+        // FDEs and the personality functions of CIEs.
+        for (const Reference *ref : table.references(id))
+          pinned.insert(ref->target());
+        break;
+      default:
+        for (const Reference *ref : table.references(id)) {
+          // Atoms which must stay next to each other stay where they are.
+          if (ref->kindNamespace() == Reference::KindNamespace::all &&
+              ref->kindValue() == Reference::kindLayoutAfter) {
+            pinned.insert(atom);
+            pinned.insert(ref->target());
+            continue;
+          }
+          if (ref->kindNamespace() != Reference::KindNamespace::mach_o ||
+              ref->target() == atom)
+            continue;
+          if (table.contentType(id) == DefinedAtom::typeCode &&
+              (_archHandler.isCallSite(*ref) ||
+               _archHandler.isNonCallBranch(*ref)))
+            continue;
+          // Anything else may compare or store the address.
+          pinned.insert(ref->target());
+        }
+        break;
+      }
+    }
+
+    std::vector<int32_t> candidateOf(table.size(), targetOther);
+    for (uint32_t id = 0, e = table.size(); id != e; ++id) {
+      const DefinedAtom *atom = table.atom(id);
+      if (!mayFold(id) || pinned.count(atom))
+        continue;
+      candidateOf[id] = _ids.size();
+      _ids.push_back(id);
+      _unwind.push_back(unwind.lookup(atom));
+      _isThumb.push_back(_archHandler.isThumbFunction(*atom));
+    }
+
+    // Resolve the target of every reference of every candidate up front, so
+    // that comparing atoms needs no lookups.
+    _targets.assign(table.allReferences().size(), targetOther);
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, size_t(0), _ids.size(), [&](size_t i) {
+          uint32_t id = _ids[i];
+          uint32_t first = table.firstReference(id);
+          ArrayRef<const Reference *> refs = table.references(id);
+          for (size_t k = 0, e = refs.size(); k != e; ++k) {
+            const Atom *target = refs[k]->target();
+            int64_t targetId = table.find(target);
+            if (target == table.atom(id))
+              _targets[first + k] = targetSelf;
+            else if (targetId >= 0)
+              _targets[first + k] = candidateOf[targetId];
+          }
+        });
+  }
+
+  uint64_t constantHash(uint32_t i) const {
+    uint32_t id = _ids[i];
+    ArrayRef<uint8_t> content = _table->rawContent(id);
+    llvm::hash_code hash = llvm::hash_combine(
+        _table->atomSize(id), _table->contentType(id), _unwind[i].encoding,
+        _unwind[i].personality,
+        llvm::hash_combine_range(content.begin(), content.end()));
+    ArrayRef<const Reference *> refs = _table->references(id);
+    const int32_t *targets = &_targets[_table->firstReference(id)];
+    for (size_t k = 0, e = refs.size(); k != e; ++k) {
+      const Reference *ref = refs[k];
+      const Atom *target =
+          targets[k] == targetOther ? ref->target() : nullptr;
+      hash = llvm::hash_combine(hash, ref->kindValue(), ref->offsetInAtom(),
+                                ref->addend(), target);
+    }
+    return hash;
+  }
+
+  uint64_t variableHash(uint32_t i) const {
+    uint32_t id = _ids[i];
+    llvm::hash_code hash = llvm::hash_value(_classes[i]);
+    const int32_t *targets = &_targets[_table->firstReference(id)];
+    for (size_t k = 0, e = _table->references(id).size(); k != e; ++k)
+      if (targets[k] >= 0)
+        hash = llvm::hash_combine(hash, _classes[targets[k]]);
+    return hash;
+  }
+
+  /// Compares everything but the classes of candidate targets.
+  bool equalsConstant(uint32_t i, uint32_t j) const {
+    const DefinedAtomTable &table = *_table;
+    uint32_t a = _ids[i];
+    uint32_t b = _ids[j];
+    if (table.atomSize(a) != table.atomSize(b) ||
+        table.contentType(a) != table.contentType(b) ||
+        !(table.alignment(a) == table.alignment(b)) ||
+        table.permissions(a) != table.permissions(b) ||
+        _isThumb[i] != _isThumb[j] || !(_unwind[i] == _unwind[j]) ||
+        table.rawContent(a) != table.rawContent(b))
+      return false;
+
+    ArrayRef<const Reference *> refsA = table.references(a);
+    ArrayRef<const Reference *> refsB = table.references(b);
+    if (refsA.size() != refsB.size())
+      return false;
+    const int32_t *targetsA = &_targets[table.firstReference(a)];
+    const int32_t *targetsB = &_targets[table.firstReference(b)];
+    for (size_t k = 0, e = refsA.size(); k != e; ++k) {
+      const Reference *ra = refsA[k];
+      const Reference *rb = refsB[k];
+      if (ra->kindNamespace() != rb->kindNamespace() ||
+          ra->kindArch() != rb->kindArch() ||
+          ra->kindValue() != rb->kindValue() ||
+          ra->offsetInAtom() != rb->offsetInAtom() ||
+          ra->addend() != rb->addend())
+        return false;
+      if ((targetsA[k] == targetSelf) != (targetsB[k] == targetSelf))
+        return false;
+      if ((targetsA[k] == targetOther || targetsB[k] == targetOther) &&
+          ra->target() != rb->target())
+        return false;
+    }
+    return true;
+  }
+
+  /// Compares the classes of candidate targets of two atoms which are known
+  /// to be equal otherwise.
+  bool equalsVariable(uint32_t i, uint32_t j) const {
+    uint32_t a = _ids[i];
+    uint32_t b = _ids[j];
+    const int32_t *targetsA = &_targets[_table->firstReference(a)];
+    const int32_t *targetsB = &_targets[_table->firstReference(b)];
+    for (size_t k = 0, e = _table->references(a).size(); k != e; ++k)
+      if (targetsA[k] >= 0 && _classes[targetsA[k]] != _classes[targetsB[k]])
+        return false;
+    return true;
+  }
+
+  /// Splits each class into the atoms which equal() considers the same,
+  /// using hashes to keep the comparisons within small groups. Returns the
+  /// number of classes.
+  size_t segregate(ArrayRef<uint64_t> hashes,
+                   llvm::function_ref<bool(uint32_t, uint32_t)> equal) {
+    std::vector<uint32_t> order(_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    sort(llvm::parallel::par, order.begin(), order.end(),
+         [&](uint32_t a, uint32_t b) {
+           return std::make_tuple(_classes[a], hashes[a], a) <
+                  std::make_tuple(_classes[b], hashes[b], b);
+         });
+
+    std::vector<uint32_t> classes(_ids.size());
+    std::vector<uint32_t> leaders;
+    size_t numClasses = 0;
+    for (size_t begin = 0, end; begin < order.size(); begin = end) {
+      uint32_t first = order[begin];
+      for (end = begin + 1; end < order.size(); ++end)
+        if (_classes[order[end]] != _classes[first] ||
+            hashes[order[end]] != hashes[first])
+          break;
+
+      // Atoms in a group are almost always equal, so this is usually linear.
+      leaders.clear();
+      for (size_t k = begin; k < end; ++k) {
+        uint32_t atom = order[k];
+        auto leader = llvm::find_if(
+            leaders, [&](uint32_t l) { return equal(l, atom); });
+        if (leader != leaders.end()) {
+          classes[atom] = classes[*leader];
+          continue;
+        }
+        leaders.push_back(atom);
+        classes[atom] = numClasses++;
+      }
+    }
+    _classes = std::move(classes);
+    return numClasses;
+  }
+
+  const MachOLinkingContext &_ctx;
+  mach_o::ArchHandler &_archHandler;
+  const DefinedAtomTable *_table = nullptr;
+  // The table ids of the candidates.
+  std::vector<uint32_t> _ids;
+  // For each reference in the table, the candidate it refers to, or
+  // targetSelf or targetOther. Only set for references of candidates.
+  std::vector<int32_t> _targets;
+  std::vector<UnwindKey> _unwind;
+  std::vector<bool> _isThumb;
+  std::vector<uint32_t> _classes;
+};
+
+void addICFPass(PassManager &pm, const MachOLinkingContext &ctx) {
+  assert(ctx.needsICFPass());
+  pm.add(llvm::make_unique<ICFPass>(ctx));
+}
+
+} // end namespace mach_o
+} // end namespace lld
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "LayoutPass.h"
+#include "CallGraphOrder.h"
 #include "lld/Core/Instrumentation.h"
 #include "lld/Core/PassManager.h"
 #include "lld/ReaderWriter/MachOLinkingContext.h"
@@ -27,8 +28,7 @@ namespace lld {
 namespace mach_o {
 
 static bool compareAtoms(const LayoutPass::SortKey &,
-                         const LayoutPass::SortKey &,
-                         LayoutPass::SortOverride customSorter);
+                         const LayoutPass::SortKey &);
 
 #ifndef NDEBUG
 // Return "reason (leftval, rightval)"
@@ -40,12 +40,11 @@ static std::string formatReason(StringRef reason, int leftVal, int rightVal) {
 // Less-than relationship of two atoms must be transitive, which is, if a < b
 // and b < c, a < c must be true. This function checks the transitivity by
 // checking the sort results.
-static void checkTransitivity(std::vector<LayoutPass::SortKey> &vec,
-                              LayoutPass::SortOverride customSorter) {
+static void checkTransitivity(std::vector<LayoutPass::SortKey> &vec) {
   for (auto i = vec.begin(), e = vec.end(); (i + 1) != e; ++i) {
     for (auto j = i + 1; j != e; ++j) {
-      assert(compareAtoms(*i, *j, customSorter));
-      assert(!compareAtoms(*j, *i, customSorter));
+      assert(compareAtoms(*i, *j));
+      assert(!compareAtoms(*j, *i));
     }
   }
 }
@@ -170,12 +169,12 @@ void LayoutPass::checkFollowonChain(const File::AtomRange<DefinedAtom> &range) {
 /// a) Sorts atoms by their ordinal overrides (layout-after/ingroup)
 /// b) Sorts atoms by their permissions
 /// c) Sorts atoms by their content
-/// d) Sorts atoms by custom sorter
+/// d) Sorts atoms by their position in the order file, if any
 /// e) Sorts atoms on how they appear using File Ordinality
 /// f) Sorts atoms on how they appear within the File
+/// b) to d) are packed into SortKey::_group, so they are compared at once.
 static bool compareAtomsSub(const LayoutPass::SortKey &lc,
                             const LayoutPass::SortKey &rc,
-                            LayoutPass::SortOverride customSorter,
                             std::string &reason) {
   const DefinedAtom *left = lc._atom.get();
   const DefinedAtom *right = rc._atom.get();
@@ -184,62 +183,33 @@ static bool compareAtomsSub(const LayoutPass::SortKey &lc,
     return false;
   }
 
-  // Find the root of the chain if it is a part of a follow-on chain.
-  const DefinedAtom *leftRoot = lc._root;
-  const DefinedAtom *rightRoot = rc._root;
-
   // Sort atoms by their ordinal overrides only if they fall in the same
   // chain.
-  if (leftRoot == rightRoot) {
+  if (lc._root == rc._root) {
     LLVM_DEBUG(reason = formatReason("override", lc._override, rc._override));
     return lc._override < rc._override;
   }
 
-  // Sort same permissions together.
-  DefinedAtom::ContentPermissions leftPerms = leftRoot->permissions();
-  DefinedAtom::ContentPermissions rightPerms = rightRoot->permissions();
-
-  if (leftPerms != rightPerms) {
-    LLVM_DEBUG(
-        reason = formatReason("contentPerms", (int)leftPerms, (int)rightPerms));
-    return leftPerms < rightPerms;
-  }
-
-  // Sort same content types together.
-  DefinedAtom::ContentType leftType = leftRoot->contentType();
-  DefinedAtom::ContentType rightType = rightRoot->contentType();
-
-  if (leftType != rightType) {
-    LLVM_DEBUG(reason =
-                   formatReason("contentType", (int)leftType, (int)rightType));
-    return leftType < rightType;
-  }
-
-  // Use custom sorter if supplied.
-  if (customSorter) {
-    bool leftBeforeRight;
-    if (customSorter(leftRoot, rightRoot, leftBeforeRight))
-      return leftBeforeRight;
+  // Sort same permissions, then same content types together, then by order
+  // file.
+  if (lc._group != rc._group) {
+    LLVM_DEBUG(reason = formatReason("group", (int)(lc._group >> 48),
+                                     (int)(rc._group >> 48)));
+    return lc._group < rc._group;
   }
 
   // Sort by .o order.
-  const File *leftFile = &leftRoot->file();
-  const File *rightFile = &rightRoot->file();
-
-  if (leftFile != rightFile) {
-    LLVM_DEBUG(reason = formatReason(".o order", (int)leftFile->ordinal(),
-                                     (int)rightFile->ordinal()));
-    return leftFile->ordinal() < rightFile->ordinal();
+  if (lc._fileOrdinal != rc._fileOrdinal) {
+    LLVM_DEBUG(reason = formatReason(".o order", (int)lc._fileOrdinal,
+                                     (int)rc._fileOrdinal));
+    return lc._fileOrdinal < rc._fileOrdinal;
   }
 
   // Sort by atom order with .o file.
-  uint64_t leftOrdinal = leftRoot->ordinal();
-  uint64_t rightOrdinal = rightRoot->ordinal();
-
-  if (leftOrdinal != rightOrdinal) {
-    LLVM_DEBUG(reason = formatReason("ordinal", (int)leftRoot->ordinal(),
-                                     (int)rightRoot->ordinal()));
-    return leftOrdinal < rightOrdinal;
+  if (lc._ordinal != rc._ordinal) {
+    LLVM_DEBUG(reason = formatReason("ordinal", (int)lc._ordinal,
+                                     (int)rc._ordinal));
+    return lc._ordinal < rc._ordinal;
   }
 
   llvm::errs() << "Unordered: <" << left->name() << "> <"
@@ -248,10 +218,9 @@ static bool compareAtomsSub(const LayoutPass::SortKey &lc,
 }
 
 static bool compareAtoms(const LayoutPass::SortKey &lc,
-                         const LayoutPass::SortKey &rc,
-                         LayoutPass::SortOverride customSorter) {
+                         const LayoutPass::SortKey &rc) {
   std::string reason;
-  bool result = compareAtomsSub(lc, rc, customSorter, reason);
+  bool result = compareAtomsSub(lc, rc, reason);
   LLVM_DEBUG({
     StringRef comp = result ? "<" : ">=";
     llvm::dbgs() << "Layout: '" << lc._atom.get()->name()
@@ -423,13 +392,30 @@ LayoutPass::buildOrdinalOverrideMap(const File::AtomRange<DefinedAtom> &range) {
 std::vector<LayoutPass::SortKey>
 LayoutPass::decorate(File::AtomRange<DefinedAtom> &atomRange) const {
   std::vector<SortKey> ret;
-  for (OwningAtomPtr<DefinedAtom> &atom : atomRange.owning_ptrs()) {
-    auto ri = _followOnRoots.find(atom.get());
-    auto oi = _ordinalOverrideMap.find(atom.get());
-    const auto *root = (ri == _followOnRoots.end()) ? atom.get() : ri->second;
-    uint64_t override = (oi == _ordinalOverrideMap.end()) ? 0 : oi->second;
-    ret.push_back(SortKey(std::move(atom), root, override));
-  }
+  ret.reserve(atomRange.size());
+  for (OwningAtomPtr<DefinedAtom> &atom : atomRange.owning_ptrs())
+    ret.push_back(SortKey(std::move(atom), nullptr, 0));
+
+  llvm::parallel::for_each(llvm::parallel::par, ret.begin(), ret.end(),
+                           [&](SortKey &key) {
+    const DefinedAtom *atom = key._atom.get();
+    auto ri = _followOnRoots.find(atom);
+    auto oi = _ordinalOverrideMap.find(atom);
+    const DefinedAtom *root = (ri == _followOnRoots.end()) ? atom : ri->second;
+    key._root = root;
+    key._override = (oi == _ordinalOverrideMap.end()) ? 0 : oi->second;
+
+    // Atoms in the order file go first, in order file order. Bit 32 is set
+    // for the others.
+    unsigned order;
+    uint64_t orderRank = 1ULL << 32;
+    if (_customSorter && _customSorter(root, order))
+      orderRank = order;
+    key._group = ((uint64_t)root->permissions() << 56) |
+                 ((uint64_t)root->contentType() << 48) | orderRank;
+    key._fileOrdinal = root->file().ordinal();
+    key._ordinal = root->ordinal();
+  });
   return ret;
 }
 
@@ -444,7 +430,6 @@ void LayoutPass::undecorate(File::AtomRange<DefinedAtom> &atomRange,
 llvm::Error LayoutPass::perform(SimpleFile &mergedFile) {
   LLVM_DEBUG(llvm::dbgs() << "******** Laying out atoms:\n");
   // sort the atoms
-  ScopedTask task(getDefaultDomain(), "LayoutPass");
   File::AtomRange<DefinedAtom> atomRange = mergedFile.defined();
 
   // Build follow on tables
@@ -462,11 +447,8 @@ llvm::Error LayoutPass::perform(SimpleFile &mergedFile) {
   });
 
   std::vector<LayoutPass::SortKey> vec = decorate(atomRange);
-  sort(llvm::parallel::par, vec.begin(), vec.end(),
-       [&](const LayoutPass::SortKey &l, const LayoutPass::SortKey &r) -> bool {
-         return compareAtoms(l, r, _customSorter);
-       });
-  LLVM_DEBUG(checkTransitivity(vec, _customSorter));
+  sort(llvm::parallel::par, vec.begin(), vec.end(), compareAtoms);
+  LLVM_DEBUG(checkTransitivity(vec));
   undecorate(atomRange, vec);
 
   LLVM_DEBUG({
@@ -478,11 +460,15 @@ llvm::Error LayoutPass::perform(SimpleFile &mergedFile) {
   return llvm::Error::success();
 }
 
-void addLayoutPass(PassManager &pm, const MachOLinkingContext &ctx) {
+void addLayoutPass(PassManager &pm, const MachOLinkingContext &ctx,
+                   const CallGraphOrder *callGraphOrder) {
   pm.add(llvm::make_unique<LayoutPass>(
-      ctx.registry(), [&](const DefinedAtom * left, const DefinedAtom * right,
-                          bool & leftBeforeRight) ->bool {
-    return ctx.customAtomOrderer(left, right, leftBeforeRight);
+      ctx.registry(), [&ctx, callGraphOrder](const DefinedAtom *atom,
+                                             unsigned &order) -> bool {
+    // -order_file and -call_graph_ordering_file may not be used together.
+    if (callGraphOrder)
+      return callGraphOrder->ordinal(atom, order);
+    return ctx.orderFileOrdinal(atom, order);
   }));
 }
 
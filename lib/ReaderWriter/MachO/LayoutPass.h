@@ -32,18 +32,30 @@ namespace mach_o {
 /// the sort must take that into account too.
 class LayoutPass : public Pass {
 public:
+  // The sort keys are computed once per atom by decorate(), so that
+  // comparing two atoms only compares integers.
   struct SortKey {
     SortKey(OwningAtomPtr<DefinedAtom> &&atom,
             const DefinedAtom *root, uint64_t override)
-    : _atom(std::move(atom)), _root(root), _override(override) {}
+    : _atom(std::move(atom)), _root(root), _override(override), _group(0),
+      _fileOrdinal(0), _ordinal(0) {}
     OwningAtomPtr<DefinedAtom> _atom;
     const DefinedAtom *_root;
     uint64_t _override;
 
+    // The permissions, content type and order file position of the root,
+    // packed so that they sort in that order.
+    uint64_t _group;
+    // The ordinals of the root's file and of the root within it.
+    uint64_t _fileOrdinal;
+    uint64_t _ordinal;
+
     // Note, these are only here to appease MSVC bots which didn't like
     // the same methods being implemented/deleted in OwningAtomPtr.
     SortKey(SortKey &&key) : _atom(std::move(key._atom)), _root(key._root),
-                             _override(key._override) {
+                             _override(key._override), _group(key._group),
+                             _fileOrdinal(key._fileOrdinal),
+                             _ordinal(key._ordinal) {
       key._root = nullptr;
     }
 
@@ -52,6 +64,9 @@ public:
       _root = key._root;
       key._root = nullptr;
       _override = key._override;
+      _group = key._group;
+      _fileOrdinal = key._fileOrdinal;
+      _ordinal = key._ordinal;
       return *this;
     }
 
@@ -60,11 +75,14 @@ public:
     void operator=(const SortKey&) = delete;
   };
 
-  typedef std::function<bool (const DefinedAtom *left, const DefinedAtom *right,
-                              bool &leftBeforeRight)> SortOverride;
+  // Returns true and sets order if the atom is listed in an order file.
+  typedef std::function<bool (const DefinedAtom *atom, unsigned &order)>
+      SortOverride;
 
   LayoutPass(const Registry &registry, SortOverride sorter);
 
+  const char *name() const override { return "LayoutPass"; }
+
   /// Sorts atoms in mergedFile by content type then by command line order.
   llvm::Error perform(SimpleFile &mergedFile) override;
 
@@ -27,6 +27,7 @@
 #include "llvm/Demangle/Demangle.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/Path.h"
 #include <algorithm>
@@ -366,6 +367,11 @@ bool MachOLinkingContext::needsObjCPass() const {
   return _objcConstraint != objc_unknown;
 }
 
+bool MachOLinkingContext::needsICFPass() const {
+  // Folding is only done in final linked images.
+  return _deduplicate && _outputMachOType != MH_OBJECT;
+}
+
 bool MachOLinkingContext::needsShimPass() const {
   // Shim pass only used in final executables.
   if (_outputMachOType == MH_OBJECT)
@@ -450,8 +456,43 @@ bool MachOLinkingContext::pathExists(StringRef path) const {
   return _existingPaths.find(key) != _existingPaths.end();
 }
 
+// Returns false if the directory that contains path has no entry of the same
+// name. Library and framework searches probe each search directory for many
+// names, so this answers most misses without a stat. Each directory is read
+// once. Names are compared ignoring case, because the file system may do so,
+// and a hit still has to be confirmed with pathExists(). The directory itself
+// is looked up in its parent first, so that probing Foo.framework/Foo in a
+// directory without Foo.framework does not try to read Foo.framework.
+bool MachOLinkingContext::mayBeInDirListing(StringRef path) const {
+  StringRef dir = llvm::sys::path::parent_path(path);
+  if (dir.empty() || dir == path)
+    return true;
+  if (!mayBeInDirListing(dir))
+    return false;
+
+  std::lock_guard<std::mutex> lock(_dirListingsMutex);
+  auto ins = _dirListings.try_emplace(dir);
+  llvm::Optional<llvm::StringSet<>> &listing = ins.first->second;
+  if (ins.second) {
+    llvm::StringSet<> names;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), e; it != e && !ec;
+         it.increment(ec))
+      names.insert(llvm::sys::path::filename(it->path()).lower());
+    if (!ec)
+      listing = std::move(names);
+  }
+  if (!listing)
+    return true;
+  return listing->count(llvm::sys::path::filename(path).lower());
+}
+
 bool MachOLinkingContext::fileExists(StringRef path) const {
-  bool found = pathExists(path);
+  bool found;
+  if (_testingFileUsage)
+    found = pathExists(path);
+  else
+    found = mayBeInDirListing(path) && pathExists(path);
   // Log search misses.
   if (!found)
     addInputFileNotFound(path);
@@ -635,15 +676,27 @@ void MachOLinkingContext::addPasses(PassManager &pm) {
   // no atoms which confuses the layout pass.
   if (needsObjCPass())
     mach_o::addObjCPass(pm, *this);
-  mach_o::addLayoutPass(pm, *this);
-  if (needsStubsPass())
-    mach_o::addStubsPass(pm, *this);
+  if (needsICFPass())
+    mach_o::addICFPass(pm, *this);
+  // The call graph is ordered after folding, since folded functions no longer
+  // need a place.
+  const mach_o::CallGraphOrder *callGraphOrder = nullptr;
+  if (!_callGraphProfile.empty())
+    callGraphOrder = &mach_o::addCallGraphOrder(pm, *this);
+  mach_o::addLayoutPass(pm, *this, callGraphOrder);
   if (needsCompactUnwindPass())
     mach_o::addCompactUnwindPass(pm, *this);
-  if (needsGOTPass())
-    mach_o::addGOTPass(pm, *this);
-  if (needsTLVPass())
-    mach_o::addTLVPass(pm, *this);
+  // The stubs, GOT and TLV passes share one walk over all references, which
+  // has to see the atoms the compact unwind pass adds and removes.
+  if (needsStubsPass() || needsGOTPass() || needsTLVPass()) {
+    mach_o::ReferenceScan &scan = mach_o::addReferenceScan(pm, *this);
+    if (needsStubsPass())
+      mach_o::addStubsPass(pm, *this, scan);
+    if (needsGOTPass())
+      mach_o::addGOTPass(pm, *this, scan);
+    if (needsTLVPass())
+      mach_o::addTLVPass(pm, *this, scan);
+  }
   if (needsShimPass())
     mach_o::addShimPass(pm, *this); // Shim pass must run after stubs pass.
 }
@@ -741,15 +794,11 @@ uint32_t MachOLinkingContext::dylibCompatVersion(StringRef installName) const {
 
 void MachOLinkingContext::createImplicitFiles(
                             std::vector<std::unique_ptr<File> > &result) {
-  // Add indirect dylibs by asking each linked dylib to add its indirects.
-  // Iterate until no more dylibs get loaded.
-  size_t dylibCount = 0;
-  while (dylibCount != _allDylibs.size()) {
-    dylibCount = _allDylibs.size();
-    for (MachODylibFile *dylib : _allDylibs) {
-      dylib->loadReExportedDylibs([this] (StringRef path) -> MachODylibFile* {
-                                  return findIndirectDylib(path); });
-    }
+  // Tell each linked dylib how to find the dylibs it re-exports. They are
+  // loaded when a symbol is first looked up in them.
+  for (MachODylibFile *dylib : _allDylibs) {
+    dylib->loadReExportedDylibs([this] (StringRef path) -> MachODylibFile* {
+                                return findIndirectDylib(path); });
   }
 
   // Let writer add output type specific extras.
@@ -958,44 +1007,22 @@ MachOLinkingContext::findOrderOrdinal(const std::vector<OrderFileNode> &nodes,
   return false;
 }
 
-bool MachOLinkingContext::customAtomOrderer(const DefinedAtom *left,
-                                            const DefinedAtom *right,
-                                            bool &leftBeforeRight) const {
+bool MachOLinkingContext::orderFileOrdinal(const DefinedAtom *atom,
+                                           unsigned &ordinal) const {
   // No custom sorting if no order file entries.
   if (!_orderFileEntries)
     return false;
 
   // Order files can only order named atoms.
-  StringRef leftName = left->name();
-  StringRef rightName = right->name();
-  if (leftName.empty() || rightName.empty())
-    return false;
-
-  // If neither is in order file list, no custom sorter.
-  auto leftPos = _orderFiles.find(leftName);
-  auto rightPos = _orderFiles.find(rightName);
-  bool leftIsOrdered = (leftPos != _orderFiles.end());
-  bool rightIsOrdered = (rightPos != _orderFiles.end());
-  if (!leftIsOrdered && !rightIsOrdered)
+  StringRef name = atom->name();
+  if (name.empty())
     return false;
 
   // There could be multiple symbols with same name but different file prefixes.
-  unsigned leftOrder;
-  unsigned rightOrder;
-  bool foundLeft =
-      leftIsOrdered && findOrderOrdinal(leftPos->getValue(), left, leftOrder);
-  bool foundRight = rightIsOrdered &&
-                    findOrderOrdinal(rightPos->getValue(), right, rightOrder);
-  if (!foundLeft && !foundRight)
+  auto pos = _orderFiles.find(name);
+  if (pos == _orderFiles.end())
     return false;
-
-  // If only one is in order file list, ordered one goes first.
-  if (foundLeft != foundRight)
-    leftBeforeRight = foundLeft;
-  else
-    leftBeforeRight = (leftOrder < rightOrder);
-
-  return true;
+  return findOrderOrdinal(pos->getValue(), atom, ordinal);
 }
 
 static bool isLibrary(const std::unique_ptr<Node> &elem) {
@@ -259,6 +259,8 @@ struct NormalizedFile {
   std::vector<BindLocation>   weakBindingInfo;
   std::vector<BindLocation>   lazyBindingInfo;
   std::vector<Export>         exportInfo;
+  // The raw export trie, if readBinary was asked to leave it unexpanded.
+  ArrayRef<uint8_t>           exportTrie;
   std::vector<uint8_t>        functionStarts;
   std::vector<DataInCode>     dataInCode;
 
@@ -280,10 +282,17 @@ bool isThinObjectFile(StringRef path, MachOLinkingContext::Arch &arch);
 bool sliceFromFatFile(MemoryBufferRef mb, MachOLinkingContext::Arch arch,
                       uint32_t &offset, uint32_t &size);
 
-/// Reads a mach-o file and produces an in-memory normalized view.
+/// Reads a mach-o file and produces an in-memory normalized view. If
+/// expandExports is false, the export trie is referenced as exportTrie
+/// instead of being decoded into exportInfo.
 llvm::Expected<std::unique_ptr<NormalizedFile>>
 readBinary(std::unique_ptr<MemoryBuffer> &mb,
-           const MachOLinkingContext::Arch arch);
+           const MachOLinkingContext::Arch arch, bool expandExports = true);
+
+/// Looks up name in an export trie. Returns true with the symbol's flags
+/// if it is exported.
+bool lookupExportTrie(ArrayRef<uint8_t> trie, StringRef name,
+                      uint64_t &flags);
 
 /// Takes in-memory normalized view and writes a mach-o object file.
 llvm::Error writeBinary(const NormalizedFile &file, StringRef path);
@@ -298,6 +307,10 @@ readYaml(std::unique_ptr<MemoryBuffer> &mb);
 /// Writes a yaml encoded mach-o files given an in-memory normalized view.
 std::error_code writeYaml(const NormalizedFile &file, raw_ostream &out);
 
+/// Returns a reader for yaml encoded mach-o objects which keeps their binary
+/// encoding in ctx.yamlCacheDirectory() and reads that when it can.
+std::unique_ptr<Reader> createYamlCacheReader(MachOLinkingContext &ctx);
+
 llvm::Error
 normalizedObjectToAtoms(MachOFile *file,
                         const NormalizedFile &normalizedFile,
@@ -88,6 +88,7 @@ static std::error_code appendRelocations(Relocations &relocs, StringRef buffer,
   const any_relocation_info* relocsArray =
             reinterpret_cast<const any_relocation_info*>(buffer.begin()+reloff);
 
+  relocs.reserve(relocs.size() + nreloc);
   for(uint32_t i=0; i < nreloc; ++i) {
     relocs.push_back(unpackRelocation(relocsArray[i], bigEndian));
   }
@@ -104,6 +105,7 @@ appendIndirectSymbols(IndirectSymbols &isyms, StringRef buffer, bool isBig,
     return make_error_code(llvm::errc::executable_format_error);
   const uint8_t *indirectSymbolArray = (const uint8_t *)buffer.data();
 
+  isyms.reserve(isyms.size() + count);
   for(uint32_t i=0; i < count; ++i) {
     isyms.push_back(read32(
         indirectSymbolArray + (startIndex + i) * sizeof(uint32_t), isBig));
@@ -203,7 +205,7 @@ bool sliceFromFatFile(MemoryBufferRef mb, MachOLinkingContext::Arch arch,
 /// Reads a mach-o file and produces an in-memory normalized view.
 llvm::Expected<std::unique_ptr<NormalizedFile>>
 readBinary(std::unique_ptr<MemoryBuffer> &mb,
-           const MachOLinkingContext::Arch arch) {
+           const MachOLinkingContext::Arch arch, bool expandExports) {
   // Make empty NormalizedFile.
   std::unique_ptr<NormalizedFile> f(new NormalizedFile());
 
@@ -292,6 +294,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
         // Verify sections don't extend beyond end of segment load command.
         if (lcSize > size)
           return true;
+        f->sections.reserve(f->sections.size() + sectionCount);
         for (unsigned i=0; i < sectionCount; ++i) {
           const section_64 *sect = &sects[i];
           Section section;
@@ -305,8 +308,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
           const uint8_t *content =
             (const uint8_t *)start + read32(&sect->offset, isBig);
           size_t contentSize = read64(&sect->size, isBig);
-          // Note: this assign() is copying the content bytes.  Ideally,
-          // we can use a custom allocator for vector to avoid the copy.
+          // The content is referenced in place, not copied.
           section.content = llvm::makeArrayRef(content, contentSize);
           appendRelocations(section.relocations, mb->getBuffer(), isBig,
                             read32(&sect->reloff, isBig),
@@ -319,7 +321,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
                                   read32(&sect->reserved1, isBig),
                                   contentSize/4);
           }
-          f->sections.push_back(section);
+          f->sections.push_back(std::move(section));
         }
       }
       break;
@@ -335,6 +337,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
         // Verify sections don't extend beyond end of segment load command.
         if (lcSize > size)
           return true;
+        f->sections.reserve(f->sections.size() + sectionCount);
         for (unsigned i=0; i < sectionCount; ++i) {
           const section *sect = &sects[i];
           Section section;
@@ -349,8 +352,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
           const uint8_t *content =
             (const uint8_t *)start + read32(&sect->offset, isBig);
           size_t contentSize = read32(&sect->size, isBig);
-          // Note: this assign() is copying the content bytes.  Ideally,
-          // we can use a custom allocator for vector to avoid the copy.
+          // The content is referenced in place, not copied.
           section.content = llvm::makeArrayRef(content, contentSize);
           appendRelocations(section.relocations, mb->getBuffer(), isBig,
                             read32(&sect->reloff, isBig),
@@ -361,7 +363,7 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
                 indirectSymbolTableOffset, indirectSymbolTableCount,
                 read32(&sect->reserved1, isBig), contentSize / 4);
           }
-          f->sections.push_back(section);
+          f->sections.push_back(std::move(section));
         }
       }
       break;
@@ -511,6 +513,13 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
       const uint8_t *trieStart = reinterpret_cast<const uint8_t *>(
           start + read32(&dyldInfo->export_off, isBig));
       ArrayRef<uint8_t> trie(trieStart, read32(&dyldInfo->export_size, isBig));
+      if (trie.end() > reinterpret_cast<const uint8_t *>(start + objSize))
+        return llvm::make_error<GenericError>("Export trie exceeds file size");
+      // Dylibs look up their exports in the trie on demand instead.
+      if (!expandExports) {
+        f->exportTrie = trie;
+        return std::move(f);
+      }
       Error Err = Error::success();
       for (const ExportEntry &trieExport : MachOObjectFile::exports(Err, trie)) {
         Export normExport;
@@ -531,6 +540,58 @@ readBinary(std::unique_ptr<MemoryBuffer> &mb,
   return std::move(f);
 }
 
+bool lookupExportTrie(ArrayRef<uint8_t> trie, StringRef name,
+                      uint64_t &flags) {
+  const uint8_t *end = trie.end();
+  const uint8_t *p = trie.begin();
+  auto readULEB = [&](uint64_t &value) -> bool {
+    unsigned n;
+    const char *error = nullptr;
+    value = llvm::decodeULEB128(p, &n, end, &error);
+    p += n;
+    return !error;
+  };
+
+  // Each node starts with the size of its export info, which is empty
+  // unless a symbol ends at the node, followed by its edges. An edge is
+  // labeled with the next characters of the names below it, so at most
+  // one edge can match. Since edges are never empty, each step consumes
+  // part of the name.
+  for (;;) {
+    uint64_t terminalSize;
+    if (!readULEB(terminalSize))
+      return false;
+    if (name.empty())
+      return terminalSize && readULEB(flags);
+    if (terminalSize >= uint64_t(end - p))
+      return false;
+    p += terminalSize;
+
+    uint8_t childCount = *p++;
+    bool found = false;
+    for (uint8_t i = 0; i < childCount && !found; ++i) {
+      const uint8_t *label = p;
+      p = std::find(p, end, 0);
+      if (p == end)
+        return false;
+      StringRef edge(reinterpret_cast<const char *>(label), p - label);
+      ++p;
+      uint64_t childOffset;
+      if (!readULEB(childOffset) || edge.empty())
+        return false;
+      if (!name.startswith(edge))
+        continue;
+      if (childOffset >= trie.size())
+        return false;
+      name = name.drop_front(edge.size());
+      p = trie.begin() + childOffset;
+      found = true;
+    }
+    if (!found)
+      return false;
+  }
+}
+
 class MachOObjectReader : public Reader {
 public:
   MachOObjectReader(MachOLinkingContext &ctx) : _ctx(ctx) {}
@@ -582,6 +643,9 @@ private:
 
 void Registry::addSupportMachOObjects(MachOLinkingContext &ctx) {
   MachOLinkingContext::Arch arch = ctx.arch();
+  // Must come before the generic yaml reader to see !mach-o yaml files.
+  if (!ctx.yamlCacheDirectory().empty())
+    add(mach_o::normalized::createYamlCacheReader(ctx));
   add(std::unique_ptr<Reader>(new mach_o::normalized::MachOObjectReader(ctx)));
   add(std::unique_ptr<Reader>(new mach_o::normalized::MachODylibReader(ctx)));
   addKindTable(Reference::KindNamespace::mach_o, ctx.archHandler().kindArch(),
@@ -25,6 +25,7 @@
 #include "MachONormalizedFileBinaryUtils.h"
 #include "lld/Common/LLVM.h"
 #include "lld/Core/Error.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -39,7 +40,9 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <functional>
 #include <list>
 #include <map>
@@ -1011,22 +1014,29 @@ llvm::Error MachOFileLayout::writeLoadCommands() {
 }
 
 void MachOFileLayout::writeSectionContent() {
-  for (const Section &s : _file.sections) {
-    // Copy all section content to output buffer.
+  // Copy all section content to output buffer.
+  auto copySection = [&](const Section &s) {
     if (isZeroFillSection(s.type))
-      continue;
+      return;
     if (s.content.empty())
-      continue;
-    uint32_t offset = _sectInfo[&s].fileOffset;
-    uint8_t *p = &_buffer[offset];
-    memcpy(p, &s.content[0], s.content.size());
-    p += s.content.size();
-  }
+      return;
+    uint32_t offset = _sectInfo.find(&s)->second.fileOffset;
+    memcpy(&_buffer[offset], &s.content[0], s.content.size());
+  };
+  // Object files are also written by the yaml cache from the threads which
+  // parse the input files, which must not wait on the thread pool themselves.
+  // Sections of final linked images have disjoint file ranges and are copied
+  // in parallel.
+  if (_file.fileType == llvm::MachO::MH_OBJECT)
+    std::for_each(_file.sections.begin(), _file.sections.end(), copySection);
+  else
+    llvm::parallel::for_each(llvm::parallel::par, _file.sections.begin(),
+                             _file.sections.end(), copySection);
 }
 
 void MachOFileLayout::writeRelocations() {
   uint32_t relOffset = _startOfRelocations;
-  for (Section sect : _file.sections) {
+  for (const Section &sect : _file.sections) {
     for (Relocation r : sect.relocations) {
       any_relocation_info* rb = reinterpret_cast<any_relocation_info*>(
                                                            &_buffer[relOffset]);
@@ -1088,7 +1098,7 @@ void MachOFileLayout::writeDataInCodeInfo() {
 }
 
 void MachOFileLayout::writeSymbolTable() {
-  // Write symbol table and symbol strings in parallel.
+  // Write symbol table, symbol strings and indirect symbol table.
   uint32_t symOffset = _startOfSymbols;
   uint32_t strOffset = _startOfSymbolStrings;
   // Reserve n_strx offset of zero to mean no name.
@@ -1146,10 +1156,14 @@ void MachOFileLayout::writeExportInfo() {
 }
 
 void MachOFileLayout::buildLinkEditInfo() {
-  buildRebaseInfo();
-  buildBindInfo();
-  buildLazyBindInfo();
-  buildExportTrie();
+  // The opcode streams and the export trie each read only the normalized file
+  // and fill their own buffer, so they are built concurrently.
+  static void (MachOFileLayout::*const builders[])() = {
+      &MachOFileLayout::buildRebaseInfo, &MachOFileLayout::buildBindInfo,
+      &MachOFileLayout::buildLazyBindInfo, &MachOFileLayout::buildExportTrie};
+  llvm::parallel::for_each_n(llvm::parallel::par, size_t(0),
+                             llvm::array_lengthof(builders),
+                             [&](size_t i) { (this->*builders[i])(); });
   computeSymbolTableSizes();
   computeFunctionStartsSize();
   computeDataInCodeSize();
@@ -1160,27 +1174,92 @@ void MachOFileLayout::buildSectionRelocations() {
 }
 
 void MachOFileLayout::buildRebaseInfo() {
-  // TODO: compress rebasing info.
-  for (const RebaseLocation& entry : _file.rebasingInfo) {
-    _rebaseInfo.append_byte(REBASE_OPCODE_SET_TYPE_IMM | entry.kind);
-    _rebaseInfo.append_byte(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
-                            | entry.segIndex);
-    _rebaseInfo.append_uleb128(entry.segOffset);
-    _rebaseInfo.append_uleb128(REBASE_OPCODE_DO_REBASE_IMM_TIMES | 1);
+  // Sort the locations by address, so that runs of pointers of the same type
+  // at a constant stride can each be encoded with a single opcode.
+  std::vector<RebaseLocation> locations(_file.rebasingInfo.begin(),
+                                        _file.rebasingInfo.end());
+  std::stable_sort(locations.begin(), locations.end(),
+                   [](const RebaseLocation &l, const RebaseLocation &r) {
+    if (l.segIndex != r.segIndex)
+      return l.segIndex < r.segIndex;
+    return (uint32_t)l.segOffset < (uint32_t)r.segOffset;
+  });
+
+  const uint64_t pointerSize = _is64 ? 8 : 4;
+  uint8_t curSegIndex = (uint8_t)~0U;
+  uint64_t curSegOffset = 0;
+  int curKind = -1;
+  for (size_t i = 0, e = locations.size(); i < e;) {
+    const RebaseLocation &entry = locations[i];
+    uint64_t offset = entry.segOffset;
+    if (curKind != entry.kind) {
+      _rebaseInfo.append_byte(REBASE_OPCODE_SET_TYPE_IMM | entry.kind);
+      curKind = entry.kind;
+    }
+
+    // Find the run of locations that starts here.
+    size_t j = i + 1;
+    uint64_t stride = pointerSize;
+    if (j < e && locations[j].segIndex == entry.segIndex &&
+        locations[j].kind == entry.kind &&
+        (uint64_t)locations[j].segOffset >= offset + pointerSize) {
+      stride = (uint64_t)locations[j].segOffset - offset;
+      while (j < e && locations[j].segIndex == entry.segIndex &&
+             locations[j].kind == entry.kind &&
+             (uint64_t)locations[j].segOffset ==
+                 (uint64_t)locations[j - 1].segOffset + stride)
+        ++j;
+    }
+    uint64_t count = j - i;
+
+    // Move to the first location of the run.
+    if (curSegIndex != entry.segIndex || offset < curSegOffset) {
+      _rebaseInfo.append_byte(REBASE_OPCODE_SET_SEGMENT_AND_OFFSET_ULEB
+                              | entry.segIndex);
+      _rebaseInfo.append_uleb128(offset);
+    } else if (offset != curSegOffset) {
+      uint64_t delta = offset - curSegOffset;
+      if (delta % pointerSize == 0 &&
+          delta / pointerSize <= REBASE_IMMEDIATE_MASK) {
+        _rebaseInfo.append_byte(REBASE_OPCODE_ADD_ADDR_IMM_SCALED
+                                | (delta / pointerSize));
+      } else {
+        _rebaseInfo.append_byte(REBASE_OPCODE_ADD_ADDR_ULEB);
+        _rebaseInfo.append_uleb128(delta);
+      }
+    }
+
+    if (stride == pointerSize) {
+      if (count <= REBASE_IMMEDIATE_MASK) {
+        _rebaseInfo.append_byte(REBASE_OPCODE_DO_REBASE_IMM_TIMES | count);
+      } else {
+        _rebaseInfo.append_byte(REBASE_OPCODE_DO_REBASE_ULEB_TIMES);
+        _rebaseInfo.append_uleb128(count);
+      }
+    } else {
+      _rebaseInfo.append_byte(REBASE_OPCODE_DO_REBASE_ULEB_TIMES_SKIPPING_ULEB);
+      _rebaseInfo.append_uleb128(count);
+      _rebaseInfo.append_uleb128(stride - pointerSize);
+    }
+    curSegIndex = entry.segIndex;
+    curSegOffset = offset + count * stride;
+    i = j;
   }
   _rebaseInfo.append_byte(REBASE_OPCODE_DONE);
   _rebaseInfo.align(_is64 ? 8 : 4);
 }
 
 void MachOFileLayout::buildBindInfo() {
-  // TODO: compress bind info.
+  const uint64_t pointerSize = _is64 ? 8 : 4;
   uint64_t lastAddend = 0;
   int lastOrdinal = 0x80000000;
   StringRef lastSymbolName;
   BindType lastType = (BindType)0;
-  Hex32 lastSegOffset = ~0U;
+  uint64_t lastSegOffset = ~0ULL;
   uint8_t lastSegIndex = (uint8_t)~0U;
-  for (const BindLocation& entry : _file.bindingInfo) {
+  ArrayRef<BindLocation> locations = _file.bindingInfo;
+  for (size_t i = 0, e = locations.size(); i < e;) {
+    const BindLocation &entry = locations[i];
     if (entry.ordinal != lastOrdinal) {
       if (entry.ordinal <= 0)
         _bindingInfo.append_byte(BIND_OPCODE_SET_DYLIB_SPECIAL_IMM |
@@ -1211,14 +1290,41 @@ void MachOFileLayout::buildBindInfo() {
                                | entry.segIndex);
       _bindingInfo.append_uleb128(entry.segOffset);
       lastSegIndex = entry.segIndex;
-      lastSegOffset = entry.segOffset;
     }
     if (entry.addend != lastAddend) {
       _bindingInfo.append_byte(BIND_OPCODE_SET_ADDEND_SLEB);
       _bindingInfo.append_sleb128(entry.addend);
       lastAddend = entry.addend;
     }
-    _bindingInfo.append_byte(BIND_OPCODE_DO_BIND);
+
+    // Bind the following locations of the same symbol that are at a constant
+    // stride in one go.
+    size_t j = i + 1;
+    uint64_t stride = pointerSize;
+    auto sameBinding = [&](const BindLocation &l) {
+      return l.segIndex == entry.segIndex && l.ordinal == entry.ordinal &&
+             l.kind == entry.kind && l.addend == entry.addend &&
+             l.symbolName == entry.symbolName;
+    };
+    if (j < e && sameBinding(locations[j]) &&
+        (uint64_t)locations[j].segOffset >= entry.segOffset + pointerSize) {
+      stride = (uint64_t)locations[j].segOffset - entry.segOffset;
+      while (j < e && sameBinding(locations[j]) &&
+             (uint64_t)locations[j].segOffset ==
+                 (uint64_t)locations[j - 1].segOffset + stride)
+        ++j;
+    }
+    uint64_t count = j - i;
+    if (count == 1) {
+      _bindingInfo.append_byte(BIND_OPCODE_DO_BIND);
+    } else {
+      _bindingInfo.append_byte(BIND_OPCODE_DO_BIND_ULEB_TIMES_SKIPPING_ULEB);
+      _bindingInfo.append_uleb128(count);
+      _bindingInfo.append_uleb128(stride - pointerSize);
+    }
+    // Binding moves the address past the bound pointers.
+    lastSegOffset = entry.segOffset + count * stride;
+    i = j;
   }
   _bindingInfo.append_byte(BIND_OPCODE_DONE);
   _bindingInfo.align(_is64 ? 8 : 4);
@@ -1260,29 +1366,31 @@ void TrieNode::addSymbol(const Export& entry,
       return;
     }
     // See if string has commmon prefix with existing edge.
-    for (int n=edgeStr.size()-1; n > 0; --n) {
-      if (partialStr.substr(0, n).equals(edgeStr.substr(0, n))) {
-        // Splice in new node:  was A -> C,  now A -> B -> C
-        StringRef bNodeStr = edge._child->_cummulativeString;
-        bNodeStr = bNodeStr.drop_back(edgeStr.size()-n).copy(allocator);
-        auto *bNode = new (allocator) TrieNode(bNodeStr);
-        allNodes.push_back(bNode);
-        TrieNode* cNode = edge._child;
-        StringRef abEdgeStr = edgeStr.substr(0,n).copy(allocator);
-        StringRef bcEdgeStr = edgeStr.substr(n).copy(allocator);
-        DEBUG_WITH_TYPE("trie-builder", llvm::dbgs()
-                        << "splice in TrieNode('" << bNodeStr
-                        << "') between edge '"
-                        << abEdgeStr << "' and edge='"
-                        << bcEdgeStr<< "'\n");
-        TrieEdge& abEdge = edge;
-        abEdge._subString = abEdgeStr;
-        abEdge._child = bNode;
-        auto *bcEdge = new (allocator) TrieEdge(bcEdgeStr, cNode);
-        bNode->_children.insert(bNode->_children.end(), bcEdge);
-        bNode->addSymbol(entry, allocator, allNodes);
-        return;
-      }
+    size_t n = 0;
+    size_t maxPrefix = std::min(partialStr.size(), edgeStr.size());
+    while (n < maxPrefix && partialStr[n] == edgeStr[n])
+      ++n;
+    if (n > 0) {
+      // Splice in new node:  was A -> C,  now A -> B -> C
+      StringRef bNodeStr = edge._child->_cummulativeString;
+      bNodeStr = bNodeStr.drop_back(edgeStr.size()-n).copy(allocator);
+      auto *bNode = new (allocator) TrieNode(bNodeStr);
+      allNodes.push_back(bNode);
+      TrieNode* cNode = edge._child;
+      StringRef abEdgeStr = edgeStr.substr(0,n).copy(allocator);
+      StringRef bcEdgeStr = edgeStr.substr(n).copy(allocator);
+      DEBUG_WITH_TYPE("trie-builder", llvm::dbgs()
+                      << "splice in TrieNode('" << bNodeStr
+                      << "') between edge '"
+                      << abEdgeStr << "' and edge='"
+                      << bcEdgeStr<< "'\n");
+      TrieEdge& abEdge = edge;
+      abEdge._subString = abEdgeStr;
+      abEdge._child = bNode;
+      auto *bcEdge = new (allocator) TrieEdge(bcEdgeStr, cNode);
+      bNode->_children.insert(bNode->_children.end(), bcEdge);
+      bNode->addSymbol(entry, allocator, allNodes);
+      return;
     }
   }
   if (entry.flags & EXPORT_SYMBOL_FLAGS_REEXPORT) {
@@ -1504,14 +1612,20 @@ void MachOFileLayout::writeLinkEditContent() {
     writeDataInCodeInfo();
     writeSymbolTable();
   } else {
-    writeRebaseInfo();
-    writeBindingInfo();
-    writeLazyBindingInfo();
-    // TODO: add weak binding info
-    writeExportInfo();
-    writeFunctionStartsInfo();
-    writeDataInCodeInfo();
-    writeSymbolTable();
+    // Each piece of LINKEDIT has its own file range, so they are written
+    // concurrently.
+    static void (MachOFileLayout::*const writers[])() = {
+        &MachOFileLayout::writeRebaseInfo,
+        &MachOFileLayout::writeBindingInfo,
+        &MachOFileLayout::writeLazyBindingInfo,
+        // TODO: add weak binding info
+        &MachOFileLayout::writeExportInfo,
+        &MachOFileLayout::writeFunctionStartsInfo,
+        &MachOFileLayout::writeDataInCodeInfo,
+        &MachOFileLayout::writeSymbolTable};
+    llvm::parallel::for_each_n(llvm::parallel::par, size_t(0),
+                               llvm::array_lengthof(writers),
+                               [&](size_t i) { (this->*writers[i])(); });
   }
 }
 
@@ -33,6 +33,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include <map>
 #include <system_error>
 #include <unordered_set>
@@ -660,14 +661,22 @@ void Util::copySectionContent(NormalizedFile &file) {
     return pos->second;
   };
 
+  llvm::DenseMap<const Atom *, uint64_t> atomToSectionAddress;
+  for (const SectionInfo *sectInfo : _sectionInfos)
+    for (const AtomInfo &atomInfo : sectInfo->atomsAndOffsets)
+      atomToSectionAddress.insert({atomInfo.atom, sectInfo->address});
+
   auto sectionAddrForAtom = [&] (const Atom &atom) -> uint64_t {
-    for (const SectionInfo *sectInfo : _sectionInfos)
-      for (const AtomInfo &atomInfo : sectInfo->atomsAndOffsets)
-        if (atomInfo.atom == &atom)
-          return sectInfo->address;
-    llvm_unreachable("atom not assigned to section");
+    auto pos = atomToSectionAddress.find(&atom);
+    assert(pos != atomToSectionAddress.end() &&
+           "atom not assigned to section");
+    return pos->second;
   };
 
+  // Give each section its content buffer first, since the allocator is not
+  // thread safe, and collect the slice of it each atom is copied to.
+  std::vector<std::pair<const DefinedAtom *, llvm::MutableArrayRef<uint8_t>>>
+      atomContents;
   for (SectionInfo *si : _sectionInfos) {
     Section *normSect = &file.sections[si->normalizedSectionIndex];
     if (isZeroFillSection(si->type)) {
@@ -688,13 +697,19 @@ void Util::copySectionContent(NormalizedFile &file) {
                "Cannot have references without content");
         continue;
       }
-      auto atomContent = sectionContent.slice(ai.offsetInSection,
-                                              ai.atom->size());
-      _archHandler.generateAtomContent(*ai.atom, r, addrForAtom,
-                                       sectionAddrForAtom, _ctx.baseAddress(),
-                                       atomContent);
+      atomContents.push_back(
+          {ai.atom, sectionContent.slice(ai.offsetInSection, ai.atom->size())});
     }
   }
+
+  // Atoms only write their own slice and only read addresses, so their
+  // content is generated and fixed up in parallel.
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), atomContents.size(), [&](size_t i) {
+        _archHandler.generateAtomContent(
+            *atomContents[i].first, r, addrForAtom, sectionAddrForAtom,
+            _ctx.baseAddress(), atomContents[i].second);
+      });
 }
 
 void Util::copySectionInfo(NormalizedFile &file) {
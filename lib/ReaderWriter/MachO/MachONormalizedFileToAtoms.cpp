@@ -1566,7 +1566,9 @@ normalizedDylibToAtoms(MachODylibFile *file,
   file->setCurrentVersion(normalizedFile.currentVersion);
 
   // Tell MachODylibFile object about all symbols it exports.
-  if (!normalizedFile.exportInfo.empty()) {
+  if (!normalizedFile.exportTrie.empty()) {
+    file->setExportTrie(normalizedFile.exportTrie);
+  } else if (!normalizedFile.exportInfo.empty()) {
     // If exports trie exists, use it instead of traditional symbol table.
     for (const Export &exp : normalizedFile.exportInfo) {
       bool weakDef = (exp.flags & EXPORT_SYMBOL_FLAGS_WEAK_DEFINITION);
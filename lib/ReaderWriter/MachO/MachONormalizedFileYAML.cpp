@@ -18,18 +18,23 @@
 #include "MachONormalizedFile.h"
 #include "lld/Common/LLVM.h"
 #include "lld/Core/Error.h"
+#include "lld/Core/Reader.h"
 #include "lld/ReaderWriter/YamlContext.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/BinaryFormat/MachO.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/xxhash.h"
 #include "llvm/Support/raw_ostream.h"
 #include <system_error>
 
@@ -838,6 +843,95 @@ std::error_code writeYaml(const NormalizedFile &file, raw_ostream &out) {
   return std::error_code();
 }
 
+namespace {
+
+/// Reads single document !mach-o yaml object files through a cache of their
+/// binary encoding, kept in the directory given by -yaml_cache_dir. Entries
+/// are keyed by a hash of the yaml text and the architecture, so an edited
+/// file simply misses.
+class MachOYamlCacheReader : public Reader {
+public:
+  MachOYamlCacheReader(MachOLinkingContext &ctx) : _ctx(ctx) {}
+
+  bool canParse(file_magic magic, MemoryBufferRef mb) const override {
+    StringRef name = mb.getBufferIdentifier();
+    if (!name.endswith(".objtxt") && !name.endswith(".yaml"))
+      return false;
+    bool found = false;
+    for (StringRef rest = mb.getBuffer(); !rest.empty();) {
+      StringRef line;
+      std::tie(line, rest) = rest.split('\n');
+      if (!line.startswith("---"))
+        continue;
+      if (found || !line.startswith("--- !mach-o"))
+        return false;
+      found = true;
+    }
+    return found;
+  }
+
+  ErrorOr<std::unique_ptr<File>>
+  loadFile(std::unique_ptr<MemoryBuffer> mb,
+           const Registry &registry) const override {
+    StringRef path = mb->getBufferIdentifier();
+    SmallString<128> cachePath(_ctx.yamlCacheDirectory());
+    llvm::sys::path::append(
+        cachePath, llvm::utohexstr(llvm::xxHash64(mb->getBuffer())) + "-" +
+                       _ctx.archName() + ".o");
+
+    // On a hit, the object is read like any other binary input.
+    ErrorOr<std::unique_ptr<MemoryBuffer>> cached =
+        MemoryBuffer::getFile(cachePath);
+    if (cached) {
+      llvm::Expected<std::unique_ptr<NormalizedFile>> nf =
+          readBinary(*cached, _ctx.arch());
+      if (nf)
+        return toAtoms(**nf, path, std::move(*cached));
+      llvm::consumeError(nf.takeError());
+    }
+
+    llvm::Expected<std::unique_ptr<NormalizedFile>> nf = readYaml(mb);
+    if (!nf) {
+      llvm::errs() << path << ": " << llvm::toString(nf.takeError()) << "\n";
+      return make_error_code(YamlReaderError::illegal_value);
+    }
+    if ((*nf)->arch != _ctx.arch()) {
+      llvm::errs() << path << ": file is wrong architecture. Expected ("
+                   << _ctx.archName() << ") found ("
+                   << MachOLinkingContext::nameFromArch((*nf)->arch) << ")\n";
+      return make_error_code(YamlReaderError::illegal_value);
+    }
+
+    // Only objects are cached. The binary writer lays out the other file
+    // types as linked images, which yaml inputs do not describe.
+    if ((*nf)->fileType == llvm::MachO::MH_OBJECT)
+      llvm::consumeError(writeBinary(**nf, cachePath));
+    return toAtoms(**nf, path, std::move(mb));
+  }
+
+private:
+  ErrorOr<std::unique_ptr<File>>
+  toAtoms(const NormalizedFile &nf, StringRef path,
+          std::unique_ptr<MemoryBuffer> mb) const {
+    llvm::Expected<std::unique_ptr<File>> file =
+        normalizedToAtoms(nf, path, true);
+    if (!file) {
+      llvm::errs() << path << ": " << llvm::toString(file.takeError()) << "\n";
+      return make_error_code(YamlReaderError::illegal_value);
+    }
+    (*file)->setSharedMemoryBuffer(std::shared_ptr<MemoryBuffer>(mb.release()));
+    return std::move(*file);
+  }
+
+  MachOLinkingContext &_ctx;
+};
+
+} // end anonymous namespace
+
+std::unique_ptr<Reader> createYamlCacheReader(MachOLinkingContext &ctx) {
+  return llvm::make_unique<MachOYamlCacheReader>(ctx);
+}
+
 } // namespace normalized
 } // namespace mach_o
 } // namespace lld
@@ -16,13 +16,25 @@
 namespace lld {
 namespace mach_o {
 
-void addLayoutPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx);
-void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx);
+class CallGraphOrder;
+class ReferenceScan;
+
+CallGraphOrder &addCallGraphOrder(PassManager &pm,
+                                  const MachOLinkingContext &ctx);
+void addLayoutPass(PassManager &pm, const MachOLinkingContext &ctx,
+                   const CallGraphOrder *callGraphOrder);
+ReferenceScan &addReferenceScan(PassManager &pm,
+                                const MachOLinkingContext &ctx);
+void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx,
+                  const ReferenceScan &scan);
+void addGOTPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceScan &scan);
+void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceScan &scan);
 void addCompactUnwindPass(PassManager &pm, const MachOLinkingContext &ctx);
 void addObjCPass(PassManager &pm, const MachOLinkingContext &ctx);
 void addShimPass(PassManager &pm, const MachOLinkingContext &ctx);
+void addICFPass(PassManager &pm, const MachOLinkingContext &ctx);
 
 } // namespace mach_o
 } // namespace lld
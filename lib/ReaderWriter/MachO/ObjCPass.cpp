@@ -102,6 +102,8 @@ public:
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
+  const char *name() const override { return "ObjCPass"; }
+
   llvm::Error perform(SimpleFile &mergedFile) override {
     // Add the image info.
     mergedFile.addAtom(*getImageInfo());
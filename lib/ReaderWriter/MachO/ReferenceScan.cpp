@@ -0,0 +1,84 @@
+//===- lib/ReaderWriter/MachO/ReferenceScan.cpp -----------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ReferenceScan.h"
+#include "ArchHandler.h"
+#include "MachOPasses.h"
+#include "lld/Core/DefinedAtom.h"
+#include "lld/Core/Reference.h"
+#include "lld/Core/Simple.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Parallel.h"
+#include <algorithm>
+
+using namespace lld;
+using namespace lld::mach_o;
+
+namespace {
+struct Buckets {
+  std::vector<ReferenceScan::Use> callSites;
+  std::vector<ReferenceScan::Use> gotAccesses;
+  std::vector<ReferenceScan::Use> tlvAccesses;
+};
+} // namespace
+
+template <class T>
+static void append(std::vector<T> &to, const std::vector<T> &from) {
+  to.insert(to.end(), from.begin(), from.end());
+}
+
+llvm::Error ReferenceScan::perform(SimpleFile &mergedFile) {
+  _callSites.clear();
+  _gotAccesses.clear();
+  _tlvAccesses.clear();
+
+  std::vector<const DefinedAtom *> atoms;
+  for (const DefinedAtom *atom : mergedFile.defined())
+    atoms.push_back(atom);
+
+  // Classify the references of each chunk of atoms in parallel, then
+  // concatenate the buckets so that they are in atom order.
+  const size_t chunkSize = 1024;
+  size_t numChunks = (atoms.size() + chunkSize - 1) / chunkSize;
+  std::vector<Buckets> chunks(numChunks);
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), numChunks, [&](size_t chunk) {
+        Buckets &buckets = chunks[chunk];
+        size_t end = std::min(atoms.size(), (chunk + 1) * chunkSize);
+        for (size_t i = chunk * chunkSize; i < end; ++i) {
+          const DefinedAtom *atom = atoms[i];
+          for (const Reference *ref : *atom) {
+            if (ref->kindNamespace() != Reference::KindNamespace::mach_o)
+              continue;
+            bool canBypassGOT = false;
+            if (_archHandler.isCallSite(*ref))
+              buckets.callSites.push_back({atom, ref, false});
+            else if (_archHandler.isGOTAccess(*ref, canBypassGOT))
+              buckets.gotAccesses.push_back({atom, ref, canBypassGOT});
+            else if (_archHandler.isTLVAccess(*ref))
+              buckets.tlvAccesses.push_back({atom, ref, false});
+          }
+        }
+      });
+
+  for (const Buckets &buckets : chunks) {
+    append(_callSites, buckets.callSites);
+    append(_gotAccesses, buckets.gotAccesses);
+    append(_tlvAccesses, buckets.tlvAccesses);
+  }
+  return llvm::Error::success();
+}
+
+ReferenceScan &mach_o::addReferenceScan(PassManager &pm,
+                                        const MachOLinkingContext &ctx) {
+  auto scan = llvm::make_unique<ReferenceScan>(ctx.archHandler());
+  ReferenceScan &ret = *scan;
+  pm.add(std::move(scan));
+  return ret;
+}
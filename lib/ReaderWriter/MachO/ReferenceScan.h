@@ -0,0 +1,64 @@
+//===- lib/ReaderWriter/MachO/ReferenceScan.h -------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_READER_WRITER_MACHO_REFERENCE_SCAN_H
+#define LLD_READER_WRITER_MACHO_REFERENCE_SCAN_H
+
+#include "lld/Common/LLVM.h"
+#include "lld/Core/Pass.h"
+#include <vector>
+
+namespace lld {
+class DefinedAtom;
+class Reference;
+class SimpleFile;
+
+namespace mach_o {
+
+class ArchHandler;
+
+/// The references the stubs, GOT and TLV passes rewrite, found in a single
+/// walk over all references of the merged file. The walk runs as a pass of
+/// its own, after the last pass which adds or removes such references and
+/// before the first pass which rewrites them.
+class ReferenceScan : public Pass {
+public:
+  struct Use {
+    const DefinedAtom *atom;
+    const Reference *ref;
+    bool canBypassGOT;
+  };
+
+  explicit ReferenceScan(ArchHandler &archHandler)
+      : _archHandler(archHandler) {}
+
+  const char *name() const override { return "ReferenceScan"; }
+
+  llvm::Error perform(SimpleFile &mergedFile) override;
+
+  /// References which are calls, for the stubs pass.
+  ArrayRef<Use> callSites() const { return _callSites; }
+
+  /// References which load from the GOT, for the GOT pass.
+  ArrayRef<Use> gotAccesses() const { return _gotAccesses; }
+
+  /// References to thread local variables, for the TLV pass.
+  ArrayRef<Use> tlvAccesses() const { return _tlvAccesses; }
+
+private:
+  ArchHandler &_archHandler;
+  std::vector<Use> _callSites;
+  std::vector<Use> _gotAccesses;
+  std::vector<Use> _tlvAccesses;
+};
+
+} // namespace mach_o
+} // namespace lld
+
+#endif // LLD_READER_WRITER_MACHO_REFERENCE_SCAN_H
@@ -47,6 +47,8 @@ public:
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
+  const char *name() const override { return "ShimPass"; }
+
   llvm::Error perform(SimpleFile &mergedFile) override {
     // Scan all references in all atoms.
     for (const DefinedAtom *atom : mergedFile.defined()) {
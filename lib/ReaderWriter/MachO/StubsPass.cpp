@@ -17,6 +17,7 @@
 #include "ArchHandler.h"
 #include "File.h"
 #include "MachOPasses.h"
+#include "ReferenceScan.h"
 #include "lld/Common/LLVM.h"
 #include "lld/Core/DefinedAtom.h"
 #include "lld/Core/File.h"
@@ -208,38 +209,36 @@ private:
 
 class StubsPass : public Pass {
 public:
-  StubsPass(const MachOLinkingContext &context)
+  StubsPass(const MachOLinkingContext &context, const ReferenceScan &scan)
       : _ctx(context), _archHandler(_ctx.archHandler()),
-        _stubInfo(_archHandler.stubInfo()),
+        _stubInfo(_archHandler.stubInfo()), _scan(scan),
         _file(*_ctx.make_file<MachOFile>("<mach-o Stubs pass>")) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
+  const char *name() const override { return "StubsPass"; }
+
   llvm::Error perform(SimpleFile &mergedFile) override {
     // Skip this pass if output format uses text relocations instead of stubs.
     if (!this->noTextRelocs())
       return llvm::Error::success();
 
-    // Scan all references in all atoms.
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        // Look at call-sites.
-        if (!this->isCallSite(*ref))
-          continue;
-        const Atom *target = ref->target();
-        assert(target != nullptr);
-        if (isa<SharedLibraryAtom>(target)) {
-          // Calls to shared libraries go through stubs.
-          _targetToUses[target].push_back(ref);
-          continue;
-        }
-        const DefinedAtom *defTarget = dyn_cast<DefinedAtom>(target);
-        if (defTarget && defTarget->interposable() != DefinedAtom::interposeNo){
-          // Calls to interposable functions in same linkage unit must also go
-          // through a stub.
-          assert(defTarget->scope() != DefinedAtom::scopeTranslationUnit);
-          _targetToUses[target].push_back(ref);
-        }
+    // Look at all call-sites.
+    for (const ReferenceScan::Use &use : _scan.callSites()) {
+      const Reference *ref = use.ref;
+      const Atom *target = ref->target();
+      assert(target != nullptr);
+      if (isa<SharedLibraryAtom>(target)) {
+        // Calls to shared libraries go through stubs.
+        _targetToUses[target].push_back(ref);
+        continue;
+      }
+      const DefinedAtom *defTarget = dyn_cast<DefinedAtom>(target);
+      if (defTarget && defTarget->interposable() != DefinedAtom::interposeNo) {
+        // Calls to interposable functions in same linkage unit must also go
+        // through a stub.
+        assert(defTarget->scope() != DefinedAtom::scopeTranslationUnit);
+        _targetToUses[target].push_back(ref);
       }
     }
 
@@ -331,10 +330,6 @@ private:
     return true;
   }
 
-  bool isCallSite(const Reference &ref) {
-    return _archHandler.isCallSite(ref);
-  }
-
   void addReference(SimpleDefinedAtom* atom,
                     const ArchHandler::ReferenceInfo &refInfo,
                     const lld::Atom* target) {
@@ -367,12 +362,14 @@ private:
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler                            &_archHandler;
   const ArchHandler::StubInfo                    &_stubInfo;
+  const ReferenceScan                            &_scan;
   MachOFile                                      &_file;
   TargetToUses                                    _targetToUses;
 };
 
-void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx) {
-  pm.add(std::unique_ptr<Pass>(new StubsPass(ctx)));
+void addStubsPass(PassManager &pm, const MachOLinkingContext &ctx,
+                  const ReferenceScan &scan) {
+  pm.add(std::unique_ptr<Pass>(new StubsPass(ctx, scan)));
 }
 
 } // end namespace mach_o
@@ -15,6 +15,7 @@
 #include "ArchHandler.h"
 #include "File.h"
 #include "MachOPasses.h"
+#include "ReferenceScan.h"
 #include "lld/Core/Simple.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Debug.h"
@@ -65,34 +66,32 @@ private:
 
 class TLVPass : public Pass {
 public:
-  TLVPass(const MachOLinkingContext &context)
-      : _ctx(context), _archHandler(_ctx.archHandler()),
+  TLVPass(const MachOLinkingContext &context, const ReferenceScan &scan)
+      : _ctx(context), _archHandler(_ctx.archHandler()), _scan(scan),
         _file(*_ctx.make_file<MachOFile>("<mach-o TLV pass>")) {
     _file.setOrdinal(_ctx.getNextOrdinalAndIncrement());
   }
 
+  const char *name() const override { return "TLVPass"; }
+
 private:
   llvm::Error perform(SimpleFile &mergedFile) override {
     bool allowTLV = _ctx.minOS("10.7", "1.0");
 
-    for (const DefinedAtom *atom : mergedFile.defined()) {
-      for (const Reference *ref : *atom) {
-        if (!_archHandler.isTLVAccess(*ref))
-          continue;
-
-        if (!allowTLV)
-          return llvm::make_error<GenericError>(
-            "targeted OS version does not support use of thread local "
-            "variables in " + atom->name() + " for architecture " +
-            _ctx.archName());
+    for (const ReferenceScan::Use &use : _scan.tlvAccesses()) {
+      if (!allowTLV)
+        return llvm::make_error<GenericError>(
+          "targeted OS version does not support use of thread local "
+          "variables in " + use.atom->name() + " for architecture " +
+          _ctx.archName());
 
-        const Atom *target = ref->target();
-        assert(target != nullptr);
+      const Reference *ref = use.ref;
+      const Atom *target = ref->target();
+      assert(target != nullptr);
 
-        const DefinedAtom *tlvpEntry = makeTLVPEntry(target);
-        const_cast<Reference*>(ref)->setTarget(tlvpEntry);
-        _archHandler.updateReferenceToTLV(ref);
-      }
+      const DefinedAtom *tlvpEntry = makeTLVPEntry(target);
+      const_cast<Reference*>(ref)->setTarget(tlvpEntry);
+      _archHandler.updateReferenceToTLV(ref);
     }
 
     std::vector<const TLVPEntryAtom*> entries;
@@ -128,13 +127,15 @@ private:
 
   const MachOLinkingContext &_ctx;
   mach_o::ArchHandler &_archHandler;
+  const ReferenceScan &_scan;
   MachOFile           &_file;
   llvm::DenseMap<const Atom*, const TLVPEntryAtom*> _targetToTLVP;
 };
 
-void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx) {
+void addTLVPass(PassManager &pm, const MachOLinkingContext &ctx,
+                const ReferenceScan &scan) {
   assert(ctx.needsTLVPass());
-  pm.add(llvm::make_unique<TLVPass>(ctx));
+  pm.add(llvm::make_unique<TLVPass>(ctx, scan));
 }
 
 } // end namesapce mach_o
@@ -613,6 +613,14 @@ template <> struct MappingTraits<const lld::File *> {
       return nullptr;
     }
 
+    std::vector<StringRef> symbols() override {
+      std::vector<StringRef> names;
+      for (const ArchMember &member : _members)
+        for (const lld::DefinedAtom *atom : member._content->defined())
+          names.push_back(atom->name());
+      return names;
+    }
+
     std::error_code
     parseAllMembers(std::vector<std::unique_ptr<File>> &result) override {
       return std::error_code();
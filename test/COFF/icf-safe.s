@@ -0,0 +1,76 @@
+# REQUIRES: x86
+# RUN: llvm-mc -triple=x86_64-windows-msvc -filetype=obj -o %t1.obj %s
+# RUN: lld-link /dll /noentry /out:%t.dll /verbose /opt:noref,safeicf \
+# RUN:   %t1.obj > %t.log 2>&1
+# RUN: FileCheck %s < %t.log
+# RUN: not grep -E 'Removed [fg][12]$' %t.log
+# RUN: lld-link /dll /noentry /out:%t.dll /verbose /opt:noref,safeicf \
+# RUN:   /export:g3 /export:f3 %t1.obj 2>&1 | FileCheck --check-prefix=EXPORT %s
+# RUN: lld-link /dll /noentry /out:%t.dll /verbose /opt:noref,icf \
+# RUN:   %t1.obj 2>&1 | FileCheck --check-prefix=ICF %s
+
+## Read-only data and functions that are not in the address-significance
+## table are folded. g1, g2, f1 and f2 are address-significant.
+# CHECK-DAG: Selected g3
+# CHECK-DAG:   Removed g4
+# CHECK-DAG: Selected f3
+# CHECK-DAG:   Removed f4
+# CHECK: ICF folded 2 sections (2 bytes)
+
+## Exported symbols are address-significant too.
+# EXPORT-NOT: Selected
+# EXPORT: ICF folded 0 sections (0 bytes)
+
+## Without safe mode, all functions are folded but no data.
+# ICF-NOT: Selected g
+# ICF: Selected f1
+# ICF-NEXT:   Removed f2
+# ICF-NEXT:   Removed f3
+# ICF-NEXT:   Removed f4
+# ICF: ICF folded 3 sections (3 bytes)
+
+.section .rdata,"dr",one_only,g1
+.globl g1
+g1:
+.byte 1
+
+.section .rdata,"dr",one_only,g2
+.globl g2
+g2:
+.byte 1
+
+.section .rdata,"dr",one_only,g3
+.globl g3
+g3:
+.byte 2
+
+.section .rdata,"dr",one_only,g4
+.globl g4
+g4:
+.byte 2
+
+.section .text,"xr",one_only,f1
+.globl f1
+f1:
+  ret
+
+.section .text,"xr",one_only,f2
+.globl f2
+f2:
+  ret
+
+.section .text,"xr",one_only,f3
+.globl f3
+f3:
+  ret
+
+.section .text,"xr",one_only,f4
+.globl f4
+f4:
+  ret
+
+.addrsig
+.addrsig_sym g1
+.addrsig_sym g2
+.addrsig_sym f1
+.addrsig_sym f2
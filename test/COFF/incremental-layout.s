@@ -0,0 +1,67 @@
+# REQUIRES: x86
+# RUN: llvm-mc -triple=x86_64-windows-msvc -filetype=obj %s -o %t1.obj
+# RUN: llvm-mc -triple=x86_64-windows-msvc -filetype=obj --defsym=GROW=1 \
+# RUN:   %s -o %t2.obj
+# RUN: llvm-mc -triple=x86_64-windows-msvc -filetype=obj --defsym=BIG=1 \
+# RUN:   %s -o %t3.obj
+# RUN: llvm-mc -triple=x86_64-windows-msvc -filetype=obj --defsym=NEWSYM=1 \
+# RUN:   %s -o %t4.obj
+# RUN: echo '.globl bar; bar: ret' | \
+# RUN:   llvm-mc -triple=x86_64-windows-msvc -filetype=obj - -o %tb.obj
+
+## Without an explicit /incremental, no room is reserved.
+# RUN: rm -f %t.exe %t.ilk
+# RUN: cp %t1.obj %t.obj
+# RUN: lld-link -entry:main -opt:noref,noicf %t.obj %tb.obj -out:%t.exe
+# RUN: not ls %t.ilk
+
+## The first link reserves room after each chunk and records it.
+# RUN: lld-link -incremental -entry:main -opt:noref,noicf %t.obj %tb.obj \
+# RUN:   -out:%t.exe -lldmap:%t.map1 -verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=NOSTATE %s
+# RUN: FileCheck --check-prefix=STATE %s < %t.ilk
+# RUN: grep ' bar$' %t.map1 > %t.bar1
+# NOSTATE: /incremental: laying out from scratch because there is no previous state
+# STATE:      lld-link-incremental 1
+# STATE-NEXT: symbols {{[0-9A-F]+}}
+# STATE-NEXT: file {{.*}}.obj
+# STATE-NEXT: {{[0-9]+}} 17
+# STATE:      file {{.*}}b.obj
+# STATE-NEXT: {{[0-9]+}} 17
+
+## The same chunks, one of them grown within its room, keep their addresses
+## and the image is updated in place.
+# RUN: cp %t2.obj %t.obj
+# RUN: lld-link -incremental -entry:main -opt:noref,noicf %t.obj %tb.obj \
+# RUN:   -out:%t.exe -lldmap:%t.map2 -verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=REUSE %s
+# RUN: grep ' bar$' %t.map2 > %t.bar2
+# RUN: diff %t.bar1 %t.bar2
+# REUSE: /incremental: reusing the layout of the previous link
+# REUSE: updated {{[0-9]+}} of {{[0-9]+}} pages of {{.*}} in place
+
+## A chunk that outgrows its room, or a new global symbol, moves chunks.
+# RUN: cp %t3.obj %t.obj
+# RUN: lld-link -incremental -entry:main -opt:noref,noicf %t.obj %tb.obj \
+# RUN:   -out:%t.exe -verbose 2>&1 | FileCheck --check-prefix=GREW %s
+# GREW: /incremental: laying out from scratch because {{.*}}.obj:(.text) grew past its reserved space
+
+# RUN: cp %t4.obj %t.obj
+# RUN: lld-link -incremental -entry:main -opt:noref,noicf %t.obj %tb.obj \
+# RUN:   -out:%t.exe -verbose 2>&1 | FileCheck --check-prefix=SYMS %s
+# SYMS: /incremental: laying out from scratch because the set of symbols changed
+
+.globl main
+main:
+.ifdef GROW
+  nop
+  nop
+.endif
+.ifdef BIG
+  .fill 64, 1, 0x90
+.endif
+.ifdef NEWSYM
+.globl baz
+baz:
+.endif
+  ret
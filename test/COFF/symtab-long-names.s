@@ -0,0 +1,29 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-gnu %s -o %t1.obj
+# RUN: llvm-mc -filetype=obj -triple=x86_64-windows-gnu --defsym SECOND=1 \
+# RUN:   %s -o %t2.obj
+# RUN: lld-link -entry:main -out:%t.exe -debug:dwarf %t1.obj %t2.obj
+# RUN: llvm-readobj -symbols %t.exe | FileCheck %s
+
+## Both files have a local symbol with the same long name. The name is
+## stored once in the string table, and both symbols refer to it.
+
+# CHECK-DAG: Name: main
+# CHECK-DAG: Name: shared_long_local_name
+# CHECK-DAG: Name: shared_long_local_name
+# CHECK-DAG: Name: first_long_global_name
+# CHECK-DAG: Name: second_long_global_name
+
+.text
+.ifdef SECOND
+.globl second_long_global_name
+second_long_global_name:
+.else
+.globl main
+main:
+.globl first_long_global_name
+first_long_global_name:
+.endif
+shared_long_local_name:
+  ret
@@ -0,0 +1,87 @@
+# REQUIRES: aarch64
+# RUN: llvm-mc -filetype=obj -triple=aarch64-unknown-linux %s -o %t.o
+
+# RUN: ld.lld --relax-got %t.o -o %t
+# RUN: llvm-objdump -d %t | FileCheck --check-prefix=RELAX %s
+# RUN: llvm-readobj -s %t | FileCheck --check-prefix=RELAX-GOT %s
+
+# RUN: ld.lld --relax-got -pie %t.o -o %t.pie
+# RUN: llvm-objdump -d %t.pie | FileCheck --check-prefix=RELAX %s
+
+# RUN: ld.lld --relax-got -shared %t.o -o %t.so
+# RUN: llvm-objdump -d %t.so | FileCheck --check-prefix=SHARED %s
+
+# RUN: ld.lld %t.o -o %t.norelax
+# RUN: llvm-objdump -d %t.norelax | FileCheck --check-prefix=NORELAX %s
+# RUN: llvm-readobj -s %t.norelax | FileCheck --check-prefix=NORELAX-GOT %s
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux /dev/null -o %t.x86.o
+# RUN: not ld.lld --relax-got %t.x86.o -o %t.x86 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: --relax-got is only supported on AArch64 targets
+
+## A pair that loads the address of a non-preemptible symbol becomes an
+## address computation. The pair with different registers, the lone ldr
+## and the preemptible symbol in a shared object keep their GOT loads.
+
+# RELAX:      _start:
+# RELAX-NEXT:   adrp x0, #{{[0-9]+}}
+# RELAX-NEXT:   add x0, x0, #{{[0-9]+}}
+# RELAX-NEXT:   adrp x1, #{{[0-9]+}}
+# RELAX-NEXT:   ldr x2, [x1, #{{[0-9]+}}]
+# RELAX-NEXT:   adrp x3, #{{[0-9]+}}
+# RELAX-NEXT:   nop
+# RELAX-NEXT:   ldr x3, [x3, #{{[0-9]+}}]
+# RELAX-NEXT:   adrp x4, #{{[0-9]+}}
+# RELAX-NEXT:   add x4, x4, #{{[0-9]+}}
+
+## Only foo is left in the GOT.
+
+# RELAX-GOT:      Name: .got
+# RELAX-GOT-NEXT: Type: SHT_PROGBITS
+# RELAX-GOT-NEXT: Flags [
+# RELAX-GOT-NEXT:   SHF_ALLOC
+# RELAX-GOT-NEXT:   SHF_WRITE
+# RELAX-GOT-NEXT: ]
+# RELAX-GOT-NEXT: Address:
+# RELAX-GOT-NEXT: Offset:
+# RELAX-GOT-NEXT: Size: 8
+
+# NORELAX-GOT:      Name: .got
+# NORELAX-GOT-NEXT: Type: SHT_PROGBITS
+# NORELAX-GOT-NEXT: Flags [
+# NORELAX-GOT-NEXT:   SHF_ALLOC
+# NORELAX-GOT-NEXT:   SHF_WRITE
+# NORELAX-GOT-NEXT: ]
+# NORELAX-GOT-NEXT: Address:
+# NORELAX-GOT-NEXT: Offset:
+# NORELAX-GOT-NEXT: Size: 16
+
+# SHARED:      _start:
+# SHARED-NEXT:   adrp x0, #{{[0-9]+}}
+# SHARED-NEXT:   ldr x0, [x0, #{{[0-9]+}}]
+
+# NORELAX:      _start:
+# NORELAX-NEXT:   adrp x0, #{{[0-9]+}}
+# NORELAX-NEXT:   ldr x0, [x0, #{{[0-9]+}}]
+
+.globl _start
+_start:
+  adrp x0, :got:foo
+  ldr  x0, [x0, :got_lo12:foo]
+  adrp x1, :got:foo
+  ldr  x2, [x1, :got_lo12:foo]
+  adrp x3, :got:foo
+  nop
+  ldr  x3, [x3, :got_lo12:foo]
+  adrp x4, :got:bar
+  ldr  x4, [x4, :got_lo12:bar]
+
+.data
+.globl foo
+foo:
+  .quad 0
+.hidden bar
+.globl bar
+bar:
+  .quad 0
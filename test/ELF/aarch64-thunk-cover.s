@@ -0,0 +1,40 @@
+// REQUIRES: aarch64
+// RUN: llvm-mc -filetype=obj -triple=aarch64-linux-gnu %s -o %t.o
+// RUN: echo "SECTIONS { \
+// RUN:       .text_low 0x2000: { *(.text_low) } \
+// RUN:       .text_high 0x8002000 : { *(.text_high) } \
+// RUN:       } " > %t.script
+// RUN: ld.lld --script %t.script --thunk-placement=cover --print-stats \
+// RUN:   %t.o -o %t | FileCheck --check-prefix=STATS %s
+// RUN: llvm-objdump -d -triple=aarch64-linux-gnu %t | FileCheck %s
+
+// RUN: not ld.lld --script %t.script --thunk-placement=foo %t.o -o %t2 2>&1 \
+// RUN:   | FileCheck --check-prefix=ERR %s
+// ERR: unknown --thunk-placement mode: foo
+
+// Both callers of high_target share one thunk.
+// STATS: thunks created: 1 in pass 0
+// STATS: thunk bytes: 16
+
+// CHECK: Disassembly of section .text_low:
+// CHECK-NEXT: _start:
+// CHECK-NEXT:     2000:       03 00 00 94     bl      #12
+// CHECK-NEXT:     2004:       02 00 00 94     bl      #8
+// CHECK-NEXT:     2008:       c0 03 5f d6     ret
+// CHECK: __AArch64AbsLongThunk_high_target:
+// CHECK-NEXT:     200c:       50 00 00 58     ldr     x16, #8
+// CHECK-NEXT:     2010:       00 02 1f d6     br      x16
+
+ .section .text_low, "ax", %progbits
+ .globl _start
+ .type _start, %function
+_start:
+ bl high_target
+ bl high_target
+ ret
+
+ .section .text_high, "ax", %progbits
+ .globl high_target
+ .type high_target, %function
+high_target:
+ ret
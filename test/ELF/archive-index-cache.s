@@ -0,0 +1,37 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/Inputs/archive.s -o %t2.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/Inputs/archive2.s -o %t3.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/Inputs/archive3.s -o %t4.o
+# RUN: rm -f %t.a
+# RUN: llvm-ar rcs %t.a %t2.o %t3.o
+# RUN: ld.lld %t.o %t.a -o %t
+
+## The first link fills the cache and the second one reads from it. Both
+## fetch the same members as a link without the cache.
+# RUN: rm -rf %t.cache
+# RUN: ld.lld --archive-index-cache-dir=%t.cache --print-stats \
+# RUN:   %t.o %t.a -o %t.miss | FileCheck --check-prefix=MISS %s
+# RUN: ls %t.cache | count 1
+# RUN: ld.lld --archive-index-cache-dir=%t.cache --print-stats \
+# RUN:   %t.o %t.a -o %t.hit | FileCheck --check-prefix=HIT %s
+# RUN: cmp %t %t.miss
+# RUN: cmp %t %t.hit
+# RUN: llvm-nm %t.hit | FileCheck --check-prefix=SYMS %s
+
+# MISS: archive index cache:    0 hits, 1 misses
+# HIT:  archive index cache:    1 hits, 0 misses
+
+# SYMS: T _start
+# SYMS: T end
+# SYMS: T foo
+
+## A rewritten archive gets a new entry.
+# RUN: rm -f %t.a
+# RUN: llvm-ar rcs %t.a %t2.o %t3.o %t4.o
+# RUN: ld.lld --archive-index-cache-dir=%t.cache --print-stats \
+# RUN:   %t.o %t.a -o %t.new | FileCheck --check-prefix=MISS %s
+# RUN: ls %t.cache | count 2
+
+.quad end
+.quad foo
@@ -1,6 +1,9 @@
 // REQUIRES: arm
 // RUN: llvm-mc -filetype=obj -triple=armv7a-none-linux-gnueabi %s -o %t
 // RUN: ld.lld %t -o %t2 2>&1
+// RUN: ld.lld --threads=1 %t -o %t3 2>&1
+// RUN: cmp %t2 %t3
+// RUN: ld.lld --print-stats %t -o %t3 | FileCheck -check-prefix=STATS %s
 // The output file is large, most of it zeroes. We dissassemble only the
 // parts we need to speed up the test and avoid a large output file
 // RUN: llvm-objdump -d %t2 -start-address=1048578 -stop-address=1048586 -triple=thumbv7a-linux-gnueabihf  | FileCheck -check-prefix=CHECK1 %s
@@ -10,6 +13,10 @@
 // extended can be pushed out of range by another Thunk, necessitating another
 // pass
 
+// Every relocation is examined in the first pass; later passes only revisit
+// the relocations whose place or target has moved.
+// STATS: thunks created: {{[0-9]+}} in pass 0 ({{[0-9]+}} relocations), {{[0-9]+}} in pass 1 ({{[0-9]+}} relocations)
+
  .macro FUNCTION suff
  .section .text.\suff\(), "ax", %progbits
  .thumb
@@ -0,0 +1,94 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+# RUN: ld.lld --gc-sections %t.o -o %t1
+# RUN: llvm-nm %t1 | FileCheck --check-prefix=NOATOM %s
+# NOATOM: T unused
+# NOATOM: B var_unused
+
+# RUN: ld.lld --gc-sections --atomize-sections %t.o -o %t2
+# RUN: llvm-nm %t2 | FileCheck %s
+# RUN: llvm-objdump -s -j .rodata %t2 | FileCheck --check-prefix=DATA %s
+
+## unused and var_unused are removed. .text.keep is not split because it
+## defines a local symbol, so kept_b stays.
+# CHECK:      T _start
+# CHECK-NEXT: T kept_a
+# CHECK-NEXT: T kept_b
+# CHECK-NEXT: t local_fn
+# CHECK-NEXT: R table
+# CHECK-NEXT: 0000000000201019 T used
+# CHECK-NEXT: B var_used
+
+## table refers to .Lused_body through the section symbol of .text, and still
+## points into used after the split.
+# DATA: Contents of section .rodata:
+# DATA-NEXT: {{[0-9a-f]+}} 1a102000 00000000
+
+# RUN: not ld.lld -r --atomize-sections %t.o -o %t3 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: -r and --atomize-sections may not be used together
+
+.text
+.globl _start, used, unused
+.type _start, @function
+_start:
+  call used@PLT
+  call kept_a@PLT
+  movq table(%rip), %rax
+  movq var_used(%rip), %rax
+  ret
+.size _start, . - _start
+
+.type used, @function
+used:
+  .cfi_startproc
+  nop
+.Lused_body:
+  ret
+  .cfi_endproc
+.size used, . - used
+
+.type unused, @function
+unused:
+  .cfi_startproc
+  ret
+  .cfi_endproc
+.size unused, . - unused
+
+.section .text.keep,"ax",@progbits
+.globl kept_a, kept_b
+.type kept_a, @function
+kept_a:
+  call local_fn
+  ret
+.size kept_a, . - kept_a
+
+.type kept_b, @function
+kept_b:
+  ret
+.size kept_b, . - kept_b
+
+.type local_fn, @function
+local_fn:
+  ret
+.size local_fn, . - local_fn
+
+.section .rodata,"a",@progbits
+.globl table
+.type table, @object
+table:
+  .quad .Lused_body
+.size table, 8
+
+.bss
+.globl var_used, var_unused
+.type var_used, @object
+var_used:
+  .zero 8
+.size var_used, 8
+
+.type var_unused, @object
+var_unused:
+  .zero 8
+.size var_unused, 8
@@ -0,0 +1,42 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/Inputs/archive.s -o %t2.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/Inputs/archive2.s -o %t3.o
+# RUN: rm -f %t.a
+# RUN: llvm-ar rcs %t.a %t2.o %t3.o
+# RUN: ld.lld %t.o %t.a -o %t
+
+## Every line of the batch file is one link. The archive is indexed by the
+## first link only.
+# RUN: rm -f %t.out1 %t.out2
+# RUN: echo "# comment" > %t.batch
+# RUN: echo "-o %t.out1" >> %t.batch
+# RUN: echo "" >> %t.batch
+# RUN: echo "-o %t.out2" >> %t.batch
+# RUN: ld.lld --batch=%t.batch --print-stats %t.o %t.a | FileCheck %s
+# RUN: cmp %t %t.out1
+# RUN: cmp %t %t.out2
+
+# CHECK:     archive index cache:    0 hits, 1 misses
+# CHECK:     archive index cache:    1 hits, 0 misses
+# CHECK-NOT: archive index cache
+
+## A failing link does not stop the batch, but makes it fail.
+# RUN: rm -f %t.out2
+# RUN: echo "-o %t.out1 --no-such-option" > %t.batch2
+# RUN: echo "-o %t.out2" >> %t.batch2
+# RUN: not ld.lld --batch=%t.batch2 %t.o %t.a 2>&1 | FileCheck --check-prefix=ERR %s
+# RUN: cmp %t %t.out2
+
+# ERR: unknown argument: --no-such-option
+
+# RUN: echo "--batch=%t.batch" > %t.rsp
+# RUN: not ld.lld --batch=%t.batch @%t.rsp %t.o %t.a 2>&1 | \
+# RUN:   FileCheck --check-prefix=NESTED %s
+# NESTED: error: --batch must be given on the command line
+
+# RUN: not ld.lld --batch=%t.nonexistent %t.o 2>&1 | FileCheck --check-prefix=OPEN %s
+# OPEN: error: --batch: cannot open {{.*}}nonexistent
+
+.quad end
+.quad foo
@@ -0,0 +1,63 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: echo "A B 100" > %t.call_graph
+# RUN: echo "D B 90" >> %t.call_graph
+
+## C³ appends B to its hottest caller A and leaves D on its own.
+# RUN: ld.lld -e A %t.o --call-graph-ordering-file %t.call_graph -o %t.c3
+# RUN: llvm-nm --numeric-sort %t.c3 | FileCheck --check-prefix=C3 %s
+# RUN: ld.lld -e A %t.o --call-graph-ordering-file %t.call_graph \
+# RUN:   --call-graph-sort=c3 -o %t.c3
+# RUN: llvm-nm --numeric-sort %t.c3 | FileCheck --check-prefix=C3 %s
+
+# C3:      T A
+# C3-NEXT: T B
+# C3-NEXT: T D
+
+## hfsort+ first places D right before B, which is the best single merge
+## with 64-byte pages, and then puts A after them rather than before.
+# RUN: ld.lld -e A %t.o --call-graph-ordering-file %t.call_graph \
+# RUN:   --call-graph-sort=hfsort+ --call-graph-page-size=64 --print-stats \
+# RUN:   -o %t.hfsort 2>&1 | FileCheck --check-prefix=STATS %s
+# RUN: llvm-nm --numeric-sort %t.hfsort | FileCheck --check-prefix=HFSORT %s
+
+# STATS: call graph locality:     0.711
+
+# HFSORT:      T D
+# HFSORT-NEXT: T B
+# HFSORT-NEXT: T A
+
+## A and B do not fit in one 32-byte cluster, so B is placed first on its
+## own as the densest section.
+# RUN: ld.lld -e A %t.o --call-graph-ordering-file %t.call_graph \
+# RUN:   --call-graph-cluster-size=32 -o %t.small
+# RUN: llvm-nm --numeric-sort %t.small | FileCheck --check-prefix=SMALL %s
+
+# SMALL:      T B
+# SMALL-NEXT: T A
+# SMALL-NEXT: T D
+
+# RUN: not ld.lld -e A %t.o --call-graph-ordering-file %t.call_graph \
+# RUN:   --call-graph-sort=foo -o /dev/null 2>&1 | FileCheck --check-prefix=ERR %s
+# RUN: not ld.lld -e A %t.o --call-graph-ordering-file %t.call_graph \
+# RUN:   --call-graph-page-size=0 -o /dev/null 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR-PAGE %s
+
+# ERR: unknown --call-graph-sort algorithm: foo
+# ERR-PAGE: --call-graph-page-size: page size must be > 0
+
+    .section .text.A,"ax",@progbits
+    .globl A
+A:
+    .zero 40
+
+    .section .text.B,"ax",@progbits
+    .globl B
+B:
+    .zero 8
+
+    .section .text.D,"ax",@progbits
+    .globl D
+D:
+    .zero 16
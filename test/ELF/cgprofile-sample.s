@@ -0,0 +1,84 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## The program the perf profile was recorded from, with each function at
+## a known address.
+# RUN: echo "SECTIONS { .a 0x1000 : { *(.text.A) } .b 0x2000 : { *(.text.B) } \
+# RUN:   .c 0x3000 : { *(.text.C) } .d 0x4000 : { *(.text.D) } }" > %t.script
+# RUN: ld.lld -e A %t.o -T %t.script -o %t.old
+
+## A calls C 3 times and there is one branch inside B. The return from C to
+## A is not a call and is ignored.
+# RUN: echo "0x1001/0x3000/P/-/-/0 0x3001/0x1002/P/-/-/0" > %t.perf
+# RUN: echo "0x1001/0x3000/P/-/-/0 0x1001/0x3000/P/-/-/0" >> %t.perf
+# RUN: echo "0x2001/0x2002/P/-/-/0" >> %t.perf
+# RUN: ld.lld -e A %t.o --call-graph-profile-perf=%t.perf \
+# RUN:   --call-graph-profile-binary=%t.old -o %t.hot
+# RUN: llvm-nm --numeric-sort %t.hot | FileCheck --check-prefix=HOTB %s
+# RUN: ld.lld -e A %t.o --call-graph-profile-perf=%t.perf \
+# RUN:   --call-graph-profile-binary=%t.old \
+# RUN:   --call-graph-profile-min-samples=2 -o %t.cold
+# RUN: llvm-nm --numeric-sort %t.cold | FileCheck --check-prefix=COLDB %s
+
+## The same profile in the AutoFDO text format.
+# RUN: echo "A:100:0" > %t.afdo
+# RUN: echo " 1: 50 C:40" >> %t.afdo
+# RUN: echo " 2: 10" >> %t.afdo
+# RUN: echo "B:1:0" >> %t.afdo
+# RUN: echo " 1: 1" >> %t.afdo
+# RUN: ld.lld -e A %t.o --call-graph-profile-autofdo=%t.afdo -o %t.afdo.hot
+# RUN: llvm-nm --numeric-sort %t.afdo.hot | FileCheck --check-prefix=HOTB %s
+# RUN: ld.lld -e A %t.o --call-graph-profile-autofdo=%t.afdo \
+# RUN:   --call-graph-profile-min-samples=2 -o %t.afdo.cold
+# RUN: llvm-nm --numeric-sort %t.afdo.cold | FileCheck --check-prefix=COLDB %s
+
+# HOTB:      T A
+# HOTB-NEXT: T C
+# HOTB-NEXT: T B
+# HOTB-NEXT: T D
+
+# COLDB:      T A
+# COLDB-NEXT: T C
+# COLDB-NEXT: T D
+# COLDB-NEXT: T B
+
+# RUN: not ld.lld -e A %t.o --call-graph-profile-perf=%t.perf -o /dev/null \
+# RUN:   2>&1 | FileCheck --check-prefix=ERR %s
+# ERR: error: --call-graph-profile-perf requires --call-graph-profile-binary
+
+    .section .text.D,"ax",@progbits
+    .globl D
+    .type D,@function
+D:
+    nop
+    nop
+    retq
+    .size D, .-D
+
+    .section .text.C,"ax",@progbits
+    .globl C
+    .type C,@function
+C:
+    nop
+    nop
+    retq
+    .size C, .-C
+
+    .section .text.B,"ax",@progbits
+    .globl B
+    .type B,@function
+B:
+    nop
+    nop
+    retq
+    .size B, .-B
+
+    .section .text.A,"ax",@progbits
+    .globl A
+    .type A,@function
+A:
+    nop
+    nop
+    retq
+    .size A, .-A
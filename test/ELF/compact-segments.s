@@ -0,0 +1,35 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+# RUN: ld.lld %t.o -o %t
+# RUN: llvm-readelf -l %t | FileCheck --check-prefix=DEFAULT %s
+# DEFAULT:      LOAD 0x000000 0x0000000000200000 {{.*}} R   0x1000
+# DEFAULT-NEXT: LOAD 0x001000 0x0000000000201000 {{.*}} R E 0x1000
+# DEFAULT-NEXT: LOAD 0x002000 0x0000000000202000 {{.*}} RW  0x1000
+
+## The read-only data shares the executable segment, and the writable
+## segment follows it in the file without padding. In memory it starts on
+## the next page, at the same offset within the page.
+# RUN: ld.lld -z compact-segments %t.o -o %t2
+# RUN: llvm-readelf -l %t2 | FileCheck --check-prefix=COMPACT %s
+# COMPACT:      LOAD 0x000000 0x0000000000200000 {{.*}} R E 0x1000
+# COMPACT-NEXT: LOAD 0x000[[OFF:[0-9a-f]{3}]] 0x0000000000201[[OFF]] {{.*}} RW  0x1000
+# COMPACT-NOT:  LOAD
+
+# RUN: ld.lld -z compact-segments --print-stats %t.o -o %t2 | \
+# RUN:   FileCheck --check-prefix=STATS %s
+# STATS: compact segments: 2 PT_LOADs, about {{[1-9][0-9]*}} bytes of padding saved
+
+# RUN: not ld.lld -z compact-segments -z hugepage-text %t.o -o %t3 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: -z compact-segments and -z hugepage-text may not be used together
+
+.globl _start
+_start:
+  ret
+
+.section .rodata,"a"
+.byte 1
+
+.data
+.byte 2
@@ -0,0 +1,32 @@
+# REQUIRES: x86, zlib
+
+## .debug_info is larger than a compression shard, so it is compressed in
+## pieces that are joined into a single zlib stream.
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t1 --compress-debug-sections=zlib --threads
+# RUN: ld.lld %t.o -o %t2 --compress-debug-sections=zlib --no-threads
+# RUN: cmp %t1 %t2
+
+# RUN: llvm-objcopy --decompress-debug-sections %t1 %t.dec
+# RUN: ld.lld %t.o -o %t.plain
+# RUN: llvm-objdump -s -j .debug_info %t.dec > %t.dec.txt
+# RUN: llvm-objdump -s -j .debug_info %t.plain > %t.plain.txt
+# RUN: diff %t.dec.txt %t.plain.txt
+
+## Higher levels produce a different stream that still decompresses.
+# RUN: ld.lld %t.o -o %t3 --compress-debug-sections=zlib \
+# RUN:   --compress-debug-sections-level=9
+# RUN: llvm-objcopy --decompress-debug-sections %t3 %t3.dec
+# RUN: llvm-objdump -s -j .debug_info %t3.dec > %t3.dec.txt
+# RUN: diff %t3.dec.txt %t.plain.txt
+
+# RUN: not ld.lld %t.o -o %t4 --compress-debug-sections=zlib \
+# RUN:   --compress-debug-sections-level=10 2>&1 | FileCheck --check-prefix=ERR %s
+# ERR: --compress-debug-sections-level: level must be between 1 and 9
+
+.section .debug_info,"",@progbits
+.rept 0x6000
+.ascii "0123456789abcdef0123456789ABCDEF0123456789abcdef0123456789ABCDEF"
+.quad .
+.endr
@@ -0,0 +1,31 @@
+# REQUIRES: x86, zstd
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t1 --compress-debug-sections=zstd
+# RUN: ld.lld %t.o -o %t2 --compress-debug-sections=zstd --no-threads
+# RUN: cmp %t1 %t2
+
+# RUN: llvm-readobj -s %t1 | FileCheck %s --check-prefix=FLAGS
+# FLAGS:      Name: .debug_str
+# FLAGS-NEXT: Type: SHT_PROGBITS
+# FLAGS-NEXT: Flags [
+# FLAGS-NEXT:   SHF_COMPRESSED
+
+## The Elf64_Chdr starts with ELFCOMPRESS_ZSTD and the zstd frame follows the
+## 24-byte header.
+# RUN: llvm-objdump -s -j .debug_str %t1 | FileCheck %s --check-prefix=CHDR
+# CHDR:      Contents of section .debug_str:
+# CHDR-NEXT: 0000 02000000 00000000 38000000 00000000
+# CHDR-NEXT: 0010 01000000 00000000 28b52ffd
+
+# RUN: ld.lld %t.o -o %t3 --compress-debug-sections=zstd \
+# RUN:   --compress-debug-sections-level=19
+# RUN: not ld.lld %t.o -o %t4 --compress-debug-sections=zstd \
+# RUN:   --compress-debug-sections-level=20 2>&1 | FileCheck --check-prefix=ERR %s
+# ERR: --compress-debug-sections-level: level must be between 1 and 19
+
+.section .debug_str,"MS",@progbits,1
+.Linfo_string0:
+  .asciz "AAAAAAAAAAAAAAAAAAAAAAAAAAA"
+.Linfo_string1:
+  .asciz "BBBBBBBBBBBBBBBBBBBBBBBBBBB"
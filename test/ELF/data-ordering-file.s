@@ -0,0 +1,84 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t.out
+# RUN: llvm-objdump -s %t.out | FileCheck %s --check-prefix=BEFORE
+
+# BEFORE:      Contents of section .text:
+# BEFORE-NEXT:  201000 c3c3
+# BEFORE:      Contents of section .rodata:
+# BEFORE-NEXT:  {{[0-9a-f]+}} 11223344
+# BEFORE:      Contents of section .data:
+# BEFORE-NEXT:  {{[0-9a-f]+}} 55667788
+
+# RUN: echo "data4" > %t_order.txt
+# RUN: echo "ro3" >> %t_order.txt
+# RUN: echo "func2" >> %t_order.txt
+# RUN: echo "data2" >> %t_order.txt
+# RUN: echo "missing" >> %t_order.txt
+
+# RUN: ld.lld --data-ordering-file %t_order.txt %t.o -o %t2.out 2>&1 | \
+# RUN:   FileCheck %s --check-prefix=WARN
+# RUN: llvm-objdump -s %t2.out | FileCheck %s --check-prefix=AFTER
+
+# WARN:      warning: {{.*}}.o: unable to order code symbol: func2
+# WARN-NEXT: warning: data ordering file: no such symbol: missing
+
+## Listed data goes first in the order of the file; code is not moved and
+## unlisted data keeps its order after the listed data.
+# AFTER:      Contents of section .text:
+# AFTER-NEXT:  201000 c3c3
+# AFTER:      Contents of section .rodata:
+# AFTER-NEXT:  {{[0-9a-f]+}} 33112244
+# AFTER:      Contents of section .data:
+# AFTER-NEXT:  {{[0-9a-f]+}} 88665577
+
+## Data symbols override the order given by --symbol-ordering-file.
+# RUN: echo "data1" > %t_sym.txt
+# RUN: echo "func2" >> %t_sym.txt
+# RUN: ld.lld --symbol-ordering-file %t_sym.txt --data-ordering-file \
+# RUN:   %t_order.txt --no-warn-symbol-ordering %t.o -o %t3.out
+# RUN: llvm-objdump -s %t3.out | FileCheck %s --check-prefix=BOTH
+
+# BOTH:      Contents of section .data:
+# BOTH-NEXT:  {{[0-9a-f]+}} 88665577
+
+.section .text.func1,"ax",@progbits
+.globl _start
+_start:
+ ret
+
+.section .text.func2,"ax",@progbits
+func2:
+ ret
+
+.section .rodata.ro1,"a",@progbits
+ro1:
+ .byte 0x11
+
+.section .rodata.ro2,"a",@progbits
+ro2:
+ .byte 0x22
+
+.section .rodata.ro3,"a",@progbits
+ro3:
+ .byte 0x33
+
+.section .rodata.ro4,"a",@progbits
+ro4:
+ .byte 0x44
+
+.section .data.data1,"aw",@progbits
+data1:
+ .byte 0x55
+
+.section .data.data2,"aw",@progbits
+data2:
+ .byte 0x66
+
+.section .data.data3,"aw",@progbits
+data3:
+ .byte 0x77
+
+.section .data.data4,"aw",@progbits
+data4:
+ .byte 0x88
@@ -0,0 +1,127 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux \
+# RUN:   %p/Inputs/gdb-index.s -o %t2.o
+# RUN: ld.lld --debug-names %t1.o %t2.o -o %t
+# RUN: llvm-dwarfdump -debug-names %t | FileCheck %s
+# RUN: llvm-dwarfdump -debug-names %t | FileCheck -check-prefix=FOO %s
+# RUN: llvm-dwarfdump -debug-names %t | FileCheck -check-prefix=AAA %s
+# RUN: llvm-dwarfdump -debug-names %t | FileCheck -check-prefix=INT %s
+
+## The name index of %t1.o is merged with the names that %t2.o has in
+## .debug_gnu_pubnames and .debug_gnu_pubtypes into a single name index.
+
+# CHECK:      .debug_names contents:
+# CHECK-NEXT: Name Index @ 0x0 {
+# CHECK:        CU count: 2
+# CHECK:        Local TU count: 0
+# CHECK:        Foreign TU count: 0
+# CHECK:        Name count: 3
+# CHECK:      Compilation Unit offsets [
+# CHECK-NEXT:   CU[0]: 0x00000000
+# CHECK-NEXT:   CU[1]: 0x00000016
+# CHECK-NEXT: ]
+# CHECK-NOT:  Name Index @
+
+# FOO:      String: 0x{{[0-9a-f]+}} "foo"
+# FOO-NEXT: Entry @ 0x{{[0-9a-f]+}} {
+# FOO-NEXT:   Abbrev: 0x2
+# FOO-NEXT:   Tag: DW_TAG_subprogram
+# FOO-NEXT:   DW_IDX_compile_unit: 0x{{0*}}0{{$}}
+# FOO-NEXT:   DW_IDX_die_offset: {{.*}}0x{{0*}}10
+
+## %t2.o has split DWARF, so tags are guessed from the pubnames kinds.
+# AAA:      String: 0x{{[0-9a-f]+}} "aaaaaaaaaaaaaaaa"
+# AAA-NEXT: Entry @ 0x{{[0-9a-f]+}} {
+# AAA-NEXT:   Abbrev: 0x2
+# AAA-NEXT:   Tag: DW_TAG_subprogram
+# AAA-NEXT:   DW_IDX_compile_unit: 0x{{0*}}1{{$}}
+# AAA-NEXT:   DW_IDX_die_offset: {{.*}}0x{{0*}}18
+
+# INT:      String: 0x{{[0-9a-f]+}} "int"
+# INT-NEXT: Entry @ 0x{{[0-9a-f]+}} {
+# INT-NEXT:   Abbrev: 0x1
+# INT-NEXT:   Tag: DW_TAG_structure_type
+# INT-NEXT:   DW_IDX_compile_unit: 0x{{0*}}1{{$}}
+# INT-NEXT:   DW_IDX_die_offset: {{.*}}0x{{0*}}2b
+
+# RUN: not ld.lld -r --debug-names %t1.o -o %t.o 2>&1 \
+# RUN:   | FileCheck -check-prefix=RELOC %s
+# RELOC: -r and --debug-names may not be used together
+
+.text
+.globl foo
+.type foo, @function
+foo:
+  nop
+
+.section .debug_abbrev,"",@progbits
+.uleb128 1      # Abbreviation code
+.uleb128 0x11   # DW_TAG_compile_unit
+.byte 1         # DW_CHILDREN_yes
+.uleb128 0x3    # DW_AT_name
+.uleb128 0xe    # DW_FORM_strp
+.byte 0
+.byte 0
+.uleb128 2      # Abbreviation code
+.uleb128 0x2e   # DW_TAG_subprogram
+.byte 0         # DW_CHILDREN_no
+.uleb128 0x3    # DW_AT_name
+.uleb128 0xe    # DW_FORM_strp
+.byte 0
+.byte 0
+.byte 0
+
+.section .debug_info,"",@progbits
+.Lcu_begin0:
+.long .Lcu_end0 - .Lcu_start0
+.Lcu_start0:
+.short 4        # DWARF version
+.long 0         # Abbreviation offset
+.byte 8         # Address size
+.uleb128 1      # DW_TAG_compile_unit
+.long .Lstr_cu
+.Ldie_foo:
+.uleb128 2      # DW_TAG_subprogram
+.long .Lstr_foo
+.byte 0
+.Lcu_end0:
+
+.section .debug_str,"MS",@progbits,1
+.Lstr_cu:
+.asciz "a.c"
+.Lstr_foo:
+.asciz "foo"
+
+.section .debug_names,"",@progbits
+.long .Lnames_end - .Lnames_start
+.Lnames_start:
+.short 5        # Version
+.short 0        # Padding
+.long 1         # CU count
+.long 0         # Local TU count
+.long 0         # Foreign TU count
+.long 1         # Bucket count
+.long 1         # Name count
+.long .Labbrev_end - .Labbrev_begin
+.long 0         # Augmentation string size
+.long .Lcu_begin0
+.long 1         # Bucket 0
+.long 0x0b887389  # Hash of "foo"
+.long .Lstr_foo
+.long .Lentry_foo - .Lentries
+.Labbrev_begin:
+.uleb128 0x2e   # Abbreviation code
+.uleb128 0x2e   # DW_TAG_subprogram
+.uleb128 3      # DW_IDX_die_offset
+.uleb128 0x13   # DW_FORM_ref4
+.byte 0
+.byte 0
+.byte 0
+.Labbrev_end:
+.Lentries:
+.Lentry_foo:
+.uleb128 0x2e
+.long .Ldie_foo - .Lcu_begin0
+.byte 0
+.Lnames_end:
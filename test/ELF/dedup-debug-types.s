@@ -0,0 +1,131 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym=SECOND=1 \
+# RUN:   %s -o %t2.o
+
+# RUN: ld.lld %t1.o %t2.o -o %t
+# RUN: llvm-dwarfdump -debug-info %t | FileCheck --check-prefix=NODEDUP %s
+# NODEDUP: 0x00000030: Compile Unit: length = 0x0000002c
+# NODEDUP: DW_TAG_structure_type
+
+# RUN: ld.lld --dedup-debug-types %t1.o %t2.o -o %t
+# RUN: llvm-dwarfdump -debug-info %t | FileCheck %s
+# RUN: llvm-dwarfdump --verify %t | FileCheck --check-prefix=VERIFY %s
+
+# CHECK:      0x00000000: Compile Unit: length = 0x0000002c
+# CHECK:      0x00000017: DW_TAG_structure_type
+# CHECK-NEXT:   DW_AT_name ("foo")
+# CHECK:      0x00000026: DW_TAG_variable
+# CHECK-NEXT:   DW_AT_name ("var")
+# CHECK-NEXT:   DW_AT_type (0x00000017 "foo")
+
+## The second unit refers to foo in the first one, and its own copies of foo
+## and int are gone.
+# CHECK:      0x00000030: Compile Unit: length = 0x00000016{{.*}}abbr_offset = 0x0030
+# CHECK-NOT:  DW_TAG_base_type
+# CHECK-NOT:  DW_TAG_structure_type
+# CHECK:      0x00000040: DW_TAG_variable
+# CHECK-NEXT:   DW_AT_name ("var")
+# CHECK-NEXT:   DW_AT_type (0x00000017 "foo")
+
+# VERIFY: No errors.
+
+# RUN: not ld.lld -r --dedup-debug-types %t1.o %t2.o -o %t.ro 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR1 %s
+# ERR1: -r and --dedup-debug-types may not be used together
+
+# RUN: not ld.lld --dedup-debug-types --gdb-index %t1.o %t2.o -o %t 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR2 %s
+# ERR2: --dedup-debug-types and --gdb-index may not be used together
+
+.section .debug_abbrev,"",@progbits
+  .byte 1             # Abbreviation code
+  .byte 0x11          # DW_TAG_compile_unit
+  .byte 1             # DW_CHILDREN_yes
+  .byte 0x03          # DW_AT_name
+  .byte 0x08          # DW_FORM_string
+  .byte 0, 0
+
+  .byte 2             # Abbreviation code
+  .byte 0x13          # DW_TAG_structure_type
+  .byte 1             # DW_CHILDREN_yes
+  .byte 0x03          # DW_AT_name
+  .byte 0x0e          # DW_FORM_strp
+  .byte 0x0b          # DW_AT_byte_size
+  .byte 0x0b          # DW_FORM_data1
+  .byte 0, 0
+
+  .byte 3             # Abbreviation code
+  .byte 0x0d          # DW_TAG_member
+  .byte 0             # DW_CHILDREN_no
+  .byte 0x03          # DW_AT_name
+  .byte 0x08          # DW_FORM_string
+  .byte 0x49          # DW_AT_type
+  .byte 0x13          # DW_FORM_ref4
+  .byte 0x38          # DW_AT_data_member_location
+  .byte 0x0b          # DW_FORM_data1
+  .byte 0, 0
+
+  .byte 4             # Abbreviation code
+  .byte 0x24          # DW_TAG_base_type
+  .byte 0             # DW_CHILDREN_no
+  .byte 0x03          # DW_AT_name
+  .byte 0x08          # DW_FORM_string
+  .byte 0x3e          # DW_AT_encoding
+  .byte 0x0b          # DW_FORM_data1
+  .byte 0x0b          # DW_AT_byte_size
+  .byte 0x0b          # DW_FORM_data1
+  .byte 0, 0
+
+  .byte 5             # Abbreviation code
+  .byte 0x34          # DW_TAG_variable
+  .byte 0             # DW_CHILDREN_no
+  .byte 0x03          # DW_AT_name
+  .byte 0x08          # DW_FORM_string
+  .byte 0x49          # DW_AT_type
+  .byte 0x13          # DW_FORM_ref4
+  .byte 0, 0
+
+  .byte 0
+
+.section .debug_info,"",@progbits
+.Lcu:
+  .long .Lcu_end - .Lcu_begin
+.Lcu_begin:
+  .short 4            # DWARF version
+  .long .debug_abbrev
+  .byte 8             # Address size
+
+  .byte 1             # DW_TAG_compile_unit
+.ifdef SECOND
+  .asciz "b.c"
+.else
+  .asciz "a.c"
+.endif
+
+.Lint:
+  .byte 4             # DW_TAG_base_type
+  .asciz "int"
+  .byte 5             # DW_ATE_signed
+  .byte 4
+
+.Lfoo:
+  .byte 2             # DW_TAG_structure_type
+  .long .Lstr_foo
+  .byte 4
+  .byte 3             # DW_TAG_member
+  .asciz "x"
+  .long .Lint - .Lcu
+  .byte 0
+  .byte 0
+
+  .byte 5             # DW_TAG_variable
+  .asciz "var"
+  .long .Lfoo - .Lcu
+
+  .byte 0
+.Lcu_end:
+
+.section .debug_str,"MS",@progbits,1
+.Lstr_foo:
+  .asciz "foo"
@@ -0,0 +1,51 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## Input .eh_frame sections are parsed and written in parallel, and the
+## .eh_frame_hdr table is sorted in parallel, but the output must be the
+## same as in a serial link.
+# RUN: ld.lld --threads=1 --eh-frame-hdr --gc-sections --icf=all \
+# RUN:   %t.o -o %t1
+# RUN: ld.lld --threads=4 --eh-frame-hdr --gc-sections --icf=all \
+# RUN:   %t.o -o %t4
+# RUN: cmp %t1 %t4
+
+## f1 and f2 are folded by ICF and dead is collected, so .eh_frame_hdr
+## keeps one FDE per remaining function.
+# RUN: llvm-readobj -s %t4 | FileCheck %s
+# CHECK:      Name: .eh_frame_hdr
+# CHECK-NEXT: Type: SHT_PROGBITS
+# CHECK-NEXT: Flags [
+# CHECK-NEXT:   SHF_ALLOC
+# CHECK-NEXT: ]
+# CHECK-NEXT: Address:
+# CHECK-NEXT: Offset:
+# CHECK-NEXT: Size: 28
+
+.globl _start, f1, f2
+
+.section .text._start, "ax"
+_start:
+  .cfi_startproc
+  call f1
+  call f2
+  .cfi_endproc
+
+.section .text.f1, "ax"
+f1:
+  .cfi_startproc
+  ret
+  .cfi_endproc
+
+.section .text.f2, "ax"
+f2:
+  .cfi_startproc
+  ret
+  .cfi_endproc
+
+.section .text.dead, "ax"
+dead:
+  .cfi_startproc
+  nop
+  .cfi_endproc
@@ -0,0 +1,62 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## Live sections are marked in parallel with --threads, but the live set
+## and the list of removed sections must be the same as in a serial link.
+# RUN: ld.lld --threads=1 --gc-sections --print-gc-sections %t.o -o %t1 \
+# RUN:   > %t1.log 2>&1
+# RUN: ld.lld --threads=4 --gc-sections --print-gc-sections %t.o -o %t4 \
+# RUN:   > %t4.log 2>&1
+# RUN: cmp %t1 %t4
+# RUN: cmp %t1.log %t4.log
+# RUN: FileCheck %s < %t4.log
+
+# CHECK:      removing unused section {{.*}}:(.text.dead1)
+# CHECK-NEXT: removing unused section {{.*}}:(.text.dead2)
+# CHECK-NEXT: removing unused section {{.*}}:(.rodata.str)
+# CHECK-NOT:  removing
+
+.globl _start
+_start:
+  call a
+  call b
+
+.section .text.a,"ax",@progbits
+a:
+  call c
+  leaq .Lstr(%rip), %rax
+
+.section .text.b,"ax",@progbits
+b:
+  call c
+  call a
+
+.section .text.c,"ax",@progbits
+c:
+  call d
+  movq __start_keep_me(%rip), %rax
+
+.section .text.d,"ax",@progbits
+d:
+  ret
+
+.section .text.dead1,"ax",@progbits
+  call dead2
+
+.section .text.dead2,"ax",@progbits
+dead2:
+  call a
+  leaq .Ldead(%rip), %rax
+
+.section keep_me,"a",@progbits
+  .quad 0
+
+.section .rodata.str1.1,"aMS",@progbits,1
+.Lstr:
+  .asciz "live"
+.Ldead:
+  .asciz "dead"
+
+.section .rodata.str,"a",@progbits
+  .quad dead2
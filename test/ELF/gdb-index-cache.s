@@ -0,0 +1,26 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/gdb-index.s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %p/Inputs/gdb-index.s -o %t2.o
+# RUN: ld.lld --gdb-index %t1.o %t2.o -o %t
+
+## The first link fills the cache and the second one reads from it. Both
+## produce the same output as a link without the cache.
+# RUN: rm -rf %t.cache
+# RUN: ld.lld --gdb-index --gdb-index-cache-dir=%t.cache --print-stats \
+# RUN:   %t1.o %t2.o -o %t.miss | FileCheck --check-prefix=MISS %s
+# RUN: ls %t.cache | count 2
+# RUN: ld.lld --gdb-index --gdb-index-cache-dir=%t.cache --print-stats \
+# RUN:   %t1.o %t2.o -o %t.hit | FileCheck --check-prefix=HIT %s
+# RUN: cmp %t %t.miss
+# RUN: cmp %t %t.hit
+
+# MISS: gdb index cache:        0 hits, 2 misses
+# HIT:  gdb index cache:        2 hits, 0 misses
+
+## A changed object gets a new entry.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %S/gdb-index-dup-types.s \
+# RUN:   -o %t3.o
+# RUN: ld.lld --gdb-index --gdb-index-cache-dir=%t.cache --print-stats \
+# RUN:   %t1.o %t2.o %t3.o -o %t.new | FileCheck --check-prefix=NEW %s
+# RUN: ls %t.cache | count 3
+# NEW: gdb index cache:        2 hits, 1 misses
@@ -0,0 +1,34 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+
+# RUN: ld.lld -shared --hash-style=gnu %t.o -o %t.so
+# RUN: llvm-readobj -gnu-hash-table %t.so | FileCheck --check-prefix=DEFAULT %s
+# DEFAULT:      Num Buckets: 2
+# DEFAULT-NEXT: First Hashed Symbol Index: 1
+# DEFAULT-NEXT: Num Mask Words: 2
+
+# RUN: ld.lld -shared --hash-style=gnu --hash-bloom-bits=64 %t.o -o %t2.so
+# RUN: llvm-readobj -gnu-hash-table %t2.so | FileCheck --check-prefix=BITS %s
+# BITS:      Num Buckets: 2
+# BITS-NEXT: First Hashed Symbol Index: 1
+# BITS-NEXT: Num Mask Words: 16
+
+# RUN: ld.lld -shared --hash-style=gnu --print-hash-stats %t.o -o %t3.so \
+# RUN:   | FileCheck --check-prefix=STATS %s
+# STATS:      .gnu.hash: 8 symbols, 2 buckets, 2 bloom filter words
+# STATS-NEXT:   bloom filter: 12 bits per symbol, estimated false positive rate {{[0-9.]+}}%
+# STATS-NEXT:   chains: {{[0-9]+}} empty buckets, longest {{[0-9]+}}, average probes {{[0-9.]+}} per hit and 4.00 per miss
+
+# RUN: not ld.lld -shared --hash-bloom-bits=0 %t.o -o %t4.so 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: --hash-bloom-bits: number of bits must be > 0
+
+.globl a, b, c, d, e, f, g, h
+a:
+b:
+c:
+d:
+e:
+f:
+g:
+h:
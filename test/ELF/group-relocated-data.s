@@ -0,0 +1,56 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+# RUN: ld.lld -pie %t.o -o %t
+# RUN: llvm-nm --numeric-sort %t | FileCheck --check-prefix=DEFAULT %s
+# DEFAULT:      d clean1
+# DEFAULT-NEXT: d reloc1
+# DEFAULT-NEXT: d clean2
+# DEFAULT-NEXT: d reloc2
+
+## The sections that need a dynamic relocation go first in each output
+## section, and the others keep their relative order.
+# RUN: ld.lld -pie -z group-relocated-data %t.o -o %t2
+# RUN: llvm-nm --numeric-sort %t2 | FileCheck --check-prefix=GROUP %s
+# GROUP:      d ro_reloc
+# GROUP-NEXT: d ro_clean
+# GROUP:      d reloc1
+# GROUP-NEXT: d reloc2
+# GROUP-NEXT: d clean1
+# GROUP-NEXT: d clean2
+
+## The two relocated words in .data share a page now.
+# RUN: ld.lld -pie --print-stats %t.o -o %t | \
+# RUN:   FileCheck --check-prefix=STATS-DEFAULT %s
+# RUN: ld.lld -pie -z group-relocated-data --print-stats %t.o -o %t2 | \
+# RUN:   FileCheck --check-prefix=STATS-GROUP %s
+# STATS-DEFAULT: pages dirtied at load:  3 of {{[0-9]+}} writable
+# STATS-GROUP:   pages dirtied at load:  2 of {{[0-9]+}} writable
+
+.globl _start
+_start:
+  ret
+
+.section .data.rel.ro.clean,"aw",@progbits
+ro_clean:
+  .quad 0
+
+.section .data.rel.ro.reloc,"aw",@progbits
+ro_reloc:
+  .quad _start
+
+.section .data.clean1,"aw",@progbits
+clean1:
+  .fill 4096, 1, 0
+
+.section .data.reloc1,"aw",@progbits
+reloc1:
+  .quad _start
+
+.section .data.clean2,"aw",@progbits
+clean2:
+  .fill 4096, 1, 0
+
+.section .data.reloc2,"aw",@progbits
+reloc2:
+  .quad _start
@@ -0,0 +1,42 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld -z hugepage-text %t.o -o %t
+# RUN: llvm-readelf -l %t | FileCheck %s
+# RUN: llvm-nm --numeric-sort %t | FileCheck --check-prefix=ORDER %s
+
+## The text segment starts on a 2 MiB boundary in memory and in the file, and
+## the next segment starts on the following 2 MiB boundary in memory only.
+# CHECK:      LOAD 0x000000 0x0000000000200000 {{.*}} R   0x1000
+# CHECK-NEXT: LOAD 0x200000 0x0000000000400000 {{.*}} R E 0x200000
+# CHECK-NEXT: LOAD 0x201000 0x0000000000600000 {{.*}} RW  0x1000
+
+# ORDER:      T f_hot
+# ORDER-NEXT: T _start
+# ORDER-NEXT: t cold
+
+## The text is still in a segment of its own with -no-rosegment.
+# RUN: ld.lld -z hugepage-text -no-rosegment %t.o -o %t.norosegment
+# RUN: llvm-readelf -l %t.norosegment | FileCheck --check-prefix=NORO %s
+
+# NORO:      LOAD 0x000000 0x0000000000200000 {{.*}} R E 0x1000
+# NORO-NEXT: LOAD 0x200000 0x0000000000400000 {{.*}} R E 0x200000
+# NORO-NEXT: LOAD 0x201000 0x0000000000600000 {{.*}} RW  0x1000
+
+.globl _start
+_start:
+  ret
+
+.section .text.cold,"ax"
+cold:
+  nop
+
+.section .text.hot.f_hot,"ax"
+.globl f_hot
+f_hot:
+  nop
+
+.section .rodata,"a"
+.byte 1
+
+.data
+.byte 2
@@ -0,0 +1,59 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --icf=all --print-icf-sections --print-stats %t.o -o %t | \
+# RUN:   FileCheck %s
+
+## f1 and f2 have the same contents but call different functions. The classes
+## of relocation targets are part of the initial hash, so they are told apart
+## before ICF starts comparing sections and no class has to be split. f3 and
+## f4 call identical functions and are still folded.
+
+# CHECK:     selected section {{.*}}:(.text.f3)
+# CHECK-NEXT:  removing identical section {{.*}}:(.text.f4)
+# CHECK-NOT: removing identical section {{.*}}:(.text.f2)
+# CHECK:     ICF classes split: 0 in iteration 0, 0 in iteration 1
+
+.globl _start
+_start:
+  ret
+
+.section .text.f1,"ax",@progbits
+f1:
+  call a
+  ret
+
+.section .text.f2,"ax",@progbits
+f2:
+  call b
+  ret
+
+.section .text.f3,"ax",@progbits
+f3:
+  call c
+  ret
+
+.section .text.f4,"ax",@progbits
+f4:
+  call d
+  ret
+
+.section .text.a,"ax",@progbits
+a:
+  movl $1, %eax
+  ret
+
+.section .text.b,"ax",@progbits
+b:
+  movl $2, %eax
+  ret
+
+.section .text.c,"ax",@progbits
+c:
+  movl $3, %eax
+  ret
+
+.section .text.d,"ax",@progbits
+d:
+  movl $3, %eax
+  ret
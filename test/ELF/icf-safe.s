@@ -0,0 +1,83 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux -defsym NOADDRSIG=1 \
+# RUN:   %s -o %t2.o
+
+# RUN: ld.lld %t1.o -o %t --icf=safe --print-icf-sections > %t.safe
+# RUN: FileCheck --check-prefix=SAFE %s < %t.safe
+# RUN: FileCheck --check-prefix=NOFOLD %s < %t.safe
+
+## f1 and f2 are folded because their addresses are not significant. f3 is
+## address-significant, so f4 has nothing to be folded into. The same rule
+## applies to read-only data.
+# SAFE-DAG: selected section {{.*}}:(.text.f1)
+# SAFE-DAG:   removing identical section {{.*}}:(.text.f2)
+# SAFE-DAG: selected section {{.*}}:(.rodata.r1)
+# SAFE-DAG:   removing identical section {{.*}}:(.rodata.r2)
+
+# NOFOLD-NOT: (.text.f3)
+# NOFOLD-NOT: (.text.f4)
+# NOFOLD-NOT: (.rodata.r3)
+# NOFOLD-NOT: (.rodata.r4)
+
+## --icf=all ignores address significance and does not fold data.
+# RUN: ld.lld %t1.o -o %t --icf=all --print-icf-sections | \
+# RUN:   FileCheck --check-prefix=ALL %s
+
+# ALL-DAG: selected section {{.*}}:(.text.f1)
+# ALL-DAG:   removing identical section {{.*}}:(.text.f2)
+# ALL-DAG: selected section {{.*}}:(.text.f3)
+# ALL-DAG:   removing identical section {{.*}}:(.text.f4)
+# ALL-NOT: .rodata
+
+## Without an address-significance table every symbol is assumed to be
+## address-significant, and so are the symbols exported by a shared object.
+# RUN: ld.lld %t2.o -o %t --icf=safe --print-icf-sections | \
+# RUN:   FileCheck --allow-empty --check-prefix=NONE %s
+# RUN: ld.lld %t1.o -o %t --icf=safe -shared --print-icf-sections | \
+# RUN:   FileCheck --allow-empty --check-prefix=NONE %s
+
+# NONE-NOT: selected section
+
+.globl _start, f1, f2, f3, f4, r1, r2, r3, r4
+_start:
+  ret
+
+.section .text.f1,"ax",@progbits
+f1:
+  ud2
+
+.section .text.f2,"ax",@progbits
+f2:
+  ud2
+
+.section .text.f3,"ax",@progbits
+f3:
+  int3
+
+.section .text.f4,"ax",@progbits
+f4:
+  int3
+
+.section .rodata.r1,"a",@progbits
+r1:
+  .byte 1
+
+.section .rodata.r2,"a",@progbits
+r2:
+  .byte 1
+
+.section .rodata.r3,"a",@progbits
+r3:
+  .byte 2
+
+.section .rodata.r4,"a",@progbits
+r4:
+  .byte 2
+
+.ifndef NOADDRSIG
+.addrsig
+.addrsig_sym f3
+.addrsig_sym r3
+.endif
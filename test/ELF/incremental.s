@@ -0,0 +1,65 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym=GROW=1 \
+# RUN:   %s -o %t2.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym=BIG=1 \
+# RUN:   %s -o %t3.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym=NEWSYM=1 \
+# RUN:   %s -o %t4.o
+# RUN: echo '.globl bar; bar: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-unknown-linux - -o %tb.o
+
+## The first link reserves room after each section and records it.
+# RUN: rm -f %t %t.incr
+# RUN: cp %t1.o %t.o
+# RUN: ld.lld --incremental %t.o %tb.o -o %t --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=NOSTATE %s
+# RUN: FileCheck --check-prefix=STATE %s < %t.incr
+# RUN: llvm-nm %t | grep bar > %t.bar1
+# NOSTATE: --incremental: laying out from scratch because there is no previous state
+# STATE:      lld-incremental 1
+# STATE-NEXT: symbols {{[0-9A-F]+}}
+# STATE-NEXT: file {{.*}}.o
+# STATE-NEXT: {{[0-9]+}} 17
+# STATE:      file {{.*}}b.o
+# STATE-NEXT: {{[0-9]+}} 17
+
+## The same sections, one of them grown within its room, keep their
+## addresses.
+# RUN: cp %t2.o %t.o
+# RUN: ld.lld --incremental %t.o %tb.o -o %t --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=REUSE %s
+# RUN: llvm-nm %t | grep bar > %t.bar2
+# RUN: diff %t.bar1 %t.bar2
+# REUSE: --incremental: reusing the layout of the previous link
+# REUSE: updated {{[0-9]+}} of {{[0-9]+}} pages of {{.*}} in place
+
+## A section that outgrows its room, or a new global symbol, moves sections.
+# RUN: cp %t3.o %t.o
+# RUN: ld.lld --incremental %t.o %tb.o -o %t --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=GREW %s
+# GREW: --incremental: laying out from scratch because {{.*}}.o:(.text) grew past its reserved space
+
+# RUN: cp %t4.o %t.o
+# RUN: ld.lld --incremental %t.o %tb.o -o %t --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=SYMS %s
+# SYMS: --incremental: laying out from scratch because the set of symbols changed
+
+# RUN: not ld.lld --incremental -r %t1.o -o %t.ro 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: -r and --incremental may not be used together
+
+.globl _start
+_start:
+.ifdef GROW
+  nop
+  nop
+.endif
+.ifdef BIG
+  .fill 64, 1, 0x90
+.endif
+.ifdef NEWSYM
+.globl baz
+baz:
+.endif
+  ret
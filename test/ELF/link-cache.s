@@ -0,0 +1,40 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: echo "SECTIONS { .text : { *(.text) } }" > %t.script
+# RUN: rm -rf %t.cache %t %t.map
+
+## The first link stores the output and the map file in the cache.
+# RUN: ld.lld --link-cache=%t.cache --verbose %t.o -T %t.script -o %t \
+# RUN:   -Map=%t.map 2>&1 | FileCheck --check-prefix=MISS %s
+# RUN: ls %t.cache | FileCheck --check-prefix=CACHE %s
+# MISS-NOT: link cache: reused
+
+# CACHE: llvmcache-{{[0-9A-F]+}}-0
+# CACHE: llvmcache-{{[0-9A-F]+}}-1
+
+## An identical link copies both from the cache.
+# RUN: rm -f %t %t.map
+# RUN: ld.lld --link-cache=%t.cache --verbose %t.o -T %t.script -o %t \
+# RUN:   -Map=%t.map 2>&1 | FileCheck --check-prefix=HIT %s
+# RUN: llvm-readobj -file-headers %t | FileCheck --check-prefix=ELF %s
+# RUN: FileCheck --check-prefix=MAP %s < %t.map
+# HIT: link cache: reused
+# ELF: Type: Executable
+# MAP: .text
+
+## Changing an input, even one that is only named by an option, or an
+## option causes a full link.
+# RUN: echo "SECTIONS { .text : { *(.text*) } }" > %t.script
+# RUN: ld.lld --link-cache=%t.cache --verbose %t.o -T %t.script -o %t \
+# RUN:   -Map=%t.map 2>&1 | FileCheck --check-prefix=MISS %s
+# RUN: ld.lld --link-cache=%t.cache --verbose %t.o -T %t.script -o %t \
+# RUN:   -Map=%t.map --no-rosegment 2>&1 | FileCheck --check-prefix=MISS %s
+
+# RUN: not ld.lld --link-cache=%t.cache --link-cache-policy=foo %t.o -o %t \
+# RUN:   2>&1 | FileCheck --check-prefix=ERR %s
+# ERR: --link-cache-policy: invalid cache policy
+
+.globl _start
+_start:
+  nop
@@ -0,0 +1,44 @@
+# REQUIRES: aarch64
+# RUN: llvm-mc -filetype=obj -triple=aarch64-linux-gnu %s -o %t.o
+# RUN: echo "SECTIONS { \
+# RUN:       .text_low 0x2000 : { *(.text_low) } \
+# RUN:       foo = 0x1234; \
+# RUN:       bar = SIZEOF(.text_high); \
+# RUN:       .text_high 0x8004000 : { *(.text_high) } \
+# RUN:       baz = . + foo; \
+# RUN:       } " > %t.script
+# RUN: ld.lld --script %t.script --print-stats %t.o -o %t | \
+# RUN:   FileCheck -check-prefix=STATS %s
+# RUN: llvm-nm %t | FileCheck %s
+# RUN: llvm-objdump -d -triple=aarch64-linux-gnu %t | \
+# RUN:   FileCheck -check-prefix=DISASM %s
+
+## The thunk is added to .text_high, so .text_low and the assignment to foo
+## are not evaluated again after thunks are created. The assignment to bar
+## reads the size of .text_high and is evaluated again.
+
+# STATS: linker script commands: {{[0-9]+}} evaluated, {{[1-9][0-9]*}} skipped
+
+# CHECK: 0000000000000018 A bar
+# CHECK: 000000000800524c {{[AT]}} baz
+# CHECK: 0000000000001234 A foo
+
+# DISASM:      high_target:
+# DISASM-NEXT:  8004000: 02 00 00 94 bl #8
+# DISASM-NEXT:  8004004: c0 03 5f d6 ret
+# DISASM:      __AArch64AbsLongThunk__start:
+# DISASM-NEXT:  8004008: 50 00 00 58 ldr x16, #8
+# DISASM-NEXT:  800400c: 00 02 1f d6 br x16
+
+ .section .text_low, "ax", %progbits
+ .globl _start
+ .type _start, %function
+_start:
+ ret
+
+ .section .text_high, "ax", %progbits
+ .globl high_target
+ .type high_target, %function
+high_target:
+ bl _start
+ ret
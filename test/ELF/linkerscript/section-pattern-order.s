@@ -0,0 +1,28 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## Sections matched by literal names, prefixes and general wildcards keep
+## their input order, and a section matched by more than one pattern of
+## a description is added only once.
+# RUN: echo "SECTIONS { .foo : { *(.foo .foo* .foo.b) } \
+# RUN:   .bar : { *(.b?r.*) } }" > %t.script
+# RUN: ld.lld -o %t --script %t.script %t.o
+# RUN: llvm-objdump -s %t | FileCheck %s
+
+# CHECK:      Contents of section .foo:
+# CHECK-NEXT:  01020304
+# CHECK:      Contents of section .bar:
+# CHECK-NEXT:  0506
+
+.section .foo.b,"a"
+.byte 1
+.section .foo,"a"
+.byte 2
+.section .foo.a,"a"
+.byte 3
+.section .foo.b,"a",@progbits,unique,1
+.byte 4
+.section .bar.b,"a"
+.byte 5
+.section .bar.a,"a"
+.byte 6
@@ -0,0 +1,37 @@
+; REQUIRES: x86
+
+; RUN: opt -module-summary %s -o %t1.o
+; RUN: opt -module-summary %p/Inputs/thinlto.ll -o %t2.o
+
+; A job that fails is an error unless there is a fallback.
+; RUN: rm -f %t1.o.thinlto.bc %t2.o.thinlto.bc %t1.o.imports %t2.o.imports
+; RUN: not ld.lld --thinlto-distributor=false -shared %t1.o %t2.o -o %t3 \
+; RUN:   2>&1 | FileCheck %s --check-prefix=ERR
+; RUN: ls %t1.o.thinlto.bc %t2.o.thinlto.bc %t1.o.imports %t2.o.imports
+
+; ERR-DAG: error: ThinLTO backend job for {{.*}}1.o failed: {{.*}}
+; ERR-DAG: error: ThinLTO backend job for {{.*}}2.o failed: {{.*}}
+
+; RUN: ld.lld --thinlto-distributor=false \
+; RUN:   --thinlto-distributor-fallback="llc -filetype=obj {input} -o {output}" \
+; RUN:   -shared %t1.o %t2.o -o %t3
+; RUN: ls %t1.o.thinlto.o %t2.o.thinlto.o
+; RUN: llvm-nm %t3 | FileCheck %s --check-prefix=NM
+
+; NM: T f
+; NM: T g
+
+; RUN: not ld.lld --thinlto-distributor=false --plugin-opt=thinlto-index-only \
+; RUN:   -shared %t1.o %t2.o -o %t3 2>&1 | FileCheck %s --check-prefix=INDEX
+; INDEX: error: --thinlto-distributor and --plugin-opt=thinlto-index-only may not be used together
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @g(...)
+
+define void @f() {
+entry:
+  call void (...) @g()
+  ret void
+}
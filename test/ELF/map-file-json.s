@@ -0,0 +1,42 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: ld.lld %t.o -o %t --gc-sections --icf=all -Map=%t.map \
+# RUN:   --map-format=json
+# RUN: FileCheck %s < %t.map
+
+# CHECK:      {"output_sections": [
+# CHECK:        {"name": ".text", "address": [[TEXT:[0-9]+]], "load_address": [[TEXT]], "offset": {{[0-9]+}}, "size": 13, "align": 4, "input_sections": [
+# CHECK-NEXT:     {"file": "{{.*}}.o", "name": ".text", "address": [[TEXT]], "offset": 0, "size": 11, "align": 4, "symbols": [
+# CHECK-NEXT:       {"name": "_start", "address": [[TEXT]], "size": 0}]},
+# CHECK-NEXT:     {"file": "{{.*}}.o", "name": ".text.f", "address": {{[0-9]+}}, "offset": 11, "size": 2, "align": 1, "symbols": [
+# CHECK-NEXT:       {"name": "f(int)", "address": {{[0-9]+}}, "size": 0}]}]}
+# CHECK:      "icf_folds": [
+# CHECK-NEXT:   {"file": "{{.*}}.o", "name": ".text.g", "size": 2, "folded_into": {"file": "{{.*}}.o", "name": ".text.f"}}],
+# CHECK-NEXT: "gc_sections": [
+# CHECK-NEXT:   {"file": "{{.*}}.o", "name": ".text.unused", "size": 1}]}
+
+# RUN: not ld.lld %t.o -o %t -Map=%t.map --map-format=yaml 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: unknown --map-format: yaml
+
+.globl _start
+_start:
+  call _Z1fi
+  call g
+  ret
+
+.section .text.f,"ax",@progbits
+.globl _Z1fi
+_Z1fi:
+  nop
+  ret
+
+.section .text.g,"ax",@progbits
+.globl g
+g:
+  nop
+  ret
+
+.section .text.unused,"ax",@progbits
+unused:
+  ret
@@ -8,6 +8,10 @@
 # RUN: ld.lld -shared -mips-got-size 52 %t0.o %t1.o %t2.o -o %t.so
 # RUN: llvm-objdump -s -section=.got -t %t.so | FileCheck %s
 # RUN: llvm-readobj -r -dt -mips-plt-got %t.so | FileCheck -check-prefix=GOT %s
+# RUN: ld.lld -shared -mips-got-size 52 --print-stats %t0.o %t1.o %t2.o \
+# RUN:   -o %t.so | FileCheck -check-prefix=STATS %s
+
+# STATS: MIPS GOTs: {{[0-9]+}} GOTs, 28 entries
 
 # REQUIRES: mips
 
@@ -0,0 +1,29 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## With --no-mmap-output, large page-aligned sections without relocations
+## are copied from the input file to the output file by the kernel. The
+## result is the same as writing them through a mapping, also for the
+## bytes around them that are written from memory.
+# RUN: ld.lld %t.o -o %t1
+# RUN: ld.lld %t.o -o %t2 --no-mmap-output
+# RUN: cmp %t1 %t2
+
+# RUN: ld.lld %t.o -o %t3 -r
+# RUN: ld.lld %t.o -o %t4 -r --no-mmap-output
+# RUN: cmp %t3 %t4
+
+.globl _start
+_start:
+  ret
+
+.section .rodata.head,"a",@progbits
+.quad _start
+
+.section .rodata.blob,"a",@progbits
+.p2align 12
+.fill 16384, 4, 0x12345678
+
+.section .blob,"",@progbits
+.p2align 12
+.fill 32768, 2, 0xabcd
@@ -0,0 +1,41 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## Writing the output section by section produces the same file as writing
+## it through a mapping, including the build ID, which is computed last.
+# RUN: ld.lld %t.o -o %t1 --build-id --eh-frame-hdr
+# RUN: ld.lld %t.o -o %t2 --build-id --eh-frame-hdr --no-mmap-output
+# RUN: cmp %t1 %t2
+
+# RUN: ld.lld %t.o -o %t3 -shared --build-id=sha1 --gc-sections
+# RUN: ld.lld %t.o -o %t4 -shared --build-id=sha1 --gc-sections \
+# RUN:   --no-mmap-output-file
+# RUN: cmp %t3 %t4
+
+# RUN: ld.lld %t.o -o %t5 -r
+# RUN: ld.lld %t.o -o %t6 -r --no-mmap-output
+# RUN: cmp %t5 %t6
+
+# RUN: ld.lld %t.o -o %t7 --oformat binary
+# RUN: ld.lld %t.o -o %t8 --oformat binary --no-mmap-output
+# RUN: cmp %t7 %t8
+
+.globl _start
+_start:
+  .cfi_startproc
+  call foo
+  ret
+  .cfi_endproc
+
+.section .text.foo,"ax",@progbits
+foo:
+  .cfi_startproc
+  nop
+  ret
+  .cfi_endproc
+
+.data
+.quad foo
+
+.bss
+.zero 64
@@ -0,0 +1,57 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld -pie --pack-dyn-relocs=relr %t.o -o %t
+# RUN: llvm-readobj -s -dynamic-table %t | FileCheck %s
+# RUN: llvm-objdump -s -j .relr.dyn %t | FileCheck --check-prefix=CONTENT %s
+
+## The three relative relocations in .data are word aligned and adjacent,
+## so they are encoded as one address followed by one bitmap. The one at an
+## odd offset cannot be represented in .relr.dyn and stays in .rela.dyn.
+
+# CHECK:      Name: .rela.dyn
+# CHECK-NEXT: Type: SHT_RELA
+# CHECK:      Size: 24
+
+# CHECK:      Name: .relr.dyn
+# CHECK-NEXT: Type: SHT_RELR
+# CHECK-NEXT: Flags [
+# CHECK-NEXT:   SHF_ALLOC
+# CHECK-NEXT: ]
+# CHECK-NEXT: Address: [[RELR:.*]]
+# CHECK-NEXT: Offset:
+# CHECK-NEXT: Size: 16
+# CHECK-NEXT: Link: 0
+# CHECK-NEXT: Info: 0
+# CHECK-NEXT: AddressAlignment: 8
+# CHECK-NEXT: EntrySize: 8
+
+# CHECK:      DynamicSection [
+# CHECK-DAG:    RELASZ 24
+# CHECK-DAG:    RELACOUNT 1
+# CHECK-DAG:    RELR [[RELR]]
+# CHECK-DAG:    RELRSZ {{0x10|16}}
+# CHECK-DAG:    RELRENT {{0x8|8}}
+
+## The bitmap 0b11 marks the two words after the leading address, and is
+## stored shifted left by one with the least significant bit set.
+# CONTENT:      Contents of section .relr.dyn:
+# CONTENT-NEXT: {{[0-9a-f]+}} {{[0-9a-f]+}} {{[0-9a-f]+}} 07000000 00000000
+
+# RUN: not ld.lld -pie --pack-dyn-relocs=foo %t.o -o %t2 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: unknown -pack-dyn-relocs format: foo
+
+.globl _start
+_start:
+  ret
+
+.data
+.balign 8
+.quad _start
+.quad _start
+.quad _start
+
+.section .data.unaligned,"aw",@progbits
+.byte 0
+.quad _start
@@ -0,0 +1,27 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## Pre-faulting the output mapping does not change the output.
+# RUN: ld.lld %t.o -o %t1
+# RUN: ld.lld %t.o -o %t2 --prefault-output
+# RUN: cmp %t1 %t2
+
+## The output replaces an existing file of a different size.
+# RUN: ld.lld %t.o -o %t2 --prefault-output --defsym=foo=1
+# RUN: llvm-nm %t2 | FileCheck %s
+# CHECK: 0000000000000001 A foo
+
+## Special files are not mapped.
+# RUN: ld.lld %t.o -o /dev/null --prefault-output
+
+# RUN: not ld.lld %t.o -o %t3 --prefault-output --no-mmap-output 2>&1 | \
+# RUN:   FileCheck --check-prefix=ERR %s
+# ERR: --prefault-output and --no-mmap-output may not be used together
+
+.globl _start
+_start:
+  ret
+
+.section .rodata.blob,"a",@progbits
+.p2align 12
+.fill 16384, 4, 0x12345678
@@ -0,0 +1,23 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: echo '.globl foo; foo: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-unknown-linux - -o %t2.o
+# RUN: echo '.globl bar; bar: ret' | \
+# RUN:   llvm-mc -filetype=obj -triple=x86_64-unknown-linux - -o %t3.o
+# RUN: rm -f %t.a
+# RUN: llvm-ar rcs %t.a %t2.o %t3.o
+
+## Prefetching does not change which files are read or what is produced.
+# RUN: ld.lld %t.o %t.a -o %t1
+# RUN: ld.lld --prefetch-inputs %t.o %t.a -o %t2
+# RUN: cmp %t1 %t2
+# RUN: ld.lld --prefetch-inputs --no-threads %t.o %t.a -o %t3
+# RUN: cmp %t1 %t3
+
+# RUN: not ld.lld --prefetch-inputs %t.o %t.nonexistent -o %t4 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: cannot open {{.*}}.nonexistent:
+
+.globl _start
+_start:
+  call foo
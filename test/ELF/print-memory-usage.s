@@ -0,0 +1,21 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --print-memory-usage %t.o -o %t | FileCheck %s
+
+# CHECK:      memory usage after reading input files:
+# CHECK-NEXT:   arena objects bytes
+# CHECK:        lld::elf::ObjFile<{{.*}}> 1 {{[0-9]+}}
+# CHECK:        input files {{[1-9][0-9]*}}
+# CHECK-NEXT:   output buffer 0
+# CHECK-NEXT:   peak RSS {{[0-9]+}}
+# CHECK:      memory usage after symbol resolution:
+# CHECK-NOT:  memory usage after LTO:
+# CHECK:      memory usage after section optimizations:
+# CHECK:      memory usage after writing the output:
+# CHECK:        lld::elf::InputSection {{[0-9]+}} {{[0-9]+}}
+# CHECK:        output buffer {{[1-9][0-9]*}}
+
+.globl _start
+_start:
+  ret
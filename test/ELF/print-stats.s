@@ -0,0 +1,42 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --print-stats --icf=all %t.o -o %t | FileCheck %s
+
+# CHECK:      input files:            1 objects, 0 shared, 0 bitcode, 0 binary
+# CHECK-NEXT: input sections:         {{[0-9]+}} total, {{[0-9]+}} live
+## The three strings below and the one in .comment.
+# CHECK-NEXT: section pieces:         4 before merging, 3 after
+# CHECK-NEXT: relocations scanned:    3
+# CHECK-NEXT: dynamic relocations:    0
+# CHECK-NEXT: thunks created:         0
+# CHECK-NEXT: ICF:                    {{[0-9]+}} iterations, 2 sections folded
+## f1, f2 and unused start out in the same class and are never split.
+# CHECK-NEXT: ICF classes split:      0 in iteration 0, 0 in iteration 1
+# CHECK-NEXT: bytes written:
+# CHECK:        .text                 {{[0-9]+}}
+# CHECK:        .rodata               8
+
+.globl _start
+_start:
+  call f1
+  call f2
+  movq $str, %rax
+
+.section .text.f1,"ax",@progbits
+f1:
+  ret
+
+.section .text.f2,"ax",@progbits
+f2:
+  ret
+
+.section .text.unused,"ax",@progbits
+unused:
+  ret
+
+.section .rodata.str1.1,"aMS",@progbits,1
+str:
+.asciz "foo"
+.asciz "bar"
+.asciz "foo"
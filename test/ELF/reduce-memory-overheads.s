@@ -0,0 +1,32 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t2.o \
+# RUN:   -defsym=SECOND=1
+
+## Releasing input files as soon as their sections have been written must not
+## change the output, including .strtab, whose names point into the released
+## files, and the map file, which is written at the end.
+# RUN: ld.lld %t1.o %t2.o -Map=%t.map -o %t
+# RUN: ld.lld %t1.o %t2.o -Map=%t.reduced.map --reduce-memory-overheads \
+# RUN:   -o %t.reduced
+# RUN: cmp %t %t.reduced
+# RUN: diff %t.map %t.reduced.map
+
+.ifdef SECOND
+.text
+.globl foo
+foo:
+  call _start
+local2:
+  nop
+.else
+.text
+.globl _start
+_start:
+  call foo
+local1:
+  nop
+
+.data
+.quad foo
+.endif
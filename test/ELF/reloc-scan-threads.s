@@ -0,0 +1,40 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux \
+# RUN:   %p/Inputs/shared.s -o %t2.o
+# RUN: ld.lld -shared %t2.o -soname=t2.so -o %t2.so
+
+## Relocations are classified in parallel, but GOT and PLT entries, copy
+## relocations and dynamic relocations must be created in input order.
+# RUN: ld.lld --threads=1 %t.o %t2.so -o %t1
+# RUN: ld.lld --threads=4 %t.o %t2.so -o %t4
+# RUN: cmp %t1 %t4
+# RUN: ld.lld --threads=1 -pie %t.o %t2.so -o %t1
+# RUN: ld.lld --threads=4 -pie %t.o %t2.so -o %t4
+# RUN: cmp %t1 %t4
+
+# RUN: llvm-readobj -r %t1 | FileCheck %s
+# CHECK:      .rela.dyn {
+# CHECK-NEXT:   R_X86_64_RELATIVE
+# CHECK-DAG:    R_X86_64_GLOB_DAT zed
+# CHECK-DAG:    R_X86_64_GLOB_DAT foo
+# CHECK-DAG:    R_X86_64_64 bar2
+# CHECK:      }
+# CHECK:      .rela.plt {
+# CHECK-NEXT:   R_X86_64_JUMP_SLOT bar2
+# CHECK-NEXT:   R_X86_64_JUMP_SLOT bar
+# CHECK-NEXT: }
+
+.globl _start
+_start:
+  call bar2@PLT
+  movq zed@GOTPCREL(%rip), %rax
+
+.section .text.a,"ax",@progbits
+  call bar@PLT
+  movq foo@GOTPCREL(%rip), %rax
+
+.data
+  .quad _start
+  .quad bar2
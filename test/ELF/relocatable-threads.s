@@ -0,0 +1,44 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym=SECOND=1 \
+# RUN:   %s -o %t2.o
+
+## Output sections are written in parallel with -r. The result must not
+## depend on the number of threads.
+# RUN: ld.lld -r %t1.o %t2.o -o %t.threads
+# RUN: ld.lld -r --no-threads %t1.o %t2.o -o %t.nothreads
+# RUN: cmp %t.threads %t.nothreads
+# RUN: llvm-readobj -r %t.threads | FileCheck %s
+
+# CHECK:      Section ({{.*}}) .rela.text.a {
+# CHECK-NEXT:   0x1 R_X86_64_PLT32 b 0xFFFFFFFFFFFFFFFC
+# CHECK-NEXT:   0x6 R_X86_64_PLT32 b 0xFFFFFFFFFFFFFFFC
+# CHECK-NEXT: }
+# CHECK-NEXT: Section ({{.*}}) .rela.text.b {
+# CHECK-NEXT:   0x1 R_X86_64_PLT32 a 0xFFFFFFFFFFFFFFFC
+# CHECK-NEXT:   0x6 R_X86_64_PLT32 a 0xFFFFFFFFFFFFFFFC
+# CHECK-NEXT: }
+# CHECK-NEXT: Section ({{.*}}) .rela.data {
+# CHECK-NEXT:   0x0 R_X86_64_64 .text.a 0x0
+# CHECK-NEXT:   0x8 R_X86_64_64 .text.b 0x0
+# CHECK-NEXT:   0x10 R_X86_64_64 .text.a 0x5
+# CHECK-NEXT:   0x18 R_X86_64_64 .text.b 0x5
+# CHECK-NEXT: }
+
+.section .text.a,"ax",@progbits
+.ifndef SECOND
+.globl a
+a:
+.endif
+  call b@PLT
+
+.section .text.b,"ax",@progbits
+.ifdef SECOND
+.globl b
+b:
+.endif
+  call a@PLT
+
+.data
+  .quad .text.a
+  .quad .text.b
@@ -0,0 +1,27 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: mkdir -p "%t.dir/a b"
+# RUN: cp %t.o "%t.dir/a b/c.o"
+
+## Quoted and escaped paths, and a response file that names another one.
+# RUN: echo "\"%t.dir/a b/c.o\" -o %t.dir/a\\ b/out" > %t.inner
+# RUN: echo "--defsym='x y'=1 @%t.inner" > %t.outer
+# RUN: ld.lld @%t.outer
+# RUN: llvm-nm "%t.dir/a b/out" | FileCheck %s
+
+# CHECK: 0000000000000001 A x y
+
+## A response file that cannot be read is left as an argument.
+# RUN: not ld.lld %t.o @%t.missing -o %t.out 2>&1 | \
+# RUN:   FileCheck --check-prefix=MISSING %s
+# MISSING: cannot open @{{.*}}.missing
+
+## A response file that includes itself is expanded only so many times.
+# RUN: echo "@%t.self" > %t.self
+# RUN: not ld.lld %t.o @%t.self -o %t.out 2>&1 | \
+# RUN:   FileCheck --check-prefix=SELF %s
+# SELF: cannot open @{{.*}}.self
+
+.globl _start
+_start:
+  nop
@@ -9,6 +9,11 @@
 
 # CHECK-NOT: Foo
 # CHECK-NOT: Bar
+# CHECK-NOT: .debug_info
 
 .section .debug_Foo,"",@progbits
 .section .zdebug_Bar,"",@progbits
+
+# Relocation sections for stripped debug sections are discarded as well.
+.section .debug_info,"",@progbits
+.quad .text
@@ -0,0 +1,39 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t1.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t2.o \
+# RUN:   -defsym=SECOND=1
+
+## Local symbols are collected and their names deduplicated in parallel. The
+## output must not depend on the number of threads.
+# RUN: ld.lld --threads %t1.o %t2.o -o %t.threads
+# RUN: ld.lld --no-threads %t1.o %t2.o -o %t.nothreads
+# RUN: cmp %t.threads %t.nothreads
+# RUN: llvm-readelf -symbols %t.threads | FileCheck %s
+
+# CHECK:      LOCAL  DEFAULT {{.*}} local
+# CHECK-NEXT: LOCAL  DEFAULT {{.*}} local
+# CHECK-NEXT: LOCAL  DEFAULT {{.*}} other
+# CHECK-NEXT: LOCAL  HIDDEN  {{.*}} hidden
+# CHECK-NEXT: GLOBAL DEFAULT {{.*}} _start
+
+## The duplicate name "local" is stored once in .strtab.
+# RUN: llvm-strings %t.threads | FileCheck --check-prefix=STR %s
+# STR:     local
+# STR-NOT: local
+
+.text
+local:
+  nop
+
+.ifdef SECOND
+other:
+  nop
+.globl hidden
+.hidden hidden
+hidden:
+  nop
+.else
+.globl _start
+_start:
+  nop
+.endif
@@ -0,0 +1,28 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux \
+# RUN:   %p/Inputs/trace-symbols-foo-strong.s -o %t2.o
+
+## Symbol names are hashed and reserved in the symbol table in parallel,
+## but symbols must still be resolved and ordered as in a serial link.
+# RUN: ld.lld --threads=1 %t.o %t2.o -o %t1
+# RUN: ld.lld --threads=4 %t.o %t2.o -o %t4
+# RUN: cmp %t1 %t4
+# RUN: ld.lld --threads=1 %t2.o %t.o -o %t1
+# RUN: ld.lld --threads=4 %t2.o %t.o -o %t4
+# RUN: cmp %t1 %t4
+
+## Reserved entries must not be mistaken for traced symbols.
+# RUN: ld.lld --threads=4 -y foo %t.o %t2.o -o %t4 2>&1 \
+# RUN:   | FileCheck -check-prefix=TRACE %s
+# TRACE:      symtab-threads.s.tmp.o: reference to foo
+# TRACE-NEXT: symtab-threads.s.tmp2.o: definition of foo
+# TRACE-NOT: bar
+
+.globl _start, baz
+_start:
+  call foo
+  call func2
+baz:
+  nop
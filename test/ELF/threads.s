@@ -0,0 +1,30 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+
+## The output must not depend on the number of threads.
+# RUN: ld.lld --threads=1 %t.o -o %t1
+# RUN: ld.lld --threads=4 %t.o -o %t4
+# RUN: ld.lld --no-threads %t.o -o %t0
+# RUN: cmp %t1 %t4
+# RUN: cmp %t1 %t0
+# RUN: ld.lld --threads=4 -O2 %t.o -o %t1
+# RUN: ld.lld --threads=1 -O2 %t.o -o %t4
+# RUN: cmp %t1 %t4
+# RUN: llvm-objdump -s -j .rodata %t1 | FileCheck -check-prefix=TAIL %s
+# TAIL: 62617200 666f6f00 bar.foo.
+
+# RUN: not ld.lld --threads=0 %t.o -o %t 2>&1 | FileCheck %s
+# RUN: not ld.lld --threads=x %t.o -o %t 2>&1 | FileCheck %s
+# CHECK: --threads: number of threads must be > 0
+
+.globl _start
+_start:
+  nop
+
+.section .rodata.str1.1,"aMS",@progbits,1
+.asciz "foo"
+.asciz "bar"
+.asciz "foo"
+.asciz "oo"
+.asciz "ar"
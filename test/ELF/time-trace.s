@@ -0,0 +1,21 @@
+# REQUIRES: x86
+
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: ld.lld --time-trace=%t.json --threads=4 %t.o -o %t
+# RUN: FileCheck %s < %t.json
+
+# CHECK:     "traceEvents"
+# CHECK-DAG: "name":"Total Link Time"
+# CHECK-DAG: "name":"Read input files"
+# CHECK-DAG: "name":"Resolve symbols"
+# CHECK-DAG: "name":"Finalize sections"
+# CHECK-DAG: "name":"Write sections"
+# CHECK-DAG: "name":"thread_name","args":{"name":"main"}
+
+# RUN: not ld.lld --time-trace=%t.dir/nonexistent/trace.json %t.o -o %t 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: cannot open {{.*}}trace.json
+
+.globl _start
+_start:
+  nop
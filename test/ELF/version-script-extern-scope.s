@@ -0,0 +1,30 @@
+# REQUIRES: x86
+
+## When every extern "C++" pattern starts with a namespace or class name,
+## only symbols mangled in that scope are demangled. Check that they are
+## still matched, including const members and local entities.
+# RUN: llvm-mc -filetype=obj -triple=x86_64-pc-linux %s -o %t.o
+# RUN: echo "FOO { global: extern \"C++\" { foo::*; }; local: *; };" > %t.script
+# RUN: ld.lld --version-script %t.script -shared %t.o -o %t.so
+# RUN: llvm-readobj -V -dyn-symbols %t.so | FileCheck %s
+# RUN: llvm-readobj -V -dyn-symbols %t.so | FileCheck --check-prefix=LOCAL %s
+
+# CHECK-DAG: Name: _ZN3foo1aEv@@FOO
+# CHECK-DAG: Name: _ZNK3foo1bEv@@FOO
+# CHECK-DAG: Name: _ZZN3foo1aEvE1x@@FOO
+
+# LOCAL-NOT: _ZN3bar1cEv
+# LOCAL-NOT: _Z3fooi
+
+.text
+.globl _ZN3foo1aEv, _ZNK3foo1bEv, _ZN3bar1cEv, _Z3fooi
+_ZN3foo1aEv:
+_ZNK3foo1bEv:
+_ZN3bar1cEv:
+_Z3fooi:
+  retq
+
+.data
+.globl _ZZN3foo1aEvE1x
+_ZZN3foo1aEvE1x:
+  .long 0
@@ -0,0 +1,42 @@
+# REQUIRES: x86
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux %s -o %t.o
+# RUN: llvm-mc -filetype=obj -triple=x86_64-unknown-linux --defsym=CHANGE=1 \
+# RUN:   %s -o %t2.o
+# RUN: ld.lld %t.o -o %t.ref
+# RUN: ld.lld %t2.o -o %t2.ref
+
+## Without an existing output, the file is written as usual.
+# RUN: rm -f %t
+# RUN: ld.lld %t.o -o %t --write-in-place --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=SCRATCH %s
+# RUN: cmp %t %t.ref
+# SCRATCH: writing {{.*}} from scratch
+
+## A relink that changes one page rewrites only that page.
+# RUN: ld.lld %t2.o -o %t --write-in-place --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=UPDATE %s
+# RUN: cmp %t %t2.ref
+# UPDATE: updated 1 of {{[0-9]+}} pages of {{.*}} in place
+
+## An identical relink writes nothing.
+# RUN: ld.lld %t2.o -o %t --write-in-place --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=SAME %s
+# RUN: cmp %t %t2.ref
+# SAME: updated 0 of {{[0-9]+}} pages of {{.*}} in place
+
+## A change in size falls back to a full write.
+# RUN: ld.lld %t.o -o %t --write-in-place --build-id --verbose 2>&1 \
+# RUN:   | FileCheck --check-prefix=SCRATCH %s
+
+# RUN: not ld.lld %t.o -o %t --write-in-place --no-mmap-output 2>&1 \
+# RUN:   | FileCheck --check-prefix=ERR %s
+# ERR: --write-in-place and --no-mmap-output may not be used together
+
+.globl _start
+_start:
+.ifdef CHANGE
+  movl $2, %eax
+.else
+  movl $1, %eax
+.endif
+  ret
@@ -90,6 +90,9 @@ if (config.llvm_libxml2_enabled == '1'):
 if config.have_dia_sdk:
     config.available_features.add("diasdk")
 
+if config.have_zstd:
+    config.available_features.add('zstd')
+
 tar_executable = lit.util.which('tar', config.environment['PATH'])
 if tar_executable:
     tar_version = subprocess.Popen(
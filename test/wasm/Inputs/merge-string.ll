@@ -0,0 +1,8 @@
+target triple = "wasm32-unknown-unknown"
+
+@.str = private unnamed_addr constant [6 x i8] c"hello\00", align 1
+
+define hidden i8* @get_hello2() {
+entry:
+  ret i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str, i32 0, i32 0)
+}
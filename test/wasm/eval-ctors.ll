@@ -0,0 +1,61 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --snax-eval-ctors --allow-undefined --verbose -o %t.wasm %t.o \
+; RUN:     2>&1 | FileCheck %s -check-prefix=LOG
+; RUN: obj2yaml %t.wasm | FileCheck %s
+; RUN: not wasm-ld -r --snax-eval-ctors -o %t.o2 %t.o 2>&1 | \
+; RUN:     FileCheck %s -check-prefix=RELOC
+
+target triple = "wasm32-unknown-unknown"
+
+@value = hidden global i32 1, align 4
+
+@llvm.global_ctors = appending global [2 x { i32, void ()*, i8* }] [
+  { i32, void ()*, i8* } { i32 1, void ()* @init, i8* null },
+  { i32, void ()*, i8* } { i32 2, void ()* @callsImport, i8* null }
+]
+
+declare void @imported()
+
+define internal void @init() {
+entry:
+  %v = load i32, i32* @value, align 4
+  %m = mul i32 %v, 42
+  store i32 %m, i32* @value, align 4
+  ret void
+}
+
+define internal void @callsImport() {
+entry:
+  call void @imported()
+  ret void
+}
+
+define hidden i32 @_start() {
+entry:
+  %v = load i32, i32* @value, align 4
+  ret i32 %v
+}
+
+; LOG: --snax-eval-ctors: callsImport calls imported function 0, so it and the constructors after it run at runtime
+; LOG: --snax-eval-ctors: ran 1 of 2 constructors at link time
+
+; The store of init is in the data segment and __wasm_call_ctors only calls
+; callsImport. The body of init is replaced with unreachable.
+; CHECK:        - Type:            CODE
+; CHECK-NEXT:     Functions:
+; CHECK-NEXT:       - Index:           1
+; CHECK-NEXT:         Locals:          []
+; CHECK-NEXT:         Body:            1083808080000B
+; CHECK-NEXT:       - Index:           2
+; CHECK-NEXT:         Locals:          []
+; CHECK-NEXT:         Body:            00
+; CHECK:        - Type:            DATA
+; CHECK-NEXT:     Segments:
+; CHECK-NEXT:       - SectionOffset:   7
+; CHECK-NEXT:         MemoryIndex:     0
+; CHECK-NEXT:         Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1024
+; CHECK-NEXT:         Content:         2A000000
+
+; RELOC: -r and --snax-eval-ctors may not be used together
@@ -0,0 +1,47 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --allow-undefined -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s
+
+; RUN: wasm-ld --no-gc-sections --allow-undefined -o %t.no-gc.wasm %t.o
+; RUN: obj2yaml %t.no-gc.wasm | FileCheck %s -check-prefix=NO-GC
+
+target triple = "wasm32-unknown-unknown"
+
+declare i32 @used_import()
+
+declare i64 @dead_import(i64)
+
+define hidden i64 @dead(i64 %arg) {
+entry:
+  %r = call i64 @dead_import(i64 %arg)
+  ret i64 %r
+}
+
+define hidden void @_start() {
+entry:
+  call i32 @used_import()
+  ret void
+}
+
+; dead_import is not hidden, so it survives GC, but nothing live calls it.
+; Neither it nor its signature should reach the output.
+
+; CHECK:        - Type:            TYPE
+; CHECK-NEXT:     Signatures:
+; CHECK-NEXT:       - Index:           0
+; CHECK-NEXT:         ReturnType:      I32
+; CHECK-NEXT:         ParamTypes:
+; CHECK-NEXT:       - Index:           1
+; CHECK-NEXT:         ReturnType:      NORESULT
+; CHECK-NEXT:         ParamTypes:
+; CHECK-NEXT:   - Type:            IMPORT
+; CHECK-NEXT:     Imports:
+; CHECK-NEXT:       - Module:          env
+; CHECK-NEXT:         Field:           used_import
+; CHECK-NEXT:         Kind:            FUNCTION
+; CHECK-NEXT:         SigIndex:        0
+; CHECK-NEXT:   - Type:
+; CHECK-NOT:    dead_import
+
+; NO-GC:          Field:           used_import
+; NO-GC:          Field:           dead_import
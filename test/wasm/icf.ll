@@ -0,0 +1,70 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --icf=all --print-icf-sections -o %t.wasm %t.o | \
+; RUN:     FileCheck %s -check-prefix=ALL
+; RUN: wasm-ld --icf=safe --print-icf-sections -o %t.wasm %t.o | \
+; RUN:     FileCheck %s -check-prefix=SAFE
+; RUN: wasm-ld --icf=all --icf=none --print-icf-sections -o %t.wasm %t.o | \
+; RUN:     FileCheck %s -check-prefix=NONE --allow-empty
+; RUN: not wasm-ld -r --icf=all -o %t.o2 %t.o 2>&1 | \
+; RUN:     FileCheck %s -check-prefix=RELOC
+
+; Classes are printed in hash order, so only check membership.
+; ALL-DAG: selected function {{.*}}:(foo1)
+; ALL-DAG:   removing identical function {{.*}}:(foo2)
+; ALL-DAG:   removing identical function {{.*}}:(addr_taken)
+; ALL-DAG: selected function {{.*}}:(bar1)
+; ALL-DAG:   removing identical function {{.*}}:(bar2)
+; ALL-NOT: {{.*}}:(different)
+
+; SAFE-DAG: selected function {{.*}}:(foo1)
+; SAFE-DAG:   removing identical function {{.*}}:(foo2)
+; SAFE-NOT: {{.*}}:(addr_taken)
+
+; NONE-NOT: selected function
+
+; RELOC: -r and --icf may not be used together
+
+target triple = "wasm32-unknown-unknown"
+
+define hidden i32 @foo1(i32 %a) {
+  %1 = add i32 %a, 42
+  ret i32 %1
+}
+
+define hidden i32 @foo2(i32 %a) {
+  %1 = add i32 %a, 42
+  ret i32 %1
+}
+
+define hidden i32 @addr_taken(i32 %a) {
+  %1 = add i32 %a, 42
+  ret i32 %1
+}
+
+define hidden i32 @different(i32 %a) {
+  %1 = add i32 %a, 43
+  ret i32 %1
+}
+
+; These only become identical once foo1 and foo2 are folded.
+define hidden i32 @bar1(i32 %a) {
+  %1 = call i32 @foo1(i32 %a)
+  ret i32 %1
+}
+
+define hidden i32 @bar2(i32 %a) {
+  %1 = call i32 @foo2(i32 %a)
+  ret i32 %1
+}
+
+@fptr = hidden global i32 (i32)* @addr_taken, align 4
+
+define hidden void @_start() {
+entry:
+  call i32 @bar1(i32 1)
+  call i32 @bar2(i32 2)
+  call i32 @different(i32 3)
+  %f = load i32 (i32)*, i32 (i32)** @fptr, align 4
+  call i32 %f(i32 4)
+  ret void
+}
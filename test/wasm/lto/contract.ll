@@ -0,0 +1,28 @@
+; RUN: llvm-as %s -o %t.o
+; RUN: wasm-ld --snax-contract-lto %t.o -o %t2 -save-temps
+; RUN: llvm-dis < %t2.0.2.internalize.bc | FileCheck %s
+; RUN: not wasm-ld -r --snax-contract-lto %t.o -o %t3 2>&1 | \
+; RUN:   FileCheck --check-prefix=RELOC %s
+
+target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"
+target triple = "wasm32-unknown-unknown-wasm"
+
+define void @_start() {
+  ret void
+}
+
+define hidden i1 @pre_dispatch(i64 %receiver, i64 %code, i64 %action) {
+  ret i1 true
+}
+
+define void @helper() {
+  ret void
+}
+
+; The hooks the dispatcher calls by name are kept, everything else that no
+; regular object uses is internalized.
+; CHECK: define void @_start()
+; CHECK: define hidden i1 @pre_dispatch(
+; CHECK: define internal void @helper()
+
+; RELOC: -r and --snax-contract-lto may not be used together
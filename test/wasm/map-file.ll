@@ -0,0 +1,33 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld -Map=%t.map -o %t.wasm %t.o
+; RUN: FileCheck %s < %t.map
+; RUN: not wasm-ld -Map=/ -o %t.wasm %t.o 2>&1 | FileCheck %s -check-prefix=FAIL
+
+target triple = "wasm32-unknown-unknown"
+
+@wasm = hidden global i32 123, align 4
+
+define hidden i32 @foo() {
+  %1 = load i32, i32* @wasm, align 4
+  ret i32 %1
+}
+
+define hidden void @_start() {
+entry:
+  call i32 @foo()
+  ret void
+}
+
+; CHECK:          Offset     Size  Index/VA Out     In      Symbol
+; CHECK-NEXT:  {{ +[0-9a-f]+ +[0-9a-f]+ +- }}TYPE
+; CHECK:       {{ +[0-9a-f]+ +[0-9a-f]+ +- }}CODE
+; CHECK:       {{ +[0-9a-f]+ +[0-9a-f]+ +[0-9a-f]+ }}        {{.*}}map-file.ll.tmp.o:(foo)
+; CHECK-NEXT:  {{ +- +0 +[0-9a-f]+ }}                foo
+; CHECK-NEXT:  {{ +[0-9a-f]+ +[0-9a-f]+ +[0-9a-f]+ }}        {{.*}}map-file.ll.tmp.o:(_start)
+; CHECK-NEXT:  {{ +- +0 +[0-9a-f]+ }}                _start
+; CHECK:       {{ +[0-9a-f]+ +[0-9a-f]+ +- }}DATA
+; CHECK-NEXT:  {{ +[0-9a-f]+ +4 +400 }}        .data
+; CHECK-NEXT:  {{ +[0-9a-f]+ +4 +400 }}                {{.*}}map-file.ll.tmp.o:(.data.wasm)
+; CHECK-NEXT:  {{ +- +4 +400 }}                        wasm
+
+; FAIL: cannot open /
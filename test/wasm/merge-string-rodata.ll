@@ -0,0 +1,38 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s
+
+target triple = "wasm32-unknown-unknown"
+
+@value = hidden constant i32 42, section ".rodata", align 4
+@.str = private unnamed_addr constant [6 x i8] c"hello\00", align 1
+
+define hidden i32 @get_value() {
+entry:
+  %v = load i32, i32* @value, align 4
+  ret i32 %v
+}
+
+define hidden i8* @get_hello() {
+entry:
+  ret i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str, i32 0, i32 0)
+}
+
+define hidden void @_start() {
+entry:
+  call i32 @get_value()
+  call i8* @get_hello()
+  ret void
+}
+
+; The merged strings follow the other read-only data in the same segment
+; instead of getting a segment of their own.
+; CHECK:        - Type:            DATA
+; CHECK-NEXT:     Segments:
+; CHECK-NEXT:       - SectionOffset:   7
+; CHECK-NEXT:         MemoryIndex:     0
+; CHECK-NEXT:         Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1024
+; CHECK-NEXT:         Content:         2A00000068656C6C6F00
+; CHECK-NEXT:   - Type:            CUSTOM
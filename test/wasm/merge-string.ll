@@ -0,0 +1,53 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: llc -filetype=obj %S/Inputs/merge-string.ll -o %t2.o
+; RUN: wasm-ld -o %t.wasm %t.o %t2.o
+; RUN: obj2yaml %t.wasm | FileCheck %s -check-prefix=MERGE
+; RUN: wasm-ld -O2 -o %t.tail.wasm %t.o %t2.o
+; RUN: obj2yaml %t.tail.wasm | FileCheck %s -check-prefix=TAIL
+; RUN: wasm-ld --no-merge-data-segments -o %t.nomerge.wasm %t.o %t2.o
+; RUN: obj2yaml %t.nomerge.wasm | FileCheck %s -check-prefix=NOMERGE
+
+target triple = "wasm32-unknown-unknown"
+
+@.str = private unnamed_addr constant [6 x i8] c"hello\00", align 1
+@.str.1 = private unnamed_addr constant [5 x i8] c"ello\00", align 1
+
+define hidden i8* @get_hello() {
+entry:
+  ret i8* getelementptr inbounds ([6 x i8], [6 x i8]* @.str, i32 0, i32 0)
+}
+
+define hidden i8* @get_ello() {
+entry:
+  ret i8* getelementptr inbounds ([5 x i8], [5 x i8]* @.str.1, i32 0, i32 0)
+}
+
+declare i8* @get_hello2()
+
+define hidden void @_start() {
+entry:
+  call i8* @get_hello()
+  call i8* @get_ello()
+  call i8* @get_hello2()
+  ret void
+}
+
+; "hello" from the second file is deduplicated.
+; MERGE:        - Type:            DATA
+; MERGE-NEXT:     Segments:
+; MERGE-NEXT:       - SectionOffset:   7
+; MERGE-NEXT:         MemoryIndex:     0
+; MERGE-NEXT:         Offset:
+; MERGE-NEXT:           Opcode:          I32_CONST
+; MERGE-NEXT:           Value:           1024
+; MERGE-NEXT:         Content:         68656C6C6F00656C6C6F00
+; MERGE-NEXT:   - Type:            CUSTOM
+
+; With tail merging "ello" shares the storage of "hello".
+; TAIL:        - Type:            DATA
+; TAIL:         Content:         68656C6C6F00{{$}}
+
+; NOMERGE:        - Type:            DATA
+; NOMERGE:         Content:         68656C6C6F00{{$}}
+; NOMERGE:         Content:         656C6C6F00{{$}}
+; NOMERGE:         Content:         68656C6C6F00{{$}}
@@ -0,0 +1,41 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --no-gc-sections -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s -check-prefix=ALL
+; RUN: wasm-ld --no-gc-sections --prune-name-section -o %t.pruned.wasm %t.o
+; RUN: obj2yaml %t.pruned.wasm | FileCheck %s -check-prefix=PRUNED
+; RUN: obj2yaml %t.pruned.wasm | FileCheck %s -check-prefix=NOORPHAN
+
+target triple = "wasm32-unknown-unknown"
+
+define hidden void @helper() {
+entry:
+  ret void
+}
+
+define hidden void @orphan() {
+entry:
+  ret void
+}
+
+define void @exported() {
+entry:
+  call void @helper()
+  ret void
+}
+
+define hidden void @_start() {
+entry:
+  ret void
+}
+
+; ALL:      Name: name
+; ALL-DAG:    Name: helper
+; ALL-DAG:    Name: orphan
+; ALL-DAG:    Name: exported
+
+; PRUNED:      Name: name
+; PRUNED-DAG:    Name: helper
+; PRUNED-DAG:    Name: exported
+
+; NOORPHAN:     Name: name
+; NOORPHAN-NOT: Name: orphan
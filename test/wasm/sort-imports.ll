@@ -0,0 +1,37 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --sort-imports --allow-undefined -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s
+
+target triple = "wasm32-unknown-unknown"
+
+declare void @zeta()
+declare void @alpha()
+declare void @mid()
+
+define hidden void @_start() {
+entry:
+  call void @zeta()
+  call void @mid()
+  call void @alpha()
+  ret void
+}
+
+; CHECK:       - Type:            IMPORT
+; CHECK-NEXT:    Imports:
+; CHECK-NEXT:      - Module:          env
+; CHECK-NEXT:        Field:           alpha
+; CHECK-NEXT:        Kind:            FUNCTION
+; CHECK-NEXT:        SigIndex:        0
+; CHECK-NEXT:      - Module:          env
+; CHECK-NEXT:        Field:           mid
+; CHECK-NEXT:        Kind:            FUNCTION
+; CHECK-NEXT:        SigIndex:        0
+; CHECK-NEXT:      - Module:          env
+; CHECK-NEXT:        Field:           zeta
+; CHECK-NEXT:        Kind:            FUNCTION
+; CHECK-NEXT:        SigIndex:        0
+
+; The calls in _start refer to the new indices.
+; CHECK:       - Type:            CODE
+; CHECK-NEXT:    Functions:
+; CHECK:           Body:            1082808080001081808080001080808080000B
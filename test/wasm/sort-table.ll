@@ -0,0 +1,68 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --sort-table-by-signature -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s
+; RUN: wasm-ld -o %t.unsorted.wasm %t.o
+; RUN: obj2yaml %t.unsorted.wasm | FileCheck %s -check-prefix=UNSORTED
+
+target triple = "wasm32-unknown-unknown"
+
+define hidden void @a() {
+entry:
+  ret void
+}
+
+define hidden void @b(i32 %x) {
+entry:
+  ret void
+}
+
+define hidden void @c() {
+entry:
+  ret void
+}
+
+define hidden void @unused() {
+entry:
+  ret void
+}
+
+@table = hidden global [3 x i8*] [
+  i8* bitcast (void ()* @a to i8*),
+  i8* bitcast (void (i32)* @b to i8*),
+  i8* bitcast (void ()* @c to i8*)
+], align 4
+
+; The address of unused is only taken in dead code, so it gets no entry.
+define hidden i8* @dead() {
+entry:
+  ret i8* bitcast (void ()* @unused to i8*)
+}
+
+define hidden void @_start() {
+entry:
+  %f = load i8*, i8** getelementptr ([3 x i8*], [3 x i8*]* @table, i32 0, i32 0), align 4
+  ret void
+}
+
+; a and c share a signature, so c comes before b.
+; CHECK:        - Type:            ELEM
+; CHECK-NEXT:     Segments:
+; CHECK-NEXT:       - Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1
+; CHECK-NEXT:         Functions:       [ [[A:[0-9]+]], [[C:[0-9]+]], [[B:[0-9]+]] ]
+; CHECK:          FunctionNames:
+; CHECK:            - Index:           [[A]]
+; CHECK-NEXT:         Name:            a
+; CHECK-NEXT:       - Index:           [[B]]
+; CHECK-NEXT:         Name:            b
+; CHECK-NEXT:       - Index:           [[C]]
+; CHECK-NEXT:         Name:            c
+
+; UNSORTED:       - Type:            ELEM
+; UNSORTED:             Functions:       [ [[A:[0-9]+]], [[B:[0-9]+]], [[C:[0-9]+]] ]
+; UNSORTED:         FunctionNames:
+; UNSORTED:           - Index:           [[A]]
+; UNSORTED-NEXT:        Name:            a
+; UNSORTED-NEXT:      - Index:           [[B]]
+; UNSORTED-NEXT:        Name:            b
@@ -0,0 +1,39 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: wasm-ld --split-zero-runs=16 -o %t.wasm %t.o
+; RUN: obj2yaml %t.wasm | FileCheck %s
+; RUN: not wasm-ld -r --split-zero-runs=16 -o %t.o2 %t.o 2>&1 | \
+; RUN:     FileCheck %s -check-prefix=RELOC
+
+target triple = "wasm32-unknown-unknown"
+
+@data = hidden global <{ i32, [32 x i8], i32, [8 x i8], i32 }>
+    <{ i32 1, [32 x i8] zeroinitializer, i32 2, [8 x i8] zeroinitializer, i32 3 }>,
+    align 4
+@zeros = hidden global [64 x i8] zeroinitializer, align 4
+
+define hidden void @_start() {
+entry:
+  %a = load i32, i32* bitcast (<{ i32, [32 x i8], i32, [8 x i8], i32 }>* @data to i32*), align 4
+  %b = load i8, i8* getelementptr inbounds ([64 x i8], [64 x i8]* @zeros, i32 0, i32 0), align 4
+  ret void
+}
+
+; The 32 byte zero run is dropped, the 8 byte one is kept and the segment
+; holding only zeros is not written at all.
+; CHECK:        - Type:            DATA
+; CHECK-NEXT:     Segments:
+; CHECK-NEXT:       - SectionOffset:   7
+; CHECK-NEXT:         MemoryIndex:     0
+; CHECK-NEXT:         Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1024
+; CHECK-NEXT:         Content:         '01'
+; CHECK-NEXT:       - SectionOffset:   14
+; CHECK-NEXT:         MemoryIndex:     0
+; CHECK-NEXT:         Offset:
+; CHECK-NEXT:           Opcode:          I32_CONST
+; CHECK-NEXT:           Value:           1060
+; CHECK-NEXT:         Content:         '02000000000000000000000003'
+; CHECK-NEXT:   - Type:            CUSTOM
+
+; RELOC: -r and --split-zero-runs may not be used together
@@ -0,0 +1,48 @@
+; RUN: llc -filetype=obj %s -o %t.o
+; RUN: echo "bar" > %t.order
+; RUN: echo "foo" >> %t.order
+; RUN: echo "missing" >> %t.order
+; RUN: wasm-ld --symbol-ordering-file=%t.order -Map=%t.map -o %t.wasm %t.o \
+; RUN:     2>&1 | FileCheck %s -check-prefix=WARN
+; RUN: FileCheck %s < %t.map
+
+; RUN: echo "_start foo 10" > %t.cg
+; RUN: echo "foo baz 10" >> %t.cg
+; RUN: wasm-ld --call-graph-ordering-file=%t.cg -Map=%t.cg.map -o %t.wasm %t.o
+; RUN: FileCheck %s -check-prefix=CG < %t.cg.map
+
+target triple = "wasm32-unknown-unknown"
+
+define hidden void @foo() {
+  call void @baz()
+  ret void
+}
+
+define hidden void @bar() {
+  ret void
+}
+
+define hidden void @baz() {
+  ret void
+}
+
+define hidden void @_start() {
+entry:
+  call void @foo()
+  call void @bar()
+  ret void
+}
+
+; WARN: warning: symbol ordering file: no such symbol: missing
+
+; CHECK:      CODE
+; CHECK:      :(bar)
+; CHECK:      :(foo)
+; CHECK:      :(baz)
+; CHECK:      :(_start)
+
+; CG:      CODE
+; CG:      :(_start)
+; CG:      :(foo)
+; CG:      :(baz)
+; CG:      :(bar)
@@ -6,6 +6,18 @@
 # License. See LICENSE.TXT for details.
 #
 # ==------------------------------------------------------------------------==#
+#
+# Each benchmark is a directory holding one or more response*.txt files.
+# The linker being measured is expected one level up as ld.lld, lld-link or
+# wasm-ld. --flavor picks which one; a directory can override that with a
+# file named "flavor" that holds elf, coff or wasm.
+#
+# For every benchmark we record the perf stat counters, the peak RSS and,
+# for the drivers that support it, the per-phase timers. With
+# --thread-counts we also sweep the number of CPUs the linker may run on,
+# to get a scaling curve.
+#
+# ==------------------------------------------------------------------------==#
 
 import os
 import glob
@@ -14,8 +26,12 @@ import subprocess
 import json
 import datetime
 import argparse
-import urllib
-import urllib2
+try:
+    from urllib.parse import urlencode
+    from urllib.request import urlopen, Request
+except ImportError:
+    from urllib import urlencode
+    from urllib2 import urlopen, Request
 
 parser = argparse.ArgumentParser()
 parser.add_argument('benchmark_directory')
@@ -24,25 +40,68 @@ parser.add_argument('--wrapper', default='')
 parser.add_argument('--machine', required=True)
 parser.add_argument('--revision', required=True)
 parser.add_argument('--threads', action='store_true')
+parser.add_argument('--thread-counts', default='',
+                    help='Comma separated list of CPU counts to sweep, '
+                    'e.g. 1,2,4,8. Also runs the linker with --no-threads')
+parser.add_argument('--flavor', choices=['elf', 'coff', 'wasm'], default='elf',
+                    help='Default linker flavor of the benchmarks')
 parser.add_argument('--url', help='The lnt server url to send the results to',
                     default='http://localhost:8000/db_default/v4/link/submitRun')
 args = parser.parse_args()
 
+class Flavor:
+    def __init__(self, linker, output, time, no_threads):
+        self.linker = linker
+        self.output = output
+        self.time = time
+        self.no_threads = no_threads
+
+# The COFF driver has no switch to disable threading and the ELF driver
+# has no phase timers.
+FLAVORS = {
+    'elf': Flavor('ld.lld', ['-o', 't'], [], ['--no-threads']),
+    'coff': Flavor('lld-link', ['/out:t'], ['/time'], None),
+    'wasm': Flavor('wasm-ld', ['-o', 't'], ['--time'], ['--no-threads']),
+}
+
 class Bench:
-    def __init__(self, directory, variant):
+    def __init__(self, directory, variant, threads=None):
         self.directory = directory
         self.variant = variant
+        # None runs with the linker's default threading, 0 with --no-threads
+        # and N > 0 restricted to N CPUs.
+        self.threads = threads
     def __str__(self):
-        if not self.variant:
-            return self.directory
-        return '%s-%s' % (self.directory, self.variant)
+        name = self.directory
+        if self.variant:
+            name = '%s-%s' % (name, self.variant)
+        if self.threads == 0:
+            name += '-no-threads'
+        elif self.threads:
+            name += '-j%d' % self.threads
+        return name
+
+def getFlavor(directory):
+    path = os.path.join(directory, 'flavor')
+    if os.path.exists(path):
+        with open(path) as f:
+            return FLAVORS[f.read().strip()]
+    return FLAVORS[args.flavor]
 
 def getBenchmarks():
     ret = []
     for i in glob.glob('*/response*.txt'):
         m = re.match('response-(.*)\.txt', os.path.basename(i))
         variant = m.groups()[0] if m else None
-        ret.append(Bench(os.path.dirname(i), variant))
+        directory = os.path.dirname(i)
+        counts = [int(x) for x in args.thread_counts.split(',') if x]
+        if not counts:
+            ret.append(Bench(directory, variant))
+            continue
+        if getFlavor(directory).no_threads is not None:
+            ret.append(Bench(directory, variant, 0))
+        for n in counts:
+            ret.append(Bench(directory, variant, n))
     return ret
 
 def parsePerfNum(num):
@@ -73,6 +132,17 @@ def parsePerf(output):
         ret.update(parsePerfLine(l))
     return ret
 
+# Parses the output of the driver's phase timers, lines such as
+# "  Write Output:    12 ms ( 3.4%)".
+def parseTimers(output):
+    ret = {}
+    for line in output.split(b'\n'):
+        m = re.match(br'^\s*([^:]+):\s+(\d+) ms', line)
+        if m:
+            name = m.group(1).strip().decode('ascii').lower().replace(' ', '-')
+            ret['phase-%s-ms' % name] = int(m.group(2))
+    return ret
+
 def run(cmd):
     try:
         return subprocess.check_output(cmd, stderr=subprocess.STDOUT)
@@ -80,6 +150,20 @@ def run(cmd):
         print(e.output)
         raise e
 
+# Like run, but also returns the peak RSS of the command in kilobytes. On
+# Linux the rusage reported by wait4 covers the waited-for descendants too,
+# so this sees through perf and any wrapper.
+def runWithRss(cmd):
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    out = p.stdout.read()
+    p.stdout.close()
+    _, status, rusage = os.wait4(p.pid, 0)
+    p.returncode = status
+    if status != 0:
+        print(out)
+        raise subprocess.CalledProcessError(status, cmd, out)
+    return out, rusage.ru_maxrss
+
 def combinePerfRun(acc, d):
     for k,v in d.items():
         a = acc.get(k, [])
@@ -94,18 +178,30 @@ def perf(cmd):
     wrapper_args = [x for x in args.wrapper.split(',') if x]
     for i in range(args.runs):
         os.unlink('t')
-        out = run(wrapper_args + ['perf', 'stat'] + cmd)
+        out, rss = runWithRss(wrapper_args + ['perf', 'stat'] + cmd)
         r = parsePerf(out)
+        r.update(parseTimers(out))
+        r['max-rss-kb'] = rss
         combinePerfRun(ret, r)
     os.unlink('t')
     return ret
 
 def runBench(bench):
-    thread_arg = [] if args.threads else ['--no-threads']
+    flavor = getFlavor(bench.directory)
+    prefix = []
+    thread_arg = []
+    if bench.threads is None:
+        if not args.threads and flavor.no_threads:
+            thread_arg = flavor.no_threads
+    elif bench.threads == 0:
+        thread_arg = flavor.no_threads
+    else:
+        prefix = ['taskset', '-c', '0-%d' % (bench.threads - 1)]
     os.chdir(bench.directory)
     suffix = '-%s' % bench.variant if bench.variant else ''
     response = 'response' + suffix + '.txt'
-    ret = perf(['../ld.lld', '@' + response, '-o', 't'] + thread_arg)
+    ret = perf(prefix + ['../' + flavor.linker, '@' + response] +
+               flavor.output + flavor.time + thread_arg)
     ret['name'] = str(bench)
     os.chdir('..')
     return ret
@@ -127,8 +223,8 @@ def buildLntJson(benchmarks):
     return json.dumps(ret, sort_keys=True, indent=4)
 
 def submitToServer(data):
-    data2 = urllib.urlencode({ 'input_data' : data }).encode('ascii')
-    urllib2.urlopen(urllib2.Request(args.url, data2))
+    data2 = urlencode({ 'input_data' : data }).encode('ascii')
+    urlopen(Request(args.url, data2))
 
 os.chdir(args.benchmark_directory)
 data = buildLntJson(getBenchmarks())
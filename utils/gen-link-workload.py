@@ -0,0 +1,371 @@
+#!/usr/bin/env python
+#
+#                     The LLVM Compiler Infrastructure
+#
+# This file is distributed under the University of Illinois Open Source
+# License. See LICENSE.TXT for details.
+#
+# ==------------------------------------------------------------------------==#
+#
+# Generates synthetic link workloads in the layout that benchmark.py reads,
+# so that scaling measurements can be reproduced without sharing real
+# inputs. For each requested flavor it writes a directory
+#
+#   <output>/<name>-<flavor>/
+#       flavor          elf, coff or wasm, for benchmark.py
+#       response.txt    the inputs and flags of the link
+#       *.o, *.a        the generated inputs
+#
+# The inputs are generated as LLVM IR and compiled with llc, so the same
+# workload is produced for all three flavors. The knobs are
+#
+#   --objects            number of objects
+#   --functions          functions per object, each in its own section
+#   --globals            data objects per object, each in its own section
+#   --calls, --data-refs relocations per function
+#   --comdat-ratio       fraction of each object's functions that are
+#                        linkonce_odr copies of a shared pool, each pool
+#                        function being defined in --comdat-copies objects
+#   --icf-ratio          fraction of functions that are identical to
+#                        another one, for ICF
+#   --strings            mergeable string literals per object, of which
+#                        --string-dup-ratio are shared by all objects
+#   --archives           number of archives the objects other than the
+#                        first are put into (--thin for thin archives)
+#   --snax-actions       wasm only: number of actions, each with an ABI
+#                        fragment and action list entry in the object that
+#                        defines its handler, so that the link generates a
+#                        dispatcher and merges the ABI
+#
+# Run benchmark.py on <output> with the linkers copied or linked into it.
+#
+# ==------------------------------------------------------------------------==#
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+
+parser = argparse.ArgumentParser()
+parser.add_argument('output', help='Directory to write the benchmarks to')
+parser.add_argument('--name', default='synthetic')
+parser.add_argument('--flavor', action='append',
+                    choices=['elf', 'coff', 'wasm'],
+                    help='Flavor to generate, may be repeated (default: all)')
+parser.add_argument('--objects', type=int, default=64)
+parser.add_argument('--functions', type=int, default=200)
+parser.add_argument('--globals', type=int, default=50)
+parser.add_argument('--calls', type=int, default=4)
+parser.add_argument('--data-refs', type=int, default=2)
+parser.add_argument('--comdat-ratio', type=float, default=0.2)
+parser.add_argument('--comdat-copies', type=int, default=8)
+parser.add_argument('--icf-ratio', type=float, default=0.1)
+parser.add_argument('--strings', type=int, default=100)
+parser.add_argument('--string-length', type=int, default=32)
+parser.add_argument('--string-dup-ratio', type=float, default=0.5)
+parser.add_argument('--archives', type=int, default=0)
+parser.add_argument('--thin', action='store_true')
+parser.add_argument('--snax-actions', type=int, default=0)
+parser.add_argument('--extra-args', default='',
+                    help='Space separated flags to add to every response file')
+parser.add_argument('--seed', type=int, default=0)
+parser.add_argument('--llc', default='llc')
+parser.add_argument('--llvm-ar', default='llvm-ar')
+args = parser.parse_args()
+
+TRIPLES = {
+    'elf': 'x86_64-unknown-linux',
+    'coff': 'x86_64-pc-windows-msvc',
+    'wasm': 'wasm32-unknown-unknown',
+}
+
+# The flags needed to link the generated inputs. ICF is on so that
+# --icf-ratio has something to measure.
+FLAGS = {
+    'elf': ['--icf=all'],
+    'coff': ['/entry:_start', '/subsystem:console', '/nodefaultlib',
+             '/opt:ref,icf'],
+    'wasm': ['--icf=all'],
+}
+
+def run(cmd):
+    try:
+        return subprocess.check_output(cmd, stderr=subprocess.STDOUT)
+    except subprocess.CalledProcessError as e:
+        print(e.output.decode('utf-8', 'replace'))
+        raise e
+
+def func(o, i):
+    return 'f%d_%d' % (o, i)
+
+def glob(o, j):
+    return 'g%d_%d' % (o, j)
+
+# Returns the text of a string literal. Shared strings are the same in
+# every object; the others are unique to it.
+def stringText(o, k):
+    shared = k < int(args.strings * args.string_dup_ratio)
+    key = 'shared %d' % k if shared else 'object %d string %d' % (o, k)
+    text = key + ' '
+    while len(text) < args.string_length:
+        text += key
+    return text[:args.string_length]
+
+# Snax names are up to 12 characters out of a-z, 1-5 and '.'.
+def actionName(n):
+    s = ''
+    while True:
+        s = 'abcdefghijklmnopqrstuvwxyz'[n % 26] + s
+        n //= 26
+        if n == 0:
+            break
+    return 'act' + s
+
+def abiFragment(action):
+    return {
+        'version': 'snax::abi/1.1',
+        'types': [],
+        'structs': [{'name': action, 'base': '',
+                     'fields': [{'name': 'value', 'type': 'uint64'}]}],
+        'actions': [{'name': action, 'type': action,
+                     'ricardian_contract': ''}],
+        'tables': [],
+        'ricardian_clauses': [],
+        'error_messages': [],
+        'variants': [],
+    }
+
+def uleb(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7f
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+# A custom section holding a vector of strings, the format of the
+# snax_actions section that wasm-ld -r writes.
+def stringVector(strings):
+    out = uleb(len(strings))
+    for s in strings:
+        s = s.encode('utf-8')
+        out += uleb(len(s)) + s
+    return out
+
+def irString(data):
+    if not isinstance(data, bytes):
+        data = data.encode('utf-8')
+    out = ''
+    for b in bytearray(data):
+        c = chr(b)
+        out += c if 32 <= b < 127 and c not in '"\\' else '\\%02X' % b
+    return '"%s"' % out
+
+class Workload:
+    """The symbols of the whole workload, shared by all flavors."""
+
+    def __init__(self, rng):
+        n = args.objects
+        per_obj = int(args.functions * args.comdat_ratio)
+        pool_size = max(1, per_obj * n // max(1, args.comdat_copies))
+        self.pool = [rng.sample(range(pool_size), min(per_obj, pool_size))
+                     for _ in range(n)]
+
+        # The canonical bodies that identical functions copy: their callees
+        # and data references, which are the same wherever they appear.
+        self.templates = []
+        for _ in range(16):
+            self.templates.append(self.body(rng))
+
+        self.funcs = []
+        for o in range(n):
+            # Each entry is (callees, globals, is_copy). Copies of a
+            # template reference nothing else, so that they stay identical.
+            bodies = []
+            for i in range(args.functions):
+                if rng.random() < args.icf_ratio:
+                    bodies.append(rng.choice(self.templates) + (True,))
+                else:
+                    bodies.append(self.body(rng) + (False,))
+            self.funcs.append(bodies)
+
+        self.actions = {}
+        for a in range(args.snax_actions):
+            self.actions.setdefault(rng.randrange(n), []).append(actionName(a))
+
+    def body(self, rng):
+        calls = [func(rng.randrange(args.objects), rng.randrange(
+            args.functions)) for _ in range(args.calls)]
+        refs = []
+        if args.globals:
+            refs = [glob(rng.randrange(args.objects),
+                         rng.randrange(args.globals))
+                    for _ in range(args.data_refs)]
+        return (calls, refs)
+
+    def module(self, flavor, o):
+        lines = ['target triple = "%s"\n\n' % TRIPLES[flavor]]
+        defined_funcs = set(func(o, i) for i in range(args.functions))
+        defined_globals = set(glob(o, j) for j in range(args.globals))
+
+        for j in range(args.globals):
+            lines.append('@%s = global i32 %d\n' % (glob(o, j), j))
+        lines.append('@sink = internal global i8* null\n')
+        for k in range(args.strings):
+            text = stringText(o, k)
+            lines.append('@.str%d = private unnamed_addr constant '
+                         '[%d x i8] c%s, align 1\n' %
+                         (k, len(text) + 1, irString(text + '\0')))
+
+        has_start = o == 0 and not (flavor == 'wasm' and self.actions)
+        callees = set()
+        refs = set()
+        for calls, grefs, _ in self.funcs[o]:
+            callees.update(calls)
+            refs.update(grefs)
+        for p in self.pool[o]:
+            refs.update(self.poolRefs(p))
+        if has_start:
+            callees.update(func(other, 0) for other in range(args.objects))
+        for c in sorted(callees - defined_funcs):
+            lines.append('declare void @%s()\n' % c)
+        for g in sorted(refs - defined_globals):
+            lines.append('@%s = external global i32\n' % g)
+        lines.append('\n')
+
+        def emitBody(calls, grefs, string):
+            for c in calls:
+                lines.append('  call void @%s()\n' % c)
+            for n, g in enumerate(grefs):
+                lines.append('  %%v%d = load volatile i32, i32* @%s\n' % (n, g))
+            if string is not None:
+                lines.append('  store volatile i8* getelementptr inbounds '
+                             '([%d x i8], [%d x i8]* @.str%d, i32 0, i32 0), '
+                             'i8** @sink\n' %
+                             (args.string_length + 1, args.string_length + 1,
+                              string))
+            lines.append('  ret void\n}\n')
+
+        for p in self.pool[o]:
+            lines.append('$pool%d = comdat any\n' % p)
+            lines.append('define linkonce_odr void @pool%d() comdat {\n'
+                         'entry:\n' % p)
+            emitBody([], self.poolRefs(p), None)
+
+        for i, (calls, grefs, is_copy) in enumerate(self.funcs[o]):
+            lines.append('define void @%s() {\nentry:\n' % func(o, i))
+            string = None
+            if not is_copy:
+                if i < len(self.pool[o]):
+                    lines.append('  call void @pool%d()\n' % self.pool[o][i])
+                if args.strings:
+                    string = i % args.strings
+            emitBody(calls, grefs, string)
+
+        if flavor == 'wasm':
+            self.emitActions(o, lines)
+
+        if has_start:
+            # Reference one function of every object so that all archive
+            # members are fetched.
+            lines.append('define void @_start() {\nentry:\n')
+            for other in range(args.objects):
+                lines.append('  call void @%s()\n' % func(other, 0))
+            lines.append('  ret void\n}\n')
+        return ''.join(lines)
+
+    # The globals that pool function P reads, the same in every copy.
+    def poolRefs(self, p):
+        return [glob(p % args.objects, 0)] if args.globals else []
+
+    def emitActions(self, o, lines):
+        actions = self.actions.get(o, [])
+        if o == 0 and self.actions:
+            lines.append('declare void @snax_assert_code(i32, i64)\n')
+            lines.append('define void @keep_assert() {\nentry:\n'
+                         '  call void @snax_assert_code(i32 1, i64 0)\n'
+                         '  ret void\n}\n')
+        if not actions:
+            return
+        for a in actions:
+            lines.append('define void @dispatch_%s(i64 %%receiver, i64 %%code)'
+                         ' {\nentry:\n  call void @%s()\n  ret void\n}\n' %
+                         (a, func(o, 0)))
+        entries = ['%s:dispatch_%s' % (a, a) for a in actions]
+        # Like the output of the Snax compiler, each object carries one
+        # fragment describing all of its actions.
+        abi = abiFragment(actions[0])
+        for a in actions[1:]:
+            other = abiFragment(a)
+            abi['structs'] += other['structs']
+            abi['actions'] += other['actions']
+        lines.append('!wasm.custom_sections = !{!0, !1}\n')
+        lines.append('!0 = !{!"snax_abi", !%s}\n' %
+                     irString(json.dumps(abi, sort_keys=True)))
+        lines.append('!1 = !{!"snax_actions", !%s}\n' %
+                     irString(stringVector(entries)))
+
+def generate(flavor, workload):
+    directory = os.path.join(args.output, '%s-%s' % (args.name, flavor))
+    if not os.path.isdir(directory):
+        os.makedirs(directory)
+
+    objects = []
+    for o in range(args.objects):
+        ll = os.path.join(directory, 'obj%d.ll' % o)
+        obj = 'obj%d.o' % o
+        with open(ll, 'w') as f:
+            f.write(workload.module(flavor, o))
+        run([args.llc, '-filetype=obj', '-function-sections',
+             '-data-sections', ll, '-o', os.path.join(directory, obj)])
+        os.unlink(ll)
+        objects.append(obj)
+
+    inputs = objects
+    archives = args.archives
+    if flavor == 'wasm' and workload.actions:
+        # Nothing refers to the action handlers, so they would not be
+        # fetched from an archive.
+        archives = 0
+    if archives and len(objects) > 1:
+        inputs = [objects[0]]
+        members = objects[1:]
+        for a in range(archives):
+            name = 'lib%d.a' % a
+            part = members[a::archives]
+            if not part:
+                continue
+            run([args.llvm_ar, 'rcsT' if args.thin else 'rcs',
+                 os.path.join(directory, name)] +
+                [os.path.join(directory, m) for m in part])
+            inputs.append(name)
+        if not args.thin:
+            for m in members:
+                os.unlink(os.path.join(directory, m))
+
+    flags = list(FLAGS[flavor])
+    if flavor == 'wasm' and workload.actions:
+        flags.append('--allow-undefined')
+    flags += [x for x in args.extra_args.split(' ') if x]
+
+    with open(os.path.join(directory, 'response.txt'), 'w') as f:
+        f.write('\n'.join(inputs + flags) + '\n')
+    with open(os.path.join(directory, 'flavor'), 'w') as f:
+        f.write(flavor + '\n')
+    print('wrote ' + directory)
+
+def main():
+    if args.objects < 1 or args.functions < 1:
+        sys.exit('--objects and --functions must be at least 1')
+    workload = Workload(random.Random(args.seed))
+    for flavor in args.flavor or ['elf', 'coff', 'wasm']:
+        generate(flavor, workload)
+
+main()
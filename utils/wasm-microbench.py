@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+#
+#                     The LLVM Compiler Infrastructure
+#
+# This file is distributed under the University of Illinois Open Source
+# License. See LICENSE.TXT for details.
+#
+# ==------------------------------------------------------------------------==#
+#
+# Microbenchmarks for the hot paths of wasm-ld.
+#
+# Each benchmark generates a synthetic LLVM IR module that stresses one part
+# of the linker, compiles it with llc, links it a number of times with
+# `wasm-ld --time` and reports the median of the phase timings that lld
+# prints.  The inputs are generated rather than checked in so that the size
+# of each benchmark can be scaled from the command line.
+#
+#   symtab  many objects defining and referencing many global symbols
+#           (SymbolTable::insert and symbol resolution)
+#   gc      a large random call graph of which only part is reachable
+#           (markLive)
+#   relocs  functions with many calls and data references
+#           (InputChunk::writeTo relocation patching)
+#
+# The Snax dispatcher and ABI merging need action metadata and ABI fragments
+# that only the Snax compiler emits, so they are measured by passing extra
+# objects built with that toolchain via --extra.
+#
+# ==------------------------------------------------------------------------==#
+
+from __future__ import print_function
+
+import argparse
+import os
+import random
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+parser = argparse.ArgumentParser()
+parser.add_argument('benchmarks', nargs='*', default=['symtab', 'gc', 'relocs'])
+parser.add_argument('--wasm-ld', default='wasm-ld')
+parser.add_argument('--llc', default='llc')
+parser.add_argument('--runs', type=int, default=5)
+parser.add_argument('--scale', type=int, default=1000,
+                    help='Number of functions per generated benchmark')
+parser.add_argument('--objects', type=int, default=16,
+                    help='Number of objects for the symtab benchmark')
+parser.add_argument('--seed', type=int, default=0)
+parser.add_argument('--extra', action='append', default=[],
+                    help='Additional input to link into every benchmark')
+parser.add_argument('--keep', action='store_true',
+                    help='Keep the generated files')
+args = parser.parse_args()
+
+HEADER = 'target triple = "wasm32-unknown-unknown"\n\n'
+
+def genSymtab(rng):
+    # Every object defines its share of the functions and calls a random
+    # sample of the functions defined by the others.
+    per = max(1, args.scale // args.objects)
+    total = per * args.objects
+    modules = []
+    for o in range(args.objects):
+        lines = [HEADER]
+        defined = range(o * per, (o + 1) * per)
+        callees = set(rng.randrange(total) for _ in range(per))
+        callees -= set(defined)
+        for c in sorted(callees):
+            lines.append('declare void @f%d()\n' % c)
+        for i in defined:
+            lines.append('define void @f%d() {\nentry:\n' % i)
+            for c in sorted(callees)[:4]:
+                lines.append('  call void @f%d()\n' % c)
+            lines.append('  ret void\n}\n')
+        if o == 0:
+            lines.append('define void @_start() {\nentry:\n'
+                         '  call void @f0()\n  ret void\n}\n')
+        modules.append(''.join(lines))
+    return modules
+
+def genGc(rng):
+    # Hidden functions are only kept alive through calls, so the live set is
+    # whatever is reachable from _start.
+    n = args.scale
+    lines = [HEADER]
+    for i in range(n):
+        lines.append('define hidden void @f%d() {\nentry:\n' % i)
+        for _ in range(3):
+            lines.append('  call void @f%d()\n' % rng.randrange(n))
+        lines.append('  ret void\n}\n')
+    lines.append('define void @_start() {\nentry:\n')
+    for i in range(0, n, max(1, n // 16)):
+        lines.append('  call void @f%d()\n' % i)
+    lines.append('  ret void\n}\n')
+    return [''.join(lines)]
+
+def genRelocs(rng):
+    n = args.scale
+    lines = [HEADER]
+    for i in range(n):
+        lines.append('@g%d = hidden global i32 %d\n' % (i, i))
+    for i in range(n):
+        lines.append('define void @f%d() {\nentry:\n' % i)
+        for j in range(8):
+            g = rng.randrange(n)
+            lines.append('  %%v%d = load volatile i32, i32* @g%d\n' % (j, g))
+            lines.append('  store volatile i32 %%v%d, i32* @g%d\n' %
+                         (j, rng.randrange(n)))
+        lines.append('  call void @f%d()\n' % rng.randrange(n))
+        lines.append('  ret void\n}\n')
+    lines.append('define void @_start() {\nentry:\n  ret void\n}\n')
+    return [''.join(lines)]
+
+GENERATORS = {
+    'symtab': genSymtab,
+    'gc': genGc,
+    'relocs': genRelocs,
+}
+
+def run(cmd):
+    try:
+        return subprocess.check_output(cmd, stderr=subprocess.STDOUT)
+    except subprocess.CalledProcessError as e:
+        print(e.output.decode('utf-8', 'replace'))
+        raise e
+
+# Parses the output of --time, lines such as "  GC:   12 ms ( 3.4%)".
+# Returns (phase, milliseconds) pairs in the order they were printed.
+def parseTimers(output):
+    ret = []
+    for line in output.decode('utf-8', 'replace').split('\n'):
+        m = re.match(r'^(\s*)([^:]+):\s+(\d+) ms', line)
+        if m:
+            ret.append((m.group(1) + m.group(2), int(m.group(3))))
+    return ret
+
+def median(values):
+    values = sorted(values)
+    return values[len(values) // 2]
+
+def runBench(name, workdir):
+    rng = random.Random(args.seed)
+    objects = []
+    for i, module in enumerate(GENERATORS[name](rng)):
+        ll = os.path.join(workdir, '%s%d.ll' % (name, i))
+        obj = os.path.join(workdir, '%s%d.o' % (name, i))
+        with open(ll, 'w') as f:
+            f.write(module)
+        run([args.llc, '-filetype=obj', ll, '-o', obj])
+        objects.append(obj)
+
+    out = os.path.join(workdir, name + '.wasm')
+    cmd = [args.wasm_ld, '--time', '--allow-undefined', '-o', out]
+    cmd += objects + args.extra
+
+    # Discard the first run to warm up any system cache.
+    run(cmd)
+    timings = {}
+    order = []
+    for _ in range(args.runs):
+        for phase, ms in parseTimers(run(cmd)):
+            if phase not in timings:
+                order.append(phase)
+            timings.setdefault(phase, []).append(ms)
+
+    print('%s (%d functions, median of %d runs)' % (name, args.scale,
+                                                    args.runs))
+    for phase in order:
+        print('  %-32s%6d ms' % (phase, median(timings[phase])))
+
+def main():
+    for name in args.benchmarks:
+        if name not in GENERATORS:
+            sys.exit('unknown benchmark: %s' % name)
+    workdir = tempfile.mkdtemp(prefix='wasm-microbench-')
+    try:
+        for name in args.benchmarks:
+            runBench(name, workdir)
+    finally:
+        if args.keep:
+            print('generated files kept in ' + workdir)
+        else:
+            shutil.rmtree(workdir)
+
+main()
@@ -0,0 +1,144 @@
+//===- BuildId.cpp --------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The build id is computed the same way as ELF's (see BuildIdSection in
+// ELF/SyntheticSections.cpp): the output is split into 1MB chunks which are
+// hashed in parallel, and the build id is the hash of the chunk hashes.
+//
+// LLVM's Support library has no SHA-256, which is what Snax uses to identify
+// contract code, so a straightforward implementation of FIPS 180-4 lives here.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BuildId.h"
+#include "Config.h"
+#include "lld/Common/Threads.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::support::endian;
+using namespace lld;
+using namespace lld::wasm;
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static uint32_t rotr(uint32_t X, unsigned N) {
+  return (X >> N) | (X << (32 - N));
+}
+
+// Processes one 64-byte block.
+static void sha256Block(uint32_t *State, const uint8_t *Block) {
+  uint32_t W[64];
+  for (int I = 0; I < 16; ++I)
+    W[I] = read32be(Block + I * 4);
+  for (int I = 16; I < 64; ++I) {
+    uint32_t S0 = rotr(W[I - 15], 7) ^ rotr(W[I - 15], 18) ^ (W[I - 15] >> 3);
+    uint32_t S1 = rotr(W[I - 2], 17) ^ rotr(W[I - 2], 19) ^ (W[I - 2] >> 10);
+    W[I] = W[I - 16] + S0 + W[I - 7] + S1;
+  }
+
+  uint32_t A = State[0], B = State[1], C = State[2], D = State[3];
+  uint32_t E = State[4], F = State[5], G = State[6], H = State[7];
+  for (int I = 0; I < 64; ++I) {
+    uint32_t S1 = rotr(E, 6) ^ rotr(E, 11) ^ rotr(E, 25);
+    uint32_t Ch = (E & F) ^ (~E & G);
+    uint32_t T1 = H + S1 + Ch + K[I] + W[I];
+    uint32_t S0 = rotr(A, 2) ^ rotr(A, 13) ^ rotr(A, 22);
+    uint32_t Maj = (A & B) ^ (A & C) ^ (B & C);
+    uint32_t T2 = S0 + Maj;
+    H = G;
+    G = F;
+    F = E;
+    E = D + T1;
+    D = C;
+    C = B;
+    B = A;
+    A = T1 + T2;
+  }
+
+  State[0] += A;
+  State[1] += B;
+  State[2] += C;
+  State[3] += D;
+  State[4] += E;
+  State[5] += F;
+  State[6] += G;
+  State[7] += H;
+}
+
+std::array<uint8_t, 32> lld::wasm::sha256(ArrayRef<uint8_t> Data) {
+  uint32_t State[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+  size_t Full = Data.size() & ~size_t(63);
+  for (size_t I = 0; I < Full; I += 64)
+    sha256Block(State, Data.data() + I);
+
+  // Pad the remainder with a 1 bit, zeros and the message length in bits so
+  // that it fills one or two final blocks.
+  uint8_t Tail[128] = {};
+  size_t Rest = Data.size() - Full;
+  memcpy(Tail, Data.data() + Full, Rest);
+  Tail[Rest] = 0x80;
+  size_t TailSize = Rest < 56 ? 64 : 128;
+  write64be(Tail + TailSize - 8, uint64_t(Data.size()) * 8);
+  for (size_t I = 0; I < TailSize; I += 64)
+    sha256Block(State, Tail + I);
+
+  std::array<uint8_t, 32> Hash;
+  for (int I = 0; I < 8; ++I)
+    write32be(Hash.data() + I * 4, State[I]);
+  return Hash;
+}
+
+size_t lld::wasm::getBuildIdSize() {
+  switch (Config->BuildId) {
+  case BuildIdKind::Fast:
+    return 8;
+  case BuildIdKind::Sha256:
+    return 32;
+  case BuildIdKind::None:
+    break;
+  }
+  llvm_unreachable("unknown BuildIdKind");
+}
+
+static void hashChunk(uint8_t *Dest, ArrayRef<uint8_t> Arr) {
+  if (Config->BuildId == BuildIdKind::Fast)
+    write64le(Dest, xxHash64(toStringRef(Arr)));
+  else
+    memcpy(Dest, sha256(Arr).data(), 32);
+}
+
+void lld::wasm::computeBuildId(ArrayRef<uint8_t> Data, uint8_t *Dest) {
+  const size_t ChunkSize = 1024 * 1024;
+  size_t HashSize = getBuildIdSize();
+  size_t NumChunks = (Data.size() + ChunkSize - 1) / ChunkSize;
+  std::vector<uint8_t> Hashes(NumChunks * HashSize);
+
+  parallelForEachN(0, NumChunks, [&](size_t I) {
+    hashChunk(Hashes.data() + I * HashSize,
+              Data.slice(I * ChunkSize,
+                         std::min(ChunkSize, Data.size() - I * ChunkSize)));
+  });
+
+  hashChunk(Dest, Hashes);
+}
@@ -0,0 +1,31 @@
+//===- BuildId.h ------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_BUILD_ID_H
+#define LLD_WASM_BUILD_ID_H
+
+#include "lld/Common/LLVM.h"
+#include <array>
+
+namespace lld {
+namespace wasm {
+
+// Returns the size of the hash selected by --build-id.
+size_t getBuildIdSize();
+
+// Computes the --build-id hash of Data into Dest, which must hold
+// getBuildIdSize() bytes.
+void computeBuildId(ArrayRef<uint8_t> Data, uint8_t *Dest);
+
+std::array<uint8_t, 32> sha256(ArrayRef<uint8_t> Data);
+
+} // namespace wasm
+} // namespace lld
+
+#endif
@@ -0,0 +1,122 @@
+//===- CodeReader.h ---------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Helpers for walking the instructions of a function body.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_CODE_READER_H
+#define LLD_WASM_CODE_READER_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Support/LEB128.h"
+
+namespace lld {
+namespace wasm {
+
+// Reads instructions and their immediates from a function body.
+struct CodeReader {
+  CodeReader(ArrayRef<uint8_t> Data, uint32_t Pc) : Data(Data), Pc(Pc) {}
+
+  bool atEnd() const { return Pc >= Data.size(); }
+
+  uint8_t u8() {
+    if (atEnd()) {
+      Error = true;
+      return 0;
+    }
+    return Data[Pc++];
+  }
+
+  uint64_t uleb() {
+    const char *Err = nullptr;
+    unsigned N = 0;
+    uint64_t V = llvm::decodeULEB128(Data.data() + Pc, &N, Data.end(), &Err);
+    Error |= Err != nullptr;
+    Pc += N;
+    return V;
+  }
+
+  int64_t sleb() {
+    const char *Err = nullptr;
+    unsigned N = 0;
+    int64_t V = llvm::decodeSLEB128(Data.data() + Pc, &N, Data.end(), &Err);
+    Error |= Err != nullptr;
+    Pc += N;
+    return V;
+  }
+
+  uint64_t fixed(unsigned Size) {
+    uint64_t V = 0;
+    for (unsigned I = 0; I < Size; ++I)
+      V |= uint64_t(u8()) << (8 * I);
+    return V;
+  }
+
+  ArrayRef<uint8_t> Data;
+  uint32_t Pc;
+  bool Error = false;
+};
+
+// Skips the immediates of an instruction. Returns false for opcodes outside
+// of WebAssembly MVP and the sign extension operators.
+inline bool skipImmediates(CodeReader &R, uint8_t Op) {
+  switch (Op) {
+  case 0x02: // block
+  case 0x03: // loop
+  case 0x04: // if
+    R.u8();
+    return true;
+  case 0x0c: // br
+  case 0x0d: // br_if
+  case 0x10: // call
+    R.uleb();
+    return true;
+  case 0x0e: { // br_table
+    uint64_t N = R.uleb();
+    for (uint64_t I = 0; I <= N && !R.Error; ++I)
+      R.uleb();
+    return true;
+  }
+  case 0x11: // call_indirect
+    R.uleb();
+    R.uleb();
+    return true;
+  case 0x3f: // memory.size
+  case 0x40: // memory.grow
+    R.u8();
+    return true;
+  case 0x41: // i32.const
+  case 0x42: // i64.const
+    R.sleb();
+    return true;
+  case 0x43: // f32.const
+    R.fixed(4);
+    return true;
+  case 0x44: // f64.const
+    R.fixed(8);
+    return true;
+  }
+  if (Op >= 0x20 && Op <= 0x24) { // local and global accesses
+    R.uleb();
+    return true;
+  }
+  if (Op >= 0x28 && Op <= 0x3e) { // loads and stores
+    R.uleb();
+    R.uleb();
+    return true;
+  }
+  return Op <= 0x01 || Op == 0x05 || Op == 0x0b || Op == 0x0f || Op == 0x1a ||
+         Op == 0x1b || (Op >= 0x45 && Op <= 0xc4);
+}
+
+} // namespace wasm
+} // namespace lld
+
+#endif
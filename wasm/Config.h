@@ -10,6 +10,7 @@
 #ifndef LLD_WASM_CONFIG_H
 #define LLD_WASM_CONFIG_H
 
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/BinaryFormat/Wasm.h"
@@ -17,8 +18,16 @@
 #include "llvm/Support/CachePruning.h"
 
 namespace lld {
+class LinkCache;
+
 namespace wasm {
 
+class InputFunction;
+
+enum class BuildIdKind { None, Fast, Sha256 };
+
+enum class ICFLevel { None, Safe, All };
+
 struct Configuration {
   inline bool should_export(const llvm::wasm::WasmExport& ex)const {
      for (auto x : exports) {
@@ -28,37 +37,66 @@ struct Configuration {
      return false;
   }
   bool AllowUndefined;
+  bool AutoStackSize;
+  bool BinaryABI;
+  bool CallGraphSort;
   bool CompressRelocTargets;
+  bool ContractLTO;
   bool Demangle;
+  bool Devirtualize;
   bool DisableVerify;
+  bool DispatchSection;
+  bool EvalCtors;
   bool ExportAll;
   bool ExportTable;
+  bool FoldGlobals;
+  bool FunctionHashes;
   bool GcSections;
   bool ImportMemory;
   bool ImportTable;
+  bool Incremental;
+  bool InlineDispatch;
   bool MergeDataSegments;
+  bool PrintActionCost;
+  bool PrintActionFootprint;
   bool PrintGcSections;
+  bool PrintIcfSections;
+  bool PrintMemoryUsage;
+  bool PruneNameSection;
   bool Relocatable;
   bool SaveTemps;
+  bool ShowTiming;
+  bool SortImports;
+  bool SortTable;
   bool StripAll;
   bool StripDebug;
   bool StackFirst;
+  BuildIdKind BuildId;
+  ICFLevel ICF;
   uint32_t GlobalBase;
   uint32_t InitialMemory;
   uint32_t MaxMemory;
+  uint32_t SplitZeroRuns;
   uint32_t ZStackSize;
   unsigned LTOPartitions;
   unsigned LTOO;
   unsigned Optimize;
   unsigned ThinLTOJobs;
   llvm::StringRef Entry;
+  llvm::StringRef MapFile;
   llvm::StringRef OutputFile;
   llvm::StringRef ABIOutputFile;
   llvm::StringRef ThinLTOCacheDir;
+  llvm::StringRef TimeTraceFile;
   std::vector<llvm::wasm::WasmExport> exports;  
   llvm::StringSet<> AllowUndefinedSymbols;
   std::vector<llvm::StringRef> SearchPaths;
+  std::vector<llvm::StringRef> SymbolOrderingFile;
+  llvm::MapVector<std::pair<const InputFunction *, const InputFunction *>,
+                  uint64_t>
+      CallGraphProfile;
   llvm::CachePruningPolicy ThinLTOCachePolicy;
+  LinkCache *OutputCache = nullptr;
 };
 
 // The only instance of Configuration struct.
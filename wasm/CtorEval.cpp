@@ -0,0 +1,675 @@
+//===- CtorEval.cpp -------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Link-time evaluation of static constructors for --snax-eval-ctors.
+//
+// The generated apply function calls __wasm_call_ctors at the start of every
+// action, and every action starts from the memory image in the data
+// segments.  A constructor that only computes values and stores them to
+// memory therefore redoes the same work on every action.  This file runs
+// such constructors in an interpreter once the output is laid out, so that
+// the data segments can hold the memory as it is after they ran.
+//
+// The interpreter covers the integer part of WebAssembly MVP.  It gives up
+// on a constructor that calls an import or a synthetic function, executes
+// floating point arithmetic, grows memory, traps, stores outside the data
+// segments and the stack, leaves the stack pointer moved, or runs for too
+// long.  Constructors are run in order and the first one given up on stops
+// the evaluation, as the ones after it may depend on its effects.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CtorEval.h"
+#include "CodeReader.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputGlobal.h"
+#include "OutputSegment.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <limits>
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+// The number of instructions that all constructors together may execute.
+static const uint64_t MaxSteps = 50000000;
+
+// The maximum depth of nested calls.
+static const unsigned MaxCallDepth = 256;
+
+namespace {
+// A function body prepared for interpretation.
+struct FunctionCode {
+  std::vector<uint8_t> Body;
+  // The offset of the first instruction and the number of locals that are
+  // not parameters.
+  uint32_t CodeStart = 0;
+  uint32_t NumLocals = 0;
+  // Map the offset of each block, loop and if to that of its end, and the
+  // offset of each if that has an else to that of the else.
+  DenseMap<uint32_t, uint32_t> Ends;
+  DenseMap<uint32_t, uint32_t> Elses;
+};
+
+// An entry of the control stack.
+struct Label {
+  // Where a branch to this label continues.
+  uint32_t Target;
+  // The height of the operand stack when the block was entered.
+  size_t Height;
+  bool IsLoop;
+  bool HasResult;
+};
+
+class Interpreter {
+public:
+  explicit Interpreter(const CtorEvalModule &M);
+
+  // Runs a constructor. On failure, its effects are undone and Reason says
+  // why it could not be run.
+  bool runCtor(const FunctionSymbol *Ctor);
+
+  void getResult(std::vector<std::vector<uint8_t>> &SegmentContents);
+
+  std::string Reason;
+
+private:
+  bool fail(const Twine &Msg) {
+    Reason = Msg.str();
+    return false;
+  }
+
+  const FunctionCode *getCode(const InputFunction *F);
+  bool call(uint32_t Index, std::vector<uint64_t> &Stack, unsigned Depth);
+  bool execute(const InputFunction *F, const FunctionCode &Code,
+               std::vector<uint64_t> &Locals, uint64_t &Result,
+               unsigned Depth);
+  bool isWritable(uint64_t Addr, unsigned Size) const;
+
+  const CtorEvalModule &M;
+  DenseMap<const InputFunction *, std::unique_ptr<FunctionCode>> Codes;
+  uint64_t Steps = 0;
+
+  std::vector<uint8_t> Memory;
+  // Address ranges that may be stored to, sorted by start address.
+  std::vector<std::pair<uint64_t, uint64_t>> Writable;
+  // The bytes overwritten by the current constructor, to undo its stores.
+  std::vector<std::pair<uint32_t, uint8_t>> Journal;
+
+  // Values of the defined globals. Globals that are not initialized to a
+  // constant cannot be used.
+  std::vector<uint64_t> Globals;
+  std::vector<bool> KnownGlobals;
+};
+} // namespace
+
+Interpreter::Interpreter(const CtorEvalModule &M) : M(M) {
+  Memory.resize(uint64_t(M.NumMemoryPages) * WasmPageSize);
+
+  // Lay out the initial contents of the data segments, relocated.
+  for (OutputSegment *Seg : M.Segments) {
+    for (InputSegment *InputSeg : Seg->InputSegments) {
+      InputSeg->OutputOffset = Seg->StartVA + InputSeg->OutputSegmentOffset;
+      InputSeg->writeTo(Memory.data());
+    }
+    Writable.push_back({Seg->StartVA, uint64_t(Seg->StartVA) + Seg->Size});
+  }
+
+  for (const InputGlobal *G : M.Globals) {
+    const WasmInitExpr &Init = G->Global.InitExpr;
+    if (Init.Opcode == WASM_OPCODE_I32_CONST) {
+      Globals.push_back(uint32_t(Init.Value.Int32));
+      KnownGlobals.push_back(true);
+    } else if (Init.Opcode == WASM_OPCODE_I64_CONST) {
+      Globals.push_back(Init.Value.Int64);
+      KnownGlobals.push_back(true);
+    } else {
+      Globals.push_back(0);
+      KnownGlobals.push_back(false);
+    }
+  }
+
+  // The stack grows down from the initial value of the stack pointer.
+  if (WasmSym::StackPointer) {
+    uint64_t Top = uint32_t(
+        WasmSym::StackPointer->Global->Global.InitExpr.Value.Int32);
+    uint64_t Bottom = Top >= Config->ZStackSize ? Top - Config->ZStackSize : 0;
+    Writable.push_back({Bottom, Top});
+  }
+  std::sort(Writable.begin(), Writable.end());
+}
+
+bool Interpreter::isWritable(uint64_t Addr, unsigned Size) const {
+  auto It = std::upper_bound(
+      Writable.begin(), Writable.end(), Addr,
+      [](uint64_t A, const std::pair<uint64_t, uint64_t> &R) {
+        return A < R.first;
+      });
+  if (It == Writable.begin())
+    return false;
+  --It;
+  return Addr + Size <= It->second;
+}
+
+const FunctionCode *Interpreter::getCode(const InputFunction *F) {
+  std::unique_ptr<FunctionCode> &Code = Codes[F];
+  if (Code)
+    return Code.get();
+
+  auto C = llvm::make_unique<FunctionCode>();
+  C->Body = F->getRelocatedBody();
+  CodeReader R(C->Body, 0);
+  R.uleb(); // body size
+  uint64_t NumGroups = R.uleb();
+  for (uint64_t I = 0; I < NumGroups && !R.Error; ++I) {
+    uint64_t N = R.uleb();
+    R.u8(); // type
+    if (C->NumLocals + N > 50000) {
+      fail(F->getName() + " has too many locals");
+      return nullptr;
+    }
+    C->NumLocals += N;
+  }
+  C->CodeStart = R.Pc;
+
+  // Match each block, loop and if with its else and end.
+  std::vector<uint32_t> Open;
+  bool Done = false;
+  while (!Done && !R.atEnd() && !R.Error) {
+    uint32_t Pos = R.Pc;
+    uint8_t Op = R.u8();
+    if (!skipImmediates(R, Op)) {
+      fail(F->getName() + " uses unsupported opcode 0x" + utohexstr(Op));
+      return nullptr;
+    }
+    if (Op == 0x02 || Op == 0x03 || Op == 0x04) {
+      Open.push_back(Pos);
+    } else if (Op == 0x05 && !Open.empty()) {
+      C->Elses[Open.back()] = Pos;
+    } else if (Op == 0x0b) {
+      if (Open.empty()) {
+        Done = true;
+        continue;
+      }
+      C->Ends[Open.back()] = Pos;
+      Open.pop_back();
+    }
+  }
+  if (!Done || R.Error || !R.atEnd()) {
+    fail(F->getName() + " has a malformed body");
+    return nullptr;
+  }
+
+  Code = std::move(C);
+  return Code.get();
+}
+
+bool Interpreter::call(uint32_t Index, std::vector<uint64_t> &Stack,
+                       unsigned Depth) {
+  if (Index < M.NumImportedFunctions)
+    return fail("calls imported function " + Twine(Index));
+  if (Index - M.NumImportedFunctions >= M.Functions.size())
+    return fail("calls invalid function " + Twine(Index));
+  const InputFunction *F = M.Functions[Index - M.NumImportedFunctions];
+  if (!F->File)
+    return fail("calls synthetic function " + F->getName());
+  if (Depth >= MaxCallDepth)
+    return fail("nests calls too deeply");
+
+  const FunctionCode *Code = getCode(F);
+  if (!Code)
+    return false;
+
+  size_t NumParams = F->Signature.ParamTypes.size();
+  if (Stack.size() < NumParams)
+    return fail(F->getName() + " called with too few arguments");
+  std::vector<uint64_t> Locals(Stack.end() - NumParams, Stack.end());
+  Stack.resize(Stack.size() - NumParams);
+  Locals.resize(NumParams + Code->NumLocals);
+
+  uint64_t Result;
+  if (!execute(F, *Code, Locals, Result, Depth + 1))
+    return false;
+  if (F->Signature.ReturnType != WASM_TYPE_NORESULT)
+    Stack.push_back(Result);
+  return true;
+}
+
+template <class U, class S> static uint64_t compare(unsigned K, U A, U B) {
+  S SA = S(A);
+  S SB = S(B);
+  switch (K) {
+  case 0: return A == B;
+  case 1: return A != B;
+  case 2: return SA < SB;
+  case 3: return A < B;
+  case 4: return SA > SB;
+  case 5: return A > B;
+  case 6: return SA <= SB;
+  case 7: return A <= B;
+  case 8: return SA >= SB;
+  default: return A >= B;
+  }
+}
+
+// Evaluates a binary arithmetic instruction, numbered from add. Returns
+// false if it traps.
+template <class U, class S>
+static bool arith(unsigned K, U A, U B, uint64_t &Result) {
+  const unsigned Bits = sizeof(U) * 8;
+  unsigned Shift = B % Bits;
+  U R;
+  switch (K) {
+  case 0: R = A + B; break;
+  case 1: R = A - B; break;
+  case 2: R = A * B; break;
+  case 3:
+    if (B == 0 || (S(A) == std::numeric_limits<S>::min() && S(B) == -1))
+      return false;
+    R = U(S(A) / S(B));
+    break;
+  case 4:
+    if (B == 0)
+      return false;
+    R = A / B;
+    break;
+  case 5:
+    if (B == 0)
+      return false;
+    R = S(B) == -1 ? 0 : U(S(A) % S(B));
+    break;
+  case 6:
+    if (B == 0)
+      return false;
+    R = A % B;
+    break;
+  case 7: R = A & B; break;
+  case 8: R = A | B; break;
+  case 9: R = A ^ B; break;
+  case 10: R = A << Shift; break;
+  case 11: R = U(S(A) >> Shift); break;
+  case 12: R = A >> Shift; break;
+  case 13: R = Shift ? U((A << Shift) | (A >> (Bits - Shift))) : A; break;
+  default: R = Shift ? U((A >> Shift) | (A << (Bits - Shift))) : A; break;
+  }
+  Result = R;
+  return true;
+}
+
+// Evaluates a numeric instruction. Returns false if it traps or works on
+// floating point values.
+static bool evalNumeric(uint8_t Op, std::vector<uint64_t> &Stack) {
+  auto Unary = [&](uint64_t V) { Stack.back() = V; };
+
+  // i32.eqz and i64.eqz
+  if (Op == 0x45 || Op == 0x50) {
+    Unary(Stack.back() == 0);
+    return true;
+  }
+
+  // Comparisons, in the order eq, ne, lt_s, lt_u, gt_s, gt_u, le_s, le_u,
+  // ge_s and ge_u.
+  if ((Op >= 0x46 && Op <= 0x4f) || (Op >= 0x51 && Op <= 0x5a)) {
+    if (Stack.size() < 2)
+      return false;
+    uint64_t B = Stack.back();
+    Stack.pop_back();
+    uint64_t A = Stack.back();
+    if (Op <= 0x4f)
+      Unary(compare<uint32_t, int32_t>(Op - 0x46, A, B));
+    else
+      Unary(compare<uint64_t, int64_t>(Op - 0x51, A, B));
+    return true;
+  }
+
+  switch (Op) {
+  case 0x67: Unary(countLeadingZeros(uint32_t(Stack.back()))); return true;
+  case 0x68: Unary(countTrailingZeros(uint32_t(Stack.back()))); return true;
+  case 0x69: Unary(countPopulation(uint32_t(Stack.back()))); return true;
+  case 0x79: Unary(countLeadingZeros(Stack.back())); return true;
+  case 0x7a: Unary(countTrailingZeros(Stack.back())); return true;
+  case 0x7b: Unary(countPopulation(Stack.back())); return true;
+  case 0xa7: Unary(uint32_t(Stack.back())); return true; // i32.wrap_i64
+  case 0xac: // i64.extend_i32_s
+    Unary(uint64_t(int64_t(int32_t(Stack.back()))));
+    return true;
+  case 0xad: Unary(uint32_t(Stack.back())); return true; // i64.extend_i32_u
+  case 0xbc: // i32.reinterpret_f32
+  case 0xbd: // i64.reinterpret_f64
+  case 0xbe: // f32.reinterpret_i32
+  case 0xbf: // f64.reinterpret_i64
+    return true;
+  case 0xc0: Unary(uint32_t(SignExtend32<8>(Stack.back()))); return true;
+  case 0xc1: Unary(uint32_t(SignExtend32<16>(Stack.back()))); return true;
+  case 0xc2: Unary(SignExtend64<8>(Stack.back())); return true;
+  case 0xc3: Unary(SignExtend64<16>(Stack.back())); return true;
+  case 0xc4: Unary(SignExtend64<32>(Stack.back())); return true;
+  }
+
+  // Binary arithmetic, in the order add, sub, mul, div_s, div_u, rem_s,
+  // rem_u, and, or, xor, shl, shr_s, shr_u, rotl and rotr.
+  if ((Op >= 0x6a && Op <= 0x78) || (Op >= 0x7c && Op <= 0x8a)) {
+    if (Stack.size() < 2)
+      return false;
+    uint64_t B = Stack.back();
+    Stack.pop_back();
+    uint64_t A = Stack.back();
+    if (Op <= 0x78)
+      return arith<uint32_t, int32_t>(Op - 0x6a, A, B, Stack.back());
+    return arith<uint64_t, int64_t>(Op - 0x7c, A, B, Stack.back());
+  }
+  return false;
+}
+
+bool Interpreter::execute(const InputFunction *F, const FunctionCode &Code,
+                          std::vector<uint64_t> &Locals, uint64_t &Result,
+                          unsigned Depth) {
+  std::vector<uint64_t> Stack;
+  std::vector<Label> Labels;
+  CodeReader R(Code.Body, Code.CodeStart);
+  bool Underflow = false;
+
+  auto Pop = [&]() -> uint64_t {
+    if (Stack.empty()) {
+      Underflow = true;
+      return 0;
+    }
+    uint64_t V = Stack.back();
+    Stack.pop_back();
+    return V;
+  };
+
+  auto Return = [&]() {
+    Result = 0;
+    if (F->Signature.ReturnType != WASM_TYPE_NORESULT)
+      Result = Pop();
+    return !Underflow || fail(F->getName() + ": operand stack underflow");
+  };
+
+  // Branches to the label Up levels up. Returns false if that leaves the
+  // function.
+  auto Branch = [&](uint64_t Up) {
+    if (Up >= Labels.size())
+      return false;
+    Label L = Labels[Labels.size() - 1 - Up];
+    if (L.IsLoop) {
+      Stack.resize(std::min(Stack.size(), L.Height));
+      Labels.resize(Labels.size() - Up);
+    } else {
+      uint64_t V = L.HasResult ? Pop() : 0;
+      Stack.resize(std::min(Stack.size(), L.Height));
+      if (L.HasResult)
+        Stack.push_back(V);
+      Labels.resize(Labels.size() - 1 - Up);
+    }
+    R.Pc = L.Target;
+    return true;
+  };
+
+  while (true) {
+    if (++Steps > MaxSteps)
+      return fail("runs for too long");
+    uint32_t Pos = R.Pc;
+    uint8_t Op = R.u8();
+    if (R.Error)
+      return fail(F->getName() + " has a malformed body");
+
+    switch (Op) {
+    case 0x00:
+      return fail(F->getName() + " executes unreachable");
+    case 0x01: // nop
+      break;
+    case 0x02: // block
+    case 0x03: // loop
+    case 0x04: { // if
+      bool HasResult = R.u8() != 0x40;
+      if (Op == 0x03) {
+        Labels.push_back({R.Pc, Stack.size(), true, false});
+        break;
+      }
+      uint32_t End = Code.Ends.lookup(Pos);
+      if (Op == 0x02) {
+        Labels.push_back({End + 1, Stack.size(), false, HasResult});
+        break;
+      }
+      uint64_t Cond = Pop();
+      Labels.push_back({End + 1, Stack.size(), false, HasResult});
+      if (uint32_t(Cond) == 0) {
+        auto It = Code.Elses.find(Pos);
+        if (It != Code.Elses.end()) {
+          R.Pc = It->second + 1;
+        } else {
+          Labels.pop_back();
+          R.Pc = End + 1;
+        }
+      }
+      break;
+    }
+    case 0x05: // else, reached at the end of the then arm
+      if (Labels.empty())
+        return fail(F->getName() + " has a malformed body");
+      R.Pc = Labels.back().Target;
+      Labels.pop_back();
+      break;
+    case 0x0b: // end
+      if (Labels.empty())
+        return Return();
+      Labels.pop_back();
+      break;
+    case 0x0c: // br
+      if (!Branch(R.uleb()))
+        return Return();
+      break;
+    case 0x0d: { // br_if
+      uint64_t Target = R.uleb();
+      if (uint32_t(Pop()) != 0 && !Branch(Target))
+        return Return();
+      break;
+    }
+    case 0x0e: { // br_table
+      uint64_t N = R.uleb();
+      std::vector<uint64_t> Targets;
+      for (uint64_t I = 0; I < N && !R.Error; ++I)
+        Targets.push_back(R.uleb());
+      uint64_t Default = R.uleb();
+      uint32_t I = Pop();
+      if (!Branch(I < Targets.size() ? Targets[I] : Default))
+        return Return();
+      break;
+    }
+    case 0x0f: // return
+      return Return();
+    case 0x10: // call
+      if (!call(R.uleb(), Stack, Depth))
+        return false;
+      break;
+    case 0x11: { // call_indirect
+      uint64_t TypeIndex = R.uleb();
+      R.uleb(); // table
+      uint32_t Elem = Pop();
+      if (Elem < M.TableBase || Elem - M.TableBase >= M.Table.size())
+        return fail("calls an invalid table element");
+      const FunctionSymbol *Callee = M.Table[Elem - M.TableBase];
+      if (TypeIndex >= M.Types.size() ||
+          !(*M.Types[TypeIndex] == *Callee->getFunctionType()))
+        return fail("calls " + Callee->getName() + " with a wrong signature");
+      if (!call(Callee->getFunctionIndex(), Stack, Depth))
+        return false;
+      break;
+    }
+    case 0x1a: // drop
+      Pop();
+      break;
+    case 0x1b: { // select
+      uint64_t Cond = Pop();
+      uint64_t B = Pop();
+      uint64_t A = Pop();
+      Stack.push_back(uint32_t(Cond) ? A : B);
+      break;
+    }
+    case 0x20: // local.get
+    case 0x21: // local.set
+    case 0x22: { // local.tee
+      uint64_t I = R.uleb();
+      if (I >= Locals.size())
+        return fail(F->getName() + " uses an invalid local");
+      if (Op == 0x20)
+        Stack.push_back(Locals[I]);
+      else if (Op == 0x21)
+        Locals[I] = Pop();
+      else if (!Stack.empty())
+        Locals[I] = Stack.back();
+      break;
+    }
+    case 0x23: // global.get
+    case 0x24: { // global.set
+      uint64_t Index = R.uleb();
+      if (Index < M.NumImportedGlobals)
+        return fail("uses imported global " + Twine(Index));
+      uint64_t I = Index - M.NumImportedGlobals;
+      if (I >= Globals.size() || !KnownGlobals[I])
+        return fail("uses global " + Twine(Index) +
+                    ", which is not initialized to a constant");
+      if (Op == 0x23)
+        Stack.push_back(Globals[I]);
+      else
+        Globals[I] = Pop();
+      break;
+    }
+    case 0x3f: // memory.size
+      R.u8();
+      Stack.push_back(M.NumMemoryPages);
+      break;
+    case 0x40:
+      return fail("grows memory");
+    case 0x41: // i32.const
+      Stack.push_back(uint32_t(R.sleb()));
+      break;
+    case 0x42: // i64.const
+      Stack.push_back(R.sleb());
+      break;
+    case 0x43: // f32.const
+      Stack.push_back(R.fixed(4));
+      break;
+    case 0x44: // f64.const
+      Stack.push_back(R.fixed(8));
+      break;
+    default:
+      if (Op >= 0x28 && Op <= 0x35) { // loads
+        static const uint8_t Sizes[] = {4, 8, 4, 8, 1, 1, 2,
+                                        2, 1, 1, 2, 2, 4, 4};
+        unsigned Size = Sizes[Op - 0x28];
+        R.uleb(); // alignment
+        uint64_t Addr = uint64_t(uint32_t(Pop())) + R.uleb();
+        if (Addr + Size > Memory.size())
+          return fail("loads out of bounds");
+        uint64_t V = 0;
+        for (unsigned I = 0; I < Size; ++I)
+          V |= uint64_t(Memory[Addr + I]) << (8 * I);
+        switch (Op) {
+        case 0x2c: V = uint32_t(SignExtend32<8>(V)); break;
+        case 0x2e: V = uint32_t(SignExtend32<16>(V)); break;
+        case 0x30: V = SignExtend64<8>(V); break;
+        case 0x32: V = SignExtend64<16>(V); break;
+        case 0x34: V = SignExtend64<32>(V); break;
+        }
+        Stack.push_back(V);
+        break;
+      }
+      if (Op >= 0x36 && Op <= 0x3e) { // stores
+        static const uint8_t Sizes[] = {4, 8, 4, 8, 1, 2, 1, 2, 4};
+        unsigned Size = Sizes[Op - 0x36];
+        R.uleb(); // alignment
+        uint64_t Offset = R.uleb();
+        uint64_t V = Pop();
+        uint64_t Addr = uint64_t(uint32_t(Pop())) + Offset;
+        if (Addr + Size > Memory.size() || !isWritable(Addr, Size))
+          return fail("stores to address " + Twine(Addr) +
+                      ", outside of the data segments and the stack");
+        for (unsigned I = 0; I < Size; ++I) {
+          Journal.push_back({uint32_t(Addr + I), Memory[Addr + I]});
+          Memory[Addr + I] = uint8_t(V >> (8 * I));
+        }
+        break;
+      }
+      if (Stack.empty() || !evalNumeric(Op, Stack))
+        return fail(F->getName() + " executes unsupported or trapping "
+                    "instruction 0x" + utohexstr(Op));
+      break;
+    }
+
+    if (Underflow)
+      return fail(F->getName() + ": operand stack underflow");
+  }
+}
+
+bool Interpreter::runCtor(const FunctionSymbol *Ctor) {
+  Journal.clear();
+  std::vector<uint64_t> SavedGlobals = Globals;
+
+  std::vector<uint64_t> Stack;
+  bool Ok = call(Ctor->getFunctionIndex(), Stack, 0);
+  if (Ok && WasmSym::StackPointer) {
+    uint32_t SP =
+        WasmSym::StackPointer->getGlobalIndex() - M.NumImportedGlobals;
+    if (Globals[SP] != SavedGlobals[SP])
+      Ok = fail("does not restore the stack pointer");
+  }
+  if (Ok)
+    return true;
+
+  for (auto It = Journal.rbegin(), E = Journal.rend(); It != E; ++It)
+    Memory[It->first] = It->second;
+  Globals = std::move(SavedGlobals);
+  return false;
+}
+
+void Interpreter::getResult(std::vector<std::vector<uint8_t>> &Contents) {
+  Contents.clear();
+  for (OutputSegment *Seg : M.Segments) {
+    auto Begin = Memory.begin() + Seg->StartVA;
+    Contents.emplace_back(Begin, Begin + Seg->Size);
+  }
+
+  for (size_t I = 0, E = M.Globals.size(); I != E; ++I) {
+    if (!KnownGlobals[I])
+      continue;
+    WasmInitExpr &Init = M.Globals[I]->Global.InitExpr;
+    if (Init.Opcode == WASM_OPCODE_I32_CONST)
+      Init.Value.Int32 = int32_t(Globals[I]);
+    else
+      Init.Value.Int64 = int64_t(Globals[I]);
+  }
+}
+
+size_t lld::wasm::evaluateCtors(
+    const CtorEvalModule &M, ArrayRef<const FunctionSymbol *> Ctors,
+    std::vector<std::vector<uint8_t>> &SegmentContents) {
+  Interpreter I(M);
+  size_t NumRun = 0;
+  for (const FunctionSymbol *Ctor : Ctors) {
+    if (!I.runCtor(Ctor)) {
+      log("--snax-eval-ctors: " + Ctor->getName() + " " + I.Reason +
+          ", so it and the constructors after it run at runtime");
+      break;
+    }
+    ++NumRun;
+  }
+  if (NumRun)
+    I.getResult(SegmentContents);
+  return NumRun;
+}
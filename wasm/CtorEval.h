@@ -0,0 +1,52 @@
+//===- CtorEval.h -----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_CTOR_EVAL_H
+#define LLD_WASM_CTOR_EVAL_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/Object/Wasm.h"
+#include <string>
+#include <vector>
+
+namespace lld {
+namespace wasm {
+
+class FunctionSymbol;
+class InputFunction;
+class InputGlobal;
+class OutputSegment;
+
+// The parts of the output module that constructors can observe, with all
+// indices and addresses assigned and relocations resolved.
+struct CtorEvalModule {
+  ArrayRef<InputFunction *> Functions;
+  ArrayRef<InputGlobal *> Globals;
+  ArrayRef<const FunctionSymbol *> Table;
+  ArrayRef<const llvm::wasm::WasmSignature *> Types;
+  ArrayRef<OutputSegment *> Segments;
+  uint32_t NumImportedFunctions;
+  uint32_t NumImportedGlobals;
+  uint32_t NumMemoryPages;
+  uint32_t TableBase;
+};
+
+// Runs Ctors in order in an interpreter until one of them cannot be run at
+// link time, for example because it calls an import. Returns how many were
+// run. If that is not zero, SegmentContents is set to the contents of each
+// output segment after running them, and the init expressions of globals
+// they changed are updated.
+size_t evaluateCtors(const CtorEvalModule &M,
+                     ArrayRef<const FunctionSymbol *> Ctors,
+                     std::vector<std::vector<uint8_t>> &SegmentContents);
+
+} // namespace wasm
+} // namespace lld
+
+#endif
@@ -0,0 +1,236 @@
+//===- Devirtualize.cpp ---------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implements --devirtualize.  A call_indirect checks that the table entry at
+// the index on top of the stack has the expected signature and traps if it
+// does not.  After garbage collection, the table holds exactly the functions
+// whose table index is taken by a live chunk, so if only one of them, F, has
+// the signature of a call_indirect, the call either calls F or traps.  Such
+// calls are rewritten in one of two ways:
+//
+//  - If the index is pushed by an i32.const of F's table index right before
+//    the call, the i32.const is removed and the call_indirect becomes a call
+//    of F.  If no other use takes F's table index, F leaves the table.
+//
+//  - Otherwise, the call_indirect becomes a call of a guard function, which
+//    takes the index as an extra last parameter, traps unless it is F's
+//    table index and then calls F.
+//
+// The call_indirect immediates are a 5-byte padded type index and a zero
+// byte for the table, so the call fits in the same seven bytes, followed by
+// a nop, or without padding when relocation targets are compressed.
+//
+// The table of a module that imports or exports it may be changed or called
+// through from outside, so nothing is rewritten then.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Devirtualize.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "WriterUtils.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Memory.h"
+#include "lld/Common/Strings.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseMap.h"
+
+#define DEBUG_TYPE "lld"
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+static Timer DevirtualizeTimer("Devirtualize", Timer::root());
+
+namespace {
+enum : uint8_t {
+  OPCODE_UNREACHABLE = 0x00,
+  OPCODE_IF = 0x04,
+  OPCODE_END = 0x0b,
+  OPCODE_CALL = 0x10,
+  OPCODE_CALL_INDIRECT = 0x11,
+  OPCODE_GET_LOCAL = 0x20,
+  OPCODE_I32_CONST = 0x41,
+  OPCODE_I32_NE = 0x47,
+};
+
+// The table entries with one signature.
+struct Entries {
+  DefinedFunction *Target = nullptr;
+  bool Unique = true;
+};
+} // namespace
+
+// The guard functions created for the current link and their targets.
+static std::vector<std::pair<SyntheticFunction *, const DefinedFunction *>>
+    Guards;
+
+static bool isTableIndexReloc(const WasmRelocation &Rel) {
+  return Rel.Type == R_WEBASSEMBLY_TABLE_INDEX_SLEB ||
+         Rel.Type == R_WEBASSEMBLY_TABLE_INDEX_I32;
+}
+
+// Returns the defined function whose table index Sym stands for, or null if
+// Sym is not defined in the output or is the null function pointer of a weak
+// undefined symbol.
+static DefinedFunction *getTableTarget(FunctionSymbol *Sym) {
+  auto *F = dyn_cast<DefinedFunction>(Sym);
+  if (!F || !F->Function || Sym->hasTableIndex())
+    return nullptr;
+  return F;
+}
+
+static SyntheticFunction *createGuard(const DefinedFunction *Target) {
+  auto *Sig = make<WasmSignature>(Target->Function->Signature);
+  Sig->ParamTypes.push_back(WASM_TYPE_I32);
+  auto *Guard = make<SyntheticFunction>(
+      *Sig, Saver.save("__call_guard." + Target->getName()),
+      Saver.save("call guard for " + toString(*Target)));
+  Guard->Live = true;
+  Symtab->SyntheticFunctions.push_back(Guard);
+  Guards.push_back({Guard, Target});
+  return Guard;
+}
+
+void lld::wasm::devirtualizeCalls() {
+  ScopedTimer T(DevirtualizeTimer);
+  Guards.clear();
+
+  if (Config->ImportTable || Config->ExportTable) {
+    log("--devirtualize: the table is " +
+        Twine(Config->ImportTable ? "imported" : "exported"));
+    return;
+  }
+
+  // Collect the future table entries by signature.  Entries that are not
+  // defined functions keep their signature from being devirtualized.
+  DenseMap<WasmSignature, Entries> BySignature;
+  auto AddEntries = [&](const InputChunk *C) {
+    if (!C->Live)
+      return;
+    for (const WasmRelocation &Rel : C->getRelocations()) {
+      if (!isTableIndexReloc(Rel))
+        continue;
+      FunctionSymbol *Sym = C->File->getFunctionSymbol(Rel.Index);
+      if (Sym->hasTableIndex())
+        continue;
+      Entries &E = BySignature[*Sym->getFunctionType()];
+      DefinedFunction *F = getTableTarget(Sym);
+      if (!F || (E.Target && E.Target->Function != F->Function))
+        E.Unique = false;
+      else
+        E.Target = F;
+    }
+  };
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    for (const InputChunk *C : File->Functions)
+      AddEntries(C);
+    for (const InputChunk *C : File->Segments)
+      AddEntries(C);
+    for (const InputChunk *C : File->CustomSections)
+      AddEntries(C);
+  }
+
+  DenseMap<const InputFunction *, SyntheticFunction *> GuardOf;
+  size_t NumDirect = 0;
+  size_t NumGuarded = 0;
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    ArrayRef<uint8_t> Content = File->CodeSection
+                                    ? File->CodeSection->Content
+                                    : ArrayRef<uint8_t>();
+    ArrayRef<WasmSignature> Types = File->getWasmObj()->types();
+    for (InputFunction *F : File->Functions) {
+      if (!F->Live)
+        continue;
+      ArrayRef<WasmRelocation> Relocs = F->getRelocations();
+      for (size_t I = 0, E = Relocs.size(); I != E; ++I) {
+        const WasmRelocation &Rel = Relocs[I];
+        if (Rel.Type != R_WEBASSEMBLY_TYPE_INDEX_LEB ||
+            Content[Rel.Offset - 1] != OPCODE_CALL_INDIRECT)
+          continue;
+        auto It = BySignature.find(Types[Rel.Index]);
+        if (It == BySignature.end() || !It->second.Unique)
+          continue;
+        DefinedFunction *Target = It->second.Target;
+
+        // The i32.const immediate is a 5-byte padded SLEB that ends at the
+        // call_indirect opcode.
+        if (I > 0 && Relocs[I - 1].Type == R_WEBASSEMBLY_TABLE_INDEX_SLEB &&
+            Relocs[I - 1].Offset + 6 == Rel.Offset &&
+            Content[Relocs[I - 1].Offset - 1] == OPCODE_I32_CONST) {
+          DefinedFunction *Const =
+              getTableTarget(File->getFunctionSymbol(Relocs[I - 1].Index));
+          if (Const && Const->Function == Target->Function) {
+            F->Rewrites[I - 1] = {CallRewrite::DropIndex, Target, nullptr};
+            F->Rewrites[I] = {CallRewrite::Direct, Target, nullptr};
+            ++NumDirect;
+            continue;
+          }
+        }
+
+        SyntheticFunction *&Guard = GuardOf[Target->Function];
+        if (!Guard)
+          Guard = createGuard(Target);
+        F->Rewrites[I] = {CallRewrite::Guarded, Target, Guard};
+        ++NumGuarded;
+      }
+    }
+  }
+  log("--devirtualize: " + Twine(NumDirect) + " direct and " +
+      Twine(NumGuarded) + " guarded calls");
+}
+
+void lld::wasm::writeCallGuards() {
+  for (const auto &P : Guards) {
+    SyntheticFunction *Guard = P.first;
+    const DefinedFunction *Target = P.second;
+    uint32_t NumParams = Target->Function->Signature.ParamTypes.size();
+
+    std::string BodyContent;
+    {
+      raw_string_ostream OS(BodyContent);
+      writeUleb128(OS, 0, "num locals");
+
+      // If every use of the target's table index was removed, the target
+      // left the table, and a call through any index would have trapped.
+      if (Target->hasTableIndex()) {
+        writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
+        writeUleb128(OS, NumParams, "table index");
+        writeU8(OS, OPCODE_I32_CONST, "I32_CONST");
+        writeSleb128(OS, Target->getTableIndex(), "target table index");
+        writeU8(OS, OPCODE_I32_NE, "I32_NE");
+        writeU8(OS, OPCODE_IF, "IF");
+        writeU8(OS, WASM_TYPE_NORESULT, "no result");
+        writeU8(OS, OPCODE_UNREACHABLE, "UNREACHABLE");
+        writeU8(OS, OPCODE_END, "END");
+        for (uint32_t I = 0; I < NumParams; ++I) {
+          writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
+          writeUleb128(OS, I, "argument");
+        }
+        writeU8(OS, OPCODE_CALL, "CALL");
+        writeUleb128(OS, Target->getFunctionIndex(), "function index");
+      } else {
+        writeU8(OS, OPCODE_UNREACHABLE, "UNREACHABLE");
+      }
+      writeU8(OS, OPCODE_END, "END");
+    }
+
+    std::string FunctionBody;
+    {
+      raw_string_ostream OS(FunctionBody);
+      writeUleb128(OS, BodyContent.size(), "function size");
+      OS << BodyContent;
+    }
+    Guard->setBody(toArrayRef(Saver.save(FunctionBody)));
+  }
+}
@@ -0,0 +1,28 @@
+//===- Devirtualize.h -------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_DEVIRTUALIZE_H
+#define LLD_WASM_DEVIRTUALIZE_H
+
+namespace lld {
+namespace wasm {
+
+// Turns the call_indirect instructions of live functions whose signature
+// matches a single table entry into direct calls.  Must run after garbage
+// collection and before the writer assigns table indices.
+void devirtualizeCalls();
+
+// Writes the bodies of the guard functions created by devirtualizeCalls.
+// Must run once function and table indices are assigned.
+void writeCallGuards();
+
+} // namespace wasm
+} // namespace lld
+
+#endif // LLD_WASM_DEVIRTUALIZE_H
@@ -0,0 +1,198 @@
+//===- Dispatch.cpp -------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Helpers for the generated Snax dispatcher.
+//
+// The dispatcher calls each handler with (receiver, code), and the handlers
+// generated for actions are often wrappers that only forward those two
+// values to the real implementation.  With --snax-inline-dispatch such a
+// wrapper is written into the dispatcher in place of the call to it.  Its
+// parameters are the dispatcher's locals 0 and 1, so the body can be copied
+// as is once its call targets are rewritten.  Only straight-line bodies with
+// no locals are accepted, built from a few instructions that cannot branch
+// or return out of the dispatcher.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Dispatch.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "WriterUtils.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/LEB128.h"
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+std::vector<StringRef> lld::wasm::getDispatchHandlerNames() {
+  std::vector<StringRef> Names;
+  DenseSet<StringRef> Seen;
+  auto Add = [&](StringRef Name) {
+    if (Seen.insert(Name).second)
+      Names.push_back(Name);
+  };
+
+  for (const ObjFile *Obj : Symtab->ObjectFiles) {
+    // <action>:<generated_dispatch_func>
+    for (StringRef Act : Obj->getSnaxActions())
+      Add(Act.substr(Act.find(':') + 1));
+    // <code_name>::<action>:<generated_notify_dispatch_func>
+    for (StringRef Not : Obj->getSnaxNotify()) {
+      StringRef Sub = Not.substr(Not.find(':') + 2);
+      Add(Sub.substr(Sub.find(':') + 1));
+    }
+  }
+  return Names;
+}
+
+ArrayRef<StringRef> lld::wasm::getDispatcherCallees() {
+  static const StringRef Names[] = {"__wasm_call_ctors", "pre_dispatch",
+                                    "snax_assert_code", "post_dispatch",
+                                    "__cxa_finalize"};
+  return Names;
+}
+
+namespace {
+enum : uint8_t {
+  OPCODE_CALL = 0x10,
+  OPCODE_DROP = 0x1a,
+  OPCODE_END = 0x0b,
+  OPCODE_GET_LOCAL = 0x20,
+  OPCODE_I32_CONST = 0x41,
+  OPCODE_I64_CONST = 0x42,
+};
+
+struct Instr {
+  uint8_t Opcode;
+  int64_t Imm;
+  const WasmRelocation *Reloc;
+};
+} // namespace
+
+// Bodies with more instructions than this are left as calls.
+static const size_t MaxInlineInstrs = 8;
+
+// Decodes the body of F into Out.  Returns false if F cannot be inlined.
+static bool decodeHandler(const InputFunction *F, std::vector<Instr> &Out) {
+  static const WasmSignature HandlerSig = {{WASM_TYPE_I64, WASM_TYPE_I64},
+                                           WASM_TYPE_NORESULT};
+  if (!F->File || !(F->Signature == HandlerSig))
+    return false;
+
+  ArrayRef<uint8_t> Body = F->getInputBody();
+  const uint8_t *P = Body.begin();
+  const uint8_t *End = Body.end();
+  const char *Err = nullptr;
+  unsigned N;
+
+  auto ReadULEB = [&]() -> uint64_t {
+    uint64_t V = decodeULEB128(P, &N, End, &Err);
+    P += N;
+    return V;
+  };
+  auto ReadSLEB = [&]() -> int64_t {
+    int64_t V = decodeSLEB128(P, &N, End, &Err);
+    P += N;
+    return V;
+  };
+
+  ReadULEB(); // body size
+  if (Err || ReadULEB() != 0 || Err)
+    return false; // has locals
+
+  // Every relocation must be the target of one of the calls.
+  ArrayRef<WasmRelocation> Relocs = F->getRelocations();
+  size_t NextReloc = 0;
+
+  while (P < End) {
+    uint8_t Op = *P++;
+    Instr I = {Op, 0, nullptr};
+    switch (Op) {
+    case OPCODE_END:
+      // Only the end of the function itself is allowed.
+      if (P != End)
+        return false;
+      return NextReloc == Relocs.size();
+    case OPCODE_DROP:
+      break;
+    case OPCODE_GET_LOCAL:
+      I.Imm = ReadULEB();
+      if (I.Imm > 1)
+        return false;
+      break;
+    case OPCODE_I32_CONST:
+    case OPCODE_I64_CONST:
+    case OPCODE_CALL: {
+      uint32_t ImmOffset = F->getFunctionInputOffset() + (P - Body.begin());
+      bool HasReloc = NextReloc < Relocs.size() &&
+                      Relocs[NextReloc].Offset == ImmOffset;
+      if (Op == OPCODE_CALL) {
+        if (!HasReloc ||
+            Relocs[NextReloc].Type != R_WEBASSEMBLY_FUNCTION_INDEX_LEB)
+          return false;
+        I.Reloc = &Relocs[NextReloc++];
+        ReadULEB();
+      } else {
+        // Constants holding addresses are not final yet.
+        if (HasReloc)
+          return false;
+        I.Imm = ReadSLEB();
+      }
+      break;
+    }
+    default:
+      return false;
+    }
+    if (Err || Out.size() == MaxInlineInstrs)
+      return false;
+    Out.push_back(I);
+  }
+  return false;
+}
+
+InputFunction *lld::wasm::getInlinableHandler(const Symbol *Sym) {
+  if (!Config->InlineDispatch)
+    return nullptr;
+  auto *F = dyn_cast_or_null<DefinedFunction>(Sym);
+  if (!F || !F->Function)
+    return nullptr;
+  std::vector<Instr> Instrs;
+  if (!decodeHandler(F->Function, Instrs))
+    return nullptr;
+  return F->Function;
+}
+
+void lld::wasm::writeInlinedHandler(raw_ostream &OS,
+                                    const InputFunction *F) {
+  std::vector<Instr> Instrs;
+  bool Decoded = decodeHandler(F, Instrs);
+  assert(Decoded && "handler is not inlinable");
+  (void)Decoded;
+
+  for (const Instr &I : Instrs) {
+    writeU8(OS, I.Opcode, "opcode");
+    switch (I.Opcode) {
+    case OPCODE_CALL:
+      writeUleb128(OS, F->File->calcNewValue(*I.Reloc), "function index");
+      break;
+    case OPCODE_GET_LOCAL:
+      writeUleb128(OS, I.Imm, "local index");
+      break;
+    case OPCODE_I32_CONST:
+    case OPCODE_I64_CONST:
+      encodeSLEB128(I.Imm, OS);
+      break;
+    }
+  }
+}
@@ -0,0 +1,43 @@
+//===- Dispatch.h -----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_DISPATCH_H
+#define LLD_WASM_DISPATCH_H
+
+#include "lld/Common/LLVM.h"
+#include <vector>
+
+namespace lld {
+namespace wasm {
+
+class InputFunction;
+class Symbol;
+
+// Returns the names of the action and notify handlers recorded in the input
+// objects, without duplicates.
+std::vector<StringRef> getDispatchHandlerNames();
+
+// Returns the names of the functions, other than the handlers, that the
+// generated dispatcher calls by index.  Nothing refers to them through a
+// relocation, so anything that follows calls has to add them itself.
+ArrayRef<StringRef> getDispatcherCallees();
+
+// Returns the function defining handler Sym if --snax-inline-dispatch is on
+// and its body is small enough to be written into the dispatcher in place
+// of a call.  Returns nullptr otherwise.
+InputFunction *getInlinableHandler(const Symbol *Sym);
+
+// Writes the body of an inlinable handler, without its final end, with call
+// targets rewritten to output function indices.
+void writeInlinedHandler(raw_ostream &OS, const InputFunction *F);
+
+} // namespace wasm
+} // namespace lld
+
+#endif
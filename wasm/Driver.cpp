@@ -9,6 +9,9 @@
 
 #include "lld/Common/Driver.h"
 #include "Config.h"
+#include "Devirtualize.h"
+#include "FoldGlobals.h"
+#include "ICF.h"
 #include "InputChunks.h"
 #include "InputGlobal.h"
 #include "MarkLive.h"
@@ -16,18 +19,29 @@
 #include "Writer.h"
 #include "lld/Common/Args.h"
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/LinkCache.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/TimeTrace.h"
+#include "lld/Common/Timer.h"
 #include "lld/Common/Version.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Object/Wasm.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
-#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/xxhash.h"
 #include <cstring>
+#include <future>
+#if LLVM_ON_UNIX
+#include <sys/mman.h>
+#endif
 
 #define DEBUG_TYPE "lld"
 
@@ -40,6 +54,9 @@ using namespace lld::wasm;
 
 Configuration *lld::wasm::Config;
 
+static Timer InputFileTimer("Input File Reading", Timer::root());
+static Timer LTOTimer("LTO", Timer::root());
+
 namespace {
 
 // Create enum with OPT_xxx values for each option in Options.td
@@ -50,29 +67,27 @@ enum {
 #undef OPTION
 };
 
-// This function is called on startup. We need this for LTO since
-// LTO calls LLVM functions to compile bitcode files to native code.
-// Technically this can be delayed until we read bitcode files, but
-// we don't bother to do lazily because the initialization is fast.
-static void initLLVM() {
-  InitializeAllTargets();
-  InitializeAllTargetMCs();
-  InitializeAllAsmPrinters();
-  InitializeAllAsmParsers();
-}
-
 class LinkerDriver {
 public:
   void link(ArrayRef<const char *> ArgsArr);
 
 private:
   void createFiles(opt::InputArgList &Args);
-  void addFile(StringRef Path);
-  void addLibrary(StringRef Name);
+  void addFile(MemoryBufferRef MBRef, StringRef Path);
+  std::string getIncrementalState(opt::InputArgList &Args);
+
   std::vector<InputFile *> Files;
+
+  // Paths and content hashes of the inputs, recorded for --incremental.
+  std::vector<std::pair<std::string, uint64_t>> InputHashes;
 };
 } // anonymous namespace
 
+// During a --batch run, the buffers of input files are kept here rather than
+// in the arena so that later links can reuse them.  Inputs are assumed not to
+// change while the batch runs.
+static StringMap<std::unique_ptr<MemoryBuffer>> *BatchBuffers;
+
 bool lld::wasm::link(ArrayRef<const char *> Args, bool CanExitEarly,
                      raw_ostream &Error) {
   errorHandler().LogName = Args[0];
@@ -85,8 +100,9 @@ bool lld::wasm::link(ArrayRef<const char *> Args, bool CanExitEarly,
   Config = make<Configuration>();
   Symtab = make<SymbolTable>();
 
-  initLLVM();
   LinkerDriver().link(Args);
+  if (!Config->TimeTraceFile.empty())
+    writeTimeTrace(Config->TimeTraceFile);
 
   // Exit immediately if we don't need to return to the caller.
   // This saves time because the overhead of calling destructors
@@ -158,7 +174,7 @@ opt::InputArgList WasmOptTable::parse(ArrayRef<const char *> Argv) {
   unsigned MissingCount;
 
   // Expand response files (arguments in the form of @<filename>)
-  cl::ExpandResponseFiles(Saver, cl::TokenizeGNUCommandLine, Vec);
+  args::expandResponseFiles(cl::TokenizeGNUCommandLine, Vec);
 
   opt::InputArgList Args = this->ParseArgs(Vec, MissingIndex, MissingCount);
 
@@ -181,12 +197,38 @@ static void readImportFile(StringRef Filename) {
       Config->AllowUndefinedSymbols.insert(Sym);
 }
 
-void LinkerDriver::addFile(StringRef Path) {
-  Optional<MemoryBufferRef> Buffer = readFile(Path);
-  if (!Buffer.hasValue())
-    return;
-  MemoryBufferRef MBRef = *Buffer;
+// ErrorOr is not default constructible, so it cannot be used as the type
+// parameter of a future.
+typedef std::pair<std::unique_ptr<MemoryBuffer>, std::error_code> MBErrPair;
+
+// Create a std::future that opens and maps a file.  With threads enabled
+// every input is opened on its own thread, so that opening files and
+// faulting in their pages overlaps with the processing of earlier inputs.
+static std::future<MBErrPair> createFutureForFile(std::string Path) {
+  auto Strategy = ThreadsEnabled ? std::launch::async : std::launch::deferred;
+  return std::async(Strategy, [=]() {
+    auto MBOrErr = MemoryBuffer::getFile(Path,
+                                         /*FileSize*/ -1,
+                                         /*RequiresNullTerminator*/ false);
+    if (!MBOrErr)
+      return MBErrPair{nullptr, MBOrErr.getError()};
+
+#if LLVM_ON_UNIX
+    // Ask the kernel to start reading the whole mapping in.
+    MemoryBuffer &MB = **MBOrErr;
+    if (MB.getBufferKind() == MemoryBuffer::MemoryBuffer_MMap) {
+      uintptr_t PageSize = sys::Process::getPageSize();
+      uintptr_t Start = reinterpret_cast<uintptr_t>(MB.getBufferStart());
+      uintptr_t Begin = Start & ~(PageSize - 1);
+      posix_madvise(reinterpret_cast<void *>(Begin),
+                    Start - Begin + MB.getBufferSize(), POSIX_MADV_WILLNEED);
+    }
+#endif
+    return MBErrPair{std::move(*MBOrErr), std::error_code()};
+  });
+}
 
+void LinkerDriver::addFile(MemoryBufferRef MBRef, StringRef Path) {
   switch (identify_magic(MBRef.getBuffer())) {
   case file_magic::archive: {
     SmallString<128> ImportFile = Path;
@@ -205,29 +247,176 @@ void LinkerDriver::addFile(StringRef Path) {
   }
 }
 
-// Add a given library by searching it from input search paths.
-void LinkerDriver::addLibrary(StringRef Name) {
-  for (StringRef Dir : Config->SearchPaths) {
-    if (Optional<std::string> S = findFile(Dir, "lib" + Name + ".a")) {
-      addFile(*S);
-      return;
-    }
-  }
+// Find a given library by searching it from input search paths.
+static Optional<std::string> searchLibrary(StringRef Name) {
+  for (StringRef Dir : Config->SearchPaths)
+    if (Optional<std::string> S = findFile(Dir, "lib" + Name + ".a"))
+      return S;
 
   error("unable to find library -l" + Name);
+  return None;
 }
 
 void LinkerDriver::createFiles(opt::InputArgList &Args) {
+  std::vector<std::string> Paths;
   for (auto *Arg : Args) {
     switch (Arg->getOption().getUnaliasedOption().getID()) {
     case OPT_l:
-      addLibrary(Arg->getValue());
+      if (Optional<std::string> Path = searchLibrary(Arg->getValue()))
+        Paths.push_back(*Path);
       break;
     case OPT_INPUT:
-      addFile(Arg->getValue());
+      Paths.push_back(Arg->getValue());
       break;
     }
   }
+
+  // Start opening all inputs before the first one is processed.  Inputs an
+  // earlier link of the batch has already opened get no future.
+  std::vector<std::future<MBErrPair>> Futures;
+  for (const std::string &Path : Paths) {
+    if (BatchBuffers && BatchBuffers->count(Path))
+      Futures.emplace_back();
+    else
+      Futures.push_back(createFutureForFile(Path));
+  }
+
+  for (size_t I = 0; I < Paths.size(); ++I) {
+    log("Loading: " + Paths[I]);
+    if (!Futures[I].valid()) {
+      MemoryBufferRef MBRef = (*BatchBuffers)[Paths[I]]->getMemBufferRef();
+      if (Config->Incremental)
+        InputHashes.push_back({Paths[I], xxHash64(MBRef.getBuffer())});
+      if (Config->OutputCache)
+        Config->OutputCache->addInput(Paths[I], MBRef);
+      addFile(MBRef, Paths[I]);
+      continue;
+    }
+    MBErrPair MBOrErr = Futures[I].get();
+    if (MBOrErr.second) {
+      error("cannot open " + Paths[I] + ": " + MBOrErr.second.message());
+      continue;
+    }
+    // Take ownership of the buffer.
+    MemoryBufferRef MBRef = MBOrErr.first->getMemBufferRef();
+    if (BatchBuffers && !BatchBuffers->count(Paths[I]))
+      (*BatchBuffers)[Paths[I]] = std::move(MBOrErr.first);
+    else
+      make<std::unique_ptr<MemoryBuffer>>(std::move(MBOrErr.first));
+    InputFileBytes += MBRef.getBufferSize();
+    if (Config->Incremental)
+      InputHashes.push_back({Paths[I], xxHash64(MBRef.getBuffer())});
+    if (Config->OutputCache)
+      Config->OutputCache->addInput(Paths[I], MBRef);
+    addFile(MBRef, Paths[I]);
+  }
+}
+
+// Returns the files a link may write, the output file first. --link-cache
+// stores them and --incremental checks that they are unchanged.
+static std::vector<std::string> getOutputFiles() {
+  std::vector<std::string> V = {Config->OutputFile};
+  if (!Config->MapFile.empty())
+    V.push_back(Config->MapFile);
+  SmallString<64> ABIFile = StringRef(Config->OutputFile);
+  sys::path::replace_extension(ABIFile, ".abi");
+  V.push_back(ABIFile.str());
+  V.push_back((ABIFile.str() + ".bin").str());
+  V.push_back((Config->OutputFile + ".sha256").str());
+  return V;
+}
+
+static Optional<uint64_t> hashFile(StringRef Path) {
+  auto MBOrErr = MemoryBuffer::getFile(Path, /*FileSize*/ -1,
+                                       /*RequiresNullTerminator*/ false);
+  if (!MBOrErr)
+    return None;
+  return xxHash64((*MBOrErr)->getBuffer());
+}
+
+// Describes this link for --incremental: the linker version, the expanded
+// command line and the content hash of every input.  The previous output
+// can be kept if it was produced from the same description.
+std::string LinkerDriver::getIncrementalState(opt::InputArgList &Args) {
+  std::string State;
+  raw_string_ostream OS(State);
+  OS << "wasm-ld incremental 1\n" << getLLDVersion() << "\n";
+  for (opt::Arg *Arg : Args)
+    OS << "arg " << Arg->getAsString(Args) << "\n";
+  for (const std::pair<std::string, uint64_t> &P : InputHashes)
+    OS << "input " << utohexstr(P.second) << " " << P.first << "\n";
+
+  // Options may name files that are read outside of createFiles(), such as
+  // the symbol ordering file, so hash every existing file an option names,
+  // as --link-cache does.
+  std::vector<std::string> Outputs = getOutputFiles();
+  for (opt::Arg *Arg : Args) {
+    unsigned ID = Arg->getOption().getUnaliasedOption().getID();
+    if (ID == OPT_INPUT || ID == OPT_l)
+      continue;
+    for (StringRef Path : Arg->getValues()) {
+      if (is_contained(Outputs, Path) || !sys::fs::is_regular_file(Path))
+        continue;
+      if (Optional<uint64_t> Hash = hashFile(Path))
+        OS << "file " << utohexstr(*Hash) << " " << Path << "\n";
+    }
+  }
+  return OS.str();
+}
+
+static std::string getIncrementalStatePath() {
+  return (Config->OutputFile + ".incremental").str();
+}
+
+// Returns true if the state file next to the output says that the outputs
+// were linked from State, and none of the files that link wrote has been
+// changed or removed since.
+static bool isUpToDate(StringRef State) {
+  auto MBOrErr = MemoryBuffer::getFile(getIncrementalStatePath());
+  if (!MBOrErr)
+    return false;
+  StringRef Saved = (*MBOrErr)->getBuffer();
+  if (!Saved.consume_front(State))
+    return false;
+
+  SmallVector<StringRef, 8> Lines;
+  Saved.split(Lines, '\n', -1, false);
+  if (Lines.empty())
+    return false;
+  for (StringRef Line : Lines) {
+    // output <hash> <path>
+    if (!Line.consume_front("output "))
+      return false;
+    std::pair<StringRef, StringRef> P = Line.split(' ');
+    Optional<uint64_t> Hash = hashFile(P.second);
+    if (!Hash || P.first != utohexstr(*Hash))
+      return false;
+  }
+  return true;
+}
+
+// Records State and the outputs this link wrote.  The output file is always
+// listed first; side files that do not exist, e.g. the .abi file of a module
+// without an ABI, are left out.
+static void writeIncrementalState(StringRef State) {
+  std::string Outputs;
+  raw_string_ostream OS(Outputs);
+  for (const std::string &Path : getOutputFiles()) {
+    Optional<uint64_t> Hash = hashFile(Path);
+    if (!Hash && Path == Config->OutputFile)
+      return;
+    if (Hash)
+      OS << "output " << utohexstr(*Hash) << " " << Path << "\n";
+  }
+
+  std::string Path = getIncrementalStatePath();
+  std::error_code EC;
+  raw_fd_ostream File(Path, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Path + ": " + EC.message());
+    return;
+  }
+  File << State << OS.str();
 }
 
 static StringRef getEntry(opt::InputArgList &Args, StringRef Default) {
@@ -239,6 +428,97 @@ static StringRef getEntry(opt::InputArgList &Args, StringRef Default) {
   return Arg->getValue();
 }
 
+// Parse the symbol ordering file and warn for any duplicate entries.
+static std::vector<StringRef> getSymbolOrderingFile(MemoryBufferRef MB) {
+  SetVector<StringRef> Names;
+  for (StringRef S : args::getLines(MB))
+    if (!Names.insert(S))
+      warn(MB.getBufferIdentifier() + ": duplicate ordered symbol: " + S);
+
+  return Names.takeVector();
+}
+
+// Read a call graph profile of "<caller> <callee> <count>" lines.
+static void readCallGraph(MemoryBufferRef MB) {
+  // Build a map from symbol name to symbol
+  DenseMap<StringRef, const Symbol *> SymbolNameToSymbol;
+  for (ObjFile *File : Symtab->ObjectFiles)
+    for (Symbol *Sym : File->getSymbols())
+      SymbolNameToSymbol[Sym->getName()] = Sym;
+
+  for (StringRef L : args::getLines(MB)) {
+    SmallVector<StringRef, 3> Fields;
+    L.split(Fields, ' ');
+    uint64_t Count;
+    if (Fields.size() != 3 || !to_integer(Fields[2], Count))
+      fatal(MB.getBufferIdentifier() + ": parse error");
+    const Symbol *FromSym = SymbolNameToSymbol.lookup(Fields[0]);
+    const Symbol *ToSym = SymbolNameToSymbol.lookup(Fields[1]);
+    if (!FromSym)
+      warn("call graph file: no such symbol: " + Fields[0]);
+    if (!ToSym)
+      warn("call graph file: no such symbol: " + Fields[1]);
+    if (!FromSym || !ToSym || Count == 0)
+      continue;
+    auto *From = dyn_cast<DefinedFunction>(FromSym);
+    auto *To = dyn_cast<DefinedFunction>(ToSym);
+    if (!From || !To || !From->Function || !To->Function ||
+        !From->Function->File || !To->Function->File)
+      continue;
+    if (From->Function->Live && To->Function->Live)
+      Config->CallGraphProfile[std::make_pair(From->Function, To->Function)] +=
+          Count;
+  }
+}
+
+// With --call-graph-sort, weight every direct call between two live
+// functions from input files by one.  Synthetic functions are always placed
+// first and so are not part of the graph.
+static void buildStaticCallGraph() {
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    for (InputFunction *F : File->Functions) {
+      if (!F->Live)
+        continue;
+      for (const WasmRelocation &Reloc : F->getRelocations()) {
+        if (Reloc.Type != R_WEBASSEMBLY_FUNCTION_INDEX_LEB)
+          continue;
+        auto *Callee = dyn_cast<DefinedFunction>(File->getSymbol(Reloc.Index));
+        if (!Callee || !Callee->Function || !Callee->Function->File)
+          continue;
+        Config->CallGraphProfile[std::make_pair(F, Callee->Function)] += 1;
+      }
+    }
+  }
+}
+
+static BuildIdKind getBuildId(opt::InputArgList &Args) {
+  auto *Arg = Args.getLastArg(OPT_build_id, OPT_build_id_eq);
+  if (!Arg)
+    return BuildIdKind::None;
+
+  if (Arg->getOption().getID() == OPT_build_id)
+    return BuildIdKind::Fast;
+
+  StringRef S = Arg->getValue();
+  if (S == "fast")
+    return BuildIdKind::Fast;
+  if (S == "sha256")
+    return BuildIdKind::Sha256;
+
+  if (S != "none")
+    error("unknown --build-id style: " + S);
+  return BuildIdKind::None;
+}
+
+static ICFLevel getICF(opt::InputArgList &Args) {
+  auto *Arg = Args.getLastArg(OPT_icf_none, OPT_icf_safe, OPT_icf_all);
+  if (!Arg || Arg->getOption().getID() == OPT_icf_none)
+    return ICFLevel::None;
+  if (Arg->getOption().getID() == OPT_icf_safe)
+    return ICFLevel::Safe;
+  return ICFLevel::All;
+}
+
 static const uint8_t UnreachableFn[] = {
     0x03 /* ULEB length */, 0x00 /* ULEB num locals */,
     0x00 /* opcode unreachable */, 0x0b /* opcode end */
@@ -291,10 +571,81 @@ static Symbol *addUndefined(StringRef Name) {
   return S;
 }
 
+// Runs each non-empty line of a --batch file, other than # comments, as the
+// command line of a separate link.  Every link gets a fresh configuration,
+// symbol table and arena.  Only the opened input files are shared between
+// links, so archives and objects common to many links are opened and mapped
+// once.  A fatal error still ends the whole batch.
+static void runBatch(StringRef Path, StringRef Argv0) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = MemoryBuffer::getFile(Path);
+  if (auto EC = MBOrErr.getError()) {
+    error("cannot open " + Path + ": " + EC.message());
+    return;
+  }
+
+  // The arena is freed after every link, so anything that outlives one link
+  // is kept in storage owned by this function.
+  BumpPtrAllocator Alloc;
+  StringSaver JobSaver(Alloc);
+  const char *Name = JobSaver.save(Argv0).data();
+  StringMap<std::unique_ptr<MemoryBuffer>> Buffers;
+  BatchBuffers = &Buffers;
+
+  SmallVector<StringRef, 0> Lines;
+  (*MBOrErr)->getBuffer().split(Lines, '\n', -1, false);
+  unsigned NumJobs = 0;
+  unsigned NumFailed = 0;
+  for (StringRef Line : Lines) {
+    Line = Line.trim();
+    if (Line.empty() || Line.startswith("#"))
+      continue;
+
+    SmallVector<const char *, 32> JobArgs = {Name};
+    cl::TokenizeGNUCommandLine(Line, JobSaver, JobArgs);
+
+    Config = make<Configuration>();
+    Symtab = make<SymbolTable>();
+    WasmSym::EntryFunc = nullptr;
+    WasmSym::CallCtors = nullptr;
+    WasmSym::DsoHandle = nullptr;
+    WasmSym::DataEnd = nullptr;
+    WasmSym::HeapBase = nullptr;
+    WasmSym::StackPointer = nullptr;
+
+    LinkerDriver().link(JobArgs);
+    if (!Config->TimeTraceFile.empty())
+      writeTimeTrace(Config->TimeTraceFile);
+
+    ++NumJobs;
+    if (errorCount())
+      ++NumFailed;
+    errorHandler().resetErrorCount();
+    freeArena();
+  }
+  BatchBuffers = nullptr;
+
+  // Config and Symtab pointed into the arena that was just freed.
+  Config = make<Configuration>();
+  Symtab = make<SymbolTable>();
+  if (NumFailed)
+    error(Twine(NumFailed) + " of " + Twine(NumJobs) + " links failed");
+}
+
 void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   WasmOptTable Parser;
   opt::InputArgList Args = Parser.parse(ArgsArr.slice(1));
 
+  // Handle --batch before anything else; the remaining options are ignored.
+  if (auto *Arg = Args.getLastArg(OPT_batch)) {
+    if (BatchBuffers) {
+      error("--batch cannot be used inside a batch file");
+      return;
+    }
+    std::string Path = Arg->getValue();
+    runBatch(Path, ArgsArr[0]);
+    return;
+  }
+
   // Handle --help
   if (Args.hasArg(OPT_help)) {
     Parser.PrintHelp(outs(), ArgsArr[0], "LLVM Linker", false);
@@ -307,6 +658,21 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
     return;
   }
 
+  // Start --time-trace before the root timer so that the trace covers the
+  // whole link.
+  Config->TimeTraceFile = Args.getLastArgValue(OPT_time_trace_eq);
+  if (!Config->TimeTraceFile.empty())
+    startTimeTrace();
+
+  // Open the counters before the root timer starts and before any thread
+  // is created, so that they cover the whole link.
+  if (Args.hasArg(OPT_time_counters))
+    Timer::enableCounters();
+
+  // A --batch run links many times, so drop the times of the last link.
+  Timer::root().reset();
+  ScopedTimer T(Timer::root());
+
   // Parse and evaluate -mllvm options.
   std::vector<const char *> V;
   V.push_back("wasm-ld (LLVM option parsing)");
@@ -317,17 +683,32 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   errorHandler().ErrorLimit = args::getInteger(Args, OPT_error_limit, 20);
 
   Config->AllowUndefined = Args.hasArg(OPT_allow_undefined);
+  Config->AutoStackSize = Args.hasArg(OPT_auto_stack_size);
+  Config->BuildId = getBuildId(Args);
+  Config->CallGraphSort = Args.hasArg(OPT_call_graph_sort);
+  Config->BinaryABI = Args.hasArg(OPT_snax_binary_abi);
+  Config->ContractLTO = Args.hasArg(OPT_snax_contract_lto);
   Config->Demangle = Args.hasFlag(OPT_demangle, OPT_no_demangle, true);
   Config->DisableVerify = Args.hasArg(OPT_disable_verify);
+  Config->DispatchSection = Args.hasArg(OPT_snax_dispatch_section);
+  Config->FunctionHashes = Args.hasArg(OPT_snax_function_hashes);
+  Config->EvalCtors = Args.hasArg(OPT_snax_eval_ctors);
+  Config->InlineDispatch = Args.hasArg(OPT_snax_inline_dispatch);
   Config->Entry = getEntry(Args, Args.hasArg(OPT_relocatable) ? "" : "_start");
   Config->ExportAll = Args.hasArg(OPT_export_all);
   Config->ExportTable = Args.hasArg(OPT_export_table);
   errorHandler().FatalWarnings =
       Args.hasFlag(OPT_fatal_warnings, OPT_no_fatal_warnings, false);
+  Config->Devirtualize = Args.hasArg(OPT_devirtualize);
+  Config->FoldGlobals = Args.hasArg(OPT_fold_globals);
+  Config->ICF = getICF(Args);
   Config->ImportMemory = Args.hasArg(OPT_import_memory);
+  Config->Incremental =
+      Args.hasFlag(OPT_incremental, OPT_no_incremental, false);
   Config->ImportTable = Args.hasArg(OPT_import_table);
   Config->LTOO = args::getInteger(Args, OPT_lto_O, 2);
   Config->LTOPartitions = args::getInteger(Args, OPT_lto_partitions, 1);
+  Config->MapFile = Args.getLastArgValue(OPT_Map);
   Config->Optimize = args::getInteger(Args, OPT_O, 0);
   Config->OutputFile = Args.getLastArgValue(OPT_o);
   Config->Relocatable = Args.hasArg(OPT_relocatable);
@@ -336,9 +717,18 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   Config->MergeDataSegments =
       Args.hasFlag(OPT_merge_data_segments, OPT_no_merge_data_segments,
                    !Config->Relocatable);
+  Config->PrintActionCost = Args.hasArg(OPT_print_action_cost);
+  Config->PrintActionFootprint = Args.hasArg(OPT_print_action_footprint);
   Config->PrintGcSections =
       Args.hasFlag(OPT_print_gc_sections, OPT_no_print_gc_sections, false);
+  Config->PrintIcfSections =
+      Args.hasFlag(OPT_print_icf_sections, OPT_no_print_icf_sections, false);
+  Config->PrintMemoryUsage = Args.hasArg(OPT_print_memory_usage);
+  Config->PruneNameSection = Args.hasArg(OPT_prune_name_section);
   Config->SaveTemps = Args.hasArg(OPT_save_temps);
+  Config->ShowTiming = Args.hasArg(OPT_time, OPT_time_counters);
+  Config->SortImports = Args.hasArg(OPT_sort_imports);
+  Config->SortTable = Args.hasArg(OPT_sort_table_by_signature);
   Config->SearchPaths = args::getStrings(Args, OPT_L);
   Config->StripAll = Args.hasArg(OPT_strip_all);
   Config->StripDebug = Args.hasArg(OPT_strip_debug);
@@ -349,11 +739,21 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
       "--thinlto-cache-policy: invalid cache policy");
   Config->ThinLTOJobs = args::getInteger(Args, OPT_thinlto_jobs, -1u);
   errorHandler().Verbose = Args.hasArg(OPT_verbose);
-  ThreadsEnabled = Args.hasFlag(OPT_threads, OPT_no_threads, true);
+  ThreadsEnabled =
+      Args.hasFlag(OPT_threads, OPT_threads_eq, OPT_no_threads, true);
+  ThreadCount = 0;
+  if (Args.hasArg(OPT_threads_eq)) {
+    int N = args::getInteger(Args, OPT_threads_eq, 0);
+    if (N <= 0)
+      error("--threads: number of threads must be > 0");
+    else
+      ThreadCount = N;
+  }
 
   Config->InitialMemory = args::getInteger(Args, OPT_initial_memory, 0);
   Config->GlobalBase = args::getInteger(Args, OPT_global_base, 1024);
   Config->MaxMemory = args::getInteger(Args, OPT_max_memory, 0);
+  Config->SplitZeroRuns = args::getInteger(Args, OPT_split_zero_runs, 0);
   Config->ZStackSize =
       args::getZOptionValue(Args, OPT_z, "stack-size", WasmPageSize);
 
@@ -369,6 +769,10 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   if (auto *Arg = Args.getLastArg(OPT_allow_undefined_file))
     readImportFile(Arg->getValue());
 
+  if (auto *Arg = Args.getLastArg(OPT_symbol_ordering_file))
+    if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
+      Config->SymbolOrderingFile = getSymbolOrderingFile(*Buffer);
+
   if (!Args.hasArg(OPT_INPUT)) {
     error("no input files");
     return;
@@ -380,11 +784,31 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   if (Config->ImportTable && Config->ExportTable)
     error("--import-table and --export-table may not be used together");
 
+  if (Config->InlineDispatch && Config->DispatchSection)
+    error("--snax-inline-dispatch and --snax-dispatch-section may not be used "
+          "together");
+
   if (Config->Relocatable) {
     if (!Config->Entry.empty())
       error("entry point specified for relocatable output file");
     if (Config->GcSections)
       error("-r and --gc-sections may not be used together");
+    if (Config->ICF != ICFLevel::None)
+      error("-r and --icf may not be used together");
+    if (Config->SplitZeroRuns)
+      error("-r and --split-zero-runs may not be used together");
+    if (Config->EvalCtors)
+      error("-r and --snax-eval-ctors may not be used together");
+    if (Config->FoldGlobals)
+      error("-r and --fold-globals may not be used together");
+    if (Config->Devirtualize)
+      error("-r and --devirtualize may not be used together");
+    if (Config->AutoStackSize)
+      error("-r and --auto-stack-size may not be used together");
+    if (Config->ContractLTO)
+      error("-r and --snax-contract-lto may not be used together");
+    if (Config->BuildId != BuildIdKind::None)
+      error("-r and --build-id may not be used together");
     if (Args.hasArg(OPT_undefined))
       error("-r -and --undefined may not be used together");
   }
@@ -431,16 +855,53 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
       addUndefined(Arg->getValue());
   }
 
+  // Inputs are recorded for --link-cache as they are read, so the cache has
+  // to be set up before any input is opened.  Output written to stdout
+  // cannot be stored or restored.
+  if (auto *Arg = Args.getLastArg(OPT_link_cache))
+    if (Config->OutputFile != "-")
+      Config->OutputCache = make<LinkCache>(
+          Arg->getValue(),
+          CHECK(parseCachePruningPolicy(
+                    Args.getLastArgValue(OPT_link_cache_policy)),
+                "--link-cache-policy: invalid cache policy"),
+          Args);
+
+  ScopedTimer InputTimer(InputFileTimer);
   createFiles(Args);
   if (errorCount())
     return;
 
+  // Reuse the result of an identical earlier link if there is one.
+  if (Config->OutputCache && Config->OutputCache->fetch(getOutputFiles()))
+    return;
+
+  std::string IncrementalState;
+  if (Config->Incremental) {
+    IncrementalState = getIncrementalState(Args);
+    if (isUpToDate(IncrementalState)) {
+      log("incremental: " + Config->OutputFile + " is up to date");
+      return;
+    }
+  }
+
+  // Decode all object files up front in parallel.  Adding them to the symbol
+  // table stays serial and in command line order so that symbol resolution
+  // is deterministic.
+  parallelForEach(Files, [](InputFile *F) {
+    if (auto *Obj = dyn_cast<ObjFile>(F))
+      Obj->readObject();
+  });
+
   // Add all files to the symbol table. This will add almost all
   // symbols that we need to the symbol table.
   for (InputFile *F : Files)
     Symtab->addFile(F);
   if (errorCount())
     return;
+  InputTimer.stop();
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("reading input files");
 
   // Add synthetic dummies for weak undefined functions.
   if (!Config->Relocatable)
@@ -455,9 +916,13 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
 
   // Do link-time optimization if given files are LLVM bitcode files.
   // This compiles bitcode files into real object files.
+  ScopedTimer LTOT(LTOTimer);
   Symtab->addCombinedLTOObject();
   if (errorCount())
     return;
+  LTOT.stop();
+  if (Config->PrintMemoryUsage && !Symtab->BitcodeFiles.empty())
+    printMemoryUsage("LTO");
 
   // Make sure we have resolved all symbols.
   if (!Config->Relocatable && !Config->AllowUndefined) {
@@ -523,6 +988,41 @@ void LinkerDriver::link(ArrayRef<const char *> ArgsArr) {
   // Do size optimizations: garbage collection
   markLive();
 
+  // Fold identical functions.
+  if (Config->ICF != ICFLevel::None)
+    doIcf();
+
+  // Replace globals that are never written with constants.
+  if (Config->FoldGlobals)
+    foldGlobals();
+
+  // Turn indirect calls with a single possible target into direct calls.
+  if (Config->Devirtualize)
+    devirtualizeCalls();
+
+  // Read the callgraph now that we know what was gced or icfed
+  if (auto *Arg = Args.getLastArg(OPT_call_graph_ordering_file)) {
+    if (Optional<MemoryBufferRef> Buffer = readFile(Arg->getValue()))
+      readCallGraph(*Buffer);
+  } else if (Config->CallGraphSort) {
+    buildStaticCallGraph();
+  }
+
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("section optimizations");
+
   // Write the result to the file.
   writeResult(true);
+  if (Config->PrintMemoryUsage)
+    printMemoryUsage("writing the output");
+
+  if (Config->Incremental && !errorCount())
+    writeIncrementalState(IncrementalState);
+  if (Config->OutputCache && !errorCount())
+    Config->OutputCache->store(getOutputFiles());
+
+  // Stop early so we can print the results.
+  Timer::root().stop();
+  if (Config->ShowTiming)
+    Timer::root().print();
 }
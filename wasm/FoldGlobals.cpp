@@ -0,0 +1,118 @@
+//===- FoldGlobals.cpp ----------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implements --fold-globals.  The compiler has to read a global with
+// global.get even if no function ever writes it, because it cannot see the
+// other translation units.  At link time, after garbage collection, all code
+// is known, so a global can be replaced by its initial value if
+//
+//  - it is defined by an input file with an i32.const or i64.const
+//    initializer,
+//  - it is not exported, and
+//  - no live function writes it with global.set.
+//
+// Each global.get of such a global becomes an i32.const or i64.const, and
+// the global is left out of the output.  Global index relocations are 5-byte
+// padded LEBs that directly follow the one-byte global.get opcode, so the
+// constant instruction fits in the same 6 bytes: the opcode is replaced and
+// the relocation is written as a padded SLEB.  i64 globals are only folded if
+// their value fits in 32 bits, as that is all a relocation value can hold.
+//
+//===----------------------------------------------------------------------===//
+
+#include "FoldGlobals.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputGlobal.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseSet.h"
+
+#define DEBUG_TYPE "lld"
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+static Timer FoldGlobalsTimer("Fold Globals", Timer::root());
+
+// Returns true if G has a constant initializer that a global.get can be
+// replaced with.
+static bool hasFoldableInit(const InputGlobal *G) {
+  const WasmGlobal &Global = G->Global;
+  const WasmInitExpr &Init = Global.InitExpr;
+  switch (Global.Type.Type) {
+  case WASM_TYPE_I32:
+    return Init.Opcode == WASM_OPCODE_I32_CONST;
+  case WASM_TYPE_I64:
+    return Init.Opcode == WASM_OPCODE_I64_CONST &&
+           Init.Value.Int64 == static_cast<int32_t>(Init.Value.Int64);
+  default:
+    return false;
+  }
+}
+
+// Returns true if Sym is written to the export section by the Writer.
+static bool isExported(const Symbol *Sym) {
+  return !Sym->isLocal() && (!Sym->isHidden() || Config->ExportAll);
+}
+
+void lld::wasm::foldGlobals() {
+  ScopedTimer T(FoldGlobalsTimer);
+
+  DenseSet<const InputGlobal *> Unfoldable;
+
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    for (const Symbol *Sym : File->getSymbols())
+      if (auto *G = dyn_cast_or_null<DefinedGlobal>(Sym))
+        if (G->Global && isExported(G))
+          Unfoldable.insert(G->Global);
+
+    // Only a global.get can be rewritten. Any other use of a global index,
+    // e.g. a global.set or a reference from a non-code section, keeps the
+    // global.
+    auto MarkUses = [&](const InputChunk *C, bool IsCode) {
+      for (const WasmRelocation &Rel : C->getRelocations()) {
+        if (Rel.Type != R_WEBASSEMBLY_GLOBAL_INDEX_LEB)
+          continue;
+        auto *G = dyn_cast<DefinedGlobal>(File->getGlobalSymbol(Rel.Index));
+        if (!G || !G->Global)
+          continue;
+        if (!IsCode || Rel.Offset == 0 ||
+            File->CodeSection->Content[Rel.Offset - 1] !=
+                WASM_OPCODE_GET_GLOBAL)
+          Unfoldable.insert(G->Global);
+      }
+    };
+    for (const InputFunction *F : File->Functions)
+      if (F->Live)
+        MarkUses(F, true);
+    for (const InputSegment *S : File->Segments)
+      if (S->Live)
+        MarkUses(S, false);
+    for (const InputSection *S : File->CustomSections)
+      MarkUses(S, false);
+  }
+
+  size_t NumFolded = 0;
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    for (InputGlobal *G : File->Globals) {
+      if (!G->Live || Unfoldable.count(G) || !hasFoldableInit(G))
+        continue;
+      LLVM_DEBUG(dbgs() << "fold global: " << toString(G) << "\n");
+      G->Folded = true;
+      G->Live = false;
+      ++NumFolded;
+    }
+  }
+  log("--fold-globals: folded " + Twine(NumFolded) + " globals");
+}
@@ -0,0 +1,23 @@
+//===- FoldGlobals.h --------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_FOLD_GLOBALS_H
+#define LLD_WASM_FOLD_GLOBALS_H
+
+namespace lld {
+namespace wasm {
+
+// Replaces reads of defined globals that are never written and not exported
+// with their initial values, and removes the globals from the output.
+void foldGlobals();
+
+} // namespace wasm
+} // namespace lld
+
+#endif // LLD_WASM_FOLD_GLOBALS_H
@@ -0,0 +1,401 @@
+//===- ICF.cpp ------------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// ICF is short for Identical Code Folding.  This file implements it for wasm
+// functions using the same algorithm as the ELF port (see ELF/ICF.cpp for a
+// detailed description).  Functions are partitioned into equivalence classes
+// by their signature, body bytes and relocations, and the classes are then
+// refined by comparing relocation targets until a fixed point is reached.
+// Every function in a class is finally replaced with the first member.
+//
+// Unlike ELF sections, the bodies of wasm functions contain input-file
+// specific indices at their relocation sites (padded LEBs holding function,
+// type or global indices).  Those bytes are therefore skipped when comparing
+// contents; the relocations themselves are compared instead:
+//
+//  - type index relocations are equal if the referenced signatures are,
+//  - function index and table index relocations are equal if they refer to
+//    the same symbol or to functions in the same equivalence class,
+//  - all other relocations must refer to the same symbol with the same
+//    addend.
+//
+// With --icf=safe functions whose address is taken (that is, that are the
+// target of a table index relocation) are never folded, so that distinct
+// functions keep distinct function pointers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ICF.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include <algorithm>
+#include <atomic>
+
+#define DEBUG_TYPE "lld"
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+static Timer ICFTimer("ICF", Timer::root());
+
+namespace {
+class ICF {
+public:
+  void run();
+
+private:
+  void segregate(size_t Begin, size_t End, bool Constant);
+
+  bool equalsConstant(const InputFunction *A, const InputFunction *B);
+  bool equalsVariable(const InputFunction *A, const InputFunction *B);
+
+  size_t findBoundary(size_t Begin, size_t End);
+
+  void forEachClassRange(size_t Begin, size_t End,
+                         std::function<void(size_t, size_t)> Fn);
+
+  void forEachClass(std::function<void(size_t, size_t)> Fn);
+
+  std::vector<InputFunction *> Functions;
+
+  // We repeat the main loop while `Repeat` is true.
+  std::atomic<bool> Repeat;
+
+  // The main loop counter.
+  int Cnt = 0;
+
+  // Indices of the current and next equivalence class slots.  See the
+  // comment in ELF/ICF.cpp for why two slots are needed.
+  int Current = 0;
+  int Next = 0;
+};
+} // namespace
+
+// Returns the number of bytes at the relocation site of Rel.
+static unsigned getRelocWidth(const WasmRelocation &Rel) {
+  switch (Rel.Type) {
+  case R_WEBASSEMBLY_TABLE_INDEX_I32:
+  case R_WEBASSEMBLY_MEMORY_ADDR_I32:
+  case R_WEBASSEMBLY_FUNCTION_OFFSET_I32:
+  case R_WEBASSEMBLY_SECTION_OFFSET_I32:
+    return 4;
+  default:
+    return 5;
+  }
+}
+
+// Calls Fn on each region of the body of F that is not covered by a
+// relocation site.
+template <typename FnT>
+static void forEachFixedRegion(const InputFunction *F, FnT Fn) {
+  ArrayRef<uint8_t> Body = F->getInputBody();
+  uint32_t Start = F->getFunctionInputOffset();
+  uint32_t Pos = 0;
+  for (const WasmRelocation &Rel : F->getRelocations()) {
+    uint32_t Off = Rel.Offset - Start;
+    Fn(Pos, Body.slice(Pos, Off - Pos));
+    Pos = Off + getRelocWidth(Rel);
+  }
+  Fn(Pos, Body.slice(Pos));
+}
+
+// Returns a hash value for F.  Relocation targets are not included.
+static uint32_t getHash(const InputFunction *F) {
+  hash_code H = hash_combine(
+      F->Signature.ReturnType,
+      hash_combine_range(F->Signature.ParamTypes.begin(),
+                         F->Signature.ParamTypes.end()),
+      F->getInputBody().size(), F->NumRelocations());
+  forEachFixedRegion(F, [&](uint32_t, ArrayRef<uint8_t> Region) {
+    H = hash_combine(H, hash_combine_range(Region.begin(), Region.end()));
+  });
+  return H;
+}
+
+// Returns true if the wasm function F is subject of ICF.
+static bool isEligible(InputFunction *F) {
+  // Synthetic functions have no input file and their bodies are generated
+  // after ICF has run.
+  if (!F->Live || F->KeepUnique || !F->File || isa<SyntheticFunction>(F))
+    return false;
+  return true;
+}
+
+// Split an equivalence class into smaller classes.
+void ICF::segregate(size_t Begin, size_t End, bool Constant) {
+  while (Begin < End) {
+    // Divide [Begin, End) into two. Let Mid be the start index of the
+    // second group.
+    auto Bound = std::stable_partition(
+        Functions.begin() + Begin + 1, Functions.begin() + End,
+        [&](InputFunction *F) {
+          if (Constant)
+            return equalsConstant(Functions[Begin], F);
+          return equalsVariable(Functions[Begin], F);
+        });
+    size_t Mid = Bound - Functions.begin();
+
+    // Now we split [Begin, End) into [Begin, Mid) and [Mid, End) by
+    // updating the functions in [Begin, Mid). We use Mid as an equivalence
+    // class ID because every group ends with a unique index.
+    for (size_t I = Begin; I < Mid; ++I)
+      Functions[I]->Class[Next] = Mid;
+
+    // If we created a group, we need to iterate the main loop again.
+    if (Mid != End)
+      Repeat = true;
+
+    Begin = Mid;
+  }
+}
+
+// Compare the "non-moving" part of two functions, namely everything except
+// the equivalence classes of the functions they refer to.
+bool ICF::equalsConstant(const InputFunction *A, const InputFunction *B) {
+  if (A->Signature != B->Signature ||
+      A->getInputBody().size() != B->getInputBody().size() ||
+      A->NumRelocations() != B->NumRelocations())
+    return false;
+
+  ArrayRef<WasmRelocation> RA = A->getRelocations();
+  ArrayRef<WasmRelocation> RB = B->getRelocations();
+  uint32_t StartA = A->getFunctionInputOffset();
+  uint32_t StartB = B->getFunctionInputOffset();
+
+  for (size_t I = 0; I < RA.size(); ++I) {
+    if (RA[I].Type != RB[I].Type ||
+        RA[I].Offset - StartA != RB[I].Offset - StartB)
+      return false;
+
+    if (RA[I].Type == R_WEBASSEMBLY_TYPE_INDEX_LEB) {
+      if (A->File->getWasmObj()->types()[RA[I].Index] !=
+          B->File->getWasmObj()->types()[RB[I].Index])
+        return false;
+      continue;
+    }
+
+    Symbol *SA = A->File->getSymbol(RA[I].Index);
+    Symbol *SB = B->File->getSymbol(RB[I].Index);
+    if (RA[I].Addend != RB[I].Addend)
+      return false;
+    if (SA == SB)
+      continue;
+
+    // Different function symbols may still be equal if their functions
+    // are; that is checked by equalsVariable.
+    switch (RA[I].Type) {
+    case R_WEBASSEMBLY_FUNCTION_INDEX_LEB:
+    case R_WEBASSEMBLY_TABLE_INDEX_SLEB:
+    case R_WEBASSEMBLY_TABLE_INDEX_I32:
+      if (isa<DefinedFunction>(SA) && isa<DefinedFunction>(SB))
+        continue;
+      return false;
+    default:
+      return false;
+    }
+  }
+
+  // The relocation sites line up, so the fixed regions of both bodies do
+  // too.
+  ArrayRef<uint8_t> BodyB = B->getInputBody();
+  bool Equal = true;
+  forEachFixedRegion(A, [&](uint32_t Pos, ArrayRef<uint8_t> Region) {
+    if (Equal && Region != BodyB.slice(Pos, Region.size()))
+      Equal = false;
+  });
+  return Equal;
+}
+
+// Compare the "moving" part of two functions, namely the functions that
+// their relocations refer to.
+bool ICF::equalsVariable(const InputFunction *A, const InputFunction *B) {
+  ArrayRef<WasmRelocation> RA = A->getRelocations();
+  ArrayRef<WasmRelocation> RB = B->getRelocations();
+
+  for (size_t I = 0; I < RA.size(); ++I) {
+    if (RA[I].Type == R_WEBASSEMBLY_TYPE_INDEX_LEB)
+      continue;
+    Symbol *SA = A->File->getSymbol(RA[I].Index);
+    Symbol *SB = B->File->getSymbol(RB[I].Index);
+    if (SA == SB)
+      continue;
+
+    // equalsConstant has already made sure these are defined functions.
+    InputFunction *X = cast<DefinedFunction>(SA)->Function;
+    InputFunction *Y = cast<DefinedFunction>(SB)->Function;
+    if (X == Y)
+      continue;
+
+    // Ineligible functions are in the special equivalence class 0.
+    // They can never be the same in terms of the equivalence class.
+    if (X->Class[Current] == 0)
+      return false;
+    if (X->Class[Current] != Y->Class[Current])
+      return false;
+  }
+
+  return true;
+}
+
+size_t ICF::findBoundary(size_t Begin, size_t End) {
+  uint32_t Class = Functions[Begin]->Class[Current];
+  for (size_t I = Begin + 1; I < End; ++I)
+    if (Class != Functions[I]->Class[Current])
+      return I;
+  return End;
+}
+
+// Functions in the same equivalence class are contiguous in the Functions
+// vector.  This function calls Fn on every group within [Begin, End).
+void ICF::forEachClassRange(size_t Begin, size_t End,
+                            std::function<void(size_t, size_t)> Fn) {
+  while (Begin < End) {
+    size_t Mid = findBoundary(Begin, End);
+    Fn(Begin, Mid);
+    Begin = Mid;
+  }
+}
+
+// Call Fn on each equivalence class.
+void ICF::forEachClass(std::function<void(size_t, size_t)> Fn) {
+  // If threading is disabled or the number of functions is too small to
+  // use threading, call Fn sequentially.
+  if (!ThreadsEnabled || Functions.size() < 1024) {
+    forEachClassRange(0, Functions.size(), Fn);
+    ++Cnt;
+    return;
+  }
+
+  Current = Cnt % 2;
+  Next = (Cnt + 1) % 2;
+
+  // Shard into non-overlapping intervals, and call Fn in parallel.  The
+  // sharding must be completed before any calls to Fn are made so that Fn
+  // can modify the functions in its shard without causing data races.
+  const size_t NumShards = 256;
+  size_t Step = Functions.size() / NumShards;
+  size_t Boundaries[NumShards + 1];
+  Boundaries[0] = 0;
+  Boundaries[NumShards] = Functions.size();
+
+  parallelForEachN(1, NumShards, [&](size_t I) {
+    Boundaries[I] = findBoundary((I - 1) * Step, Functions.size());
+  });
+
+  parallelForEachN(1, NumShards + 1, [&](size_t I) {
+    if (Boundaries[I - 1] < Boundaries[I])
+      forEachClassRange(Boundaries[I - 1], Boundaries[I], Fn);
+  });
+  ++Cnt;
+}
+
+static void print(const Twine &S) {
+  if (Config->PrintIcfSections)
+    message(S);
+}
+
+// The main function of ICF.
+void ICF::run() {
+  ScopedTimer T(ICFTimer);
+
+  // With --icf=safe, functions whose address is taken keep their identity.
+  if (Config->ICF == ICFLevel::Safe) {
+    auto MarkAddressTaken = [](InputChunk *Chunk) {
+      if (!Chunk->Live)
+        return;
+      for (const WasmRelocation &Rel : Chunk->getRelocations()) {
+        if (Rel.Type != R_WEBASSEMBLY_TABLE_INDEX_SLEB &&
+            Rel.Type != R_WEBASSEMBLY_TABLE_INDEX_I32)
+          continue;
+        if (auto *F = dyn_cast<DefinedFunction>(
+                Chunk->File->getSymbol(Rel.Index)))
+          if (F->Function)
+            F->Function->KeepUnique = true;
+      }
+    };
+    for (ObjFile *File : Symtab->ObjectFiles) {
+      for (InputChunk *Chunk : File->Functions)
+        MarkAddressTaken(Chunk);
+      for (InputChunk *Chunk : File->Segments)
+        MarkAddressTaken(Chunk);
+    }
+  }
+
+  // Collect functions to merge.
+  for (ObjFile *File : Symtab->ObjectFiles)
+    for (InputFunction *F : File->Functions)
+      if (isEligible(F))
+        Functions.push_back(F);
+
+  // Initially, we use hash values to partition functions.
+  parallelForEach(Functions, [&](InputFunction *F) {
+    // Set MSB to 1 to avoid collisions with non-hash IDs.
+    F->Class[0] = getHash(F) | (1U << 31);
+  });
+
+  // From now on, functions in the Functions vector are ordered so that
+  // functions in the same equivalence class are consecutive in the vector.
+  std::stable_sort(Functions.begin(), Functions.end(),
+                   [](InputFunction *A, InputFunction *B) {
+                     return A->Class[0] < B->Class[0];
+                   });
+
+  // Compare static contents and assign unique IDs for each static content.
+  forEachClass([&](size_t Begin, size_t End) { segregate(Begin, End, true); });
+
+  // Split groups by comparing relocations until convergence is obtained.
+  do {
+    Repeat = false;
+    forEachClass(
+        [&](size_t Begin, size_t End) { segregate(Begin, End, false); });
+  } while (Repeat);
+
+  log("ICF needed " + Twine(Cnt) + " iterations");
+
+  // Merge functions by the equivalence class.
+  DenseMap<InputFunction *, InputFunction *> Replacements;
+  forEachClassRange(0, Functions.size(), [&](size_t Begin, size_t End) {
+    if (End - Begin == 1)
+      return;
+    print("selected function " + toString(Functions[Begin]));
+    for (size_t I = Begin + 1; I < End; ++I) {
+      print("  removing identical function " + toString(Functions[I]));
+      Functions[I]->Live = false;
+      Replacements[Functions[I]] = Functions[Begin];
+    }
+  });
+
+  if (Replacements.empty())
+    return;
+
+  // Point every symbol that was defined by a folded function at the
+  // function it was folded into.
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    for (Symbol *Sym : File->getSymbols()) {
+      auto *F = dyn_cast<DefinedFunction>(Sym);
+      if (!F || !F->Function)
+        continue;
+      auto It = Replacements.find(F->Function);
+      if (It != Replacements.end())
+        F->Function = It->second;
+    }
+  }
+}
+
+// ICF entry point function.
+void lld::wasm::doIcf() { ICF().run(); }
@@ -0,0 +1,21 @@
+//===- ICF.h ----------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_ICF_H
+#define LLD_WASM_ICF_H
+
+namespace lld {
+namespace wasm {
+
+void doIcf();
+
+} // namespace wasm
+} // namespace lld
+
+#endif // LLD_WASM_ICF_H
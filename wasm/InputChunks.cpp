@@ -8,11 +8,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "InputChunks.h"
+#include "BuildId.h"
 #include "Config.h"
+#include "InputGlobal.h"
 #include "OutputSegment.h"
+#include "Symbols.h"
 #include "WriterUtils.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/LLVM.h"
+#include "lld/Common/Strings.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/LEB128.h"
 
 #define DEBUG_TYPE "lld"
@@ -23,6 +28,13 @@ using namespace llvm::support::endian;
 using namespace lld;
 using namespace lld::wasm;
 
+namespace {
+enum : uint8_t {
+  OPCODE_NOP = 0x01,
+  OPCODE_CALL = 0x10,
+};
+} // namespace
+
 static StringRef ReloctTypeToString(uint8_t RelocType) {
   switch (RelocType) {
 #define WASM_RELOC(NAME, REL) case REL: return #NAME;
@@ -43,14 +55,17 @@ StringRef InputChunk::getComdatName() const {
   return File->getWasmObj()->linkingData().Comdats[Index];
 }
 
-void InputChunk::copyRelocations(const WasmSection &Section) {
-  if (Section.Relocations.empty())
+void InputChunk::setRelocations(ArrayRef<WasmRelocation> Relocs) {
+  if (Relocs.empty())
     return;
-  size_t Start = getInputSectionOffset();
-  size_t Size = getInputSize();
-  for (const WasmRelocation &R : Section.Relocations)
-    if (R.Offset >= Start && R.Offset < Start + Size)
-      Relocations.push_back(R);
+  uint32_t Start = getInputSectionOffset();
+  uint32_t End = Start + getInputSize();
+  auto Less = [](const WasmRelocation &R, uint32_t Off) {
+    return R.Offset < Off;
+  };
+  auto Begin = std::lower_bound(Relocs.begin(), Relocs.end(), Start, Less);
+  auto Last = std::lower_bound(Begin, Relocs.end(), End, Less);
+  Relocations = makeArrayRef(Begin, Last);
 }
 
 void InputChunk::verifyRelocTargets() const {
@@ -90,6 +105,53 @@ void InputChunk::verifyRelocTargets() const {
   }
 }
 
+void InputChunk::resolveRelocations() {
+  RelocValues.resize(Relocations.size());
+  FoldedOpcodes.clear();
+  for (size_t I = 0, E = Relocations.size(); I != E; ++I) {
+    const WasmRelocation &Rel = Relocations[I];
+    if (const CallRewrite *RW = getRewrite(I)) {
+      switch (RW->K) {
+      case CallRewrite::DropIndex:
+        RelocValues[I] = 0;
+        break;
+      case CallRewrite::Direct:
+        RelocValues[I] = RW->Target->getFunctionIndex();
+        break;
+      case CallRewrite::Guarded:
+        RelocValues[I] = RW->Guard->getFunctionIndex();
+        break;
+      }
+      continue;
+    }
+    if (Rel.Type == R_WEBASSEMBLY_GLOBAL_INDEX_LEB) {
+      // A read of a folded global is replaced by its initial value.
+      auto *G = dyn_cast<DefinedGlobal>(File->getGlobalSymbol(Rel.Index));
+      if (G && G->Global && G->Global->Folded) {
+        const WasmInitExpr &Init = G->Global->Global.InitExpr;
+        if (FoldedOpcodes.empty())
+          FoldedOpcodes.resize(E);
+        FoldedOpcodes[I] = Init.Opcode;
+        RelocValues[I] = Init.Opcode == WASM_OPCODE_I32_CONST
+                             ? Init.Value.Int32
+                             : static_cast<int32_t>(Init.Value.Int64);
+        continue;
+      }
+    }
+    RelocValues[I] = File->calcNewValue(Rel);
+  }
+}
+
+// Writes a LEB128 value padded to 5 bytes.  Passing the value sign- or
+// zero-extended to 64 bits yields the SLEB or ULEB encoding respectively.
+static void writePaddedLEB(uint8_t *Loc, int64_t Value) {
+  Loc[0] = (Value & 0x7f) | 0x80;
+  Loc[1] = ((Value >> 7) & 0x7f) | 0x80;
+  Loc[2] = ((Value >> 14) & 0x7f) | 0x80;
+  Loc[3] = ((Value >> 21) & 0x7f) | 0x80;
+  Loc[4] = (Value >> 28) & 0x7f;
+}
+
 // Copy this input chunk to an mmap'ed output file and apply relocations.
 void InputChunk::writeTo(uint8_t *Buf) const {
   // Copy contents
@@ -105,26 +167,51 @@ void InputChunk::writeTo(uint8_t *Buf) const {
 
   LLVM_DEBUG(dbgs() << "applying relocations: " << getName()
                     << " count=" << Relocations.size() << "\n");
-  int32_t Off = OutputOffset - getInputSectionOffset();
+  applyRelocations(Buf + OutputOffset - getInputSectionOffset());
+}
 
-  for (const WasmRelocation &Rel : Relocations) {
-    uint8_t *Loc = Buf + Rel.Offset + Off;
-    uint32_t Value = File->calcNewValue(Rel);
+// Writes the resolved relocation values to a copy of the chunk's input data.
+// Base is where the start of the input section would be in that copy.
+void InputChunk::applyRelocations(uint8_t *Base) const {
+  assert(RelocValues.size() == Relocations.size());
+  for (size_t I = 0, E = Relocations.size(); I != E; ++I) {
+    const WasmRelocation &Rel = Relocations[I];
+    uint8_t *Loc = Base + Rel.Offset;
+    uint32_t Value = RelocValues[I];
     LLVM_DEBUG(dbgs() << "apply reloc: type=" << ReloctTypeToString(Rel.Type)
                       << " addend=" << Rel.Addend << " index=" << Rel.Index
                       << " value=" << Value << " offset=" << Rel.Offset
                       << "\n");
 
+    if (uint8_t Opcode = getFoldedOpcode(I)) {
+      Loc[-1] = Opcode;
+      writePaddedLEB(Loc, static_cast<int32_t>(Value));
+      continue;
+    }
+
+    // A removed i32.const becomes six nops.  A devirtualized call_indirect
+    // becomes a call, and its table immediate a nop.
+    if (const CallRewrite *RW = getRewrite(I)) {
+      if (RW->K == CallRewrite::DropIndex) {
+        memset(Loc - 1, OPCODE_NOP, 6);
+      } else {
+        Loc[-1] = OPCODE_CALL;
+        writePaddedLEB(Loc, Value);
+        Loc[5] = OPCODE_NOP;
+      }
+      continue;
+    }
+
     switch (Rel.Type) {
     case R_WEBASSEMBLY_TYPE_INDEX_LEB:
     case R_WEBASSEMBLY_FUNCTION_INDEX_LEB:
     case R_WEBASSEMBLY_GLOBAL_INDEX_LEB:
     case R_WEBASSEMBLY_MEMORY_ADDR_LEB:
-      encodeULEB128(Value, Loc, 5);
+      writePaddedLEB(Loc, Value);
       break;
     case R_WEBASSEMBLY_TABLE_INDEX_SLEB:
     case R_WEBASSEMBLY_MEMORY_ADDR_SLEB:
-      encodeSLEB128(static_cast<int32_t>(Value), Loc, 5);
+      writePaddedLEB(Loc, static_cast<int32_t>(Value));
       break;
     case R_WEBASSEMBLY_TABLE_INDEX_I32:
     case R_WEBASSEMBLY_MEMORY_ADDR_I32:
@@ -138,10 +225,37 @@ void InputChunk::writeTo(uint8_t *Buf) const {
   }
 }
 
-// Copy relocation entries to a given output stream.
+static bool hasAddend(uint32_t Type) {
+  switch (Type) {
+  case R_WEBASSEMBLY_MEMORY_ADDR_LEB:
+  case R_WEBASSEMBLY_MEMORY_ADDR_SLEB:
+  case R_WEBASSEMBLY_MEMORY_ADDR_I32:
+  case R_WEBASSEMBLY_FUNCTION_OFFSET_I32:
+  case R_WEBASSEMBLY_SECTION_OFFSET_I32:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Returns the number of bytes writeRelocations writes.
+size_t InputChunk::getRelocationsSize() const {
+  int32_t Off = OutputOffset - getInputSectionOffset();
+  size_t Size = 0;
+  for (const WasmRelocation &Rel : Relocations) {
+    Size += getULEB128Size(Rel.Type);
+    Size += getULEB128Size(uint32_t(Rel.Offset + Off));
+    Size += getULEB128Size(File->calcNewIndex(Rel));
+    if (hasAddend(Rel.Type))
+      Size += getSLEB128Size(int32_t(File->calcNewAddend(Rel)));
+  }
+  return Size;
+}
+
+// Copy relocation entries to a given buffer.
 // This function is used only when a user passes "-r". For a regular link,
 // we consume relocations instead of copying them to an output file.
-void InputChunk::writeRelocations(raw_ostream &OS) const {
+void InputChunk::writeRelocations(uint8_t *Buf) const {
   if (Relocations.empty())
     return;
 
@@ -150,22 +264,63 @@ void InputChunk::writeRelocations(raw_ostream &OS) const {
                     << " offset=" << Twine(Off) << "\n");
 
   for (const WasmRelocation &Rel : Relocations) {
-    writeUleb128(OS, Rel.Type, "reloc type");
-    writeUleb128(OS, Rel.Offset + Off, "reloc offset");
-    writeUleb128(OS, File->calcNewIndex(Rel), "reloc index");
+    Buf += encodeULEB128(Rel.Type, Buf);
+    Buf += encodeULEB128(uint32_t(Rel.Offset + Off), Buf);
+    Buf += encodeULEB128(File->calcNewIndex(Rel), Buf);
+    if (hasAddend(Rel.Type))
+      Buf += encodeSLEB128(int32_t(File->calcNewAddend(Rel)), Buf);
+  }
+}
 
-    switch (Rel.Type) {
-    case R_WEBASSEMBLY_MEMORY_ADDR_LEB:
-    case R_WEBASSEMBLY_MEMORY_ADDR_SLEB:
-    case R_WEBASSEMBLY_MEMORY_ADDR_I32:
-    case R_WEBASSEMBLY_FUNCTION_OFFSET_I32:
-    case R_WEBASSEMBLY_SECTION_OFFSET_I32:
-      writeSleb128(OS, File->calcNewAddend(Rel), "reloc addend");
-      break;
-    }
+uint32_t InputSegment::getVA(uint32_t Offset) const {
+  if (MergedInto)
+    return MergedInto->getVA(getMergedOffset(Offset));
+  return OutputSeg->StartVA + OutputSegmentOffset + Offset;
+}
+
+// Clang places each string literal in its own ".rodata..L.str*" segment,
+// or all of them in ".rodata.str*" without -fdata-sections.
+bool InputSegment::isMergeableString() const {
+  StringRef Name = getName();
+  if (!Name.startswith(".rodata.str") && !Name.startswith(".rodata..L.str"))
+    return false;
+
+  // Wide strings contain NUL bytes within each character, so only byte
+  // aligned strings can be split at NULs.
+  ArrayRef<uint8_t> Data = data();
+  return getAlignment() <= 1 && Relocations.empty() && !Data.empty() &&
+         Data.back() == 0;
+}
+
+// Split the segment into NUL-terminated strings.  isMergeableString
+// guarantees that the last byte is a NUL.
+void InputSegment::splitIntoPieces() {
+  ArrayRef<uint8_t> Data = data();
+  size_t Off = 0;
+  while (Off < Data.size()) {
+    const void *End = memchr(Data.data() + Off, 0, Data.size() - Off);
+    Pieces.emplace_back(Off);
+    Off = static_cast<const uint8_t *>(End) - Data.data() + 1;
   }
 }
 
+StringRef InputSegment::getPieceData(size_t I) const {
+  size_t Begin = Pieces[I].InputOff;
+  size_t End = (I + 1 == Pieces.size()) ? data().size() : Pieces[I + 1].InputOff;
+  return toStringRef(data().slice(Begin, End - Begin));
+}
+
+// Translate an offset within this segment to the corresponding offset within
+// the merged segment.
+uint32_t InputSegment::getMergedOffset(uint32_t Offset) const {
+  assert(MergedInto && !Pieces.empty());
+  auto It = std::upper_bound(
+      Pieces.begin(), Pieces.end(), Offset,
+      [](uint32_t Off, const SegmentPiece &P) { return Off < P.InputOff; });
+  --It;
+  return It->OutputOff + (Offset - It->InputOff);
+}
+
 void InputFunction::setFunctionIndex(uint32_t Index) {
   LLVM_DEBUG(dbgs() << "InputFunction::setFunctionIndex: " << getName()
                     << " -> " << Index << "\n");
@@ -180,10 +335,24 @@ void InputFunction::setTableIndex(uint32_t Index) {
   TableIndex = Index;
 }
 
+// The body of a stubbed out function: its size, no locals, unreachable, end.
+const uint8_t InputFunction::StubBody[4] = {3, 0, 0x00, 0x0b};
+
+std::vector<uint8_t> InputFunction::getRelocatedBody() const {
+  ArrayRef<uint8_t> Body = getInputBody();
+  std::vector<uint8_t> Ret(Body.begin(), Body.end());
+  if (!Relocations.empty())
+    applyRelocations(Ret.data() - getInputSectionOffset());
+  return Ret;
+}
+
 // Write a relocation value without padding and return the number of bytes
-// witten.
+// witten.  Folded global reads are written as the signed constant they were
+// replaced with.
 static unsigned writeCompressedReloc(uint8_t *Buf, const WasmRelocation &Rel,
-                                     uint32_t Value) {
+                                     uint32_t Value, bool Folded) {
+  if (Folded)
+    return encodeSLEB128(static_cast<int32_t>(Value), Buf);
   switch (Rel.Type) {
   case R_WEBASSEMBLY_TYPE_INDEX_LEB:
   case R_WEBASSEMBLY_FUNCTION_INDEX_LEB:
@@ -212,9 +381,10 @@ static unsigned getRelocWidthPadded(const WasmRelocation &Rel) {
   }
 }
 
-static unsigned getRelocWidth(const WasmRelocation &Rel, uint32_t Value) {
+static unsigned getRelocWidth(const WasmRelocation &Rel, uint32_t Value,
+                              bool Folded) {
   uint8_t Buf[5];
-  return writeCompressedReloc(Buf, Rel, Value);
+  return writeCompressedReloc(Buf, Rel, Value, Folded);
 }
 
 // Relocations of type LEB and SLEB in the code section are padded to 5 bytes
@@ -242,10 +412,24 @@ void InputFunction::calculateSize() {
   uint32_t End = Start + Function->Size;
 
   uint32_t LastRelocEnd = Start + FunctionSizeLength;
-  for (WasmRelocation &Rel : Relocations) {
+  for (size_t I = 0, E = Relocations.size(); I != E; ++I) {
+    const WasmRelocation &Rel = Relocations[I];
     LLVM_DEBUG(dbgs() << "  region: " << (Rel.Offset - LastRelocEnd) << "\n");
     CompressedFuncSize += Rel.Offset - LastRelocEnd;
-    CompressedFuncSize += getRelocWidth(Rel, File->calcNewValue(Rel));
+
+    // See writeTo for the compressed form of rewritten instructions.
+    if (const CallRewrite *RW = getRewrite(I)) {
+      if (RW->K == CallRewrite::DropIndex) {
+        CompressedFuncSize -= 1;
+        LastRelocEnd = Rel.Offset + 5;
+      } else {
+        CompressedFuncSize += getULEB128Size(RelocValues[I]);
+        LastRelocEnd = Rel.Offset + 6;
+      }
+      continue;
+    }
+    CompressedFuncSize +=
+        getRelocWidth(Rel, RelocValues[I], getFoldedOpcode(I));
     LastRelocEnd = Rel.Offset + getRelocWidthPadded(Rel);
   }
   LLVM_DEBUG(dbgs() << "  final region: " << (End - LastRelocEnd) << "\n");
@@ -260,9 +444,87 @@ void InputFunction::calculateSize() {
   LLVM_DEBUG(dbgs() << "  calculateSize  new: " << CompressedSize << "\n");
 }
 
+std::array<uint8_t, 32> InputFunction::getContentHash() const {
+  if (Stubbed)
+    return sha256(StubBody);
+  if (!File)
+    return sha256(data());
+
+  // Each piece of the normalized body is tagged with its length or kind so
+  // that different bodies cannot run together into the same bytes.  Values
+  // are written unpadded, so the hash does not depend on -O.
+  std::string Str;
+  raw_string_ostream OS(Str);
+  OS << toString(Signature);
+  auto WriteName = [&](uint8_t Kind, StringRef Name) {
+    OS << Kind;
+    encodeULEB128(Name.size(), OS);
+    OS << Name;
+  };
+
+  const uint8_t *SecStart = File->CodeSection->Content.data();
+  const uint8_t *Start = SecStart + getInputSectionOffset();
+  const uint8_t *End = Start + Function->Size;
+  uint32_t Count;
+  decodeULEB128(Start, &Count);
+  Start += Count;
+
+  const uint8_t *LastRelocEnd = Start;
+  for (size_t I = 0, E = Relocations.size(); I != E; ++I) {
+    const WasmRelocation &Rel = Relocations[I];
+    const uint8_t *Loc = SecStart + Rel.Offset;
+
+    // The opcode of a rewritten instruction is left out of the raw bytes.
+    const CallRewrite *RW = getRewrite(I);
+    uint8_t Opcode = getFoldedOpcode(I);
+    const uint8_t *ChunkEnd = (RW || Opcode) ? Loc - 1 : Loc;
+    encodeULEB128(ChunkEnd - LastRelocEnd, OS);
+    OS << toStringRef(makeArrayRef(LastRelocEnd, ChunkEnd));
+    LastRelocEnd = Loc + getRelocWidthPadded(Rel);
+
+    if (RW) {
+      if (RW->K == CallRewrite::Direct)
+        WriteName(OPCODE_CALL, RW->Target->getName());
+      else if (RW->K == CallRewrite::Guarded)
+        WriteName(OPCODE_CALL, RW->Guard->getName());
+      if (RW->K != CallRewrite::DropIndex)
+        ++LastRelocEnd;
+      continue;
+    }
+    if (Opcode) {
+      OS << Opcode;
+      encodeSLEB128(static_cast<int32_t>(RelocValues[I]), OS);
+      continue;
+    }
+
+    OS << static_cast<uint8_t>(Rel.Type);
+    switch (Rel.Type) {
+    case R_WEBASSEMBLY_FUNCTION_INDEX_LEB:
+      WriteName(0, File->getFunctionSymbol(Rel.Index)->getName());
+      break;
+    case R_WEBASSEMBLY_GLOBAL_INDEX_LEB:
+      WriteName(0, File->getGlobalSymbol(Rel.Index)->getName());
+      break;
+    case R_WEBASSEMBLY_TYPE_INDEX_LEB:
+      WriteName(0, toString(File->getWasmObj()->types()[Rel.Index]));
+      break;
+    default:
+      encodeULEB128(RelocValues[I], OS);
+      break;
+    }
+  }
+  encodeULEB128(End - LastRelocEnd, OS);
+  OS << toStringRef(makeArrayRef(LastRelocEnd, End));
+  return sha256(toArrayRef(OS.str()));
+}
+
 // Override the default writeTo method so that we can (optionally) write the
 // compressed version of the function.
 void InputFunction::writeTo(uint8_t *Buf) const {
+  if (Stubbed) {
+    memcpy(Buf + OutputOffset, StubBody, sizeof(StubBody));
+    return;
+  }
   if (!File || !Config->CompressRelocTargets)
     return InputChunk::writeTo(Buf);
 
@@ -279,12 +541,32 @@ void InputFunction::writeTo(uint8_t *Buf) const {
   LLVM_DEBUG(dbgs() << "write func: " << getName() << "\n");
   Buf += encodeULEB128(CompressedFuncSize, Buf);
   const uint8_t *LastRelocEnd = FuncStart;
-  for (const WasmRelocation &Rel : Relocations) {
+  for (size_t I = 0, E = Relocations.size(); I != E; ++I) {
+    const WasmRelocation &Rel = Relocations[I];
     unsigned ChunkSize = (SecStart + Rel.Offset) - LastRelocEnd;
     LLVM_DEBUG(dbgs() << "  write chunk: " << ChunkSize << "\n");
     memcpy(Buf, LastRelocEnd, ChunkSize);
     Buf += ChunkSize;
-    Buf += writeCompressedReloc(Buf, Rel, File->calcNewValue(Rel));
+
+    // A removed i32.const is left out along with its opcode, and a
+    // devirtualized call_indirect is written as a call without the table
+    // immediate.
+    if (const CallRewrite *RW = getRewrite(I)) {
+      if (RW->K == CallRewrite::DropIndex) {
+        --Buf;
+        LastRelocEnd = SecStart + Rel.Offset + 5;
+      } else {
+        Buf[-1] = OPCODE_CALL;
+        Buf += encodeULEB128(RelocValues[I], Buf);
+        LastRelocEnd = SecStart + Rel.Offset + 6;
+      }
+      continue;
+    }
+
+    uint8_t Opcode = getFoldedOpcode(I);
+    if (Opcode)
+      Buf[-1] = Opcode;
+    Buf += writeCompressedReloc(Buf, Rel, RelocValues[I], Opcode);
     LastRelocEnd = SecStart + Rel.Offset + getRelocWidthPadded(Rel);
   }
 
@@ -24,7 +24,9 @@
 #include "Config.h"
 #include "InputFiles.h"
 #include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Object/Wasm.h"
+#include <array>
 
 using llvm::object::WasmSection;
 using llvm::object::WasmSegment;
@@ -39,9 +41,38 @@ class raw_ostream;
 namespace lld {
 namespace wasm {
 
+class FunctionSymbol;
+class InputFunction;
 class ObjFile;
 class OutputSegment;
 
+// An instruction that --devirtualize rewrites, identified by the relocation
+// of its immediate.
+struct CallRewrite {
+  enum Kind : uint8_t {
+    // An i32.const of the table index of Target whose only use is the
+    // Direct call_indirect right after it.  The instruction is removed.
+    DropIndex,
+    // A call_indirect of Target that becomes a call of Target.
+    Direct,
+    // A call_indirect of an unknown index that becomes a call of Guard,
+    // which traps unless the index is that of Target and then calls it.
+    Guarded,
+  };
+
+  Kind K;
+  const FunctionSymbol *Target;
+  const InputFunction *Guard;
+};
+
+// A NUL-terminated piece of a mergeable string segment.
+struct SegmentPiece {
+  SegmentPiece(uint32_t Off) : InputOff(Off) {}
+
+  uint32_t InputOff;
+  uint32_t OutputOff = 0;
+};
+
 class InputChunk {
 public:
   enum Kind { DataSegment, Function, SyntheticFunction, Section };
@@ -50,7 +81,14 @@ public:
 
   virtual uint32_t getSize() const { return data().size(); }
 
-  void copyRelocations(const WasmSection &Section);
+  // Points this chunk at the subrange of Relocs that falls within it.  Relocs
+  // must be sorted by offset and outlive the chunk.
+  void setRelocations(ArrayRef<WasmRelocation> Relocs);
+
+  // Computes the final value of each relocation.  Must be called once all
+  // indices and addresses have been assigned and before the chunk is sized or
+  // written.
+  void resolveRelocations();
 
   virtual void writeTo(uint8_t *SectionStart) const;
 
@@ -62,7 +100,20 @@ public:
   StringRef getComdatName() const;
 
   size_t NumRelocations() const { return Relocations.size(); }
-  void writeRelocations(llvm::raw_ostream &OS) const;
+  size_t getRelocationsSize() const;
+  void writeRelocations(uint8_t *Buf) const;
+
+  // Returns how --devirtualize rewrites the instruction of the I-th
+  // relocation, or null if it is left alone.
+  const CallRewrite *getRewrite(size_t I) const {
+    if (Rewrites.empty())
+      return nullptr;
+    auto It = Rewrites.find(I);
+    return It == Rewrites.end() ? nullptr : &It->second;
+  }
+
+  // Set by --devirtualize, keyed by relocation index.
+  llvm::DenseMap<uint32_t, CallRewrite> Rewrites;
 
   ObjFile *File;
   int32_t OutputOffset = 0;
@@ -80,11 +131,25 @@ protected:
   virtual uint32_t getInputSectionOffset() const = 0;
   virtual uint32_t getInputSize() const { return getSize(); };
 
+  // Writes the values computed by resolveRelocations() into a copy of the
+  // input data whose input section would start at Base.
+  void applyRelocations(uint8_t *Base) const;
+
+  uint8_t getFoldedOpcode(size_t I) const {
+    return FoldedOpcodes.empty() ? 0 : FoldedOpcodes[I];
+  }
+
   // Verifies the existing data at relocation targets matches our expectations.
   // This is performed only debug builds as an extra sanity check.
   void verifyRelocTargets() const;
 
-  std::vector<WasmRelocation> Relocations;
+  ArrayRef<WasmRelocation> Relocations;
+  // Values of Relocations, in the same order, set by resolveRelocations().
+  std::vector<uint32_t> RelocValues;
+  // For global index relocations of globals removed by --fold-globals, the
+  // opcode of the constant instruction that replaces the global.get, and 0
+  // for all other relocations.  Empty if no relocation is folded.
+  std::vector<uint8_t> FoldedOpcodes;
   Kind SectionKind;
 };
 
@@ -108,9 +173,24 @@ public:
   StringRef getDebugName() const override { return StringRef(); }
   uint32_t getComdat() const override { return Segment.Data.Comdat; }
 
+  // Returns the output virtual address of the byte at Offset within this
+  // segment.
+  uint32_t getVA(uint32_t Offset) const;
+
+  // Mergeable string segments are split into pieces which are deduplicated
+  // across all input files and written out as part of a single synthetic
+  // segment (MergedInto) instead of this one.
+  bool isMergeableString() const;
+  void splitIntoPieces();
+  StringRef getPieceData(size_t I) const;
+  uint32_t getMergedOffset(uint32_t Offset) const;
+
   const OutputSegment *OutputSeg = nullptr;
   int32_t OutputSegmentOffset = 0;
 
+  std::vector<SegmentPiece> Pieces;
+  InputSegment *MergedInto = nullptr;
+
 protected:
   ArrayRef<uint8_t> data() const override { return Segment.Data.Content; }
   uint32_t getInputSectionOffset() const override {
@@ -139,6 +219,8 @@ public:
   uint32_t getFunctionInputOffset() const { return getInputSectionOffset(); }
   uint32_t getFunctionCodeOffset() const { return Function->CodeOffset; }
   uint32_t getSize() const override {
+    if (Stubbed)
+      return sizeof(StubBody);
     if (Config->CompressRelocTargets && File) {
       assert(CompressedSize);
       return CompressedSize;
@@ -158,8 +240,33 @@ public:
   // called.
   void calculateSize();
 
+  // The uncompressed body of the function as it appears in the input file.
+  // Unlike data(), this is usable regardless of CompressRelocTargets.
+  ArrayRef<uint8_t> getInputBody() const {
+    return File->CodeSection->Content.slice(getInputSectionOffset(),
+                                            Function->Size);
+  }
+
+  // The input body with the final relocation values applied and the padding
+  // of LEB relocation targets kept.  Requires resolveRelocations().
+  std::vector<uint8_t> getRelocatedBody() const;
+
+  // Returns the SHA-256 of the final body with the indices of functions,
+  // globals and types replaced by their names and signatures, so that it
+  // does not change when the function is linked into another module or
+  // other functions are added.  Requires resolveRelocations().
+  std::array<uint8_t, 32> getContentHash() const;
+
+  // Replaces the body with a single unreachable instruction.  Used for
+  // constructors that were run at link time and have no other users.
+  void stubOut() { Stubbed = true; }
+
   const WasmSignature &Signature;
 
+  // Used by ICF.
+  uint32_t Class[2] = {0, 0};
+  bool KeepUnique = false;
+
 protected:
   ArrayRef<uint8_t> data() const override {
     assert(!Config->CompressRelocTargets);
@@ -178,6 +285,9 @@ protected:
   llvm::Optional<uint32_t> TableIndex;
   uint32_t CompressedFuncSize = 0;
   uint32_t CompressedSize = 0;
+  bool Stubbed = false;
+
+  static const uint8_t StubBody[4];
 };
 
 class SyntheticFunction : public InputFunction {
@@ -197,6 +307,7 @@ public:
   uint32_t getComdat() const override { return UINT32_MAX; }
 
   void setBody(ArrayRef<uint8_t> Body_) { Body = Body_; }
+  ArrayRef<uint8_t> getBody() const { return Body; }
 
 protected:
   ArrayRef<uint8_t> data() const override { return Body; }
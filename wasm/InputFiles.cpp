@@ -14,7 +14,9 @@
 #include "SymbolTable.h"
 
 #include "lld/Common/ErrorHandler.h"
+#include "lld/Common/LinkCache.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/TargetOptionsCommandFlags.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/Wasm.h"
 #include "llvm/Support/raw_ostream.h"
@@ -38,8 +40,11 @@ Optional<MemoryBufferRef> lld::wasm::readFile(StringRef Path) {
   }
   std::unique_ptr<MemoryBuffer> &MB = *MBOrErr;
   MemoryBufferRef MBRef = MB->getMemBufferRef();
+  InputFileBytes += MBRef.getBufferSize();
   make<std::unique_ptr<MemoryBuffer>>(std::move(MB)); // take MB ownership
 
+  if (Config->OutputCache)
+    Config->OutputCache->addInput(Path, MBRef);
   return MBRef;
 }
 
@@ -128,7 +133,7 @@ uint32_t ObjFile::calcNewValue(const WasmRelocation &Reloc) const {
   case R_WEBASSEMBLY_MEMORY_ADDR_LEB:
     if (auto *Sym = dyn_cast<DefinedData>(getDataSymbol(Reloc.Index)))
       if (Sym->isLive())
-        return Sym->getVirtualAddress() + Reloc.Addend;
+        return Sym->getVirtualAddress(Reloc.Addend);
     return 0;
   case R_WEBASSEMBLY_TYPE_INDEX_LEB:
     return TypeMap[Reloc.Index];
@@ -149,9 +154,12 @@ uint32_t ObjFile::calcNewValue(const WasmRelocation &Reloc) const {
   }
 }
 
-void ObjFile::parse() {
+// Decodes the wasm object.  This neither touches the symbol table nor
+// allocates from the arena, so it is safe to call for many files in
+// parallel before they are added to the symbol table in order.
+void ObjFile::readObject() {
   // Parse a memory buffer as a wasm file.
-  LLVM_DEBUG(dbgs() << "Parsing object: " << toString(this) << "\n");
+  LLVM_DEBUG(dbgs() << "Reading object: " << toString(this) << "\n");
   std::unique_ptr<Binary> Bin = CHECK(createBinary(MB), toString(this));
 
   auto *Obj = dyn_cast<WasmObjectFile>(Bin.get());
@@ -185,33 +193,61 @@ void ObjFile::parse() {
 
   // Find the code and data sections.  Wasm objects can have at most one code
   // and one data section.
-  uint32_t SectionIndex = 0;
   for (const SectionRef &Sec : WasmObj->sections()) {
     const WasmSection &Section = WasmObj->getWasmSection(Sec);
-    if (Section.Type == WASM_SEC_CODE) {
+    if (Section.Type == WASM_SEC_CODE)
       CodeSection = &Section;
-    } else if (Section.Type == WASM_SEC_DATA) {
+    else if (Section.Type == WASM_SEC_DATA)
       DataSection = &Section;
-    } else if (Section.Type == WASM_SEC_CUSTOM) {
+  }
+
+  TypeMap.resize(getWasmObj()->types().size());
+  TypeIsUsed.resize(getWasmObj()->types().size(), false);
+}
+
+ArrayRef<WasmRelocation>
+ObjFile::getSortedRelocations(const WasmSection &Section) {
+  auto Less = [](const WasmRelocation &A, const WasmRelocation &B) {
+    return A.Offset < B.Offset;
+  };
+  if (std::is_sorted(Section.Relocations.begin(), Section.Relocations.end(),
+                     Less))
+    return Section.Relocations;
+  auto *Sorted = make<std::vector<WasmRelocation>>(Section.Relocations);
+  std::stable_sort(Sorted->begin(), Sorted->end(), Less);
+  return *Sorted;
+}
+
+void ObjFile::parse() {
+  // Files on the command line have already been read by the driver, archive
+  // members and LTO output have not.
+  if (!WasmObj)
+    readObject();
+  LLVM_DEBUG(dbgs() << "Parsing object: " << toString(this) << "\n");
+
+  uint32_t SectionIndex = 0;
+  for (const SectionRef &Sec : WasmObj->sections()) {
+    const WasmSection &Section = WasmObj->getWasmSection(Sec);
+    if (Section.Type == WASM_SEC_CUSTOM) {
       CustomSections.emplace_back(make<InputSection>(Section, this));
-      CustomSections.back()->copyRelocations(Section);
+      CustomSections.back()->setRelocations(getSortedRelocations(Section));
       CustomSectionsByIndex[SectionIndex] = CustomSections.back();
     }
     SectionIndex++;
   }
 
-  TypeMap.resize(getWasmObj()->types().size());
-  TypeIsUsed.resize(getWasmObj()->types().size(), false);
-
   ArrayRef<StringRef> Comdats = WasmObj->linkingData().Comdats;
   UsedComdats.resize(Comdats.size());
   for (unsigned I = 0; I < Comdats.size(); ++I)
     UsedComdats[I] = Symtab->addComdat(Comdats[I]);
 
   // Populate `Segments`.
+  ArrayRef<WasmRelocation> DataRelocs;
+  if (DataSection)
+    DataRelocs = getSortedRelocations(*DataSection);
   for (const WasmSegment &S : WasmObj->dataSegments()) {
     InputSegment *Seg = make<InputSegment>(S, this);
-    Seg->copyRelocations(*DataSection);
+    Seg->setRelocations(DataRelocs);
     Segments.emplace_back(Seg);
   }
 
@@ -221,10 +257,14 @@ void ObjFile::parse() {
   ArrayRef<WasmSignature> Types = WasmObj->types();
   Functions.reserve(Funcs.size());
 
+  ArrayRef<WasmRelocation> CodeRelocs;
+  if (CodeSection)
+    CodeRelocs = getSortedRelocations(*CodeSection);
+
   for (size_t I = 0, E = Funcs.size(); I != E; ++I) {
     InputFunction *F =
         make<InputFunction>(Types[FuncTypes[I]], &Funcs[I], this);
-    F->copyRelocations(*CodeSection);
+    F->setRelocations(CodeRelocs);
     Functions.emplace_back(F);
   }
 
@@ -417,6 +457,8 @@ static Symbol *createBitcodeSymbol(const lto::InputFile::Symbol &ObjSym,
 }
 
 void BitcodeFile::parse() {
+  // LLVM targets are registered only once a bitcode file shows up.
+  initLLVMTargets();
   Obj = check(lto::InputFile::create(MemoryBufferRef(
       MB.getBuffer(), Saver.save(ParentName + MB.getBufferIdentifier()))));
   Triple T(Obj->getTargetTriple());
@@ -102,6 +102,9 @@ public:
 
   void parse() override;
 
+  // Decodes the object file; called by parse() if it has not been already.
+  void readObject();
+
   // Returns the underlying wasm file.
   const WasmObjectFile *getWasmObj() const { return WasmObj.get(); }
 
@@ -144,6 +147,11 @@ private:
 
   bool isExcludedByComdat(InputChunk *Chunk) const;
 
+  // Returns the relocations of a section sorted by offset.  These are normally
+  // a view of the object file's own array; a sorted copy is made only for
+  // input that is not already in order.
+  ArrayRef<WasmRelocation> getSortedRelocations(const WasmSection &Section);
+
   std::unique_ptr<WasmObjectFile> WasmObj;
 };
 
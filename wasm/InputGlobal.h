@@ -44,6 +44,10 @@ public:
 
   bool Live = false;
 
+  // Set by --fold-globals if every read of this global is replaced with its
+  // initial value.  Folded globals are not live.
+  bool Folded = false;
+
 protected:
   llvm::Optional<uint32_t> GlobalIndex;
 };
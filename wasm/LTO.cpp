@@ -9,6 +9,7 @@
 
 #include "LTO.h"
 #include "Config.h"
+#include "Dispatch.h"
 #include "InputFiles.h"
 #include "Symbols.h"
 #include "lld/Common/ErrorHandler.h"
@@ -53,6 +54,15 @@ static std::unique_ptr<lto::LTO> createLTO() {
   C.DiagHandler = diagnosticHandler;
   C.OptLevel = Config->LTOO;
 
+  // A contract pays for its size when it is deployed and for every
+  // instruction it executes, so contracts are optimized for size.  The
+  // inliner still runs, and with everything but the roots internalized it
+  // can inline helpers across translation units.
+  if (Config->ContractLTO && Config->LTOO > 0) {
+    C.OptPipeline = Config->LTOO == 3 ? "lto<O3>" : "lto<Os>";
+    C.AAPipeline = "default";
+  }
+
   if (Config->SaveTemps)
     checkError(C.addSaveTemps(Config->OutputFile.str() + ".",
                               /*UseInputModulePath*/ true));
@@ -64,7 +74,26 @@ static std::unique_ptr<lto::LTO> createLTO() {
                                      Config->LTOPartitions);
 }
 
-BitcodeCompiler::BitcodeCompiler() : LTOObj(createLTO()) {}
+// Returns the symbols of a contract that must survive LTO. The handlers are
+// called only by the dispatcher that the linker generates, and the hooks
+// are looked up by name when generating it, so nothing in the bitcode keeps
+// them alive.
+static DenseSet<StringRef> getContractRoots() {
+  DenseSet<StringRef> Roots;
+  for (StringRef Name : getDispatchHandlerNames())
+    Roots.insert(Name);
+  if (!Config->Entry.empty())
+    Roots.insert(Config->Entry);
+  for (StringRef Name :
+       {"pre_dispatch", "post_dispatch", "snax_assert_code", "__cxa_finalize"})
+    Roots.insert(Name);
+  return Roots;
+}
+
+BitcodeCompiler::BitcodeCompiler() : LTOObj(createLTO()) {
+  if (Config->ContractLTO)
+    ContractRoots = getContractRoots();
+}
 
 BitcodeCompiler::~BitcodeCompiler() = default;
 
@@ -95,7 +124,8 @@ void BitcodeCompiler::add(BitcodeFile &F) {
     // Once IRObjectFile is fixed to report only one symbol this hack can
     // be removed.
     R.Prevailing = !ObjSym.isUndefined() && Sym->getFile() == &F;
-    R.VisibleToRegularObj = Config->Relocatable || Sym->IsUsedInRegularObj;
+    R.VisibleToRegularObj = Config->Relocatable || Sym->IsUsedInRegularObj ||
+                            ContractRoots.count(Sym->getName());
     if (R.Prevailing)
       undefine(Sym);
   }
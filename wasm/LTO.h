@@ -22,6 +22,7 @@
 #define LLD_WASM_LTO_H
 
 #include "lld/Common/LLVM.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
 #include <memory>
 #include <vector>
@@ -50,6 +51,9 @@ private:
   std::unique_ptr<llvm::lto::LTO> LTOObj;
   std::vector<SmallString<0>> Buf;
   std::vector<std::unique_ptr<MemoryBuffer>> Files;
+
+  // Symbols kept visible by --snax-contract-lto.
+  llvm::DenseSet<StringRef> ContractRoots;
 };
 } // namespace wasm
 } // namespace lld
@@ -0,0 +1,187 @@
+//===- MapFile.cpp --------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the -Map option. It shows lists in order and
+// hierarchically the output sections, data segments, input chunks and
+// symbols:
+//
+//     Offset     Size  Index/VA Out     In      Symbol
+//          8        a         - TYPE
+//         bd       3f         - CODE
+//         c0       12         2         foo.o:(foo)
+//          -        0         2                 foo
+//         fc       17         - DATA
+//        102        c       400         .data
+//        102        c       400                 foo.o:(.data.bar)
+//          -        4       400                         bar
+//
+// For functions the Index/VA column holds the function index and for data
+// the virtual address in linear memory.  Function sizes are the sizes after
+// relocation target compression.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MapFile.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "InputFiles.h"
+#include "OutputSections.h"
+#include "OutputSegment.h"
+#include "SymbolTable.h"
+#include "Symbols.h"
+#include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+typedef DenseMap<const InputChunk *, SmallVector<Symbol *, 4>> SymbolMapTy;
+
+static const std::string Indent8 = "        ";          // 8 spaces
+static const std::string Indent16 = "                "; // 16 spaces
+static const std::string Indent24 = Indent16 + Indent8;
+
+static void writeNumber(raw_ostream &OS, Optional<uint64_t> N) {
+  if (N)
+    OS << format("%10llx ", *N);
+  else
+    OS << "         - ";
+}
+
+// Print out the first three columns of a line.
+static void writeHeader(raw_ostream &OS, Optional<uint64_t> Offset,
+                        uint64_t Size, Optional<uint64_t> Addr) {
+  writeNumber(OS, Offset);
+  OS << format("%8llx ", Size);
+  writeNumber(OS, Addr);
+}
+
+// Returns the chunk that a symbol we want to print out is defined in.
+static const InputChunk *getChunk(const Symbol *Sym) {
+  if (auto *F = dyn_cast<DefinedFunction>(Sym))
+    return F->Function;
+  if (auto *D = dyn_cast<DefinedData>(Sym)) {
+    if (D->Segment && D->Segment->MergedInto)
+      return D->Segment->MergedInto;
+    return D->Segment;
+  }
+  return nullptr;
+}
+
+// Returns a list of all symbols that we want to print out.
+static std::vector<Symbol *> getSymbols() {
+  std::vector<Symbol *> V;
+  for (ObjFile *File : Symtab->ObjectFiles)
+    for (Symbol *Sym : File->getSymbols()) {
+      const InputChunk *Chunk = getChunk(Sym);
+      if (Chunk && Chunk->Live && Sym->getFile() == File)
+        V.push_back(Sym);
+    }
+  return V;
+}
+
+// Returns a map from chunks to their symbols.
+static SymbolMapTy getChunkSyms(ArrayRef<Symbol *> Syms) {
+  SymbolMapTy Ret;
+  for (Symbol *Sym : Syms)
+    Ret[getChunk(Sym)].push_back(Sym);
+  return Ret;
+}
+
+// Construct a map from symbols to their stringified representations.
+// Demangling symbols (which is what toString() does) is slow, so
+// we do that in batch using parallel-for.
+static DenseMap<Symbol *, std::string>
+getSymbolStrings(ArrayRef<Symbol *> Syms) {
+  std::vector<std::string> Str(Syms.size());
+  parallelForEachN(0, Syms.size(), [&](size_t I) {
+    raw_string_ostream OS(Str[I]);
+    if (auto *F = dyn_cast<DefinedFunction>(Syms[I])) {
+      writeHeader(OS, None, 0, F->getFunctionIndex());
+      OS << Indent16;
+    } else {
+      auto *D = cast<DefinedData>(Syms[I]);
+      writeHeader(OS, None, D->getSize(), D->getVirtualAddress());
+      OS << Indent24;
+    }
+    OS << toString(*Syms[I]);
+  });
+
+  DenseMap<Symbol *, std::string> Ret;
+  for (size_t I = 0, E = Syms.size(); I < E; ++I)
+    Ret[Syms[I]] = std::move(Str[I]);
+  return Ret;
+}
+
+void lld::wasm::writeMapFile(ArrayRef<OutputSection *> OutputSections) {
+  if (Config->MapFile.empty())
+    return;
+
+  // Open a map file for writing.
+  std::error_code EC;
+  raw_fd_ostream OS(Config->MapFile, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Config->MapFile + ": " + EC.message());
+    return;
+  }
+
+  // Collect symbol info that we want to print out.
+  std::vector<Symbol *> Syms = getSymbols();
+  SymbolMapTy ChunkSyms = getChunkSyms(Syms);
+  DenseMap<Symbol *, std::string> SymStr = getSymbolStrings(Syms);
+
+  // Print out the header line.
+  OS << "    Offset     Size  Index/VA Out     In      Symbol\n";
+
+  for (OutputSection *OSec : OutputSections) {
+    writeHeader(OS, OSec->getOffset(), OSec->getSize(), None);
+    OS << toString(*OSec) << '\n';
+
+    // Chunk offsets are relative to the end of the section header.
+    uint64_t BodyOffset = OSec->getOffset() + OSec->Header.size();
+
+    if (OSec->Type == WASM_SEC_CODE) {
+      for (const InputFunction *F :
+           static_cast<CodeSection *>(OSec)->getFunctions()) {
+        writeHeader(OS, BodyOffset + F->OutputOffset, F->getSize(),
+                    F->getFunctionIndex());
+        OS << Indent8 << toString(F) << '\n';
+        for (Symbol *Sym : ChunkSyms[F])
+          OS << SymStr[Sym] << '\n';
+      }
+    } else if (OSec->Type == WASM_SEC_DATA) {
+      // With --split-zero-runs a segment is not written contiguously.
+      bool HasOffsets = !Config->SplitZeroRuns;
+      for (const OutputSegment *Seg :
+           static_cast<DataSection *>(OSec)->getSegments()) {
+        Optional<uint64_t> SegOffset;
+        if (HasOffsets)
+          SegOffset = BodyOffset + Seg->SectionOffset + Seg->Header.size();
+        writeHeader(OS, SegOffset, Seg->Size, Seg->StartVA);
+        OS << Indent8 << Seg->Name << '\n';
+        for (const InputSegment *IS : Seg->InputSegments) {
+          Optional<uint64_t> Offset;
+          if (HasOffsets)
+            Offset = BodyOffset + IS->OutputOffset;
+          writeHeader(OS, Offset, IS->getSize(),
+                      Seg->StartVA + IS->OutputSegmentOffset);
+          OS << Indent16 << toString(IS) << '\n';
+          for (Symbol *Sym : ChunkSyms[IS])
+            OS << SymStr[Sym] << '\n';
+        }
+      }
+    }
+  }
+}
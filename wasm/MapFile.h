@@ -0,0 +1,22 @@
+//===- MapFile.h ------------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_MAPFILE_H
+#define LLD_WASM_MAPFILE_H
+
+#include "lld/Common/LLVM.h"
+
+namespace lld {
+namespace wasm {
+class OutputSection;
+void writeMapFile(ArrayRef<OutputSection *> OutputSections);
+} // namespace wasm
+} // namespace lld
+
+#endif
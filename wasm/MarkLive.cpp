@@ -20,11 +20,19 @@
 //===----------------------------------------------------------------------===//
 
 #include "MarkLive.h"
+#include "CodeReader.h"
 #include "Config.h"
+#include "Dispatch.h"
 #include "InputChunks.h"
 #include "InputGlobal.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
+#include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MathExtras.h"
 
 #define DEBUG_TYPE "lld"
 
@@ -33,10 +41,14 @@ using namespace llvm::wasm;
 using namespace lld;
 using namespace lld::wasm;
 
+static Timer GCTimer("GC", Timer::root());
+
 void lld::wasm::markLive() {
   if (!Config->GcSections)
     return;
 
+  ScopedTimer T(GCTimer);
+
   LLVM_DEBUG(dbgs() << "markLive\n");
   SmallVector<InputChunk *, 256> Q;
 
@@ -70,32 +82,34 @@ void lld::wasm::markLive() {
       Enqueue(Obj->getFunctionSymbol(F.Symbol));
   }
 
-  // mark action dispatch stubs as live
-  for (const ObjFile *Obj : Symtab->ObjectFiles) {
-     auto wasm_obj = Obj->getWasmObj();
-     for (auto func : wasm_obj->functions()) {
-        for (auto act : wasm_obj->actions()) {
-            if (func.SymbolName == act.substr(act.find(":")+1)) {
-               Enqueue(Symtab->find(func.SymbolName));
-            }
-            if (func.SymbolName == "pre_dispatch" || func.SymbolName == "post_dispatch" || func.SymbolName == "snax_assert_code" ) {
-               Enqueue(Symtab->find(func.SymbolName));
-            }
-        }
-     }
+  // Mark action and notify dispatch stubs as live.  The handler names are
+  // collected once and their symbols enqueued directly, so the cost is linear
+  // in the number of actions rather than in functions times actions.
+  bool HasActions = false;
+  for (const ObjFile *Obj : Symtab->ObjectFiles)
+    if (!Obj->getSnaxActions().empty())
+      HasActions = true;
+  auto EnqueueDefined = [&](StringRef Name) {
+    Symbol *Sym = Symtab->find(Name);
+    if (Sym && Sym->isDefined())
+      Enqueue(Sym);
+  };
+  for (StringRef Name : getDispatchHandlerNames()) {
+    // A handler inlined into the dispatcher is not called, only its callees
+    // are, so it stays dead unless something else refers to it.
+    if (InputFunction *F = getInlinableHandler(Symtab->find(Name))) {
+      for (const WasmRelocation &Reloc : F->getRelocations())
+        Enqueue(F->File->getSymbol(Reloc.Index));
+      continue;
+    }
+    EnqueueDefined(Name);
   }
 
-  // mark notify dispatch stubs as live
-  for (const ObjFile *Obj : Symtab->ObjectFiles) {
-     auto wasm_obj = Obj->getWasmObj();
-     for (auto func : wasm_obj->functions()) {
-        for (auto _not : wasm_obj->notify()) {
-            std::string sub = _not.substr(_not.find(":")+2);
-            if (func.SymbolName == sub.substr(sub.find(":")+1)) {
-               Enqueue(Symtab->find(func.SymbolName));
-            }
-        }
-     }
+  // The generated dispatcher calls these directly when there are actions.
+  if (HasActions) {
+    EnqueueDefined("pre_dispatch");
+    EnqueueDefined("post_dispatch");
+    EnqueueDefined("snax_assert_code");
   }
 
   // Follow relocations to mark all reachable chunks.
@@ -146,3 +160,263 @@ void lld::wasm::markLive() {
         message("removing unused section " + toString(G));
   }
 }
+
+// Returns the name and the handler function of every action and notify
+// handler. The entries are <action>:<func> and <code>::<action>:<func>.
+// Objects that include the same contract header list the same handlers, so
+// the first one is kept.
+static std::vector<std::pair<StringRef, Symbol *>> getHandlers() {
+  std::vector<std::pair<StringRef, Symbol *>> Handlers;
+  DenseSet<StringRef> Seen;
+  auto AddHandler = [&](StringRef Entry) {
+    size_t Pos = Entry.rfind(':');
+    StringRef Name = Entry.substr(0, Pos);
+    if (Seen.insert(Name).second)
+      Handlers.push_back({Name, Symtab->find(Entry.substr(Pos + 1))});
+  };
+  for (const ObjFile *Obj : Symtab->ObjectFiles) {
+    for (StringRef Act : Obj->getSnaxActions())
+      AddHandler(Act);
+    for (StringRef Not : Obj->getSnaxNotify())
+      AddHandler(Not);
+  }
+  return Handlers;
+}
+
+// Reports, for every action and notify handler, the code and data reachable
+// from it through relocations.  Bytes reachable from only one handler are
+// exclusive to it; the rest are shared with other handlers.  This runs once
+// the code section has been laid out, so function sizes are final.
+void lld::wasm::printActionFootprint() {
+  struct Footprint {
+    StringRef Name;
+    Symbol *Sym;
+    std::vector<InputChunk *> Chunks;
+    uint64_t Total = 0;
+    uint64_t Exclusive = 0;
+  };
+
+  std::vector<Footprint> Handlers;
+  for (const std::pair<StringRef, Symbol *> &H : getHandlers()) {
+    Footprint F;
+    F.Name = H.first;
+    F.Sym = H.second;
+    Handlers.push_back(std::move(F));
+  }
+  if (Handlers.empty())
+    return;
+
+  parallelForEach(Handlers, [](Footprint &F) {
+    DenseSet<InputChunk *> Visited;
+    SmallVector<InputChunk *, 64> Q;
+    auto Visit = [&](Symbol *Sym) {
+      InputChunk *C = Sym ? Sym->getChunk() : nullptr;
+      if (C && C->Live && Visited.insert(C).second)
+        Q.push_back(C);
+    };
+
+    Visit(F.Sym);
+    while (!Q.empty()) {
+      InputChunk *C = Q.pop_back_val();
+      F.Chunks.push_back(C);
+      for (const WasmRelocation &Reloc : C->getRelocations())
+        if (Reloc.Type != R_WEBASSEMBLY_TYPE_INDEX_LEB)
+          Visit(C->File->getSymbol(Reloc.Index));
+    }
+  });
+
+  DenseMap<InputChunk *, unsigned> RefCount;
+  for (const Footprint &F : Handlers)
+    for (InputChunk *C : F.Chunks)
+      ++RefCount[C];
+
+  for (Footprint &F : Handlers) {
+    for (InputChunk *C : F.Chunks) {
+      F.Total += C->getSize();
+      if (RefCount[C] == 1)
+        F.Exclusive += C->getSize();
+    }
+  }
+
+  std::stable_sort(Handlers.begin(), Handlers.end(),
+                   [](const Footprint &A, const Footprint &B) {
+                     return A.Total > B.Total;
+                   });
+
+  message(formatv("{0,-32} {1,10} {2,10} {3,10}", "handler", "total",
+                  "exclusive", "shared")
+              .str());
+  for (const Footprint &F : Handlers)
+    message(formatv("{0,-32} {1,10} {2,10} {3,10}", F.Name, F.Total,
+                    F.Exclusive, F.Total - F.Exclusive)
+                .str());
+}
+
+namespace {
+// What the action cost report needs to know about one function.
+struct FunctionCost {
+  // Computed from the function alone.
+  uint64_t Instrs = 0;
+  bool HasCallIndirect = false;
+  std::vector<InputFunction *> Callees;
+  uint32_t ImportCalls = 0;
+
+  // Computed over everything the function calls.
+  bool Done = false;
+  bool OnStack = false;
+  uint64_t TotalInstrs = 0;
+  uint32_t Depth = 0;
+  bool Recursive = false;
+  bool Indirect = false;
+};
+
+class ActionCost {
+public:
+  void analyze(ArrayRef<InputFunction *> Functions);
+  FunctionCost &visit(InputFunction *F);
+  DenseMap<InputFunction *, FunctionCost> Costs;
+};
+} // namespace
+
+// Counts the instructions of each function and records its direct callees
+// and its calls to imports. Calls are found through the relocations of the
+// call instructions.
+void ActionCost::analyze(ArrayRef<InputFunction *> Functions) {
+  for (InputFunction *F : Functions)
+    Costs[F];
+
+  parallelForEach(Functions, [&](InputFunction *F) {
+    // Synthetic functions call by index, without relocations, so their
+    // callees are unknown and they are counted as empty.
+    if (!F->File)
+      return;
+
+    FunctionCost &C = Costs.find(F)->second;
+    CodeReader R(F->getInputBody(), 0);
+    R.uleb(); // body size
+    uint64_t NumGroups = R.uleb();
+    for (uint64_t I = 0; I < NumGroups && !R.Error; ++I) {
+      R.uleb(); // count
+      R.u8();   // type
+    }
+    while (!R.atEnd() && !R.Error) {
+      uint8_t Op = R.u8();
+      if (!skipImmediates(R, Op))
+        break;
+      ++C.Instrs;
+      if (Op == 0x11)
+        C.HasCallIndirect = true;
+    }
+
+    for (const WasmRelocation &Reloc : F->getRelocations()) {
+      if (Reloc.Type != R_WEBASSEMBLY_FUNCTION_INDEX_LEB)
+        continue;
+      Symbol *Sym = F->File->getSymbol(Reloc.Index);
+      if (auto *D = dyn_cast<DefinedFunction>(Sym))
+        C.Callees.push_back(D->Function);
+      else if (Sym->isUndefined())
+        ++C.ImportCalls;
+    }
+  });
+}
+
+// Computes the cost of F and everything it calls. A function that reaches a
+// function on the current call path is recursive. Costs has an entry for
+// every function that can be called, so the references into it stay valid.
+FunctionCost &ActionCost::visit(InputFunction *F) {
+  FunctionCost &C = Costs.find(F)->second;
+  if (C.OnStack)
+    C.Recursive = true;
+  if (C.Done || C.OnStack)
+    return C;
+
+  C.OnStack = true;
+  C.TotalInstrs = C.Instrs;
+  C.Indirect = C.HasCallIndirect;
+  for (InputFunction *Callee : C.Callees) {
+    if (!Costs.count(Callee))
+      continue;
+    FunctionCost &CC = visit(Callee);
+    C.Recursive |= CC.Recursive;
+    C.Indirect |= CC.Indirect;
+    C.Depth = std::max(C.Depth, CC.Depth + 1);
+    C.TotalInstrs = SaturatingAdd(C.TotalInstrs, CC.TotalInstrs);
+  }
+  C.OnStack = false;
+  C.Done = true;
+  return C;
+}
+
+// Reports, for every action and notify handler, an estimate of the
+// instructions executed by one call of the handler with each loop body run
+// once, the calls to imports in the code it reaches, and the depth of its
+// call graph. The estimate has no bound if the handler can recurse or make
+// an indirect call. The search the dispatcher does to find the handler is
+// not included.
+void lld::wasm::printActionCost() {
+  std::vector<std::pair<StringRef, Symbol *>> Handlers = getHandlers();
+  if (Handlers.empty())
+    return;
+
+  std::vector<InputFunction *> Functions;
+  for (InputFunction *F : Symtab->SyntheticFunctions)
+    if (F->Live)
+      Functions.push_back(F);
+  for (ObjFile *File : Symtab->ObjectFiles)
+    for (InputFunction *F : File->Functions)
+      if (F->Live)
+        Functions.push_back(F);
+
+  ActionCost AC;
+  AC.analyze(Functions);
+
+  struct Row {
+    StringRef Name;
+    uint64_t Instrs = 0;
+    uint64_t ImportCalls = 0;
+    uint32_t Depth = 0;
+    StringRef Bound = "yes";
+  };
+  std::vector<Row> Rows;
+  for (const std::pair<StringRef, Symbol *> &H : Handlers) {
+    Row R;
+    R.Name = H.first;
+    auto *D = dyn_cast_or_null<DefinedFunction>(H.second);
+    if (D && AC.Costs.count(D->Function)) {
+      const FunctionCost &C = AC.visit(D->Function);
+      R.Instrs = C.TotalInstrs;
+      R.Depth = C.Depth;
+      if (C.Recursive)
+        R.Bound = "recursion";
+      else if (C.Indirect)
+        R.Bound = "call_indirect";
+
+      // Count each reachable call site of an import once.
+      DenseSet<InputFunction *> Visited;
+      SmallVector<InputFunction *, 64> Q = {D->Function};
+      Visited.insert(D->Function);
+      while (!Q.empty()) {
+        auto It = AC.Costs.find(Q.pop_back_val());
+        if (It == AC.Costs.end())
+          continue;
+        R.ImportCalls += It->second.ImportCalls;
+        for (InputFunction *Callee : It->second.Callees)
+          if (Visited.insert(Callee).second)
+            Q.push_back(Callee);
+      }
+    }
+    Rows.push_back(R);
+  }
+
+  std::stable_sort(Rows.begin(), Rows.end(), [](const Row &A, const Row &B) {
+    return A.Instrs > B.Instrs;
+  });
+
+  message(formatv("{0,-32} {1,12} {2,8} {3,6} {4}", "handler", "instrs",
+                  "imports", "depth", "bounded")
+              .str());
+  for (const Row &R : Rows)
+    message(formatv("{0,-32} {1,12} {2,8} {3,6} {4}", R.Name, R.Instrs,
+                    R.ImportCalls, R.Depth, R.Bound)
+                .str());
+}
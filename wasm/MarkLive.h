@@ -14,6 +14,8 @@ namespace lld {
 namespace wasm {
 
 void markLive();
+void printActionFootprint();
+void printActionCost();
 
 } // namespace wasm
 } // namespace lld
@@ -16,6 +16,7 @@
 #include "lld/Common/Threads.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/LEB128.h"
+#include <numeric>
 
 #define DEBUG_TYPE "lld"
 
@@ -85,11 +86,40 @@ CodeSection::CodeSection(ArrayRef<InputFunction *> Functions)
   OS.flush();
   BodySize = CodeSectionHeader.size();
 
-  for (InputFunction *Func : Functions) {
-    Func->OutputOffset = BodySize;
-    Func->calculateSize();
-    BodySize += Func->getSize();
-  }
+  // Once symbol values are final the size of each function depends only on
+  // its own body, so the sizes can be computed in parallel.  The output
+  // offsets are then assigned with a blocked prefix sum: each shard sums its
+  // own sizes, the shard totals are scanned serially, and each shard then
+  // lays out its functions starting from its base offset.
+  parallelForEach(Functions,
+                  [](InputFunction *Func) { Func->calculateSize(); });
+
+  const size_t NumShards = 64;
+  size_t ShardSize = (Functions.size() + NumShards - 1) / NumShards;
+  std::vector<uint32_t> ShardOffsets(NumShards + 1);
+  ShardOffsets[0] = BodySize;
+
+  parallelForEachN(0, NumShards, [&](size_t I) {
+    size_t Begin = std::min(I * ShardSize, Functions.size());
+    size_t End = std::min(Begin + ShardSize, Functions.size());
+    uint32_t Size = 0;
+    for (size_t J = Begin; J != End; ++J)
+      Size += Functions[J]->getSize();
+    ShardOffsets[I + 1] = Size;
+  });
+  std::partial_sum(ShardOffsets.begin(), ShardOffsets.end(),
+                   ShardOffsets.begin());
+
+  parallelForEachN(0, NumShards, [&](size_t I) {
+    size_t Begin = std::min(I * ShardSize, Functions.size());
+    size_t End = std::min(Begin + ShardSize, Functions.size());
+    uint32_t Offset = ShardOffsets[I];
+    for (size_t J = Begin; J != End; ++J) {
+      Functions[J]->OutputOffset = Offset;
+      Offset += Functions[J]->getSize();
+    }
+  });
+  BodySize = ShardOffsets[NumShards];
 
   createHeader(BodySize);
 }
@@ -108,9 +138,18 @@ void CodeSection::writeTo(uint8_t *Buf) {
   // Write code section headers
   memcpy(Buf, CodeSectionHeader.data(), CodeSectionHeader.size());
 
-  // Write code section bodies
-  parallelForEach(Functions,
-                  [&](const InputChunk *Chunk) { Chunk->writeTo(Buf); });
+  // Write code section bodies, and hash each one while its input is still
+  // in cache.  Most functions are small, so each thread takes at least 16 of
+  // them.
+  if (Config->FunctionHashes)
+    FunctionHashes.resize(Functions.size());
+  parallelForEachN(0, Functions.size(),
+                   [&](size_t I) {
+                     Functions[I]->writeTo(Buf);
+                     if (Config->FunctionHashes)
+                       FunctionHashes[I] = Functions[I]->getContentHash();
+                   },
+                   16);
 }
 
 uint32_t CodeSection::numRelocations() const {
@@ -120,27 +159,50 @@ uint32_t CodeSection::numRelocations() const {
   return Count;
 }
 
-void CodeSection::writeRelocations(raw_ostream &OS) const {
-  for (const InputChunk *C : Functions)
-    C->writeRelocations(OS);
+std::vector<const InputChunk *> CodeSection::getRelocatedChunks() const {
+  return {Functions.begin(), Functions.end()};
+}
+
+static void writeSegmentHeader(std::string &Header, uint32_t VA,
+                               uint32_t Size) {
+  raw_string_ostream OS(Header);
+  writeUleb128(OS, 0, "memory index");
+  writeUleb128(OS, WASM_OPCODE_I32_CONST, "opcode:i32const");
+  writeSleb128(OS, VA, "memory offset");
+  writeUleb128(OS, WASM_OPCODE_END, "opcode:end");
+  writeUleb128(OS, Size, "segment size");
+  OS.flush();
 }
 
-DataSection::DataSection(ArrayRef<OutputSegment *> Segments)
-    : OutputSection(WASM_SEC_DATA), Segments(Segments) {
+DataSection::DataSection(ArrayRef<OutputSegment *> Segments,
+                         std::vector<std::vector<uint8_t>> Contents)
+    : OutputSection(WASM_SEC_DATA), Segments(Segments),
+      Contents(std::move(Contents)) {
+  if (Config->SplitZeroRuns)
+    splitZeroRuns();
+
   raw_string_ostream OS(DataSectionHeader);
 
-  writeUleb128(OS, Segments.size(), "data segment count");
+  writeUleb128(OS, Config->SplitZeroRuns ? Ranges.size() : Segments.size(),
+               "data segment count");
   OS.flush();
   BodySize = DataSectionHeader.size();
 
+  if (Config->SplitZeroRuns) {
+    for (DataRange &R : Ranges) {
+      writeSegmentHeader(R.Header, Segments[R.SegmentIndex]->StartVA + R.Begin,
+                         R.End - R.Begin);
+      R.SectionOffset = BodySize;
+      BodySize += R.Header.size() + R.End - R.Begin;
+    }
+    log("Data segments: " + Twine(Segments.size()) + " split into " +
+        Twine(Ranges.size()));
+    createHeader(BodySize);
+    return;
+  }
+
   for (OutputSegment *Segment : Segments) {
-    raw_string_ostream OS(Segment->Header);
-    writeUleb128(OS, 0, "memory index");
-    writeUleb128(OS, WASM_OPCODE_I32_CONST, "opcode:i32const");
-    writeSleb128(OS, Segment->StartVA, "memory offset");
-    writeUleb128(OS, WASM_OPCODE_END, "opcode:end");
-    writeUleb128(OS, Segment->Size, "segment size");
-    OS.flush();
+    writeSegmentHeader(Segment->Header, Segment->StartVA, Segment->Size);
 
     Segment->SectionOffset = BodySize;
     BodySize += Segment->Header.size() + Segment->Size;
@@ -154,6 +216,54 @@ DataSection::DataSection(ArrayRef<OutputSegment *> Segments)
   createHeader(BodySize);
 }
 
+// Linear memory is zero initialized, so zero bytes only need to be written
+// when they sit between non-zero bytes.  This computes the relocated
+// contents of each output segment (all symbol values are final by the time
+// the data section is created) and records the ranges that remain after
+// dropping leading and trailing zeros and any run of at least
+// Config->SplitZeroRuns zeros.
+void DataSection::splitZeroRuns() {
+  if (Contents.empty()) {
+    Contents.resize(Segments.size());
+    parallelForEachN(0, Segments.size(), [&](size_t I) {
+      std::vector<uint8_t> &Buf = Contents[I];
+      Buf.resize(Segments[I]->Size);
+      for (InputSegment *InputSeg : Segments[I]->InputSegments) {
+        InputSeg->OutputOffset = InputSeg->OutputSegmentOffset;
+        InputSeg->writeTo(Buf.data());
+      }
+    });
+  }
+
+  for (size_t I = 0; I < Segments.size(); ++I) {
+    ArrayRef<uint8_t> Buf = Contents[I];
+    size_t Pos = 0;
+    while (true) {
+      while (Pos < Buf.size() && Buf[Pos] == 0)
+        ++Pos;
+      if (Pos == Buf.size())
+        break;
+
+      size_t Begin = Pos;
+      size_t End = Pos;
+      while (Pos < Buf.size()) {
+        if (Buf[Pos] != 0) {
+          End = ++Pos;
+          continue;
+        }
+        size_t ZeroEnd = Pos;
+        while (ZeroEnd < Buf.size() && Buf[ZeroEnd] == 0)
+          ++ZeroEnd;
+        if (ZeroEnd == Buf.size() || ZeroEnd - Pos >= Config->SplitZeroRuns)
+          break;
+        Pos = ZeroEnd;
+      }
+      Ranges.push_back({I, uint32_t(Begin), uint32_t(End), "", 0});
+      Pos = End;
+    }
+  }
+}
+
 void DataSection::writeTo(uint8_t *Buf) {
   log("writing " + toString(*this) + " size=" + Twine(getSize()) +
       " body=" + Twine(BodySize));
@@ -166,12 +276,28 @@ void DataSection::writeTo(uint8_t *Buf) {
   // Write data section headers
   memcpy(Buf, DataSectionHeader.data(), DataSectionHeader.size());
 
-  parallelForEach(Segments, [&](const OutputSegment *Segment) {
+  if (Config->SplitZeroRuns) {
+    parallelForEach(Ranges, [&](const DataRange &R) {
+      uint8_t *SegStart = Buf + R.SectionOffset;
+      memcpy(SegStart, R.Header.data(), R.Header.size());
+      memcpy(SegStart + R.Header.size(),
+             Contents[R.SegmentIndex].data() + R.Begin, R.End - R.Begin);
+    });
+    return;
+  }
+
+  parallelForEachN(0, Segments.size(), [&](size_t I) {
     // Write data segment header
+    const OutputSegment *Segment = Segments[I];
     uint8_t *SegStart = Buf + Segment->SectionOffset;
     memcpy(SegStart, Segment->Header.data(), Segment->Header.size());
 
     // Write segment data payload
+    if (!Contents.empty()) {
+      memcpy(SegStart + Segment->Header.size(), Contents[I].data(),
+             Contents[I].size());
+      return;
+    }
     for (const InputChunk *Chunk : Segment->InputSegments)
       Chunk->writeTo(Buf);
   });
@@ -185,10 +311,12 @@ uint32_t DataSection::numRelocations() const {
   return Count;
 }
 
-void DataSection::writeRelocations(raw_ostream &OS) const {
+std::vector<const InputChunk *> DataSection::getRelocatedChunks() const {
+  std::vector<const InputChunk *> Chunks;
   for (const OutputSegment *Seg : Segments)
-    for (const InputChunk *C : Seg->InputSegments)
-      C->writeRelocations(OS);
+    Chunks.insert(Chunks.end(), Seg->InputSegments.begin(),
+                  Seg->InputSegments.end());
+  return Chunks;
 }
 
 CustomSection::CustomSection(std::string Name,
@@ -223,7 +351,8 @@ void CustomSection::writeTo(uint8_t *Buf) {
 
   // Write custom sections payload
   parallelForEach(InputSections,
-                  [&](const InputSection *Section) { Section->writeTo(Buf); });
+                  [&](const InputSection *Section) { Section->writeTo(Buf); },
+                  16);
 }
 
 uint32_t CustomSection::numRelocations() const {
@@ -233,7 +362,51 @@ uint32_t CustomSection::numRelocations() const {
   return Count;
 }
 
-void CustomSection::writeRelocations(raw_ostream &OS) const {
-  for (const InputSection *S : InputSections)
-    S->writeRelocations(OS);
+std::vector<const InputChunk *> CustomSection::getRelocatedChunks() const {
+  return {InputSections.begin(), InputSections.end()};
+}
+
+RelocSection::RelocSection(StringRef Name, OutputSection *Sec,
+                           uint32_t SectionIndex)
+    : OutputSection(WASM_SEC_CUSTOM, Name), Sec(Sec) {
+  raw_string_ostream OS(BodyHeader);
+  writeStr(OS, Name, "section name");
+  writeUleb128(OS, SectionIndex, "reloc section");
+  writeUleb128(OS, Sec->numRelocations(), "reloc count");
+  OS.flush();
+}
+
+void RelocSection::finalizeContents() {
+  Chunks = Sec->getRelocatedChunks();
+  ChunkOffsets.resize(Chunks.size());
+
+  // Encoding the relocations takes about as long as writing them, so the
+  // sizes are computed in parallel too.
+  parallelForEachN(0, Chunks.size(), [&](size_t I) {
+    ChunkOffsets[I] = Chunks[I]->getRelocationsSize();
+  }, 16);
+
+  BodySize = BodyHeader.size();
+  for (size_t &Off : ChunkOffsets) {
+    size_t Size = Off;
+    Off = BodySize;
+    BodySize += Size;
+  }
+  createHeader(BodySize);
+}
+
+void RelocSection::writeTo(uint8_t *Buf) {
+  log("writing " + toString(*this) + " size=" + Twine(getSize()) +
+      " chunks=" + Twine(Chunks.size()));
+
+  assert(Offset);
+  Buf += Offset;
+
+  memcpy(Buf, Header.data(), Header.size());
+  Buf += Header.size();
+  memcpy(Buf, BodyHeader.data(), BodyHeader.size());
+
+  parallelForEachN(0, Chunks.size(), [&](size_t I) {
+    Chunks[I]->writeRelocations(Buf + ChunkOffsets[I]);
+  }, 16);
 }
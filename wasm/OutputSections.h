@@ -40,12 +40,18 @@ public:
     log("setOffset: " + toString(*this) + ": " + Twine(NewOffset));
     Offset = NewOffset;
   }
+  size_t getOffset() const { return Offset; }
   void createHeader(size_t BodySize);
   virtual size_t getSize() const = 0;
   virtual void writeTo(uint8_t *Buf) = 0;
   virtual void finalizeContents() {}
   virtual uint32_t numRelocations() const { return 0; }
-  virtual void writeRelocations(raw_ostream &OS) const {}
+
+  // Returns the chunks whose relocations are copied to the output with -r,
+  // in the order they are written.
+  virtual std::vector<const InputChunk *> getRelocatedChunks() const {
+    return {};
+  }
 
   std::string Header;
   uint32_t Type;
@@ -89,28 +95,55 @@ class CodeSection : public OutputSection {
 public:
   explicit CodeSection(ArrayRef<InputFunction *> Functions);
   size_t getSize() const override { return Header.size() + BodySize; }
+  ArrayRef<InputFunction *> getFunctions() const { return Functions; }
   void writeTo(uint8_t *Buf) override;
   uint32_t numRelocations() const override;
-  void writeRelocations(raw_ostream &OS) const override;
+  std::vector<const InputChunk *> getRelocatedChunks() const override;
+
+  // The getContentHash() of each function, computed by writeTo() when
+  // --snax-function-hashes is given.
+  ArrayRef<std::array<uint8_t, 32>> getFunctionHashes() const {
+    return FunctionHashes;
+  }
 
 protected:
   ArrayRef<InputFunction *> Functions;
   std::string CodeSectionHeader;
   size_t BodySize = 0;
+  std::vector<std::array<uint8_t, 32>> FunctionHashes;
 };
 
 class DataSection : public OutputSection {
 public:
-  explicit DataSection(ArrayRef<OutputSegment *> Segments);
+  // Contents, if not empty, replaces the contents of each segment that the
+  // input segments would give it.
+  DataSection(ArrayRef<OutputSegment *> Segments,
+              std::vector<std::vector<uint8_t>> Contents = {});
   size_t getSize() const override { return Header.size() + BodySize; }
+  ArrayRef<OutputSegment *> getSegments() const { return Segments; }
   void writeTo(uint8_t *Buf) override;
   uint32_t numRelocations() const override;
-  void writeRelocations(raw_ostream &OS) const override;
+  std::vector<const InputChunk *> getRelocatedChunks() const override;
 
 protected:
+  // A range of an output segment that is emitted as its own wasm data
+  // segment when --split-zero-runs is used.
+  struct DataRange {
+    size_t SegmentIndex;
+    uint32_t Begin;
+    uint32_t End;
+    std::string Header;
+    uint32_t SectionOffset = 0;
+  };
+
+  void splitZeroRuns();
+
   ArrayRef<OutputSegment *> Segments;
   std::string DataSectionHeader;
   size_t BodySize = 0;
+
+  std::vector<DataRange> Ranges;
+  std::vector<std::vector<uint8_t>> Contents;
 };
 
 // Represents a custom section in the output file.  Wasm custom sections are 
@@ -128,7 +161,7 @@ public:
   }
   void writeTo(uint8_t *Buf) override;
   uint32_t numRelocations() const override;
-  void writeRelocations(raw_ostream &OS) const override;
+  std::vector<const InputChunk *> getRelocatedChunks() const override;
 
 protected:
   size_t PayloadSize;
@@ -136,6 +169,29 @@ protected:
   std::string NameData;
 };
 
+// Represents a "reloc.*" custom section, which holds the relocations of
+// another output section when a user passes "-r". The relocations of each
+// chunk are written directly to the output buffer at an offset computed by
+// finalizeContents, so that no copy of the section is built in memory and
+// the chunks can be written in parallel.
+class RelocSection : public OutputSection {
+public:
+  RelocSection(StringRef Name, OutputSection *Sec, uint32_t SectionIndex);
+  size_t getSize() const override { return Header.size() + BodySize; }
+  void finalizeContents() override;
+  void writeTo(uint8_t *Buf) override;
+
+protected:
+  OutputSection *Sec;
+
+  // The section name, the index of Sec and the relocation count.
+  std::string BodyHeader;
+
+  std::vector<const InputChunk *> Chunks;
+  std::vector<size_t> ChunkOffsets;
+  size_t BodySize = 0;
+};
+
 } // namespace wasm
 } // namespace lld
 
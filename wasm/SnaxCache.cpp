@@ -0,0 +1,98 @@
+//===- SnaxCache.cpp ------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The cache file is a header followed by entries, each a line with its name,
+// key and size, immediately followed by the value itself:
+//
+//   wasm-ld snax cache 1
+//   <lld version>
+//   <name> <key> <size>
+//   <value>...
+//
+// A file that is not understood, for example one written by another version
+// of the linker, is ignored and replaced.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SnaxCache.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace lld;
+using namespace lld::wasm;
+
+static std::string getHeader() {
+  return ("wasm-ld snax cache 1\n" + getLLDVersion() + "\n").str();
+}
+
+SnaxCache::SnaxCache(StringRef Path) : Path(Path) {
+  auto MBOrErr = MemoryBuffer::getFile(Path, /*FileSize*/ -1,
+                                       /*RequiresNullTerminator*/ false);
+  if (!MBOrErr)
+    return;
+
+  StringRef Data = (*MBOrErr)->getBuffer();
+  std::string Header = getHeader();
+  if (!Data.startswith(Header))
+    return;
+  Data = Data.drop_front(Header.size());
+
+  while (!Data.empty()) {
+    StringRef Line;
+    std::tie(Line, Data) = Data.split('\n');
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, ' ');
+    uint64_t Key;
+    size_t Size;
+    if (Fields.size() != 3 || Fields[1].getAsInteger(16, Key) ||
+        Fields[2].getAsInteger(10, Size) || Data.size() < Size) {
+      log("ignoring malformed " + Path);
+      Entries.clear();
+      return;
+    }
+    Entries[Fields[0]] = {Key, Data.take_front(Size)};
+    Data = Data.drop_front(Size);
+  }
+}
+
+Optional<StringRef> SnaxCache::lookup(StringRef Name, uint64_t Key) const {
+  auto It = Entries.find(Name);
+  if (It == Entries.end() || It->second.first != Key)
+    return None;
+  return StringRef(It->second.second);
+}
+
+void SnaxCache::insert(StringRef Name, uint64_t Key, StringRef Value) {
+  std::pair<uint64_t, std::string> &E = Entries[Name];
+  if (E.first == Key && E.second == Value)
+    return;
+  E = {Key, Value};
+  Dirty = true;
+}
+
+void SnaxCache::commit() {
+  if (!Dirty)
+    return;
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  if (EC) {
+    error("cannot open " + Path + ": " + EC.message());
+    return;
+  }
+  OS << getHeader();
+  for (const auto &P : Entries)
+    OS << P.first << " " << utohexstr(P.second.first) << " "
+       << P.second.second.size() << "\n"
+       << P.second.second;
+}
@@ -0,0 +1,53 @@
+//===- SnaxCache.h ----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// With --incremental, the merged ABI and the body of the generated dispatcher
+// are kept next to the output, in "<output>.snax-cache", along with a hash of
+// everything they were computed from.  A relink after an edit that did not
+// touch the Snax metadata of any object, nor move an action handler to
+// another function index, then reuses them instead of merging the ABIs and
+// generating the dispatcher again.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_SNAX_CACHE_H
+#define LLD_WASM_SNAX_CACHE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include <map>
+#include <string>
+
+namespace lld {
+namespace wasm {
+
+class SnaxCache {
+public:
+  // Reads the cache file at Path, if there is a valid one.
+  explicit SnaxCache(StringRef Path);
+
+  // Returns the value stored under Name if it was computed from inputs with
+  // hash Key.
+  llvm::Optional<StringRef> lookup(StringRef Name, uint64_t Key) const;
+
+  void insert(StringRef Name, uint64_t Key, StringRef Value);
+
+  // Writes the cache file back if insert() changed it.
+  void commit();
+
+private:
+  std::string Path;
+  std::map<std::string, std::pair<uint64_t, std::string>> Entries;
+  bool Dirty = false;
+};
+
+} // namespace wasm
+} // namespace lld
+
+#endif
@@ -0,0 +1,264 @@
+//===- StackSize.cpp ------------------------------------------------------===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Computes the stack size for --auto-stack-size.  Code compiled by LLVM keeps
+// the locals that live in memory in a stack in linear memory, addressed by
+// the __stack_pointer global.  A function that needs N bytes of it starts with
+//
+//   global.get __stack_pointer
+//   i32.const N
+//   i32.sub
+//
+// and writes the result back before it makes calls.  The deepest the stack
+// can get is therefore the largest sum of N along a path in the call graph.
+//
+// The bound is unknown if the call graph has a cycle, if a function moves
+// the stack pointer in any other way (e.g. for a variable sized alloca), or
+// if an indirect call may reach functions that are not in the table of this
+// module.  Indirect calls through the table are assumed to reach any
+// function in it that has the called signature.
+//
+//===----------------------------------------------------------------------===//
+
+#include "StackSize.h"
+#include "CodeReader.h"
+#include "Config.h"
+#include "InputChunks.h"
+#include "Symbols.h"
+#include "lld/Common/ErrorHandler.h"
+#include "llvm/ADT/DenseMap.h"
+
+#define DEBUG_TYPE "lld"
+
+using namespace llvm;
+using namespace llvm::wasm;
+using namespace lld;
+using namespace lld::wasm;
+
+namespace {
+enum : uint8_t {
+  OPCODE_CALL = 0x10,
+  OPCODE_CALL_INDIRECT = 0x11,
+  OPCODE_GET_GLOBAL = 0x23,
+  OPCODE_SET_GLOBAL = 0x24,
+  OPCODE_I32_CONST = 0x41,
+  OPCODE_I32_SUB = 0x6b,
+};
+
+class StackSizeAnalysis {
+public:
+  StackSizeAnalysis(ArrayRef<InputFunction *> Functions,
+                    uint32_t NumImportedFunctions);
+
+  Optional<uint32_t> run();
+
+  std::string Why;
+
+private:
+  bool getFrameSize(const InputFunction *F, uint32_t &Size);
+  bool getCallees(const InputFunction *F,
+                  std::vector<const InputFunction *> &Callees);
+  bool getSyntheticCallees(const InputFunction *F,
+                           std::vector<const InputFunction *> &Callees);
+  bool visit(const InputFunction *F);
+
+  ArrayRef<InputFunction *> Functions;
+  uint32_t NumImportedFunctions;
+  std::vector<const InputFunction *> TableFunctions;
+
+  // The deepest stack use of each function that has been visited.  Done is
+  // false while the function is being visited.
+  struct FunctionState {
+    uint64_t Depth = 0;
+    bool Done = false;
+  };
+  DenseMap<const InputFunction *, FunctionState> States;
+};
+} // namespace
+
+StackSizeAnalysis::StackSizeAnalysis(ArrayRef<InputFunction *> Functions,
+                                     uint32_t NumImportedFunctions)
+    : Functions(Functions), NumImportedFunctions(NumImportedFunctions) {
+  for (const InputFunction *F : Functions)
+    if (F->hasTableIndex())
+      TableFunctions.push_back(F);
+}
+
+// Finds the frame size of F from its prologue.
+bool StackSizeAnalysis::getFrameSize(const InputFunction *F, uint32_t &Size) {
+  Size = 0;
+  if (!F->File)
+    return true;
+
+  ArrayRef<uint8_t> Content = F->File->CodeSection->Content;
+  bool SeenGet = false;
+  for (const WasmRelocation &Rel : F->getRelocations()) {
+    if (Rel.Type != R_WEBASSEMBLY_GLOBAL_INDEX_LEB ||
+        F->File->getGlobalSymbol(Rel.Index) != WasmSym::StackPointer)
+      continue;
+    uint8_t Op = Content[Rel.Offset - 1];
+    if (Op == OPCODE_SET_GLOBAL)
+      continue;
+
+    // Only the first read may adjust the stack pointer, by a constant.  The
+    // immediate of global.get is a 5-byte padded LEB.
+    if (Op == OPCODE_GET_GLOBAL && !SeenGet) {
+      CodeReader R(Content, Rel.Offset + 5);
+      int64_t N = R.u8() == OPCODE_I32_CONST ? R.sleb() : -1;
+      if (R.u8() == OPCODE_I32_SUB && !R.Error && N >= 0) {
+        SeenGet = true;
+        Size = N;
+        continue;
+      }
+    }
+    Why = toString(F) + " moves the stack pointer by an unknown amount";
+    return false;
+  }
+  return true;
+}
+
+// Collects the functions F may call.  Imported functions are left out, as
+// they do not use the stack of this module.
+bool StackSizeAnalysis::getCallees(
+    const InputFunction *F, std::vector<const InputFunction *> &Callees) {
+  if (!F->File)
+    return getSyntheticCallees(F, Callees);
+
+  ArrayRef<uint8_t> Content = F->File->CodeSection->Content;
+  ArrayRef<WasmSignature> Types = F->File->getWasmObj()->types();
+  ArrayRef<WasmRelocation> Relocs = F->getRelocations();
+  for (size_t I = 0, E = Relocs.size(); I != E; ++I) {
+    const WasmRelocation &Rel = Relocs[I];
+    if (Rel.Type == R_WEBASSEMBLY_FUNCTION_INDEX_LEB) {
+      auto *Sym = dyn_cast<DefinedFunction>(
+          F->File->getFunctionSymbol(Rel.Index));
+      if (Sym && Sym->Function)
+        Callees.push_back(Sym->Function);
+      continue;
+    }
+    if (Rel.Type != R_WEBASSEMBLY_TYPE_INDEX_LEB ||
+        Content[Rel.Offset - 1] != OPCODE_CALL_INDIRECT)
+      continue;
+
+    // A call rewritten by --devirtualize has a single callee.
+    if (const CallRewrite *R = F->getRewrite(I)) {
+      if (R->K == CallRewrite::Guarded)
+        Callees.push_back(R->Guard);
+      else if (auto *Sym = dyn_cast<DefinedFunction>(R->Target))
+        Callees.push_back(Sym->Function);
+      continue;
+    }
+
+    if (Config->ImportTable || Config->ExportTable) {
+      Why = toString(F) + " makes an indirect call and the table is " +
+            (Config->ImportTable ? "imported" : "exported");
+      return false;
+    }
+    for (const InputFunction *Target : TableFunctions)
+      if (Target->Signature == Types[Rel.Index])
+        Callees.push_back(Target);
+  }
+  return true;
+}
+
+// Synthetic functions have no relocations; their bodies hold output function
+// indices.
+bool StackSizeAnalysis::getSyntheticCallees(
+    const InputFunction *F, std::vector<const InputFunction *> &Callees) {
+  auto *SF = dyn_cast<SyntheticFunction>(F);
+  if (!SF) {
+    Why = "cannot read " + toString(F);
+    return false;
+  }
+
+  CodeReader R(SF->getBody(), 0);
+  R.uleb(); // body size
+  uint64_t NumLocalGroups = R.uleb();
+  for (uint64_t I = 0; I < NumLocalGroups && !R.Error; ++I) {
+    R.uleb();
+    R.u8();
+  }
+
+  while (!R.atEnd() && !R.Error) {
+    uint8_t Op = R.u8();
+    if (Op == OPCODE_CALL) {
+      uint64_t Index = R.uleb();
+      if (Index >= NumImportedFunctions &&
+          Index - NumImportedFunctions < Functions.size())
+        Callees.push_back(Functions[Index - NumImportedFunctions]);
+      continue;
+    }
+    if (Op == OPCODE_CALL_INDIRECT || !skipImmediates(R, Op)) {
+      Why = "cannot follow the calls of " + toString(F);
+      return false;
+    }
+  }
+  if (R.Error) {
+    Why = "cannot read " + toString(F);
+    return false;
+  }
+  return true;
+}
+
+// Computes the deepest stack use of a call to F, including its own frame.
+bool StackSizeAnalysis::visit(const InputFunction *F) {
+  auto P = States.insert({F, FunctionState()});
+  if (!P.second) {
+    if (P.first->second.Done)
+      return true;
+    Why = "recursion through " + toString(F);
+    return false;
+  }
+
+  uint32_t Frame;
+  std::vector<const InputFunction *> Callees;
+  if (!getFrameSize(F, Frame) || !getCallees(F, Callees))
+    return false;
+
+  uint64_t Deepest = 0;
+  for (const InputFunction *Callee : Callees) {
+    if (!visit(Callee))
+      return false;
+    Deepest = std::max(Deepest, States[Callee].Depth);
+  }
+
+  // The calls above may have moved the entry of F.
+  FunctionState &S = States[F];
+  S.Depth = Frame + Deepest;
+  S.Done = true;
+  LLVM_DEBUG(dbgs() << "stack size: " << toString(F) << " frame=" << Frame
+                    << " depth=" << S.Depth << "\n");
+  return true;
+}
+
+// Any function of the output may be called from outside, so all of them are
+// roots of the call graph.
+Optional<uint32_t> StackSizeAnalysis::run() {
+  uint64_t Deepest = 0;
+  for (const InputFunction *F : Functions) {
+    if (!visit(F))
+      return None;
+    Deepest = std::max(Deepest, States[F].Depth);
+  }
+  if (Deepest > UINT32_MAX) {
+    Why = "the stack does not fit in memory";
+    return None;
+  }
+  return Deepest;
+}
+
+Optional<uint32_t>
+lld::wasm::computeStackSize(ArrayRef<InputFunction *> Functions,
+                            uint32_t NumImportedFunctions, std::string &Why) {
+  StackSizeAnalysis A(Functions, NumImportedFunctions);
+  Optional<uint32_t> Size = A.run();
+  if (!Size)
+    Why = A.Why;
+  return Size;
+}
@@ -0,0 +1,33 @@
+//===- StackSize.h ----------------------------------------------*- C++ -*-===//
+//
+//                             The LLVM Linker
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_WASM_STACK_SIZE_H
+#define LLD_WASM_STACK_SIZE_H
+
+#include "lld/Common/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include <string>
+
+namespace lld {
+namespace wasm {
+
+class InputFunction;
+
+// Returns the largest number of bytes of the linear memory stack that a call
+// to any of Functions can use, or None if that cannot be bounded, in which
+// case Why is set to the reason.  Functions are the defined functions of the
+// output in function index order, following NumImportedFunctions imports.
+llvm::Optional<uint32_t> computeStackSize(ArrayRef<InputFunction *> Functions,
+                                          uint32_t NumImportedFunctions,
+                                          std::string &Why);
+
+} // namespace wasm
+} // namespace lld
+
+#endif // LLD_WASM_STACK_SIZE_H
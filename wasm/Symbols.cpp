@@ -150,11 +150,11 @@ DefinedFunction::DefinedFunction(StringRef Name, uint32_t Flags, InputFile *F,
                      Function ? &Function->Signature : nullptr),
       Function(Function) {}
 
-uint32_t DefinedData::getVirtualAddress() const {
+uint32_t DefinedData::getVirtualAddress(int64_t Addend) const {
   LLVM_DEBUG(dbgs() << "getVirtualAddress: " << getName() << "\n");
   if (Segment)
-    return Segment->OutputSeg->StartVA + Segment->OutputSegmentOffset + Offset;
-  return Offset;
+    return Segment->getVA(Offset + Addend);
+  return Offset + Addend;
 }
 
 void DefinedData::setVirtualAddress(uint32_t Value) {
@@ -202,8 +202,10 @@ public:
 
   static bool classof(const Symbol *S) { return S->kind() == DefinedDataKind; }
 
-  // Returns the output virtual address of a defined data symbol.
-  uint32_t getVirtualAddress() const;
+  // Returns the output virtual address of a defined data symbol.  The addend
+  // is resolved within the symbol's segment so that it lands on the right
+  // piece of a merged string segment.
+  uint32_t getVirtualAddress(int64_t Addend = 0) const;
   void setVirtualAddress(uint32_t VA);
 
   // Returns the offset of a defined data symbol within its OutputSegment.
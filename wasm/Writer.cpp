@@ -8,26 +8,41 @@
 //===----------------------------------------------------------------------===//
 
 #include "Writer.h"
+#include "BuildId.h"
 #include "Config.h"
+#include "CtorEval.h"
+#include "Devirtualize.h"
+#include "Dispatch.h"
 #include "InputChunks.h"
 #include "InputGlobal.h"
+#include "MapFile.h"
+#include "MarkLive.h"
 #include "OutputSections.h"
 #include "OutputSegment.h"
+#include "SnaxCache.h"
+#include "StackSize.h"
 #include "SymbolTable.h"
 #include "WriterUtils.h"
+#include "lld/Common/CallGraphSort.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
 #include "lld/Common/Threads.h"
+#include "lld/Common/Timer.h"
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/BinaryFormat/Wasm.h"
+#include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Object/WasmTraits.h"
 #include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
 
 #include <cstdarg>
 #include <map>
@@ -54,6 +69,22 @@ struct WasmInitEntry {
   uint32_t Priority;
 };
 
+// A single case of a generated dispatcher: the name value to match and the
+// function to call when it matches.  With --snax-inline-dispatch, Inline is
+// the handler whose body is written in place of the call, in which case
+// FunctionIndex is unused.
+struct DispatchEntry {
+  uint64_t Name;
+  uint32_t FunctionIndex;
+  const InputFunction *Inline;
+};
+
+// The notify handlers registered for a single code account.
+struct NotifyCodeEntry {
+  uint64_t Name;
+  std::vector<DispatchEntry> Actions;
+};
+
 // The writer writes a SymbolTable result to a file.
 class Writer {
 public:
@@ -66,15 +97,20 @@ private:
   uint32_t registerType(const WasmSignature &Sig);
 
   void createCtorFunction();
+  void calculateDispatchEntries();
   void createDispatchFunction();
+  uint64_t getDispatchKey();
   void calculateInitFunctions();
+  void snapshotCtors();
   void assignIndexes();
   void calculateImports();
   void calculateExports();
   void calculateCustomSections();
+  void resolveRelocations();
   void assignSymtab();
   void calculateTypes();
   void createOutputSegments();
+  void mergeStringSegments(ArrayRef<InputSegment *> StringSegments);
   void layoutMemory();
   void createHeader();
   void createSections();
@@ -97,37 +133,18 @@ private:
   void createRelocSections();
   void createLinkingSection();
   void createNameSection();
+  std::vector<bool> getReachableFunctions();
+  void createDispatchSection();
+  void createFunctionHashSection();
+  void createBuildIdSection();
+
+  void writeFunctionHashes();
+  void writeBuildId();
 
   void writeHeader();
   void writeSections();
-  void writeABI() {
-     if (abis.empty())
-        return;
-     try {
-        ABIMerger merger(ojson::parse(abis.back()));
-        for (auto abi : abis) {
-           merger.set_abi(merger.merge(ojson::parse(abi)));
-        }
-        SmallString<64> output_file = Config->OutputFile;
-        llvm::sys::path::replace_extension(output_file, ".abi");
-        Expected<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
-          FileOutputBuffer::create(output_file, merger.get_abi_string().size());
-
-        if (!BufferOrErr)
-          error("failed to open " + Config->OutputFile + ": " +
-                toString(BufferOrErr.takeError()));
-        else {
-          auto Buffer = std::move(*BufferOrErr);
-          memcpy(Buffer->getBufferStart(), merger.get_abi_string().c_str(), merger.get_abi_string().size());
-          if (Error E = Buffer->commit())
-             fatal("failed to write the output file: " + toString(std::move(E)));
-        }
-     } catch (std::runtime_error& err) {
-        fatal(std::string(std::string("failed to write abi: ") + err.what()).c_str());
-     } catch (jsoncons::json_exception& ex) {
-        fatal(std::string(std::string("failed to write abi") + ex.what()).c_str());
-     }
-  }
+  void mergeABI();
+  void writeABI();
 
   uint64_t FileSize = 0;
   uint32_t NumMemoryPages = 0;
@@ -146,6 +163,21 @@ private:
   std::vector<const Symbol *> SymtabEntries;
   std::vector<WasmInitEntry> InitFunctions;
   std::vector<std::string> abis;
+  std::string MergedABI;
+  std::string MergedBinaryABI;
+
+  // The merged ABI and dispatcher of the previous link, with --incremental.
+  SnaxCache *Cache = nullptr;
+
+  // The contents of each output segment after the constructors run at link
+  // time by --snax-eval-ctors.
+  std::vector<std::vector<uint8_t>> CtorSnapshot;
+
+  // Action and notify handlers, sorted by name.
+  std::vector<DispatchEntry> ActionHandlers;
+  std::vector<NotifyCodeEntry> NotifyHandlers;
+  std::vector<DispatchEntry> WildcardNotifyHandlers;
+  bool HasOnErrorHandler = false;
 
   llvm::StringMap<std::vector<InputSection *>> CustomSectionMapping;
   llvm::StringMap<SectionSymbol *> CustomSectionSymbols;
@@ -155,6 +187,9 @@ private:
   std::vector<OutputSection *> OutputSections;
 
   std::unique_ptr<FileOutputBuffer> Buffer;
+  CodeSection *CodeSec = nullptr;
+  SyntheticSection *FunctionHashSec = nullptr;
+  SyntheticSection *BuildIdSec = nullptr;
 
   std::vector<OutputSegment *> Segments;
   llvm::SmallDenseMap<StringRef, OutputSegment *> SegmentMap;
@@ -334,6 +369,25 @@ void Writer::calculateCustomSections() {
   }
 }
 
+// Computes the final relocation values of every chunk that is written to the
+// output, so that sizing and writing the sections need not look them up.
+void Writer::resolveRelocations() {
+  std::vector<InputChunk *> Chunks;
+  for (InputFunction *F : InputFunctions)
+    Chunks.push_back(F);
+  for (OutputSegment *Seg : Segments)
+    for (InputSegment *S : Seg->InputSegments)
+      Chunks.push_back(S);
+  for (auto &Pair : CustomSectionMapping)
+    for (InputSection *S : Pair.second)
+      Chunks.push_back(S);
+
+  parallelForEach(Chunks, [](InputChunk *C) {
+    if (!C->getRelocations().empty())
+      C->resolveRelocations();
+  });
+}
+
 void Writer::createCustomSections() {
   log("createCustomSections");
   for (auto &Pair : CustomSectionMapping) {
@@ -379,8 +433,8 @@ void Writer::createCodeSection() {
 
   log("createCodeSection");
 
-  auto Section = make<CodeSection>(InputFunctions);
-  OutputSections.push_back(Section);
+  CodeSec = make<CodeSection>(InputFunctions);
+  OutputSections.push_back(CodeSec);
 }
 
 void Writer::createDataSection() {
@@ -388,7 +442,7 @@ void Writer::createDataSection() {
     return;
 
   log("createDataSection");
-  auto Section = make<DataSection>(Segments);
+  auto Section = make<DataSection>(Segments, std::move(CtorSnapshot));
   OutputSections.push_back(Section);
 }
 
@@ -415,11 +469,7 @@ void Writer::createRelocSections() {
       llvm_unreachable(
           "relocations only supported for code, data, or custom sections");
 
-    SyntheticSection *Section = createSyntheticSection(WASM_SEC_CUSTOM, Name);
-    raw_ostream &OS = Section->getStream();
-    writeUleb128(OS, I, "reloc section");
-    writeUleb128(OS, Count, "reloc count");
-    OSec->writeRelocations(OS);
+    OutputSections.push_back(make<RelocSection>(Name, OSec, I));
   }
 }
 
@@ -568,44 +618,220 @@ void Writer::createLinkingSection() {
   }
 }
 
+// Returns the output indices of the functions reachable through calls and
+// table references from the exports, the entry point, the init functions,
+// the dispatch handlers and the function table.
+std::vector<bool> Writer::getReachableFunctions() {
+  std::vector<bool> Reachable(NumImportedFunctions + InputFunctions.size());
+  std::vector<uint32_t> Worklist;
+  auto Mark = [&](uint32_t Index) {
+    if (!Reachable[Index]) {
+      Reachable[Index] = true;
+      Worklist.push_back(Index);
+    }
+  };
+
+  for (const WasmExport &E : Exports)
+    if (E.Kind == WASM_EXTERNAL_FUNCTION)
+      Mark(E.Index);
+  for (const WasmInitEntry &E : InitFunctions)
+    Mark(E.Sym->getFunctionIndex());
+  for (const FunctionSymbol *Sym : IndirectFunctions)
+    Mark(Sym->getFunctionIndex());
+  // Synthetic functions, the entry point and the dispatcher among them,
+  // call without relocations, so their callees are marked directly.
+  for (const InputFunction *F : InputFunctions)
+    if (!F->File)
+      Mark(F->getFunctionIndex());
+  for (StringRef Name : getDispatcherCallees())
+    if (auto *Sym = dyn_cast_or_null<FunctionSymbol>(Symtab->find(Name)))
+      if (Sym->hasFunctionIndex())
+        Mark(Sym->getFunctionIndex());
+  auto MarkHandlers = [&](ArrayRef<DispatchEntry> Entries) {
+    for (const DispatchEntry &E : Entries) {
+      if (!E.Inline) {
+        Mark(E.FunctionIndex);
+        continue;
+      }
+      for (const WasmRelocation &Rel : E.Inline->getRelocations())
+        Mark(E.Inline->File->calcNewValue(Rel));
+    }
+  };
+  MarkHandlers(ActionHandlers);
+  MarkHandlers(WildcardNotifyHandlers);
+  for (const NotifyCodeEntry &C : NotifyHandlers)
+    MarkHandlers(C.Actions);
+
+  while (!Worklist.empty()) {
+    uint32_t Index = Worklist.back();
+    Worklist.pop_back();
+    if (Index < NumImportedFunctions)
+      continue;
+    const InputFunction *F = InputFunctions[Index - NumImportedFunctions];
+    for (const WasmRelocation &Rel : F->getRelocations()) {
+      switch (Rel.Type) {
+      case R_WEBASSEMBLY_FUNCTION_INDEX_LEB:
+      case R_WEBASSEMBLY_TABLE_INDEX_SLEB:
+      case R_WEBASSEMBLY_TABLE_INDEX_I32: {
+        FunctionSymbol *Sym = F->File->getFunctionSymbol(Rel.Index);
+        if (Sym->hasFunctionIndex())
+          Mark(Sym->getFunctionIndex());
+        break;
+      }
+      default:
+        break;
+      }
+    }
+  }
+  return Reachable;
+}
+
 // Create the custom "name" section containing debug symbol names.
 void Writer::createNameSection() {
-  unsigned NumNames = NumImportedFunctions;
-  for (const InputFunction *F : InputFunctions)
-    if (!F->getName().empty() || !F->getDebugName().empty())
-      ++NumNames;
+  struct NameEntry {
+    uint32_t Index;
+    StringRef Name;
+    bool Demangle;
+  };
 
-  if (NumNames == 0)
+  // Names must appear in function index order.  As it happens ImportedSymbols
+  // and InputFunctions are numbered in order with imported functions coming
+  // first.
+  std::vector<NameEntry> Entries;
+  for (const Symbol *S : ImportedSymbols)
+    if (auto *F = dyn_cast<FunctionSymbol>(S))
+      Entries.push_back({F->getFunctionIndex(), F->getName(), true});
+
+  std::vector<bool> Reachable;
+  if (Config->PruneNameSection)
+    Reachable = getReachableFunctions();
+  for (const InputFunction *F : InputFunctions) {
+    if (F->getName().empty())
+      continue;
+    if (Config->PruneNameSection && !Reachable[F->getFunctionIndex()])
+      continue;
+    if (!F->getDebugName().empty())
+      Entries.push_back({F->getFunctionIndex(), F->getDebugName(), false});
+    else
+      Entries.push_back({F->getFunctionIndex(), F->getName(), true});
+  }
+
+  if (Entries.empty())
     return;
 
+  // Demangling dominates the cost of this section for C++ inputs, so do it
+  // up front in parallel.
+  std::vector<std::string> Names(Entries.size());
+  parallelForEachN(0, Entries.size(), [&](size_t I) {
+    Optional<std::string> Name;
+    if (Entries[I].Demangle)
+      Name = demangleItanium(Entries[I].Name);
+    Names[I] = Name ? std::move(*Name) : Entries[I].Name.str();
+  });
+
   SyntheticSection *Section = createSyntheticSection(WASM_SEC_CUSTOM, "name");
 
   SubSection Sub(WASM_NAMES_FUNCTION);
-  writeUleb128(Sub.OS, NumNames, "name count");
+  writeUleb128(Sub.OS, Entries.size(), "name count");
+  for (size_t I = 0, E = Entries.size(); I != E; ++I) {
+    writeUleb128(Sub.OS, Entries[I].Index, "func index");
+    writeStr(Sub.OS, Names[I], "symbol name");
+  }
 
-  // Names must appear in function index order.  As it happens ImportedSymbols
-  // and InputFunctions are numbered in order with imported functions coming
-  // first.
-  for (const Symbol *S : ImportedSymbols) {
-    if (auto *F = dyn_cast<FunctionSymbol>(S)) {
-      writeUleb128(Sub.OS, F->getFunctionIndex(), "func index");
-      Optional<std::string> Name = demangleItanium(F->getName());
-      writeStr(Sub.OS, Name ? StringRef(*Name) : F->getName(), "symbol name");
-    }
+  Sub.writeTo(Section->getStream());
+}
+
+// Create the custom "snax.dispatch" section.  It records the function that
+// handles each action and notification so that a VM can call the handler
+// directly instead of running the generated dispatcher.  Layout:
+//
+//   version              uleb
+//   action count         uleb
+//     action name        u64
+//     function index     uleb
+//   notify count         uleb
+//     code name          u64 (0 for the "*" wildcard)
+//     action name        u64
+//     function index     uleb
+void Writer::createDispatchSection() {
+  if (ActionHandlers.empty() && NotifyHandlers.empty() &&
+      WildcardNotifyHandlers.empty())
+    return;
+
+  SyntheticSection *Section =
+      createSyntheticSection(WASM_SEC_CUSTOM, "snax.dispatch");
+  raw_ostream &OS = Section->getStream();
+
+  writeUleb128(OS, 1, "version");
+  writeUleb128(OS, ActionHandlers.size(), "action count");
+  for (const DispatchEntry &E : ActionHandlers) {
+    writeU64(OS, E.Name, "action name");
+    writeUleb128(OS, E.FunctionIndex, "function index");
   }
-  for (const InputFunction *F : InputFunctions) {
-    if (!F->getName().empty()) {
-      writeUleb128(Sub.OS, F->getFunctionIndex(), "func index");
-      if (!F->getDebugName().empty()) {
-        writeStr(Sub.OS, F->getDebugName(), "symbol name");
-      } else {
-        Optional<std::string> Name = demangleItanium(F->getName());
-        writeStr(Sub.OS, Name ? StringRef(*Name) : F->getName(), "symbol name");
-      }
+
+  uint32_t NumNotify = WildcardNotifyHandlers.size();
+  for (const NotifyCodeEntry &C : NotifyHandlers)
+    NumNotify += C.Actions.size();
+  writeUleb128(OS, NumNotify, "notify count");
+  for (const NotifyCodeEntry &C : NotifyHandlers) {
+    for (const DispatchEntry &E : C.Actions) {
+      writeU64(OS, C.Name, "code name");
+      writeU64(OS, E.Name, "action name");
+      writeUleb128(OS, E.FunctionIndex, "function index");
     }
   }
+  for (const DispatchEntry &E : WildcardNotifyHandlers) {
+    writeU64(OS, 0, "code name");
+    writeU64(OS, E.Name, "action name");
+    writeUleb128(OS, E.FunctionIndex, "function index");
+  }
+}
 
-  Sub.writeTo(Section->getStream());
+// Create the custom "snax.function_hashes" section, which lets a VM reuse
+// the machine code of functions that did not change between two versions
+// of a contract, or that two contracts share.  Its layout is
+//
+//   version                uleb
+//   first function index   uleb
+//   function count         uleb
+//     hash                 32 bytes, in function index order
+//
+// The hashes are computed by CodeSection::writeTo and copied in by
+// writeFunctionHashes().
+void Writer::createFunctionHashSection() {
+  FunctionHashSec =
+      createSyntheticSection(WASM_SEC_CUSTOM, "snax.function_hashes");
+  raw_ostream &OS = FunctionHashSec->getStream();
+  writeUleb128(OS, 1, "version");
+  writeUleb128(OS, NumImportedFunctions, "first function index");
+  writeUleb128(OS, InputFunctions.size(), "function count");
+  OS << std::string(InputFunctions.size() * 32, '\0');
+}
+
+void Writer::writeFunctionHashes() {
+  ArrayRef<std::array<uint8_t, 32>> Hashes = CodeSec->getFunctionHashes();
+  uint8_t *Dest = Buffer->getBufferStart() + FunctionHashSec->getOffset() +
+                  FunctionHashSec->getSize() - Hashes.size() * 32;
+  for (const std::array<uint8_t, 32> &Hash : Hashes) {
+    memcpy(Dest, Hash.data(), Hash.size());
+    Dest += Hash.size();
+  }
+}
+
+// Create the custom "build_id" section.  It is the last section of the
+// output and its payload, the raw hash, is filled in by writeBuildId().
+void Writer::createBuildIdSection() {
+  BuildIdSec = createSyntheticSection(WASM_SEC_CUSTOM, "build_id");
+  BuildIdSec->getStream() << std::string(getBuildIdSize(), '\0');
+}
+
+// Hash the output, with the build id still zeroed, into the build_id
+// section.
+void Writer::writeBuildId() {
+  uint8_t *Start = Buffer->getBufferStart();
+  uint8_t *Dest = Start + BuildIdSec->getOffset() + BuildIdSec->getSize() -
+                  getBuildIdSize();
+  computeBuildId(makeArrayRef(Start, FileSize), Dest);
 }
 
 void Writer::writeHeader() {
@@ -617,13 +843,220 @@ void Writer::writeSections() {
   parallelForEach(OutputSections, [Buf](OutputSection *S) { S->writeTo(Buf); });
 }
 
+// Convert a name to its 64-bit value without allocating.  Names are at most
+// 13 characters long, anything beyond that is ignored by string_to_name.
+static uint64_t toSnaxName(StringRef Name) {
+  char Buf[14];
+  size_t Len = std::min(Name.size(), sizeof(Buf) - 1);
+  memcpy(Buf, Name.data(), Len);
+  Buf[Len] = '\0';
+  return snax::cdt::string_to_name(Buf);
+}
+
+// The following functions write an ABI in the packed binary form of abi_def
+// that is stored on chain, so that tools can deploy it without converting the
+// JSON themselves.  Strings and vectors are prefixed with a varuint32 length
+// and names are written as little-endian 64-bit values.  Missing keys are
+// written as empty values.
+static std::string getABIString(const ojson &J, const char *Key) {
+  if (!J.count(Key))
+    return "";
+  return J[Key].as<std::string>();
+}
+
+static void packString(raw_ostream &OS, const std::string &S) {
+  encodeULEB128(S.size(), OS);
+  OS << S;
+}
+
+static void packString(raw_ostream &OS, const ojson &J, const char *Key) {
+  packString(OS, getABIString(J, Key));
+}
+
+static void packName(raw_ostream &OS, const ojson &J, const char *Key) {
+  support::endian::write<uint64_t>(OS, toSnaxName(getABIString(J, Key)),
+                                   support::little);
+}
+
+template <typename FnT>
+static void packArray(raw_ostream &OS, const ojson &J, const char *Key,
+                      FnT Fn) {
+  if (!J.count(Key) || !J[Key].is_array()) {
+    encodeULEB128(0, OS);
+    return;
+  }
+  const ojson &A = J[Key];
+  encodeULEB128(A.size(), OS);
+  for (const ojson &E : A.array_range())
+    Fn(E);
+}
+
+static void packStringArray(raw_ostream &OS, const ojson &J, const char *Key) {
+  packArray(OS, J, Key,
+            [&](const ojson &E) { packString(OS, E.as<std::string>()); });
+}
+
+static void packABI(raw_ostream &OS, const ojson &ABI) {
+  packString(OS, ABI, "version");
+  packArray(OS, ABI, "types", [&](const ojson &T) {
+    packString(OS, T, "new_type_name");
+    packString(OS, T, "type");
+  });
+  packArray(OS, ABI, "structs", [&](const ojson &S) {
+    packString(OS, S, "name");
+    packString(OS, S, "base");
+    packArray(OS, S, "fields", [&](const ojson &F) {
+      packString(OS, F, "name");
+      packString(OS, F, "type");
+    });
+  });
+  packArray(OS, ABI, "actions", [&](const ojson &A) {
+    packName(OS, A, "name");
+    packString(OS, A, "type");
+    packString(OS, A, "ricardian_contract");
+  });
+  packArray(OS, ABI, "tables", [&](const ojson &T) {
+    packName(OS, T, "name");
+    packString(OS, T, "index_type");
+    packStringArray(OS, T, "key_names");
+    packStringArray(OS, T, "key_types");
+    packString(OS, T, "type");
+  });
+  packArray(OS, ABI, "ricardian_clauses", [&](const ojson &C) {
+    packString(OS, C, "id");
+    packString(OS, C, "body");
+  });
+  packArray(OS, ABI, "error_messages", [&](const ojson &E) {
+    support::endian::write<uint64_t>(OS, E["error_code"].as<uint64_t>(),
+                                     support::little);
+    packString(OS, E, "error_msg");
+  });
+  // The linker never produces abi_extensions, so always write an empty list.
+  encodeULEB128(0, OS);
+  packArray(OS, ABI, "variants", [&](const ojson &V) {
+    packString(OS, V, "name");
+    packStringArray(OS, V, "types");
+  });
+}
+
+static void writeSidecarFile(StringRef Path, StringRef Data) {
+  Expected<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
+      FileOutputBuffer::create(Path, Data.size());
+  if (!BufferOrErr) {
+    error("failed to open " + Path + ": " + toString(BufferOrErr.takeError()));
+    return;
+  }
+
+  std::unique_ptr<FileOutputBuffer> Buffer = std::move(*BufferOrErr);
+  memcpy(Buffer->getBufferStart(), Data.data(), Data.size());
+  if (Error E = Buffer->commit())
+    fatal("failed to write the output file: " + toString(std::move(E)));
+}
+
+// Merge the ABI fragments embedded in the input objects into MergedABI and,
+// with --snax-binary-abi, MergedBinaryABI.  Objects often embed identical
+// fragments, so each distinct fragment is parsed only once, and the parsing
+// runs in parallel.
+//
+// The merge itself stays serial and in the order it has always had: start
+// from the last fragment, then merge each one in input order.  The merger
+// keeps the entries it already has and appends new ones, so this order
+// decides which entries come first in the output.  Merging a fragment
+// again adds nothing (the last one always was merged twice), so each
+// distinct fragment is merged once.
+void Writer::mergeABI() {
+  if (abis.empty() || !MergedABI.empty())
+    return;
+
+  std::vector<const std::string *> Unique;
+  DenseSet<CachedHashStringRef> Seen;
+  for (const std::string &ABI : abis)
+    if (Seen.insert(CachedHashStringRef(ABI)).second)
+      Unique.push_back(&ABI);
+
+  // Exceptions must not escape the worker threads, so remember the message
+  // of each failed task and report the first one afterwards.
+  std::vector<std::string> Errors;
+  auto RunTasks = [&](size_t N, std::function<void(size_t)> Task) {
+    Errors.assign(N, "");
+    parallelForEachN(0, N, [&](size_t I) {
+      try {
+        Task(I);
+      } catch (std::runtime_error &Err) {
+        Errors[I] = Err.what();
+      } catch (jsoncons::json_exception &Ex) {
+        Errors[I] = Ex.what();
+      }
+    });
+    for (const std::string &E : Errors)
+      if (!E.empty())
+        fatal("failed to write abi: " + E);
+  };
+
+  // The merged ABI depends only on the fragments and their order.
+  uint64_t Key = 0;
+  if (Cache) {
+    std::string Hashes = Config->BinaryABI ? "binary" : "json";
+    for (const std::string &ABI : abis)
+      Hashes += " " + utohexstr(xxHash64(ABI));
+    Key = xxHash64(Hashes);
+    Optional<StringRef> JSON = Cache->lookup("abi", Key);
+    Optional<StringRef> Binary = Cache->lookup("abi.bin", Key);
+    if (JSON && Binary) {
+      log("snax cache: reusing the merged ABI");
+      MergedABI = *JSON;
+      MergedBinaryABI = *Binary;
+      return;
+    }
+  }
+
+  std::vector<ojson> Parsed(Unique.size());
+  RunTasks(Unique.size(), [&](size_t I) { Parsed[I] = ojson::parse(*Unique[I]); });
+
+  size_t Last = 0;
+  while (*Unique[Last] != abis.back())
+    ++Last;
+
+  RunTasks(1, [&](size_t) {
+    ojson Merged = Parsed[Last];
+    for (const ojson &ABI : Parsed)
+      Merged = ABIMerger(Merged).merge(ABI);
+    MergedABI = ABIMerger(Merged).get_abi_string();
+    if (Config->BinaryABI) {
+      raw_string_ostream OS(MergedBinaryABI);
+      packABI(OS, Merged);
+    }
+  });
+
+  if (Cache) {
+    Cache->insert("abi", Key, MergedABI);
+    Cache->insert("abi.bin", Key, MergedBinaryABI);
+  }
+}
+
+// Write the merged ABI next to the output file.
+void Writer::writeABI() {
+  if (abis.empty())
+    return;
+  mergeABI();
+
+  SmallString<64> OutputFile = Config->OutputFile;
+  llvm::sys::path::replace_extension(OutputFile, ".abi");
+  writeSidecarFile(OutputFile, MergedABI);
+  if (Config->BinaryABI) {
+    OutputFile += ".bin";
+    writeSidecarFile(OutputFile, MergedBinaryABI);
+  }
+}
+
 // Fix the memory layout of the output binary.  This assigns memory offsets
 // to each of the input data sections as well as the explicit stack region.
 // The default memory layout is as follows, from low to high.
 //
 //  - initialized data (starting at Config->GlobalBase)
 //  - BSS data (not currently implemented in llvm)
-//  - explicit stack (Config->ZStackSize)
+//  - explicit stack (Config->ZStackSize, or the size computed by
+//    --auto-stack-size)
 //  - heap start / unallocated
 //
 // The --stack-first option means that stack is placed before any static data.
@@ -633,6 +1066,19 @@ void Writer::writeSections() {
 void Writer::layoutMemory() {
   createOutputSegments();
 
+  if (Config->AutoStackSize && !Config->Relocatable) {
+    std::string Why;
+    if (Optional<uint32_t> Size =
+            computeStackSize(InputFunctions, NumImportedFunctions, Why)) {
+      log("--auto-stack-size: deepest call path uses " + Twine(*Size) +
+          " bytes of stack");
+      Config->ZStackSize = alignTo(*Size, kStackAlignment);
+    } else {
+      warn("--auto-stack-size: cannot bound the stack size: " + Why +
+           "; using " + Twine(Config->ZStackSize) + " bytes");
+    }
+  }
+
   uint32_t MemoryPtr = 0;
 
   auto PlaceStack = [&]() {
@@ -738,6 +1184,12 @@ void Writer::createSections() {
   }
   if (!Config->StripDebug && !Config->StripAll)
     createNameSection();
+  if (Config->DispatchSection && !Config->Relocatable)
+    createDispatchSection();
+  if (Config->FunctionHashes && CodeSec && !Config->Relocatable)
+    createFunctionHashSection();
+  if (Config->BuildId != BuildIdKind::None)
+    createBuildIdSection();
 
   for (OutputSection *S : OutputSections) {
     S->setOffset(FileSize);
@@ -746,7 +1198,50 @@ void Writer::createSections() {
   }
 }
 
+// Returns the symbols referenced by relocations of chunks that will be
+// written to the output, plus those the generated dispatcher calls.
+static DenseSet<const Symbol *> collectReferencedSymbols() {
+  DenseSet<const Symbol *> Referenced;
+  auto Visit = [&](const InputChunk *Chunk) {
+    for (const WasmRelocation &Reloc : Chunk->getRelocations())
+      if (Reloc.Type != R_WEBASSEMBLY_TYPE_INDEX_LEB)
+        Referenced.insert(Chunk->File->getSymbol(Reloc.Index));
+  };
+
+  for (const ObjFile *File : Symtab->ObjectFiles) {
+    for (const InputChunk *Chunk : File->Functions)
+      if (Chunk->Live)
+        Visit(Chunk);
+    for (const InputChunk *Chunk : File->Segments)
+      if (Chunk->Live)
+        Visit(Chunk);
+    for (const InputChunk *Chunk : File->CustomSections)
+      Visit(Chunk);
+  }
+
+  if (Symtab->EntryIsUndefined) {
+    for (StringRef Name : getDispatcherCallees())
+      if (const Symbol *Sym = Symtab->find(Name))
+        Referenced.insert(Sym);
+    // Inlined handlers are dead, but their calls end up in the dispatcher.
+    for (StringRef Name : getDispatchHandlerNames())
+      if (const InputFunction *F = getInlinableHandler(Symtab->find(Name)))
+        Visit(F);
+  }
+  return Referenced;
+}
+
 void Writer::calculateImports() {
+  // Undefined symbols that are not hidden are GC roots, so they remain live
+  // even when no live code refers to them.  When garbage collecting a final
+  // link, only import those that are actually referenced; the type section
+  // then only gets their signatures.
+  bool Prune = Config->GcSections && !Config->Relocatable;
+  DenseSet<const Symbol *> Referenced;
+  if (Prune)
+    Referenced = collectReferencedSymbols();
+
+  std::vector<Symbol *> Imports;
   for (Symbol *Sym : Symtab->getSymbols()) {
     if (!Sym->isUndefined())
       continue;
@@ -758,9 +1253,29 @@ void Writer::calculateImports() {
       continue;
     if (!Sym->IsUsedInRegularObj)
       continue;
+    // Symbols with no file were named on the command line with -u.
+    if (Prune && Sym->getFile() && !Referenced.count(Sym))
+      continue;
 
     LLVM_DEBUG(dbgs() << "import: " << Sym->getName() << "\n");
-    ImportedSymbols.emplace_back(Sym);
+    Imports.push_back(Sym);
+  }
+
+  // All imports come from the "env" module and are named after their symbol,
+  // so sorting by kind and name is enough to give each module a contiguous,
+  // sorted run of imports.
+  if (Config->SortImports)
+    std::stable_sort(Imports.begin(), Imports.end(),
+                     [](const Symbol *A, const Symbol *B) {
+                       bool AIsFunction = isa<FunctionSymbol>(A);
+                       bool BIsFunction = isa<FunctionSymbol>(B);
+                       if (AIsFunction != BIsFunction)
+                         return AIsFunction;
+                       return A->getName() < B->getName();
+                     });
+
+  for (Symbol *Sym : Imports) {
+    ImportedSymbols.push_back(Sym);
     if (auto *F = dyn_cast<FunctionSymbol>(Sym))
       F->setFunctionIndex(NumImportedFunctions++);
     else
@@ -897,6 +1412,87 @@ void Writer::calculateTypes() {
     registerType(F->Signature);
 }
 
+// Sort functions by the call graph in Config->CallGraphProfile.  Reordering
+// functions in the code section also reassigns their function indices, so
+// callers and their hot callees end up both adjacent and in nearby index
+// ranges.
+static DenseMap<const InputFunction *, int> computeCallGraphProfileOrder() {
+  std::vector<const InputFunction *> Functions;
+  std::vector<uint64_t> Sizes;
+  std::vector<CallGraphArc> Arcs;
+  DenseMap<const InputFunction *, int> FuncToNode;
+
+  auto GetOrCreateNode = [&](const InputFunction *F) -> int {
+    auto Res = FuncToNode.insert(std::make_pair(F, Functions.size()));
+    if (Res.second) {
+      Functions.push_back(F);
+      Sizes.push_back(F->getInputBody().size());
+    }
+    return Res.first->second;
+  };
+
+  for (const auto &C : Config->CallGraphProfile) {
+    int From = GetOrCreateNode(C.first.first);
+    int To = GetOrCreateNode(C.first.second);
+    Arcs.push_back({From, To, C.second});
+  }
+
+  DenseMap<const InputFunction *, int> OrderMap;
+  int CurOrder = 1;
+  for (int I : sortCallGraph(Sizes, Arcs, CallGraphSortOptions()))
+    OrderMap[Functions[I]] = CurOrder++;
+  return OrderMap;
+}
+
+// Builds the order in which functions from input files are placed in the
+// code section, either from the call graph or from --symbol-ordering-file.
+// Functions that are not in the returned map keep their input order after
+// all ordered functions.
+static DenseMap<const InputFunction *, int> buildFunctionOrder() {
+  if (!Config->CallGraphProfile.empty())
+    return computeCallGraphProfileOrder();
+
+  DenseMap<const InputFunction *, int> FunctionOrder;
+  if (Config->SymbolOrderingFile.empty())
+    return FunctionOrder;
+
+  // Build a map from symbols to their priorities.  Symbols that appear
+  // earlier in the symbol ordering file have lower priorities.
+  DenseMap<StringRef, std::pair<int, bool>> SymbolOrder;
+  int Priority = 0;
+  for (StringRef S : Config->SymbolOrderingFile)
+    SymbolOrder.insert({S, {Priority++, false}});
+
+  auto AddSym = [&](Symbol *Sym) {
+    auto It = SymbolOrder.find(Sym->getName());
+    if (It == SymbolOrder.end())
+      return;
+    It->second.second = true;
+    auto *F = dyn_cast<DefinedFunction>(Sym);
+    if (!F || !F->Function || !F->Function->File) {
+      warn("symbol ordering file: unable to order non-function symbol: " +
+           toString(*Sym));
+      return;
+    }
+    auto Res = FunctionOrder.insert({F->Function, It->second.first});
+    if (!Res.second)
+      Res.first->second = std::min(Res.first->second, It->second.first);
+  };
+
+  for (Symbol *Sym : Symtab->getSymbols())
+    if (!Sym->isLazy())
+      AddSym(Sym);
+  for (ObjFile *File : Symtab->ObjectFiles)
+    for (Symbol *Sym : File->getSymbols())
+      if (Sym->isLocal())
+        AddSym(Sym);
+
+  for (auto &Entry : SymbolOrder)
+    if (!Entry.second.second)
+      warn("symbol ordering file: no such symbol: " + Entry.first);
+  return FunctionOrder;
+}
+
 void Writer::assignIndexes() {
   uint32_t FunctionIndex = NumImportedFunctions + InputFunctions.size();
   auto AddDefinedFunction = [&](InputFunction *Func) {
@@ -909,26 +1505,54 @@ void Writer::assignIndexes() {
   for (InputFunction *Func : Symtab->SyntheticFunctions)
     AddDefinedFunction(Func);
 
+  std::vector<InputFunction *> Functions;
   for (ObjFile *File : Symtab->ObjectFiles) {
     LLVM_DEBUG(dbgs() << "Functions: " << File->getName() << "\n");
-    for (InputFunction *Func : File->Functions)
-      AddDefinedFunction(Func);
+    Functions.insert(Functions.end(), File->Functions.begin(),
+                     File->Functions.end());
   }
 
-  uint32_t TableIndex = kInitialTableOffset;
+  DenseMap<const InputFunction *, int> Order = buildFunctionOrder();
+  if (!Order.empty()) {
+    auto End = std::stable_partition(
+        Functions.begin(), Functions.end(),
+        [&](InputFunction *F) { return Order.count(F); });
+    std::stable_sort(Functions.begin(), End,
+                     [&](InputFunction *A, InputFunction *B) {
+                       return Order.lookup(A) < Order.lookup(B);
+                     });
+  }
+
+  for (InputFunction *Func : Functions)
+    AddDefinedFunction(Func);
+
+  // Only address-taken functions referenced from live chunks get a table
+  // entry. A defined function gets one entry however many symbols refer to
+  // it, so entries are keyed by the function.
+  std::vector<FunctionSymbol *> TableEntries;
+  DenseSet<const void *> SeenTableEntries;
   auto HandleRelocs = [&](InputChunk *Chunk) {
     if (!Chunk->Live)
       return;
     ObjFile *File = Chunk->File;
     ArrayRef<WasmSignature> Types = File->getWasmObj()->types();
-    for (const WasmRelocation &Reloc : Chunk->getRelocations()) {
+    ArrayRef<WasmRelocation> Relocs = Chunk->getRelocations();
+    for (size_t I = 0, E = Relocs.size(); I != E; ++I) {
+      const WasmRelocation &Reloc = Relocs[I];
       if (Reloc.Type == R_WEBASSEMBLY_TABLE_INDEX_I32 ||
           Reloc.Type == R_WEBASSEMBLY_TABLE_INDEX_SLEB) {
+        // An index that --devirtualize removed needs no table entry.
+        const CallRewrite *R = Chunk->getRewrite(I);
+        if (R && R->K == CallRewrite::DropIndex)
+          continue;
         FunctionSymbol *Sym = File->getFunctionSymbol(Reloc.Index);
         if (Sym->hasTableIndex() || !Sym->hasFunctionIndex())
           continue;
-        Sym->setTableIndex(TableIndex++);
-        IndirectFunctions.emplace_back(Sym);
+        const void *Key = Sym;
+        if (auto *F = dyn_cast<DefinedFunction>(Sym))
+          Key = F->Function;
+        if (SeenTableEntries.insert(Key).second)
+          TableEntries.push_back(Sym);
       } else if (Reloc.Type == R_WEBASSEMBLY_TYPE_INDEX_LEB) {
         // Mark target type as live
         File->TypeMap[Reloc.Index] = registerType(Types[Reloc.Index]);
@@ -947,6 +1571,27 @@ void Writer::assignIndexes() {
       HandleRelocs(P);
   }
 
+  // Entries with the same signature are made adjacent, in order of first
+  // use, so that the signature checks of call_indirect touch fewer distinct
+  // type entries.
+  if (Config->SortTable) {
+    DenseMap<WasmSignature, uint32_t> Groups;
+    for (const FunctionSymbol *Sym : TableEntries)
+      Groups.insert({*Sym->getFunctionType(), Groups.size()});
+    std::stable_sort(TableEntries.begin(), TableEntries.end(),
+                     [&](const FunctionSymbol *A, const FunctionSymbol *B) {
+                       return Groups.lookup(*A->getFunctionType()) <
+                              Groups.lookup(*B->getFunctionType());
+                     });
+  }
+
+  uint32_t TableIndex = kInitialTableOffset;
+  for (FunctionSymbol *Sym : TableEntries) {
+    Sym->setTableIndex(TableIndex++);
+    IndirectFunctions.push_back(Sym);
+  }
+  log("Table entries: " + Twine(IndirectFunctions.size()));
+
   uint32_t GlobalIndex = NumImportedGlobals + InputGlobals.size();
   auto AddDefinedGlobal = [&](InputGlobal *Global) {
     if (Global->Live) {
@@ -978,13 +1623,70 @@ static StringRef getOutputDataSegmentName(StringRef Name) {
   return Name;
 }
 
+// Split all mergeable string segments into pieces, deduplicate the pieces
+// and write them to a single ".rodata.str" input segment.  It is placed at the
+// end of the ".rodata" output segment, so merging never adds a data segment
+// to a module that already has read-only data.  With -O2 or higher strings
+// that are suffixes of other strings share their storage too.
+void Writer::mergeStringSegments(ArrayRef<InputSegment *> StringSegments) {
+  StringTableBuilder Builder(StringTableBuilder::RAW);
+  size_t InputSize = 0;
+  for (InputSegment *Segment : StringSegments) {
+    Segment->splitIntoPieces();
+    for (size_t I = 0, E = Segment->Pieces.size(); I != E; ++I)
+      Builder.add(Segment->getPieceData(I));
+    InputSize += Segment->getSize();
+  }
+
+  if (Config->Optimize >= 2)
+    Builder.finalize();
+  else
+    Builder.finalizeInOrder();
+
+  size_t Size = Builder.getSize();
+  uint8_t *Buf = BAlloc.Allocate<uint8_t>(Size);
+  Builder.write(Buf);
+
+  auto *Seg = make<WasmSegment>();
+  Seg->Data.Name = ".rodata.str";
+  Seg->Data.Alignment = 1;
+  Seg->Data.Comdat = UINT32_MAX;
+  Seg->Data.Content = makeArrayRef(Buf, Size);
+  auto *Merged = make<InputSegment>(*Seg, nullptr);
+  Merged->Live = true;
+
+  for (InputSegment *Segment : StringSegments) {
+    Segment->MergedInto = Merged;
+    for (size_t I = 0, E = Segment->Pieces.size(); I != E; ++I)
+      Segment->Pieces[I].OutputOff =
+          Builder.getOffset(Segment->getPieceData(I));
+  }
+
+  log("merged " + Twine(StringSegments.size()) + " string segments: " +
+      Twine(InputSize) + " -> " + Twine(Size) + " bytes");
+
+  OutputSegment *&S = SegmentMap[".rodata"];
+  if (S == nullptr) {
+    S = make<OutputSegment>(".rodata", Segments.size());
+    Segments.push_back(S);
+  }
+  S->addInputSegment(Merged);
+}
+
 void Writer::createOutputSegments() {
+  bool MergeStrings = Config->MergeDataSegments && !Config->Relocatable;
+  std::vector<InputSegment *> StringSegments;
+
   for (ObjFile *File : Symtab->ObjectFiles) {
     if (!File->getSnaxABI().empty())
        abis.push_back(File->getSnaxABI());
     for (InputSegment *Segment : File->Segments) {
       if (!Segment->Live)
         continue;
+      if (MergeStrings && Segment->isMergeableString()) {
+        StringSegments.push_back(Segment);
+        continue;
+      }
       StringRef Name = getOutputDataSegmentName(Segment->getName());
       OutputSegment *&S = SegmentMap[Name];
       if (S == nullptr) {
@@ -996,84 +1698,235 @@ void Writer::createOutputSegments() {
       LLVM_DEBUG(dbgs() << "added data: " << Name << ": " << S->Size << "\n");
     }
   }
+
+  if (!StringSegments.empty())
+    mergeStringSegments(StringSegments);
 }
 
 static constexpr int OPCODE_CALL = 0x10;
+static constexpr int OPCODE_BLOCK = 0x2;
 static constexpr int OPCODE_IF   = 0x4;
 static constexpr int OPCODE_ELSE = 0x5;
 static constexpr int OPCODE_END  = 0xb;
+static constexpr int OPCODE_BR   = 0xc;
 static constexpr int OPCODE_GET_LOCAL = 0x20;
 static constexpr int OPCODE_I32_EQ    = 0x46;
 static constexpr int OPCODE_I64_EQ    = 0x51;
 static constexpr int OPCODE_I64_NE    = 0x52;
+static constexpr int OPCODE_I64_LT_U  = 0x54;
 static constexpr int OPCODE_I32_CONST = 0x41;
 static constexpr int OPCODE_I64_CONST = 0x42;
 static constexpr uint64_t SNAX_COMPILER_ERROR_BASE = 8000000000000000000ull;
 static constexpr uint64_t SNAX_ERROR_NO_ACTION     = SNAX_COMPILER_ERROR_BASE;
 static constexpr uint64_t SNAX_ERROR_ONERROR       = SNAX_COMPILER_ERROR_BASE+1;
 
-void Writer::createDispatchFunction() {
+// Dispatch tables with at most this many entries are emitted as a linear
+// chain of compares.  Beyond that a binary search over the sorted names costs
+// fewer compares per call than the chain.
+static constexpr size_t kLinearDispatchLimit = 4;
+
+// Sort dispatch entries by name so they can be searched.  If the same name is
+// registered twice the first registration wins, which matches the behaviour
+// of the original linear if/else chain.
+static void sortDispatchEntries(std::vector<DispatchEntry> &Entries) {
+  std::stable_sort(Entries.begin(), Entries.end(),
+                   [](const DispatchEntry &A, const DispatchEntry &B) {
+                     return A.Name < B.Name;
+                   });
+  Entries.erase(std::unique(Entries.begin(), Entries.end(),
+                            [](const DispatchEntry &A, const DispatchEntry &B) {
+                              return A.Name == B.Name;
+                            }),
+                Entries.end());
+}
 
-   auto get_function = [&](std::string func_name) -> int64_t {
-      for (ObjFile *File : Symtab->ObjectFiles) {
-         for (auto func : File->Functions) {
-            if (func->getName().str() == func_name) {
-               return func->getFunctionIndex();
-            }
-         }
-      }
-      return -1;
-   };
+// Write the call of a dispatch handler with (receiver, code) as arguments,
+// or the handler's body if it is inlined.
+static void writeDispatchCall(raw_ostream &OS, const DispatchEntry &E) {
+  if (E.Inline) {
+    writeInlinedHandler(OS, E.Inline);
+    return;
+  }
+  writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
+  writeUleb128(OS, 0, "receiver");
+  writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
+  writeUleb128(OS, 1, "code");
+  writeU8(OS, OPCODE_CALL, "CALL");
+  writeUleb128(OS, E.FunctionIndex, "index");
+}
+
+// Write a search over `Entries` (sorted by name) for the value held in local
+// `Local`.  `Depth` is the number of labels between the emitted code and the
+// enclosing block that ends the dispatch.  On a match `OnMatch(Entry, Depth)`
+// writes the body for that entry after which control branches to the end of
+// the dispatch block.  On a miss control falls through past the emitted code.
+template <typename EntryT, typename FnT>
+static void writeNameSearch(raw_ostream &OS, ArrayRef<EntryT> Entries,
+                            uint32_t Local, uint32_t Depth, FnT OnMatch) {
+  if (Entries.size() <= kLinearDispatchLimit) {
+    for (const EntryT &E : Entries) {
+      writeU8(OS, OPCODE_I64_CONST, "I64 CONST");
+      encodeSLEB128((int64_t)E.Name, OS);
+      writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
+      writeUleb128(OS, Local, "name");
+      writeU8(OS, OPCODE_I64_EQ, "I64_EQ");
+      writeU8(OS, OPCODE_IF, "IF name == entry");
+      writeU8(OS, 0x40, "none");
+      OnMatch(E, Depth + 1);
+      writeU8(OS, OPCODE_BR, "BR");
+      writeUleb128(OS, Depth + 1, "dispatch done");
+      writeU8(OS, OPCODE_END, "END");
+    }
+    return;
+  }
+
+  // Split on the middle entry: names below it are searched in the "then" arm
+  // and the rest, including the pivot itself, in the "else" arm.
+  size_t Mid = Entries.size() / 2;
+  writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
+  writeUleb128(OS, Local, "name");
+  writeU8(OS, OPCODE_I64_CONST, "I64 CONST");
+  encodeSLEB128((int64_t)Entries[Mid].Name, OS);
+  writeU8(OS, OPCODE_I64_LT_U, "I64_LT_U");
+  writeU8(OS, OPCODE_IF, "IF name < pivot");
+  writeU8(OS, 0x40, "none");
+  writeNameSearch(OS, Entries.slice(0, Mid), Local, Depth + 1, OnMatch);
+  writeU8(OS, OPCODE_ELSE, "ELSE");
+  writeNameSearch(OS, Entries.slice(Mid), Local, Depth + 1, OnMatch);
+  writeU8(OS, OPCODE_END, "END");
+}
+
+// Write a search over the handlers in `Entries` for the name in `Local`,
+// calling the handler that matches.
+static void writeDispatchSearch(raw_ostream &OS,
+                                ArrayRef<DispatchEntry> Entries,
+                                uint32_t Local, uint32_t Depth) {
+  writeNameSearch(OS, Entries, Local, Depth,
+                  [&](const DispatchEntry &E, uint32_t) {
+                    writeDispatchCall(OS, E);
+                  });
+}
+
+// Resolve the action and notify handlers recorded in the input objects to
+// their output function indices.  The result drives both the generated
+// dispatcher and the optional "snax.dispatch" section.
+void Writer::calculateDispatchEntries() {
+  // Handler names are looked up directly in the symbol table's hash map
+  // rather than by scanning the functions of every input file.
+  auto GetHandler = [](uint64_t Action, StringRef Name) -> DispatchEntry {
+    auto *Sym = dyn_cast_or_null<FunctionSymbol>(Symtab->find(Name));
+    if (InputFunction *F = getInlinableHandler(Sym))
+      return {Action, 0, F};
+    if (!Sym || !Sym->hasFunctionIndex())
+      fatal("dispatch handler not found: " + Name);
+    return {Action, Sym->getFunctionIndex(), nullptr};
+  };
+
+  std::set<StringRef> HasDispatched;
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    // <action>:<generated_dispatch_func>
+    for (StringRef Act : File->getSnaxActions()) {
+      if (!HasDispatched.insert(Act).second)
+        continue;
+      std::pair<StringRef, StringRef> P = Act.split(':');
+      ActionHandlers.push_back(GetHandler(toSnaxName(P.first), P.second));
+    }
+  }
+  sortDispatchEntries(ActionHandlers);
 
-   auto create_if = [&](raw_string_ostream& os, std::string str, bool& need_else) {
-      if (need_else) {
-         writeU8(os, OPCODE_ELSE, "ELSE");
+  // Group the notify handlers by code, each group searched by action.
+  std::map<StringRef, std::vector<DispatchEntry>> NotifyMap;
+  HasDispatched.clear();
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    // <code_name>::<action>:<generated_notify_dispatch_func>
+    for (StringRef Notif : File->getSnaxNotify()) {
+      if (!HasDispatched.insert(Notif).second)
+        continue;
+      size_t Idx = Notif.find(':');
+      StringRef Code = Notif.substr(0, Idx);
+      std::pair<StringRef, StringRef> P = Notif.substr(Idx + 2).split(':');
+      if (Code == "snax" && P.first == "onerror")
+        HasOnErrorHandler = true;
+      NotifyMap[Code].push_back(GetHandler(toSnaxName(P.first), P.second));
+    }
+  }
+
+  for (auto &Pair : NotifyMap) {
+    sortDispatchEntries(Pair.second);
+    if (Pair.first == "*")
+      WildcardNotifyHandlers = std::move(Pair.second);
+    else
+      NotifyHandlers.push_back(
+          {toSnaxName(Pair.first), std::move(Pair.second)});
+  }
+  std::sort(NotifyHandlers.begin(), NotifyHandlers.end(),
+            [](const NotifyCodeEntry &A, const NotifyCodeEntry &B) {
+              return A.Name < B.Name;
+            });
+}
+
+// Returns a hash of everything createDispatchFunction() reads: the action
+// and notify lists of the objects, the handlers they resolved to and the
+// indices of the other functions that the dispatcher calls.
+uint64_t Writer::getDispatchKey() {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    for (StringRef Act : File->getSnaxActions())
+      OS << "action " << Act << "\n";
+    for (StringRef Notif : File->getSnaxNotify())
+      OS << "notify " << Notif << "\n";
+  }
+
+  auto WriteEntries = [&](ArrayRef<DispatchEntry> Entries) {
+    for (const DispatchEntry &E : Entries) {
+      OS << "entry " << E.Name << " " << E.FunctionIndex << " ";
+      if (E.Inline)
+        writeInlinedHandler(OS, E.Inline);
+      OS << "\n";
+    }
+  };
+  WriteEntries(ActionHandlers);
+  for (const NotifyCodeEntry &C : NotifyHandlers) {
+    OS << "code " << C.Name << "\n";
+    WriteEntries(C.Actions);
+  }
+  OS << "wildcard\n";
+  WriteEntries(WildcardNotifyHandlers);
+
+  for (StringRef Name : getDispatcherCallees()) {
+    OS << Name << " ";
+    auto *Sym = dyn_cast_or_null<FunctionSymbol>(Symtab->find(Name));
+    if (Sym && Sym->hasFunctionIndex())
+      OS << Sym->getFunctionIndex();
+    OS << "\n";
+  }
+  OS << "ctors " << InitFunctions.empty() << " onerror " << HasOnErrorHandler;
+  return xxHash64(OS.str());
+}
+
+void Writer::createDispatchFunction() {
+   uint64_t Key = 0;
+   if (Cache) {
+      Key = getDispatchKey();
+      if (Optional<StringRef> Body = Cache->lookup("dispatch", Key)) {
+         log("snax cache: reusing the dispatcher");
+         cast<SyntheticFunction>(WasmSym::EntryFunc->Function)
+             ->setBody(toArrayRef(Saver.save(*Body)));
+         return;
       }
-      need_else = true;
-      uint64_t nm = snax::cdt::string_to_name(str.substr(0, str.find(":")).c_str());
-      writeU8(os, OPCODE_I64_CONST, "I64 CONST");
-      encodeSLEB128((int64_t)nm, os);
-      writeU8(os, OPCODE_GET_LOCAL, "GET_LOCAL");
-      writeUleb128(os, 2, "action");
-      writeU8(os, OPCODE_I64_EQ, "I64_EQ");
-      writeU8(os, OPCODE_IF, "IF action == name");
-      writeU8(os, 0x40, "none");
-      writeU8(os, OPCODE_GET_LOCAL, "GET_LOCAL");
-      writeUleb128(os, 0, "receiver");
-      writeU8(os, OPCODE_GET_LOCAL, "GET_LOCAL");
-      writeUleb128(os, 1, "code");
-      writeU8(os, OPCODE_CALL, "CALL");
-      auto func_sym = (FunctionSymbol*)Symtab->find(str.substr(str.find(":")+1));
-      uint32_t index = func_sym->getFunctionIndex();
-      if (index >= 0)
-         writeUleb128(os, index, "index");
-      else
-         throw std::runtime_error("wasm_ld internal error function not found");
-   };
+   }
 
    auto assert_sym = (FunctionSymbol*)Symtab->find("snax_assert_code");
    uint32_t assert_idx = assert_sym->getFunctionIndex();
    auto post_sym = (FunctionSymbol*)Symtab->find("post_dispatch");
 
    auto create_action_dispatch = [&](raw_string_ostream& OS) {
-      // count how many total actions we have
-      int act_cnt = 0;
-
-      // create the dispatching for the actions
-      std::set<StringRef> has_dispatched;
-      bool need_else = false;
-      for (ObjFile *File : Symtab->ObjectFiles) {
-        if (!File->getSnaxActions().empty()) {
-            for (auto act : File->getSnaxActions()) {
-              if (has_dispatched.insert(act).second) {
-                create_if(OS, act.str(), need_else);
-                act_cnt++;
-              }
-            }
-        }
-      }
-      if (act_cnt > 0)
-        writeU8(OS, OPCODE_ELSE, "ELSE");
+      // every matching handler branches out of this block, so falling
+      // through the search means that no action was found
+      writeU8(OS, OPCODE_BLOCK, "BLOCK");
+      writeU8(OS, 0x40, "none");
+      writeDispatchSearch(OS, ActionHandlers, 2, 0);
 
       // do not fail if self == snax
       writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
@@ -1105,33 +1958,10 @@ void Writer::createDispatchFunction() {
          writeUleb128(OS, post_idx, "post_dispatch call");
       }
       writeU8(OS, OPCODE_END, "END");
-
-      for (int i=0; i < act_cnt; i++) {
-         writeU8(OS, OPCODE_END, "END");
-      }
+      writeU8(OS, OPCODE_END, "END block");
    };
 
    auto create_notify_dispatch = [&](raw_string_ostream& OS) {
-      // count how many total notify handlers we have and register them
-      int not_cnt = 0;
-      std::set<StringRef> has_dispatched;
-      std::map<std::string, std::vector<std::string>> notify_handlers;
-      for (ObjFile *File : Symtab->ObjectFiles) {
-         if (!File->getSnaxNotify().empty()) {
-            for (auto notif : File->getSnaxNotify()) {
-              if (has_dispatched.insert(notif).second) {
-                not_cnt++;
-                std::string snotif = notif.str();
-                size_t idx = snotif.find(":");
-                // <code_name>::<action>:<generated_notify_dispatch_func>
-                auto code_name = snotif.substr(0, idx);
-                auto rest      = snotif.substr(idx+2);
-                notify_handlers[code_name].push_back(rest);
-              }
-            }
-         }
-      }
-
       writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
       writeUleb128(OS, 0, "self");
       writeU8(OS, OPCODE_I64_CONST, "I64.CONST");
@@ -1139,20 +1969,8 @@ void Writer::createDispatchFunction() {
       writeU8(OS, OPCODE_I64_NE, "I64.NE");
       writeU8(OS, OPCODE_IF, "if receiver != snax");
       writeU8(OS, 0x40, "none");
-      
-      // check for onerror first
-      bool has_onerror_handler = false;
-      if (not_cnt > 0) {
-         for (auto const& notif0 : notify_handlers) {
-            uint64_t nm = snax::cdt::string_to_name(notif0.first.c_str());
-            if (notif0.first == "snax")
-               for (auto const& notif1 : notif0.second)
-                  if (notif1 == "onerror")
-                     has_onerror_handler = true;
-         }
-      }
 
-      if (!has_onerror_handler) {
+      if (!HasOnErrorHandler) {
          // assert on onerror
          writeU8(OS, OPCODE_I64_CONST, "I64.CONST");
          uint64_t acnt = snax::cdt::string_to_name("snax");
@@ -1181,40 +1999,19 @@ void Writer::createDispatchFunction() {
          writeU8(OS, OPCODE_END, "END");
       }
 
-      // dispatch notification handlers
-      bool notify0_need_else = false;
-      if (not_cnt > 0) {
-         for (auto const& notif0 : notify_handlers) {
-            uint64_t nm = snax::cdt::string_to_name(notif0.first.c_str());
-            if (notif0.first == "*")
-               continue;
-            if (notify0_need_else)
-               writeU8(OS, OPCODE_ELSE, "ELSE");
-            writeU8(OS, OPCODE_I64_CONST, "I64.CONST");
-            encodeSLEB128((int64_t)nm, OS);
-            writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
-            writeUleb128(OS, 1, "code");
-            writeU8(OS, OPCODE_I64_EQ, "I64.EQ");
-            writeU8(OS, OPCODE_IF, "IF code==?");
-            writeU8(OS, 0x40, "none");
-            bool need_else = false;
-            for (auto const& notif1 : notif0.second)
-               create_if(OS, notif1, need_else);
-            notify0_need_else = true;
-         }
-         writeU8(OS, OPCODE_END, "END");
-         writeU8(OS, OPCODE_ELSE, "ELSE");
-      }
-
-      if (!notify_handlers["*"].empty()) {
-         bool need_else = false;
-         for (auto const& notif1 : notify_handlers["*"]) {
-            create_if(OS, notif1, need_else);
-         }
-      }
+      // dispatch notification handlers: search the code first, then the
+      // action among that code's handlers.  A code with no handler for the
+      // action is done; an unknown code falls through to the wildcard
+      // handlers and, failing those, to post_dispatch.
+      writeU8(OS, OPCODE_BLOCK, "BLOCK");
+      writeU8(OS, 0x40, "none");
+      writeNameSearch(OS, makeArrayRef(NotifyHandlers), 1, 0,
+                      [&](const NotifyCodeEntry &C, uint32_t Depth) {
+                        writeDispatchSearch(OS, C.Actions, 2, Depth);
+                      });
+      writeDispatchSearch(OS, WildcardNotifyHandlers, 2, 0);
 
       if (post_sym) {
-         writeU8(OS, OPCODE_ELSE, "ELSE");
          uint32_t post_idx  = post_sym->getFunctionIndex();
          writeU8(OS, OPCODE_GET_LOCAL, "GET_LOCAL");
          writeUleb128(OS, 0, "receiver");
@@ -1225,9 +2022,8 @@ void Writer::createDispatchFunction() {
          writeU8(OS, OPCODE_CALL, "CALL");
          writeUleb128(OS, post_idx, "post_dispatch call");
       }
-
-      for (int i=0; i < not_cnt; i++)
-        writeU8(OS, OPCODE_END, "END");
+      writeU8(OS, OPCODE_END, "END block");
+      writeU8(OS, OPCODE_END, "END");
    };
 
    std::string BodyContent;
@@ -1239,7 +2035,7 @@ void Writer::createDispatchFunction() {
       auto ctors_sym = (FunctionSymbol*)Symtab->find("__wasm_call_ctors");
       if (ctors_sym) {
          uint32_t ctors_idx = ctors_sym->getFunctionIndex();
-         if (ctors_idx != 0) {
+         if (ctors_idx != 0 && !InitFunctions.empty()) {
             writeU8(OS, OPCODE_CALL, "CALL");
             writeUleb128(OS, ctors_idx, "__wasm_call_ctors");
          }
@@ -1306,6 +2102,8 @@ void Writer::createDispatchFunction() {
 
    ArrayRef<uint8_t> Body = toArrayRef(Saver.save(FunctionBody));
    cast<SyntheticFunction>(WasmSym::EntryFunc->Function)->setBody(Body);
+   if (Cache)
+      Cache->insert("dispatch", Key, FunctionBody);
 }
 
 // Create synthetic "__wasm_call_ctors" function based on ctor functions
@@ -1357,22 +2155,107 @@ void Writer::calculateInitFunctions() {
                    });
 }
 
+// Runs as many of the constructors as possible at link time, from the
+// first, and removes them from __wasm_call_ctors. The data section is then
+// written from the memory they left behind.
+void Writer::snapshotCtors() {
+  CtorEvalModule M;
+  M.Functions = InputFunctions;
+  M.Globals = InputGlobals;
+  if (!Config->ImportTable)
+    M.Table = IndirectFunctions;
+  M.Types = Types;
+  M.Segments = Segments;
+  M.NumImportedFunctions = NumImportedFunctions;
+  M.NumImportedGlobals = NumImportedGlobals;
+  M.NumMemoryPages = NumMemoryPages;
+  M.TableBase = kInitialTableOffset;
+
+  std::vector<const FunctionSymbol *> Ctors;
+  for (const WasmInitEntry &F : InitFunctions)
+    Ctors.push_back(F.Sym);
+  size_t NumRun = evaluateCtors(M, Ctors, CtorSnapshot);
+  log("--snax-eval-ctors: ran " + Twine(NumRun) + " of " +
+      Twine(Ctors.size()) + " constructors at link time");
+  if (NumRun == 0)
+    return;
+
+  // Function indices are already assigned, so a constructor that is no
+  // longer called cannot be removed. Its body is replaced with a stub if
+  // nothing else can reach it.
+  DenseSet<const InputFunction *> Used;
+  for (ObjFile *File : Symtab->ObjectFiles) {
+    for (const Symbol *Sym : File->getSymbols()) {
+      auto *F = dyn_cast_or_null<DefinedFunction>(Sym);
+      if (F && F->Function && (!F->isLocal() || F->hasTableIndex()))
+        Used.insert(F->Function);
+    }
+
+    auto MarkCallees = [&](const InputChunk *C) {
+      for (const WasmRelocation &Reloc : C->getRelocations()) {
+        if (Reloc.Type != R_WEBASSEMBLY_FUNCTION_INDEX_LEB)
+          continue;
+        if (auto *F = dyn_cast<DefinedFunction>(File->getSymbol(Reloc.Index)))
+          Used.insert(F->Function);
+      }
+    };
+    for (const InputFunction *F : File->Functions)
+      MarkCallees(F);
+    for (const InputSegment *S : File->Segments)
+      MarkCallees(S);
+    for (const InputSection *S : File->CustomSections)
+      MarkCallees(S);
+  }
+
+  for (size_t I = 0; I < NumRun; ++I) {
+    auto *F = dyn_cast<DefinedFunction>(InitFunctions[I].Sym);
+    if (F && F->Function && F->Function->File && F->isLocal() &&
+        !F->hasTableIndex() && !Used.count(F->Function))
+      F->Function->stubOut();
+  }
+
+  InitFunctions.erase(InitFunctions.begin(), InitFunctions.begin() + NumRun);
+  createCtorFunction();
+  if (Symtab->EntryIsUndefined)
+    createDispatchFunction();
+}
+
+static Timer WriterTimer("Writer", Timer::root());
+static Timer LayoutTimer("Layout", WriterTimer);
+static Timer DispatchTimer("Dispatch Generation", WriterTimer);
+static Timer CreateSectionsTimer("Create Sections", WriterTimer);
+static Timer OutputTimer("Write Output File", WriterTimer);
+static Timer ABITimer("ABI Merge", WriterTimer);
+
 void Writer::run(bool is_entry_defined) {
+  ScopedTimer T(WriterTimer);
   if (Config->Relocatable)
     Config->GlobalBase = 0;
+  if (Config->Incremental && !Config->Relocatable)
+    Cache = make<SnaxCache>((Config->OutputFile + ".snax-cache").str());
 
+  ScopedTimer T1(LayoutTimer);
   log("-- calculateImports");
   calculateImports();
   log("-- assignIndexes");
   assignIndexes();
+  if (Config->Devirtualize)
+    writeCallGuards();
   log("-- calculateInitFunctions");
   calculateInitFunctions();
   if (!Config->Relocatable)
     createCtorFunction();
+  T1.stop();
 
+  ScopedTimer T2(DispatchTimer);
+  if (!Config->Relocatable &&
+      (Symtab->EntryIsUndefined || Config->DispatchSection))
+    calculateDispatchEntries();
   if (Symtab->EntryIsUndefined)
      createDispatchFunction();
+  T2.stop();
 
+  ScopedTimer T3(LayoutTimer);
   log("-- calculateTypes");
   calculateTypes();
   log("-- layoutMemory");
@@ -1393,10 +2276,26 @@ void Writer::run(bool is_entry_defined) {
       File->dumpInfo();
   }
 
+  T3.stop();
+
+  ScopedTimer T4(CreateSectionsTimer);
+  log("-- resolveRelocations");
+  resolveRelocations();
+  if (Config->EvalCtors && !InitFunctions.empty()) {
+    log("-- snapshotCtors");
+    snapshotCtors();
+  }
   createHeader();
   log("-- createSections");
   createSections();
+  T4.stop();
+
+  if (Config->PrintActionFootprint)
+    printActionFootprint();
+  if (Config->PrintActionCost)
+    printActionCost();
 
+  ScopedTimer T5(OutputTimer);
   log("-- openFile");
   openFile();
   if (errorCount())
@@ -1409,15 +2308,38 @@ void Writer::run(bool is_entry_defined) {
   if (errorCount())
     return;
 
+  if (FunctionHashSec)
+    writeFunctionHashes();
+  if (BuildIdSec)
+    writeBuildId();
+
+  // Snax identifies contract code by the sha256 of the whole module, so
+  // write it next to the output for deploy tooling to compare.
+  std::string ModuleHash;
+  if (BuildIdSec)
+    ModuleHash = toHex(
+        toStringRef(sha256(makeArrayRef(Buffer->getBufferStart(), FileSize))),
+        /*LowerCase=*/true);
+
   if (Error E = Buffer->commit())
     fatal("failed to write the output file: " + toString(std::move(E)));
 
+  if (BuildIdSec)
+    writeSidecarFile((Config->OutputFile + ".sha256").str(), ModuleHash + "\n");
+
+  writeMapFile(OutputSections);
+  T5.stop();
+
+  ScopedTimer T6(ABITimer);
   writeABI();
+  if (Cache && !errorCount())
+    Cache->commit();
 }
 
 // Open a result file.
 void Writer::openFile() {
   log("writing: " + Config->OutputFile);
+  OutputBufferBytes = FileSize;
 
   Expected<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
       FileOutputBuffer::create(Config->OutputFile, FileSize,
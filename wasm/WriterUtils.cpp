@@ -73,6 +73,11 @@ void wasm::writeU32(raw_ostream &OS, uint32_t Number, const Twine &Msg) {
   support::endian::write(OS, Number, support::little);
 }
 
+void wasm::writeU64(raw_ostream &OS, uint64_t Number, const Twine &Msg) {
+  debugWrite(OS.tell(), Msg + "[0x" + utohexstr(Number) + "]");
+  support::endian::write(OS, Number, support::little);
+}
+
 void wasm::writeValueType(raw_ostream &OS, uint8_t Type, const Twine &Msg) {
   writeU8(OS, Type, Msg + "[type: " + valueTypeToString(Type) + "]");
 }